@@ -11,6 +11,7 @@
  *   http://www.eclipse.org/org/documents/edl-v10.php.
  *******************************************************************************/
 #include "ezDevSDK_boot.h"
+#include "ezDevSDK_kv.h"
 #include "ezdev_sdk_kernel.h"
 #include "platform_define.h"
 #include "thread_interface.h"
@@ -30,6 +31,11 @@ NET_PLATFORM_INTERFACE
 LOG_PLATFORM_INTERFACE
 TIME_PLATFORM_INTERFACE
 MUTEX_PLATFORM_INTERFACE
+SEM_PLATFORM_INTERFACE
+THREAD_PLATFORM_INTERFACE
+#ifdef __linux__
+NET_WAKEUP_PLATFORM_INTERFACE
+#endif
 
 #define BOOT_MAIN_THREAD_NAME "ez_kernel_main"
 #define BOOT_USER_THREAD_NAME "ez_kernel_user"
@@ -55,6 +61,7 @@ unsigned int sdk_main_thread(void *user_data)
         {
             break;
         }
+        ezDevSDK_kv_flush(0);
         sdk_thread_sleep(10);
     } while (g_running && sdk_error != ezdev_sdk_kernel_invald_call);
 
@@ -152,11 +159,11 @@ void value_load(sdk_keyvalue_type valuetype, unsigned char *keyvalue, EZDEV_SDK_
     {
         if (valuetype == sdk_keyvalue_devid)
         {
-            get_file_value(g_all_config.config.dev_id, keyvalue, keyvalue_maxsize);
+            ezDevSDK_kv_load(ezDevSDK_kv_devid, keyvalue, keyvalue_maxsize);
         }
         else if (valuetype == sdk_keyvalue_masterkey)
         {
-            get_file_value(g_all_config.config.dev_masterkey, keyvalue, keyvalue_maxsize);
+            ezDevSDK_kv_load(ezDevSDK_kv_masterkey, keyvalue, keyvalue_maxsize);
         }
     }
 }
@@ -180,11 +187,11 @@ EZDEV_SDK_INT32 value_save(sdk_keyvalue_type valuetype, unsigned char *keyvalue,
     {
         if (valuetype == sdk_keyvalue_devid)
         {
-            iRv = set_file_value(g_all_config.config.dev_id, keyvalue, keyvalue_size);
+            iRv = ezDevSDK_kv_save(ezDevSDK_kv_devid, keyvalue, keyvalue_size);
         }
         else if (valuetype == sdk_keyvalue_masterkey)
         {
-            iRv = set_file_value(g_all_config.config.dev_masterkey, keyvalue, keyvalue_size);
+            iRv = ezDevSDK_kv_save(ezDevSDK_kv_masterkey, keyvalue, keyvalue_size);
         }
     }
 
@@ -244,6 +251,12 @@ void event_notice_from_sdk_kernel(ezdev_sdk_kernel_event *ptr_event)
     case sdk_kernel_event_heartbeat_interval_changed:
         g_all_config.notice.event_notice(ezDevSDK_App_Event_heartbeat_interval_changed, ptr_event->event_context);
         break;
+    case sdk_kernel_event_send_shaped:
+        g_all_config.notice.event_notice(ezDevSDK_App_Event_Send_shaped, ptr_event->event_context);
+        break;
+    case sdk_kernel_event_sessionkey_rotated:
+        g_all_config.notice.event_notice(ezDevSDK_App_Event_Sessionkey_rotated, ptr_event->event_context);
+        break;
     case sdk_kernel_event_runtime_err:
         g_all_config.notice.event_notice(ezDevSDK_App_Event_Runtime_err, ptr_event->event_context);
     default:
@@ -303,6 +316,13 @@ int ezDevSDK_Init(const char *server_name, unsigned int server_port, ezDevSDK_al
             result_code = ezdev_sdk_kernel_value_load;
             break;
         }
+
+        if (0 == g_all_config.config.bUser && 0 != ezDevSDK_kv_init(g_all_config.config.dev_id, g_all_config.config.dev_masterkey))
+        {
+            sdk_kernel_logprint(sdk_log_error, 0, 0, "ezDevSDK_kv_init err\n");
+            result_code = ezdev_sdk_kernel_internal;
+            break;
+        }
         kernel_platform_handle.net_work_create = net_create;
         kernel_platform_handle.net_work_connect = net_connect;
         kernel_platform_handle.net_work_read = net_read;
@@ -326,12 +346,22 @@ int ezDevSDK_Init(const char *server_name, unsigned int server_port, ezDevSDK_al
         kernel_platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
         kernel_platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
         kernel_platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+        kernel_platform_handle.thread_sem_create = sdk_platform_thread_sem_create;
+        kernel_platform_handle.thread_sem_destroy = sdk_platform_thread_sem_destroy;
+        kernel_platform_handle.thread_sem_post = sdk_platform_thread_sem_post;
+        kernel_platform_handle.thread_sem_wait = sdk_platform_thread_sem_wait;
+        kernel_platform_handle.thread_start = sdk_platform_thread_start;
         kernel_platform_handle.time_sleep = sdk_thread_sleep;
+#ifdef __linux__
+        kernel_platform_handle.net_work_wait = net_wait;
+        kernel_platform_handle.net_work_wakeup = net_wakeup;
+#endif
 
         result_code = ezdev_sdk_kernel_init(server_name, server_port, &kernel_platform_handle, event_notice_from_sdk_kernel, devinfo_string, (kernel_das_info *)all_config->config.reg_das_info, reg_mode);
         if (result_code != ezdev_sdk_kernel_succ)
         {
             sdk_kernel_logprint(sdk_log_error, 0, 0,"ezdev_sdk_kernel_init err\n");
+            ezDevSDK_kv_fini();
             break;
         }
         g_init = 1;
@@ -347,6 +377,7 @@ int ezDevSDK_Fini()
         return ezdev_sdk_kernel_invald_call;
     }
     ezdev_sdk_kernel_fini();
+    ezDevSDK_kv_fini();
     g_init = 0;
     return ezdev_sdk_kernel_succ;
 }
@@ -402,9 +433,11 @@ int ezDevSDK_Stop()
     if (g_running)
     {
         g_running = 0;
+        ezdev_sdk_kernel_wakeup();
         sdk_thread_destroy(&g_main_thread);
         sdk_thread_destroy(&g_user_thread);
     }
+    ezDevSDK_kv_flush(1);
     sdk_kernel_logprint(sdk_log_debug, 0, 0,"ezDevSDK_Stop\n");
     kernel_error = ezdev_sdk_kernel_stop();
     if (kernel_error != ezdev_sdk_kernel_succ)
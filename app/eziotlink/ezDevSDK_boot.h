@@ -53,7 +53,9 @@ typedef enum
 	ezDevSDK_App_Event_fast_reg_online,		          ///<	event_context == sdk_sessionkey_context	设备快速上线
 	ezDevSDK_App_Event_Runtime_err,			          ///<	evnet_context == sdk_runtime_err_context 设备sdk运行时错误信息
 	ezDevSDK_App_Event_Reconnect_success,             ///<  evnet_context == NULL 重连成功事件回调
-	ezDevSDK_App_Event_heartbeat_interval_changed     ///<  evnet_context == int  心跳改变事件回调
+	ezDevSDK_App_Event_heartbeat_interval_changed,    ///<  evnet_context == int  心跳改变事件回调
+	ezDevSDK_App_Event_Send_shaped,                   ///<  evnet_context == sdk_send_shaped_context  消息因限速延后发送
+	ezDevSDK_App_Event_Sessionkey_rotated             ///<  evnet_context == sdk_sessionkey_context  不断线更换了会话密钥
 }ezDevSDK_App_Event;
 
 /**
@@ -0,0 +1,492 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "ezDevSDK_kv.h"
+#include "base_typedef.h"
+#include "ezdev_sdk_kernel_struct.h"
+#include "platform_define.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+#define EZDEVSDK_KV_RETRY_MS		1000	///<	落盘失败后的重试间隔
+
+typedef struct
+{
+	char path[EZDEVSDK_KV_PATH_MAX];
+	unsigned char value[EZDEVSDK_KV_VALUE_MAX];
+	int len;
+	EZDEV_SDK_INT8 loaded;					///<	是否已经从文件加载过
+	EZDEV_SDK_INT8 exist;					///<	文件或内存中是否有值
+	EZDEV_SDK_INT8 dirty;					///<	是否有未落盘的修改
+	EZDEV_SDK_UINT32 version;				///<	每次修改加1, 落盘期间被修改时不清除脏标记
+} kv_entry;
+
+typedef struct
+{
+	kv_entry entry[ezDevSDK_kv_count];
+	ezdev_sdk_mutex lock;
+	ezdev_sdk_time flush_timer;
+	EZDEV_SDK_INT8 init;
+} kv_store;
+
+static kv_store g_kv_store;
+
+#if defined(_WIN32)
+
+static int kv_write_file(const char* path, const unsigned char* value, int len)
+{
+	char tmp_path[EZDEVSDK_KV_PATH_MAX + 8];
+	FILE* file = NULL;
+	int return_code = 0;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	file = fopen(tmp_path, "wb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+
+	do
+	{
+		if (len != (int)fwrite(value, 1, len, file) || 0 != fflush(file) || 0 != _commit(_fileno(file)))
+		{
+			return_code = -1;
+			break;
+		}
+	} while (0);
+
+	fclose(file);
+	if (0 != return_code)
+	{
+		remove(tmp_path);
+		return return_code;
+	}
+
+	/* windows的rename不能覆盖已存在的文件, 先remove再rename中间掉电会两个文件都丢, 用MoveFileEx原子替换 */
+	if (!MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		remove(tmp_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int kv_promote_new(const char* path)
+{
+	/* MoveFileEx原子替换, 不会留下.new */
+	(void)path;
+	return 0;
+}
+
+#else
+
+static int kv_write_fd(int fd, const unsigned char* buf, int count)
+{
+	int left = count;
+	int ret = 0;
+
+	while (left > 0)
+	{
+		ret = write(fd, buf + count - left, left);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		left -= ret;
+	}
+
+	return 0;
+}
+
+static void kv_sync_dir(const char* path)
+{
+#ifndef _RT_THREAD_
+	char dir[EZDEVSDK_KV_PATH_MAX];
+	char* slash = NULL;
+	int fd = -1;
+
+	strncpy(dir, path, sizeof(dir) - 1);
+	dir[sizeof(dir) - 1] = '\0';
+	slash = strrchr(dir, '/');
+	if (slash == NULL)
+	{
+		strcpy(dir, ".");
+	}
+	else if (slash == dir)
+	{
+		slash[1] = '\0';
+	}
+	else
+	{
+		*slash = '\0';
+	}
+
+	/* rename本身也要落盘, 否则掉电后目录项可能还指向旧文件 */
+	fd = open(dir, O_RDONLY);
+	if (fd != -1)
+	{
+		fsync(fd);
+		close(fd);
+	}
+#else
+	(void)path;
+#endif
+}
+
+/**
+ * \brief   把残留的.new换成正式文件, 没有.new时什么都不做
+ * \note    .new只会是已落盘的完整新值, 存在时优先于正式文件. 删除正式文件后中断,
+ *          下次加载仍然读.new, 所以任何一步中断都不会丢值
+ */
+static int kv_promote_new(const char* path)
+{
+	char new_path[EZDEVSDK_KV_PATH_MAX + 8];
+	struct stat st;
+
+	snprintf(new_path, sizeof(new_path), "%s.new", path);
+	if (0 != stat(new_path, &st))
+	{
+		return 0;
+	}
+
+	unlink(path);
+	if (0 != rename(new_path, path))
+	{
+		return -1;
+	}
+
+	kv_sync_dir(path);
+	return 0;
+}
+
+/**
+ * \brief   用已落盘的临时文件替换正式文件
+ * \note    有的文件系统(如FAT)rename不能覆盖已存在的文件, 这时先把临时文件改名为.new再替换
+ */
+static int kv_replace_file(const char* tmp_path, const char* path)
+{
+	char new_path[EZDEVSDK_KV_PATH_MAX + 8];
+
+	if (0 == rename(tmp_path, path))
+	{
+		return 0;
+	}
+
+	snprintf(new_path, sizeof(new_path), "%s.new", path);
+	if (0 != rename(tmp_path, new_path))
+	{
+		return -1;
+	}
+
+	kv_sync_dir(path);
+	return kv_promote_new(path);
+}
+
+static int kv_write_file(const char* path, const unsigned char* value, int len)
+{
+	char tmp_path[EZDEVSDK_KV_PATH_MAX + 8];
+	int fd = -1;
+	int return_code = 0;
+
+	/* 上次替换没做完时先做完, 保证写的时候不存在.new */
+	if (0 != kv_promote_new(path))
+	{
+		return -1;
+	}
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+	{
+		return -1;
+	}
+
+	do
+	{
+		if (0 != kv_write_fd(fd, value, len) || 0 != fsync(fd))
+		{
+			return_code = -1;
+			break;
+		}
+	} while (0);
+
+	close(fd);
+	if (0 != return_code)
+	{
+		unlink(tmp_path);
+		return return_code;
+	}
+
+	if (0 != kv_replace_file(tmp_path, path))
+	{
+		unlink(tmp_path);
+		return -1;
+	}
+
+	kv_sync_dir(path);
+	return 0;
+}
+
+#endif
+
+static int kv_read_path(kv_entry* entry, const char* path)
+{
+	FILE* file = NULL;
+	int real_read = 0;
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+
+	real_read = (int)fread(entry->value, 1, EZDEVSDK_KV_VALUE_MAX, file);
+	fclose(file);
+	if (real_read <= 0)
+	{
+		return -1;
+	}
+
+	entry->len = real_read;
+	entry->exist = 1;
+	return 0;
+}
+
+static void kv_read_file(kv_entry* entry)
+{
+	char new_path[EZDEVSDK_KV_PATH_MAX + 8];
+
+	entry->loaded = 1;
+	entry->exist = 0;
+	entry->len = 0;
+
+	/* 残留的.new是替换正式文件中途掉电留下的完整新值, 先换成正式文件, 换不成就直接读它 */
+	kv_promote_new(entry->path);
+	snprintf(new_path, sizeof(new_path), "%s.new", entry->path);
+	if (0 == kv_read_path(entry, new_path))
+	{
+		return;
+	}
+
+	/* 残留的.tmp是写临时文件中途掉电的产物, 内容可能不完整, 直接忽略 */
+	kv_read_path(entry, entry->path);
+}
+
+int ezDevSDK_kv_init(const char* devid_path, const char* masterkey_path)
+{
+	int return_code = 0;
+
+	do
+	{
+		if (g_kv_store.init)
+		{
+			return_code = -1;
+			break;
+		}
+
+		if (devid_path == NULL || masterkey_path == NULL ||
+			strlen(devid_path) >= EZDEVSDK_KV_PATH_MAX || strlen(masterkey_path) >= EZDEVSDK_KV_PATH_MAX)
+		{
+			return_code = -1;
+			break;
+		}
+
+		memset(&g_kv_store, 0, sizeof(g_kv_store));
+		strcpy(g_kv_store.entry[ezDevSDK_kv_devid].path, devid_path);
+		strcpy(g_kv_store.entry[ezDevSDK_kv_masterkey].path, masterkey_path);
+
+		g_kv_store.lock = sdk_platform_thread_mutex_create();
+		g_kv_store.flush_timer = Platform_TimerCreater();
+		if (g_kv_store.lock == NULL || g_kv_store.flush_timer == NULL)
+		{
+			return_code = -1;
+			break;
+		}
+
+		g_kv_store.init = 1;
+	} while (0);
+
+	if (0 != return_code && !g_kv_store.init)
+	{
+		if (g_kv_store.lock != NULL)
+		{
+			sdk_platform_thread_mutex_destroy(g_kv_store.lock);
+			g_kv_store.lock = NULL;
+		}
+		if (g_kv_store.flush_timer != NULL)
+		{
+			Platform_TimeDestroy(g_kv_store.flush_timer);
+			g_kv_store.flush_timer = NULL;
+		}
+	}
+
+	return return_code;
+}
+
+int ezDevSDK_kv_load(ezDevSDK_kv_key key, unsigned char* value, int value_maxsize)
+{
+	int return_code = 0;
+	kv_entry* entry = NULL;
+
+	if (!g_kv_store.init || key >= ezDevSDK_kv_count || value == NULL)
+	{
+		return -1;
+	}
+
+	entry = &g_kv_store.entry[key];
+	sdk_platform_thread_mutex_lock(g_kv_store.lock);
+	do
+	{
+		if (!entry->loaded)
+		{
+			kv_read_file(entry);
+		}
+
+		if (!entry->exist || entry->len > value_maxsize)
+		{
+			return_code = -1;
+			break;
+		}
+
+		memcpy(value, entry->value, entry->len);
+	} while (0);
+	sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+
+	return return_code;
+}
+
+int ezDevSDK_kv_save(ezDevSDK_kv_key key, unsigned char* value, int value_size)
+{
+	kv_entry* entry = NULL;
+
+	if (!g_kv_store.init || key >= ezDevSDK_kv_count || value == NULL ||
+		value_size <= 0 || value_size > EZDEVSDK_KV_VALUE_MAX)
+	{
+		return -1;
+	}
+
+	entry = &g_kv_store.entry[key];
+	sdk_platform_thread_mutex_lock(g_kv_store.lock);
+	do
+	{
+		if (!entry->loaded)
+		{
+			kv_read_file(entry);
+		}
+
+		/* 值没有变化时不写flash */
+		if (entry->exist && entry->len == value_size && 0 == memcmp(entry->value, value, value_size))
+		{
+			break;
+		}
+
+		memcpy(entry->value, value, value_size);
+		entry->len = value_size;
+		entry->exist = 1;
+		entry->dirty = 1;
+		entry->version++;
+
+		/* 每次写都重新开始合并窗口, 连续写的多个key在窗口结束后一起落盘 */
+		Platform_TimerCountdownMS(g_kv_store.flush_timer, EZDEVSDK_KV_COALESCE_MS);
+	} while (0);
+	sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+
+	return 0;
+}
+
+int ezDevSDK_kv_flush(int force)
+{
+	int i = 0;
+	int return_code = 0;
+	kv_entry snapshot;
+	kv_entry* entry = NULL;
+
+	if (!g_kv_store.init)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < ezDevSDK_kv_count; i++)
+	{
+		entry = &g_kv_store.entry[i];
+
+		sdk_platform_thread_mutex_lock(g_kv_store.lock);
+		if (!entry->dirty)
+		{
+			sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+			continue;
+		}
+		if (!force && !Platform_TimerIsExpired(g_kv_store.flush_timer))
+		{
+			sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+			return -1;
+		}
+		memcpy(&snapshot, entry, sizeof(snapshot));
+		sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+
+		/* 写文件时不持锁, 避免阻塞读取 */
+		if (0 != kv_write_file(snapshot.path, snapshot.value, snapshot.len))
+		{
+			sdk_platform_thread_mutex_lock(g_kv_store.lock);
+			Platform_TimerCountdownMS(g_kv_store.flush_timer, EZDEVSDK_KV_RETRY_MS);
+			sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+			return_code = -1;
+			continue;
+		}
+
+		sdk_platform_thread_mutex_lock(g_kv_store.lock);
+		if (entry->version == snapshot.version)
+		{
+			entry->dirty = 0;
+		}
+		else
+		{
+			return_code = -1;
+		}
+		sdk_platform_thread_mutex_unlock(g_kv_store.lock);
+	}
+
+	return return_code;
+}
+
+void ezDevSDK_kv_fini()
+{
+	if (!g_kv_store.init)
+	{
+		return;
+	}
+
+	ezDevSDK_kv_flush(1);
+
+	sdk_platform_thread_mutex_destroy(g_kv_store.lock);
+	Platform_TimeDestroy(g_kv_store.flush_timer);
+	memset(&g_kv_store, 0, sizeof(g_kv_store));
+}
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEVSDK_KV_H_
+#define H_EZDEVSDK_KV_H_
+
+/**
+ * \brief 文件方式(bUser为0)存取devid和masterkey时使用的缓存层
+ * \note
+ * - 每个key仍然对应原来配置的文件路径, 文件内容和原来一致, 已上线的设备无需迁移
+ * - 读只在第一次访问文件, 之后直接返回内存中的值
+ * - 写先更新内存, 在合并窗口(EZDEVSDK_KV_COALESCE_MS)结束后统一落盘, 连续写devid和masterkey只落盘一次
+ * - 落盘先写临时文件并同步, 再rename覆盖正式文件(windows用MoveFileEx), 掉电时文件要么是旧值要么是新值, 不会出现写了一半的内容
+ * - rename不能覆盖已存在文件的文件系统经由.new替换, 加载时.new优先于正式文件
+ * - 落盘失败的key保持脏状态, 下次flush时重试
+ */
+
+#define EZDEVSDK_KV_COALESCE_MS		100		///<	写合并窗口, 毫秒
+#define EZDEVSDK_KV_VALUE_MAX		64		///<	单个value的最大长度, 与get_file_value一致
+#define EZDEVSDK_KV_PATH_MAX		128		///<	文件路径最大长度, 与ezDevSDK_config一致
+
+typedef enum
+{
+	ezDevSDK_kv_devid,						///<	devid
+	ezDevSDK_kv_masterkey,					///<	masterkey
+	ezDevSDK_kv_count						///<	枚举上限
+} ezDevSDK_kv_key;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ *  \brief		初始化缓存层
+ *  \method		ezDevSDK_kv_init
+ *  \param[in]	devid_path			devid文件路径
+ *  \param[in]	masterkey_path		masterkey文件路径
+ *  \returns    成功返回0,失败返回-1
+ */
+int ezDevSDK_kv_init(const char* devid_path, const char* masterkey_path);
+
+/**
+ *  \brief		读取value, 第一次读取时从文件加载
+ *  \method		ezDevSDK_kv_load
+ *  \param[in]	key					key
+ *  \param[out]	value				数据地址
+ *  \param[in]	value_maxsize		数据最大长度
+ *  \returns    成功返回0,失败返回-1
+ */
+int ezDevSDK_kv_load(ezDevSDK_kv_key key, unsigned char* value, int value_maxsize);
+
+/**
+ *  \brief		保存value, 只更新内存并启动合并窗口, 由ezDevSDK_kv_flush落盘
+ *  \method		ezDevSDK_kv_save
+ *  \param[in]	key					key
+ *  \param[in]	value				数据地址
+ *  \param[in]	value_size			数据长度
+ *  \returns    成功返回0,失败返回-1
+ */
+int ezDevSDK_kv_save(ezDevSDK_kv_key key, unsigned char* value, int value_size);
+
+/**
+ *  \brief		落盘脏数据
+ *  \method		ezDevSDK_kv_flush
+ *  \param[in]	force				0:合并窗口结束后才落盘 !0:立即落盘
+ *  \returns    没有未落盘的数据返回0,否则返回-1
+ */
+int ezDevSDK_kv_flush(int force);
+
+/**
+ *  \brief		落盘脏数据并释放缓存层
+ *  \method		ezDevSDK_kv_fini
+ */
+void ezDevSDK_kv_fini();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -42,12 +42,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <float.h>
 #include <ctype.h>
 
-#ifdef ENABLE_LOCALES
-#include <locale.h>
-#endif
-
 #if defined(_MSC_VER)
 #pragma warning(pop)
 #endif
@@ -132,6 +129,7 @@ typedef struct internal_hooks
     void *(bscJSON_CDECL *allocate)(size_t size);
     void(bscJSON_CDECL *deallocate)(void *pointer);
     void *(bscJSON_CDECL *reallocate)(void *pointer, size_t size);
+    bscJSON_Arena *arena; /* allocations go to the arena instead when set */
 } internal_hooks;
 
 #if defined(_MSC_VER)
@@ -157,7 +155,79 @@ static void *bscJSON_CDECL internal_realloc(void *pointer, size_t size)
 /* strlen of character literals resolved at compile time */
 #define static_strlen(string_literal) (sizeof(string_literal) - sizeof(""))
 
-static internal_hooks global_hooks = {internal_malloc, internal_free, internal_realloc};
+static internal_hooks global_hooks = {internal_malloc, internal_free, internal_realloc, NULL};
+
+#ifndef bscJSON_ARENA_CHUNK_SIZE
+#define bscJSON_ARENA_CHUNK_SIZE 512
+#endif
+
+/* keep nodes (which hold a double) aligned inside the arena */
+#define arena_align(size) (((size) + 7) & ~(size_t)7)
+
+typedef struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+} arena_chunk;
+
+static void *arena_allocate(bscJSON_Arena *const arena, size_t size)
+{
+    arena_chunk *chunk = (arena_chunk *)arena->overflow;
+    size_t padding = 0;
+    size_t chunk_size = 0;
+    void *memory = NULL;
+
+    size = arena_align(size);
+    if (arena->block != NULL)
+    {
+        padding = arena_align((size_t)(arena->block + arena->used)) - (size_t)(arena->block + arena->used);
+        if (arena->used + padding + size <= arena->size)
+        {
+            memory = arena->block + arena->used + padding;
+            arena->used += padding + size;
+            arena->allocations++;
+            return memory;
+        }
+    }
+
+    if ((chunk == NULL) || (chunk->used + size > chunk->size))
+    {
+        chunk_size = (size > bscJSON_ARENA_CHUNK_SIZE) ? size : bscJSON_ARENA_CHUNK_SIZE;
+        chunk = (arena_chunk *)global_hooks.allocate(arena_align(sizeof(arena_chunk)) + chunk_size);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        chunk->next = (arena_chunk *)arena->overflow;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        arena->overflow = chunk;
+    }
+
+    memory = (unsigned char *)chunk + arena_align(sizeof(arena_chunk)) + chunk->used;
+    chunk->used += size;
+    arena->allocations++;
+    return memory;
+}
+
+static void *hooks_allocate(const internal_hooks *const hooks, size_t size)
+{
+    if (hooks->arena != NULL)
+    {
+        return arena_allocate(hooks->arena, size);
+    }
+    return hooks->allocate(size);
+}
+
+static void hooks_deallocate(const internal_hooks *const hooks, void *pointer)
+{
+    /* arena memory is only given back by bscJSON_ArenaReset */
+    if (hooks->arena == NULL)
+    {
+        hooks->deallocate(pointer);
+    }
+}
 
 static unsigned char *bscJSON_strdup(const unsigned char *string, const internal_hooks *const hooks)
 {
@@ -170,7 +240,7 @@ static unsigned char *bscJSON_strdup(const unsigned char *string, const internal
     }
 
     length = strlen((const char *)string) + sizeof("");
-    copy = (unsigned char *)hooks->allocate(length);
+    copy = (unsigned char *)hooks_allocate(hooks, length);
     if (copy == NULL)
     {
         return NULL;
@@ -214,7 +284,7 @@ bscJSON_PUBLIC(void) bscJSON_InitHooks(bscJSON_Hooks *hooks)
 /* Internal constructor. */
 static bscJSON *bscJSON_New_Item(const internal_hooks *const hooks)
 {
-    bscJSON *node = (bscJSON *)hooks->allocate(sizeof(bscJSON));
+    bscJSON *node = (bscJSON *)hooks_allocate(hooks, sizeof(bscJSON));
     if (node)
     {
         memset(node, '\0', sizeof(bscJSON));
@@ -223,6 +293,185 @@ static bscJSON *bscJSON_New_Item(const internal_hooks *const hooks)
     return node;
 }
 
+/* Hash index of a wide object: an open addressing table (linear probing) of the members, keyed by the
+ * lower cased name so case sensitive and case insensitive lookups share it. Members with the same name
+ * keep their list order along the probe path, so duplicated names still resolve to the first one. */
+typedef struct bscJSON_Index
+{
+    size_t count;  /* members in the table */
+    size_t mask;   /* number of slots - 1, the number of slots is a power of two */
+    bscJSON *last; /* tail of the member list, appending doesn't walk the list */
+    bscJSON *slots[1];
+} object_index;
+
+/* objects parsed into an arena point here and are never indexed, the index would outlive bscJSON_ArenaReset */
+static object_index no_index;
+
+static object_index *get_index(const bscJSON *const object)
+{
+    return (object->index == &no_index) ? NULL : object->index;
+}
+
+static size_t index_hash(const unsigned char *name)
+{
+    size_t hash = 2166136261U;
+
+    for (; *name != '\0'; name++)
+    {
+        hash = (hash ^ (size_t)tolower(*name)) * 16777619U;
+    }
+
+    return hash;
+}
+
+static void index_put(object_index *const index, bscJSON *const item)
+{
+    size_t slot = index_hash((const unsigned char *)item->string) & index->mask;
+
+    while (index->slots[slot] != NULL)
+    {
+        slot = (slot + 1) & index->mask;
+    }
+    index->slots[slot] = item;
+    index->count++;
+}
+
+static size_t index_slot_of(const object_index *const index, const bscJSON *const item)
+{
+    size_t slot = index_hash((const unsigned char *)item->string) & index->mask;
+
+    while ((index->slots[slot] != NULL) && (index->slots[slot] != item))
+    {
+        slot = (slot + 1) & index->mask;
+    }
+
+    return slot;
+}
+
+/* take item out of the table, shifting the rest of its cluster back instead of leaving a tombstone */
+static bscJSON_bool index_remove(object_index *const index, const bscJSON *const item)
+{
+    size_t slot = index_slot_of(index, item);
+    size_t next = 0;
+    size_t home = 0;
+
+    if (index->slots[slot] == NULL)
+    {
+        return false;
+    }
+
+    index->slots[slot] = NULL;
+    index->count--;
+    for (next = (slot + 1) & index->mask; index->slots[next] != NULL; next = (next + 1) & index->mask)
+    {
+        home = index_hash((const unsigned char *)index->slots[next]->string) & index->mask;
+        /* members whose home lies between the hole and their slot have to stay */
+        if (((next - home) & index->mask) >= ((next - slot) & index->mask))
+        {
+            index->slots[slot] = index->slots[next];
+            index->slots[next] = NULL;
+            slot = next;
+        }
+    }
+
+    return true;
+}
+
+/* replace in place, only possible when both names hash alike (the usual case of replacing by name) */
+static bscJSON_bool index_replace(object_index *const index, const bscJSON *const item, bscJSON *const replacement)
+{
+    size_t slot = 0;
+
+    if ((index_hash((const unsigned char *)item->string) & index->mask) != (index_hash((const unsigned char *)replacement->string) & index->mask))
+    {
+        return false;
+    }
+
+    slot = index_slot_of(index, item);
+    if (index->slots[slot] == NULL)
+    {
+        return false;
+    }
+    index->slots[slot] = replacement;
+
+    return true;
+}
+
+static bscJSON *index_find(const object_index *const index, const char *const name, const bscJSON_bool case_sensitive)
+{
+    size_t slot = index_hash((const unsigned char *)name) & index->mask;
+    bscJSON *member = NULL;
+
+    while ((member = index->slots[slot]) != NULL)
+    {
+        if (case_sensitive ? (strcmp(name, member->string) == 0) : (case_insensitive_strcmp((const unsigned char *)name, (const unsigned char *)member->string) == 0))
+        {
+            return member;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+
+    return NULL;
+}
+
+/* drop the index, lookups walk the list again */
+static void index_drop(bscJSON *const object)
+{
+    object_index *index = get_index(object);
+
+    if (index != NULL)
+    {
+        global_hooks.deallocate(index);
+        object->index = NULL;
+    }
+}
+
+/* (re)build the index from the member list with at least twice as many slots as members */
+static object_index *index_build(bscJSON *const object)
+{
+    object_index *index = NULL;
+    bscJSON *member = NULL;
+    bscJSON *last = NULL;
+    size_t count = 0;
+    size_t slots = 16;
+    size_t size = 0;
+
+    index_drop(object);
+
+    for (member = object->child; member != NULL; member = member->next)
+    {
+        if (member->string == NULL)
+        {
+            /* not an object after all, lookups keep walking the list */
+            return NULL;
+        }
+        last = member;
+        count++;
+    }
+    while (slots < (count * 2))
+    {
+        slots <<= 1;
+    }
+
+    size = offsetof(object_index, slots) + (slots * sizeof(bscJSON *));
+    index = (object_index *)global_hooks.allocate(size);
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    memset(index, '\0', size);
+    index->mask = slots - 1;
+    index->last = last;
+
+    for (member = object->child; member != NULL; member = member->next)
+    {
+        index_put(index, member);
+    }
+    object->index = index;
+
+    return index;
+}
+
 /* Delete a bscJSON structure. */
 bscJSON_PUBLIC(void) bscJSON_Delete(bscJSON *item)
 {
@@ -234,6 +483,10 @@ bscJSON_PUBLIC(void) bscJSON_Delete(bscJSON *item)
         {
             bscJSON_Delete(item->child);
         }
+        if (!(item->type & bscJSON_IsReference))
+        {
+            index_drop(item);
+        }
         if (!(item->type & bscJSON_IsReference) && (item->valuestring != NULL))
         {
             global_hooks.deallocate(item->valuestring);
@@ -247,17 +500,6 @@ bscJSON_PUBLIC(void) bscJSON_Delete(bscJSON *item)
     }
 }
 
-/* get the decimal point character of the current locale */
-static unsigned char get_decimal_point(void)
-{
-#ifdef ENABLE_LOCALES
-    struct lconv *lconv = localeconv();
-    return (unsigned char)lconv->decimal_point[0];
-#else
-    return '.';
-#endif
-}
-
 typedef struct
 {
     const unsigned char *content;
@@ -275,213 +517,1284 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
-/* Parse the input text to generate a number, and populate the result into item. */
-static bscJSON_bool parse_number(bscJSON *const item, parse_buffer *const input_buffer)
+/* powers of ten that are exactly representable as a double */
+static const double exact_powers_of_ten[] =
 {
-    double number = 0;
-    unsigned char *after_end = NULL;
-    unsigned char number_c_string[64];
-    unsigned char decimal_point = get_decimal_point();
-    size_t i = 0;
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+static const unsigned long long integer_powers_of_ten[] =
+{
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+    10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* Numbers with a 64 bit significand, used by both parsing and printing of doubles
+ * (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010) */
+typedef struct
+{
+    unsigned long long f;
+    int e;
+} diy_fp;
+
+#define diy_fp_significand_size 64
+#define double_significand_mask 0x000FFFFFFFFFFFFFULL
+#define double_exponent_mask 0x7FF0000000000000ULL
+#define double_hidden_bit 0x0010000000000000ULL
+#define double_exponent_bias (0x3FF + 52)
+#define double_denormal_exponent (1 - double_exponent_bias)
+
+/* normalized 10^k for k = -348, -340, ..., 340, each within half a unit in the last place */
+static const unsigned long long cached_powers_f[] =
+{
+    0xFA8FD5A0081C0288ULL, 0xBAAEE17FA23EBF76ULL, 0x8B16FB203055AC76ULL, 0xCF42894A5DCE35EAULL,
+    0x9A6BB0AA55653B2DULL, 0xE61ACF033D1A45DFULL, 0xAB70FE17C79AC6CAULL, 0xFF77B1FCBEBCDC4FULL,
+    0xBE5691EF416BD60CULL, 0x8DD01FAD907FFC3CULL, 0xD3515C2831559A83ULL, 0x9D71AC8FADA6C9B5ULL,
+    0xEA9C227723EE8BCBULL, 0xAECC49914078536DULL, 0x823C12795DB6CE57ULL, 0xC21094364DFB5637ULL,
+    0x9096EA6F3848984FULL, 0xD77485CB25823AC7ULL, 0xA086CFCD97BF97F4ULL, 0xEF340A98172AACE5ULL,
+    0xB23867FB2A35B28EULL, 0x84C8D4DFD2C63F3BULL, 0xC5DD44271AD3CDBAULL, 0x936B9FCEBB25C996ULL,
+    0xDBAC6C247D62A584ULL, 0xA3AB66580D5FDAF6ULL, 0xF3E2F893DEC3F126ULL, 0xB5B5ADA8AAFF80B8ULL,
+    0x87625F056C7C4A8BULL, 0xC9BCFF6034C13053ULL, 0x964E858C91BA2655ULL, 0xDFF9772470297EBDULL,
+    0xA6DFBD9FB8E5B88FULL, 0xF8A95FCF88747D94ULL, 0xB94470938FA89BCFULL, 0x8A08F0F8BF0F156BULL,
+    0xCDB02555653131B6ULL, 0x993FE2C6D07B7FACULL, 0xE45C10C42A2B3B06ULL, 0xAA242499697392D3ULL,
+    0xFD87B5F28300CA0EULL, 0xBCE5086492111AEBULL, 0x8CBCCC096F5088CCULL, 0xD1B71758E219652CULL,
+    0x9C40000000000000ULL, 0xE8D4A51000000000ULL, 0xAD78EBC5AC620000ULL, 0x813F3978F8940984ULL,
+    0xC097CE7BC90715B3ULL, 0x8F7E32CE7BEA5C70ULL, 0xD5D238A4ABE98068ULL, 0x9F4F2726179A2245ULL,
+    0xED63A231D4C4FB27ULL, 0xB0DE65388CC8ADA8ULL, 0x83C7088E1AAB65DBULL, 0xC45D1DF942711D9AULL,
+    0x924D692CA61BE758ULL, 0xDA01EE641A708DEAULL, 0xA26DA3999AEF774AULL, 0xF209787BB47D6B85ULL,
+    0xB454E4A179DD1877ULL, 0x865B86925B9BC5C2ULL, 0xC83553C5C8965D3DULL, 0x952AB45CFA97A0B3ULL,
+    0xDE469FBD99A05FE3ULL, 0xA59BC234DB398C25ULL, 0xF6C69A72A3989F5CULL, 0xB7DCBF5354E9BECEULL,
+    0x88FCF317F22241E2ULL, 0xCC20CE9BD35C78A5ULL, 0x98165AF37B2153DFULL, 0xE2A0B5DC971F303AULL,
+    0xA8D9D1535CE3B396ULL, 0xFB9B7CD9A4A7443CULL, 0xBB764C4CA7A44410ULL, 0x8BAB8EEFB6409C1AULL,
+    0xD01FEF10A657842CULL, 0x9B10A4E5E9913129ULL, 0xE7109BFBA19C0C9DULL, 0xAC2820D9623BF429ULL,
+    0x80444B5E7AA7CF85ULL, 0xBF21E44003ACDD2DULL, 0x8E679C2F5E44FF8FULL, 0xD433179D9C8CB841ULL,
+    0x9E19DB92B4E31BA9ULL, 0xEB96BF6EBADF77D9ULL, 0xAF87023B9BF0EE6BULL
+};
+
+static const short cached_powers_e[] =
+{
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821,
+    -794, -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396,
+    -369, -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static diy_fp diy_fp_multiply(diy_fp x, diy_fp y)
+{
+    const unsigned long long mask32 = 0xFFFFFFFFULL;
+    unsigned long long a = x.f >> 32;
+    unsigned long long b = x.f & mask32;
+    unsigned long long c = y.f >> 32;
+    unsigned long long d = y.f & mask32;
+    unsigned long long ac = a * c;
+    unsigned long long bc = b * c;
+    unsigned long long ad = a * d;
+    unsigned long long bd = b * d;
+    unsigned long long tmp = (bd >> 32) + (ad & mask32) + (bc & mask32);
+    diy_fp r;
+
+    tmp += 1ULL << 31; /* round */
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+static diy_fp diy_fp_normalize(diy_fp x)
+{
+    while (!(x.f & (1ULL << 63)))
     {
-        return false;
+        x.f <<= 1;
+        x.e--;
     }
+    return x;
+}
 
-    /* copy the number into a temporary buffer and replace '.' with the decimal point
-     * of the current locale (for strtod)
-     * This also takes care of '\0' not necessarily being available for marking the end of the input */
-    for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, i); i++)
-    {
-        switch (buffer_at_offset(input_buffer)[i])
-        {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case '+':
-        case '-':
-        case 'e':
-        case 'E':
-            number_c_string[i] = buffer_at_offset(input_buffer)[i];
-            break;
+/* Exact decimal arithmetic (the "decimal" of Go's strconv) for the few numbers the 64 bit paths
+ * cannot decide. 800 digits hold the exact value of every double and of every halfway point
+ * between two doubles, so the conversions through it are correctly rounded.
+ * At about 800 bytes it is never put on the stack. */
+#define number_decimal_digits 800
+
+typedef struct
+{
+    unsigned char d[number_decimal_digits]; /* digits, most significant first */
+    int nd;                                 /* number of digits used */
+    int dp;                                 /* position of the decimal point */
+    int trunc;                              /* nonzero digits were dropped after d[nd - 1] */
+} number_decimal;
+
+/* largest shift for which the 64 bit accumulator of a shift cannot overflow */
+#define number_decimal_max_shift 60
+
+static void decimal_trim(number_decimal *const a)
+{
+    while ((a->nd > 0) && (a->d[a->nd - 1] == '0'))
+    {
+        a->nd--;
+    }
+    if (a->nd == 0)
+    {
+        a->dp = 0;
+    }
+}
+
+static void decimal_assign(number_decimal *const a, unsigned long long value)
+{
+    unsigned char buffer[20];
+    int n = 0;
+
+    while (value > 0)
+    {
+        buffer[n++] = (unsigned char)('0' + (value % 10));
+        value /= 10;
+    }
+    a->nd = 0;
+    a->trunc = 0;
+    while (n > 0)
+    {
+        a->d[a->nd++] = buffer[--n];
+    }
+    a->dp = a->nd;
+    decimal_trim(a);
+}
+
+/* a = a / 2^k */
+static void decimal_right_shift(number_decimal *const a, unsigned int k)
+{
+    unsigned long long mask = (1ULL << k) - 1;
+    unsigned long long n = 0;
+    unsigned int digit = 0;
+    int r = 0; /* read position */
+    int w = 0; /* write position */
 
-        case '.':
-            number_c_string[i] = decimal_point;
+    /* take enough leading digits for the first digit of the quotient */
+    for (; (n >> k) == 0; r++)
+    {
+        if (r >= a->nd)
+        {
+            if (n == 0)
+            {
+                a->nd = 0;
+                return;
+            }
+            while ((n >> k) == 0)
+            {
+                n *= 10;
+                r++;
+            }
             break;
+        }
+        n = (n * 10) + (unsigned long long)(a->d[r] - '0');
+    }
+    a->dp -= r - 1;
 
-        default:
-            goto loop_end;
+    for (; r < a->nd; r++)
+    {
+        digit = (unsigned int)(n >> k);
+        n &= mask;
+        a->d[w++] = (unsigned char)('0' + digit);
+        n = (n * 10) + (unsigned long long)(a->d[r] - '0');
+    }
+
+    while (n > 0)
+    {
+        digit = (unsigned int)(n >> k);
+        n &= mask;
+        if (w < number_decimal_digits)
+        {
+            a->d[w++] = (unsigned char)('0' + digit);
+        }
+        else if (digit > 0)
+        {
+            a->trunc = 1;
         }
+        n *= 10;
     }
-loop_end:
-    number_c_string[i] = '\0';
 
-    number = strtod((const char *)number_c_string, (char **)&after_end);
-    if (number_c_string == after_end)
+    a->nd = w;
+    decimal_trim(a);
+}
+
+/* a = a * 2^k, the digits are written from the least significant end on */
+static void decimal_left_shift(number_decimal *const a, unsigned int k)
+{
+    int delta = (int)(k / 3) + 1; /* at least the number of new digits, as k * log10(2) < k / 3 */
+    int r = a->nd;
+    int w = a->nd + delta;
+    unsigned long long n = 0;
+    unsigned long long quotient = 0;
+    unsigned long long remainder = 0;
+
+    while ((r > 0) || (n > 0))
     {
-        return false; /* parse_error */
+        if (r > 0)
+        {
+            n += (unsigned long long)(a->d[--r] - '0') << k;
+        }
+        quotient = n / 10;
+        remainder = n - (10 * quotient);
+        w--;
+        if (w < number_decimal_digits)
+        {
+            a->d[w] = (unsigned char)('0' + remainder);
+        }
+        else if (remainder != 0)
+        {
+            a->trunc = 1;
+        }
+        n = quotient;
     }
 
-    item->valuedouble = number;
+    /* w positions at the front stayed unused */
+    a->nd += delta;
+    a->dp += delta;
+    if (a->nd > number_decimal_digits)
+    {
+        a->nd = number_decimal_digits;
+    }
+    if (w > 0)
+    {
+        memmove(a->d, a->d + w, (size_t)(a->nd - w));
+        a->nd -= w;
+        a->dp -= w;
+    }
+    decimal_trim(a);
+}
 
-    /* use saturation in case of overflow */
-    if (number >= INT_MAX)
+/* a = a * 2^k, k may be negative */
+static void decimal_shift(number_decimal *const a, int k)
+{
+    if (a->nd == 0)
     {
-        item->valueint = INT_MAX;
+        return;
     }
-    else if (number <= (double)INT_MIN)
+    while (k > number_decimal_max_shift)
     {
-        item->valueint = INT_MIN;
+        decimal_left_shift(a, number_decimal_max_shift);
+        k -= number_decimal_max_shift;
     }
-    else
+    if (k > 0)
     {
-        item->valueint = (int)number;
+        decimal_left_shift(a, (unsigned int)k);
+    }
+    while (k < -number_decimal_max_shift)
+    {
+        decimal_right_shift(a, number_decimal_max_shift);
+        k += number_decimal_max_shift;
+    }
+    if (k < 0)
+    {
+        decimal_right_shift(a, (unsigned int)-k);
     }
+}
 
-    item->type = bscJSON_Number;
+/* whether rounding to nd digits goes up, exact halves go to even */
+static int decimal_should_round_up(const number_decimal *const a, int nd)
+{
+    if ((nd < 0) || (nd >= a->nd))
+    {
+        return 0;
+    }
+    if ((a->d[nd] == '5') && ((nd + 1) == a->nd))
+    {
+        /* dropped digits make it more than half */
+        if (a->trunc)
+        {
+            return 1;
+        }
+        return (nd > 0) && (((a->d[nd - 1] - '0') % 2) == 1);
+    }
+    return a->d[nd] >= '5';
+}
 
-    input_buffer->offset += (size_t)(after_end - number_c_string);
-    return true;
+static void decimal_round_down(number_decimal *const a, int nd)
+{
+    if ((nd < 0) || (nd >= a->nd))
+    {
+        return;
+    }
+    a->nd = nd;
+    decimal_trim(a);
 }
 
-/* don't ask me, but the original bscJSON_SetNumberValue returns an integer or double */
-bscJSON_PUBLIC(double) bscJSON_SetNumberHelper(bscJSON *object, double number)
+static void decimal_round_up(number_decimal *const a, int nd)
 {
-    if (number >= INT_MAX)
+    int i = 0;
+
+    if ((nd < 0) || (nd >= a->nd))
     {
-        object->valueint = INT_MAX;
+        return;
     }
-    else if (number <= (double)INT_MIN)
+    for (i = nd - 1; i >= 0; i--)
     {
-        object->valueint = INT_MIN;
+        if (a->d[i] < '9')
+        {
+            a->d[i]++;
+            a->nd = i + 1;
+            return;
+        }
+    }
+    /* all nines */
+    a->d[0] = '1';
+    a->nd = 1;
+    a->dp++;
+}
+
+static void decimal_round(number_decimal *const a, int nd)
+{
+    if (decimal_should_round_up(a, nd))
+    {
+        decimal_round_up(a, nd);
     }
     else
     {
-        object->valueint = (int)number;
+        decimal_round_down(a, nd);
+    }
+}
+
+/* the integer part of a, rounded */
+static unsigned long long decimal_rounded_integer(const number_decimal *const a)
+{
+    unsigned long long n = 0;
+    int i = 0;
+
+    if (a->dp > 20)
+    {
+        return 0xFFFFFFFFFFFFFFFFULL;
+    }
+    for (i = 0; (i < a->dp) && (i < a->nd); i++)
+    {
+        n = (n * 10) + (unsigned long long)(a->d[i] - '0');
+    }
+    for (; i < a->dp; i++)
+    {
+        n *= 10;
+    }
+    if (decimal_should_round_up(a, a->dp))
+    {
+        n++;
+    }
+    return n;
+}
+
+/* binary shifts that bring a number with the decimal point at i (i < 9) to below 1 */
+static const int decimal_power_shifts[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+
+/* the bits of the double closest to a (without sign), infinity when it is too large; a is scaled on the way */
+static unsigned long long decimal_to_double_bits(number_decimal *const a)
+{
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    int n = 0;
+
+    if ((a->nd == 0) || (a->dp < -330))
+    {
+        return 0;
+    }
+    if (a->dp > 310)
+    {
+        return double_exponent_mask;
+    }
+
+    /* scale into [0.5, 1) */
+    while (a->dp > 0)
+    {
+        n = (a->dp >= 9) ? 27 : decimal_power_shifts[a->dp];
+        decimal_shift(a, -n);
+        exponent += n;
+    }
+    while ((a->dp < 0) || ((a->dp == 0) && (a->d[0] < '5')))
+    {
+        n = (-a->dp >= 9) ? 27 : decimal_power_shifts[-a->dp];
+        decimal_shift(a, n);
+        exponent -= n;
+    }
+
+    /* a double's significand is in [1, 2) */
+    exponent--;
+    if (exponent < -1022)
+    {
+        /* subnormal */
+        n = -1022 - exponent;
+        decimal_shift(a, -n);
+        exponent += n;
+    }
+    if (exponent > 1023)
+    {
+        return double_exponent_mask;
+    }
+
+    decimal_shift(a, 53);
+    mantissa = decimal_rounded_integer(a);
+    if (mantissa == (double_hidden_bit << 1))
+    {
+        /* rounding carried into a new bit */
+        mantissa >>= 1;
+        exponent++;
+        if (exponent > 1023)
+        {
+            return double_exponent_mask;
+        }
+    }
+    if (!(mantissa & double_hidden_bit))
+    {
+        return mantissa;
+    }
+    return (mantissa & double_significand_mask) | ((unsigned long long)(exponent + 0x3FF) << 52);
+}
+
+/* errors of the 64 bit approximation are counted in eighths of its last place */
+#define diy_fp_error_denominator 8ULL
+
+/* The bits of the double closest to mantissa * 10^exponent (double-conversion's DiyFpStrtod).
+ * mantissa holds the first digits of the number, truncated tells that nonzero digits followed
+ * (mantissa is then rounded, off by at most half a unit). The product with a cached power of ten carries
+ * a known error; returns false when it straddles a halfway point between two doubles and the result
+ * cannot be told this way. Expects -348 <= exponent <= 340. */
+static bscJSON_bool diy_fp_to_double_bits(unsigned long long mantissa, int digits, int truncated, int exponent, unsigned long long *const bits)
+{
+    diy_fp input;
+    diy_fp power;
+    unsigned long long error_bound = truncated ? (diy_fp_error_denominator / 2) : 0;
+    unsigned long long precision_bits = 0;
+    unsigned long long half_way = 0;
+    unsigned long long significand = 0;
+    unsigned long long biased_exponent = 0;
+    int old_e = 0;
+    int index = 0;
+    int adjustment = 0;
+    int magnitude = 0;
+    int significand_size = 0;
+    int precision = 0;
+    int shift = 0;
+
+    input.f = mantissa;
+    input.e = 0;
+    input = diy_fp_normalize(input);
+    error_bound <<= -input.e;
+
+    /* the cached power at or below the exponent, the rest is an exact power of ten below 10^8 */
+    index = (exponent + 348) / 8;
+    adjustment = exponent - (-348 + (8 * index));
+    if (adjustment != 0)
+    {
+        power.f = integer_powers_of_ten[adjustment];
+        power.e = 0;
+        input = diy_fp_multiply(input, diy_fp_normalize(power));
+        if (truncated || ((digits + adjustment) > 19))
+        {
+            /* the product did not fit into 64 bits and got rounded */
+            error_bound += diy_fp_error_denominator / 2;
+        }
+    }
+
+    power.f = cached_powers_f[index];
+    power.e = cached_powers_e[index];
+    input = diy_fp_multiply(input, power);
+    /* half a unit from the cached power, half a unit from rounding the product,
+     * and one eighth for the product of the errors */
+    error_bound += diy_fp_error_denominator + ((error_bound != 0) ? 1ULL : 0ULL);
+
+    old_e = input.e;
+    input = diy_fp_normalize(input);
+    error_bound <<= old_e - input.e;
+
+    /* subnormals keep fewer bits of the significand */
+    magnitude = diy_fp_significand_size + input.e;
+    if (magnitude >= (double_denormal_exponent + 53))
+    {
+        significand_size = 53;
+    }
+    else if (magnitude <= double_denormal_exponent)
+    {
+        significand_size = 0;
+    }
+    else
+    {
+        significand_size = magnitude - double_denormal_exponent;
+    }
+    precision = diy_fp_significand_size - significand_size;
+    if ((precision + 3) >= diy_fp_significand_size)
+    {
+        /* the tiniest subnormals: make room for the eighths */
+        shift = (precision + 3) - diy_fp_significand_size + 1;
+        input.f >>= shift;
+        input.e += shift;
+        error_bound = (error_bound >> shift) + 1 + diy_fp_error_denominator;
+        precision -= shift;
+    }
+
+    precision_bits = (input.f & ((1ULL << precision) - 1)) * diy_fp_error_denominator;
+    half_way = (1ULL << (precision - 1)) * diy_fp_error_denominator;
+    if (((half_way - error_bound) < precision_bits) && (precision_bits < (half_way + error_bound)))
+    {
+        return false;
+    }
+    significand = input.f >> precision;
+    exponent = input.e + precision;
+    if (precision_bits >= (half_way + error_bound))
+    {
+        significand++;
+    }
+
+    /* pack the double */
+    while (significand > (double_hidden_bit | double_significand_mask))
+    {
+        significand >>= 1;
+        exponent++;
+    }
+    if (exponent >= (0x7FF - double_exponent_bias))
+    {
+        *bits = double_exponent_mask;
+        return true;
+    }
+    if (exponent < double_denormal_exponent)
+    {
+        *bits = 0;
+        return true;
+    }
+    while ((exponent > double_denormal_exponent) && !(significand & double_hidden_bit))
+    {
+        significand <<= 1;
+        exponent--;
+    }
+    if ((exponent == double_denormal_exponent) && !(significand & double_hidden_bit))
+    {
+        biased_exponent = 0;
+    }
+    else
+    {
+        biased_exponent = (unsigned long long)(exponent + double_exponent_bias);
+    }
+    *bits = (significand & double_significand_mask) | (biased_exponent << 52);
+    return true;
+}
+
+/* Parse the input text to generate a number, and populate the result into item.
+ * Takes what strtod took from the characters bscJSON used to hand it (sign, digits, '.', exponent),
+ * always with '.' and correctly rounded, without strtod:
+ * - up to 19 digits that fit into 2^53 and a decimal exponent within [-22, 22]: a single multiplication or
+ *   division by an exact power of ten is correctly rounded (Clinger's fast path)
+ * - otherwise the first 19 digits times a cached power of ten in 64 bit arithmetic, with an error bound
+ * - if the error bound straddles a halfway point between two doubles, exact decimal arithmetic on all digits */
+static bscJSON_bool parse_number(bscJSON *const item, parse_buffer *const input_buffer)
+{
+    const unsigned char *input = NULL;
+    number_decimal *decimal = NULL;
+    unsigned long long mantissa = 0;
+    unsigned long long bits = 0;
+    size_t length = 0;
+    size_t i = 0;
+    size_t digits_start = 0;
+    size_t digits_end = 0;
+    size_t j = 0;
+    int significant = 0;
+    int dropped = 0;
+    int truncated = 0;
+    int round_up = 0;
+    int exponent = 0;
+    int explicit_exponent = 0;
+    int exponent_negative = 0;
+    int negative = 0;
+    int seen_digit = 0;
+    int seen_point = 0;
+    double number = 0;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false;
+    }
+    input = buffer_at_offset(input_buffer);
+    length = input_buffer->length - input_buffer->offset;
+
+    if ((i < length) && ((input[i] == '-') || (input[i] == '+')))
+    {
+        negative = (input[i] == '-');
+        i++;
+    }
+
+    /* digits and the point: the first 19 significant digits go into the mantissa,
+     * exponent is the power of ten of its last digit */
+    digits_start = i;
+    for (; i < length; i++)
+    {
+        if (input[i] == '.')
+        {
+            if (seen_point)
+            {
+                break;
+            }
+            seen_point = 1;
+            continue;
+        }
+        if ((input[i] < '0') || (input[i] > '9'))
+        {
+            break;
+        }
+        seen_digit = 1;
+        if ((mantissa == 0) && (input[i] == '0'))
+        {
+            /* leading zero */
+            if (seen_point)
+            {
+                exponent--;
+            }
+        }
+        else if (significant < 19)
+        {
+            mantissa = (mantissa * 10) + (unsigned long long)(input[i] - '0');
+            significant++;
+            if (seen_point)
+            {
+                exponent--;
+            }
+        }
+        else
+        {
+            if (dropped == 0)
+            {
+                round_up = (input[i] >= '5');
+            }
+            dropped = 1;
+            truncated |= (input[i] != '0');
+            if (!seen_point)
+            {
+                exponent++;
+            }
+        }
+    }
+    digits_end = i;
+    if (!seen_digit)
+    {
+        return false; /* parse_error */
+    }
+
+    /* the exponent only counts with at least one digit */
+    if ((i < length) && ((input[i] == 'e') || (input[i] == 'E')))
+    {
+        j = i + 1;
+        if ((j < length) && ((input[j] == '+') || (input[j] == '-')))
+        {
+            exponent_negative = (input[j] == '-');
+            j++;
+        }
+        if ((j < length) && (input[j] >= '0') && (input[j] <= '9'))
+        {
+            for (; (j < length) && (input[j] >= '0') && (input[j] <= '9'); j++)
+            {
+                if (explicit_exponent < 100000)
+                {
+                    explicit_exponent = (explicit_exponent * 10) + (input[j] - '0');
+                }
+            }
+            if (exponent_negative)
+            {
+                explicit_exponent = -explicit_exponent;
+            }
+            exponent += explicit_exponent;
+            i = j;
+        }
+    }
+
+    if (mantissa == 0)
+    {
+        number = 0;
+    }
+#if !defined(FLT_EVAL_METHOD) || (FLT_EVAL_METHOD == 0)
+    /* (extended precision intermediates would round twice) */
+    else if (!truncated && (mantissa <= (1ULL << 53)) && (exponent >= -22) && (exponent <= 22))
+    {
+        number = (double)mantissa;
+        if (exponent < 0)
+        {
+            number /= exact_powers_of_ten[-exponent];
+        }
+        else
+        {
+            number *= exact_powers_of_ten[exponent];
+        }
+    }
+#endif
+    else
+    {
+        if ((significant + exponent - 1) >= 309)
+        {
+            bits = double_exponent_mask; /* at least 10^309 */
+        }
+        else if ((significant + exponent) <= -324)
+        {
+            bits = 0; /* less than half of the smallest subnormal */
+        }
+        else if (!diy_fp_to_double_bits(mantissa + (unsigned long long)(truncated && round_up), significant, truncated, exponent, &bits))
+        {
+            decimal = (number_decimal *)hooks_allocate(&input_buffer->hooks, sizeof(number_decimal));
+            if (decimal == NULL)
+            {
+                return false;
+            }
+            decimal->nd = 0;
+            decimal->dp = 0;
+            decimal->trunc = 0;
+            seen_point = 0;
+            for (j = digits_start; j < digits_end; j++)
+            {
+                if (input[j] == '.')
+                {
+                    seen_point = 1;
+                }
+                else if ((decimal->nd == 0) && (input[j] == '0'))
+                {
+                    decimal->dp -= seen_point;
+                }
+                else
+                {
+                    decimal->dp += !seen_point;
+                    if (decimal->nd < number_decimal_digits)
+                    {
+                        decimal->d[decimal->nd++] = input[j];
+                    }
+                    else if (input[j] != '0')
+                    {
+                        decimal->trunc = 1;
+                    }
+                }
+            }
+            decimal->dp += explicit_exponent;
+            decimal_trim(decimal);
+            bits = decimal_to_double_bits(decimal);
+            hooks_deallocate(&input_buffer->hooks, decimal);
+        }
+        memcpy(&number, &bits, sizeof(number));
+    }
+    if (negative)
+    {
+        number = -number;
+    }
+
+    item->valuedouble = number;
+
+    /* use saturation in case of overflow */
+    if (number >= INT_MAX)
+    {
+        item->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        item->valueint = INT_MIN;
+    }
+    else
+    {
+        item->valueint = (int)number;
+    }
+
+    item->type = bscJSON_Number;
+
+    input_buffer->offset += i;
+    return true;
+}
+
+/* don't ask me, but the original bscJSON_SetNumberValue returns an integer or double */
+bscJSON_PUBLIC(double) bscJSON_SetNumberHelper(bscJSON *object, double number)
+{
+    if (number >= INT_MAX)
+    {
+        object->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        object->valueint = INT_MIN;
+    }
+    else
+    {
+        object->valueint = (int)number;
+    }
+
+    return object->valuedouble = number;
+}
+
+typedef struct
+{
+    unsigned char *buffer;
+    size_t length;
+    size_t offset;
+    size_t depth; /* current nesting depth (for formatted printing) */
+    bscJSON_bool noalloc;
+    bscJSON_bool format; /* is this print a formatted print */
+    internal_hooks hooks;
+} printbuffer;
+
+/* realloc printbuffer if necessary to have at least "needed" bytes more */
+static unsigned char *ensure(printbuffer *const p, size_t needed)
+{
+    unsigned char *newbuffer = NULL;
+    size_t newsize = 0;
+
+    if ((p == NULL) || (p->buffer == NULL))
+    {
+        return NULL;
+    }
+
+    if ((p->length > 0) && (p->offset >= p->length))
+    {
+        /* make sure that offset is valid */
+        return NULL;
+    }
+
+    if (needed > INT_MAX)
+    {
+        /* sizes bigger than INT_MAX are currently not supported */
+        return NULL;
+    }
+
+    needed += p->offset + 1;
+    if (needed <= p->length)
+    {
+        return p->buffer + p->offset;
+    }
+
+    if (p->noalloc)
+    {
+        return NULL;
+    }
+
+    /* calculate new buffer size */
+    if (needed > (INT_MAX / 2))
+    {
+        /* overflow of int, use INT_MAX if possible */
+        if (needed <= INT_MAX)
+        {
+            newsize = INT_MAX;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        newsize = needed * 2;
+    }
+
+    if (p->hooks.reallocate != NULL)
+    {
+        /* reallocate with realloc if available */
+        newbuffer = (unsigned char *)p->hooks.reallocate(p->buffer, newsize);
+        if (newbuffer == NULL)
+        {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+    }
+    else
+    {
+        /* otherwise reallocate manually */
+        newbuffer = (unsigned char *)p->hooks.allocate(newsize);
+        if (!newbuffer)
+        {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+        if (newbuffer)
+        {
+            memcpy(newbuffer, p->buffer, p->offset + 1);
+        }
+        p->hooks.deallocate(p->buffer);
+    }
+    p->length = newsize;
+    p->buffer = newbuffer;
+
+    return newbuffer + p->offset;
+}
+
+/* calculate the new length of the string in a printbuffer and update the offset */
+static void update_offset(printbuffer *const buffer)
+{
+    const unsigned char *buffer_pointer = NULL;
+    if ((buffer == NULL) || (buffer->buffer == NULL))
+    {
+        return;
+    }
+    buffer_pointer = buffer->buffer + buffer->offset;
+
+    buffer->offset += strlen((const char *)buffer_pointer);
+}
+
+/* Shortest round trip formatting of doubles: the fewest digits that read back to the same double,
+ * of those the closest to it. Grisu3 (Florian Loitsch 2010) decides almost all doubles in 64 bit
+ * arithmetic; the rest go through exact decimal arithmetic. No locale, no libc formatting. */
+
+/* the boundaries m- and m+ halfway to the neighbouring doubles, with the exponent of m+ */
+static void diy_fp_boundaries(diy_fp v, diy_fp *const minus, diy_fp *const plus)
+{
+    diy_fp pl;
+    diy_fp mi;
+
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    while (!(pl.f & (double_hidden_bit << 1)))
+    {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= diy_fp_significand_size - 52 - 2;
+    pl.e -= diy_fp_significand_size - 52 - 2;
+
+    /* the lower neighbour is closer when v is a power of two (but not the smallest normal) */
+    if ((v.f == double_hidden_bit) && (v.e != double_denormal_exponent))
+    {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    }
+    else
+    {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *plus = pl;
+    *minus = mi;
+}
+
+/* pick a cached power c_k so that the product with a number of binary exponent e lands in [-60, -32] */
+static diy_fp cached_power(int e, int *const k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    unsigned int index = 0;
+    diy_fp r;
+
+    if ((dk - ik) > 0.0)
+    {
+        ik++;
+    }
+    index = (unsigned int)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+
+    r.f = cached_powers_f[index];
+    r.e = cached_powers_e[index];
+    return r;
+}
+
+/* Step the last digit down towards w while that gets closer. The result is only safe when no digit
+ * string inside the unsafe interval can be closer and the last digit is provably inside the safe one:
+ * returns false otherwise (double-conversion's RoundWeed). */
+static bscJSON_bool grisu_round_weed(unsigned char *const buffer, int length, unsigned long long distance_too_high_w, unsigned long long unsafe_interval, unsigned long long rest, unsigned long long ten_kappa, unsigned long long unit)
+{
+    unsigned long long small_distance = distance_too_high_w - unit;
+    unsigned long long big_distance = distance_too_high_w + unit;
+
+    while ((rest < small_distance) && ((unsafe_interval - rest) >= ten_kappa) &&
+           (((rest + ten_kappa) < small_distance) || ((small_distance - rest) >= (rest + ten_kappa - small_distance))))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+
+    /* the next lower digit might still be closer to the real w */
+    if ((rest < big_distance) && ((unsafe_interval - rest) >= ten_kappa) &&
+        (((rest + ten_kappa) < big_distance) || ((big_distance - rest) > (rest + ten_kappa - big_distance))))
+    {
+        return false;
+    }
+
+    return ((2 * unit) <= rest) && (rest <= (unsafe_interval - (4 * unit)));
+}
+
+static int count_decimal_digits(unsigned int n)
+{
+    int digits = 1;
+    while (n >= 10)
+    {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+/* Generate the digits of w until they are inside the interval (low, high), widened by the error
+ * of one unit of the scaled numbers. buffer * 10^kappa is the result. */
+static bscJSON_bool grisu_digit_gen(diy_fp low, diy_fp w, diy_fp high, unsigned char *const buffer, int *const length, int *const kappa)
+{
+    diy_fp one;
+    unsigned long long unit = 1;
+    unsigned long long too_high = high.f + unit;
+    unsigned long long unsafe_interval = too_high - (low.f - unit);
+    unsigned long long fractionals = 0;
+    unsigned long long rest = 0;
+    unsigned int integrals = 0;
+    unsigned int divisor = 0;
+
+    one.f = 1ULL << -w.e;
+    one.e = w.e;
+    integrals = (unsigned int)(too_high >> -one.e);
+    fractionals = too_high & (one.f - 1);
+    *kappa = count_decimal_digits(integrals);
+    divisor = (unsigned int)integer_powers_of_ten[*kappa - 1];
+    *length = 0;
+
+    while (*kappa > 0)
+    {
+        buffer[(*length)++] = (unsigned char)('0' + (integrals / divisor));
+        integrals %= divisor;
+        (*kappa)--;
+        rest = ((unsigned long long)integrals << -one.e) + fractionals;
+        if (rest < unsafe_interval)
+        {
+            return grisu_round_weed(buffer, *length, too_high - w.f, unsafe_interval, rest, (unsigned long long)divisor << -one.e, unit);
+        }
+        divisor /= 10;
+    }
+
+    while (*length < 18)
+    {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buffer[(*length)++] = (unsigned char)('0' + (fractionals >> -one.e));
+        fractionals &= one.f - 1;
+        (*kappa)--;
+        if (fractionals < unsafe_interval)
+        {
+            return grisu_round_weed(buffer, *length, (too_high - w.f) * unit, unsafe_interval, fractionals, one.f, unit);
+        }
     }
-
-    return object->valuedouble = number;
+    return false;
 }
 
-typedef struct
-{
-    unsigned char *buffer;
-    size_t length;
-    size_t offset;
-    size_t depth; /* current nesting depth (for formatted printing) */
-    bscJSON_bool noalloc;
-    bscJSON_bool format; /* is this print a formatted print */
-    internal_hooks hooks;
-} printbuffer;
-
-/* realloc printbuffer if necessary to have at least "needed" bytes more */
-static unsigned char *ensure(printbuffer *const p, size_t needed)
+/* mantissa and binary exponent of a positive finite double, value = f * 2^e */
+static diy_fp double_to_diy_fp(double value)
 {
-    unsigned char *newbuffer = NULL;
-    size_t newsize = 0;
+    unsigned long long bits = 0;
+    diy_fp v;
 
-    if ((p == NULL) || (p->buffer == NULL))
+    memcpy(&bits, &value, sizeof(bits));
+    v.f = bits & double_significand_mask;
+    v.e = (int)((bits & double_exponent_mask) >> 52);
+    if (v.e != 0)
     {
-        return NULL;
+        v.f += double_hidden_bit;
+        v.e -= double_exponent_bias;
     }
-
-    if ((p->length > 0) && (p->offset >= p->length))
+    else
     {
-        /* make sure that offset is valid */
-        return NULL;
+        v.e = double_denormal_exponent;
     }
+    return v;
+}
 
-    if (needed > INT_MAX)
+/* Shortest digits of a positive finite double: value = digits * 10^k, at most 17 digits.
+ * Returns false for the about 0.5% of doubles where 64 bits cannot prove them shortest and closest. */
+static bscJSON_bool grisu3(double value, unsigned char *const digits, int *const length, int *const k)
+{
+    diy_fp v = double_to_diy_fp(value);
+    diy_fp w_m;
+    diy_fp w_p;
+    diy_fp c_mk;
+    diy_fp w;
+    int kappa = 0;
+
+    diy_fp_boundaries(v, &w_m, &w_p);
+    w = diy_fp_normalize(v);
+    c_mk = cached_power(w.e, k);
+    w = diy_fp_multiply(w, c_mk);
+    w_p = diy_fp_multiply(w_p, c_mk);
+    w_m = diy_fp_multiply(w_m, c_mk);
+    if (!grisu_digit_gen(w_m, w, w_p, digits, length, &kappa))
     {
-        /* sizes bigger than INT_MAX are currently not supported */
-        return NULL;
+        return false;
     }
+    *k += kappa;
 
-    needed += p->offset + 1;
-    if (needed <= p->length)
+    while ((*length > 1) && (digits[*length - 1] == '0'))
     {
-        return p->buffer + p->offset;
+        (*length)--;
+        (*k)++;
     }
+    return true;
+}
 
-    if (p->noalloc)
+/* The same digits as grisu3 by exact decimal arithmetic (Go's strconv roundShortest): the value and the
+ * halfway points to its neighbours are expanded exactly, the digits end where the halfway points first
+ * differ from the value, and are rounded to the closest. Returns 0 when out of memory. */
+static int shortest_digits_exact(double value, unsigned char *const digits, int *const k, const internal_hooks *const hooks)
+{
+    number_decimal *decimals = NULL;
+    number_decimal *d = NULL;
+    number_decimal *upper = NULL;
+    number_decimal *lower = NULL;
+    diy_fp v = double_to_diy_fp(value);
+    diy_fp low;
+    int inclusive = (v.f % 2) == 0; /* an even significand reads back from its halfway points */
+    int upper_delta = 0;
+    int ok_down = 0;
+    int ok_up = 0;
+    int ui = 0;
+    int mi = 0;
+    int li = 0;
+    unsigned char l = 0;
+    unsigned char m = 0;
+    unsigned char u = 0;
+    int length = 0;
+
+    decimals = (number_decimal *)hooks_allocate(hooks, 3 * sizeof(number_decimal));
+    if (decimals == NULL)
     {
-        return NULL;
+        return 0;
     }
+    d = decimals;
+    upper = decimals + 1;
+    lower = decimals + 2;
 
-    /* calculate new buffer size */
-    if (needed > (INT_MAX / 2))
+    decimal_assign(d, v.f);
+    decimal_shift(d, v.e);
+
+    /* an exact expansion with no more digits than the precision of the double is already the shortest */
+    if ((v.e == double_denormal_exponent) || ((332 * (d->dp - d->nd)) < (100 * v.e)))
     {
-        /* overflow of int, use INT_MAX if possible */
-        if (needed <= INT_MAX)
+        decimal_assign(upper, (v.f * 2) + 1);
+        decimal_shift(upper, v.e - 1);
+        if ((v.f == double_hidden_bit) && (v.e != double_denormal_exponent))
         {
-            newsize = INT_MAX;
+            low.f = (v.f * 4) - 1;
+            low.e = v.e - 2;
         }
         else
         {
-            return NULL;
+            low.f = (v.f * 2) - 1;
+            low.e = v.e - 1;
+        }
+        decimal_assign(lower, low.f);
+        decimal_shift(lower, low.e);
+
+        for (ui = 0;; ui++)
+        {
+            mi = ui - upper->dp + d->dp;
+            if (mi >= d->nd)
+            {
+                break;
+            }
+            li = ui - upper->dp + lower->dp;
+            l = ((li >= 0) && (li < lower->nd)) ? lower->d[li] : '0';
+            m = (mi >= 0) ? d->d[mi] : '0';
+            u = (ui < upper->nd) ? upper->d[ui] : '0';
+
+            /* may the digits stop here, rounded down or up, and still read back */
+            ok_down = (l != m) || (inclusive && ((li + 1) == lower->nd));
+            if ((upper_delta == 0) && ((m + 1) < u))
+            {
+                upper_delta = 2;
+            }
+            else if ((upper_delta == 0) && (m != u))
+            {
+                upper_delta = 1;
+            }
+            else if ((upper_delta == 1) && ((m != '9') || (u != '0')))
+            {
+                upper_delta = 2;
+            }
+            ok_up = (upper_delta > 0) && (inclusive || (upper_delta > 1) || ((ui + 1) < upper->nd));
+
+            if (ok_down && ok_up)
+            {
+                decimal_round(d, mi + 1);
+                break;
+            }
+            if (ok_down)
+            {
+                decimal_round_down(d, mi + 1);
+                break;
+            }
+            if (ok_up)
+            {
+                decimal_round_up(d, mi + 1);
+                break;
+            }
         }
     }
-    else
+
+    length = d->nd;
+    memcpy(digits, d->d, (size_t)length);
+    *k = d->dp - d->nd;
+    hooks_deallocate(hooks, decimals);
+    return length;
+}
+
+/* Lay the digits out the way printf("%1.15g") would (or "%1.17g" for more than 15 digits),
+ * so numbers that printed fine before print the same way */
+static int print_digits(unsigned char *const output, int negative, const unsigned char *const digits, int length, int k)
+{
+    int exponent = length + k - 1;
+    int precision = (length <= 15) ? 15 : 17;
+    int position = 0;
+    int i = 0;
+
+    if (negative)
     {
-        newsize = needed * 2;
+        output[position++] = '-';
     }
 
-    if (p->hooks.reallocate != NULL)
+    if ((exponent < -4) || (exponent >= precision))
     {
-        /* reallocate with realloc if available */
-        newbuffer = (unsigned char *)p->hooks.reallocate(p->buffer, newsize);
-        if (newbuffer == NULL)
+        output[position++] = digits[0];
+        if (length > 1)
         {
-            p->hooks.deallocate(p->buffer);
-            p->length = 0;
-            p->buffer = NULL;
-
-            return NULL;
+            output[position++] = '.';
+            memcpy(output + position, digits + 1, (size_t)(length - 1));
+            position += length - 1;
+        }
+        output[position++] = 'e';
+        output[position++] = (exponent < 0) ? '-' : '+';
+        if (exponent < 0)
+        {
+            exponent = -exponent;
+        }
+        if (exponent >= 100)
+        {
+            output[position++] = (unsigned char)('0' + exponent / 100);
+            exponent %= 100;
+        }
+        output[position++] = (unsigned char)('0' + exponent / 10);
+        output[position++] = (unsigned char)('0' + exponent % 10);
+    }
+    else if (exponent < 0)
+    {
+        output[position++] = '0';
+        output[position++] = '.';
+        for (i = -1; i > exponent; i--)
+        {
+            output[position++] = '0';
         }
+        memcpy(output + position, digits, (size_t)length);
+        position += length;
     }
     else
     {
-        /* otherwise reallocate manually */
-        newbuffer = (unsigned char *)p->hooks.allocate(newsize);
-        if (!newbuffer)
+        for (i = 0; i <= exponent; i++)
         {
-            p->hooks.deallocate(p->buffer);
-            p->length = 0;
-            p->buffer = NULL;
-
-            return NULL;
+            output[position++] = (i < length) ? digits[i] : '0';
         }
-        if (newbuffer)
+        if (length > exponent + 1)
         {
-            memcpy(newbuffer, p->buffer, p->offset + 1);
+            output[position++] = '.';
+            memcpy(output + position, digits + exponent + 1, (size_t)(length - exponent - 1));
+            position += length - exponent - 1;
         }
-        p->hooks.deallocate(p->buffer);
-    }
-    p->length = newsize;
-    p->buffer = newbuffer;
-
-    return newbuffer + p->offset;
-}
-
-/* calculate the new length of the string in a printbuffer and update the offset */
-static void update_offset(printbuffer *const buffer)
-{
-    const unsigned char *buffer_pointer = NULL;
-    if ((buffer == NULL) || (buffer->buffer == NULL))
-    {
-        return;
     }
-    buffer_pointer = buffer->buffer + buffer->offset;
 
-    buffer->offset += strlen((const char *)buffer_pointer);
+    output[position] = '\0';
+    return position;
 }
 
 /* Render the number nicely from the given item into a string. */
@@ -490,10 +1803,12 @@ static bscJSON_bool print_number(const bscJSON *const item, printbuffer *const o
     unsigned char *output_pointer = NULL;
     double d = item->valuedouble;
     int length = 0;
-    size_t i = 0;
     unsigned char number_buffer[26]; /* temporary buffer to print the number into */
-    unsigned char decimal_point = get_decimal_point();
-    double test;
+    unsigned char digits[20];
+    unsigned long long integer = 0;
+    int digit_count = 0;
+    int k = 0;
+    int negative = 0;
 
     if (output_buffer == NULL)
     {
@@ -503,25 +1818,40 @@ static bscJSON_bool print_number(const bscJSON *const item, printbuffer *const o
     /* This checks for NaN and Infinity */
     if ((d * 0) != 0)
     {
-        length = sprintf((char *)number_buffer, "null");
+        memcpy(number_buffer, "null", sizeof("null"));
+        length = 4;
     }
     else
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char *)number_buffer, "%1.15g", d);
-
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char *)number_buffer, "%lg", &test) != 1) || ((double)test != d))
+        negative = (d < 0) || ((d == 0) && (1.0 / d < 0));
+        if (negative)
         {
-            /* If not, print with 17 decimal places of precision */
-            length = sprintf((char *)number_buffer, "%1.17g", d);
+            d = -d;
         }
-    }
 
-    /* sprintf failed or buffer overrun occurred */
-    if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1)))
-    {
-        return false;
+        if ((d < 1e15) && (d == (double)(unsigned long long)d))
+        {
+            /* integers below 10^15 print all their digits, same as "%1.15g" */
+            integer = (unsigned long long)d;
+            do
+            {
+                digits[sizeof(digits) - 1 - (size_t)digit_count++] = (unsigned char)('0' + (integer % 10));
+                integer /= 10;
+            } while (integer != 0);
+            length = print_digits(number_buffer, negative, digits + sizeof(digits) - digit_count, digit_count, 0);
+        }
+        else
+        {
+            if (!grisu3(d, digits, &digit_count, &k))
+            {
+                digit_count = shortest_digits_exact(d, digits, &k, &output_buffer->hooks);
+                if (digit_count == 0)
+                {
+                    return false;
+                }
+            }
+            length = print_digits(number_buffer, negative, digits, digit_count, k);
+        }
     }
 
     /* reserve appropriate space in the output */
@@ -531,20 +1861,7 @@ static bscJSON_bool print_number(const bscJSON *const item, printbuffer *const o
         return false;
     }
 
-    /* copy the printed number to the output and replace locale
-     * dependent decimal point with '.' */
-    for (i = 0; i < ((size_t)length); i++)
-    {
-        if (number_buffer[i] == decimal_point)
-        {
-            output_pointer[i] = '.';
-            continue;
-        }
-
-        output_pointer[i] = number_buffer[i];
-    }
-    output_pointer[i] = '\0';
-
+    memcpy(output_pointer, number_buffer, (size_t)length + sizeof(""));
     output_buffer->offset += (size_t)length;
 
     return true;
@@ -747,7 +2064,7 @@ static bscJSON_bool parse_string(bscJSON *const item, parse_buffer *const input_
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t)(input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char *)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        output = (unsigned char *)hooks_allocate(&input_buffer->hooks, allocation_length + sizeof(""));
         if (output == NULL)
         {
             goto fail; /* allocation failure */
@@ -825,7 +2142,7 @@ static bscJSON_bool parse_string(bscJSON *const item, parse_buffer *const input_
 fail:
     if (output != NULL)
     {
-        input_buffer->hooks.deallocate(output);
+        hooks_deallocate(&input_buffer->hooks, output);
     }
 
     if (input_pointer != NULL)
@@ -1010,9 +2327,9 @@ static parse_buffer *skip_utf8_bom(parse_buffer *const buffer)
 }
 
 /* Parse an object - create a new root, and populate. */
-bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOpts(const char *value, const char **return_parse_end, bscJSON_bool require_null_terminated)
+static bscJSON *parse_with_hooks(const char *value, const char **return_parse_end, bscJSON_bool require_null_terminated, const internal_hooks *const hooks)
 {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0, 0}};
     bscJSON *item = NULL;
 
     /* reset error position */
@@ -1027,9 +2344,9 @@ bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOpts(const char *value, const char **
     buffer.content = (const unsigned char *)value;
     buffer.length = strlen((const char *)value) + sizeof("");
     buffer.offset = 0;
-    buffer.hooks = global_hooks;
+    buffer.hooks = *hooks;
 
-    item = bscJSON_New_Item(&global_hooks);
+    item = bscJSON_New_Item(hooks);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1058,7 +2375,7 @@ bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOpts(const char *value, const char **
     return item;
 
 fail:
-    if (item != NULL)
+    if ((item != NULL) && (hooks->arena == NULL))
     {
         bscJSON_Delete(item);
     }
@@ -1089,12 +2406,68 @@ fail:
     return NULL;
 }
 
+bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOpts(const char *value, const char **return_parse_end, bscJSON_bool require_null_terminated)
+{
+    return parse_with_hooks(value, return_parse_end, require_null_terminated, &global_hooks);
+}
+
 /* Default options for bscJSON_Parse */
 bscJSON_PUBLIC(bscJSON *) bscJSON_Parse(const char *value)
 {
     return bscJSON_ParseWithOpts(value, 0, 0);
 }
 
+bscJSON_PUBLIC(void) bscJSON_ArenaInit(bscJSON_Arena *arena, void *block, size_t size)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    arena->block = (unsigned char *)block;
+    arena->size = (block != NULL) ? size : 0;
+    arena->used = 0;
+    arena->overflow = NULL;
+    arena->allocations = 0;
+}
+
+bscJSON_PUBLIC(void) bscJSON_ArenaReset(bscJSON_Arena *arena)
+{
+    arena_chunk *chunk = NULL;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    while (arena->overflow != NULL)
+    {
+        chunk = (arena_chunk *)arena->overflow;
+        arena->overflow = chunk->next;
+        global_hooks.deallocate(chunk);
+    }
+    arena->used = 0;
+    arena->allocations = 0;
+}
+
+bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOptsInArena(const char *value, const char **return_parse_end, bscJSON_bool require_null_terminated, bscJSON_Arena *arena)
+{
+    internal_hooks hooks = global_hooks;
+
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    hooks.arena = arena;
+    return parse_with_hooks(value, return_parse_end, require_null_terminated, &hooks);
+}
+
+bscJSON_PUBLIC(bscJSON *) bscJSON_ParseInArena(const char *value, bscJSON_Arena *arena)
+{
+    return bscJSON_ParseWithOptsInArena(value, 0, 0, arena);
+}
+
 #define bscJSON_min(a, b) ((a < b) ? a : b)
 
 static unsigned char *print(const bscJSON *const item, bscJSON_bool format, const internal_hooks *const hooks)
@@ -1175,7 +2548,7 @@ bscJSON_PUBLIC(char *) bscJSON_PrintUnformatted(const bscJSON *item)
 
 bscJSON_PUBLIC(char *) bscJSON_PrintBuffered(const bscJSON *item, int prebuffer, bscJSON_bool fmt)
 {
-    printbuffer p = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
+    printbuffer p = {0, 0, 0, 0, 0, 0, {0, 0, 0, 0}};
 
     if (prebuffer < 0)
     {
@@ -1205,7 +2578,7 @@ bscJSON_PUBLIC(char *) bscJSON_PrintBuffered(const bscJSON *item, int prebuffer,
 
 bscJSON_PUBLIC(bscJSON_bool) bscJSON_PrintPreallocated(bscJSON *item, char *buf, const int len, const bscJSON_bool fmt)
 {
-    printbuffer p = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
+    printbuffer p = {0, 0, 0, 0, 0, 0, {0, 0, 0, 0}};
 
     if ((len < 0) || (buf == NULL))
     {
@@ -1436,7 +2809,7 @@ success:
     return true;
 
 fail:
-    if (head != NULL)
+    if ((head != NULL) && (input_buffer->hooks.arena == NULL))
     {
         bscJSON_Delete(head);
     }
@@ -1511,6 +2884,7 @@ static bscJSON_bool parse_object(bscJSON *const item, parse_buffer *const input_
 {
     bscJSON *head = NULL; /* linked list head */
     bscJSON *current_item = NULL;
+    size_t members = 0;
 
     if (input_buffer->depth >= bscJSON_NESTING_LIMIT)
     {
@@ -1562,6 +2936,7 @@ static bscJSON_bool parse_object(bscJSON *const item, parse_buffer *const input_
             new_item->prev = current_item;
             current_item = new_item;
         }
+        members++;
 
         /* parse the name of the child */
         input_buffer->offset++;
@@ -1601,12 +2976,21 @@ success:
 
     item->type = bscJSON_Object;
     item->child = head;
+    if (input_buffer->hooks.arena != NULL)
+    {
+        item->index = &no_index;
+    }
+    else if ((bscJSON_INDEX_THRESHOLD > 0) && (members > (size_t)bscJSON_INDEX_THRESHOLD))
+    {
+        /* wide objects are indexed while parsing, lookups only read */
+        index_build(item);
+    }
 
     input_buffer->offset++;
     return true;
 
 fail:
-    if (head != NULL)
+    if ((head != NULL) && (input_buffer->hooks.arena == NULL))
     {
         bscJSON_Delete(head);
     }
@@ -1781,15 +3165,37 @@ bscJSON_PUBLIC(bscJSON *) bscJSON_GetArrayItem(const bscJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
+#pragma GCC diagnostic push
+#endif
+#ifdef __GNUC__
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#endif
+/* helper function to cast away const */
+static void *cast_away_const(const void *string)
+{
+    return (void *)string;
+}
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
+#pragma GCC diagnostic pop
+#endif
+
 static bscJSON *get_object_item(const bscJSON *const object, const char *const name, const bscJSON_bool case_sensitive)
 {
     bscJSON *current_element = NULL;
+    const object_index *index = NULL;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+    index = get_index(object);
+    if (index != NULL)
+    {
+        return index_find(index, name, case_sensitive);
+    }
+
     current_element = object->child;
     if (case_sensitive)
     {
@@ -1853,6 +3259,7 @@ static bscJSON *create_reference(const bscJSON *item, const internal_hooks *cons
 
     memcpy(reference, item, sizeof(bscJSON));
     reference->string = NULL;
+    reference->index = NULL;
     reference->type |= bscJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -1861,6 +3268,8 @@ static bscJSON *create_reference(const bscJSON *item, const internal_hooks *cons
 static bscJSON_bool add_item_to_array(bscJSON *array, bscJSON *item)
 {
     bscJSON *child = NULL;
+    object_index *index = NULL;
+    size_t walked = 0;
 
     if ((item == NULL) || (array == NULL))
     {
@@ -1868,22 +3277,52 @@ static bscJSON_bool add_item_to_array(bscJSON *array, bscJSON *item)
     }
 
     child = array->child;
+    index = get_index(array);
 
     if (child == NULL)
     {
         /* list is empty, start new one */
         array->child = item;
     }
+    else if (index != NULL)
+    {
+        suffix_object(index->last, item);
+    }
     else
     {
         /* append to the end */
         while (child->next)
         {
             child = child->next;
+            walked++;
         }
         suffix_object(child, item);
     }
 
+    /* a wide object gets the index already while it is built, it keeps the tail for the next appends */
+    if ((index == NULL) && (item->string != NULL) && (bscJSON_INDEX_THRESHOLD > 0) && (walked >= (size_t)bscJSON_INDEX_THRESHOLD) &&
+        (array->index == NULL) && !(array->type & bscJSON_IsReference))
+    {
+        index_build(array);
+    }
+    else if (index != NULL)
+    {
+        if (item->string == NULL)
+        {
+            index_drop(array);
+        }
+        else if (((index->count + 1) * 4) > ((index->mask + 1) * 3))
+        {
+            /* too full, grow */
+            index_build(array);
+        }
+        else
+        {
+            index_put(index, item);
+            index->last = item;
+        }
+    }
+
     return true;
 }
 
@@ -1893,21 +3332,6 @@ bscJSON_PUBLIC(void) bscJSON_AddItemToArray(bscJSON *array, bscJSON *item)
     add_item_to_array(array, item);
 }
 
-#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
-#pragma GCC diagnostic push
-#endif
-#ifdef __GNUC__
-#pragma GCC diagnostic ignored "-Wcast-qual"
-#endif
-/* helper function to cast away const */
-static void *cast_away_const(const void *string)
-{
-    return (void *)string;
-}
-#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
-#pragma GCC diagnostic pop
-#endif
-
 static bscJSON_bool add_item_to_object(bscJSON *const object, const char *const string, bscJSON *const item, const internal_hooks *const hooks, const bscJSON_bool constant_key)
 {
     char *new_key = NULL;
@@ -2092,11 +3516,27 @@ bscJSON_PUBLIC(bscJSON *) bscJSON_AddObjectToArray(bscJSON *const object, const
 
 bscJSON_PUBLIC(bscJSON *) bscJSON_DetachItemViaPointer(bscJSON *parent, bscJSON *const item)
 {
+    object_index *index = NULL;
+    bscJSON_bool rebuild = false;
+
     if ((parent == NULL) || (item == NULL))
     {
         return NULL;
     }
 
+    index = get_index(parent);
+    if (index != NULL)
+    {
+        if ((item->string == NULL) || !index_remove(index, item))
+        {
+            rebuild = true;
+        }
+        else if (index->last == item)
+        {
+            index->last = item->prev;
+        }
+    }
+
     if (item->prev != NULL)
     {
         /* not the first element */
@@ -2117,6 +3557,11 @@ bscJSON_PUBLIC(bscJSON *) bscJSON_DetachItemViaPointer(bscJSON *parent, bscJSON
     item->prev = NULL;
     item->next = NULL;
 
+    if (rebuild)
+    {
+        index_build(parent);
+    }
+
     return item;
 }
 
@@ -2187,10 +3632,19 @@ bscJSON_PUBLIC(void) bscJSON_InsertItemInArray(bscJSON *array, int which, bscJSO
     {
         newitem->prev->next = newitem;
     }
+
+    /* a member in the middle would break the list order along the probe paths, index the new list */
+    if (get_index(array) != NULL)
+    {
+        index_build(array);
+    }
 }
 
 bscJSON_PUBLIC(bscJSON_bool) bscJSON_ReplaceItemViaPointer(bscJSON *const parent, bscJSON *const item, bscJSON *replacement)
 {
+    object_index *index = NULL;
+    bscJSON_bool rebuild = false;
+
     if ((parent == NULL) || (replacement == NULL) || (item == NULL))
     {
         return false;
@@ -2201,6 +3655,19 @@ bscJSON_PUBLIC(bscJSON_bool) bscJSON_ReplaceItemViaPointer(bscJSON *const parent
         return true;
     }
 
+    index = get_index(parent);
+    if (index != NULL)
+    {
+        if ((item->string == NULL) || (replacement->string == NULL) || !index_replace(index, item, replacement))
+        {
+            rebuild = true;
+        }
+        else if (index->last == item)
+        {
+            index->last = replacement;
+        }
+    }
+
     replacement->next = item->next;
     replacement->prev = item->prev;
 
@@ -2221,6 +3688,11 @@ bscJSON_PUBLIC(bscJSON_bool) bscJSON_ReplaceItemViaPointer(bscJSON *const parent
     item->prev = NULL;
     bscJSON_Delete(item);
 
+    if (rebuild)
+    {
+        index_build(parent);
+    }
+
     return true;
 }
 
@@ -2639,6 +4111,11 @@ bscJSON_PUBLIC(bscJSON *) bscJSON_Duplicate(const bscJSON *item, bscJSON_bool re
         }
         child = child->next;
     }
+    /* the copy of an indexed object is indexed as well */
+    if (get_index(item) != NULL)
+    {
+        index_build(newitem);
+    }
 
     return newitem;
 
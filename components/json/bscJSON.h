@@ -119,6 +119,8 @@ then using the bscJSON_API_VISIBILITY flag to "export" the same symbols the way
     double valuedouble;
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+    /* Lookup index of a wide object, owned by bscJSON. Don't touch. */
+    struct bscJSON_Index *index;
   } bscJSON;
 
   typedef struct bscJSON_Hooks
@@ -130,10 +132,29 @@ then using the bscJSON_API_VISIBILITY flag to "export" the same symbols the way
 
   typedef int bscJSON_bool;
 
+  /* An arena hands out the nodes and strings of a parsed document from one caller supplied block (usually on the stack).
+   * Documents parsed into an arena are released all at once with bscJSON_ArenaReset and must not be passed to bscJSON_Delete.
+   * When the block runs out, further chunks are taken from the hooks set with bscJSON_InitHooks and returned on reset. */
+  typedef struct bscJSON_Arena
+  {
+    unsigned char *block;
+    size_t size;
+    size_t used;
+    void *overflow;     /* chunks taken from the hooks after the block ran out */
+    size_t allocations; /* allocations served since the last reset, for sizing the block */
+  } bscJSON_Arena;
+
 /* Limits how deeply nested arrays/objects can be before bscJSON rejects to parse them.
  * This is to prevent stack overflows. */
 #ifndef bscJSON_NESTING_LIMIT
 #define bscJSON_NESTING_LIMIT 1000
+#endif
+
+/* Objects parsed with more than this many members, or grown past it by appends, get a hash index: lookups and appends no longer walk the list.
+ * Only parsing and the add/detach/replace/insert functions build or update the index, lookups never write to the document.
+ * Code that relinks members or renames them directly has to build with 0. Objects parsed into an arena are never indexed. 0 disables indexing. */
+#ifndef bscJSON_INDEX_THRESHOLD
+#define bscJSON_INDEX_THRESHOLD 16
 #endif
 
   /* returns the version of bscJSON as a string */
@@ -149,6 +170,14 @@ then using the bscJSON_API_VISIBILITY flag to "export" the same symbols the way
   /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match bscJSON_GetErrorPtr(). */
   bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOpts(const char *value, const char **return_parse_end, bscJSON_bool require_null_terminated);
 
+  /* Prepare an arena over block, which must stay valid until the last bscJSON_ArenaReset. */
+  bscJSON_PUBLIC(void) bscJSON_ArenaInit(bscJSON_Arena *arena, void *block, size_t size);
+  /* Release every document parsed into the arena and the overflow chunks, the arena can be reused afterwards. */
+  bscJSON_PUBLIC(void) bscJSON_ArenaReset(bscJSON_Arena *arena);
+  /* Same as bscJSON_Parse/bscJSON_ParseWithOpts, but the document lives in the arena. */
+  bscJSON_PUBLIC(bscJSON *) bscJSON_ParseInArena(const char *value, bscJSON_Arena *arena);
+  bscJSON_PUBLIC(bscJSON *) bscJSON_ParseWithOptsInArena(const char *value, const char **return_parse_end, bscJSON_bool require_null_terminated, bscJSON_Arena *arena);
+
   /* Render a bscJSON entity to text for transfer/storage. */
   bscJSON_PUBLIC(char *) bscJSON_Print(const bscJSON *item);
   /* Render a bscJSON entity to text for transfer/storage without any formatting. */
@@ -1090,6 +1090,42 @@ int bscomptls_mpi_sub_int( bscomptls_mpi *X, const bscomptls_mpi *A, bscomptls_m
     return( bscomptls_mpi_sub_mpi( X, A, &_B ) );
 }
 
+#if defined(MULADDC_ADX_INIT)
+/*
+ * BMI2 (EBX bit 8) and ADX (EBX bit 19) of cpuid leaf 7, sub-leaf 0
+ */
+static int mpi_adx_has_support( void )
+{
+    static int done = 0;
+    static int adx = 0;
+    unsigned int max = 0, b = 0;
+
+    if( ! done )
+    {
+        asm( "xorl  %%eax, %%eax \n\t"
+             "cpuid             \n\t"
+             : "=a" (max)
+             :
+             : "ebx", "ecx", "edx" );
+
+        if( max >= 7 )
+        {
+            asm( "movl  $7, %%eax   \n\t"
+                 "xorl  %%ecx, %%ecx \n\t"
+                 "cpuid             \n\t"
+                 : "=b" (b)
+                 :
+                 : "eax", "ecx", "edx" );
+        }
+
+        adx = ( b & ( 1u << 8 ) ) != 0 && ( b & ( 1u << 19 ) ) != 0;
+        done = 1;
+    }
+
+    return( adx );
+}
+#endif /* MULADDC_ADX_INIT */
+
 /*
  * Helper for bscomptls_mpi multiplication
  */
@@ -1105,6 +1141,39 @@ void mpi_mul_hlp( size_t i, bscomptls_mpi_uint *s, bscomptls_mpi_uint *d, bscomp
 {
     bscomptls_mpi_uint c = 0, t = 0;
 
+#if defined(MULADDC_ADX_INIT)
+    /*
+     * Consumes all of i, the generic loops below are then skipped
+     */
+    if( mpi_adx_has_support() )
+    {
+        for( ; i >= 8; i -= 8 )
+        {
+            MULADDC_ADX_INIT
+            MULADDC_ADX_CORE( 0 )   MULADDC_ADX_CORE( 1 )
+            MULADDC_ADX_CORE( 2 )   MULADDC_ADX_CORE( 3 )
+            MULADDC_ADX_CORE( 4 )   MULADDC_ADX_CORE( 5 )
+            MULADDC_ADX_CORE( 6 )   MULADDC_ADX_CORE( 7 )
+            MULADDC_ADX_STOP( 8 )
+        }
+
+        for( ; i >= 4; i -= 4 )
+        {
+            MULADDC_ADX_INIT
+            MULADDC_ADX_CORE( 0 )   MULADDC_ADX_CORE( 1 )
+            MULADDC_ADX_CORE( 2 )   MULADDC_ADX_CORE( 3 )
+            MULADDC_ADX_STOP( 4 )
+        }
+
+        for( ; i > 0; i-- )
+        {
+            MULADDC_ADX_INIT
+            MULADDC_ADX_CORE( 0 )
+            MULADDC_ADX_STOP( 1 )
+        }
+    }
+#endif /* MULADDC_ADX_INIT */
+
 #if defined(MULADDC_HUIT)
     for( ; i >= 8; i -= 8 )
     {
@@ -117,6 +117,7 @@
         defined(__amd64__) || defined(__x86_64__)    || \
         defined(__ppc64__) || defined(__powerpc64__) || \
         defined(__ia64__)  || defined(__alpha__)     || \
+        (defined(__aarch64__) && defined(BSCOMPTLS_BIGNUM_AARCH64_INT64)) || \
         (defined(__sparc__) && defined(__arch64__))  || \
         defined(__s390x__) || defined(__mips64) ) )
      #define BSCOMPTLS_HAVE_INT64
@@ -182,6 +182,38 @@
         : "rax", "rdx", "r8"                \
     );
 
+#if defined(BSCOMPTLS_BIGNUM_ADX)
+
+/*
+ * BMI2 + ADX variant: mulx leaves the flags alone, so the carry of the
+ * product chain (adcx, CF) and the one of the accumulation into d (adox, OF)
+ * run side by side. The caller must check CPU support first, see
+ * mpi_mul_hlp() in bignum.c. k is the limb index inside the block, n the
+ * block size.
+ */
+#define MULADDC_ADX_INIT                    \
+    asm(                                    \
+        "xorl   %%r8d, %%r8d        \n\t"
+
+#define MULADDC_ADX_CORE( k )               \
+        "mulxq  " #k "*8(%2), %%rax, %%r9  \n\t" \
+        "adcxq  %0,    %%rax        \n\t"   \
+        "adoxq  " #k "*8(%1), %%rax  \n\t"   \
+        "movq   %%rax, " #k "*8(%1)  \n\t"   \
+        "movq   %%r9,  %0           \n\t"
+
+#define MULADDC_ADX_STOP( n )               \
+        "leaq   " #n "*8(%2), %2     \n\t"   \
+        "leaq   " #n "*8(%1), %1     \n\t"   \
+        "adcxq  %%r8,  %0           \n\t"   \
+        "adoxq  %%r8,  %0           \n\t"   \
+        : "+r" (c), "+r" (d), "+r" (s)      \
+        : "d" (b)                           \
+        : "rax", "r8", "r9", "cc", "memory" \
+    );
+
+#endif /* BSCOMPTLS_BIGNUM_ADX */
+
 #endif /* AMD64 */
 
 #if defined(__mc68020__) || defined(__mcpu32__)
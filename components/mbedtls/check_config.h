@@ -69,6 +69,14 @@
 #error "BSCOMPTLS_AESNI_C defined, but not all prerequisites"
 #endif
 
+#if defined(BSCOMPTLS_BIGNUM_ADX) && !defined(BSCOMPTLS_HAVE_ASM)
+#error "BSCOMPTLS_BIGNUM_ADX defined, but not all prerequisites"
+#endif
+
+#if defined(BSCOMPTLS_SHA256_SHANI) && !defined(BSCOMPTLS_HAVE_ASM)
+#error "BSCOMPTLS_SHA256_SHANI defined, but not all prerequisites"
+#endif
+
 #if defined(BSCOMPTLS_CTR_DRBG_C) && !defined(BSCOMPTLS_AES_C)
 #error "BSCOMPTLS_CTR_DRBG_C defined, but not all prerequisites"
 #endif
@@ -55,6 +55,40 @@
  */
 #define BSCOMPTLS_HAVE_ASM
 
+/**
+ * \def BSCOMPTLS_BIGNUM_ADX
+ *
+ * Use the MULX/ADCX/ADOX instructions (BMI2 + ADX) in the bignum inner
+ * multiplication loop on x86-64. Support is checked with cpuid at runtime,
+ * older CPUs keep using the generic assembly.
+ *
+ * Requires: BSCOMPTLS_HAVE_ASM, x86-64, binutils with ADX support
+ *
+ * Used in:
+ *      library/bignum.c
+ *      include/mbedtls/bn_mul.h
+ *
+ * Comment to disable the ADX code path.
+ */
+#define BSCOMPTLS_BIGNUM_ADX
+
+/**
+ * \def BSCOMPTLS_BIGNUM_AARCH64_INT64
+ *
+ * Use 64-bit limbs (with the compiler's 128-bit integer for products) for
+ * bignum on AArch64. Without it AArch64 keeps the 32-bit limbs it has
+ * always used.
+ *
+ * Requires: GCC or clang, AArch64
+ *
+ * Used in:
+ *      include/mbedtls/bignum.h
+ *
+ * Uncomment once the known-answer tests (tests/unit/test_bignum.c) pass
+ * on the target.
+ */
+//#define BSCOMPTLS_BIGNUM_AARCH64_INT64
+
 /**
  * \def BSCOMPTLS_HAVE_SSE2
  *
@@ -924,6 +958,30 @@
  */
 //#define BSCOMPTLS_SELF_TEST
 
+/**
+ * \def BSCOMPTLS_SHA256_SHANI
+ *
+ * Use the SHA-NI instructions for SHA-256 on x86-64. Support is checked with
+ * cpuid on first use, other CPUs keep the C implementation.
+ *
+ * Requires: BSCOMPTLS_HAVE_ASM, GCC or clang
+ *
+ * Comment to disable the SHA-NI code path.
+ */
+#define BSCOMPTLS_SHA256_SHANI
+
+/**
+ * \def BSCOMPTLS_SHA256_A64_CRYPTO
+ *
+ * Use the ARMv8 crypto extensions for SHA-256 on AArch64. Only takes effect
+ * when the compiler targets them (e.g. -march=armv8-a+crypto), there is no
+ * runtime check. Off by default until tests/unit/test_sha has been run on the
+ * target hardware.
+ *
+ * Uncomment to enable the ARMv8 code path.
+ */
+//#define BSCOMPTLS_SHA256_A64_CRYPTO
+
 /**
  * \def BSCOMPTLS_SHA256_SMALLER
  *
@@ -940,6 +998,29 @@
  */
 #define BSCOMPTLS_SHA256_SMALLER
 
+/**
+ * \def BSCOMPTLS_SHA512_A64_CRYPTO
+ *
+ * Use the ARMv8.2 SHA-512 instructions for SHA-384/512 on AArch64. Only takes
+ * effect when the compiler targets them (e.g. -march=armv8.2-a+sha3), there is
+ * no runtime check. x86 has no comparable instructions, SHA-384/512 use the
+ * C implementation there. Off by default like BSCOMPTLS_SHA256_A64_CRYPTO.
+ *
+ * Uncomment to enable the ARMv8.2 code path.
+ */
+//#define BSCOMPTLS_SHA512_A64_CRYPTO
+
+/**
+ * \def BSCOMPTLS_SHA512_SMALLER
+ *
+ * Keep the compact SHA-512 round loop with an 80-word message schedule
+ * instead of the unrolled one with a 16-word rolling schedule. Smaller code,
+ * roughly a third slower.
+ *
+ * Uncomment to enable the smaller implementation of SHA512.
+ */
+//#define BSCOMPTLS_SHA512_SMALLER
+
 /**
  * \def BSCOMPTLS_SSL_ALL_ALERT_MESSAGES
  *
@@ -36,6 +36,22 @@
 
 #include <string.h>
 
+#if defined(BSCOMPTLS_HAVE_ASM) && defined(__GNUC__) &&  \
+    ( defined(__amd64__) || defined(__x86_64__) )   &&  \
+    ! defined(BSCOMPTLS_HAVE_X86_64)
+#define BSCOMPTLS_HAVE_X86_64
+#endif
+
+#if defined(BSCOMPTLS_SHA256_SHANI) && defined(BSCOMPTLS_HAVE_X86_64)
+#include <immintrin.h>
+#endif
+
+#if defined(BSCOMPTLS_SHA256_A64_CRYPTO) && defined(__aarch64__) && \
+    ( defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2) )
+#define BSCOMPTLS_HAVE_A64_SHA2
+#include <arm_neon.h>
+#endif
+
 #if defined(BSCOMPTLS_SELF_TEST)
 #if defined(BSCOMPTLS_PLATFORM_C)
 #include "mbedtls/platform.h"
@@ -179,12 +195,197 @@ static const uint32_t K[] =
     d += temp1; h = temp1 + temp2;              \
 }
 
+#if defined(BSCOMPTLS_SHA256_SHANI) && defined(BSCOMPTLS_HAVE_X86_64)
+/*
+ * SHA-NI needs SSSE3 (leaf 1 ECX bit 9), SSE4.1 (leaf 1 ECX bit 19) and
+ * SHA (leaf 7 EBX bit 29)
+ */
+static int sha256_shani_has_support( void )
+{
+    static int done = 0;
+    static int sha = 0;
+    unsigned int max = 0, c = 0, b = 0;
+
+    if( ! done )
+    {
+        asm( "xorl  %%eax, %%eax \n\t"
+             "cpuid             \n\t"
+             : "=a" (max)
+             :
+             : "ebx", "ecx", "edx" );
+
+        asm( "movl  $1, %%eax   \n\t"
+             "cpuid             \n\t"
+             : "=c" (c)
+             :
+             : "eax", "ebx", "edx" );
+
+        if( max >= 7 )
+        {
+            asm( "movl  $7, %%eax   \n\t"
+                 "xorl  %%ecx, %%ecx \n\t"
+                 "cpuid             \n\t"
+                 : "=b" (b)
+                 :
+                 : "eax", "ecx", "edx" );
+        }
+
+        sha = ( c & ( 1u << 9 ) ) != 0 && ( c & ( 1u << 19 ) ) != 0 &&
+              ( b & ( 1u << 29 ) ) != 0;
+        done = 1;
+    }
+
+    return( sha );
+}
+
+/*
+ * sha256rnds2 works on the state as ABEF/CDGH pairs and does two rounds per
+ * call, sha256msg1/sha256msg2 extend the schedule four words at a time.
+ * W[] holds the last 16 schedule words as four vectors. The steps are
+ * written out so that W[] stays in registers.
+ */
+#define SHANI_LOAD( t )                                                     \
+    W[t] = _mm_shuffle_epi8(                                                \
+        _mm_loadu_si128( (const __m128i *) ( data + 16 * t ) ), mask )
+
+#define SHANI_SCHED( t )                                                    \
+do {                                                                        \
+    tmp = _mm_alignr_epi8( W[( t - 1 ) & 3], W[( t - 2 ) & 3], 4 );         \
+    msg = _mm_add_epi32( _mm_sha256msg1_epu32( W[t & 3], W[( t - 3 ) & 3] ), tmp ); \
+    W[t & 3] = _mm_sha256msg2_epu32( msg, W[( t - 1 ) & 3] );              \
+} while( 0 )
+
+#define SHANI_ROUNDS( t )                                                   \
+do {                                                                        \
+    msg    = _mm_add_epi32( W[t & 3], _mm_loadu_si128( (const __m128i *) &K[4 * t] ) ); \
+    state1 = _mm_sha256rnds2_epu32( state1, state0, msg );                  \
+    msg    = _mm_shuffle_epi32( msg, 0x0E );                                \
+    state0 = _mm_sha256rnds2_epu32( state0, state1, msg );                  \
+} while( 0 )
+
+__attribute__((target("sha,sse4.1")))
+static void sha256_process_shani( uint32_t state[8], const unsigned char data[64] )
+{
+    const __m128i mask = _mm_set_epi64x( 0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL );
+    __m128i state0, state1, abef, cdgh, msg, tmp, W[4];
+
+    tmp    = _mm_loadu_si128( (const __m128i *) &state[0] );
+    state1 = _mm_loadu_si128( (const __m128i *) &state[4] );
+    tmp    = _mm_shuffle_epi32( tmp, 0xB1 );            /* CDAB */
+    state1 = _mm_shuffle_epi32( state1, 0x1B );         /* EFGH */
+    state0 = _mm_alignr_epi8( tmp, state1, 8 );         /* ABEF */
+    state1 = _mm_blend_epi16( state1, tmp, 0xF0 );      /* CDGH */
+
+    abef = state0;
+    cdgh = state1;
+
+    SHANI_LOAD( 0 );    SHANI_ROUNDS( 0 );
+    SHANI_LOAD( 1 );    SHANI_ROUNDS( 1 );
+    SHANI_LOAD( 2 );    SHANI_ROUNDS( 2 );
+    SHANI_LOAD( 3 );    SHANI_ROUNDS( 3 );
+    SHANI_SCHED( 4 );   SHANI_ROUNDS( 4 );
+    SHANI_SCHED( 5 );   SHANI_ROUNDS( 5 );
+    SHANI_SCHED( 6 );   SHANI_ROUNDS( 6 );
+    SHANI_SCHED( 7 );   SHANI_ROUNDS( 7 );
+    SHANI_SCHED( 8 );   SHANI_ROUNDS( 8 );
+    SHANI_SCHED( 9 );   SHANI_ROUNDS( 9 );
+    SHANI_SCHED( 10 );  SHANI_ROUNDS( 10 );
+    SHANI_SCHED( 11 );  SHANI_ROUNDS( 11 );
+    SHANI_SCHED( 12 );  SHANI_ROUNDS( 12 );
+    SHANI_SCHED( 13 );  SHANI_ROUNDS( 13 );
+    SHANI_SCHED( 14 );  SHANI_ROUNDS( 14 );
+    SHANI_SCHED( 15 );  SHANI_ROUNDS( 15 );
+
+    state0 = _mm_add_epi32( state0, abef );
+    state1 = _mm_add_epi32( state1, cdgh );
+
+    tmp    = _mm_shuffle_epi32( state0, 0x1B );         /* FEBA */
+    state1 = _mm_shuffle_epi32( state1, 0xB1 );         /* DCHG */
+    state0 = _mm_blend_epi16( tmp, state1, 0xF0 );      /* DCBA */
+    state1 = _mm_alignr_epi8( state1, tmp, 8 );         /* HGFE */
+
+    _mm_storeu_si128( (__m128i *) &state[0], state0 );
+    _mm_storeu_si128( (__m128i *) &state[4], state1 );
+}
+#endif /* BSCOMPTLS_SHA256_SHANI && BSCOMPTLS_HAVE_X86_64 */
+
+#if defined(BSCOMPTLS_SHA256_A64_CRYPTO) && defined(BSCOMPTLS_HAVE_A64_SHA2)
+/*
+ * ARMv8 crypto extensions. Only built when the compiler targets them
+ * (-march=armv8-a+crypto), so there is nothing to check at runtime.
+ * sched0..3 hold the last 16 schedule words, four rounds per step.
+ */
+#define A64_ROUNDS( sched, k )                                  \
+do {                                                            \
+    tmp = vaddq_u32( sched, vld1q_u32( k ) );                   \
+    abcd_prev = abcd;                                           \
+    abcd = vsha256hq_u32( abcd_prev, efgh, tmp );               \
+    efgh = vsha256h2q_u32( efgh, abcd_prev, tmp );              \
+} while( 0 )
+
+static uint32x4_t sha256_a64_load( const unsigned char *p )
+{
+    uint8x16_t v = vld1q_u8( p );
+#if !defined(__ARM_BIG_ENDIAN)
+    v = vrev32q_u8( v );
+#endif
+    return( vreinterpretq_u32_u8( v ) );
+}
+
+static void sha256_process_a64( uint32_t state[8], const unsigned char data[64] )
+{
+    uint32x4_t abcd = vld1q_u32( &state[0] );
+    uint32x4_t efgh = vld1q_u32( &state[4] );
+    uint32x4_t abcd_orig = abcd, efgh_orig = efgh, abcd_prev, tmp;
+    uint32x4_t sched0, sched1, sched2, sched3;
+    unsigned int t;
+
+    sched0 = sha256_a64_load( data );
+    sched1 = sha256_a64_load( data + 16 );
+    sched2 = sha256_a64_load( data + 32 );
+    sched3 = sha256_a64_load( data + 48 );
+
+    A64_ROUNDS( sched0, &K[0] );
+    A64_ROUNDS( sched1, &K[4] );
+    A64_ROUNDS( sched2, &K[8] );
+    A64_ROUNDS( sched3, &K[12] );
+
+    for( t = 16; t < 64; t += 16 )
+    {
+        sched0 = vsha256su1q_u32( vsha256su0q_u32( sched0, sched1 ), sched2, sched3 );
+        A64_ROUNDS( sched0, &K[t] );
+        sched1 = vsha256su1q_u32( vsha256su0q_u32( sched1, sched2 ), sched3, sched0 );
+        A64_ROUNDS( sched1, &K[t + 4] );
+        sched2 = vsha256su1q_u32( vsha256su0q_u32( sched2, sched3 ), sched0, sched1 );
+        A64_ROUNDS( sched2, &K[t + 8] );
+        sched3 = vsha256su1q_u32( vsha256su0q_u32( sched3, sched0 ), sched1, sched2 );
+        A64_ROUNDS( sched3, &K[t + 12] );
+    }
+
+    vst1q_u32( &state[0], vaddq_u32( abcd, abcd_orig ) );
+    vst1q_u32( &state[4], vaddq_u32( efgh, efgh_orig ) );
+}
+#endif /* BSCOMPTLS_SHA256_A64_CRYPTO && BSCOMPTLS_HAVE_A64_SHA2 */
+
 void bscomptls_sha256_process( bscomptls_sha256_context *ctx, const unsigned char data[64] )
 {
     uint32_t temp1, temp2, W[64];
     uint32_t A[8];
     unsigned int i;
 
+#if defined(BSCOMPTLS_SHA256_SHANI) && defined(BSCOMPTLS_HAVE_X86_64)
+    if( sha256_shani_has_support() )
+    {
+        sha256_process_shani( ctx->state, data );
+        return;
+    }
+#endif
+
+#if defined(BSCOMPTLS_SHA256_A64_CRYPTO) && defined(BSCOMPTLS_HAVE_A64_SHA2)
+    sha256_process_a64( ctx->state, data );
+    return;
+#endif
+
     for( i = 0; i < 8; i++ )
         A[i] = ctx->state[i];
 
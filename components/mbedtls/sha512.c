@@ -42,6 +42,12 @@
 
 #include <string.h>
 
+#if defined(BSCOMPTLS_SHA512_A64_CRYPTO) && defined(__aarch64__) && \
+    defined(__ARM_FEATURE_SHA512)
+#define BSCOMPTLS_HAVE_A64_SHA512
+#include <arm_neon.h>
+#endif
+
 #if defined(BSCOMPTLS_SELF_TEST)
 #if defined(BSCOMPTLS_PLATFORM_C)
 #include "mbedtls/platform.h"
@@ -196,12 +202,98 @@ static const uint64_t K[80] =
     UL64(0x5FCB6FAB3AD6FAEC),  UL64(0x6C44198C4A475817)
 };
 
+#if defined(BSCOMPTLS_HAVE_A64_SHA512)
+/*
+ * ARMv8.2 SHA-512 extension. Only built when the compiler targets it
+ * (-march=armv8.2-a+sha3), so there is nothing to check at runtime.
+ * The state is kept as the pairs ab, cd, ef, gh; each step does two rounds
+ * and the roles of the pairs rotate by one every step. s0..s7 hold the last
+ * 16 schedule words.
+ */
+#define A64_ROUNDS( s, k, ab, cd, ef, gh )                                  \
+do {                                                                        \
+    sum = vaddq_u64( s, vld1q_u64( &K[k] ) );                              \
+    sum = vaddq_u64( vextq_u64( sum, sum, 1 ), gh );                        \
+    intermed = vsha512hq_u64( sum, vextq_u64( ef, gh, 1 ),                  \
+                              vextq_u64( cd, ef, 1 ) );                     \
+    gh = vsha512h2q_u64( intermed, cd, ab );                                \
+    cd = vaddq_u64( cd, intermed );                                         \
+} while( 0 )
+
+#define A64_SCHED( s, s1, s7, s4, s5 )                                      \
+    s = vsha512su1q_u64( vsha512su0q_u64( s, s1 ), s7, vextq_u64( s4, s5, 1 ) )
+
+static uint64x2_t sha512_a64_load( const unsigned char *p )
+{
+    uint8x16_t v = vld1q_u8( p );
+#if !defined(__ARM_BIG_ENDIAN)
+    v = vrev64q_u8( v );
+#endif
+    return( vreinterpretq_u64_u8( v ) );
+}
+
+static void sha512_process_a64( uint64_t state[8], const unsigned char data[128] )
+{
+    uint64x2_t ab = vld1q_u64( &state[0] );
+    uint64x2_t cd = vld1q_u64( &state[2] );
+    uint64x2_t ef = vld1q_u64( &state[4] );
+    uint64x2_t gh = vld1q_u64( &state[6] );
+    uint64x2_t ab_orig = ab, cd_orig = cd, ef_orig = ef, gh_orig = gh;
+    uint64x2_t s0, s1, s2, s3, s4, s5, s6, s7, sum, intermed;
+    unsigned int t;
+
+    s0 = sha512_a64_load( data );
+    s1 = sha512_a64_load( data + 16 );
+    s2 = sha512_a64_load( data + 32 );
+    s3 = sha512_a64_load( data + 48 );
+    s4 = sha512_a64_load( data + 64 );
+    s5 = sha512_a64_load( data + 80 );
+    s6 = sha512_a64_load( data + 96 );
+    s7 = sha512_a64_load( data + 112 );
+
+    A64_ROUNDS( s0,  0, ab, cd, ef, gh );
+    A64_ROUNDS( s1,  2, gh, ab, cd, ef );
+    A64_ROUNDS( s2,  4, ef, gh, ab, cd );
+    A64_ROUNDS( s3,  6, cd, ef, gh, ab );
+    A64_ROUNDS( s4,  8, ab, cd, ef, gh );
+    A64_ROUNDS( s5, 10, gh, ab, cd, ef );
+    A64_ROUNDS( s6, 12, ef, gh, ab, cd );
+    A64_ROUNDS( s7, 14, cd, ef, gh, ab );
+
+    for( t = 16; t < 80; t += 16 )
+    {
+        A64_SCHED( s0, s1, s7, s4, s5 );  A64_ROUNDS( s0, t,      ab, cd, ef, gh );
+        A64_SCHED( s1, s2, s0, s5, s6 );  A64_ROUNDS( s1, t + 2,  gh, ab, cd, ef );
+        A64_SCHED( s2, s3, s1, s6, s7 );  A64_ROUNDS( s2, t + 4,  ef, gh, ab, cd );
+        A64_SCHED( s3, s4, s2, s7, s0 );  A64_ROUNDS( s3, t + 6,  cd, ef, gh, ab );
+        A64_SCHED( s4, s5, s3, s0, s1 );  A64_ROUNDS( s4, t + 8,  ab, cd, ef, gh );
+        A64_SCHED( s5, s6, s4, s1, s2 );  A64_ROUNDS( s5, t + 10, gh, ab, cd, ef );
+        A64_SCHED( s6, s7, s5, s2, s3 );  A64_ROUNDS( s6, t + 12, ef, gh, ab, cd );
+        A64_SCHED( s7, s0, s6, s3, s4 );  A64_ROUNDS( s7, t + 14, cd, ef, gh, ab );
+    }
+
+    vst1q_u64( &state[0], vaddq_u64( ab, ab_orig ) );
+    vst1q_u64( &state[2], vaddq_u64( cd, cd_orig ) );
+    vst1q_u64( &state[4], vaddq_u64( ef, ef_orig ) );
+    vst1q_u64( &state[6], vaddq_u64( gh, gh_orig ) );
+}
+#endif /* BSCOMPTLS_HAVE_A64_SHA512 */
+
 void bscomptls_sha512_process( bscomptls_sha512_context *ctx, const unsigned char data[128] )
 {
     int i;
+#if defined(BSCOMPTLS_SHA512_SMALLER)
     uint64_t temp1, temp2, W[80];
+#else
+    uint64_t temp1, temp2, W[16];
+#endif
     uint64_t A, B, C, D, E, F, G, H;
 
+#if defined(BSCOMPTLS_HAVE_A64_SHA512)
+    sha512_process_a64( ctx->state, data );
+    return;
+#endif
+
 #define  SHR(x,n) (x >> n)
 #define ROTR(x,n) (SHR(x,n) | (x << (64 - n)))
 
@@ -226,11 +318,13 @@ void bscomptls_sha512_process( bscomptls_sha512_context *ctx, const unsigned cha
         GET_UINT64_BE( W[i], data, i << 3 );
     }
 
+#if defined(BSCOMPTLS_SHA512_SMALLER)
     for( ; i < 80; i++ )
     {
         W[i] = S1(W[i -  2]) + W[i -  7] +
                S0(W[i - 15]) + W[i - 16];
     }
+#endif
 
     A = ctx->state[0];
     B = ctx->state[1];
@@ -242,6 +336,7 @@ void bscomptls_sha512_process( bscomptls_sha512_context *ctx, const unsigned cha
     H = ctx->state[7];
     i = 0;
 
+#if defined(BSCOMPTLS_SHA512_SMALLER)
     do
     {
         P( A, B, C, D, E, F, G, H, W[i], K[i] ); i++;
@@ -254,6 +349,52 @@ void bscomptls_sha512_process( bscomptls_sha512_context *ctx, const unsigned cha
         P( B, C, D, E, F, G, H, A, W[i], K[i] ); i++;
     }
     while( i < 80 );
+#else /* BSCOMPTLS_SHA512_SMALLER */
+    /*
+     * The schedule is extended in place in a 16-word ring as the rounds
+     * consume it, so it stays in registers/L1 instead of an 80-word array.
+     * The first 16 rounds are written out, the other 64 in blocks of 16.
+     */
+#define W16(t) W[(t) & 15]
+#define R16(t) ( W16(t) += S1(W16((t) - 2)) + W16((t) - 7) + S0(W16((t) - 15)) )
+
+    P( A, B, C, D, E, F, G, H, W[ 0], K[ 0] );
+    P( H, A, B, C, D, E, F, G, W[ 1], K[ 1] );
+    P( G, H, A, B, C, D, E, F, W[ 2], K[ 2] );
+    P( F, G, H, A, B, C, D, E, W[ 3], K[ 3] );
+    P( E, F, G, H, A, B, C, D, W[ 4], K[ 4] );
+    P( D, E, F, G, H, A, B, C, W[ 5], K[ 5] );
+    P( C, D, E, F, G, H, A, B, W[ 6], K[ 6] );
+    P( B, C, D, E, F, G, H, A, W[ 7], K[ 7] );
+    P( A, B, C, D, E, F, G, H, W[ 8], K[ 8] );
+    P( H, A, B, C, D, E, F, G, W[ 9], K[ 9] );
+    P( G, H, A, B, C, D, E, F, W[10], K[10] );
+    P( F, G, H, A, B, C, D, E, W[11], K[11] );
+    P( E, F, G, H, A, B, C, D, W[12], K[12] );
+    P( D, E, F, G, H, A, B, C, W[13], K[13] );
+    P( C, D, E, F, G, H, A, B, W[14], K[14] );
+    P( B, C, D, E, F, G, H, A, W[15], K[15] );
+
+    for( i = 16; i < 80; i += 16 )
+    {
+        P( A, B, C, D, E, F, G, H, R16( 0), K[i +  0] );
+        P( H, A, B, C, D, E, F, G, R16( 1), K[i +  1] );
+        P( G, H, A, B, C, D, E, F, R16( 2), K[i +  2] );
+        P( F, G, H, A, B, C, D, E, R16( 3), K[i +  3] );
+        P( E, F, G, H, A, B, C, D, R16( 4), K[i +  4] );
+        P( D, E, F, G, H, A, B, C, R16( 5), K[i +  5] );
+        P( C, D, E, F, G, H, A, B, R16( 6), K[i +  6] );
+        P( B, C, D, E, F, G, H, A, R16( 7), K[i +  7] );
+        P( A, B, C, D, E, F, G, H, R16( 8), K[i +  8] );
+        P( H, A, B, C, D, E, F, G, R16( 9), K[i +  9] );
+        P( G, H, A, B, C, D, E, F, R16(10), K[i + 10] );
+        P( F, G, H, A, B, C, D, E, R16(11), K[i + 11] );
+        P( E, F, G, H, A, B, C, D, R16(12), K[i + 12] );
+        P( D, E, F, G, H, A, B, C, R16(13), K[i + 13] );
+        P( C, D, E, F, G, H, A, B, R16(14), K[i + 14] );
+        P( B, C, D, E, F, G, H, A, R16(15), K[i + 15] );
+    }
+#endif /* BSCOMPTLS_SHA512_SMALLER */
 
     ctx->state[0] += A;
     ctx->state[1] += B;
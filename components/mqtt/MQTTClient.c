@@ -13,14 +13,17 @@
  * Contributors:
  *    Allan Stockdill-Mander/Ian Craggs - initial API and implementation and/or initial documentation
  *******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
 #include "MQTTClient.h"
 #include "sdk_kernel_def.h"
 #include "mkernel_internal_error.h"
 
-static void NewMessageData(MessageData *md, MQTTString *aTopicName, MQTTMessage *aMessage)
+static void NewMessageData(MessageData *md, MQTTString *aTopicName, MQTTMessage *aMessage, MQTTTopicLevels *aTopicLevels)
 {
     md->topicName = aTopicName;
     md->message = aMessage;
+    md->topicLevels = aTopicLevels;
 }
 
 static int getNextPacketId(MQTTClient *c)
@@ -54,13 +57,9 @@ static int sendPacket(MQTTClient *c, int length, Timer *timer)
 void MQTTClientInit(MQTTClient *c, Network *network, unsigned int command_timeout_ms,
                     unsigned char *sendbuf, size_t sendbuf_size, unsigned char *readbuf, size_t readbuf_size)
 {
-    int i;
     c->ipstack = network;
 
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-    {
-        memset(c->messageHandlers[i].topicFilter , 0, 512);
-    }
+    MQTTTopicIndex_init(&c->topicIndex);
     c->command_timeout_ms = command_timeout_ms;
     c->buf = sendbuf;
     c->buf_size = sendbuf_size;
@@ -70,17 +69,113 @@ void MQTTClientInit(MQTTClient *c, Network *network, unsigned int command_timeou
     c->ping_outstanding = 0;
     c->defaultMessageHandler = NULL;
     c->next_packetid = 1;
+    c->growable = 0;
+    c->buf_init = 0;
+    c->buf_max = sendbuf_size;
+    c->readbuf_init = 0;
+    c->readbuf_max = readbuf_size;
+    c->shrink_ms = 0;
+    c->suback_id = 0;
+    c->suback_count = 0;
+    c->suback_state = MQTT_SUBACK_NONE;
     TimerInit(&c->ping_timer);
     TimerInit(&c->connect_timer);
+    TimerInit(&c->shrink_timer);
 #if defined(MQTT_TASK)
     MutexInit(&c->mutex);
 #endif
 }
 
+int MQTTClientInitGrowable(MQTTClient *c, Network *network, unsigned int command_timeout_ms,
+                           size_t sendbuf_size, size_t sendbuf_max, size_t readbuf_size, size_t readbuf_max, unsigned int shrink_ms)
+{
+    MQTTClientInit(c, network, command_timeout_ms, NULL, 0, NULL, 0);
+    c->growable = 1;
+    c->buf_init = sendbuf_size;
+    c->buf_max = sendbuf_max;
+    c->readbuf_init = readbuf_size;
+    c->readbuf_max = readbuf_max;
+    c->shrink_ms = shrink_ms;
+    TimerCountdownMS(&c->shrink_timer, shrink_ms);
+
+    c->buf = (unsigned char *)malloc(sendbuf_size);
+    c->readbuf = (unsigned char *)malloc(readbuf_size);
+    if (c->buf == NULL || c->readbuf == NULL)
+    {
+        free(c->buf);
+        free(c->readbuf);
+        c->buf = NULL;
+        c->readbuf = NULL;
+        return FAILURE;
+    }
+    c->buf_size = sendbuf_size;
+    c->readbuf_size = readbuf_size;
+    return SUCCESS;
+}
+
 void MQTTClientFini(MQTTClient *c)
 {
+    MQTTTopicIndex_fini(&c->topicIndex);
     TimerFini(&c->ping_timer);
     TimerFini(&c->connect_timer);
+    TimerFini(&c->shrink_timer);
+    if (c->growable)
+    {
+        free(c->buf);
+        free(c->readbuf);
+        c->buf = NULL;
+        c->readbuf = NULL;
+        c->buf_size = 0;
+        c->readbuf_size = 0;
+    }
+}
+
+/* make sure *buf can hold need bytes. Growable buffers double from their current size up to max,
+   keeping the content (readPacket has already stored the fixed header); fixed buffers only check. */
+static int MQTTClientReserve(MQTTClient *c, unsigned char **buf, size_t *size, size_t init, size_t max, size_t need)
+{
+    size_t new_size = *size > 0 ? *size : init;
+    unsigned char *new_buf = NULL;
+
+    if (c->growable && need > init)
+        TimerCountdownMS(&c->shrink_timer, c->shrink_ms); /* large packets keep the buffers big for a while */
+
+    if (need <= *size)
+        return SUCCESS;
+    if (!c->growable || need > max)
+        return FAILURE;
+
+    if (new_size == 0)
+        new_size = need;
+    while (new_size < need)
+        new_size = (new_size > max / 2) ? max : new_size * 2;
+
+    new_buf = (unsigned char *)realloc(*buf, new_size);
+    if (new_buf == NULL)
+        return FAILURE;
+    *buf = new_buf;
+    *size = new_size;
+    return SUCCESS;
+}
+
+/* give grown buffers back once no large packet has been seen for shrink_ms */
+static void MQTTClientShrink(MQTTClient *c)
+{
+    unsigned char *new_buf = NULL;
+
+    if (!c->growable || !TimerIsExpired(&c->shrink_timer))
+        return;
+
+    if (c->buf_size > c->buf_init && (new_buf = (unsigned char *)realloc(c->buf, c->buf_init)) != NULL)
+    {
+        c->buf = new_buf;
+        c->buf_size = c->buf_init;
+    }
+    if (c->readbuf_size > c->readbuf_init && (new_buf = (unsigned char *)realloc(c->readbuf, c->readbuf_init)) != NULL)
+    {
+        c->readbuf = new_buf;
+        c->readbuf_size = c->readbuf_init;
+    }
 }
 
 static int decodePacket(MQTTClient *c, int *value, int timeout)
@@ -117,6 +212,9 @@ static int readPacket(MQTTClient *c, Timer *timer)
     int len = 0;
     int rem_len = 0;
 
+    if (c->readbuf == NULL)
+        goto exit;
+
     /* 1. read the header byte.  This has the packet type in it */
     if (c->ipstack->mqttread(c->ipstack, c->readbuf, 1, TimerLeftMS(timer)) != 1)
         goto exit;
@@ -126,7 +224,7 @@ static int readPacket(MQTTClient *c, Timer *timer)
     decodePacket(c, &rem_len, TimerLeftMS(timer));
     len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
 
-    if (rem_len + len > c->readbuf_size)
+    if (MQTTClientReserve(c, &c->readbuf, &c->readbuf_size, c->readbuf_init, c->readbuf_max, rem_len + len) != SUCCESS)
     {
         ezdev_sdk_kernel_log_error(mkernel_internal_net_socket_error, 0, "rev packet size range, rem_len = %d, buf size = %d\n", rem_len, c->readbuf_size);
         MQTTNetSetLastError(mkernel_internal_net_socket_error);
@@ -152,64 +250,29 @@ exit:
 // assume topic filter and name is in correct format
 // # can only be at end
 // + and # can only be next to separator
-static char isTopicMatched(char *topicFilter, MQTTString *topicName)
-{
-    char *curf = topicFilter;
-    char *curn = topicName->lenstring.data;
-    char *curn_end = curn + topicName->lenstring.len;
-
-    if (NULL == curf || NULL == curn)
-    {
-        ezdev_sdk_kernel_log_error(0, 0, "nonono!!!!!, curf:%08x, curn:%08x", curf, curn);
-        return 0;
-    }
-
-    while (*curf && curn < curn_end)
-    {
-        if (*curn == '/' && *curf != '/')
-            break;
-        if (*curf != '+' && *curf != '#' && *curf != *curn)
-            break;
-        if (*curf == '+')
-        { // skip until we meet the next separator, or end of string
-            char *nextpos = curn + 1;
-            while (nextpos < curn_end && *nextpos != '/')
-                nextpos = ++curn + 1;
-        }
-        else if (*curf == '#')
-            curn = curn_end - 1; // skip until end of string
-        curf++;
-        curn++;
-    };
-
-    return (curn == curn_end) && (*curf == '\0');
-}
-
 int deliverMessage(MQTTClient *c, MQTTString *topicName, MQTTMessage *message)
 {
     int i;
+    int count;
     int rc = FAILURE;
-
-    // we have to find the right message handler - indexed by topic
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    MessageData md;
+    MQTTTopicLevels levels;
+    MQTTTopicHandler handlers[MQTT_TOPIC_MAX_MATCHES];
+
+    // we have to find the right message handler - indexed by topic, the topic is split only once
+    count = MQTTTopicIndex_match(&c->topicIndex, topicName, &levels, handlers);
+    NewMessageData(&md, topicName, message, &levels);
+    for (i = 0; i < count; ++i)
     {
-        if (strlen(c->messageHandlers[i].topicFilter) > 0 && (MQTTPacket_equals(topicName, (char *)c->messageHandlers[i].topicFilter) ||
-                                                       isTopicMatched((char *)c->messageHandlers[i].topicFilter, topicName)))
+        if (handlers[i] != NULL)
         {
-            if (c->messageHandlers[i].fp != NULL)
-            {
-                MessageData md;
-                NewMessageData(&md, topicName, message);
-                c->messageHandlers[i].fp(&md);
-                rc = SUCCESS;
-            }
+            handlers[i](&md);
+            rc = SUCCESS;
         }
     }
 
     if (rc == FAILURE && c->defaultMessageHandler != NULL)
     {
-        MessageData md;
-        NewMessageData(&md, topicName, message);
         c->defaultMessageHandler(&md);
         rc = SUCCESS;
     }
@@ -272,7 +335,24 @@ int cycle(MQTTClient *c, Timer *timer)
     {
     case CONNACK:
     case PUBACK:
+        break;
     case SUBACK:
+        if (c->suback_state == MQTT_SUBACK_PENDING)
+        {
+            int count = 0, i;
+            int grantedQoSs[MQTT_SUBSCRIBE_MAX_FILTERS];
+            unsigned short mypacketid;
+            if (MQTTDeserialize_suback(&mypacketid, MQTT_SUBSCRIBE_MAX_FILTERS, &count, grantedQoSs, c->readbuf, c->readbuf_size) == 1 &&
+                mypacketid == c->suback_id)
+            {
+                c->suback_state = (count == c->suback_count) ? MQTT_SUBACK_GRANTED : MQTT_SUBACK_REFUSED;
+                for (i = 0; i < count; ++i)
+                {
+                    if ((grantedQoSs[i] & 0xFF) == 0x80) /* read back as a signed char */
+                        c->suback_state = MQTT_SUBACK_REFUSED;
+                }
+            }
+        }
         break;
     case PUBLISH:
     {
@@ -321,6 +401,7 @@ int cycle(MQTTClient *c, Timer *timer)
     }
 
     keepalive(c);
+    MQTTClientShrink(c);
 exit:
     if (rc == SUCCESS)
         rc = packet_type;
@@ -402,12 +483,55 @@ int waitfor(MQTTClient *c, int packet_type, Timer *timer)
     return rc;
 }
 
+/* write one SUBSCRIBE carrying every filter at c->buf + offset, behind a CONNECT that may already be there */
+static int serializeSubscribe(MQTTClient *c, int offset, MQTTSubscribeOptions *subs)
+{
+    MQTTString topics[MQTT_SUBSCRIBE_MAX_FILTERS];
+    int qos[MQTT_SUBSCRIBE_MAX_FILTERS];
+    int i, len;
+
+    for (i = 0; i < subs->count; ++i)
+    {
+        topics[i].cstring = (char *)subs->topicFilters[i];
+        topics[i].lenstring.len = 0;
+        topics[i].lenstring.data = NULL;
+        qos[i] = subs->qos[i];
+    }
+
+    len = offset + MQTTPacket_len(MQTTSerialize_subscribeLength(subs->count, topics));
+    if (MQTTClientReserve(c, &c->buf, &c->buf_size, c->buf_init, c->buf_max, len) != SUCCESS)
+        return FAILURE;
+
+    c->suback_id = getNextPacketId(c);
+    if ((len = MQTTSerialize_subscribe(c->buf + offset, c->buf_size - offset, 0, c->suback_id, subs->count, topics, qos)) <= 0)
+        return FAILURE;
+
+    c->suback_count = subs->count;
+    c->suback_state = MQTT_SUBACK_PENDING;
+    return len;
+}
+
 int MQTTConnect(MQTTClient *c, MQTTPacket_connectData *options)
+{
+    return MQTTConnectSubscribe(c, options, NULL, NULL);
+}
+
+int MQTTConnectSubscribe(MQTTClient *c, MQTTPacket_connectData *options, MQTTSubscribeOptions *subs, unsigned char *sessionPresent)
+{
+    return MQTTConnectSubscribeFrame(c, options, NULL, 0, subs, sessionPresent);
+}
+
+int MQTTConnectSubscribeFrame(MQTTClient *c, MQTTPacket_connectData *options, const unsigned char *connectFrame, int connectLen,
+                              MQTTSubscribeOptions *subs, unsigned char *sessionPresent)
 {
     Timer connect_timer;
     int rc = FAILURE;
     MQTTPacket_connectData default_options = MQTTPacket_connectData_initializer;
     int len = 0;
+    int sublen = 0;
+    int i = 0;
+    int subscribed = 0;
+    unsigned char present = 0;
 #if defined(MQTT_TASK)
     MutexLock(&c->mutex);
 #endif
@@ -420,11 +544,48 @@ int MQTTConnect(MQTTClient *c, MQTTPacket_connectData *options)
     if (options == 0)
         options = &default_options; /* set default options if none were supplied */
 
+    if (subs != NULL && (subs->count <= 0 || subs->count > MQTT_SUBSCRIBE_MAX_FILTERS))
+        goto exit;
+
+    /* growable buffers whose first allocation failed get another chance here; the will message can exceed the initial size */
+    if (connectFrame != NULL && connectLen <= 0)
+        goto exit;
+    if (MQTTClientReserve(c, &c->buf, &c->buf_size, c->buf_init, c->buf_max,
+                          connectFrame != NULL ? connectLen : MQTTPacket_len(MQTTSerialize_connectLength(options))) != SUCCESS ||
+        MQTTClientReserve(c, &c->readbuf, &c->readbuf_size, c->readbuf_init, c->readbuf_max, c->readbuf_init) != SUCCESS)
+        goto exit;
+
     c->keepAliveInterval = options->keepAliveInterval;
     TimerCountdown(&c->ping_timer, c->keepAliveInterval);
     TimerCountdown(&c->connect_timer, 0);
-    if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
+    if (connectFrame != NULL)
+    {
+        /* serialized earlier by the caller from the same options; only copied here */
+        memcpy(c->buf, connectFrame, connectLen);
+        len = connectLen;
+    }
+    else if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
         goto exit;
+
+    if (subs != NULL)
+    {
+        /* handlers first: a persistent session may deliver queued messages right behind the CONNACK */
+        for (i = 0; i < subs->count; ++i)
+        {
+            if (MQTTTopicIndex_add(&c->topicIndex, subs->topicFilters[i], subs->handlers[i]) != SUCCESS)
+                goto exit;
+        }
+
+        /* a clean session is never present, so the SUBSCRIBE rides in the same flight as the CONNECT */
+        if (!subs->reuseSession || options->cleansession)
+        {
+            if ((sublen = serializeSubscribe(c, len, subs)) <= 0)
+                goto exit;
+            len += sublen;
+            subscribed = 1;
+        }
+    }
+
     if ((rc = sendPacket(c, len, &connect_timer)) != SUCCESS) // send the connect packet
         goto exit;                                            // there was a problem
 
@@ -432,8 +593,7 @@ int MQTTConnect(MQTTClient *c, MQTTPacket_connectData *options)
     if (waitfor(c, CONNACK, &connect_timer) == CONNACK)
     {
         unsigned char connack_rc = 255;
-        unsigned char sessionPresent = 0;
-        if (MQTTDeserialize_connack(&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) == 1)
+        if (MQTTDeserialize_connack(&present, &connack_rc, c->readbuf, c->readbuf_size) == 1)
             rc = connack_rc;
         else
             rc = FAILURE;
@@ -441,6 +601,18 @@ int MQTTConnect(MQTTClient *c, MQTTPacket_connectData *options)
     else
         rc = FAILURE;
 
+    /* the broker lost the session: subscribe now, the SUBACK is not waited for */
+    if (rc == SUCCESS && subs != NULL && !subscribed && !present)
+    {
+        if ((len = serializeSubscribe(c, 0, subs)) <= 0)
+            rc = FAILURE;
+        else
+            rc = sendPacket(c, len, &connect_timer);
+    }
+
+    if (sessionPresent != NULL)
+        *sessionPresent = present;
+
 exit:
     if (rc == SUCCESS)
         c->isconnected = 1;
@@ -482,25 +654,7 @@ int MQTTSubscribe(MQTTClient *c, const char *topicFilter, enum QoS qos, messageH
         if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) == 1)
             rc = grantedQoS; // 0, 1, 2 or 0x80
         if (rc != 0x80)
-        {
-            int i;
-            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-            {
-                if (strlen(c->messageHandlers[i].topicFilter) > 0 && strcmp(topicFilter, c->messageHandlers[i].topicFilter) == 0)
-                {
-                    rc = 0;
-                    break;
-                }
-
-                if (strlen(c->messageHandlers[i].topicFilter) == 0)
-                {
-                    sprintf(c->messageHandlers[i].topicFilter, "%s", topicFilter);
-                    c->messageHandlers[i].fp = messageHandler;
-                    rc = 0;
-                    break;
-                }
-            }
-        }
+            rc = MQTTTopicIndex_add(&c->topicIndex, topicFilter, messageHandler);
     }
     else
         rc = FAILURE;
@@ -539,7 +693,10 @@ int MQTTUnsubscribe(MQTTClient *c, const char *topicFilter)
     {
         unsigned short mypacketid; // should be the same as the packetid above
         if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) == 1)
+        {
+            MQTTTopicIndex_remove(&c->topicIndex, topicFilter);
             rc = 0;
+        }
     }
     else
         rc = FAILURE;
@@ -573,6 +730,10 @@ int MQTTPublish(MQTTClient *c, const char *topicName, MQTTMessage *message)
     if (message->qos == QOS1 || message->qos == QOS2)
         message->id = getNextPacketId(c);
 
+    if (MQTTClientReserve(c, &c->buf, &c->buf_size, c->buf_init, c->buf_max,
+                          MQTTPacket_len(MQTTSerialize_publishLength(message->qos, topic, message->payloadlen))) != SUCCESS)
+        goto exit;
+
     len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
                                 topic, (unsigned char *)message->payload, message->payloadlen);
 
@@ -35,6 +35,7 @@
 
 #include "MQTTNet.h"
 #include "MQTTPacket.h"
+#include "MQTTTopicIndex.h"
 #include <stdio.h>
 
 #if defined(MQTTCLIENT_PLATFORM_HEADER)
@@ -48,9 +49,6 @@
 
 #define MAX_PACKET_ID 65535 /* according to the MQTT specification - do not change! */
 
-#if !defined(MAX_MESSAGE_HANDLERS)
-#define MAX_MESSAGE_HANDLERS 5 /* redefinable - how many subscriptions do you want? */
-#endif
 
 enum QoS { QOS0, QOS1, QOS2 };
 
@@ -89,10 +87,25 @@ typedef struct MessageData
 {
     MQTTMessage* message;
     MQTTString* topicName;
+    MQTTTopicLevels* topicLevels;   /* topic split on '/' while matching subscriptions, NULL if not available */
 } MessageData;
 
 typedef void (*messageHandler)(MessageData*);
 
+#define MQTT_SUBSCRIBE_MAX_FILTERS 4
+
+/* state of the SUBSCRIBE sent by MQTTConnectSubscribe; its SUBACK is handled in the background by MQTTYield */
+enum MQTTSubackState { MQTT_SUBACK_NONE, MQTT_SUBACK_PENDING, MQTT_SUBACK_GRANTED, MQTT_SUBACK_REFUSED };
+
+typedef struct MQTTSubscribeOptions
+{
+    int count;
+    const char* topicFilters[MQTT_SUBSCRIBE_MAX_FILTERS];
+    enum QoS qos[MQTT_SUBSCRIBE_MAX_FILTERS];
+    messageHandler handlers[MQTT_SUBSCRIBE_MAX_FILTERS];
+    int reuseSession;   /* with cleansession = 0, skip the SUBSCRIBE when the broker reports sessionPresent */
+} MQTTSubscribeOptions;
+
 typedef struct MQTTClient
 {
     unsigned int next_packetid,
@@ -105,17 +118,26 @@ typedef struct MQTTClient
     char ping_outstanding;
     int isconnected;
 
-    struct MessageHandlers
-    {
-        char topicFilter[512];
-        void (*fp) (MessageData*);
-    } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription topic */
+    MQTTTopicIndex topicIndex;      /* Message handlers are indexed by subscription topic */
 
     void (*defaultMessageHandler) (MessageData*);
 
     Network* ipstack;
     Timer ping_timer;
 	Timer connect_timer;
+
+    /* growable buffers: start at *_init, double up to *_max on demand, shrink back after shrink_ms without large packets */
+    int growable;
+    size_t buf_init,
+      buf_max,
+      readbuf_init,
+      readbuf_max;
+    unsigned int shrink_ms;
+    Timer shrink_timer;
+
+    unsigned short suback_id;
+    int suback_count;
+    enum MQTTSubackState suback_state;
 #if defined(MQTT_TASK)
 	Mutex mutex;
 	Thread thread;
@@ -136,6 +158,16 @@ DLLExport void MQTTClientFini(MQTTClient* c);
 DLLExport void MQTTClientInit(MQTTClient* client, Network* network, unsigned int command_timeout_ms,
 		unsigned char* sendbuf, size_t sendbuf_size, unsigned char* readbuf, size_t readbuf_size);
 
+/**
+ * Create an MQTT client object whose buffers are allocated from the heap.
+ * They start at sendbuf_size/readbuf_size, grow geometrically up to sendbuf_max/readbuf_max
+ * when a publish or an incoming packet needs more room, and shrink back once no large
+ * packet has been seen for shrink_ms. The buffers are freed by MQTTClientFini.
+ * @return SUCCESS, or FAILURE if the initial buffers could not be allocated (they are retried on MQTTConnect)
+ */
+DLLExport int MQTTClientInitGrowable(MQTTClient* client, Network* network, unsigned int command_timeout_ms,
+		size_t sendbuf_size, size_t sendbuf_max, size_t readbuf_size, size_t readbuf_max, unsigned int shrink_ms);
+
 /** MQTT Connect - send an MQTT connect packet down the network and wait for a Connack
  *  The nework object must be connected to the network endpoint before calling this
  *  @param options - connect options
@@ -144,6 +176,27 @@ DLLExport void MQTTClientInit(MQTTClient* client, Network* network, unsigned int
 
 DLLExport int MQTTConnect(MQTTClient* client, MQTTPacket_connectData* options);
 
+/** MQTT Connect and Subscribe - set up a session with as few round trips as possible.
+ *  The message handlers are registered before the CONNECT goes out. The SUBSCRIBE (all filters
+ *  in one packet) is written in the same flight as the CONNECT, unless subs->reuseSession is set
+ *  on a persistent session: then it is only sent after a CONNACK without sessionPresent.
+ *  Returns as soon as the CONNACK arrives, so publishing can start right away; the SUBACK
+ *  is picked up by MQTTYield and reported through client->suback_state.
+ *  @param subs - the subscriptions, may be NULL
+ *  @param sessionPresent - returns the session present flag of the CONNACK, may be NULL
+ *  @return success code, or the CONNACK return code
+ */
+DLLExport int MQTTConnectSubscribe(MQTTClient* client, MQTTPacket_connectData* options, MQTTSubscribeOptions* subs, unsigned char* sessionPresent);
+
+/** MQTT Connect and Subscribe with a CONNECT packet the caller serialized beforehand from options
+ *  (MQTTSerialize_connect), so that reconnecting with unchanged options skips the serialization.
+ *  options must still be given: the keep alive interval and the clean session flag are taken from it.
+ *  @param connectFrame - the serialized CONNECT packet, NULL to serialize options as MQTTConnectSubscribe does
+ *  @param connectLen - length of connectFrame
+ */
+DLLExport int MQTTConnectSubscribeFrame(MQTTClient* client, MQTTPacket_connectData* options, const unsigned char* connectFrame, int connectLen,
+                                        MQTTSubscribeOptions* subs, unsigned char* sessionPresent);
+
 /** MQTT Publish - send an MQTT publish packet and wait for all acks to complete for all QoSs
  *  @param client - the client object to use
  *  @param topic - the topic to publish to
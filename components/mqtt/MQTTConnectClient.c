@@ -143,7 +143,7 @@ int MQTTDeserialize_connack(unsigned char* sessionPresent, unsigned char* connac
 	if (header.bits.type != CONNACK)
 		goto exit;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length, rc stays 0 until the packet is complete */
 	enddata = curdata + mylen;
 	if (enddata - curdata < 2)
 		goto exit;
@@ -50,7 +50,7 @@ int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retaine
 	*qos = header.bits.qos;
 	*retained = header.bits.retain;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length, rc stays 0 until the packet is complete */
 	enddata = curdata + mylen;
 
 	if (!readMQTTLenString(topicName, &curdata, enddata) ||
@@ -58,7 +58,11 @@ int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retaine
 		goto exit;
 
 	if (*qos > 0)
+	{
+		if (enddata - curdata < 2)
+			goto exit;
 		*packetid = readInt(&curdata);
+	}
 
 	*payloadlen = enddata - curdata;
 	*payload = curdata;
@@ -92,7 +96,7 @@ int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned
 	*dup = header.bits.dup;
 	*packettype = header.bits.type;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length, rc stays 0 until the packet is complete */
 	enddata = curdata + mylen;
 
 	if (enddata - curdata < 2)
@@ -1,6 +1,8 @@
 #include "MQTTNet.h"
 #include "sdk_kernel_def.h"
 
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+
 
 extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
 extern char g_binding_nic[ezdev_sdk_name_len];
@@ -116,60 +118,35 @@ void MQTTNetFini( Network* network)
 
 void TimerInit( Timer* assign_timer )
 {
-	assign_timer->end_time = g_ezdev_sdk_kernel.platform_handle.time_creator();
+	kernel_timer_init(&assign_timer->node, NULL);
 }
 
 char TimerIsExpiredByDiff(Timer* assign_timer, unsigned int time_ms)
 {
-	if (assign_timer->end_time == NULL)
-	{
-		return 0;
-	}
-	return g_ezdev_sdk_kernel.platform_handle.time_isexpired_bydiff(assign_timer->end_time, time_ms);
+	return kernel_timer_expired_bydiff(&assign_timer->node, time_ms);
 }
 
 char TimerIsExpired( Timer* assign_timer )
 {
-	if (assign_timer->end_time == NULL)
-	{
-		return 0;
-	}
-	return g_ezdev_sdk_kernel.platform_handle.time_isexpired(assign_timer->end_time);
+	return kernel_timer_expired(&assign_timer->node);
 }
 
 void TimerCountdownMS( Timer* assign_timer, unsigned int time_count )
 {
-	if (assign_timer->end_time == NULL)
-	{
-		return;
-	}
-	g_ezdev_sdk_kernel.platform_handle.time_countdownms(assign_timer->end_time, time_count);
+	kernel_timer_start(&assign_timer->node, time_count);
 }
 
 void TimerCountdown( Timer* assign_timer, unsigned int time_count )
 {
-	if (assign_timer->end_time == NULL)
-	{
-		return;
-	}
-	g_ezdev_sdk_kernel.platform_handle.time_countdown(assign_timer->end_time, time_count);
+	kernel_timer_start(&assign_timer->node, time_count * 1000);
 }
 
 int TimerLeftMS( Timer* assign_timer )
 {
-	if (assign_timer->end_time == NULL)
-	{
-		return 0;
-	}
-	return g_ezdev_sdk_kernel.platform_handle.time_leftms(assign_timer->end_time);
+	return kernel_timer_left_ms(&assign_timer->node);
 }
 
 void TimerFini( Timer* assign_timer )
-{	
-	if (assign_timer->end_time == NULL)
-	{
-		return;
-	}
-	g_ezdev_sdk_kernel.platform_handle.time_destroy(assign_timer->end_time);
-	assign_timer->end_time = NULL;
+{
+	kernel_timer_stop(&assign_timer->node);
 }
\ No newline at end of file
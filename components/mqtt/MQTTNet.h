@@ -3,6 +3,7 @@
 
 #include "ezdev_sdk_kernel_struct.h"
 #include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_timer.h"
 
 typedef struct MQTTNetwork
 {
@@ -21,7 +22,7 @@ void MQTTNetSetLastError(mkernel_internal_error code);
 
 typedef struct Timer
 {
-	ezdev_sdk_time end_time;
+	kernel_timer node;
 } Timer;
 
 void TimerInit(Timer* assign_timer);
@@ -31,6 +31,8 @@ DLLExport int MQTTSerialize_publish(unsigned char* buf, int buflen, unsigned cha
 DLLExport int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
 		unsigned char** payload, int* payloadlen, unsigned char* buf, int len);
 
+DLLExport int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen);
+
 DLLExport int MQTTSerialize_puback(unsigned char* buf, int buflen, unsigned short packetid);
 DLLExport int MQTTSerialize_pubrel(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid);
 DLLExport int MQTTSerialize_pubcomp(unsigned char* buf, int buflen, unsigned short packetid);
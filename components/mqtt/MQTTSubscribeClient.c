@@ -110,7 +110,7 @@ int MQTTDeserialize_suback(unsigned short* packetid, int maxcount, int* count, i
 	if (header.bits.type != SUBACK)
 		goto exit;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length, rc stays 0 until the packet is complete */
 	enddata = curdata + mylen;
 	if (enddata - curdata < 2)
 		goto exit;
@@ -120,7 +120,7 @@ int MQTTDeserialize_suback(unsigned short* packetid, int maxcount, int* count, i
 	*count = 0;
 	while (curdata < enddata)
 	{
-		if (*count > maxcount)
+		if (*count >= maxcount) /* grantedQoSs holds maxcount entries */
 		{
 			rc = -1;
 			goto exit;
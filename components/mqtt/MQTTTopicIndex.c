@@ -0,0 +1,322 @@
+#include "MQTTTopicIndex.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum { TOPIC_INDEX_SUCCESS = 0, TOPIC_INDEX_FAILURE = -1 };
+
+static unsigned int topic_hash(const char* data, int len)
+{
+	/* FNV-1a */
+	unsigned int hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void topic_data(MQTTString* topicName, const char** data, int* len)
+{
+	if (topicName->cstring)
+	{
+		*data = topicName->cstring;
+		*len = strlen(topicName->cstring);
+	}
+	else
+	{
+		*data = topicName->lenstring.data;
+		*len = topicName->lenstring.len;
+	}
+}
+
+static int split_levels(const char* data, int len, MQTTTopicLevels* levels)
+{
+	const char* cur = data;
+	const char* end = data + len;
+	const char* sep = NULL;
+
+	levels->count = 0;
+	while (levels->count < MQTT_TOPIC_MAX_LEVELS)
+	{
+		sep = (levels->count == MQTT_TOPIC_MAX_LEVELS - 1) ? NULL : memchr(cur, '/', end - cur);
+		levels->level[levels->count].data = cur;
+		levels->level[levels->count].len = (sep ? sep : end) - cur;
+		levels->count++;
+		if (sep == NULL)
+			break;
+		cur = sep + 1;
+	}
+	return levels->count;
+}
+
+static MQTTTopicNode* node_find(MQTTTopicNode* first, const char* level, int level_len)
+{
+	MQTTTopicNode* node = first;
+
+	for (; node != NULL; node = node->sibling)
+	{
+		if (node->level_len == level_len && memcmp(node->level, level, level_len) == 0)
+			break;
+	}
+	return node;
+}
+
+static MQTTTopicNode* node_create(const char* level, int level_len)
+{
+	MQTTTopicNode* node = (MQTTTopicNode*)malloc(sizeof(MQTTTopicNode));
+	if (node == NULL)
+		return NULL;
+
+	memset(node, 0, sizeof(MQTTTopicNode));
+	node->level = (char*)malloc(level_len + 1);
+	if (node->level == NULL)
+	{
+		free(node);
+		return NULL;
+	}
+	memcpy(node->level, level, level_len);
+	node->level[level_len] = '\0';
+	node->level_len = level_len;
+	return node;
+}
+
+static void node_destroy(MQTTTopicNode* node)
+{
+	MQTTTopicNode* next = NULL;
+
+	while (node != NULL)
+	{
+		next = node->sibling;
+		node_destroy(node->child);
+		node_destroy(node->plus);
+		free(node->level);
+		free(node);
+		node = next;
+	}
+}
+
+/* 按订阅逐级走到末级节点, create为1时补齐缺失的节点; is_multi返回订阅是否以"#"结尾 */
+static MQTTTopicNode* node_walk(MQTTTopicIndex* index, const char* filter, int filter_len, int create, int* is_multi)
+{
+	MQTTTopicLevels levels;
+	MQTTTopicNode* node = &index->root;
+	MQTTTopicNode* next = NULL;
+	int i;
+
+	*is_multi = 0;
+	split_levels(filter, filter_len, &levels);
+	for (i = 0; i < levels.count && node != NULL; i++)
+	{
+		const char* level = levels.level[i].data;
+		int level_len = levels.level[i].len;
+
+		if (level_len == 1 && level[0] == '#')
+		{
+			if (i != levels.count - 1)
+				return NULL;
+			*is_multi = 1;
+			break;
+		}
+
+		if (level_len == 1 && level[0] == '+')
+		{
+			if (node->plus == NULL && create)
+				node->plus = node_create(level, level_len);
+			node = node->plus;
+			continue;
+		}
+
+		if (memchr(level, '+', level_len) || memchr(level, '#', level_len))
+			return NULL;
+
+		next = node_find(node->child, level, level_len);
+		if (next == NULL && create)
+		{
+			next = node_create(level, level_len);
+			if (next != NULL)
+			{
+				next->sibling = node->child;
+				node->child = next;
+			}
+		}
+		node = next;
+	}
+	return node;
+}
+
+static int node_match(MQTTTopicNode* node, MQTTTopicLevels* levels, int depth, MQTTTopicHandler handlers[MQTT_TOPIC_MAX_MATCHES], int matched)
+{
+	MQTTTopicNode* child = NULL;
+
+	if (node->multi_fp != NULL && matched < MQTT_TOPIC_MAX_MATCHES)
+		handlers[matched++] = node->multi_fp;
+
+	if (depth == levels->count)
+	{
+		if (node->fp != NULL && matched < MQTT_TOPIC_MAX_MATCHES)
+			handlers[matched++] = node->fp;
+		return matched;
+	}
+
+	child = node_find(node->child, levels->level[depth].data, levels->level[depth].len);
+	if (child != NULL)
+		matched = node_match(child, levels, depth + 1, handlers, matched);
+	/* 最后一级可能带着超出级数的剩余部分, '+'只匹配一级 */
+	if (node->plus != NULL && (depth < MQTT_TOPIC_MAX_LEVELS - 1 || memchr(levels->level[depth].data, '/', levels->level[depth].len) == NULL))
+		matched = node_match(node->plus, levels, depth + 1, handlers, matched);
+
+	return matched;
+}
+
+void MQTTTopicIndex_init(MQTTTopicIndex* index)
+{
+	memset(index, 0, sizeof(MQTTTopicIndex));
+}
+
+void MQTTTopicIndex_fini(MQTTTopicIndex* index)
+{
+	MQTTTopicEntry* entry = NULL;
+	int i;
+
+	for (i = 0; i < MQTT_TOPIC_HASH_BUCKETS; i++)
+	{
+		while (index->exact[i] != NULL)
+		{
+			entry = index->exact[i];
+			index->exact[i] = entry->next;
+			free(entry->filter);
+			free(entry);
+		}
+	}
+	node_destroy(index->root.child);
+	node_destroy(index->root.plus);
+	memset(index, 0, sizeof(MQTTTopicIndex));
+}
+
+int MQTTTopicIndex_add(MQTTTopicIndex* index, const char* topicFilter, MQTTTopicHandler fp)
+{
+	int filter_len = strlen(topicFilter);
+	MQTTTopicEntry* entry = NULL;
+	MQTTTopicNode* node = NULL;
+	unsigned int hash = 0;
+	int is_multi = 0;
+
+	if (filter_len == 0)
+		return TOPIC_INDEX_FAILURE;
+
+	if (strpbrk(topicFilter, "+#") != NULL)
+	{
+		node = node_walk(index, topicFilter, filter_len, 1, &is_multi);
+		if (node == NULL)
+			return TOPIC_INDEX_FAILURE;
+		if ((is_multi ? node->multi_fp : node->fp) == NULL)
+			index->count++;
+		if (is_multi)
+			node->multi_fp = fp;
+		else
+			node->fp = fp;
+		return TOPIC_INDEX_SUCCESS;
+	}
+
+	hash = topic_hash(topicFilter, filter_len);
+	for (entry = index->exact[hash & (MQTT_TOPIC_HASH_BUCKETS - 1)]; entry != NULL; entry = entry->next)
+	{
+		if (entry->hash == hash && entry->filter_len == filter_len && memcmp(entry->filter, topicFilter, filter_len) == 0)
+		{
+			entry->fp = fp;
+			return TOPIC_INDEX_SUCCESS;
+		}
+	}
+
+	entry = (MQTTTopicEntry*)malloc(sizeof(MQTTTopicEntry));
+	if (entry == NULL)
+		return TOPIC_INDEX_FAILURE;
+	entry->filter = (char*)malloc(filter_len + 1);
+	if (entry->filter == NULL)
+	{
+		free(entry);
+		return TOPIC_INDEX_FAILURE;
+	}
+	memcpy(entry->filter, topicFilter, filter_len + 1);
+	entry->filter_len = filter_len;
+	entry->hash = hash;
+	entry->fp = fp;
+	entry->next = index->exact[hash & (MQTT_TOPIC_HASH_BUCKETS - 1)];
+	index->exact[hash & (MQTT_TOPIC_HASH_BUCKETS - 1)] = entry;
+	index->count++;
+	return TOPIC_INDEX_SUCCESS;
+}
+
+int MQTTTopicIndex_remove(MQTTTopicIndex* index, const char* topicFilter)
+{
+	int filter_len = strlen(topicFilter);
+	MQTTTopicEntry** link = NULL;
+	MQTTTopicEntry* entry = NULL;
+	MQTTTopicNode* node = NULL;
+	unsigned int hash = 0;
+	int is_multi = 0;
+
+	if (strpbrk(topicFilter, "+#") != NULL)
+	{
+		/* 节点保留到fini时释放, 订阅集合很小, 重复订阅会复用这些节点 */
+		node = node_walk(index, topicFilter, filter_len, 0, &is_multi);
+		if (node == NULL || (is_multi ? node->multi_fp : node->fp) == NULL)
+			return TOPIC_INDEX_FAILURE;
+		if (is_multi)
+			node->multi_fp = NULL;
+		else
+			node->fp = NULL;
+		index->count--;
+		return TOPIC_INDEX_SUCCESS;
+	}
+
+	hash = topic_hash(topicFilter, filter_len);
+	for (link = &index->exact[hash & (MQTT_TOPIC_HASH_BUCKETS - 1)]; *link != NULL; link = &(*link)->next)
+	{
+		entry = *link;
+		if (entry->hash == hash && entry->filter_len == filter_len && memcmp(entry->filter, topicFilter, filter_len) == 0)
+		{
+			*link = entry->next;
+			free(entry->filter);
+			free(entry);
+			index->count--;
+			return TOPIC_INDEX_SUCCESS;
+		}
+	}
+	return TOPIC_INDEX_FAILURE;
+}
+
+int MQTTTopicIndex_split(MQTTString* topicName, MQTTTopicLevels* levels)
+{
+	const char* data = NULL;
+	int len = 0;
+
+	topic_data(topicName, &data, &len);
+	return split_levels(data, len, levels);
+}
+
+int MQTTTopicIndex_match(MQTTTopicIndex* index, MQTTString* topicName, MQTTTopicLevels* levels, MQTTTopicHandler handlers[MQTT_TOPIC_MAX_MATCHES])
+{
+	MQTTTopicEntry* entry = NULL;
+	const char* data = NULL;
+	unsigned int hash = 0;
+	int matched = 0;
+	int len = 0;
+
+	topic_data(topicName, &data, &len);
+	split_levels(data, len, levels);
+	if (index->count == 0)
+		return 0;
+
+	hash = topic_hash(data, len);
+	for (entry = index->exact[hash & (MQTT_TOPIC_HASH_BUCKETS - 1)]; entry != NULL && matched < MQTT_TOPIC_MAX_MATCHES; entry = entry->next)
+	{
+		if (entry->hash == hash && entry->filter_len == len && memcmp(entry->filter, data, len) == 0)
+			handlers[matched++] = entry->fp;
+	}
+
+	return node_match(&index->root, levels, 0, handlers, matched);
+}
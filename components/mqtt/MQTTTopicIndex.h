@@ -0,0 +1,93 @@
+#ifndef H_MQTTTOPICINDEX_H_
+#define H_MQTTTOPICINDEX_H_
+
+#include "MQTTPacket.h"
+
+#if !defined(MQTT_TOPIC_MAX_LEVELS)
+#define MQTT_TOPIC_MAX_LEVELS 16	/* redefinable - deeper topics keep the remainder in the last level */
+#endif
+
+#if !defined(MQTT_TOPIC_HASH_BUCKETS)
+#define MQTT_TOPIC_HASH_BUCKETS 16	/* redefinable - buckets for filters without wildcards, must be a power of 2 */
+#endif
+
+#if !defined(MQTT_TOPIC_MAX_MATCHES)
+#define MQTT_TOPIC_MAX_MATCHES 8	/* redefinable - handlers delivered for one message */
+#endif
+
+struct MessageData;
+typedef void (*MQTTTopicHandler)(struct MessageData*);
+
+/**
+ * \brief topic按'/'切分后的各级, 指向原topic, 不以'\0'结尾
+ */
+typedef struct MQTTTopicLevels
+{
+	int count;
+	struct
+	{
+		const char* data;
+		int len;
+	} level[MQTT_TOPIC_MAX_LEVELS];
+} MQTTTopicLevels;
+
+/**
+ * \brief 含通配符的订阅按级建成的前缀树节点
+ */
+typedef struct MQTTTopicNode
+{
+	char* level;
+	int level_len;
+	struct MQTTTopicNode* sibling;		///< 同级的下一个字面量节点
+	struct MQTTTopicNode* child;		///< 下一级字面量节点链表
+	struct MQTTTopicNode* plus;		///< 下一级'+'节点
+	MQTTTopicHandler fp;				///< 订阅在此结束时的回调
+	MQTTTopicHandler multi_fp;		///< 订阅为"此级/#"时的回调
+} MQTTTopicNode;
+
+/**
+ * \brief 不含通配符的订阅, 按整个topic哈希
+ */
+typedef struct MQTTTopicEntry
+{
+	char* filter;
+	int filter_len;
+	unsigned int hash;
+	MQTTTopicHandler fp;
+	struct MQTTTopicEntry* next;
+} MQTTTopicEntry;
+
+typedef struct MQTTTopicIndex
+{
+	MQTTTopicEntry* exact[MQTT_TOPIC_HASH_BUCKETS];
+	MQTTTopicNode root;
+	int count;
+} MQTTTopicIndex;
+
+void MQTTTopicIndex_init(MQTTTopicIndex* index);
+void MQTTTopicIndex_fini(MQTTTopicIndex* index);
+
+/**
+ * \brief 添加订阅, 同一个订阅重复添加时替换回调
+ * \return SUCCESS(0) 或 FAILURE(-1)
+ */
+int MQTTTopicIndex_add(MQTTTopicIndex* index, const char* topicFilter, MQTTTopicHandler fp);
+
+/**
+ * \brief 删除订阅, 不存在时返回FAILURE
+ */
+int MQTTTopicIndex_remove(MQTTTopicIndex* index, const char* topicFilter);
+
+/**
+ * \brief 按'/'切分topic, 超过MQTT_TOPIC_MAX_LEVELS级时最后一级包含剩余部分
+ * \return 级数
+ */
+int MQTTTopicIndex_split(MQTTString* topicName, MQTTTopicLevels* levels);
+
+/**
+ * \brief 查找所有匹配topic的订阅回调, 同时输出切分好的topic
+ * \return 匹配的回调个数, 最多MQTT_TOPIC_MAX_MATCHES个
+ */
+int MQTTTopicIndex_match(MQTTTopicIndex* index, MQTTString* topicName, MQTTTopicLevels* levels, MQTTTopicHandler handlers[MQTT_TOPIC_MAX_MATCHES]);
+
+#endif
@@ -0,0 +1,462 @@
+/* ezxml_stream.c
+ *
+ * Incremental (SAX style) companion to ezxml, see ezxml_stream.h.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include "ezxml_stream.h"
+
+#define EZXML_STREAM_WS   "\t\r\n "  // whitespace
+#define EZXML_STREAM_ERRL 128        // maximum error string length
+#define EZXML_STREAM_ENTL 10         // longest reference name kept across chunks
+
+enum {
+    ST_TEXT,    // character content
+    ST_ENT,     // reference in character content, collecting up to ';'
+    ST_MARKUP,  // after '<', until the kind of markup is known
+    ST_TAG,     // start tag, collected up to '>'
+    ST_CLOSE,   // end tag, collected up to '>'
+    ST_COMMENT, // <!-- ... -->
+    ST_CDATA,   // <![CDATA[ ... ]]>
+    ST_PI,      // <? ... ?>
+    ST_DOCTYPE, // <!DOCTYPE ... >
+    ST_ERROR
+};
+
+struct ezxml_stream {
+    ezxml_stream_cb cb;
+    void *user;
+    int state;
+    char quote;           // open quote in a start tag or the DOCTYPE
+    int match;            // characters of the terminator seen so far
+    int cr;               // last content character was '\r'
+    int bracket;          // inside the DOCTYPE internal subset
+    int seen_root;        // root tag was opened
+    char *buf;            // tag being collected, null terminated
+    size_t len;
+    size_t max;
+    size_t token_max;
+    char *names;          // names of the open tags, each null terminated
+    size_t names_len;
+    size_t names_max;
+    size_t depth;
+    char ent[EZXML_STREAM_ENTL + 1];
+    size_t ent_len;
+    long line;
+    char err[EZXML_STREAM_ERRL]; // error string
+};
+
+// records an error, the parser refuses further input
+static int ezxml_stream_err(ezxml_stream_t st, const char *fmt, ...)
+{
+    char msg[EZXML_STREAM_ERRL];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    snprintf(st->err, EZXML_STREAM_ERRL, "[error near line %ld]: %.96s", st->line, msg);
+    st->state = ST_ERROR;
+    return -1;
+}
+
+// decodes a predefined entity or character reference (without '&' and ';')
+// into out, returns the number of bytes or 0 if it is not one
+static int ezxml_stream_ref(const char *ref, char out[4])
+{
+    static const char *ent[] = { "lt", "<", "gt", ">", "quot", "\"",
+                                 "apos", "'", "amp", "&", NULL };
+    char *e;
+    long c;
+    int i;
+
+    if (*ref == '#') {
+        if (ref[1] == 'x') c = strtol(ref + 2, &e, 16); // base 16
+        else c = strtol(ref + 1, &e, 10); // base 10
+        if (c <= 0 || c > 0x10FFFF || *e) return 0;
+
+        if (c < 0x80) { out[0] = (char)c; return 1; }
+        if (c < 0x800) {
+            out[0] = (char)(0xC0 | (c >> 6));
+            out[1] = (char)(0x80 | (c & 0x3F));
+            return 2;
+        }
+        if (c < 0x10000) {
+            out[0] = (char)(0xE0 | (c >> 12));
+            out[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+            out[2] = (char)(0x80 | (c & 0x3F));
+            return 3;
+        }
+        out[0] = (char)(0xF0 | (c >> 18));
+        out[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (c & 0x3F));
+        return 4;
+    }
+
+    for (i = 0; ent[i]; i += 2) {
+        if (! strcmp(ref, ent[i])) { out[0] = *ent[i + 1]; return 1; }
+    }
+    return 0;
+}
+
+// decodes an attribute value in place the way ezxml_decode() does with ' ',
+// returns the new length. Decoded references are never longer than written.
+static size_t ezxml_stream_decode(char *s)
+{
+    char *r = s, *w = s, *e, out[4];
+    int l;
+
+    while (*r) {
+        if (*r == '\r') { // \r\n and \r count as one new line
+            *(w++) = ' ';
+            r += (r[1] == '\n') ? 2 : 1;
+        }
+        else if (isspace((unsigned char)*r)) { *(w++) = ' '; r++; }
+        else if (*r == '&' && (e = strchr(r, ';')) && e - r - 1 <= EZXML_STREAM_ENTL) {
+            *e = '\0';
+            l = ezxml_stream_ref(r + 1, out);
+            *e = ';';
+            if (l) { memcpy(w, out, l); w += l; r = e + 1; }
+            else *(w++) = *(r++); // not a known reference
+        }
+        else *(w++) = *(r++);
+    }
+    *w = '\0';
+    return w - s;
+}
+
+// appends to the tag being collected
+static int ezxml_stream_put(ezxml_stream_t st, const char *s, size_t len)
+{
+    char *b;
+    size_t max;
+
+    if (st->len + len + 1 > st->token_max)
+        return ezxml_stream_err(st, "tag longer than %lu bytes", (unsigned long)st->token_max);
+
+    if (st->len + len + 1 > st->max) {
+        for (max = (st->max) ? st->max : 64; max < st->len + len + 1; max *= 2);
+        if (max > st->token_max) max = st->token_max;
+        if (! (b = realloc(st->buf, max))) return ezxml_stream_err(st, "out of memory");
+        st->buf = b;
+        st->max = max;
+    }
+
+    memcpy(st->buf + st->len, s, len);
+    st->buf[st->len += len] = '\0';
+    return 0;
+}
+
+// name of the innermost open tag, empty string outside of the root tag
+static const char *ezxml_stream_name(ezxml_stream_t st)
+{
+    const char *p;
+
+    if (! st->depth) return "";
+    for (p = st->names + st->names_len - 1; p > st->names && p[-1]; p--);
+    return p;
+}
+
+static int ezxml_stream_push(ezxml_stream_t st, const char *name)
+{
+    size_t len = strlen(name) + 1, max;
+    char *n;
+
+    if (st->names_len + len > st->names_max) {
+        for (max = (st->names_max) ? st->names_max : 64; max < st->names_len + len; max *= 2);
+        if (! (n = realloc(st->names, max))) return ezxml_stream_err(st, "out of memory");
+        st->names = n;
+        st->names_max = max;
+    }
+
+    memcpy(st->names + st->names_len, name, len);
+    st->names_len += len;
+    st->depth++;
+    return 0;
+}
+
+static int ezxml_stream_text(ezxml_stream_t st, const char *s, size_t len)
+{
+    if (! len || ! st->depth) return 0; // content outside of the root tag is ignored
+    if (st->cb(st->user, EZXML_STREAM_TEXT, ezxml_stream_name(st), s, len))
+        return ezxml_stream_err(st, "stopped by callback");
+    return 0;
+}
+
+// called with a complete start tag in buf
+static int ezxml_stream_open(ezxml_stream_t st)
+{
+    char *s = st->buf, *n, *v, q;
+    size_t l;
+    int self = 0;
+
+    if (st->len && st->buf[st->len - 1] == '/') { // self closing tag
+        st->buf[--st->len] = '\0';
+        self = 1;
+    }
+
+    if (st->seen_root && ! st->depth)
+        return ezxml_stream_err(st, "markup outside of root element");
+
+    s += strcspn(s, EZXML_STREAM_WS "/");
+    if (*s == '/') return ezxml_stream_err(st, "missing >");
+    if (*s) *(s++) = '\0'; // null terminate tag name
+
+    if (ezxml_stream_push(st, st->buf)) return -1;
+    st->seen_root = 1;
+    if (st->cb(st->user, EZXML_STREAM_START, st->buf, NULL, 0))
+        return ezxml_stream_err(st, "stopped by callback");
+
+    for (s += strspn(s, EZXML_STREAM_WS); *s; s += strspn(s, EZXML_STREAM_WS)) {
+        n = s; // attribute name
+        v = "";
+        l = 0;
+        s += strcspn(s, EZXML_STREAM_WS "=/");
+        if (*s == '/') return ezxml_stream_err(st, "missing >");
+        if (*s) {
+            *(s++) = '\0'; // null terminate attribute name
+            q = *(s += strspn(s, EZXML_STREAM_WS "="));
+            if (q == '"' || q == '\'') { // attribute value
+                v = ++s;
+                if (! (s = strchr(s, q))) return ezxml_stream_err(st, "missing %c", q);
+                *(s++) = '\0'; // null terminate attribute value
+                l = ezxml_stream_decode(v);
+            }
+        }
+        if (st->cb(st->user, EZXML_STREAM_ATTR, n, v, l))
+            return ezxml_stream_err(st, "stopped by callback");
+    }
+
+    if (self) {
+        if (st->cb(st->user, EZXML_STREAM_END, st->buf, NULL, 0))
+            return ezxml_stream_err(st, "stopped by callback");
+        st->names_len = ezxml_stream_name(st) - st->names;
+        st->depth--;
+    }
+    return 0;
+}
+
+// called with a complete end tag in buf
+static int ezxml_stream_close(ezxml_stream_t st)
+{
+    char *n = st->buf, *s = st->buf + strcspn(st->buf, EZXML_STREAM_WS);
+
+    if (s[strspn(s, EZXML_STREAM_WS)]) return ezxml_stream_err(st, "missing >");
+    *s = '\0';
+
+    if (! st->depth || strcmp(n, ezxml_stream_name(st)))
+        return ezxml_stream_err(st, "unexpected closing tag </%s>", n);
+
+    if (st->cb(st->user, EZXML_STREAM_END, n, NULL, 0))
+        return ezxml_stream_err(st, "stopped by callback");
+    st->names_len = ezxml_stream_name(st) - st->names;
+    st->depth--;
+    return 0;
+}
+
+ezxml_stream_t ezxml_stream_new(ezxml_stream_cb cb, void *user, size_t token_max)
+{
+    ezxml_stream_t st;
+
+    if (! cb || ! (st = calloc(1, sizeof(struct ezxml_stream)))) return NULL;
+    st->cb = cb;
+    st->user = user;
+    st->state = ST_TEXT;
+    st->token_max = (token_max) ? token_max : EZXML_STREAM_TOKEN_MAX;
+    st->line = 1;
+    return st;
+}
+
+int ezxml_stream_feed(ezxml_stream_t st, const char *s, size_t len)
+{
+    const char *end = s + len, *run;
+    char out[4];
+    int l;
+
+    if (! st || st->state == ST_ERROR) return -1;
+
+    while (s < end) {
+        switch (st->state) {
+        case ST_TEXT:
+            if (st->cr && *s == '\n') { s++; st->cr = 0; break; } // rest of \r\n
+            st->cr = 0;
+            for (run = s; s < end && *s != '<' && *s != '&' && *s != '\r'; s++)
+                if (*s == '\n') st->line++;
+            if (ezxml_stream_text(st, run, s - run)) return -1;
+            if (s == end) break;
+
+            if (*s == '<') { st->state = ST_MARKUP; st->len = 0; }
+            else if (*s == '&') { st->state = ST_ENT; st->ent_len = 0; }
+            else { // normalize \r and \r\n to \n
+                st->cr = 1;
+                st->line++;
+                if (ezxml_stream_text(st, "\n", 1)) return -1;
+            }
+            s++;
+            break;
+
+        case ST_ENT:
+            if (*s == ';') {
+                st->ent[st->ent_len] = '\0';
+                st->state = ST_TEXT;
+                s++;
+                if ((l = ezxml_stream_ref(st->ent, out))) {
+                    if (ezxml_stream_text(st, out, l)) return -1;
+                }
+                else if (ezxml_stream_text(st, "&", 1) ||
+                         ezxml_stream_text(st, st->ent, st->ent_len) ||
+                         ezxml_stream_text(st, ";", 1)) return -1; // unknown, keep it
+            }
+            else if (st->ent_len < EZXML_STREAM_ENTL && *s != '<' && *s != '&' &&
+                     ! isspace((unsigned char)*s)) st->ent[st->ent_len++] = *(s++);
+            else { // not a reference, keep it as written
+                st->state = ST_TEXT;
+                if (ezxml_stream_text(st, "&", 1) ||
+                    ezxml_stream_text(st, st->ent, st->ent_len)) return -1;
+            }
+            break;
+
+        case ST_MARKUP:
+            if (! st->len) {
+                if (*s == '/') { st->state = ST_CLOSE; s++; break; }
+                if (*s == '?') { st->state = ST_PI; st->match = 0; s++; break; }
+                if (*s != '!') { // new tag
+                    if (! isalpha((unsigned char)*s) && *s != '_' && *s != ':' && ! (*s & 0x80))
+                        return ezxml_stream_err(st, "unexpected <");
+                    st->state = ST_TAG;
+                    st->quote = 0;
+                    break;
+                }
+            }
+
+            if (ezxml_stream_put(st, s++, 1)) return -1;
+            if (! strcmp(st->buf, "!--")) { st->state = ST_COMMENT; st->match = 0; }
+            else if (! strcmp(st->buf, "![CDATA[")) { st->state = ST_CDATA; st->match = 0; }
+            else if (! strcmp(st->buf, "!DOCTYPE")) {
+                st->state = ST_DOCTYPE;
+                st->quote = 0;
+                st->bracket = 0;
+            }
+            else if (strncmp(st->buf, "!--", st->len) && strncmp(st->buf, "![CDATA[", st->len) &&
+                     strncmp(st->buf, "!DOCTYPE", st->len)) return ezxml_stream_err(st, "unexpected <");
+            break;
+
+        case ST_TAG:
+        case ST_CLOSE:
+            for (run = s; s < end; s++) {
+                if (*s == '\n') st->line++;
+                if (st->quote) { if (*s == st->quote) st->quote = 0; }
+                else if (*s == '>') break;
+                else if (st->state == ST_TAG && (*s == '"' || *s == '\'')) st->quote = *s;
+            }
+            if (ezxml_stream_put(st, run, s - run)) return -1;
+            if (s == end) break;
+
+            s++;
+            if (st->state == ST_TAG) { if (ezxml_stream_open(st)) return -1; }
+            else if (ezxml_stream_close(st)) return -1;
+            st->state = ST_TEXT;
+            break;
+
+        case ST_COMMENT:
+        case ST_PI:
+            for (; s < end; s++) {
+                if (*s == '\n') st->line++;
+                if (*s == '>' && st->match == ((st->state == ST_COMMENT) ? 2 : 1)) {
+                    st->state = ST_TEXT;
+                    s++;
+                    break;
+                }
+                if (*s == ((st->state == ST_COMMENT) ? '-' : '?')) {
+                    if (st->match < ((st->state == ST_COMMENT) ? 2 : 1)) st->match++;
+                }
+                else st->match = 0;
+            }
+            break;
+
+        case ST_CDATA:
+            if (st->match) { // "]" or "]]" held back
+                if (*s == '>' && st->match == 2) { st->state = ST_TEXT; st->match = 0; s++; }
+                else if (*s == ']' && st->match < 2) { st->match++; s++; }
+                else if (*s == ']') { // "]]]", the first one is content
+                    if (ezxml_stream_text(st, "]", 1)) return -1;
+                    s++;
+                }
+                else {
+                    if (ezxml_stream_text(st, "]]", st->match)) return -1;
+                    st->match = 0;
+                }
+                break;
+            }
+
+            if (st->cr && *s == '\n') { s++; st->cr = 0; break; }
+            st->cr = 0;
+            for (run = s; s < end && *s != ']' && *s != '\r'; s++)
+                if (*s == '\n') st->line++;
+            if (ezxml_stream_text(st, run, s - run)) return -1;
+            if (s == end) break;
+
+            if (*s == ']') st->match = 1;
+            else {
+                st->cr = 1;
+                st->line++;
+                if (ezxml_stream_text(st, "\n", 1)) return -1;
+            }
+            s++;
+            break;
+
+        case ST_DOCTYPE:
+            for (; s < end; s++) {
+                if (*s == '\n') st->line++;
+                if (st->quote) { if (*s == st->quote) st->quote = 0; }
+                else if (*s == '"' || *s == '\'') st->quote = *s;
+                else if (*s == '[') st->bracket = 1;
+                else if (*s == ']') st->bracket = 0;
+                else if (*s == '>' && ! st->bracket) {
+                    st->state = ST_TEXT;
+                    s++;
+                    break;
+                }
+            }
+            break;
+
+        default:
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int ezxml_stream_finish(ezxml_stream_t st)
+{
+    if (! st || st->state == ST_ERROR) return -1;
+    if (st->state != ST_TEXT && st->state != ST_ENT)
+        return ezxml_stream_err(st, "unexpected end of document inside markup");
+    if (! st->seen_root) return ezxml_stream_err(st, "root tag missing");
+    if (st->depth) return ezxml_stream_err(st, "unclosed tag <%s>", ezxml_stream_name(st));
+    return 0;
+}
+
+size_t ezxml_stream_depth(ezxml_stream_t st)
+{
+    return (st) ? st->depth : 0;
+}
+
+const char *ezxml_stream_error(ezxml_stream_t st)
+{
+    return (st) ? st->err : "";
+}
+
+void ezxml_stream_free(ezxml_stream_t st)
+{
+    if (! st) return;
+    free(st->buf);
+    free(st->names);
+    free(st);
+}
@@ -0,0 +1,66 @@
+/* ezxml_stream.h
+ *
+ * Incremental (SAX style) companion to ezxml. The document is fed in chunks of
+ * any size, e.g. as they come out of the decryptor, and element, attribute and
+ * text events are reported through a callback without building a tree. Memory
+ * use is bounded by the longest single tag and the element nesting, not by the
+ * document size.
+ *
+ * Decoding follows ezxml_parse_str(): new lines are normalized, the predefined
+ * entities and character references are decoded, attribute whitespace becomes
+ * ' ', CDATA is reported as text, comments, processing instructions and the
+ * DOCTYPE are skipped (entities declared in an internal DTD are not expanded).
+ */
+
+#ifndef _EZXML_STREAM_H
+#define _EZXML_STREAM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EZXML_STREAM_TOKEN_MAX 4096 // default limit for one tag with its attributes
+
+typedef enum {
+    EZXML_STREAM_START, // name: tag name
+    EZXML_STREAM_ATTR,  // name: attribute name, value/len: decoded value
+    EZXML_STREAM_TEXT,  // name: enclosing tag, value/len: a piece of its text
+    EZXML_STREAM_END    // name: tag name, also sent for self closing tags
+} ezxml_stream_event;
+
+// Event callback. Text of one element may arrive in several pieces and is not
+// null terminated; names and attribute values are. Pointers are only valid
+// during the call. From START to END ezxml_stream_depth() counts the tag
+// itself. Return non-zero to stop parsing.
+typedef int (*ezxml_stream_cb)(void *user, ezxml_stream_event event,
+                               const char *name, const char *value, size_t len);
+
+typedef struct ezxml_stream *ezxml_stream_t;
+
+// Creates a parser. token_max limits the size of one tag including its
+// attributes, 0 selects EZXML_STREAM_TOKEN_MAX. Returns NULL on failure.
+ezxml_stream_t ezxml_stream_new(ezxml_stream_cb cb, void *user, size_t token_max);
+
+// Feeds the next chunk of the document. Returns 0 on success, -1 on a parse
+// error or when the callback stopped parsing; see ezxml_stream_error().
+int ezxml_stream_feed(ezxml_stream_t st, const char *s, size_t len);
+
+// Signals the end of the document. Returns 0 if the root element was complete.
+int ezxml_stream_finish(ezxml_stream_t st);
+
+// current element nesting, 0 outside of the root element
+size_t ezxml_stream_depth(ezxml_stream_t st);
+
+// returns parser error message or empty string if none
+const char *ezxml_stream_error(ezxml_stream_t st);
+
+// frees the parser
+void ezxml_stream_free(ezxml_stream_t st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EZXML_STREAM_H
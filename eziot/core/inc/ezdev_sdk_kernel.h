@@ -134,7 +134,7 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_stop();
 /** 
  *  \brief		微内核内部业务驱动接口，通过外部线程驱动接口，内部执行业务
  *  \method		ezdev_sdk_kernel_yield
- *	\note		阻塞式调用
+ *	\note		阻塞式调用, 平台提供了net_work_wait时一直等到收到数据、最近的定时器到期或者被ezdev_sdk_kernel_wakeup叫醒
  *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_invald_call、ezdev_sdk_kernel_params_invalid、ezdev_sdk_kernel_buffer_too_small、\n
  *				ezdev_sdk_kernel_internal、ezdev_sdk_kernel_value_load、ezdev_sdk_kernel_value_save、ezdev_sdk_kernel_memory、NET_ERROR、\n
  *				LBS_ERROR、SECRETKEY_ERROR、DAS_ERROR
@@ -149,6 +149,40 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_yield();
  */
 EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_yield_user();
 
+/** 
+ *  \brief		让阻塞在ezdev_sdk_kernel_yield里的线程立即返回, 可在任意线程调用
+ *  \method		ezdev_sdk_kernel_wakeup
+ *	\note		发消息时微内核自己会叫醒; 停止驱动ezdev_sdk_kernel_yield的线程之前调用, 不用等到下一个定时器
+ */
+EZDEV_SDK_KERNEL_API void ezdev_sdk_kernel_wakeup();
+
+/** 
+ *  \brief		保留路由回调中收到的消息内容
+ *  \method		ezdev_sdk_kernel_submsg_retain
+ *	\note		路由回调中的ptr_submsg->buf可能借用微内核的接收缓冲区，只在回调期间有效。
+ *				回调返回后还需要使用消息内容时在回调中调用本接口，只有借用的缓冲区才会拷贝；
+ *				调用后ptr_submsg->buf指向返回的缓冲区，重复调用返回同一缓冲区，不再使用时调用ezdev_sdk_kernel_submsg_release释放
+ *  \param[in] 	ptr_submsg	路由回调中收到的消息
+ *  \return 	成功返回消息缓冲区 失败返回NULL
+ */
+EZDEV_SDK_KERNEL_API void* ezdev_sdk_kernel_submsg_retain(ezdev_sdk_kernel_submsg* ptr_submsg);
+
+/** 
+ *  \brief		保留路由回调中收到的消息内容 v3协议
+ *  \method		ezdev_sdk_kernel_submsg_v3_retain
+ *	\note		同ezdev_sdk_kernel_submsg_retain
+ *  \param[in] 	ptr_submsg	路由回调中收到的消息
+ *  \return 	成功返回消息缓冲区 失败返回NULL
+ */
+EZDEV_SDK_KERNEL_API void* ezdev_sdk_kernel_submsg_v3_retain(ezdev_sdk_kernel_submsg_v3* ptr_submsg);
+
+/** 
+ *  \brief		释放保留的消息内容
+ *  \method		ezdev_sdk_kernel_submsg_release
+ *  \param[in] 	buf	ezdev_sdk_kernel_submsg_retain或ezdev_sdk_kernel_submsg_v3_retain的返回值
+ */
+EZDEV_SDK_KERNEL_API void ezdev_sdk_kernel_submsg_release(void* buf);
+
 /** 
  *  \brief		微内核数据发送接口（线程安全）
  *  \method		ezdev_sdk_kernel_send
@@ -167,6 +201,7 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_send(ezdev_sdk_kern
  *  \method		ezdev_sdk_kernel_send
  *	\note		只负责发消息，不管消息内容
  *				非阻塞式调用
+ *				msg_coalesce为1时, 队列中尚未发送的同类消息被本条原位替换, 被替换的seq回执ezdev_sdk_kernel_msg_superseded
  *  \param[in] 	pubmsg	消息内容
  *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_invald_call、ezdev_sdk_kernel_params_invalid、ezdev_sdk_kernel_data_len_range、\n
  *				ezdev_sdk_kernel_memory、ezdev_sdk_kernel_queue_full、ezdev_sdk_kernel_extend_no_find、ezdev_sdk_kernel_force_domain_risk、\n
@@ -174,11 +209,68 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_send(ezdev_sdk_kern
  */
 EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3* pubmsg_v3);
 
+/** 
+ *  \brief		发起请求并等待平台响应（线程安全）
+ *  \method		ezdev_sdk_kernel_request
+ *	\note		非阻塞式调用, seq由微内核分配, 响应按seq和option->rsp_command_id匹配
+ *				收到响应、超时、链路断开或ezdev_sdk_kernel_stop时回调一次option->cb, 回调在微内核线程或启动定时器的线程中执行, 不要阻塞
+ *				匹配上的响应不再通过领域的ezdev_sdk_kernel_data_route分发
+ *  \param[in] 	pubmsg	消息内容, msg_response必须为0
+ *  \param[in] 	option	超时时间、响应指令和回调
+ *  \param[out] handle	请求句柄(即seq), 用于ezdev_sdk_kernel_request_cancel, 可以为NULL
+ *  \return 	同ezdev_sdk_kernel_send, 另有ezdev_sdk_kernel_queue_full(未完成的请求过多)
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_request(ezdev_sdk_kernel_pubmsg* pubmsg, const sdk_request_option* option, EZDEV_SDK_UINT32* handle);
+
+/** 
+ *  \brief		发起请求并等待平台响应 v3协议（线程安全）
+ *  \method		ezdev_sdk_kernel_request_v3
+ *	\note		同ezdev_sdk_kernel_request, 响应按seq、module和option->rsp_msg_type匹配, rsp_msg_type为空时取msg_type加"_reply"
+ *				请求消息不参与合并
+ *  \param[in] 	pubmsg	消息内容, msg_response必须为0
+ *  \param[in] 	option	超时时间、响应类型和回调
+ *  \param[out] handle	请求句柄(即seq), 可以为NULL
+ *  \return 	同ezdev_sdk_kernel_send_v3, 另有ezdev_sdk_kernel_queue_full(未完成的请求过多)
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_request_v3(ezdev_sdk_kernel_pubmsg_v3* pubmsg, const sdk_request_option* option, EZDEV_SDK_UINT32* handle);
+
+/** 
+ *  \brief		取消未完成的请求（线程安全）
+ *  \method		ezdev_sdk_kernel_request_cancel
+ *	\note		取消后不再回调; 回调已经开始时取消失败
+ *  \param[in] 	handle	ezdev_sdk_kernel_request返回的句柄
+ *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_params_invalid(请求已结束)、ezdev_sdk_kernel_invald_call
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_request_cancel(EZDEV_SDK_UINT32 handle);
+
+/** 
+ *  \brief		发起请求并阻塞等待响应
+ *  \method		ezdev_sdk_kernel_request_sync
+ *	\note		不能在微内核线程(包括各种回调)中调用; option->cb和user_data被忽略
+ *  \param[in] 	pubmsg			消息内容, msg_response必须为0
+ *  \param[in] 	option			超时时间和响应指令
+ *  \param[out] rsp_buf			响应内容, 可以为NULL
+ *  \param[in] 	rsp_buf_size	rsp_buf大小
+ *  \param[out] rsp_len			响应实际长度, 可以为NULL
+ *  \return 	同ezdev_sdk_kernel_request, 另有ezdev_sdk_kernel_request_timeout、ezdev_sdk_kernel_request_cancelled、\n
+ *				ezdev_sdk_kernel_net_disconnected(链路断开)、ezdev_sdk_kernel_buffer_too_small(响应未拷贝, rsp_len为所需大小)
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_request_sync(ezdev_sdk_kernel_pubmsg* pubmsg, const sdk_request_option* option,
+																		  void* rsp_buf, EZDEV_SDK_UINT32 rsp_buf_size, EZDEV_SDK_UINT32* rsp_len);
+
+/** 
+ *  \brief		发起请求并阻塞等待响应 v3协议
+ *  \method		ezdev_sdk_kernel_request_v3_sync
+ *	\note		同ezdev_sdk_kernel_request_sync
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_request_v3_sync(ezdev_sdk_kernel_pubmsg_v3* pubmsg, const sdk_request_option* option,
+																			 void* rsp_buf, EZDEV_SDK_UINT32 rsp_buf_size, EZDEV_SDK_UINT32* rsp_len);
+
 /** 
  *  \brief		设置socket参数
  *  \method		ezdev_sdk_kernel_set_net_option
  *	\note		设置socket参数，需要在ezdev_sdk_kernel_start前调用
- *  \param[in] 	optname 操作类型, 1 绑定到某张网卡 3 设备接入链路断开重连
+ *  \param[in] 	optname 操作类型, 1 绑定到某张网卡 3 设备接入链路断开重连 4 链路变差时预先建立备用连接(optval为int, 0关闭 1开启, 需要平台提供thread_start)
  * 	\param[in] 	optval 操作参数
  *  \param[in] 	optlen 操作参数长度
  *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_params_invalid、ezdev_sdk_kernel_buffer_too_small
@@ -221,6 +313,7 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_show_key_info(showk
 /** 
  *  \brief			
  *  \method			ezDevSDK_parse_wifi_publish_msg
+ *	\note			报文在buf内原地解密，路由回调中的消息内容借用buf，回调返回后buf内容不再是原报文
  *  \param[out]		
  *  \return			ezdev_sdk_kernel_error、ezdev_sdk_kernel_params_invalid 、ezdev_sdk_kernel_net_transmit
  */
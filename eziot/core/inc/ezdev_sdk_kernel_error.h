@@ -60,6 +60,9 @@ typedef enum
 	ezdev_sdk_kernel_value_load					= BASE_ERROR+13,					///< 获取设备数据失败
 	ezdev_sdk_kernel_value_save					= BASE_ERROR+14,					///< 保存数据至设备失败
     ezdev_sdk_kernel_msg_stop_distribute	    = BASE_ERROR+15,					///< 设备正在停止,上层消息停止下发
+	ezdev_sdk_kernel_msg_superseded				= BASE_ERROR+16,					///< 消息尚未发送就被更新的同类消息替换(msg_coalesce)
+	ezdev_sdk_kernel_request_timeout			= BASE_ERROR+17,					///< 请求等待响应超时
+	ezdev_sdk_kernel_request_cancelled			= BASE_ERROR+18,					///< 请求被取消(微内核停止)
 
 	ezdev_sdk_kernel_net_create					= (BASE_ERROR+NET_ERROR)+1,			///< 创建socket失败
 	ezdev_sdk_kernel_net_connect				= (BASE_ERROR+NET_ERROR)+2,			///< 网络连接失败
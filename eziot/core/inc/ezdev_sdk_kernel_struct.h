@@ -32,6 +32,7 @@
 #define ezdev_sdk_module_name_len     16
 #define ezdev_sdk_ext_msg_len        128
 #define ezdev_sdk_method_len         128
+#define ezdev_sdk_coalesce_key_len    32
 
 
 #if !defined(ezdev_sdk_name_len)
@@ -41,6 +42,7 @@
 typedef void *ezdev_sdk_net_work;
 typedef void *ezdev_sdk_time;
 typedef void *ezdev_sdk_mutex;
+typedef void *ezdev_sdk_sem;
 
 
 /**
@@ -87,6 +89,17 @@ enum QOS_T
     QOS_T2  ///< 准确一次送达
 };
 
+/**
+ * \brief 发送消息的优先级类别, 每个类别独立排队, 按权重轮流发送
+ */
+typedef enum
+{
+    sdk_msg_class_default = 0, ///< 未指定, 响应消息按control发送, 其余按interactive发送
+    sdk_msg_class_control,     ///< 指令响应等控制消息, 权重最高
+    sdk_msg_class_interactive, ///< 普通交互消息
+    sdk_msg_class_bulk         ///< 批量上报、透传大块数据等, 权重最低, 不会被饿死
+} sdk_msg_class;
+
 /**
  * \brief 往服务器发送的消息结构体
  */
@@ -102,6 +115,7 @@ typedef struct
     EZDEV_SDK_PTR    externel_ctx;       ///< 外部自定义数据，在消息发送回执中带回
     EZDEV_SDK_UINT32 externel_ctx_len;   ///< 外部自定义数据长度
     char command_ver[version_max_len];   ///< 指令版本
+    EZDEV_SDK_UINT8 msg_class;           ///< 优先级类别, 见sdk_msg_class, 置0即可
 } ezdev_sdk_kernel_pubmsg;
 
 /**
@@ -121,9 +135,25 @@ typedef struct
     char msg_type[ezdev_sdk_msg_type_len];           ///< 消息类型"report" / "query" / "set_reply" / "operate_reply"等
     char sub_serial[ezdev_sdk_max_serial_len];       ///< 子设备序列号
     char ext_msg[ezdev_sdk_ext_msg_len];             ///< 扩展内容，例如"model"中的 "domainid/identifier"字段
+    EZDEV_SDK_UINT8 msg_class;                       ///< 优先级类别, 见sdk_msg_class, 置0即可
+    EZDEV_SDK_UINT8 msg_coalesce;                    ///< 1:只保留最新值, 队列中尚未发送的同类消息被本条原位替换, 被替换的消息回执ezdev_sdk_kernel_msg_superseded
+    char coalesce_key[ezdev_sdk_coalesce_key_len];   ///< 可选的合并key, 与module/resource_id/resource_type/msg_type/method/sub_serial/ext_msg一起区分同类消息
+    EZDEV_SDK_INT32 (*body_read)(unsigned char *buf, EZDEV_SDK_UINT32 offset, EZDEV_SDK_UINT32 len, EZDEV_SDK_PTR user); ///< 流式发送: msg_body为NULL时, 微内核线程按分片回调读取[offset, offset+len)的业务数据, 返回读到的字节数;
+                                                     ///< msg_body_len为总长, 可以超过发送缓存, 需要平台支持分片; 收到该消息的发送回执之前数据必须保持可读
+    EZDEV_SDK_PTR body_user;                         ///< body_read的user参数
 }  ezdev_sdk_kernel_pubmsg_v3;
 
 
+/**
+ * \brief 订阅消息缓冲区的归属
+ */
+typedef enum
+{
+    submsg_buf_owned = 0,   ///< 缓冲区由微内核分配,路由回调返回后由微内核释放
+    submsg_buf_borrowed,    ///< 缓冲区借用自接收缓冲区,仅在路由回调期间有效
+    submsg_buf_retained     ///< 缓冲区已被用户保留,需调用ezdev_sdk_kernel_submsg_release释放
+} ezdev_sdk_kernel_submsg_buf_type;
+
 /**
  * \brief 订阅的消息
  */
@@ -135,6 +165,7 @@ typedef struct
     EZDEV_SDK_INT32 msg_domain_id;     ///< 扩展模块ID（领域ID）
     EZDEV_SDK_INT32 msg_command_id;    ///< 指令ID
     char command_ver[version_max_len]; ///< 指令版本 
+    EZDEV_SDK_INT8 buf_type;           ///< 缓冲区归属,见ezdev_sdk_kernel_submsg_buf_type,由微内核维护
 } ezdev_sdk_kernel_submsg;
 
 /**
@@ -152,6 +183,7 @@ typedef struct
     char msg_type[ezdev_sdk_msg_type_len];           ///< 消息类型"report" / "query" / "set_reply" / "operate_reply"等
     char sub_serial[ezdev_sdk_max_serial_len];       ///< 子设备序列号
     char ext_msg[ezdev_sdk_ext_msg_len];             ///< 扩展字段,"model"模块中的 "domainid/identifier"内容
+    EZDEV_SDK_INT8 buf_type;                         ///< 缓冲区归属,见ezdev_sdk_kernel_submsg_buf_type,由微内核维护
 } ezdev_sdk_kernel_submsg_v3;
 
 
@@ -167,7 +199,9 @@ typedef enum
     sdk_kernel_event_fast_reg_online,           ///< event_context == sdk_sessionkey_context     设备快速上线
     sdk_kernel_event_runtime_err,               ///< evnet_context == sdk_runtime_err_context    设备sdk运行时错误信息
     sdk_kernel_event_reconnect_success,         ///< evnet_context == NULL                       重连成功事件回调  
-    sdk_kernel_event_heartbeat_interval_changed ///< event_context == int                        das心跳发生改变事件回调
+    sdk_kernel_event_heartbeat_interval_changed,///< event_context == int                        das心跳发生改变事件回调
+    sdk_kernel_event_send_shaped,               ///< event_context == sdk_send_shaped_context    消息因限速延后发送
+    sdk_kernel_event_sessionkey_rotated         ///< event_context == sdk_sessionkey_context     不断线更换了会话密钥
 } sdk_kernel_event_type;
 
 /**
@@ -250,8 +284,114 @@ typedef struct
     char msg_type[ezdev_sdk_msg_type_len];           ///< 消息类型"report" / "query" / "set_reply" / "operate_reply"等
     char sub_serial[ezdev_sdk_max_serial_len];       ///< 子设备序列号,如果非hub模式, 这个参数不需要填写
     char ext_msg[ezdev_sdk_ext_msg_len];             ///< 扩展内容，例如"model"中的 "domainid/identifier"字段
+    EZDEV_SDK_UINT32 superseded_by;                  ///< 错误码为ezdev_sdk_kernel_msg_superseded时, 替换本消息的消息seq值
 } sdk_send_msg_ack_context_v3;
 
+/**
+ * \brief 发送限速的作用范围
+ */
+typedef enum
+{
+    sdk_shaper_global, ///< 所有消息
+    sdk_shaper_module, ///< v3协议的某个module
+    sdk_shaper_domain  ///< v2协议的某个领域
+} sdk_shaper_scope;
+
+/**
+ * \brief 发送限速配置(令牌桶), 超出速率的消息留在发送队列中延后发送, 不会被丢弃
+ * \note  消息数和字节数两个桶同时生效, rate为0表示该维度不限速; burst为0时取rate, 即最多攒1秒的额度
+ */
+typedef struct
+{
+    sdk_shaper_scope scope;                 ///< 作用范围
+    char module[ezdev_sdk_module_name_len]; ///< scope为sdk_shaper_module时有效
+    EZDEV_SDK_UINT32 domain_id;             ///< scope为sdk_shaper_domain时有效
+    EZDEV_SDK_UINT32 msg_rate;              ///< 每秒消息数
+    EZDEV_SDK_UINT32 msg_burst;             ///< 消息桶容量
+    EZDEV_SDK_UINT32 byte_rate;             ///< 每秒字节数
+    EZDEV_SDK_UINT32 byte_burst;            ///< 字节桶容量
+} sdk_shaper_config;
+
+/**
+ * \brief 限速延后事件的上下文, 同一个限速在积压发完之前只上报一次
+ */
+typedef struct
+{
+    sdk_shaper_scope scope;                 ///< 触发延后的限速范围
+    char module[ezdev_sdk_module_name_len]; ///< scope为sdk_shaper_module时有效
+    EZDEV_SDK_UINT32 domain_id;             ///< scope为sdk_shaper_domain时有效
+    EZDEV_SDK_UINT32 delay_ms;              ///< 预计延后时间
+} sdk_send_shaped_context;
+
+#define sdk_trace_scrub_body    0x01    ///< 不记录业务数据, 只保留长度, 回放时用空格填充
+#define sdk_trace_scrub_id      0x02    ///< 不记录子设备序列号和资源id
+
+/**
+ * \brief 消息记录的类型
+ */
+typedef enum
+{
+    sdk_trace_header = 0,   ///< 记录头, 每次开始记录时写一次, 带格式版本和脱敏选项
+    sdk_trace_in_v2,        ///< 收到的v2消息, 已解密、解压
+    sdk_trace_in_v3,        ///< 收到的v3消息, 已解密、解压
+    sdk_trace_out_v2,       ///< 送进发送队列的v2消息
+    sdk_trace_out_v3,       ///< 送进发送队列的v3消息
+    sdk_trace_sent          ///< 消息发送完成, 只有seq和结果, 与对应out记录的时间差就是排队加发送的耗时; 没能入队(如队列满)时紧跟out记录写一条带错误码的结果
+} sdk_trace_record_type;
+
+/**
+ * \brief 消息记录配置, 记录内容是紧凑的二进制格式, 多字节整数按网络字节序
+ */
+typedef struct
+{
+    void (*trace_write)(const void *data, EZDEV_SDK_UINT32 len, EZDEV_SDK_PTR user); ///< 每次写一条完整记录, 为NULL时停止记录
+                                                                                     ///< 在产生消息的线程中持锁调用, 回调中不能再调用微内核接口
+    EZDEV_SDK_PTR user;                     ///< 原样传给trace_write
+    EZDEV_SDK_UINT32 scrub;                 ///< 脱敏选项, sdk_trace_scrub_body | sdk_trace_scrub_id
+} sdk_trace_config;
+
+/**
+ * \brief 一条记录的概要, 回放时据此按记录的节奏送入微内核
+ */
+typedef struct
+{
+    EZDEV_SDK_UINT8 type;                   ///< sdk_trace_record_type
+    EZDEV_SDK_UINT8 version;                ///< 记录格式版本
+    EZDEV_SDK_UINT32 time_ms;               ///< 相对开始记录时刻的毫秒数, 记录头为0
+    EZDEV_SDK_UINT32 seq;                   ///< 消息seq, 记录头为0
+    EZDEV_SDK_UINT32 record_len;            ///< 整条记录的长度, 下一条记录紧跟其后
+} sdk_trace_record_info;
+
+/**
+ * \brief 异步请求的结果, 响应消息只在回调期间有效
+ */
+typedef struct
+{
+    EZDEV_SDK_UINT32 handle;                ///< 请求句柄, 即请求消息的seq
+    EZDEV_SDK_UINT32 result;                ///< ezdev_sdk_kernel_succ:收到响应 ezdev_sdk_kernel_request_timeout:超时
+                                            ///< ezdev_sdk_kernel_net_disconnected:链路断开 ezdev_sdk_kernel_request_cancelled:微内核停止
+    ezdev_sdk_kernel_submsg *rsp;           ///< v2请求的响应, 没有响应时为NULL
+    ezdev_sdk_kernel_submsg_v3 *rsp_v3;     ///< v3请求的响应, 没有响应时为NULL
+    void *user_data;                        ///< 发起请求时传入的user_data
+} sdk_request_result;
+
+/**
+ * \brief 异步请求完成回调, 在微内核线程中调用, 不能阻塞
+ */
+typedef void (*sdk_request_cb)(const sdk_request_result *result);
+
+/**
+ * \brief 异步请求参数
+ */
+typedef struct
+{
+    EZDEV_SDK_UINT32 timeout_ms;               ///< 等待响应的超时时间, 从请求入队开始计算
+    EZDEV_SDK_UINT32 rsp_command_id;           ///< v2请求: 响应的指令ID
+    char rsp_msg_type[ezdev_sdk_msg_type_len]; ///< v3请求: 响应的消息类型, 为空时取请求的msg_type加"_reply"
+    sdk_request_cb cb;                         ///< 完成回调, 同步接口忽略
+    void *user_data;                           ///< 回调中带回, 同步接口忽略
+} sdk_request_option;
+
 /**
  * 低功耗设备快速上线.
  */
@@ -337,6 +477,19 @@ typedef struct
 	int (*thread_mutex_lock)(ezdev_sdk_mutex ptr_mutex);
 	int (*thread_mutex_unlock)(ezdev_sdk_mutex ptr_mutex);
 
+	/* 信号量可选, 不提供时同步请求退化为轮询等待 */
+	ezdev_sdk_sem (*thread_sem_create)();
+	void (*thread_sem_destroy)(ezdev_sdk_sem ptr_sem);
+	int (*thread_sem_post)(ezdev_sdk_sem ptr_sem);
+	int (*thread_sem_wait)(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms);	///<	等到返回0, 超时返回-1
+
+	/* 后台线程可选, 不提供时备用连接不启用, 会话密钥更换的LBS交互在微内核线程里同步完成 */
+	int (*thread_start)(void (*task)(void *arg), void *arg);	///<	启动一个分离的线程执行task, 成功返回0
+
+	/* 可叫醒的等待可选, 不提供时das_yield每次最多等10ms, 靠轮询发现其他线程放进来的消息 */
+	ezdev_sdk_kernel_error (*net_work_wait)(ezdev_sdk_net_work net_work, EZDEV_SDK_INT32 timeout_ms);	///<	等到可读返回成功, 超时或被叫醒返回超时
+	void (*net_work_wakeup)(ezdev_sdk_net_work net_work);		///<	任意线程调用, 让正在进行或下一次的net_work_wait立即返回
+
 } ezdev_sdk_kernel_platform_handle;
 
 /**
@@ -27,11 +27,20 @@
 #include "ezdev_sdk_kernel_event.h"
 #include "access_domain_bus.h"
 #include "utils.h"
+#include "ezdev_sdk_kernel_rng.h"
+#include "ezdev_sdk_kernel_shaper.h"
+#include "ezdev_sdk_kernel_request.h"
+#include "ezdev_sdk_kernel_compress.h"
+#include "ezdev_sdk_kernel_trace.h"
+#include "ezdev_sdk_kernel_job.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
 
 EXTERN_QUEUE_FUN(submsg)
-EXTERN_QUEUE_FUN(pubmsg_exchange)
+EXTERN_LANE_QUEUE_FUN(pubmsg_exchange)
 EXTERN_QUEUE_FUN(submsg_v3)
-EXTERN_QUEUE_FUN(pubmsg_exchange_v3)
+EXTERN_LANE_QUEUE_FUN(pubmsg_exchange_v3)
 
 EXTERN_QUEUE_BASE_FUN
 ASE_SUPPORT_INTERFACE
@@ -40,19 +49,202 @@ ACCESS_DOMAIN_BUS_INTERFACE
 EZDEV_SDK_KERNEL_COMMON_INTERFACE
 EZDEV_SDK_KERNEL_RISK_CONTROL_INTERFACE
 EZDEV_SDK_KERNEL_EVENT_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_RNG_INTERFACE
+EZDEV_SDK_KERNEL_SHAPER_INTERFACE
+EZDEV_SDK_KERNEL_REQUEST_INTERFACE
+EZDEV_SDK_KERNEL_COMPRESS_INTERFACE
+EZDEV_SDK_KERNEL_TRACE_INTERFACE
+EZDEV_SDK_KERNEL_JOB_INTERFACE
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+
+#define das_gcm_iv_len		12
+#define das_gcm_salt_len	8		///<	报文头中每次连接随机生成的部分, 其后是4字节计数
+#define das_gcm_replay_window	32	///<	下行报文计数允许的乱序范围
+#define das_gcm_retired_max	8		///<	记住的已结束的下行随机数个数
+
+/**
+ * \brief 下行报文防重放窗口
+ * \note  同一个随机数下计数落在窗口内且没收到过才接受; 随机数变化说明平台换了连接, 旧随机数记入retired,
+ *        之后再出现直接丢弃. 只记最近das_gcm_retired_max个, 更早连接的报文要靠会话密钥更换来失效
+ */
+typedef struct
+{
+	EZDEV_SDK_INT8 ready;
+	unsigned char salt[das_gcm_salt_len];
+	EZDEV_SDK_UINT32 top;							///<	已接受的最大计数
+	EZDEV_SDK_UINT32 bitmap;						///<	第i位表示计数top - i已接受
+	unsigned char retired[das_gcm_retired_max][das_gcm_salt_len];
+	EZDEV_SDK_UINT8 retired_count;
+	EZDEV_SDK_UINT8 retired_next;
+} das_gcm_window;
+
+/**
+ * \brief GCM模式的会话状态, 只在主线程(das_yield)中使用
+ * \note  报文头 = 随机数(8字节) || 计数(4字节), nonce = iv ^ 报文头. 上下行的iv都由会话密钥派生且互不相同,
+ *        会话密钥变化时重新派生并重新设置密钥; 发送随机数在每次注册DAS和计数回绕时从DRBG重新取,
+ *        同一会话密钥下重连2^32次nonce重复的概率也只有约2^-1
+ */
+typedef struct
+{
+	bscomptls_gcm_context ctx;
+	unsigned char key[ezdev_sdk_sessionkey_len];
+	unsigned char iv_up[das_gcm_iv_len];			///<	设备发往平台
+	unsigned char iv_down[das_gcm_iv_len];			///<	平台发往设备
+	EZDEV_SDK_INT8 ready;
+	EZDEV_SDK_INT8 send_ready;						///<	send_salt已生成
+	unsigned char send_salt[das_gcm_salt_len];
+	EZDEV_SDK_UINT32 send_count;
+	das_gcm_window recv;
+} das_gcm_state;
+
+static das_gcm_state g_das_gcm;
+static das_gcm_state g_das_gcm_prev;		///<	上一代会话密钥的GCM状态, 只在宽限期内用于接收
+
+/**
+ * \brief 会话密钥代数, 只在主线程中使用
+ * \note  通过LBS拿到新密钥后在两条消息之间整体切换, 之后发送一律用新密钥; 旧密钥在宽限期内仍用于接收,
+ *        平台切换之前发出的消息不会因为换密钥丢掉. 会话密钥被完整注册流程改掉时代数归零
+ */
+typedef struct
+{
+	unsigned char key[ezdev_sdk_sessionkey_len];		///<	当前密钥, 与sdk_kernel->session_key不一致说明走了完整注册
+	EZDEV_SDK_UINT32 epoch;								///<	当前密钥的代数, 每次不断线更换加1
+	kernel_timer key_timer;								///<	当前密钥开始使用的时刻
+	EZDEV_SDK_INT8 prev_valid;							///<	旧密钥还在宽限期内
+	unsigned char prev_key[ezdev_sdk_sessionkey_len];
+	kernel_timer prev_timer;							///<	旧密钥开始宽限的时刻
+	EZDEV_SDK_INT8 retrying;							///<	上次通过LBS更换失败, 等retry_timer到期再试
+	kernel_timer retry_timer;
+} das_key_state;
+
+static das_key_state g_das_key;
+
+static kernel_timer g_das_shaper_timer;		///<	有消息被限速时, 在最早可以放行的时刻到期, 让das_yield按时醒来
+
+static ezdev_sdk_mutex g_das_wake_lock = NULL;
+static ezdev_sdk_net_work g_das_wake_net = NULL;	///<	das_yield正在等待的连接, 其他线程通过它叫醒das_yield; 释放连接前先清掉
+static EZDEV_SDK_INT8 g_das_wake_pending = 0;		///<	没有绑定连接时到来的叫醒, 下次绑定时补上, 否则das_yield要等到超时
+
+/**
+ * \brief v3消息分片信息, 放在通用协议体中, total为0表示没有分片
+ * \note  每个分片是一条独立加密的v3报文, 主题和Seq与整条消息相同; 分片按offset顺序发送, 每片的业务数据不压缩
+ */
+typedef struct
+{
+	EZDEV_SDK_UINT32 id;			///<	传输id, 发送时取消息seq
+	EZDEV_SDK_UINT32 offset;		///<	本片业务数据在整条消息中的偏移
+	EZDEV_SDK_UINT32 total;			///<	整条消息的业务数据长度
+} das_frag_info;
+
+/**
+ * \brief 正在重组的下行消息, 只在主线程中使用
+ */
+typedef struct
+{
+	ezdev_sdk_kernel_submsg_v3 head;	///<	第一个分片的主题和seq, buf为NULL
+	unsigned char *buf;				///<	整条消息的缓冲区, 为NULL表示空闲
+	EZDEV_SDK_UINT32 id;
+	EZDEV_SDK_UINT32 total;
+	EZDEV_SDK_UINT32 received;			///<	已经按顺序收到的长度
+	kernel_timer timer;				///<	收到第一个分片的时刻
+} das_frag_slot;
+
+static das_frag_slot g_das_frag[ezdev_sdk_das_frag_slots];
+static EZDEV_SDK_UINT32 g_das_frag_mem = 0;	///<	所有重组缓冲区合计大小
+
+/**
+ * \brief  topic中不变的前缀, 登录DAS时生成一次, 之后发布和订阅只追加可变部分
+ */
+static char g_das_topic_prefix_v3[ezdev_sdk_devserial_maxlen + 8];	///<	/iot/{设备序列号}/
+static EZDEV_SDK_UINT32 g_das_topic_prefix_v3_len = 0;
+static char g_das_topic_prefix_v2[ezdev_sdk_devserial_maxlen + 4];	///<	/{设备序列号}/
+static EZDEV_SDK_UINT32 g_das_topic_prefix_v2_len = 0;
+
+/**
+ * \brief  定长topic构造器, 只做追加, 空间不够时置overflow, 由das_topic_finish统一检查
+ */
+typedef struct
+{
+	char *buf;
+	EZDEV_SDK_UINT32 cap;
+	EZDEV_SDK_UINT32 len;
+	EZDEV_SDK_INT8 overflow;
+} das_topic_builder;
 
 MQTTClient g_DasClient;
 Network g_DasNetWork;
+#ifdef EZDEV_SDK_MQTT_BUF_FIXED
 unsigned char g_sendbuf[ezdev_sdk_send_buf_max];
 unsigned char g_readbuf[ezdev_sdk_recv_buf_max];
+#endif
 EZDEV_SDK_UINT32 g_das_transport_seq; ///<	与DAS通信数据包seq
 static EZDEV_SDK_BOOL g_is_first_session = EZDEV_SDK_TRUE;
 
+#define das_session_topic_v2	0x01
+#define das_session_topic_v3	0x02
+static EZDEV_SDK_UINT8 g_das_session_topics = 0;	///<	最近一次订阅的主题, 轻注册时会话里已有全部主题才沿用会话
+
+/**
+* \brief   重连准备: 遗嘱主题、加密后的遗嘱消息和序列化好的CONNECT报文按注册方式缓存, 重连时不再拼JSON、加密和序列化
+*			会话密钥、设备ID、首次上线标记、keepalive变化时自动重建, 设备信息和扩展版本变化时由das_reg_cache_invalidate清除
+*/
+typedef struct
+{
+	EZDEV_SDK_INT8 valid;
+	EZDEV_SDK_BOOL first_session;
+	EZDEV_SDK_UINT32 keepalive;
+	unsigned char session_key[ezdev_sdk_sessionkey_len];
+	unsigned char dev_id[ezdev_sdk_devid_len];
+	char will_topic[128];
+	unsigned char *will_message;
+	EZDEV_SDK_UINT32 will_message_len;
+	unsigned char *connect_frame;
+	EZDEV_SDK_INT32 connect_frame_len;
+} das_will_cache;
+
+static das_will_cache g_das_will_cache[2];		///<	[0]完整注册, [1]轻注册
+
+/**
+* \brief   链路变差(连续keepalive*1.5秒没有收到任何报文)时预先建立的备用TCP连接, 重连时直接在上面做MQTT握手
+*			TCP连接在后台任务里建立, 最长5秒的connect不占用das_yield; 平台没有提供后台线程时不启用
+*/
+typedef struct
+{
+	Network net;
+	char address[ezdev_sdk_ip_max_len];
+	EZDEV_SDK_UINT16 port;
+} das_standby_conn;
+
+static kernel_job g_das_standby_job;
+static das_standby_conn g_das_standby_conn;		///<	后台任务的参数和结果, 任务运行时微内核线程不碰
+static Network g_DasStandbyNet;
+static kernel_timer g_das_standby_timer;		///<	备用连接建立的时刻
+static char g_das_standby_address[ezdev_sdk_ip_max_len];
+static EZDEV_SDK_UINT16 g_das_standby_port = 0;
+static EZDEV_SDK_INT8 g_das_standby_tried = 0;	///<	本次链路变差已经尝试过, 恢复后清除
+extern EZDEV_SDK_INT8 g_das_standby_enable;
+
 static mkernel_internal_error das_subscribe_revc_topic(ezdev_sdk_kernel *sdk_kernel, EZDEV_SDK_INT8 open);
 static mkernel_internal_error das_message_send(ezdev_sdk_kernel *sdk_kernel);
 static mkernel_internal_error das_send_pubmsg(ezdev_sdk_kernel *sdk_kernel, ezdev_sdk_kernel_pubmsg *pubmsg);
+static void das_wake_bind(ezdev_sdk_net_work net_work);
+void das_wakeup();
+
+/**
+ * \brief   业务数据压缩过时在通用协议体中带上压缩方式和原始长度, 平台据此解压
+ */
+static void serialize_payload_compress(bscJSON *pJsonRoot, EZDEV_SDK_UINT32 raw_len)
+{
+	if (0 != raw_len)
+	{
+		bscJSON_AddNumberToObject(pJsonRoot, "Compress", ezdev_sdk_das_compress_lz4);
+		bscJSON_AddNumberToObject(pJsonRoot, "RawLen", raw_len);
+	}
+}
 
-static mkernel_internal_error serialize_payload_common_v3(EZDEV_SDK_UINT32 msg_seq, unsigned char **output_buf, EZDEV_SDK_UINT16 *output_length)
+static mkernel_internal_error serialize_payload_common_v3(EZDEV_SDK_UINT32 msg_seq, EZDEV_SDK_UINT32 raw_len, const das_frag_info *frag,
+													  unsigned char **output_buf, EZDEV_SDK_UINT16 *output_length)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	char *payload_common_jsonstring = NULL;
@@ -66,6 +258,13 @@ static mkernel_internal_error serialize_payload_common_v3(EZDEV_SDK_UINT32 msg_s
 			break;
 		}
 		bscJSON_AddNumberToObject(pJsonRoot, "Seq", msg_seq);
+		serialize_payload_compress(pJsonRoot, raw_len);
+		if (NULL != frag)
+		{
+			bscJSON_AddNumberToObject(pJsonRoot, "FragId", frag->id);
+			bscJSON_AddNumberToObject(pJsonRoot, "FragOff", frag->offset);
+			bscJSON_AddNumberToObject(pJsonRoot, "FragTotal", frag->total);
+		}
 		payload_common_jsonstring = bscJSON_PrintUnformatted(pJsonRoot);
 		if (NULL == payload_common_jsonstring)
 		{
@@ -84,7 +283,8 @@ static mkernel_internal_error serialize_payload_common_v3(EZDEV_SDK_UINT32 msg_s
 	return sdk_error;
 }
 
-static mkernel_internal_error serialize_payload_common(EZDEV_SDK_INT8 msg_type, const char *cmd_version, EZDEV_SDK_UINT32 msg_seq, unsigned char **output_buf, EZDEV_SDK_UINT16 *output_length)
+static mkernel_internal_error serialize_payload_common(EZDEV_SDK_INT8 msg_type, const char *cmd_version, EZDEV_SDK_UINT32 msg_seq, EZDEV_SDK_UINT32 raw_len,
+											 unsigned char **output_buf, EZDEV_SDK_UINT16 *output_length)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	char *payload_common_jsonstring = NULL;
@@ -100,6 +300,7 @@ static mkernel_internal_error serialize_payload_common(EZDEV_SDK_INT8 msg_type,
 		bscJSON_AddStringToObject(pJsonRoot, "CmdVer", cmd_version);
 		bscJSON_AddNumberToObject(pJsonRoot, "Seq", msg_seq);
 		bscJSON_AddNumberToObject(pJsonRoot, "MsgType", msg_type);
+		serialize_payload_compress(pJsonRoot, raw_len);
 
 		payload_common_jsonstring = bscJSON_PrintUnformatted(pJsonRoot);
 		if (NULL == payload_common_jsonstring)
@@ -309,19 +510,77 @@ static mkernel_internal_error serialize_devinfo(ezdev_sdk_kernel *sdk_kernel, un
 	return sdk_error;
 }
 
-static mkernel_internal_error deserialize_common_v3(unsigned char *common_buf, EZDEV_SDK_UINT16 common_buf_len, ezdev_sdk_kernel_submsg_v3 *ptr_submsg)
+/**
+ * \brief   解析通用协议体中的压缩信息, 没有Compress字段时raw_len为0
+ */
+static mkernel_internal_error deserialize_common_compress(bscJSON *json_item, EZDEV_SDK_UINT32 *raw_len)
+{
+	bscJSON *json_compress_item = bscJSON_GetObjectItem(json_item, "Compress");
+	bscJSON *json_rawlen_item = bscJSON_GetObjectItem(json_item, "RawLen");
+
+	*raw_len = 0;
+	if (json_compress_item == NULL)
+	{
+		return mkernel_internal_succ;
+	}
+
+	if (json_compress_item->type != bscJSON_Number || json_compress_item->valueint != ezdev_sdk_das_compress_lz4 ||
+		json_rawlen_item == NULL || json_rawlen_item->type != bscJSON_Number || json_rawlen_item->valueint <= 0)
+	{
+		ezdev_sdk_kernel_log_debug(mkernel_internal_json_parse_error, 0, "deserialize_common Parse Compress or RawLen error");
+		return mkernel_internal_json_parse_error;
+	}
+
+	*raw_len = (EZDEV_SDK_UINT32)json_rawlen_item->valueint;
+	return mkernel_internal_succ;
+}
+
+/**
+ * \brief   解析通用协议体中的分片信息, 没有FragTotal字段时frag->total为0
+ */
+static mkernel_internal_error deserialize_common_frag(bscJSON *json_item, das_frag_info *frag)
+{
+	bscJSON *json_id_item = bscJSON_GetObjectItem(json_item, "FragId");
+	bscJSON *json_off_item = bscJSON_GetObjectItem(json_item, "FragOff");
+	bscJSON *json_total_item = bscJSON_GetObjectItem(json_item, "FragTotal");
+
+	memset(frag, 0, sizeof(das_frag_info));
+	if (json_total_item == NULL)
+	{
+		return mkernel_internal_succ;
+	}
+
+	if (json_total_item->type != bscJSON_Number || json_total_item->valuedouble < 1 || json_total_item->valuedouble > ezdev_sdk_das_frag_recv_max ||
+		json_id_item == NULL || json_id_item->type != bscJSON_Number || json_id_item->valuedouble < 0 || json_id_item->valuedouble > 4294967295.0 ||
+		json_off_item == NULL || json_off_item->type != bscJSON_Number || json_off_item->valuedouble < 0 || json_off_item->valuedouble >= json_total_item->valuedouble)
+	{
+		ezdev_sdk_kernel_log_debug(mkernel_internal_json_parse_error, 0, "deserialize_common Parse FragId/FragOff/FragTotal error");
+		return mkernel_internal_json_parse_error;
+	}
+
+	frag->id = (EZDEV_SDK_UINT32)json_id_item->valuedouble;
+	frag->offset = (EZDEV_SDK_UINT32)json_off_item->valuedouble;
+	frag->total = (EZDEV_SDK_UINT32)json_total_item->valuedouble;
+	return mkernel_internal_succ;
+}
+
+static mkernel_internal_error deserialize_common_v3(unsigned char *common_buf, EZDEV_SDK_UINT16 common_buf_len, ezdev_sdk_kernel_submsg_v3 *ptr_submsg, EZDEV_SDK_UINT32 *raw_len,
+													das_frag_info *frag)
 {
 	/**
 	* \brief  解析通用协议体
 	*/
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	bscJSON *json_item = NULL;
+	unsigned char arena_block[ezdev_sdk_json_arena_size];
+	bscJSON_Arena arena;
 	bscJSON *json_seq_item = NULL;
 
 
+	bscJSON_ArenaInit(&arena, arena_block, sizeof(arena_block));
 	do
 	{
-		json_item = bscJSON_Parse((const char *)common_buf);
+		json_item = bscJSON_ParseInArena((const char *)common_buf, &arena);
 		if (json_item == NULL)
 		{
 			ezdev_sdk_kernel_log_debug(mkernel_internal_json_parse_error, 0, "deserialize_common Parse json error");
@@ -344,32 +603,39 @@ static mkernel_internal_error deserialize_common_v3(unsigned char *common_buf, E
 			break;
 		}
 		ptr_submsg->msg_seq = json_seq_item->valueint;
+		sdk_error = deserialize_common_compress(json_item, raw_len);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			break;
+		}
+		sdk_error = deserialize_common_frag(json_item, frag);
 
 	} while (0);
 
-	if (json_item != NULL)
-	{
-		bscJSON_Delete(json_item);
-		json_item = NULL;
-	}
+	bscJSON_ArenaReset(&arena);
+	json_item = NULL;
 
 	return sdk_error;
 }
 
 
-static mkernel_internal_error deserialize_common(unsigned char *common_buf, EZDEV_SDK_UINT16 common_buf_len, ezdev_sdk_kernel_submsg *ptr_submsg)
+static mkernel_internal_error deserialize_common(unsigned char *common_buf, EZDEV_SDK_UINT16 common_buf_len, ezdev_sdk_kernel_submsg *ptr_submsg, EZDEV_SDK_UINT32 *raw_len)
 {
 	/**
 	* \brief  解析通用协议体
 	*/
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	bscJSON *json_item = NULL;
+	unsigned char arena_block[ezdev_sdk_json_arena_size];
+	bscJSON_Arena arena;
 	bscJSON *json_seq_item = NULL;
 	bscJSON *json_cmdver_item = NULL;
+	size_t cmdver_len = 0;
 
+	bscJSON_ArenaInit(&arena, arena_block, sizeof(arena_block));
 	do
 	{
-		json_item = bscJSON_Parse((const char *)common_buf);
+		json_item = bscJSON_ParseInArena((const char *)common_buf, &arena);
 		if (json_item == NULL)
 		{
 			ezdev_sdk_kernel_log_debug(mkernel_internal_json_parse_error, 0, "deserialize_common Parse json error");
@@ -393,24 +659,21 @@ static mkernel_internal_error deserialize_common(unsigned char *common_buf, EZDE
 			break;
 		}
 
-		if (strlen(json_cmdver_item->valuestring) >= version_max_len)
-		{
-			strncpy(ptr_submsg->command_ver, json_cmdver_item->valuestring, version_max_len - 1);
-		}
-		else
+		cmdver_len = strlen(json_cmdver_item->valuestring);
+		if (cmdver_len >= version_max_len)
 		{
-			strncpy(ptr_submsg->command_ver, json_cmdver_item->valuestring, strlen(json_cmdver_item->valuestring));
+			cmdver_len = version_max_len - 1;
 		}
+		memcpy(ptr_submsg->command_ver, json_cmdver_item->valuestring, cmdver_len);
+		ptr_submsg->command_ver[cmdver_len] = '\0';
 
 		ptr_submsg->msg_seq = json_seq_item->valueint;
+		sdk_error = deserialize_common_compress(json_item, raw_len);
 
 	} while (0);
 
-	if (json_item != NULL)
-	{
-		bscJSON_Delete(json_item);
-		json_item = NULL;
-	}
+	bscJSON_ArenaReset(&arena);
+	json_item = NULL;
 	// 	if (comon_buf != NULL)
 	// 	{
 	// 		free(comon_buf);
@@ -423,8 +686,12 @@ static void handle_sub_msg_v3(ezdev_sdk_kernel_submsg_v3 *ptr_submsg)
 {
 	EZDEV_SDK_BOOL is_delete = EZDEV_SDK_TRUE;
 	mkernel_internal_error kernel_error = mkernel_internal_succ;
-	kernel_error = push_queue_submsg_v3(ptr_submsg);
-	if (kernel_error != mkernel_internal_succ)
+
+	if (kernel_request_complete_v3(ptr_submsg))
+	{
+		/* 设备发起的请求的响应已经在回调中交给用户, 不进入分发队列 */
+	}
+	else if ((kernel_error = push_queue_submsg_v3(ptr_submsg)) != mkernel_internal_succ)
 	{
 		ezdev_sdk_kernel_log_debug(kernel_error, 0, "push_queue_submsg v3 error,module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
 	}
@@ -451,7 +718,11 @@ static void handle_sub_msg(ezdev_sdk_kernel_submsg *ptr_submsg)
 	EZDEV_SDK_BOOL is_delete = EZDEV_SDK_TRUE;
 	mkernel_internal_error kernel_error = mkernel_internal_succ;
 
-	if (ptr_submsg->msg_domain_id == DAS_CMD_DOMAIN)
+	if (kernel_request_complete(ptr_submsg))
+	{
+		/* 设备发起的请求的响应已经在回调中交给用户, 不进入分发队列 */
+	}
+	else if (ptr_submsg->msg_domain_id == DAS_CMD_DOMAIN)
 	{
 		kernel_error = access_domain_bus_handle(ptr_submsg);
 	}
@@ -496,427 +767,1144 @@ static void handle_sub_msg(ezdev_sdk_kernel_submsg *ptr_submsg)
 	}
 }
 
-static mkernel_internal_error ezdev_parse_topic(ezdev_sdk_kernel_submsg_v3* ptr_submsg, char* topic, char* find_str)
+static mkernel_internal_error topic_level_copy(char *dst, EZDEV_SDK_UINT32 dst_size, const char *begin, const char *end)
 {
-	char* ptemp1 = NULL;
-	char* ptemp2 = NULL;
-	int temp_len = 0;
-	int find_str_len = 0;
-	mkernel_internal_error sdk_error = mkernel_internal_succ;
-	if(NULL== ptr_submsg||NULL == topic||NULL == find_str)
+	EZDEV_SDK_INT32 len = end - begin;
+	if (len <= 0 || (EZDEV_SDK_UINT32)len >= dst_size)
 	{
-       return  mkernel_internal_input_param_invalid;
+		return mkernel_internal_platform_appoint_error;
 	}
-	do
+	memcpy(dst, begin, len);
+	dst[len] = '\0';
+	return mkernel_internal_succ;
+}
+
+static mkernel_internal_error topic_level_to_int(const char *data, EZDEV_SDK_INT32 len, EZDEV_SDK_INT32 *value)
+{
+	EZDEV_SDK_INT32 i = 0;
+	EZDEV_SDK_INT32 result = 0;
+	EZDEV_SDK_INT8 negative = 0;
+
+	if (len > 0 && data[0] == '-')
 	{
-		find_str_len = strlen(find_str);
-		ptemp1 = strstr(topic, find_str);
-		if(!ptemp1)
-		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "ezdev_parse_topic, not find:%s \n", find_str);
-			sdk_error = mkernel_internal_platform_appoint_error;
-			break;
-		}
-		ptemp2 = strrchr(ptemp1, '/');
-        if(!ptemp2)
-		{
-			sdk_error = mkernel_internal_platform_appoint_error;
-			break;
-		}
-		temp_len = ptemp2 - ptemp1 - find_str_len;
-		if(temp_len <=0|| temp_len > sizeof(ptr_submsg->method))
+		negative = 1;
+		i++;
+	}
+	if (i >= len || len - i > 10)
+	{
+		return mkernel_internal_platform_appoint_error;
+	}
+	for (; i < len; i++)
+	{
+		if (data[i] < '0' || data[i] > '9')
 		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "ezdev_parse_topic temp_len, calculate err:%d \n", temp_len);
-			sdk_error = mkernel_internal_platform_appoint_error;
-			break;
+			return mkernel_internal_platform_appoint_error;
 		}
-		strncpy(ptr_submsg->msg_type, ptemp2 + 1, sizeof(ptr_submsg->msg_type)-1);
-		strncpy(ptr_submsg->method, ptemp1 + find_str_len, temp_len);
-
-	}while(0);
-    
-	return sdk_error;
+		result = result * 10 + (data[i] - '0');
+	}
+	*value = negative ? -result : result;
+	return mkernel_internal_succ;
 }
 
-static void das_message_receive_v3(MessageData *msg_data)
+#define TOPIC_LEVEL_BEGIN(levels, i) ((levels)->level[i].data)
+#define TOPIC_LEVEL_END(levels, i) ((levels)->level[i].data + (levels)->level[i].len)
+
+/**
+ * \brief  解析v3 topic, 直接使用订阅匹配时切分好的各级
+ *         /iot/{设备序列号}/{子设备序列号}/{资源id}-{资源类型}/{模块}/{方法...}/{消息类型}
+ *         /iot/{设备序列号}/{子设备序列号}/{资源id}-{资源类型}/model/{方法}/{消息类型}/{扩展字段...}
+ */
+static mkernel_internal_error ezdev_parse_topic_v3(ezdev_sdk_kernel_submsg_v3 *ptr_submsg, MQTTTopicLevels *levels)
 {
-	/**
-	* \brief  topic /{领域编号}/{指令编号}
-	*/
-	mkernel_internal_error sdk_error = mkernel_internal_succ;
-	ezdev_sdk_kernel_submsg_v3 *ptr_submsg = NULL;
-	EZDEV_SDK_INT32 division_num = 0;
-	unsigned char *output_buf = NULL;
-	EZDEV_SDK_UINT32 output_buf_len = 0;
+	const char *separator = NULL;
+	EZDEV_SDK_INT32 last = levels->count - 1;
 
-	EZDEV_SDK_UINT16 common_len = 0;
-	unsigned char common_len_buf[2];
-	memset(common_len_buf, 0, 2);
-	char find_str[32] = {0};
-	char msg_topic[512];
-	char dev_serial[ezdev_sdk_devserial_maxlen];
-	memset(msg_topic, 0, 512);
-	memset(dev_serial, 0, ezdev_sdk_devserial_maxlen);
-	do
+	if (levels->count < 8 || levels->level[0].len != 0 || levels->level[1].len != 3 || 0 != memcmp(levels->level[1].data, "iot", 3))
 	{
-		ptr_submsg = (ezdev_sdk_kernel_submsg_v3 *)malloc(sizeof(ezdev_sdk_kernel_submsg_v3));
-		if (ptr_submsg == NULL)
-		{
-			ezdev_sdk_kernel_log_debug(mkernel_internal_malloc_error, 0, "das_message_receive_v3 mallc submsg error ");
-			sdk_error = mkernel_internal_malloc_error;
-			break;
-		}
-		memset(ptr_submsg, 0, sizeof(ezdev_sdk_kernel_submsg_v3));
+		return mkernel_internal_platform_appoint_error;
+	}
 
-		if (msg_data->topicName->lenstring.len >= 512)
-		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "  recv a das v3 msg which size is too len:%d", msg_data->topicName->lenstring.len);
-			sdk_error = mkernel_internal_platform_appoint_error;
-			break;
-		}
-		strncpy(msg_topic, msg_data->topicName->lenstring.data, msg_data->topicName->lenstring.len);
-
-		ezdev_sdk_kernel_log_debug(0, 0, "das_message_receive_v3 msg_topic: %s \n", msg_topic);
-
-        division_num = sscanf(msg_topic, "/iot/%72[^/]/%72[^/]/%64[^-]-%64[^/]/%16[^/]/", dev_serial, &ptr_submsg->sub_serial, &ptr_submsg->resource_id, &ptr_submsg->resource_type, \
-            &ptr_submsg->module);
-        if (division_num != 5)
-        {
-            ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, " decode common topic err :%s\n", msg_topic);
-            sdk_error = mkernel_internal_platform_appoint_error;
-            break;
-        }
-		snprintf(find_str, 32, "%s/", ptr_submsg->module);
-        if (0 == strcmp(ptr_submsg->module, "model"))
-        {
-            division_num = sscanf(msg_topic, "/iot/%72[^/]/%72[^/]/%64[^-]-%64[^/]/model/%64[^/]/%32[^/]/%s", dev_serial, &ptr_submsg->sub_serial, &ptr_submsg->resource_id, &ptr_submsg->resource_type, \
-                                 &ptr_submsg->method, &ptr_submsg->msg_type, &ptr_submsg->ext_msg);
-            if (division_num != 7)
-            {
-                ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "decode model topic error :%s\n", msg_topic);
-                sdk_error = mkernel_internal_platform_appoint_error;
-                break;
-            }
-        }
-        else 
-        {
-		   sdk_error = ezdev_parse_topic(ptr_submsg, msg_topic, find_str);
-		   if(mkernel_internal_succ !=sdk_error)
-		   {
-			   break;
-		   }
-        }
-		/**
-		 * \brief   将整个报文解密
-		 */
-		output_buf = (unsigned char *)malloc(msg_data->message->payloadlen);
-		if (NULL == output_buf)
-		{
-			ezdev_sdk_kernel_log_debug(mkernel_internal_malloc_error, 0, "receive_v3 malloc err,module:%s\n", ptr_submsg->module);
-			sdk_error = mkernel_internal_malloc_error;
-			break;
-		}
-		memset(output_buf, 0, msg_data->message->payloadlen);
+	separator = (const char *)memchr(TOPIC_LEVEL_BEGIN(levels, 4), '-', levels->level[4].len);
+	if (NULL == separator ||
+		mkernel_internal_succ != topic_level_copy(ptr_submsg->sub_serial, sizeof(ptr_submsg->sub_serial), TOPIC_LEVEL_BEGIN(levels, 3), TOPIC_LEVEL_END(levels, 3)) ||
+		mkernel_internal_succ != topic_level_copy(ptr_submsg->resource_id, sizeof(ptr_submsg->resource_id), TOPIC_LEVEL_BEGIN(levels, 4), separator) ||
+		mkernel_internal_succ != topic_level_copy(ptr_submsg->resource_type, sizeof(ptr_submsg->resource_type), separator + 1, TOPIC_LEVEL_END(levels, 4)) ||
+		mkernel_internal_succ != topic_level_copy(ptr_submsg->module, sizeof(ptr_submsg->module), TOPIC_LEVEL_BEGIN(levels, 5), TOPIC_LEVEL_END(levels, 5)))
+	{
+		return mkernel_internal_platform_appoint_error;
+	}
 
-		sdk_error = aes_cbc_128_dec_padding(get_ezdev_sdk_kernel()->session_key, (unsigned char *)msg_data->message->payload, msg_data->message->payloadlen, output_buf, &output_buf_len);
-		if (sdk_error != mkernel_internal_succ)
-		{
-			ezdev_sdk_kernel_log_debug(sdk_error, 0, "receive_v3 aes_128_dec_padding err,module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
-			break;
-		}
-        
-		memcpy(common_len_buf, output_buf, 2);
-		common_len = deserialize_short(common_len_buf);
-		if (common_len >= output_buf_len)
-		{
-			ezdev_sdk_kernel_log_debug(mkernel_internal_rev_invalid_packet, 0, "v3  common len decode err, module:%s, seq:%d",  ptr_submsg->module, ptr_submsg->msg_seq);
-			sdk_error = mkernel_internal_rev_invalid_packet;
-			break;
-		}
-		sdk_error = deserialize_common_v3((unsigned char *)output_buf + 2, common_len, ptr_submsg);
-		if (sdk_error != mkernel_internal_succ)
+	if (0 == strcmp(ptr_submsg->module, "model"))
+	{
+		if (levels->count < 9 ||
+			mkernel_internal_succ != topic_level_copy(ptr_submsg->method, sizeof(ptr_submsg->method), TOPIC_LEVEL_BEGIN(levels, 6), TOPIC_LEVEL_END(levels, 6)) ||
+			mkernel_internal_succ != topic_level_copy(ptr_submsg->msg_type, sizeof(ptr_submsg->msg_type), TOPIC_LEVEL_BEGIN(levels, 7), TOPIC_LEVEL_END(levels, 7)) ||
+			mkernel_internal_succ != topic_level_copy(ptr_submsg->ext_msg, sizeof(ptr_submsg->ext_msg), TOPIC_LEVEL_BEGIN(levels, 8), TOPIC_LEVEL_END(levels, last)))
 		{
-			ezdev_sdk_kernel_log_debug(sdk_error, 0, "v3 deserialize_common err,module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
-			break;
+			return mkernel_internal_platform_appoint_error;
 		}
-		if (output_buf_len - 2 - common_len > 0)
+	}
+	else
+	{
+		if (mkernel_internal_succ != topic_level_copy(ptr_submsg->method, sizeof(ptr_submsg->method), TOPIC_LEVEL_BEGIN(levels, 6), TOPIC_LEVEL_END(levels, last - 1)) ||
+			mkernel_internal_succ != topic_level_copy(ptr_submsg->msg_type, sizeof(ptr_submsg->msg_type), TOPIC_LEVEL_BEGIN(levels, last), TOPIC_LEVEL_END(levels, last)))
 		{
-			memmove(output_buf, output_buf + 2 + common_len, output_buf_len - 2 - common_len);
-			memset(output_buf + output_buf_len - 2 - common_len, 0, 2 + common_len);
-			ptr_submsg->buf = output_buf;
-			ptr_submsg->buf_len = output_buf_len - 2 - common_len;
+			return mkernel_internal_platform_appoint_error;
 		}
-		else
-		{
-			/**
-			* \brief   数据为空
-			*/
-		    //数据为空包的时候不能直接返回空指针,这里malloc一个字节的空间
-			ptr_submsg->buf = malloc(sizeof(char));
-			if(NULL == ptr_submsg->buf)
-			{  
-				ezdev_sdk_kernel_log_error(mkernel_internal_malloc_error, 0, "parse das msg context is empty,malloc err");
-				sdk_error = mkernel_internal_malloc_error;
-				break;
-			}
-			memset(ptr_submsg->buf, 0 , sizeof(char));
-			ptr_submsg->buf_len = sizeof(char);
-			ezdev_sdk_kernel_log_debug(sdk_error, 0, "Recv v3 empty context  module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
+	}
 
-			free(output_buf);
-			output_buf = NULL;
-		}
-		ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_message_receive_v3 payloadlen:%lu, seq:%d", msg_data->message->payloadlen, ptr_submsg->msg_seq);
-	} while (0);
+	return mkernel_internal_succ;
+}
 
-	/**
-	* \brief   成功返回
-	*/
-	if (sdk_error == mkernel_internal_succ)
+/**
+ * \brief  解析v2 topic /{设备序列号}/{领域编号}/{指令编号}
+ */
+static mkernel_internal_error ezdev_parse_topic_v2(ezdev_sdk_kernel_submsg *ptr_submsg, MQTTTopicLevels *levels)
+{
+	if (levels->count < 4 || levels->level[0].len != 0 || levels->level[1].len <= 0 ||
+		mkernel_internal_succ != topic_level_to_int(levels->level[2].data, levels->level[2].len, &ptr_submsg->msg_domain_id) ||
+		mkernel_internal_succ != topic_level_to_int(levels->level[3].data, levels->level[3].len, &ptr_submsg->msg_command_id))
 	{
-		handle_sub_msg_v3(ptr_submsg);
-		return;
+		return mkernel_internal_platform_appoint_error;
 	}
 
-	if (ptr_submsg != NULL)
-	{
-		free(ptr_submsg);
-		ptr_submsg = NULL;
-	}
-	if (output_buf != NULL)
+	return mkernel_internal_succ;
+}
+
+/**
+ * \brief  取订阅匹配时切分好的topic, 不是经过MQTT客户端分发的消息在这里切分
+ */
+static MQTTTopicLevels *das_topic_levels(MessageData *msg_data, MQTTTopicLevels *local_levels)
+{
+	if (NULL != msg_data->topicLevels)
 	{
-		free(output_buf);
-		output_buf = NULL;
+		return msg_data->topicLevels;
 	}
+	MQTTTopicIndex_split(msg_data->topicName, local_levels);
+	return local_levels;
 }
 
-
-void das_message_receive_ex(MessageData* msg_data)
+/**
+ * \brief   会话密钥变化时重新设置GCM密钥并派生上下行iv, 密钥不变时直接复用已展开的密钥
+ */
+static mkernel_internal_error das_gcm_prepare(das_gcm_state *gcm, const unsigned char session_key[ezdev_sdk_sessionkey_len])
 {
-    ezdev_sdk_kernel_error sdk_error = ezdev_sdk_kernel_succ;
-    ezdev_sdk_kernel_submsg* ptr_submsg = NULL;
-    EZDEV_SDK_INT32 division_num = 0;
-    EZDEV_SDK_UINT16 common_len = 0;
-    unsigned char *output_buf = NULL;
-    EZDEV_SDK_UINT32 output_buf_len = 0;
-    char msg_topic[128];
-    unsigned char common_len_buf[2];
-    char dev_serial[ezdev_sdk_devserial_maxlen];
+	static const char label[] = "ezDevSDK das gcm";
+	unsigned char digest[32];
+	unsigned char material[sizeof(label) - 1 + ezdev_sdk_sessionkey_len];
 
-    memset(msg_topic, 0, 128);
-    memset(common_len_buf, 0, 2);
-    memset(dev_serial, 0, ezdev_sdk_devserial_maxlen);
+	if (gcm->ready && 0 == memcmp(gcm->key, session_key, ezdev_sdk_sessionkey_len))
+	{
+		return mkernel_internal_succ;
+	}
 
-    if(msg_data == NULL)
+	if (gcm->ready)
 	{
-		goto fail;
+		bscomptls_gcm_free(&gcm->ctx);
 	}
-    ptr_submsg = (ezdev_sdk_kernel_submsg*)malloc(sizeof(ezdev_sdk_kernel_submsg));
-    if (ptr_submsg == NULL)
-    {
-        ezdev_sdk_kernel_log_debug(ezdev_sdk_kernel_memory, 0, "das_message_receive_ex mallc submsg error ");
-        sdk_error = ezdev_sdk_kernel_memory;
-        goto fail;
-    }
-    memset(ptr_submsg, 0, sizeof(ezdev_sdk_kernel_submsg));
-	if (msg_data->topicName->lenstring.len >= 128)
+	memset(gcm, 0, sizeof(das_gcm_state));
+	bscomptls_gcm_init(&gcm->ctx);
+	if (0 != bscomptls_gcm_setkey(&gcm->ctx, BSCOMPTLS_CIPHER_ID_AES, session_key, ezdev_sdk_sessionkey_len * 8))
 	{
-		ezdev_sdk_kernel_log_error(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex recv a msg which size is too len:%d\n", msg_data->topicName->lenstring.len);
-		sdk_error = ezdev_sdk_kernel_data_len_range;
-		goto fail;
+		bscomptls_gcm_free(&gcm->ctx);
+		return mkernel_internal_casll_mbedtls_setdeckey_error;
 	}
 
-	strncpy(msg_topic, msg_data->topicName->lenstring.data, msg_data->topicName->lenstring.len);
+	memcpy(material, label, sizeof(label) - 1);
+	memcpy(material + sizeof(label) - 1, session_key, ezdev_sdk_sessionkey_len);
+	bscomptls_sha256(material, sizeof(material), digest, 0);
+	memcpy(gcm->iv_up, digest, das_gcm_iv_len);
+	memcpy(gcm->iv_down, digest + das_gcm_iv_len, das_gcm_iv_len);
+	memcpy(gcm->key, session_key, ezdev_sdk_sessionkey_len);
+	gcm->ready = 1;
+
+	return mkernel_internal_succ;
+}
 
-	division_num = sscanf(msg_topic, "/%16[^/]/%d/%d", dev_serial, &ptr_submsg->msg_domain_id, &ptr_submsg->msg_command_id);
-	if (division_num != 3)
+/**
+ * \brief   换一个随机的发送随机数并从0开始计数, 每次注册DAS或计数回绕时调用
+ */
+static mkernel_internal_error das_gcm_new_salt(das_gcm_state *gcm)
+{
+	if (0 != kernel_rng_random(NULL, gcm->send_salt, das_gcm_salt_len))
 	{
-		ezdev_sdk_kernel_log_error(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex decode topicName error :%s\n", msg_topic);
-		sdk_error = ezdev_sdk_kernel_data_len_range;
-		goto fail;
+		gcm->send_ready = 0;
+		return mkernel_internal_internal_err;
 	}
-	output_buf = (unsigned char *)malloc(msg_data->message->payloadlen);
-	if ( NULL == output_buf )
+	gcm->send_count = 0;
+	gcm->send_ready = 1;
+
+	return mkernel_internal_succ;
+}
+
+static void das_gcm_nonce(const unsigned char iv[das_gcm_iv_len], const unsigned char seq[ezdev_sdk_das_gcm_seq_len], unsigned char nonce[das_gcm_iv_len])
+{
+	EZDEV_SDK_UINT32 i = 0;
+
+	for (i = 0; i < das_gcm_iv_len; i++)
 	{
-		ezdev_sdk_kernel_log_debug(ezdev_sdk_kernel_memory, 0, "das_message_receive_ex malloc error,domain:%d, cmd:%d, lenstring len:%d \n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id, msg_data->topicName->lenstring.len);
-		sdk_error = ezdev_sdk_kernel_memory;
-		goto fail;
+		nonce[i] = iv[i] ^ seq[i];
 	}
-	memset(output_buf, 0, msg_data->message->payloadlen);
+}
+
+static EZDEV_SDK_UINT32 das_gcm_seq_count(const unsigned char seq[ezdev_sdk_das_gcm_seq_len])
+{
+	const unsigned char *p = seq + das_gcm_salt_len;
+
+	return ((EZDEV_SDK_UINT32)p[0] << 24) | ((EZDEV_SDK_UINT32)p[1] << 16) | ((EZDEV_SDK_UINT32)p[2] << 8) | p[3];
+}
+
+/**
+ * \brief   解密前检查下行报文头是否可能是重放, 只读不改窗口
+ */
+static EZDEV_SDK_BOOL das_gcm_window_check(const das_gcm_window *window, const unsigned char seq[ezdev_sdk_das_gcm_seq_len])
+{
+	EZDEV_SDK_UINT32 count = das_gcm_seq_count(seq);
+	EZDEV_SDK_UINT8 i = 0;
 
-	sdk_error = aes_cbc_128_dec_padding(get_ezdev_sdk_kernel()->session_key, (unsigned char*)msg_data->message->payload, msg_data->message->payloadlen, output_buf, &output_buf_len);
-	if (sdk_error != ezdev_sdk_kernel_succ)
+	if (!window->ready || 0 != memcmp(window->salt, seq, das_gcm_salt_len))
 	{
-		ezdev_sdk_kernel_log_debug(sdk_error, 0, "das_message_receive_ex aes_cbc_128_dec_padding error,domain:%d, cmd:%d", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
-		goto fail;
+		for (i = 0; i < window->retired_count; i++)
+		{
+			if (0 == memcmp(window->retired[i], seq, das_gcm_salt_len))
+			{
+				return EZDEV_SDK_FALSE;
+			}
+		}
+		return EZDEV_SDK_TRUE;
 	}
 
-	memcpy(common_len_buf, output_buf, 2);
-	common_len = deserialize_short(common_len_buf);
-	if (common_len >= output_buf_len)
+	if (count > window->top)
 	{
-		ezdev_sdk_kernel_log_debug(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex decode error common len, domain:%d, cmd:%d", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
-		sdk_error = ezdev_sdk_kernel_data_len_range;
-		goto fail;
+		return EZDEV_SDK_TRUE;
 	}
-	sdk_error = deserialize_common((unsigned char*)output_buf + 2, common_len, ptr_submsg);
-	if (sdk_error != ezdev_sdk_kernel_succ)
+	if (window->top - count >= das_gcm_replay_window)
 	{
-		ezdev_sdk_kernel_log_debug(sdk_error, 0, "das_message_receive_ex deserialize_common error,domain:%d, cmd:%d", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
-		goto fail;
+		return EZDEV_SDK_FALSE;
+	}
+	return 0 == (window->bitmap & ((EZDEV_SDK_UINT32)1 << (window->top - count)));
+}
+
+/**
+ * \brief   tag校验通过后才把报文头记入窗口, 伪造的报文不能挤掉真实的随机数
+ */
+static void das_gcm_window_accept(das_gcm_window *window, const unsigned char seq[ezdev_sdk_das_gcm_seq_len])
+{
+	EZDEV_SDK_UINT32 count = das_gcm_seq_count(seq);
+	EZDEV_SDK_UINT32 shift = 0;
+
+	if (!window->ready || 0 != memcmp(window->salt, seq, das_gcm_salt_len))
+	{
+		if (window->ready)
+		{
+			memcpy(window->retired[window->retired_next], window->salt, das_gcm_salt_len);
+			window->retired_next = (window->retired_next + 1) % das_gcm_retired_max;
+			if (window->retired_count < das_gcm_retired_max)
+			{
+				window->retired_count++;
+			}
+		}
+		memcpy(window->salt, seq, das_gcm_salt_len);
+		window->top = count;
+		window->bitmap = 1;
+		window->ready = 1;
+		return;
 	}
-	if (output_buf_len - 2 - common_len > 0)
+
+	if (count > window->top)
 	{
-		memmove(output_buf, output_buf + 2 + common_len, output_buf_len - 2 - common_len);
-		memset(output_buf + output_buf_len - 2 - common_len, 0, 2 + common_len);
-		ptr_submsg->buf = output_buf;
-		ptr_submsg->buf_len = output_buf_len - 2 - common_len;
+		shift = count - window->top;
+		window->bitmap = shift >= das_gcm_replay_window ? 1 : ((window->bitmap << shift) | 1);
+		window->top = count;
 	}
 	else
 	{
-		ptr_submsg->buf = NULL;
-		ptr_submsg->buf_len = 0;
-
-		free(output_buf);
-		output_buf = NULL;
+		window->bitmap |= (EZDEV_SDK_UINT32)1 << (window->top - count);
 	}
-	ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_message_receive_ex msg_topic:%s, seq:%d\n", msg_topic, ptr_submsg->msg_seq);
-    
-    if (sdk_error == ezdev_sdk_kernel_succ)
-    {
-        if (ptr_submsg->msg_domain_id == 1001)
-        {
-            common_module_bus_handle(ptr_submsg);
-        }
-    	ezdev_sdk_kernel_domain_info* kernel_domain = extend_get(ptr_submsg->msg_domain_id);
-
-        if (kernel_domain)
-        {
-            kernel_domain->kernel_extend.ezdev_sdk_kernel_extend_data_route(ptr_submsg, kernel_domain->kernel_extend.pUser);
-        }
-        else
-        {
-            ezdev_sdk_kernel_log_error(0,0,"das_message_receive_ex find domain error %d\n", ptr_submsg->msg_domain_id);
-        }
-    }
-fail:
-    ezdev_sdk_kernel_log_error(sdk_error, sdk_error,"das_message_receive_ex end\n");
+}
 
-	if (ptr_submsg != NULL)
+static void das_gcm_fini(das_gcm_state *gcm)
+{
+	if (gcm->ready)
 	{
-		free(ptr_submsg);
-		ptr_submsg = NULL;
+		bscomptls_gcm_free(&gcm->ctx);
 	}
-	if (output_buf != NULL)
+	memset(gcm, 0, sizeof(das_gcm_state));
+}
+
+static void das_key_drop_prev()
+{
+	memset(g_das_key.prev_key, 0, ezdev_sdk_sessionkey_len);
+	g_das_key.prev_valid = 0;
+	das_gcm_fini(&g_das_gcm_prev);
+}
+
+/**
+ * \brief   会话密钥被完整注册流程换掉时(LBS重定向、快速上线), 代数和宽限状态从头开始
+ */
+static void das_key_sync(ezdev_sdk_kernel *sdk_kernel)
+{
+	if (0 == memcmp(g_das_key.key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len))
 	{
-		free(output_buf);
-		output_buf = NULL;
+		return;
 	}
+
+	das_key_drop_prev();
+	memcpy(g_das_key.key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len);
+	g_das_key.epoch = 0;
+	g_das_key.retrying = 0;
+	kernel_timer_start(&g_das_key.key_timer, 0);
 }
 
+/* 用到有效期的3/4就换, 留出失败重试的时间 */
+static EZDEV_SDK_UINT32 das_key_due_ms(EZDEV_SDK_UINT32 lifetime)
+{
+	return lifetime >= 0x7FFFFFFF / 750 ? 0x7FFFFFFF : lifetime * 750;
+}
 
-static void das_message_receive(MessageData *msg_data)
+EZDEV_SDK_BOOL das_key_rotate_due(ezdev_sdk_kernel *sdk_kernel)
 {
-	/**
-	* \brief  topic /{领域编号}/{指令编号}
-	*/
-	mkernel_internal_error sdk_error = mkernel_internal_succ;
-	ezdev_sdk_kernel_submsg *ptr_submsg = NULL;
-	EZDEV_SDK_INT32 division_num = 0;
-	EZDEV_SDK_UINT16 common_len = 0;
-	unsigned char *output_buf = NULL;
-	EZDEV_SDK_UINT32 output_buf_len = 0;
-	char msg_topic[128];
-	unsigned char common_len_buf[2];
-	char dev_serial[ezdev_sdk_devserial_maxlen];
-
-	memset(msg_topic, 0, 128);
-	memset(common_len_buf, 0, 2);
-	memset(dev_serial, 0, ezdev_sdk_devserial_maxlen);
-	do
+	EZDEV_SDK_UINT32 lifetime = sdk_kernel->redirect_das_info.das_key_lifetime;
+
+	if (0 == lifetime)
 	{
-		ptr_submsg = (ezdev_sdk_kernel_submsg *)malloc(sizeof(ezdev_sdk_kernel_submsg));
-		if (ptr_submsg == NULL)
-		{
-			ezdev_sdk_kernel_log_debug(mkernel_internal_malloc_error, 0, "das_message_receive mallc submsg error ");
-			sdk_error = mkernel_internal_malloc_error;
-			break;
-		}
-		memset(ptr_submsg, 0, sizeof(ezdev_sdk_kernel_submsg));
+		return EZDEV_SDK_FALSE;
+	}
 
-		if (msg_data->topicName->lenstring.len >= 128)
-		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "das_message_receive recv a msg which size is too len:%d\n", msg_data->topicName->lenstring.len);
-			sdk_error = mkernel_internal_platform_appoint_error;
-			break;
-		}
+	das_key_sync(sdk_kernel);
+	if (g_das_key.retrying && !kernel_timer_expired_bydiff(&g_das_key.retry_timer, ezdev_sdk_das_key_retry_ms))
+	{
+		return EZDEV_SDK_FALSE;
+	}
 
-		strncpy(msg_topic, msg_data->topicName->lenstring.data, msg_data->topicName->lenstring.len);
-		division_num = sscanf(msg_topic, "/%72[^/]/%d/%d", dev_serial, &ptr_submsg->msg_domain_id, &ptr_submsg->msg_command_id);
-		if (division_num != 3)
-		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "das_message_receive decode topicName error :%s", msg_topic);
-			sdk_error = mkernel_internal_platform_appoint_error;
+	return kernel_timer_expired_bydiff(&g_das_key.key_timer, das_key_due_ms(lifetime));
+}
+
+/**
+ * \brief   离下一次das_key_rotate_due成立还有多久, 没有密钥有效期或者已经到期(正在换)时返回0xFFFFFFFF
+ */
+static EZDEV_SDK_UINT32 das_key_rotate_left(ezdev_sdk_kernel *sdk_kernel)
+{
+	EZDEV_SDK_UINT32 lifetime = sdk_kernel->redirect_das_info.das_key_lifetime;
+	EZDEV_SDK_UINT32 left_ms = 0;
+	EZDEV_SDK_UINT32 retry_ms = 0;
+
+	if (0 == lifetime)
+	{
+		return 0xFFFFFFFF;
+	}
+
+	left_ms = kernel_timer_left_bydiff(&g_das_key.key_timer, das_key_due_ms(lifetime));
+	if (g_das_key.retrying)
+	{
+		retry_ms = kernel_timer_left_bydiff(&g_das_key.retry_timer, ezdev_sdk_das_key_retry_ms);
+		left_ms = retry_ms > left_ms ? retry_ms : left_ms;
+	}
+	return 0 == left_ms ? 0xFFFFFFFF : left_ms;
+}
+
+void das_key_rotate(ezdev_sdk_kernel *sdk_kernel, const unsigned char session_key[ezdev_sdk_sessionkey_len])
+{
+	das_key_sync(sdk_kernel);
+
+	/* GCM上下文里的轮密钥指针指向自身, 不能整体拷贝, 旧密钥重新展开后只把下行防重放窗口带过去,
+	   否则宽限期内可以重放旧密钥下收到过的报文. 新密钥第一次发送时重新派生iv并换一个发送随机数 */
+	das_key_drop_prev();
+	memcpy(g_das_key.prev_key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len);
+	g_das_key.prev_valid = 1;
+	kernel_timer_start(&g_das_key.prev_timer, 0);
+	if (g_das_gcm.ready && mkernel_internal_succ == das_gcm_prepare(&g_das_gcm_prev, g_das_key.prev_key))
+	{
+		memcpy(&g_das_gcm_prev.recv, &g_das_gcm.recv, sizeof(das_gcm_window));
+	}
+	das_gcm_fini(&g_das_gcm);
+
+	memcpy(sdk_kernel->session_key, session_key, ezdev_sdk_sessionkey_len);
+	memcpy(g_das_key.key, session_key, ezdev_sdk_sessionkey_len);
+	g_das_key.epoch++;
+	g_das_key.retrying = 0;
+	kernel_timer_start(&g_das_key.key_timer, 0);
+
+	ezdev_sdk_kernel_log_info(0, 0, "das session key rotated, epoch:%u", g_das_key.epoch);
+}
+
+void das_key_rotate_failed()
+{
+	g_das_key.retrying = 1;
+	kernel_timer_start(&g_das_key.retry_timer, 0);
+}
+
+/**
+ * \brief   协商了压缩且业务数据足够大时, 在加密前压缩业务数据
+ * \note    压缩后省不下1/16时放弃, 省下的字节不够抵消通用协议体里多出的字段; 分配内存失败也按不压缩发送
+ * \param[out] zbody      压缩后的业务数据, 没有压缩时为NULL, 由调用者释放
+ * \param[out] zbody_len  压缩后的长度
+ */
+static void das_payload_compress(ezdev_sdk_kernel *sdk_kernel, const unsigned char *body, EZDEV_SDK_UINT32 body_len,
+								 unsigned char **zbody, EZDEV_SDK_UINT32 *zbody_len)
+{
+	unsigned char *buf = NULL;
+
+	*zbody = NULL;
+	*zbody_len = 0;
+	if (sdk_kernel->redirect_das_info.das_compress != ezdev_sdk_das_compress_lz4 || body_len < ezdev_sdk_das_compress_threshold)
+	{
+		return;
+	}
+
+	buf = (unsigned char *)malloc(body_len);
+	if (NULL == buf)
+	{
+		return;
+	}
+
+	if (mkernel_internal_succ != kernel_compress(body, body_len, buf, body_len - body_len / 16, zbody_len))
+	{
+		free(buf);
+		*zbody_len = 0;
+		return;
+	}
+
+	*zbody = buf;
+}
+
+/**
+ * \brief   按协商的加密方式组包并原地加密, 只分配一次内存
+ * \note    CBC: [补齐后的密文]
+ *          GCM: [8字节随机数][4字节计数][密文][16字节tag], 随机数和计数同时作为nonce的一部分, 不需要补齐
+ * \param[out] payload      报文, 由调用者释放
+ * \param[out] payload_len  报文长度
+ */
+static mkernel_internal_error das_payload_encrypt(ezdev_sdk_kernel *sdk_kernel, const unsigned char *common, EZDEV_SDK_UINT16 common_len,
+												  const unsigned char *body, EZDEV_SDK_UINT32 body_len, unsigned char **payload, EZDEV_SDK_UINT32 *payload_len)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	EZDEV_SDK_UINT32 plain_len = 2 + common_len + body_len;
+	EZDEV_SDK_UINT32 buf_len = 0;
+	EZDEV_SDK_UINT32 plain_off = 0;
+	EZDEV_SDK_INT8 gcm = (sdk_kernel->redirect_das_info.das_cipher == ezdev_sdk_das_cipher_gcm);
+	unsigned char *buf = NULL;
+	unsigned char *plain = NULL;
+	unsigned char nonce[das_gcm_iv_len];
+
+	do
+	{
+		if (gcm)
+		{
+			sdk_error = das_gcm_prepare(&g_das_gcm, sdk_kernel->session_key);
+			if (sdk_error != mkernel_internal_succ)
+			{
+				break;
+			}
+			if (!g_das_gcm.send_ready)
+			{
+				sdk_error = das_gcm_new_salt(&g_das_gcm);
+				if (sdk_error != mkernel_internal_succ)
+				{
+					break;
+				}
+			}
+			plain_off = ezdev_sdk_das_gcm_seq_len;
+			buf_len = ezdev_sdk_das_gcm_seq_len + plain_len + ezdev_sdk_das_gcm_tag_len;
+		}
+		else
+		{
+			buf_len = calculate_padding_len(plain_len);
+		}
+
+		buf = (unsigned char *)malloc(buf_len);
+		if (buf == NULL)
+		{
+			sdk_error = mkernel_internal_malloc_error;
+			break;
+		}
+		plain = buf + plain_off;
+		serialize_short(plain, common_len);
+		memcpy(plain + 2, common, common_len);
+		memcpy(plain + 2 + common_len, body, body_len);
+
+		if (!gcm)
+		{
+			sdk_error = aes_cbc_128_enc_padding(sdk_kernel->session_key, buf, plain_len, buf_len, buf, payload_len);
+			break;
+		}
+
+		memcpy(buf, g_das_gcm.send_salt, das_gcm_salt_len);
+		buf[das_gcm_salt_len] = (unsigned char)(g_das_gcm.send_count >> 24);
+		buf[das_gcm_salt_len + 1] = (unsigned char)(g_das_gcm.send_count >> 16);
+		buf[das_gcm_salt_len + 2] = (unsigned char)(g_das_gcm.send_count >> 8);
+		buf[das_gcm_salt_len + 3] = (unsigned char)g_das_gcm.send_count;
+		das_gcm_nonce(g_das_gcm.iv_up, buf, nonce);
+		if (0 != bscomptls_gcm_crypt_and_tag(&g_das_gcm.ctx, BSCOMPTLS_GCM_ENCRYPT, plain_len, nonce, das_gcm_iv_len, NULL, 0,
+											 plain, plain, ezdev_sdk_das_gcm_tag_len, plain + plain_len))
+		{
+			sdk_error = mkernel_internal_casll_mbedtls_crypt_error;
+			break;
+		}
+		*payload_len = buf_len;
+
+		/* 计数回绕前换一个随机数, 保证nonce不重复; 取不到随机数时下次发送再取 */
+		if (0xFFFFFFFF == g_das_gcm.send_count++)
+		{
+			das_gcm_new_salt(&g_das_gcm);
+		}
+	} while (0);
+
+	if (sdk_error != mkernel_internal_succ && buf != NULL)
+	{
+		free(buf);
+		buf = NULL;
+	}
+	*payload = buf;
+
+	return sdk_error;
+}
+
+/**
+ * \brief   CBC用错密钥解出来的明文重新加密一遍, 接收缓冲区还原成原来的密文, 留给另一个密钥再试
+ * \note    CBC加密是确定的(固定IV), 解密结果按原长度重新加密得到的就是原来的密文, 不需要事先拷贝报文
+ */
+static void das_payload_cbc_restore(const unsigned char session_key[ezdev_sdk_sessionkey_len], unsigned char *payload, EZDEV_SDK_UINT32 payload_len)
+{
+	EZDEV_SDK_UINT32 len = 0;
+
+	aes_cbc_128_enc_padding(session_key, payload, payload_len, payload_len, payload, &len);
+}
+
+/**
+ * \brief   用指定的会话密钥在接收缓冲区内原地解密整个报文
+ * \note    CBC解密逐块进行且先保存密文作为下一块的IV,输入输出可以是同一块内存,报文末尾至少有1字节填充;
+ *          GCM先按防重放窗口检查报文头, 解密的同时算出tag再比较, 校验通过后才更新窗口, 明文之后是tag的位置.
+ *          失败时接收缓冲区仍是原来的密文: CBC补齐不对时重新加密还原, GCM的tag不对时用同一个nonce再做一遍CTR还原
+ * \param[in]  payload       报文,解密后被明文覆盖
+ * \param[in]  payload_len   报文长度
+ * \param[out] plain         明文起始位置
+ * \param[out] plain_len     明文长度
+ */
+static mkernel_internal_error das_payload_open(ezdev_sdk_kernel *sdk_kernel, const unsigned char session_key[ezdev_sdk_sessionkey_len], das_gcm_state *gcm,
+										   unsigned char *payload, EZDEV_SDK_UINT32 payload_len, unsigned char **plain, EZDEV_SDK_UINT32 *plain_len)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	unsigned char nonce[das_gcm_iv_len];
+	unsigned char tag[ezdev_sdk_das_gcm_tag_len];
+	unsigned char diff = 0;
+	EZDEV_SDK_UINT32 i = 0;
+
+	do
+	{
+		if (sdk_kernel->redirect_das_info.das_cipher != ezdev_sdk_das_cipher_gcm)
+		{
+			sdk_error = aes_cbc_128_dec_padding(session_key, payload, payload_len, payload, plain_len);
+			if (mkernel_internal_aes_padding_unmatched == sdk_error)
+			{
+				das_payload_cbc_restore(session_key, payload, payload_len);
+			}
+			*plain = payload;
+			break;
+		}
+
+		if (payload_len < ezdev_sdk_das_gcm_seq_len + ezdev_sdk_das_gcm_tag_len)
+		{
+			sdk_error = mkernel_internal_rev_invalid_packet;
+			break;
+		}
+		sdk_error = das_gcm_prepare(gcm, session_key);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			break;
+		}
+		*plain_len = payload_len - ezdev_sdk_das_gcm_seq_len - ezdev_sdk_das_gcm_tag_len;
+		*plain = payload + ezdev_sdk_das_gcm_seq_len;
+		if (!das_gcm_window_check(&gcm->recv, payload))
+		{
+			ezdev_sdk_kernel_log_warn(mkernel_internal_rev_invalid_packet, 0, "das gcm replayed packet dropped, count:%u", das_gcm_seq_count(payload));
+			sdk_error = mkernel_internal_rev_invalid_packet;
+			break;
+		}
+		das_gcm_nonce(gcm->iv_down, payload, nonce);
+		if (0 != bscomptls_gcm_crypt_and_tag(&gcm->ctx, BSCOMPTLS_GCM_DECRYPT, *plain_len, nonce, das_gcm_iv_len, NULL, 0,
+											 *plain, *plain, ezdev_sdk_das_gcm_tag_len, tag))
+		{
+			sdk_error = mkernel_internal_casll_mbedtls_crypt_error;
+			break;
+		}
+		for (i = 0; i < ezdev_sdk_das_gcm_tag_len; i++)
+		{
+			diff |= tag[i] ^ (*plain)[*plain_len + i];
+		}
+		if (0 != diff)
+		{
+			bscomptls_gcm_crypt_and_tag(&gcm->ctx, BSCOMPTLS_GCM_ENCRYPT, *plain_len, nonce, das_gcm_iv_len, NULL, 0,
+										*plain, *plain, ezdev_sdk_das_gcm_tag_len, tag);
+			sdk_error = mkernel_internal_casll_mbedtls_crypt_error;
+			break;
+		}
+		das_gcm_window_accept(&gcm->recv, payload);
+	} while (0);
+
+	return sdk_error;
+}
+
+/**
+ * \brief   定位明文中的通用协议体和业务数据
+ * \param[out] common_len    通用协议体长度,通用协议体位于plain + 2
+ * \param[out] body_len      业务数据长度,业务数据位于plain + 2 + common_len
+ */
+static mkernel_internal_error das_payload_locate(unsigned char *plain, EZDEV_SDK_UINT32 plain_len, EZDEV_SDK_UINT16 *common_len, EZDEV_SDK_UINT32 *body_len)
+{
+	if (plain_len < 2)
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
+	*common_len = deserialize_short(plain);
+	if (*common_len >= plain_len - 1)
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
+	*body_len = plain_len - 2 - *common_len;
+	return mkernel_internal_succ;
+}
+
+/**
+ * \brief   CBC用错密钥也可能碰巧通过补齐检查, 宽限期内要求整个通用协议体能解析成JSON对象才算解对
+ * \note    在通用协议体末尾临时写'\0'用栈上arena解析, 不分配堆内存, 检查完恢复原来的字节
+ */
+static EZDEV_SDK_BOOL das_payload_common_valid(unsigned char *plain, EZDEV_SDK_UINT16 common_len)
+{
+	unsigned char arena_block[ezdev_sdk_json_arena_size];
+	bscJSON_Arena arena;
+	bscJSON *json_item = NULL;
+	unsigned char saved = plain[2 + common_len];
+	EZDEV_SDK_BOOL valid = EZDEV_SDK_FALSE;
+
+	plain[2 + common_len] = '\0';
+	bscJSON_ArenaInit(&arena, arena_block, sizeof(arena_block));
+	json_item = bscJSON_ParseWithOptsInArena((const char *)plain + 2, NULL, 1, &arena);
+	if (NULL != json_item && bscJSON_IsObject(json_item))
+	{
+		valid = EZDEV_SDK_TRUE;
+	}
+	bscJSON_ArenaReset(&arena);
+	plain[2 + common_len] = saved;
+
+	return valid;
+}
+
+/**
+ * \brief   用指定的密钥解密并定位, CBC且需要确认时再检查通用协议体; 没解对时接收缓冲区还原成密文
+ * \param[in]  confirm  CBC解出来后是否检查通用协议体, 只在宽限期内有另一个密钥可试时检查
+ * \param[out] retry    没解对且缓冲区已还原, 可以换另一个密钥再试
+ */
+static mkernel_internal_error das_payload_decrypt_key(ezdev_sdk_kernel *sdk_kernel, const unsigned char session_key[ezdev_sdk_sessionkey_len], das_gcm_state *gcm, EZDEV_SDK_INT8 confirm,
+												  unsigned char *payload, EZDEV_SDK_UINT32 payload_len, unsigned char **plain, EZDEV_SDK_UINT16 *common_len, EZDEV_SDK_UINT32 *body_len, EZDEV_SDK_INT8 *retry)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	EZDEV_SDK_UINT32 plain_len = 0;
+
+	*retry = 0;
+	sdk_error = das_payload_open(sdk_kernel, session_key, gcm, payload, payload_len, plain, &plain_len);
+	if (sdk_error != mkernel_internal_succ)
+	{
+		*retry = 1;
+		return sdk_error;
+	}
+
+	/* GCM校验过tag, 解出来就是这个密钥的报文, 格式不对也不用再换密钥 */
+	sdk_error = das_payload_locate(*plain, plain_len, common_len, body_len);
+	if (confirm && sdk_kernel->redirect_das_info.das_cipher != ezdev_sdk_das_cipher_gcm &&
+		(sdk_error != mkernel_internal_succ || !das_payload_common_valid(*plain, *common_len)))
+	{
+		das_payload_cbc_restore(session_key, payload, payload_len);
+		sdk_error = mkernel_internal_rev_invalid_packet;
+		*retry = 1;
+	}
+
+	return sdk_error;
+}
+
+/**
+ * \brief   在接收缓冲区内原地解密整个报文,并定位通用协议体和业务数据, 业务数据之后写入'\0'方便上层按字符串解析
+ * \note    先用当前密钥解; 更换会话密钥后的宽限期内, 当前密钥解不开时接收缓冲区已还原成密文, 再用旧密钥解一次.
+ *          宽限期外只试当前密钥, 每个报文没有额外的拷贝和内存分配
+ */
+static mkernel_internal_error das_payload_decrypt_inplace(unsigned char *payload, EZDEV_SDK_UINT32 payload_len, unsigned char **plain, EZDEV_SDK_UINT16 *common_len, EZDEV_SDK_UINT32 *body_len)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	ezdev_sdk_kernel *sdk_kernel = get_ezdev_sdk_kernel();
+	EZDEV_SDK_INT8 retry = 0;
+
+	das_key_sync(sdk_kernel);
+	if (g_das_key.prev_valid && kernel_timer_expired_bydiff(&g_das_key.prev_timer, ezdev_sdk_das_key_grace_ms))
+	{
+		das_key_drop_prev();
+	}
+
+	sdk_error = das_payload_decrypt_key(sdk_kernel, sdk_kernel->session_key, &g_das_gcm, g_das_key.prev_valid, payload, payload_len, plain, common_len, body_len, &retry);
+	if (sdk_error != mkernel_internal_succ && retry && g_das_key.prev_valid)
+	{
+		sdk_error = das_payload_decrypt_key(sdk_kernel, g_das_key.prev_key, &g_das_gcm_prev, 1, payload, payload_len, plain, common_len, body_len, &retry);
+	}
+	if (sdk_error == mkernel_internal_succ)
+	{
+		(*plain)[2 + *common_len + *body_len] = '\0';
+	}
+
+	return sdk_error;
+}
+
+/**
+ * \brief   将业务数据拷贝到队列消息中,接收缓冲区在下一次读取时会被覆盖
+ * \note    raw_len不为0时业务数据是压缩过的, 直接解压到新分配的缓冲区;
+ *          原始长度不能超过接收缓冲区, 压缩比不能超过ezdev_sdk_das_compress_ratio_max, 否则按非法报文处理
+ */
+static mkernel_internal_error das_payload_body_dup(const unsigned char *body, EZDEV_SDK_UINT32 body_len, EZDEV_SDK_UINT32 raw_len, void **buf, EZDEV_SDK_UINT32 *buf_len)
+{
+	unsigned char *dup_buf = NULL;
+	EZDEV_SDK_UINT32 dup_len = body_len;
+
+	if (0 != raw_len)
+	{
+		if (raw_len > ezdev_sdk_recv_buf_max || raw_len / ezdev_sdk_das_compress_ratio_max > body_len)
+		{
+			ezdev_sdk_kernel_log_error(mkernel_internal_rev_invalid_packet, 0, "compressed body rejected, len:%d, raw len:%d", body_len, raw_len);
+			return mkernel_internal_rev_invalid_packet;
+		}
+		dup_len = raw_len;
+	}
+
+	//数据为空包的时候不能直接返回空指针,这里malloc一个字节的空间
+	dup_buf = (unsigned char *)malloc(dup_len + 1);
+	if (NULL == dup_buf)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	if (0 == raw_len)
+	{
+		memcpy(dup_buf, body, body_len);
+	}
+	else if (mkernel_internal_succ != kernel_decompress(body, body_len, dup_buf, raw_len))
+	{
+		ezdev_sdk_kernel_log_error(mkernel_internal_rev_invalid_packet, 0, "decompress body error, len:%d, raw len:%d", body_len, raw_len);
+		free(dup_buf);
+		return mkernel_internal_rev_invalid_packet;
+	}
+	dup_buf[dup_len] = '\0';
+
+	*buf = dup_buf;
+	*buf_len = dup_len > 0 ? dup_len : sizeof(char);
+	return mkernel_internal_succ;
+}
+
+static void das_frag_release(das_frag_slot *slot)
+{
+	if (NULL != slot->buf)
+	{
+		free(slot->buf);
+		slot->buf = NULL;
+		g_das_frag_mem -= slot->total;
+	}
+}
+
+/**
+ * \brief   丢弃超时没有收齐的下行消息
+ */
+static void das_frag_sweep()
+{
+	EZDEV_SDK_INT32 i = 0;
+
+	for (i = 0; i < ezdev_sdk_das_frag_slots; i++)
+	{
+		if (NULL != g_das_frag[i].buf && kernel_timer_expired_bydiff(&g_das_frag[i].timer, ezdev_sdk_das_frag_timeout_ms))
+		{
+			ezdev_sdk_kernel_log_info(mkernel_internal_request_timeout, 0, "frag reassembly timeout, module:%s, id:%u, received:%u/%u",
+									  g_das_frag[i].head.module, g_das_frag[i].id, g_das_frag[i].received, g_das_frag[i].total);
+			das_frag_release(&g_das_frag[i]);
+		}
+	}
+}
+
+static EZDEV_SDK_BOOL das_frag_match(const das_frag_slot *slot, const ezdev_sdk_kernel_submsg_v3 *submsg, EZDEV_SDK_UINT32 id)
+{
+	return NULL != slot->buf && slot->id == id && 0 == strcmp(slot->head.module, submsg->module) &&
+		   0 == strcmp(slot->head.resource_id, submsg->resource_id) && 0 == strcmp(slot->head.resource_type, submsg->resource_type) &&
+		   0 == strcmp(slot->head.sub_serial, submsg->sub_serial) && 0 == strcmp(slot->head.method, submsg->method) &&
+		   0 == strcmp(slot->head.msg_type, submsg->msg_type) && 0 == strcmp(slot->head.ext_msg, submsg->ext_msg);
+}
+
+/**
+ * \brief   把一个分片放进重组缓冲区, 收齐后把整条消息交给ptr_submsg
+ * \note    分片必须按顺序到达: offset小于已收长度的是QoS1重发, 忽略; offset为0表示对端从头重发, 重新开始;
+ *          跳过了数据的按非法报文处理并丢弃整条消息. 重组缓冲区合计不超过ezdev_sdk_das_frag_recv_max
+ * \param[out] complete  整条消息已经收齐, 业务数据在ptr_submsg->buf
+ */
+static mkernel_internal_error das_frag_assemble(ezdev_sdk_kernel_submsg_v3 *ptr_submsg, const das_frag_info *frag, const unsigned char *body, EZDEV_SDK_UINT32 body_len,
+												EZDEV_SDK_BOOL *complete)
+{
+	das_frag_slot *slot = NULL;
+	EZDEV_SDK_INT32 i = 0;
+
+	*complete = EZDEV_SDK_FALSE;
+	das_frag_sweep();
+
+	if (0 == body_len || body_len > frag->total - frag->offset)
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
+
+	for (i = 0; i < ezdev_sdk_das_frag_slots; i++)
+	{
+		if (das_frag_match(&g_das_frag[i], ptr_submsg, frag->id))
+		{
+			slot = &g_das_frag[i];
+			break;
+		}
+	}
+
+	if (0 == frag->offset)
+	{
+		if (NULL != slot)
+		{
+			das_frag_release(slot);
+		}
+		for (i = 0; NULL == slot && i < ezdev_sdk_das_frag_slots; i++)
+		{
+			if (NULL == g_das_frag[i].buf)
+			{
+				slot = &g_das_frag[i];
+			}
+		}
+		if (NULL == slot || frag->total > ezdev_sdk_das_frag_recv_max - g_das_frag_mem)
+		{
+			ezdev_sdk_kernel_log_error(mkernel_internal_mem_lack, 0, "frag reassembly busy, module:%s, total:%u, in use:%u", ptr_submsg->module, frag->total, g_das_frag_mem);
+			return mkernel_internal_mem_lack;
+		}
+
+		slot->buf = (unsigned char *)malloc(frag->total + 1);
+		if (NULL == slot->buf)
+		{
+			return mkernel_internal_malloc_error;
+		}
+		g_das_frag_mem += frag->total;
+		memcpy(&slot->head, ptr_submsg, sizeof(ezdev_sdk_kernel_submsg_v3));
+		slot->id = frag->id;
+		slot->total = frag->total;
+		slot->received = 0;
+		kernel_timer_start(&slot->timer, 0);
+	}
+	else if (NULL == slot || frag->total != slot->total || frag->offset > slot->received)
+	{
+		ezdev_sdk_kernel_log_error(mkernel_internal_rev_invalid_packet, 0, "frag out of order, module:%s, id:%u, offset:%u", ptr_submsg->module, frag->id, frag->offset);
+		if (NULL != slot)
+		{
+			das_frag_release(slot);
+		}
+		return mkernel_internal_rev_invalid_packet;
+	}
+	else if (frag->offset < slot->received)
+	{
+		return mkernel_internal_succ;
+	}
+
+	memcpy(slot->buf + slot->received, body, body_len);
+	slot->received += body_len;
+	if (slot->received < slot->total)
+	{
+		return mkernel_internal_succ;
+	}
+
+	/* 收齐了, 缓冲区连同第一个分片的seq交给消息 */
+	slot->buf[slot->total] = '\0';
+	ptr_submsg->msg_seq = slot->head.msg_seq;
+	ptr_submsg->buf = slot->buf;
+	ptr_submsg->buf_len = slot->total;
+	slot->buf = NULL;
+	g_das_frag_mem -= slot->total;
+	*complete = EZDEV_SDK_TRUE;
+
+	return mkernel_internal_succ;
+}
+
+static void das_frag_fini()
+{
+	EZDEV_SDK_INT32 i = 0;
+
+	for (i = 0; i < ezdev_sdk_das_frag_slots; i++)
+	{
+		das_frag_release(&g_das_frag[i]);
+	}
+	memset(g_das_frag, 0, sizeof(g_das_frag));
+	g_das_frag_mem = 0;
+}
+
+static void das_message_receive_v3(MessageData *msg_data)
+{
+	/**
+	* \brief  topic /{领域编号}/{指令编号}
+	*/
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	ezdev_sdk_kernel_submsg_v3 *ptr_submsg = NULL;
+	unsigned char *payload = (unsigned char *)msg_data->message->payload;
+	unsigned char *plain = NULL;
+	EZDEV_SDK_UINT32 body_len = 0;
+	EZDEV_SDK_UINT32 raw_len = 0;
+	das_frag_info frag;
+	EZDEV_SDK_BOOL complete = EZDEV_SDK_TRUE;
+
+	EZDEV_SDK_UINT16 common_len = 0;
+	MQTTTopicLevels local_levels;
+	MQTTTopicLevels *levels = NULL;
+	EZDEV_SDK_INT32 topic_len = msg_data->topicName->lenstring.len;
+	const char *topic = msg_data->topicName->lenstring.data;
+	do
+	{
+		ptr_submsg = (ezdev_sdk_kernel_submsg_v3 *)malloc(sizeof(ezdev_sdk_kernel_submsg_v3));
+		if (ptr_submsg == NULL)
+		{
+			ezdev_sdk_kernel_log_debug(mkernel_internal_malloc_error, 0, "das_message_receive_v3 mallc submsg error ");
+			sdk_error = mkernel_internal_malloc_error;
+			break;
+		}
+		memset(ptr_submsg, 0, sizeof(ezdev_sdk_kernel_submsg_v3));
+
+		if (topic_len >= 512)
+		{
+			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "  recv a das v3 msg which size is too len:%d", topic_len);
+			sdk_error = mkernel_internal_platform_appoint_error;
+			break;
+		}
+
+		ezdev_sdk_kernel_log_debug(0, 0, "das_message_receive_v3 msg_topic: %.*s \n", topic_len, topic);
+
+		levels = das_topic_levels(msg_data, &local_levels);
+		sdk_error = ezdev_parse_topic_v3(ptr_submsg, levels);
+		if (mkernel_internal_succ != sdk_error)
+		{
+			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, " decode topic err :%.*s\n", topic_len, topic);
 			break;
 		}
-		
-		/**
-		 * \brief   将整个报文解密
-		 */
-		output_buf = (unsigned char *)malloc(msg_data->message->payloadlen);
-		if (NULL == output_buf)
+		/**
+		 * \brief   在接收缓冲区内将整个报文解密
+		 */
+		sdk_error = das_payload_decrypt_inplace(payload, msg_data->message->payloadlen, &plain, &common_len, &body_len);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			ezdev_sdk_kernel_log_debug(sdk_error, 0, "receive_v3 decrypt err,module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
+			break;
+		}
+		sdk_error = deserialize_common_v3(plain + 2, common_len, ptr_submsg, &raw_len, &frag);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			ezdev_sdk_kernel_log_debug(sdk_error, 0, "v3 deserialize_common err,module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
+			break;
+		}
+		/**
+		 * \brief   分片直接拷进重组缓冲区, 收齐之前不分发
+		 */
+		if (0 != frag.total)
+		{
+			sdk_error = (0 != raw_len) ? mkernel_internal_rev_invalid_packet : das_frag_assemble(ptr_submsg, &frag, plain + 2 + common_len, body_len, &complete);
+			if (sdk_error != mkernel_internal_succ)
+			{
+				ezdev_sdk_kernel_log_debug(sdk_error, 0, "receive_v3 frag err,module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
+			}
+			break;
+		}
+		/**
+		 * \brief   消息要经过队列在用户线程分发,只拷贝一次业务数据
+		 */
+		sdk_error = das_payload_body_dup(plain + 2 + common_len, body_len, raw_len, &ptr_submsg->buf, &ptr_submsg->buf_len);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "receive_v3 malloc err,module:%s\n", ptr_submsg->module);
+			break;
+		}
+		if (0 == body_len)
+		{
+			ezdev_sdk_kernel_log_debug(sdk_error, 0, "Recv v3 empty context  module:%s, seq:%d", ptr_submsg->module, ptr_submsg->msg_seq);
+		}
+		ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_message_receive_v3 payloadlen:%lu, seq:%d", msg_data->message->payloadlen, ptr_submsg->msg_seq);
+	} while (0);
+
+	/**
+	* \brief   成功返回
+	*/
+	if (sdk_error == mkernel_internal_succ && complete)
+	{
+		kernel_trace_in_v3(ptr_submsg);
+		handle_sub_msg_v3(ptr_submsg);
+		return;
+	}
+
+	if (ptr_submsg != NULL)
+	{
+		free(ptr_submsg);
+		ptr_submsg = NULL;
+	}
+}
+
+
+void das_message_receive_ex(MessageData* msg_data)
+{
+    ezdev_sdk_kernel_error sdk_error = ezdev_sdk_kernel_succ;
+    ezdev_sdk_kernel_submsg submsg;
+    EZDEV_SDK_UINT16 common_len = 0;
+    unsigned char *payload = NULL;
+    unsigned char *plain = NULL;
+    EZDEV_SDK_UINT32 body_len = 0;
+    EZDEV_SDK_UINT32 raw_len = 0;
+    MQTTTopicLevels local_levels;
+    EZDEV_SDK_INT32 topic_len = 0;
+    const char *topic = NULL;
+
+    memset(&submsg, 0, sizeof(ezdev_sdk_kernel_submsg));
+
+    if(msg_data == NULL)
+	{
+		goto fail;
+	}
+	topic_len = msg_data->topicName->lenstring.len;
+	topic = msg_data->topicName->lenstring.data;
+	if (topic_len >= 128)
+	{
+		ezdev_sdk_kernel_log_error(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex recv a msg which size is too len:%d\n", topic_len);
+		sdk_error = ezdev_sdk_kernel_data_len_range;
+		goto fail;
+	}
+
+	if (mkernel_internal_succ != ezdev_parse_topic_v2(&submsg, das_topic_levels(msg_data, &local_levels)))
+	{
+		ezdev_sdk_kernel_log_error(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex decode topicName error :%.*s\n", topic_len, topic);
+		sdk_error = ezdev_sdk_kernel_data_len_range;
+		goto fail;
+	}
+
+	payload = (unsigned char *)msg_data->message->payload;
+	if (mkernel_internal_succ != das_payload_decrypt_inplace(payload, msg_data->message->payloadlen, &plain, &common_len, &body_len))
+	{
+		ezdev_sdk_kernel_log_debug(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex decrypt error,domain:%d, cmd:%d", submsg.msg_domain_id, submsg.msg_command_id);
+		sdk_error = ezdev_sdk_kernel_data_len_range;
+		goto fail;
+	}
+	if (mkernel_internal_succ != deserialize_common(plain + 2, common_len, &submsg, &raw_len))
+	{
+		ezdev_sdk_kernel_log_debug(ezdev_sdk_kernel_data_len_range, 0, "das_message_receive_ex deserialize_common error,domain:%d, cmd:%d", submsg.msg_domain_id, submsg.msg_command_id);
+		sdk_error = ezdev_sdk_kernel_data_len_range;
+		goto fail;
+	}
+	/**
+	 * \brief   同步路由,直接借用解密后的报文,回调中需要保留时调用ezdev_sdk_kernel_submsg_retain
+	 *          压缩过的报文只能解压到新分配的缓冲区, 回调返回后没有被保留就释放
+	 */
+	if (0 != raw_len)
+	{
+		if (mkernel_internal_succ != das_payload_body_dup(plain + 2 + common_len, body_len, raw_len, &submsg.buf, &submsg.buf_len))
+		{
+			sdk_error = ezdev_sdk_kernel_data_len_range;
+			goto fail;
+		}
+		submsg.buf_type = submsg_buf_owned;
+	}
+	else if (body_len > 0)
+	{
+		submsg.buf = plain + 2 + common_len;
+		submsg.buf_len = body_len;
+		submsg.buf_type = submsg_buf_borrowed;
+	}
+	ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_message_receive_ex msg_topic:%.*s, seq:%d\n", topic_len, topic, submsg.msg_seq);
+    kernel_trace_in(&submsg);
+    
+    if (submsg.msg_domain_id == 1001)
+    {
+        common_module_bus_handle(&submsg);
+    }
+    ezdev_sdk_kernel_domain_info* kernel_domain = extend_get(submsg.msg_domain_id);
+
+    if (kernel_domain)
+    {
+        kernel_domain->kernel_extend.ezdev_sdk_kernel_extend_data_route(&submsg, kernel_domain->kernel_extend.pUser);
+    }
+    else
+    {
+        ezdev_sdk_kernel_log_error(0,0,"das_message_receive_ex find domain error %d\n", submsg.msg_domain_id);
+    }
+    if (0 != raw_len && submsg_buf_owned == submsg.buf_type && NULL != submsg.buf)
+    {
+        free(submsg.buf);
+        submsg.buf = NULL;
+    }
+fail:
+    ezdev_sdk_kernel_log_error(sdk_error, sdk_error,"das_message_receive_ex end\n");
+}
+
+
+static void das_message_receive(MessageData *msg_data)
+{
+	/**
+	* \brief  topic /{领域编号}/{指令编号}
+	*/
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	ezdev_sdk_kernel_submsg *ptr_submsg = NULL;
+	EZDEV_SDK_UINT16 common_len = 0;
+	unsigned char *payload = (unsigned char *)msg_data->message->payload;
+	unsigned char *plain = NULL;
+	EZDEV_SDK_UINT32 body_len = 0;
+	EZDEV_SDK_UINT32 raw_len = 0;
+	MQTTTopicLevels local_levels;
+	EZDEV_SDK_INT32 topic_len = msg_data->topicName->lenstring.len;
+	const char *topic = msg_data->topicName->lenstring.data;
+
+	do
+	{
+		ptr_submsg = (ezdev_sdk_kernel_submsg *)malloc(sizeof(ezdev_sdk_kernel_submsg));
+		if (ptr_submsg == NULL)
 		{
-			ezdev_sdk_kernel_log_debug(mkernel_internal_malloc_error, 0, "das_message_receive mallc error,domain:%d, cmd:%d, len:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id, msg_data->topicName->lenstring.len);
+			ezdev_sdk_kernel_log_debug(mkernel_internal_malloc_error, 0, "das_message_receive mallc submsg error ");
 			sdk_error = mkernel_internal_malloc_error;
 			break;
 		}
-		memset(output_buf, 0, msg_data->message->payloadlen);
+		memset(ptr_submsg, 0, sizeof(ezdev_sdk_kernel_submsg));
+
+		if (topic_len >= 128)
+		{
+			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "das_message_receive recv a msg which size is too len:%d\n", topic_len);
+			sdk_error = mkernel_internal_platform_appoint_error;
+			break;
+		}
 
-		sdk_error = aes_cbc_128_dec_padding(get_ezdev_sdk_kernel()->session_key, (unsigned char *)msg_data->message->payload, msg_data->message->payloadlen, output_buf, &output_buf_len);
+		sdk_error = ezdev_parse_topic_v2(ptr_submsg, das_topic_levels(msg_data, &local_levels));
 		if (sdk_error != mkernel_internal_succ)
 		{
-			ezdev_sdk_kernel_log_debug(sdk_error, 0, "das_message_receive aes_cbc_128_dec_padding error,domain:%d, cmd:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
+			ezdev_sdk_kernel_log_error(mkernel_internal_platform_appoint_error, 0, "das_message_receive decode topicName error :%.*s", topic_len, topic);
 			break;
 		}
-		memcpy(common_len_buf, output_buf, 2);
-		common_len = deserialize_short(common_len_buf);
-		if (common_len >= output_buf_len)
+		
+		/**
+		 * \brief   在接收缓冲区内将整个报文解密
+		 */
+		sdk_error = das_payload_decrypt_inplace(payload, msg_data->message->payloadlen, &plain, &common_len, &body_len);
+		if (sdk_error != mkernel_internal_succ)
 		{
-			ezdev_sdk_kernel_log_debug(mkernel_internal_rev_invalid_packet, 0, "das_message_receive decode error common len, domain:%d, cmd:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
-			sdk_error = mkernel_internal_rev_invalid_packet;
+			ezdev_sdk_kernel_log_debug(sdk_error, 0, "das_message_receive decrypt error,domain:%d, cmd:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
 			break;
 		}
-		sdk_error = deserialize_common((unsigned char *)output_buf + 2, common_len, ptr_submsg);
+		sdk_error = deserialize_common(plain + 2, common_len, ptr_submsg, &raw_len);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			ezdev_sdk_kernel_log_debug(sdk_error, 0, "das_message_receive deserialize_common error,domain:%d, cmd:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
 			break;
 		}
-		if (output_buf_len - 2 - common_len > 0)
+		sdk_error = das_payload_body_dup(plain + 2 + common_len, body_len, raw_len, &ptr_submsg->buf, &ptr_submsg->buf_len);
+		if (sdk_error != mkernel_internal_succ)
 		{
-			memmove(output_buf, output_buf + 2 + common_len, output_buf_len - 2 - common_len);
-			memset(output_buf + output_buf_len - 2 - common_len, 0, 2 + common_len);
-			ptr_submsg->buf = output_buf;
-			ptr_submsg->buf_len = output_buf_len - 2 - common_len;
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "das_message_receive malloc err,domain:%d, cmd:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id);
+			break;
 		}
-		else
+		if (0 == body_len)
 		{
-			//数据为空包的时候不能直接返回空指针,这里malloc一个字节的空间
-			ptr_submsg->buf = malloc(sizeof(char));
-			if(NULL == ptr_submsg->buf)
-			{  
-				ezdev_sdk_kernel_log_error(mkernel_internal_malloc_error, 0, "parse das msg context is empty,malloc err\n");
-				sdk_error = mkernel_internal_malloc_error;
-				break;
-			}
-			memset(ptr_submsg->buf, 0 , sizeof(char));
-			ptr_submsg->buf_len = sizeof(char);
 			ezdev_sdk_kernel_log_debug(sdk_error, 0, "Recv v2 empty context, domain_id:%d, cmd_id:%d, seq:%d\n", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id, ptr_submsg->msg_seq);
-
-			free(output_buf);
-			output_buf = NULL;
 		}
-		ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_message_receive msg_topic:%s, seq:%d\n", msg_topic, ptr_submsg->msg_seq);
+		ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_message_receive msg_topic:%.*s, seq:%d\n", topic_len, topic, ptr_submsg->msg_seq);
 	} while (0);
 
 	/**
@@ -924,6 +1912,7 @@ static void das_message_receive(MessageData *msg_data)
 	*/
 	if (sdk_error == mkernel_internal_succ)
 	{
+		kernel_trace_in(ptr_submsg);
 		handle_sub_msg(ptr_submsg);
 		return;
 	}
@@ -933,100 +1922,312 @@ static void das_message_receive(MessageData *msg_data)
 		free(ptr_submsg);
 		ptr_submsg = NULL;
 	}
-	if (output_buf != NULL)
+}
+
+/** 
+*  \brief		把回放的消息送进接收分发路径, 和从DAS收到的消息一样处理
+*  \method		das_message_inject
+*  \param[in] 	ezdev_sdk_kernel_submsg * ptr_submsg 堆上分配, 所有权交给微内核
+*/
+void das_message_inject(ezdev_sdk_kernel_submsg *ptr_submsg)
+{
+	handle_sub_msg(ptr_submsg);
+}
+
+void das_message_inject_v3(ezdev_sdk_kernel_submsg_v3 *ptr_submsg)
+{
+	handle_sub_msg_v3(ptr_submsg);
+}
+
+
+static void das_topic_append(das_topic_builder *builder, const char *data, EZDEV_SDK_UINT32 len)
+{
+	if (builder->overflow || builder->len + len >= builder->cap)
+	{
+		builder->overflow = 1;
+		return;
+	}
+	memcpy(builder->buf + builder->len, data, len);
+	builder->len += len;
+}
+
+static void das_topic_append_str(das_topic_builder *builder, const char *str)
+{
+	das_topic_append(builder, str, strlen(str));
+}
+
+/**
+ * \brief  追加定长字段里的字符串, 最多取size - 1个字节, 字段可能没有'\0'结尾
+ */
+static void das_topic_append_field(das_topic_builder *builder, const char *field, EZDEV_SDK_UINT32 size)
+{
+	const char *end = (const char *)memchr(field, '\0', size - 1);
+
+	das_topic_append(builder, field, NULL != end ? (EZDEV_SDK_UINT32)(end - field) : size - 1);
+}
+
+static void das_topic_append_char(das_topic_builder *builder, char c)
+{
+	das_topic_append(builder, &c, 1);
+}
+
+static void das_topic_append_int(das_topic_builder *builder, EZDEV_SDK_INT32 value)
+{
+	char digits[12];
+	EZDEV_SDK_UINT32 pos = sizeof(digits);
+	EZDEV_SDK_UINT32 magnitude = value < 0 ? 0U - (EZDEV_SDK_UINT32)value : (EZDEV_SDK_UINT32)value;
+
+	do
 	{
-		free(output_buf);
-		output_buf = NULL;
+		digits[--pos] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0)
+	{
+		digits[--pos] = '-';
 	}
+	das_topic_append(builder, digits + pos, sizeof(digits) - pos);
 }
 
+static void das_topic_init(das_topic_builder *builder, char *buf, EZDEV_SDK_UINT32 cap, const char *prefix, EZDEV_SDK_UINT32 prefix_len)
+{
+	builder->buf = buf;
+	builder->cap = cap;
+	builder->len = 0;
+	builder->overflow = 0;
+	das_topic_append(builder, prefix, prefix_len);
+}
 
-static mkernel_internal_error das_send_pubmsg_v3(ezdev_sdk_kernel *sdk_kernel, ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+static mkernel_internal_error das_topic_finish(das_topic_builder *builder)
+{
+	if (builder->overflow)
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+	builder->buf[builder->len] = '\0';
+	return mkernel_internal_succ;
+}
+
+/**
+ * \brief  生成topic前缀, 设备序列号在登录前已经确定
+ */
+static mkernel_internal_error das_topic_prefix_render(ezdev_sdk_kernel *sdk_kernel)
+{
+	das_topic_builder builder;
+	const char *dev_serial = sdk_kernel->dev_info.dev_subserial;
+
+	das_topic_init(&builder, g_das_topic_prefix_v3, sizeof(g_das_topic_prefix_v3), "/iot/", 5);
+	das_topic_append_field(&builder, dev_serial, sizeof(sdk_kernel->dev_info.dev_subserial));
+	das_topic_append_char(&builder, '/');
+	if (mkernel_internal_succ != das_topic_finish(&builder))
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+	g_das_topic_prefix_v3_len = builder.len;
+
+	das_topic_init(&builder, g_das_topic_prefix_v2, sizeof(g_das_topic_prefix_v2), "/", 1);
+	das_topic_append_field(&builder, dev_serial, sizeof(sdk_kernel->dev_info.dev_subserial));
+	das_topic_append_char(&builder, '/');
+	if (mkernel_internal_succ != das_topic_finish(&builder))
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+	g_das_topic_prefix_v2_len = builder.len;
+
+	return mkernel_internal_succ;
+}
+
+/**
+ * \brief  生成v3发布topic, /iot/{设备序列号}/ 登录时已生成, 这里只追加可变部分
+ */
+static mkernel_internal_error das_topic_render_v3(char *buf, EZDEV_SDK_UINT32 cap, const ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+{
+	das_topic_builder topic;
+
+	das_topic_init(&topic, buf, cap, g_das_topic_prefix_v3, g_das_topic_prefix_v3_len);
+	das_topic_append_str(&topic, strlen(pubmsg->sub_serial) > 0 ? pubmsg->sub_serial : "global");
+	das_topic_append_char(&topic, '/');
+	das_topic_append_str(&topic, pubmsg->resource_id);
+	das_topic_append_char(&topic, '-');
+	das_topic_append_str(&topic, pubmsg->resource_type);
+	das_topic_append_char(&topic, '/');
+	das_topic_append_str(&topic, pubmsg->module);
+	das_topic_append_char(&topic, '/');
+	das_topic_append_str(&topic, pubmsg->method);
+	das_topic_append_char(&topic, '/');
+	das_topic_append_str(&topic, pubmsg->msg_type);
+	if (0 == strcmp(pubmsg->module, "model"))
+	{
+		das_topic_append_char(&topic, '/');
+		das_topic_append_str(&topic, pubmsg->ext_msg);
+	}
+	return das_topic_finish(&topic);
+}
+
+/**
+ * \brief   加密一个v3报文并发布
+ */
+static mkernel_internal_error das_publish_v3(ezdev_sdk_kernel *sdk_kernel, const char *publish_topic, enum QOS_T qos, const unsigned char *common, EZDEV_SDK_UINT16 common_len,
+											 const unsigned char *body, EZDEV_SDK_UINT32 body_len)
 {
 	MQTTMessage mqtt_msg;
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	EZDEV_SDK_INT32 mqtt_result_code = 0;
-	unsigned char *common_output_buf = NULL;
-	EZDEV_SDK_UINT32 enc_output_buf_len = 0;
-	unsigned char *payload_buf = NULL;
 	unsigned char *payload_buf_enc = NULL;
-	EZDEV_SDK_UINT32 payload_buf_len = 0;
-	EZDEV_SDK_UINT16 common_output_buf_len = 0;
-	unsigned char common_len_serialize_buf[2];
-	char dev_serial[ezdev_sdk_devserial_maxlen] = {0};
-	char dev_subserial[ezdev_sdk_devserial_maxlen] = {0};
-	char publish_topic[512] ={0};
+	EZDEV_SDK_UINT32 enc_output_buf_len = 0;
+
 	do
 	{
-		memset(common_len_serialize_buf, 0, 2);
-		strncpy(dev_serial, sdk_kernel->dev_info.dev_subserial, ezdev_sdk_devserial_maxlen - 1);
-		if(strlen(pubmsg->sub_serial) > 0)
+		memset(&mqtt_msg, 0, sizeof(mqtt_msg));
+		mqtt_msg.qos = qos;
+		mqtt_msg.retained = 1; //平台不关心
+		mqtt_msg.dup = 0;
+		sdk_error = das_payload_encrypt(sdk_kernel, common, common_len, body, body_len, &payload_buf_enc, &enc_output_buf_len);
+		if (sdk_error != mkernel_internal_succ)
 		{
-			strncpy(dev_subserial, pubmsg->sub_serial, ezdev_sdk_devserial_maxlen - 1);
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "das_payload_encrypt error\n");
+			break;
 		}
-		else
+		mqtt_msg.payload = (void *)payload_buf_enc;
+		mqtt_msg.payloadlen = enc_output_buf_len;
+		mqtt_result_code = MQTTPublish(&g_DasClient, publish_topic, &mqtt_msg);
+
+		if (mqtt_result_code == MQTTPACKET_BUFFER_TOO_SHORT)
 		{
-			strncpy(dev_subserial, "global", strlen("global") + 1);
+			ezdev_sdk_kernel_log_error(mkernel_internal_call_mqtt_buffer_too_short, mqtt_result_code, "mqtt buffer too short\n");
+			sdk_error = mkernel_internal_call_mqtt_buffer_too_short;
+			break;
 		}
-		if( 0 == strcmp(pubmsg->module, "model"))
+
+		if (mqtt_result_code != 0)
 		{
-			snprintf(publish_topic, 512, "/iot/%s/%s/%s-%s/model/%s/%s/%s", dev_serial, dev_subserial, pubmsg->resource_id,\
-			        pubmsg->resource_type, pubmsg->method, pubmsg->msg_type, pubmsg->ext_msg);
+			ezdev_sdk_kernel_log_error(mkernel_internal_call_mqtt_pub_error, mqtt_result_code, "mqtt publish error\n");
+			sdk_error = mkernel_internal_call_mqtt_pub_error;
+			break;
 		}
-		else
+	} while (0);
+
+	if (payload_buf_enc)
+	{
+		free(payload_buf_enc);
+		payload_buf_enc = NULL;
+	}
+	return sdk_error;
+}
+
+/**
+ * \brief   分片大小取平台下发值, 但不超过MQTT发送缓存放得下的大小
+ */
+static EZDEV_SDK_UINT32 das_frag_chunk(ezdev_sdk_kernel *sdk_kernel)
+{
+	EZDEV_SDK_UINT32 chunk = sdk_kernel->redirect_das_info.das_frag_size;
+	return chunk < ezdev_sdk_das_frag_chunk_max ? chunk : ezdev_sdk_das_frag_chunk_max;
+}
+
+/**
+ * \brief   分片发送v3消息, 每片单独组包、加密、发布, 内存占用只和分片大小有关
+ * \note    流式发送时从body_read逐片读取业务数据, 读不满按mkernel_internal_value_load_err结束;
+ *          中途发布失败时整条消息按原有流程重发, 对端收到offset为0的分片会重新开始重组
+ */
+static mkernel_internal_error das_send_pubmsg_frag_v3(ezdev_sdk_kernel *sdk_kernel, ezdev_sdk_kernel_pubmsg_v3 *pubmsg, const char *publish_topic)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	EZDEV_SDK_UINT32 chunk = das_frag_chunk(sdk_kernel);
+	EZDEV_SDK_UINT32 len = 0;
+	unsigned char *chunk_buf = NULL;
+	unsigned char *common_output_buf = NULL;
+	EZDEV_SDK_UINT16 common_output_buf_len = 0;
+	das_frag_info frag;
+
+	if (NULL == pubmsg->msg_body)
+	{
+		chunk_buf = (unsigned char *)malloc(chunk);
+		if (NULL == chunk_buf)
 		{
-			snprintf(publish_topic, 512, "/iot/%s/%s/%s-%s/%s/%s/%s", dev_serial, dev_subserial, pubmsg->resource_id,\
-			        pubmsg->resource_type, pubmsg->module, pubmsg->method, pubmsg->msg_type);
+			return mkernel_internal_malloc_error;
 		}
-		ezdev_sdk_kernel_log_debug(0, 0, "publish topic:%s\n", publish_topic);
-		memset(&mqtt_msg, 0, sizeof(mqtt_msg));
-		mqtt_msg.qos = pubmsg->msg_qos;
-		mqtt_msg.retained = 1; //平台不关心
-		mqtt_msg.dup = 0;
-		sdk_error = serialize_payload_common_v3(pubmsg->msg_seq, &common_output_buf, &common_output_buf_len);
+	}
+
+	frag.id = pubmsg->msg_seq;
+	frag.total = pubmsg->msg_body_len;
+	for (frag.offset = 0; frag.offset < frag.total; frag.offset += len)
+	{
+		len = frag.total - frag.offset < chunk ? frag.total - frag.offset : chunk;
+		if (NULL != chunk_buf && (EZDEV_SDK_INT32)len != pubmsg->body_read(chunk_buf, frag.offset, len, pubmsg->body_user))
+		{
+			ezdev_sdk_kernel_log_error(mkernel_internal_value_load_err, 0, "stream read error, module:%s, offset:%u", pubmsg->module, frag.offset);
+			sdk_error = mkernel_internal_value_load_err;
+			break;
+		}
+
+		sdk_error = serialize_payload_common_v3(pubmsg->msg_seq, 0, &frag, &common_output_buf, &common_output_buf_len);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
-		payload_buf_len = calculate_padding_len(common_output_buf_len + 2 + pubmsg->msg_body_len);
-		payload_buf = (unsigned char *)malloc(payload_buf_len);
-		payload_buf_enc = (unsigned char *)malloc(payload_buf_len);
-		if (payload_buf == NULL || payload_buf_enc == NULL)
+		sdk_error = das_publish_v3(sdk_kernel, publish_topic, pubmsg->msg_qos, common_output_buf, common_output_buf_len,
+								   NULL != chunk_buf ? chunk_buf : pubmsg->msg_body + frag.offset, len);
+		free(common_output_buf);
+		common_output_buf = NULL;
+		if (sdk_error != mkernel_internal_succ)
 		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_malloc_error, 0, "malloc payload len error\n");
-			sdk_error = mkernel_internal_malloc_error;
 			break;
 		}
-		memset(payload_buf, 0, payload_buf_len);
-		memset(payload_buf_enc, 0, payload_buf_len);
-		serialize_short(common_len_serialize_buf, common_output_buf_len);
-		memcpy(payload_buf, common_len_serialize_buf, 2);
-		memcpy(payload_buf + 2, common_output_buf, common_output_buf_len);
-		memcpy(payload_buf + 2 + common_output_buf_len, pubmsg->msg_body, pubmsg->msg_body_len);
+	}
 
-		sdk_error = aes_cbc_128_enc_padding(sdk_kernel->session_key,payload_buf, common_output_buf_len + 2 + pubmsg->msg_body_len, payload_buf_len, payload_buf_enc, &enc_output_buf_len);
-		if (sdk_error != mkernel_internal_succ)
+	if (chunk_buf)
+	{
+		free(chunk_buf);
+		chunk_buf = NULL;
+	}
+	return sdk_error;
+}
+
+static mkernel_internal_error das_send_pubmsg_v3(ezdev_sdk_kernel *sdk_kernel, ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	unsigned char *common_output_buf = NULL;
+	EZDEV_SDK_UINT16 common_output_buf_len = 0;
+	unsigned char *zbody = NULL;
+	EZDEV_SDK_UINT32 zbody_len = 0;
+	EZDEV_SDK_UINT32 frag_size = sdk_kernel->redirect_das_info.das_frag_size;
+	char publish_topic[512];
+	do
+	{
+		if (0 == g_das_topic_prefix_v3_len && mkernel_internal_succ != (sdk_error = das_topic_prefix_render(sdk_kernel)))
 		{
 			break;
 		}
-		mqtt_msg.payload = (void *)payload_buf_enc;
-		mqtt_msg.payloadlen = enc_output_buf_len;
-		mqtt_result_code = MQTTPublish(&g_DasClient, publish_topic, &mqtt_msg);
 
-		if (mqtt_result_code == MQTTPACKET_BUFFER_TOO_SHORT)
+		sdk_error = das_topic_render_v3(publish_topic, sizeof(publish_topic), pubmsg);
+		if (sdk_error != mkernel_internal_succ)
 		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_call_mqtt_buffer_too_short, mqtt_result_code, "mqtt buffer too short\n");
-			sdk_error = mkernel_internal_call_mqtt_buffer_too_short;
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "publish topic too long, module:%s\n", pubmsg->module);
 			break;
 		}
+		ezdev_sdk_kernel_log_debug(0, 0, "publish topic:%s\n", publish_topic);
 
-		if (mqtt_result_code != 0)
+		/* 流式发送和超过分片大小的消息按分片发送, 平台不支持分片时流式消息发不出去 */
+		if (NULL == pubmsg->msg_body || (0 != frag_size && pubmsg->msg_body_len > das_frag_chunk(sdk_kernel)))
 		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_call_mqtt_pub_error, mqtt_result_code, "mqtt publish error\n");
-			sdk_error = mkernel_internal_call_mqtt_pub_error;
+			if (0 == frag_size)
+			{
+				ezdev_sdk_kernel_log_error(mkernel_internal_msg_len_overrange, 0, "das not support frag, module:%s, len:%u\n", pubmsg->module, pubmsg->msg_body_len);
+				sdk_error = mkernel_internal_msg_len_overrange;
+				break;
+			}
+			sdk_error = das_send_pubmsg_frag_v3(sdk_kernel, pubmsg, publish_topic);
 			break;
 		}
 
+		das_payload_compress(sdk_kernel, pubmsg->msg_body, pubmsg->msg_body_len, &zbody, &zbody_len);
+		sdk_error = serialize_payload_common_v3(pubmsg->msg_seq, NULL != zbody ? pubmsg->msg_body_len : 0, NULL, &common_output_buf, &common_output_buf_len);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			break;
+		}
+		sdk_error = das_publish_v3(sdk_kernel, publish_topic, pubmsg->msg_qos, common_output_buf, common_output_buf_len, NULL != zbody ? zbody : pubmsg->msg_body,
+								   NULL != zbody ? zbody_len : pubmsg->msg_body_len);
 	} while (0);
     
 	if (common_output_buf)
@@ -1034,15 +2235,10 @@ static mkernel_internal_error das_send_pubmsg_v3(ezdev_sdk_kernel *sdk_kernel, e
 		free(common_output_buf);
 		common_output_buf = NULL;
 	}
-	if (payload_buf)
-	{
-		free(payload_buf);
-		payload_buf = NULL;
-	}
-	if (payload_buf_enc)
+	if (zbody)
 	{
-		free(payload_buf_enc);
-		payload_buf_enc = NULL;
+		free(zbody);
+		zbody = NULL;
 	}
 	return sdk_error;
 }
@@ -1055,17 +2251,20 @@ static mkernel_internal_error das_send_pubmsg(ezdev_sdk_kernel *sdk_kernel, ezde
 	EZDEV_SDK_INT32 mqtt_result_code = 0;
 	unsigned char *common_output_buf = NULL;
 	EZDEV_SDK_UINT32 enc_output_buf_len = 0;
-	unsigned char *payload_buf = NULL;
 	unsigned char *payload_buf_enc = NULL;
-	EZDEV_SDK_UINT32 payload_buf_len = 0;
 	EZDEV_SDK_UINT16 common_output_buf_len = 0;
 	EZDEV_SDK_INT8 msg_type = 0;
+	unsigned char *zbody = NULL;
+	EZDEV_SDK_UINT32 zbody_len = 0;
 
-	unsigned char common_len_serialize_buf[2];
 	char publish_topic[128];
-	memset(common_len_serialize_buf, 0, 2);
-	memset(publish_topic, 0, 128);
-	snprintf(publish_topic, 128, "/%d/%d", pubmsg->msg_domain_id, pubmsg->msg_command_id);
+	das_topic_builder topic;
+
+	das_topic_init(&topic, publish_topic, sizeof(publish_topic), "/", 1);
+	das_topic_append_int(&topic, pubmsg->msg_domain_id);
+	das_topic_append_char(&topic, '/');
+	das_topic_append_int(&topic, pubmsg->msg_command_id);
+	das_topic_finish(&topic);
 
 	memset(&mqtt_msg, 0, sizeof(mqtt_msg));
 	mqtt_msg.qos = pubmsg->msg_qos;
@@ -1082,32 +2281,18 @@ static mkernel_internal_error das_send_pubmsg(ezdev_sdk_kernel *sdk_kernel, ezde
 	}
 	do
 	{
-		sdk_error = serialize_payload_common(msg_type, pubmsg->command_ver, pubmsg->msg_seq, &common_output_buf, &common_output_buf_len);
+		das_payload_compress(sdk_kernel, pubmsg->msg_body, pubmsg->msg_body_len, &zbody, &zbody_len);
+		sdk_error = serialize_payload_common(msg_type, pubmsg->command_ver, pubmsg->msg_seq, NULL != zbody ? pubmsg->msg_body_len : 0,
+											 &common_output_buf, &common_output_buf_len);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
-		payload_buf_len = calculate_padding_len(common_output_buf_len + 2 + pubmsg->msg_body_len);
-		// = common_output_buf_len + 2 + pubmsg->msg_body_len;
-		payload_buf = (unsigned char *)malloc(payload_buf_len);
-		payload_buf_enc = (unsigned char *)malloc(payload_buf_len);
-		if (payload_buf == NULL || payload_buf_enc == NULL)
-		{
-			ezdev_sdk_kernel_log_error(mkernel_internal_malloc_error, 0, "malloc payload error\n");
-			sdk_error = mkernel_internal_malloc_error;
-			break;
-		}
-		memset(payload_buf, 0, payload_buf_len);
-		serialize_short(common_len_serialize_buf, common_output_buf_len);
-		memcpy(payload_buf, common_len_serialize_buf, 2);
-		memcpy(payload_buf + 2, common_output_buf, common_output_buf_len);
-		memcpy(payload_buf + 2 + common_output_buf_len, pubmsg->msg_body, pubmsg->msg_body_len);
-
-		sdk_error = aes_cbc_128_enc_padding(sdk_kernel->session_key,
-											payload_buf, common_output_buf_len + 2 + pubmsg->msg_body_len, payload_buf_len,
-											payload_buf_enc, &enc_output_buf_len);
+		sdk_error = das_payload_encrypt(sdk_kernel, common_output_buf, common_output_buf_len, NULL != zbody ? zbody : pubmsg->msg_body,
+										NULL != zbody ? zbody_len : pubmsg->msg_body_len, &payload_buf_enc, &enc_output_buf_len);
 		if (sdk_error != mkernel_internal_succ)
 		{
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "das_payload_encrypt error\n");
 			break;
 		}
 
@@ -1137,10 +2322,10 @@ static mkernel_internal_error das_send_pubmsg(ezdev_sdk_kernel *sdk_kernel, ezde
 		free(common_output_buf);
 		common_output_buf = NULL;
 	}
-	if(NULL != payload_buf)
+	if(NULL != zbody)
 	{
-		free(payload_buf);
-		payload_buf = NULL;
+		free(zbody);
+		zbody = NULL;
 	}
 	if(NULL != payload_buf_enc)
 	{
@@ -1152,6 +2337,109 @@ static mkernel_internal_error das_send_pubmsg(ezdev_sdk_kernel *sdk_kernel, ezde
 
 
 
+/* 记录最早放行时间, 限速刚开始时上报事件 */
+static void das_shaper_deferred(EZDEV_SDK_UINT32 wait_ms, EZDEV_SDK_INT8 report, sdk_send_shaped_context *shaped, EZDEV_SDK_UINT32 *min_wait)
+{
+	if (report)
+	{
+		ezdev_sdk_kernel_log_info(0, 0, "send shaped, scope:%d, module:%s, domain:%d, delay:%d\n", shaped->scope, shaped->module, shaped->domain_id, shaped->delay_ms);
+		broadcast_user_event(sdk_kernel_event_send_shaped, shaped, sizeof(sdk_send_shaped_context));
+	}
+	if (wait_ms < *min_wait)
+	{
+		*min_wait = wait_ms;
+	}
+}
+
+/**
+ * \brief  出队前做限速判断, 被限速的分道跳过, 消息留在队列中
+ * \note   control分道只扣额度不等待; 全部分道都被限速时返回mkernel_internal_queue_empty, 并按最早放行时间启动定时器
+ */
+static mkernel_internal_error das_pop_shaped_v3(ezdev_sdk_kernel_pubmsg_exchange_v3 **ptr_pubmsg_exchange)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	sdk_send_shaped_context shaped;
+	EZDEV_SDK_UINT32 min_wait = kernel_timer_forever;
+	EZDEV_SDK_UINT32 wait_ms = 0;
+	EZDEV_SDK_UINT8 skip = 0;
+	EZDEV_SDK_UINT8 lane = 0;
+	EZDEV_SDK_INT8 report = 0;
+
+	while (mkernel_internal_succ == (sdk_error = peek_queue_pubmsg_exchange_v3(ptr_pubmsg_exchange, skip, &lane)))
+	{
+		wait_ms = kernel_shaper_acquire((*ptr_pubmsg_exchange)->msg_conntext_v3.module, 0, (*ptr_pubmsg_exchange)->msg_conntext_v3.msg_body_len,
+										ezdev_sdk_queue_lane_control == lane, kernel_timer_now(), &shaped, &report);
+		if (0 == wait_ms)
+		{
+			return pop_queue_lane_pubmsg_exchange_v3(ptr_pubmsg_exchange, lane);
+		}
+
+		das_shaper_deferred(wait_ms, report, &shaped, &min_wait);
+		skip |= (1 << lane);
+	}
+
+	if (kernel_timer_forever != min_wait)
+	{
+		kernel_timer_start(&g_das_shaper_timer, min_wait);
+	}
+	*ptr_pubmsg_exchange = NULL;
+	return sdk_error;
+}
+
+static mkernel_internal_error das_pop_shaped_v2(ezdev_sdk_kernel_pubmsg_exchange **ptr_pubmsg_exchange)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	sdk_send_shaped_context shaped;
+	EZDEV_SDK_UINT32 min_wait = kernel_timer_forever;
+	EZDEV_SDK_UINT32 wait_ms = 0;
+	EZDEV_SDK_UINT8 skip = 0;
+	EZDEV_SDK_UINT8 lane = 0;
+	EZDEV_SDK_INT8 report = 0;
+
+	while (mkernel_internal_succ == (sdk_error = peek_queue_pubmsg_exchange(ptr_pubmsg_exchange, skip, &lane)))
+	{
+		wait_ms = kernel_shaper_acquire(NULL, (*ptr_pubmsg_exchange)->msg_conntext.msg_domain_id, (*ptr_pubmsg_exchange)->msg_conntext.msg_body_len,
+										ezdev_sdk_queue_lane_control == lane, kernel_timer_now(), &shaped, &report);
+		if (0 == wait_ms)
+		{
+			return pop_queue_lane_pubmsg_exchange(ptr_pubmsg_exchange, lane);
+		}
+
+		das_shaper_deferred(wait_ms, report, &shaped, &min_wait);
+		skip |= (1 << lane);
+	}
+
+	if (kernel_timer_forever != min_wait)
+	{
+		kernel_timer_start(&g_das_shaper_timer, min_wait);
+	}
+	*ptr_pubmsg_exchange = NULL;
+	return sdk_error;
+}
+
+/**
+ * \brief  拷贝等长的定长字符串字段, 源字段可能没有'\0'结尾
+ */
+#define das_copy_field(dst, src)						\
+	do													\
+	{													\
+		memcpy((dst), (src), sizeof(dst) - 1);			\
+		(dst)[sizeof(dst) - 1] = '\0';					\
+	} while (0)
+
+static void das_ack_context_v3(sdk_send_msg_ack_context_v3 *context, const ezdev_sdk_kernel_pubmsg_v3 *msg)
+{
+	context->msg_seq = msg->msg_seq;
+	context->msg_qos = msg->msg_qos;
+	das_copy_field(context->module, msg->module);
+	das_copy_field(context->resource_id, msg->resource_id);
+	das_copy_field(context->resource_type, msg->resource_type);
+	das_copy_field(context->method, msg->method);
+	das_copy_field(context->sub_serial, msg->sub_serial);
+	das_copy_field(context->msg_type, msg->msg_type);
+	das_copy_field(context->ext_msg, msg->ext_msg);
+}
+
 static mkernel_internal_error send_message_to_das_v3(ezdev_sdk_kernel *sdk_kernel)
 {
 	ezdev_sdk_kernel_pubmsg_exchange_v3 *ptr_pubmsg_exchange = NULL;
@@ -1159,7 +2447,7 @@ static mkernel_internal_error send_message_to_das_v3(ezdev_sdk_kernel *sdk_kerne
 	sdk_send_msg_ack_context_v3 context = {0};
 	do
 	{
-		if (mkernel_internal_succ != (sdk_error = pop_queue_pubmsg_exchange_v3(&ptr_pubmsg_exchange)) ||
+		if (mkernel_internal_succ != (sdk_error = das_pop_shaped_v3(&ptr_pubmsg_exchange)) ||
 			NULL == ptr_pubmsg_exchange)
 		{
 			break;
@@ -1183,16 +2471,8 @@ static mkernel_internal_error send_message_to_das_v3(ezdev_sdk_kernel *sdk_kerne
 			}
 		}
 		ezdev_sdk_kernel_log_debug(sdk_error, 0, "broadcast_runtime_err, TAG_MSG_ACK_v3");
-		context.msg_seq = ptr_pubmsg_exchange->msg_conntext_v3.msg_seq;
-		context.msg_qos = ptr_pubmsg_exchange->msg_conntext_v3.msg_qos;
-
-        strncpy(context.module, ptr_pubmsg_exchange->msg_conntext_v3.module, ezdev_sdk_module_name_len-1);
-        strncpy(context.resource_id,ptr_pubmsg_exchange->msg_conntext_v3.resource_id,ezdev_sdk_resource_id_len-1);
-		strncpy(context.resource_type, ptr_pubmsg_exchange->msg_conntext_v3.resource_type, ezdev_sdk_resource_type_len-1);
-		strncpy(context.method, ptr_pubmsg_exchange->msg_conntext_v3.method, ezdev_sdk_method_len -1);
-		strncpy(context.sub_serial, ptr_pubmsg_exchange->msg_conntext_v3.sub_serial, ezdev_sdk_max_serial_len-1);
-		strncpy(context.msg_type, ptr_pubmsg_exchange->msg_conntext_v3.msg_type, ezdev_sdk_msg_type_len - 1);
-		strncpy(context.ext_msg, ptr_pubmsg_exchange->msg_conntext_v3.ext_msg, ezdev_sdk_ext_msg_len - 1);
+		das_ack_context_v3(&context, &ptr_pubmsg_exchange->msg_conntext_v3);
+		kernel_trace_sent(context.msg_seq, mkiE2ezE(sdk_error));
 
 		if (mkernel_internal_succ != broadcast_runtime_err(TAG_MSG_ACK_V3, mkiE2ezE(sdk_error), &context, sizeof(context)))
 		{
@@ -1215,7 +2495,7 @@ static mkernel_internal_error send_message_to_das_v2(ezdev_sdk_kernel *sdk_kerne
 	sdk_send_msg_ack_context context = {0};
 	do
 	{
-		if (mkernel_internal_succ != (sdk_error = pop_queue_pubmsg_exchange(&ptr_pubmsg_exchange)) ||
+		if (mkernel_internal_succ != (sdk_error = das_pop_shaped_v2(&ptr_pubmsg_exchange)) ||
 			NULL == ptr_pubmsg_exchange)
 		{
 			break;
@@ -1253,6 +2533,7 @@ static mkernel_internal_error send_message_to_das_v2(ezdev_sdk_kernel *sdk_kerne
 		context.msg_qos = ptr_pubmsg_exchange->msg_conntext.msg_qos;
 		context.externel_ctx = ptr_pubmsg_exchange->msg_conntext.externel_ctx;
 		context.externel_ctx_len = ptr_pubmsg_exchange->msg_conntext.externel_ctx_len;
+		kernel_trace_sent(context.msg_seq, mkiE2ezE(sdk_error));
 
 		if (mkernel_internal_succ != broadcast_runtime_err(TAG_MSG_ACK, mkiE2ezE(sdk_error), &context, sizeof(context)))
 		{
@@ -1288,99 +2569,356 @@ static mkernel_internal_error das_message_send(ezdev_sdk_kernel *sdk_kernel)
 	return sdk_error;
 }
 
+static void das_will_clear(das_will_cache *cache)
+{
+	if (NULL != cache->will_message)
+	{
+		free(cache->will_message);
+	}
+	if (NULL != cache->connect_frame)
+	{
+		free(cache->connect_frame);
+	}
+	memset(cache, 0, sizeof(das_will_cache));
+}
+
+void das_reg_cache_invalidate()
+{
+	das_will_clear(&g_das_will_cache[0]);
+	das_will_clear(&g_das_will_cache[1]);
+}
+
+/**
+* \brief   按注册方式和缓存的遗嘱填写CONNECT参数, 序列化CONNECT报文和MQTTConnectSubscribeFrame都用它
+*/
+static void das_connect_options(ezdev_sdk_kernel *sdk_kernel, EZDEV_SDK_BOOL light_reg, das_will_cache *will, MQTTPacket_connectData *connectData)
+{
+	MQTTPacket_connectData init = MQTTPacket_connectData_initializer;
+
+	*connectData = init;
+	connectData->MQTTVersion = 4;
+	if (light_reg)
+	{
+		connectData->cleansession = 0;
+		connectData->willFlag = 1;
+	}
+	else
+	{
+		/**
+		* \brief	0：表示设备断线重连
+		1：表示设备重新上线
+		*/
+		connectData->cleansession = 1;
+		/**
+		* \brief	0:断线重连上线
+		1:设备重新上线，包含遗嘱消息（设备信息）
+		*/
+		connectData->willFlag = 1;
+	}
+	/**
+	* \brief		QoS0： 00	QoS1： 01	QoS2： 10	使用QoS1
+	*/
+	connectData->will.qos = 1;
+	connectData->will.retained = 1;
+
+	memset(&connectData->username, 0, sizeof(connectData->username));
+	memset(&connectData->password, 0, sizeof(connectData->password));
+	connectData->keepAliveInterval = sdk_kernel->das_keepalive_interval;
+	connectData->clientID.lenstring.data = "";
+	connectData->clientID.lenstring.len = 0;
+	connectData->username.cstring = sdk_kernel->dev_info.dev_subserial;
+	connectData->password.cstring = "test";
+
+	connectData->will.topicName.lenstring.data = will->will_topic;
+	connectData->will.topicName.lenstring.len = 128;
+	connectData->will.message.lenstring.data = (char *)will->will_message;
+	connectData->will.message.lenstring.len = will->will_message_len;
+}
+
+/**
+* \brief   取出遗嘱和CONNECT报文, 缓存失效时重新序列化并加密
+*/
+static mkernel_internal_error das_will_prepare(ezdev_sdk_kernel *sdk_kernel, EZDEV_SDK_BOOL light_reg, das_will_cache **will)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	das_will_cache *cache = &g_das_will_cache[light_reg ? 1 : 0];
+	MQTTPacket_connectData connectData;
+	int frame_size = 0;
+
+	if (cache->valid && cache->first_session == g_is_first_session && cache->keepalive == sdk_kernel->das_keepalive_interval &&
+		0 == memcmp(cache->session_key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len) &&
+		0 == memcmp(cache->dev_id, sdk_kernel->dev_id, ezdev_sdk_devid_len))
+	{
+		*will = cache;
+		return sdk_error;
+	}
+
+	das_will_clear(cache);
+	if (!light_reg)
+	{
+		sdk_error = serialize_devinfo(sdk_kernel, &cache->will_message, &cache->will_message_len);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "mqtt serialize_devinfo error\n");
+			return sdk_error;
+		}
+	}
+	else
+	{
+		sdk_error = serialize_lightreginfo(sdk_kernel, &cache->will_message, &cache->will_message_len);
+		if (sdk_error != mkernel_internal_succ)
+		{
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "serialize_lightreginfo error\n");
+			return sdk_error;
+		}
+	}
+
+	if (g_is_first_session)
+		snprintf(cache->will_topic, sizeof(cache->will_topic), "/Basic/pu2cenplt/%s/firstconnect", sdk_kernel->dev_info.dev_subserial);
+	else
+		snprintf(cache->will_topic, sizeof(cache->will_topic), "/Basic/pu2cenplt/%s/breakconnect", sdk_kernel->dev_info.dev_subserial);
+
+	das_connect_options(sdk_kernel, light_reg, cache, &connectData);
+	frame_size = MQTTPacket_len(MQTTSerialize_connectLength(&connectData));
+	cache->connect_frame = (unsigned char *)malloc(frame_size);
+	if (NULL == cache->connect_frame)
+	{
+		das_will_clear(cache);
+		ezdev_sdk_kernel_log_error(mkernel_internal_malloc_error, 0, "das connect frame malloc error\n");
+		return mkernel_internal_malloc_error;
+	}
+	cache->connect_frame_len = MQTTSerialize_connect(cache->connect_frame, frame_size, &connectData);
+	if (cache->connect_frame_len <= 0)
+	{
+		das_will_clear(cache);
+		ezdev_sdk_kernel_log_error(mkernel_internal_call_mqtt_connect, 0, "das connect frame serialize error\n");
+		return mkernel_internal_call_mqtt_connect;
+	}
+
+	cache->first_session = g_is_first_session;
+	cache->keepalive = sdk_kernel->das_keepalive_interval;
+	memcpy(cache->session_key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len);
+	memcpy(cache->dev_id, sdk_kernel->dev_id, ezdev_sdk_devid_len);
+	cache->valid = 1;
+	*will = cache;
+
+	return sdk_error;
+}
+
+static void das_standby_close()
+{
+	if (NULL != g_DasStandbyNet.my_socket)
+	{
+		MQTTNetDisconnect(&g_DasStandbyNet);
+		MQTTNetFini(&g_DasStandbyNet);
+	}
+}
+
+/**
+* \brief   后台任务: 只读写自己的参数, 连上或失败都结束
+*/
+static void das_standby_connect_task(void *arg)
+{
+	das_standby_conn *conn = (das_standby_conn *)arg;
+
+	if (mkernel_internal_succ != MQTTNetConnect(&conn->net, conn->address, conn->port))
+	{
+		conn->net.my_socket = NULL;
+	}
+}
+
+/**
+* \brief   后台任务结束时取走它连好的连接, 作为备用连接; 任务还在连接时不等待, 返回EZDEV_SDK_TRUE
+*/
+static EZDEV_SDK_BOOL das_standby_collect()
+{
+	kernel_job_state state = kernel_job_poll(&g_das_standby_job);
+
+	if (kernel_job_finished != state)
+	{
+		return kernel_job_running == state;
+	}
+	if (NULL == g_das_standby_conn.net.my_socket)
+	{
+		ezdev_sdk_kernel_log_warn(0, 0, "das standby link %s:%d connect failed\n", g_das_standby_conn.address, g_das_standby_conn.port);
+		return EZDEV_SDK_FALSE;
+	}
+
+	das_standby_close();
+	g_DasStandbyNet.my_socket = g_das_standby_conn.net.my_socket;
+	g_das_standby_conn.net.my_socket = NULL;
+	memcpy(g_das_standby_address, g_das_standby_conn.address, ezdev_sdk_ip_max_len);
+	g_das_standby_port = g_das_standby_conn.port;
+	kernel_timer_start(&g_das_standby_timer, 0);
+	ezdev_sdk_kernel_log_info(0, 0, "das link degraded, standby link ready\n");
+	return EZDEV_SDK_FALSE;
+}
+
+/**
+* \brief   备用连接还没放太久且地址没变时接管为当前连接, 否则关掉; 返回是否接管
+*			后台任务还在连接时不等它, 直接新建连接, 任务的结果之后由das_standby_yield收走
+*/
+static EZDEV_SDK_BOOL das_standby_adopt(ezdev_sdk_kernel *sdk_kernel)
+{
+	EZDEV_SDK_BOOL adopt = EZDEV_SDK_FALSE;
+
+	das_standby_collect();
+	if (NULL != g_DasStandbyNet.my_socket &&
+		!kernel_timer_expired_bydiff(&g_das_standby_timer, ezdev_sdk_das_standby_max_ms) &&
+		g_das_standby_port == sdk_kernel->redirect_das_info.das_port &&
+		0 == strncmp(g_das_standby_address, sdk_kernel->redirect_das_info.das_address, ezdev_sdk_ip_max_len))
+	{
+		MQTTNetDisconnect(&g_DasNetWork);
+		das_wake_bind(NULL);
+		MQTTNetFini(&g_DasNetWork);
+		g_DasNetWork.my_socket = g_DasStandbyNet.my_socket;
+		g_DasStandbyNet.my_socket = NULL;
+		adopt = EZDEV_SDK_TRUE;
+		ezdev_sdk_kernel_log_info(0, 0, "das reconnect on standby link %s:%d\n", g_das_standby_address, g_das_standby_port);
+	}
+
+	das_standby_close();
+	g_das_standby_tried = 0;
+	return adopt;
+}
+
+/**
+* \brief   在线时的重连准备: 提前生成轻注册用的遗嘱和CONNECT报文; 开启备用连接时, 链路变差就在后台任务里先连好DAS, 链路恢复后关掉
+*/
+static void das_standby_yield(ezdev_sdk_kernel *sdk_kernel)
+{
+	das_will_cache *will = NULL;
+	size_t address_len = 0;
+	EZDEV_SDK_BOOL connecting = EZDEV_SDK_FALSE;
+
+	das_will_prepare(sdk_kernel, EZDEV_SDK_TRUE, &will);
+	connecting = das_standby_collect();
+
+	if (!g_das_standby_enable || 0 == g_DasClient.keepAliveInterval)
+	{
+		das_standby_close();
+		return;
+	}
+
+	if (!TimerIsExpiredByDiff(&g_DasClient.connect_timer, g_DasClient.keepAliveInterval * 1500))
+	{
+		das_standby_close();
+		g_das_standby_tried = 0;
+		return;
+	}
+
+	/* 上次链路变差时启动的任务还没结束, 它的参数不能动, 等结束后再试 */
+	if (NULL != g_DasStandbyNet.my_socket || g_das_standby_tried || connecting)
+	{
+		return;
+	}
+
+	g_das_standby_tried = 1;
+	address_len = strlen(sdk_kernel->redirect_das_info.das_address);
+	if (address_len >= ezdev_sdk_ip_max_len)
+	{
+		address_len = ezdev_sdk_ip_max_len - 1;
+	}
+	memcpy(g_das_standby_conn.address, sdk_kernel->redirect_das_info.das_address, address_len);
+	g_das_standby_conn.address[address_len] = '\0';
+	g_das_standby_conn.port = sdk_kernel->redirect_das_info.das_port;
+	MQTTNetInit(&g_das_standby_conn.net);
+	if (mkernel_internal_succ != kernel_job_start(&g_das_standby_job, das_standby_connect_task, &g_das_standby_conn))
+	{
+		ezdev_sdk_kernel_log_debug(0, 0, "das standby link not started, no background thread\n");
+	}
+}
+
 static mkernel_internal_error das_mqttlogin2das(ezdev_sdk_kernel *sdk_kernel, EZDEV_SDK_BOOL light_reg)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	EZDEV_SDK_INT32 mqtt_result_code = 0;
 	MQTTPacket_connectData connectData = MQTTPacket_connectData_initializer;
-	char sub_topic[128];
-	unsigned char *will_message = NULL;
-	EZDEV_SDK_UINT32 will_message_len = 0;
-
+	das_will_cache *will = NULL;
+	char topic_v3[ezdev_sdk_recv_topic_len];
+	char topic_v2[ezdev_sdk_recv_topic_len];
+	das_topic_builder topic;
+	MQTTSubscribeOptions subs;
+	EZDEV_SDK_UINT8 need_topics = das_session_topic_v2;
+	unsigned char session_present = 0;
+
+#ifdef EZDEV_SDK_MQTT_BUF_FIXED
 	memset(g_sendbuf, 0, ezdev_sdk_send_buf_max);
 	memset(g_readbuf, 0, ezdev_sdk_recv_buf_max);
+#endif
 
 	do
 	{
-		sdk_error = MQTTNetConnect(&g_DasNetWork, sdk_kernel->redirect_das_info.das_address, sdk_kernel->redirect_das_info.das_port);
+		sdk_error = das_topic_prefix_render(sdk_kernel);
 		if (sdk_error != mkernel_internal_succ)
 		{
-			ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_mqtt_reg2das NetworkConnect :%s :%d, error:%d\n",
-									   sdk_kernel->redirect_das_info.das_address, sdk_kernel->redirect_das_info.das_port, sdk_error);
+			ezdev_sdk_kernel_log_error(sdk_error, 0, "das_mqttlogin2das, topic prefix render error\n");
 			break;
 		}
-		connectData.MQTTVersion = 4;
-		if (light_reg)
+
+		/* 每次注册都换一个GCM发送随机数, 同一会话密钥下反复重连也不会重复使用nonce */
+		if (ezdev_sdk_das_cipher_gcm == sdk_kernel->redirect_das_info.das_cipher)
 		{
-			connectData.cleansession = 0;
-			connectData.willFlag = 1;
+			sdk_error = das_gcm_prepare(&g_das_gcm, sdk_kernel->session_key);
+			if (sdk_error == mkernel_internal_succ)
+			{
+				sdk_error = das_gcm_new_salt(&g_das_gcm);
+			}
+			if (sdk_error != mkernel_internal_succ)
+			{
+				ezdev_sdk_kernel_log_error(sdk_error, 0, "das_mqttlogin2das, gcm salt error\n");
+				break;
+			}
 		}
-		else
+
+		if (!das_standby_adopt(sdk_kernel))
 		{
-			/**
-			* \brief	0：表示设备断线重连
-			1：表示设备重新上线
-			*/
-			connectData.cleansession = 1;
-			/**
-			* \brief	0:断线重连上线
-			1:设备重新上线，包含遗嘱消息（设备信息）
-			*/
-			connectData.willFlag = 1;
+			sdk_error = MQTTNetConnect(&g_DasNetWork, sdk_kernel->redirect_das_info.das_address, sdk_kernel->redirect_das_info.das_port);
+		}
+		if (sdk_error != mkernel_internal_succ)
+		{
+			ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_mqtt_reg2das NetworkConnect :%s :%d, error:%d\n",
+									   sdk_kernel->redirect_das_info.das_address, sdk_kernel->redirect_das_info.das_port, sdk_error);
+			break;
 		}
-		/**
-		* \brief		QoS0： 00	QoS1： 01	QoS2： 10	使用QoS1
-		*/
-		connectData.will.qos = 1;
-		connectData.will.retained = 1;
-
-		memset(&connectData.username, 0, sizeof(connectData.username));
-		memset(&connectData.password, 0, sizeof(connectData.password));
-		connectData.keepAliveInterval = sdk_kernel->das_keepalive_interval;
 		if (strcmp("", (const char*)sdk_kernel->dev_id) == 0)
 		{
 			ezdev_sdk_kernel_log_error(0, 0, "das_mqttlogin2das,dev_id is empty!!!\n");
 			sdk_error = mkernel_internal_input_param_invalid;
 			break;
 		}
-		connectData.clientID.lenstring.data = "";
-		connectData.clientID.lenstring.len = 0;
-		connectData.username.cstring = sdk_kernel->dev_info.dev_subserial;
-		connectData.password.cstring = "test";
-		memset(sub_topic, 0, 128);
-
-		if(g_is_first_session)
-			snprintf(sub_topic, 128, "/Basic/pu2cenplt/%s/firstconnect", sdk_kernel->dev_info.dev_subserial);
-		else
-			snprintf(sub_topic, 128, "/Basic/pu2cenplt/%s/breakconnect", sdk_kernel->dev_info.dev_subserial);
-
-		connectData.will.topicName.lenstring.data = sub_topic;
-		connectData.will.topicName.lenstring.len = 128;
 
-		if (!light_reg)
-		{
-			sdk_error = serialize_devinfo(sdk_kernel, &will_message, &will_message_len);
-			if (sdk_error != mkernel_internal_succ)
-			{
-				ezdev_sdk_kernel_log_error(sdk_error, mqtt_result_code, "mqtt serialize_devinfo error\n");
-				break;
-			}
-			connectData.will.message.lenstring.data = (char *)will_message;
-			connectData.will.message.lenstring.len = will_message_len;
-		}
-		else
+		sdk_error = das_will_prepare(sdk_kernel, light_reg, &will);
+		if (sdk_error != mkernel_internal_succ)
 		{
-			sdk_error = serialize_lightreginfo(sdk_kernel, &will_message, &will_message_len);
-			if (sdk_error != mkernel_internal_succ)
-			{
-				ezdev_sdk_kernel_log_error(sdk_error, mqtt_result_code, "serialize_lightreginfo error\n");
-				break;
-			}
-			connectData.will.message.lenstring.data = (char *)will_message;
-			connectData.will.message.lenstring.len = will_message_len;
+			break;
 		}
+		das_connect_options(sdk_kernel, light_reg, will, &connectData);
 
-		if (0 != (mqtt_result_code = MQTTConnect(&g_DasClient, &connectData)))
+		/**
+		* \brief	CONNECT和订阅/iot/{序列号}/#、/{序列号}/#的SUBSCRIBE在同一次发送中发出, 收到CONNACK即可开始发消息, SUBACK在das_yield中处理
+		*			轻注册时如果上次订阅成功且主题没有变化, 等CONNACK确认会话还在就不再订阅
+		*/
+		memset(&subs, 0, sizeof(subs));
+		if (sdk_v3_reged == sdk_kernel->v3_reg_status)
+		{
+			das_topic_init(&topic, topic_v3, sizeof(topic_v3), g_das_topic_prefix_v3, g_das_topic_prefix_v3_len);
+			das_topic_append_char(&topic, '#');
+			das_topic_finish(&topic);
+			subs.topicFilters[subs.count] = topic_v3;
+			subs.qos[subs.count] = QOS1;
+			subs.handlers[subs.count++] = das_message_receive_v3;
+			need_topics |= das_session_topic_v3;
+		}
+		das_topic_init(&topic, topic_v2, sizeof(topic_v2), g_das_topic_prefix_v2, g_das_topic_prefix_v2_len);
+		das_topic_append_char(&topic, '#');
+		das_topic_finish(&topic);
+		subs.topicFilters[subs.count] = topic_v2;
+		subs.qos[subs.count] = QOS1;
+		subs.handlers[subs.count++] = das_message_receive;
+		subs.reuseSession = light_reg && MQTT_SUBACK_GRANTED == g_DasClient.suback_state && need_topics == (need_topics & g_das_session_topics);
+
+		if (0 != (mqtt_result_code = MQTTConnectSubscribeFrame(&g_DasClient, &connectData, will->connect_frame, will->connect_frame_len, &subs, &session_present)))
 		{
 			if (FAILURE == mqtt_result_code)
 				sdk_error = mkernel_internal_call_mqtt_connect;
@@ -1394,17 +2932,20 @@ static mkernel_internal_error das_mqttlogin2das(ezdev_sdk_kernel *sdk_kernel, EZ
 		}
 
 		g_is_first_session = EZDEV_SDK_FALSE;
-	} while (0);
 
-	if (will_message != NULL)
-	{
-		free(will_message);
-		will_message = NULL;
-	}
+		if (MQTT_SUBACK_PENDING == g_DasClient.suback_state)
+		{
+			g_das_session_topics = need_topics;
+		}
+		ezdev_sdk_kernel_log_debug(0, 0, "mqtt subscribe %s, session present:%d, topic:%s\n", subs.reuseSession && session_present ? "reused" : "sent",
+								   session_present, topic_v2);
+
+	} while (0);
 
 	if (sdk_error != mkernel_internal_succ)
 	{
 		MQTTNetDisconnect(&g_DasNetWork);
+		das_wake_bind(NULL);
 		MQTTNetFini(&g_DasNetWork);
 	}
 	ezdev_sdk_kernel_log_error(sdk_error, sdk_error, "mqtt connect server, server ip:%s, port:%d\n", sdk_kernel->redirect_das_info.das_address, sdk_kernel->redirect_das_info.das_port);
@@ -1420,6 +2961,7 @@ static mkernel_internal_error das_mqtt_logout2das()
 		ezdev_sdk_kernel_log_warn(mkernel_internal_call_mqtt_disconnect, mqtt_code, "das_mqtt_logout2das error:%d\n", mqtt_code);
 	}
 	MQTTNetDisconnect(&g_DasNetWork);
+	das_wake_bind(NULL);
 	MQTTNetFini(&g_DasNetWork);
 	ezdev_sdk_kernel_log_debug(0, 0, "das_mqtt_logout2das return \n");
 	return mkernel_internal_succ;
@@ -1432,10 +2974,19 @@ void das_object_init(ezdev_sdk_kernel *sdk_kernel)
 
 	//	MQTTClientInit(&g_DasClient, &g_DasNetWork, 10*1000, g_sendbuf, ezdev_sdk_send_buf_max, g_readbuf, ezdev_sdk_recv_buf_max);
 
+#ifdef EZDEV_SDK_MQTT_BUF_FIXED
 	memset(g_sendbuf, 0, ezdev_sdk_send_buf_max);
 	memset(g_readbuf, 0, ezdev_sdk_recv_buf_max);
 
 	MQTTClientInit(&g_DasClient, &g_DasNetWork, 6 * 1000, g_sendbuf, ezdev_sdk_send_buf_max, g_readbuf, ezdev_sdk_recv_buf_max);
+#else
+	/* 缓存按需增长, 分配失败时MQTTConnect会再试一次 */
+	if (SUCCESS != MQTTClientInitGrowable(&g_DasClient, &g_DasNetWork, 6 * 1000, ezdev_sdk_mqtt_buf_init, ezdev_sdk_send_buf_max,
+										  ezdev_sdk_mqtt_buf_init, ezdev_sdk_recv_buf_max, ezdev_sdk_mqtt_buf_shrink_ms))
+	{
+		ezdev_sdk_kernel_log_error(mkernel_internal_malloc_error, 0, "das mqtt buffer malloc error\n");
+	}
+#endif
     
 	/*if(das_getGoTcpAlways() == 0)
 	{
@@ -1445,38 +2996,62 @@ void das_object_init(ezdev_sdk_kernel *sdk_kernel)
     }*/
 
 	/* 初始化消息队列 */
-	init_queue(ezdev_sdk_queue_max, ezdev_sdk_queue_max, ezdev_sdk_queue_max * 4);
+	init_queue(ezdev_sdk_queue_max, ezdev_sdk_queue_max * 4);
+	kernel_timer_init(&g_das_shaper_timer, NULL);
+
+	MQTTNetInit(&g_DasStandbyNet);
+	MQTTNetInit(&g_das_standby_conn.net);
+	kernel_job_init(&g_das_standby_job);
+	kernel_timer_init(&g_das_standby_timer, NULL);
+	g_das_standby_tried = 0;
+	das_reg_cache_invalidate();
+
+	g_das_wake_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	g_das_wake_net = NULL;
+	g_das_wake_pending = 0;
+	kernel_timer_set_wakeup(das_wakeup);
 }
 
 void das_object_fini(ezdev_sdk_kernel *sdk_kernel)
 {
 	EZDEV_SDK_UNUSED(sdk_kernel)
+#ifdef EZDEV_SDK_MQTT_BUF_FIXED
 	memset(g_sendbuf, 0, ezdev_sdk_send_buf_max);
 	memset(g_readbuf, 0, ezdev_sdk_recv_buf_max);
+#endif
 
 	MQTTClientFini(&g_DasClient);
 
+	kernel_timer_set_wakeup(NULL);
+	das_wake_bind(NULL);
 	MQTTNetFini(&g_DasNetWork);
 	fini_queue();
+	das_gcm_fini(&g_das_gcm);
+	das_key_drop_prev();
+	memset(&g_das_key, 0, sizeof(g_das_key));
+	kernel_timer_stop(&g_das_shaper_timer);
+	das_frag_fini();
+
+	/* 后台任务最多阻塞到connect超时, 结束后关掉它可能连好的连接 */
+	kernel_job_fini(&g_das_standby_job);
+	if (NULL != g_das_standby_conn.net.my_socket)
+	{
+		MQTTNetDisconnect(&g_das_standby_conn.net);
+		MQTTNetFini(&g_das_standby_conn.net);
+	}
+	das_standby_close();
+	kernel_timer_stop(&g_das_standby_timer);
+	das_reg_cache_invalidate();
 
 	g_das_transport_seq = 0;
+	ezdev_sdk_kernel_platform_thread_mutex_destroy(g_das_wake_lock);
+	g_das_wake_lock = NULL;
 }
 
 mkernel_internal_error das_reg(ezdev_sdk_kernel *sdk_kernel)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	sdk_error = das_mqttlogin2das(sdk_kernel, EZDEV_SDK_FALSE);
-	if (sdk_error != mkernel_internal_succ)
-	{
-		return sdk_error;
-	}
-
-	sdk_error = das_subscribe_revc_topic(sdk_kernel, 1);
-	if (sdk_error != mkernel_internal_succ)
-	{
-		das_mqtt_logout2das();
-		ezdev_sdk_kernel_log_warn(sdk_error, 0, "das_reg subscribe error\n");
-	}
 
 	ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_reg result:%d\n", sdk_error);
 	return sdk_error;
@@ -1500,18 +3075,6 @@ mkernel_internal_error das_light_reg_v2(ezdev_sdk_kernel *sdk_kernel)
 
 	sdk_error = das_mqttlogin2das(sdk_kernel, EZDEV_SDK_TRUE);
 
-	if (sdk_error != mkernel_internal_succ)
-	{
-		return sdk_error;
-	}
-
-	sdk_error = das_subscribe_revc_topic(sdk_kernel, 1);
-	if (sdk_error != mkernel_internal_succ)
-	{
-		das_mqtt_logout2das();
-		ezdev_sdk_kernel_log_warn(sdk_error, 0, "das_light_reg_v2 subscribe error\n");
-	}
-
 	ezdev_sdk_kernel_log_debug(sdk_error, sdk_error, "das_light_reg result:%d\n", sdk_error);
 
 	return sdk_error;
@@ -1527,18 +3090,6 @@ mkernel_internal_error das_light_reg_v3(ezdev_sdk_kernel *sdk_kernel)
 
 	sdk_error = das_mqttlogin2das(sdk_kernel, EZDEV_SDK_FALSE);
 
-	if (sdk_error != mkernel_internal_succ)
-	{
-		return sdk_error;
-	}
-
-	sdk_error = das_subscribe_revc_topic(sdk_kernel, 1);
-	if (sdk_error != mkernel_internal_succ)
-	{
-		das_mqtt_logout2das();
-		ezdev_sdk_kernel_log_warn(sdk_error, 0, "das_light_reg_v3 subscribe error\n");
-	}
-
 	return sdk_error;
 }
 
@@ -1566,10 +3117,22 @@ mkernel_internal_error das_unreg(ezdev_sdk_kernel *sdk_kernel)
 mkernel_internal_error das_send_pubmsg_async(ezdev_sdk_kernel *sdk_kernel, ezdev_sdk_kernel_pubmsg_exchange *msg_exchange)
 {
 	/**
-	* \brief   将消息放到发布队列中去
+	* \brief   将消息放到发布队列中去, 入队之后消息归发送线程所有, 先记录
 	*/
-	mkernel_internal_error sdk_error = push_queue_pubmsg_exchange(msg_exchange);
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	EZDEV_SDK_UNUSED(sdk_kernel);
+
+	kernel_trace_out(&msg_exchange->msg_conntext);
+	sdk_error = push_queue_pubmsg_exchange(msg_exchange);
+	if (mkernel_internal_succ != sdk_error)
+	{
+		/* 没有入队, 记一条发送结果与上面的out记录配对, 回放时跳过 */
+		kernel_trace_sent(msg_exchange->msg_conntext.msg_seq, mkiE2ezE(sdk_error));
+	}
+	else
+	{
+		das_wakeup();
+	}
 	return sdk_error;
 }
 
@@ -1585,8 +3148,37 @@ mkernel_internal_error das_send_pubmsg_async_v3(ezdev_sdk_kernel *sdk_kernel, ez
 	/**
 	* \brief   将消息放到发布队列中去
 	*/
-	mkernel_internal_error sdk_error = push_queue_pubmsg_exchange_v3(msg_exchange);
+	ezdev_sdk_kernel_pubmsg_exchange_v3 *replaced = NULL;
+	sdk_send_msg_ack_context_v3 context = {0};
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	EZDEV_SDK_UNUSED(sdk_kernel);
+
+	kernel_trace_out_v3(&msg_exchange->msg_conntext_v3);
+	sdk_error = coalesce_queue_pubmsg_exchange_v3(msg_exchange, &replaced);
+	if (mkernel_internal_succ != sdk_error)
+	{
+		kernel_trace_sent(msg_exchange->msg_conntext_v3.msg_seq, mkiE2ezE(sdk_error));
+	}
+	else
+	{
+		das_wakeup();
+	}
+
+	/* 被替换的消息不会再发送, 单独回执一次, 让上层知道这个seq的结果 */
+	if (NULL != replaced)
+	{
+		ezdev_sdk_kernel_log_debug(0, 0, "v3 msg seq:%d superseded by seq:%d", replaced->msg_conntext_v3.msg_seq, msg_exchange->msg_conntext_v3.msg_seq);
+		das_ack_context_v3(&context, &replaced->msg_conntext_v3);
+		context.superseded_by = msg_exchange->msg_conntext_v3.msg_seq;
+		kernel_trace_sent(context.msg_seq, mkiE2ezE(mkernel_internal_queue_superseded));
+		broadcast_runtime_err(TAG_MSG_ACK_V3, mkiE2ezE(mkernel_internal_queue_superseded), &context, sizeof(context));
+
+		if (replaced->msg_conntext_v3.msg_body)
+			free(replaced->msg_conntext_v3.msg_body);
+
+		free(replaced);
+	}
+
 	return sdk_error;
 }
 
@@ -1598,6 +3190,7 @@ mkernel_internal_error das_change_keep_alive_interval(ezdev_sdk_kernel *sdk_kern
 	sdk_kernel->das_keepalive_interval = interval;
 	g_DasClient.keepAliveInterval = interval;
 	TimerCountdown(&g_DasClient.ping_timer, interval);
+	das_wakeup();
 
 	return sdk_error;
 }
@@ -1609,12 +3202,14 @@ static mkernel_internal_error das_subscribe_revc_topic(ezdev_sdk_kernel *sdk_ker
 	*/
 	EZDEV_SDK_INT32 mqtt_result_code = 0;
 	char subscribe_topic[ezdev_sdk_recv_topic_len];
-    memset(subscribe_topic, 0, ezdev_sdk_recv_topic_len);
+	das_topic_builder topic;
 	if (open)
 	{
 		if(sdk_v3_reged == sdk_kernel->v3_reg_status)
 		{
-			snprintf(subscribe_topic, ezdev_sdk_recv_topic_len, "/iot/%s/#", sdk_kernel->dev_info.dev_subserial);
+			das_topic_init(&topic, subscribe_topic, sizeof(subscribe_topic), g_das_topic_prefix_v3, g_das_topic_prefix_v3_len);
+			das_topic_append_char(&topic, '#');
+			das_topic_finish(&topic);
 			ezdev_sdk_kernel_log_debug(0, 0, "mqtt subscribe:%s ", subscribe_topic);
 			mqtt_result_code = MQTTSubscribe(&g_DasClient, subscribe_topic, QOS1, das_message_receive_v3);
 			if (mqtt_result_code != 0)
@@ -1624,8 +3219,9 @@ static mkernel_internal_error das_subscribe_revc_topic(ezdev_sdk_kernel *sdk_ker
 			}
 		}
 		
-        memset(subscribe_topic, 0,ezdev_sdk_recv_topic_len);
-		snprintf(subscribe_topic, ezdev_sdk_recv_topic_len, "/%s/#", sdk_kernel->dev_info.dev_subserial);
+		das_topic_init(&topic, subscribe_topic, sizeof(subscribe_topic), g_das_topic_prefix_v2, g_das_topic_prefix_v2_len);
+		das_topic_append_char(&topic, '#');
+		das_topic_finish(&topic);
 		mqtt_result_code = MQTTSubscribe(&g_DasClient, subscribe_topic, QOS1, das_message_receive);
 		if (mqtt_result_code != 0)
 		{
@@ -1638,7 +3234,9 @@ static mkernel_internal_error das_subscribe_revc_topic(ezdev_sdk_kernel *sdk_ker
 	{
 		if(sdk_v3_reged == sdk_kernel->v3_reg_status)
 		{
-			snprintf(subscribe_topic, ezdev_sdk_recv_topic_len, "/iot/%s/#", sdk_kernel->dev_info.dev_subserial);
+			das_topic_init(&topic, subscribe_topic, sizeof(subscribe_topic), g_das_topic_prefix_v3, g_das_topic_prefix_v3_len);
+			das_topic_append_char(&topic, '#');
+			das_topic_finish(&topic);
 			ezdev_sdk_kernel_log_debug(0, 0, "mqtt subscribe:%s \n", subscribe_topic);
 			mqtt_result_code = MQTTUnsubscribe(&g_DasClient, subscribe_topic);
 			if (mqtt_result_code != 0)
@@ -1646,8 +3244,9 @@ static mkernel_internal_error das_subscribe_revc_topic(ezdev_sdk_kernel *sdk_ker
 				ezdev_sdk_kernel_log_warn(mkernel_internal_call_mqtt_sub_error, mqtt_result_code, "mqtt unsubscribe:%s error\n", subscribe_topic);
 		    }
 		}
-		memset(subscribe_topic, 0,ezdev_sdk_recv_topic_len);
-		snprintf(subscribe_topic, ezdev_sdk_recv_topic_len, "/%s/#", sdk_kernel->dev_info.dev_subserial);
+		das_topic_init(&topic, subscribe_topic, sizeof(subscribe_topic), g_das_topic_prefix_v2, g_das_topic_prefix_v2_len);
+		das_topic_append_char(&topic, '#');
+		das_topic_finish(&topic);
 		mqtt_result_code = MQTTUnsubscribe(&g_DasClient, subscribe_topic);
 		if (mqtt_result_code != 0)
 		{
@@ -1657,11 +3256,101 @@ static mkernel_internal_error das_subscribe_revc_topic(ezdev_sdk_kernel *sdk_ker
 	return mkernel_internal_succ;
 }
 
+static void das_wake_bind(ezdev_sdk_net_work net_work)
+{
+	if (NULL == g_das_wake_lock)
+	{
+		return;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_das_wake_lock);
+	g_das_wake_net = net_work;
+	if (NULL != g_das_wake_net && g_das_wake_pending && NULL != get_ezdev_sdk_kernel()->platform_handle.net_work_wakeup)
+	{
+		g_das_wake_pending = 0;
+		get_ezdev_sdk_kernel()->platform_handle.net_work_wakeup(g_das_wake_net);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_das_wake_lock);
+}
+
+void das_wakeup()
+{
+	ezdev_sdk_kernel *sdk_kernel = get_ezdev_sdk_kernel();
+
+	if (NULL == g_das_wake_lock || NULL == sdk_kernel->platform_handle.net_work_wakeup)
+	{
+		return;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_das_wake_lock);
+	if (NULL != g_das_wake_net)
+	{
+		sdk_kernel->platform_handle.net_work_wakeup(g_das_wake_net);
+	}
+	else
+	{
+		g_das_wake_pending = 1;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_das_wake_lock);
+}
+
+static EZDEV_SDK_UINT32 das_wait_min(EZDEV_SDK_UINT32 wait_ms, EZDEV_SDK_UINT32 left_ms)
+{
+	return left_ms < wait_ms ? left_ms : wait_ms;
+}
+
+/**
+ * \brief   das_yield等待网络的时长: 到最近的定时器或者下面按时间差轮询的检查到期为止
+ * \note    心跳超时、切换备用连接、会话密钥轮换和分片重组超时是按时间差轮询的, 不在时间轮上, 单独算
+ */
+static EZDEV_SDK_UINT32 das_yield_wait_ms(ezdev_sdk_kernel *sdk_kernel)
+{
+	EZDEV_SDK_UINT32 wait_ms = kernel_timer_next_deadline();
+	EZDEV_SDK_UINT32 left_ms = 0;
+	EZDEV_SDK_INT32 i = 0;
+
+	if (0 != g_DasClient.keepAliveInterval)
+	{
+		wait_ms = das_wait_min(wait_ms, kernel_timer_left_bydiff(&g_DasClient.connect_timer.node, g_DasClient.keepAliveInterval * 2000));
+		/* 已经到了建备用连接的时候就不再算, 否则在心跳超时之前会一直不等待 */
+		left_ms = kernel_timer_left_bydiff(&g_DasClient.connect_timer.node, g_DasClient.keepAliveInterval * 1500);
+		if (g_das_standby_enable && !g_das_standby_tried && left_ms > 0)
+		{
+			wait_ms = das_wait_min(wait_ms, left_ms);
+		}
+	}
+	wait_ms = das_wait_min(wait_ms, das_key_rotate_left(sdk_kernel));
+	for (i = 0; i < ezdev_sdk_das_frag_slots; i++)
+	{
+		if (NULL != g_das_frag[i].buf)
+		{
+			wait_ms = das_wait_min(wait_ms, kernel_timer_left_bydiff(&g_das_frag[i].timer, ezdev_sdk_das_frag_timeout_ms));
+		}
+	}
+	/* 平台不能叫醒等待时, 其他线程放进来的消息只能靠轮询发现, 最多等10ms */
+	if (NULL == sdk_kernel->platform_handle.net_work_wait || NULL == sdk_kernel->platform_handle.net_work_wakeup)
+	{
+		wait_ms = das_wait_min(wait_ms, 10);
+	}
+	return wait_ms;
+}
+
 mkernel_internal_error das_yield(ezdev_sdk_kernel *sdk_kernel)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	EZDEV_SDK_UINT32 yield_ms = 0;
+	int mqtt_result = 0;
 
-	int mqtt_result = MQTTYield(&g_DasClient, 10);
+	das_wake_bind(g_DasNetWork.my_socket);
+	yield_ms = das_yield_wait_ms(sdk_kernel);
+
+	/* 平台提供了可叫醒的等待时一直等到有数据、定时器到期或者其他线程叫醒, 之后MQTTYield只处理已经到达的数据;
+	   否则由MQTTYield里的读等待 */
+	if (NULL != sdk_kernel->platform_handle.net_work_wait && NULL != sdk_kernel->platform_handle.net_work_wakeup && yield_ms > 0)
+	{
+		sdk_kernel->platform_handle.net_work_wait(g_DasNetWork.my_socket, yield_ms > 0x7FFFFFFF ? 0x7FFFFFFF : (EZDEV_SDK_INT32)yield_ms);
+		yield_ms = 0;
+	}
+	kernel_timer_wait_done();
+	mqtt_result = MQTTYield(&g_DasClient, (int)yield_ms);
 	if (mqtt_result != 0)
 	{
 		ezdev_sdk_kernel_log_debug(mkernel_internal_call_mqtt_yield_error, mqtt_result, "das_yield MQTTYield:%d error\n", mqtt_result);
@@ -1679,6 +3368,15 @@ mkernel_internal_error das_yield(ezdev_sdk_kernel *sdk_kernel)
 			break;
 		}
 		/**
+		* \brief   建连时一起发出的订阅被拒绝, 收不到下行消息, 重新注册
+		*/
+		if (MQTT_SUBACK_REFUSED == g_DasClient.suback_state)
+		{
+			sdk_error = mkernel_internal_das_need_reconnect;
+			ezdev_sdk_kernel_log_error(mkernel_internal_call_mqtt_sub_error, sdk_error, "mqtt subscribe refused, need rereg\n");
+			break;
+		}
+		/**
 		* \brief   更新超时时间
 		*/
 		if (g_DasClient.keepAliveInterval != sdk_kernel->das_keepalive_interval)
@@ -1694,6 +3392,9 @@ mkernel_internal_error das_yield(ezdev_sdk_kernel *sdk_kernel)
 
 			if (mkernel_internal_das_need_reconnect != (sdk_error = das_message_send(sdk_kernel)))
 				sdk_error = mkernel_internal_succ;
+
+			das_standby_yield(sdk_kernel);
+			das_frag_sweep();
 		}
 		else
 		{
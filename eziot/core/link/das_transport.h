@@ -28,6 +28,13 @@
 	extern mkernel_internal_error das_send_pubmsg_async(ezdev_sdk_kernel* sdk_kernel, ezdev_sdk_kernel_pubmsg_exchange* msg_exchange); \
 	extern mkernel_internal_error das_send_pubmsg_async_v3(ezdev_sdk_kernel* sdk_kernel, ezdev_sdk_kernel_pubmsg_exchange_v3* msg_exchange); \
 	extern mkernel_internal_error das_change_keep_alive_interval(ezdev_sdk_kernel* sdk_kernel, EZDEV_SDK_UINT16 interval); \
+	extern void das_reg_cache_invalidate(); \
+	extern EZDEV_SDK_BOOL das_key_rotate_due(ezdev_sdk_kernel* sdk_kernel); \
+	extern void das_key_rotate(ezdev_sdk_kernel* sdk_kernel, const unsigned char session_key[ezdev_sdk_sessionkey_len]); \
+	extern void das_key_rotate_failed(); \
+	extern void das_message_inject(ezdev_sdk_kernel_submsg* ptr_submsg); \
+	extern void das_message_inject_v3(ezdev_sdk_kernel_submsg_v3* ptr_submsg); \
+	extern void das_wakeup(); \
 	int ezdev_sdk_kernel_get_das_socket(ezdev_sdk_kernel* sdk_kernel);\
 	void das_message_receive_ex(MessageData *msg_data);
 #endif
\ No newline at end of file
@@ -14,7 +14,6 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 #include "mkernel_internal_error.h"
 #include "sdk_kernel_def.h"
 #include "mbedtls/ecdh.h"
@@ -27,73 +26,15 @@
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
 #include "ezdev_ecdh_support.h"
+#include "ezdev_sdk_kernel_rng.h"
 
-uint32_t  g_delta = 0x9E3779B9;
-
-static int rnd_std_rand( void *rng_state, unsigned char *output, size_t len )
-{
-#if !defined(__OpenBSD__)
-    size_t i;
-
-    if( rng_state != NULL )
-        rng_state  = NULL;
-
-    for( i = 0; i < len; ++i )
-    {
-        srand( (unsigned)time( NULL)); 
-        output[i] = rand();
-    }
-#else
-    if( rng_state != NULL )
-        rng_state = NULL;
-
-    arc4random_buf( output, len );
-#endif /* !OpenBSD */
-
-    return( 0 );
-}
-
-static int rnd_pseudo_rand( void *rng_state, unsigned char *output, size_t len )
-{
-    rnd_pseudo_info *info = (rnd_pseudo_info *) rng_state;
-    uint32_t i, *k, sum;
-    unsigned char result[4] ={0}, *out = output;
-
-    if( rng_state == NULL )
-        return( rnd_std_rand( NULL, output, len ) );
-
-    k = info->key;
-
-    while( len > 0 )
-    {
-        size_t use_len = ( len > 4 ) ? 4 : len;
-        sum = 0;
-
-        for( i = 0; i < 32; i++ )
-        {
-            info->v0 += ( ( ( info->v1 << 4 ) ^ ( info->v1 >> 5 ) )
-                            + info->v1 ) ^ ( sum + k[sum & 3] );
-            sum += g_delta;
-            info->v1 += ( ( ( info->v0 << 4 ) ^ ( info->v0 >> 5 ) )
-                            + info->v0 ) ^ ( sum + k[( sum>>11 ) & 3] );
-        }
-
-        PUT_UINT32_BE( info->v0, result, 0 );
-        memcpy( out, result, use_len );
-        len -= use_len;
-        out += 4;
-    }
-
-    return( 0 );
-}
-
+EZDEV_SDK_KERNEL_RNG_INTERFACE
 
 mkernel_internal_error ezdev_generate_publickey(bscomptls_ecdh_context* ctx_client, unsigned char* pubkey, EZDEV_SDK_UINT32* pubkey_len)
 {
     mkernel_internal_error sdk_error = mkernel_internal_succ;
     unsigned char buf[1000];
     size_t public_key_len = 0;
-    rnd_pseudo_info rnd_info;
     int  ret = 0;
 
     ezdev_sdk_kernel_log_debug(0, 0, "generate_public_key enter\n");
@@ -116,7 +57,7 @@ mkernel_internal_error ezdev_generate_publickey(bscomptls_ecdh_context* ctx_clie
 
         memset( buf, 0x00, sizeof( buf )); 
 
-        ret = bscomptls_ecdh_make_public(ctx_client, &public_key_len, buf, 1000, &rnd_pseudo_rand, &rnd_info );
+        ret = bscomptls_ecdh_make_public(ctx_client, &public_key_len, buf, 1000, kernel_rng_random, NULL );
         if(ret != 0)
         {   
             sdk_error = mkernel_internal_bscomptls_ecdh_read_public_err;
@@ -138,7 +79,6 @@ mkernel_internal_error ezdev_generate_masterkey(bscomptls_ecdh_context* ctx_clie
 {
     int ret = 0;
     mkernel_internal_error sdk_error = mkernel_internal_succ;
-    rnd_pseudo_info rnd_info;
     size_t master_key_len = 0;
     unsigned char input_key[ezdev_sdk_ecdh_key_len+1]={0};
     ezdev_sdk_kernel_log_debug(0, 0, "generate_master_key enter! \n");
@@ -160,7 +100,7 @@ mkernel_internal_error ezdev_generate_masterkey(bscomptls_ecdh_context* ctx_clie
             sdk_error = mkernel_internal_bscomptls_ecdh_read_public_err;
             break;
         }
-        ret = bscomptls_ecdh_calc_secret( ctx_client, &master_key_len, masterkey, 1000, &rnd_pseudo_rand, &rnd_info );
+        ret = bscomptls_ecdh_calc_secret( ctx_client, &master_key_len, masterkey, 1000, kernel_rng_random, NULL );
         if(ret!=0)
         {
             ezdev_sdk_kernel_log_warn(0, 0, "bscomptls_ecdh_calc_secret error,ret:%d\n", ret);
@@ -25,22 +25,6 @@
 #define ezdev_sdk_ecdh_publickey_len  0x61
 
 
-#ifndef PUT_UINT32_BE
-#define PUT_UINT32_BE(n,b,i)                            \
-{                                                       \
-    (b)[(i)    ] = (unsigned char) ( (n) >> 24 );       \
-    (b)[(i) + 1] = (unsigned char) ( (n) >> 16 );       \
-    (b)[(i) + 2] = (unsigned char) ( (n) >>  8 );       \
-    (b)[(i) + 3] = (unsigned char) ( (n)       );       \
-}
-#endif
-
-typedef struct
-{
-    uint32_t key[16];
-    uint32_t v0, v1;
-} rnd_pseudo_info;
-
     mkernel_internal_error ezdev_generate_publickey(bscomptls_ecdh_context* ctx_client, unsigned char* pubkey, EZDEV_SDK_UINT32* pubkey_len); 
     mkernel_internal_error ezdev_generate_masterkey(bscomptls_ecdh_context* ctx_client, unsigned char* peer_pubkey, EZDEV_SDK_UINT32 peer_pubkey_len, unsigned char* masterkey, EZDEV_SDK_UINT32 *masterkey_len);
 
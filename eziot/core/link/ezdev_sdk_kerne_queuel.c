@@ -29,51 +29,142 @@ queque_submsg_v3 g_queue_submsg_v3;					///<	接收服务器消息V3协议, 分
 queque_pubmsg_exchange_v3 g_queue_pubmsg_exchange_v3; ///<	接收上层应用消息V3协议,往服务器发
 
 QUEUE_INIT(submsg)			   ///<	展开后为init_queue_submsg(EZDEV_SDK_UINT8 max_size)函数
-QUEUE_INIT(pubmsg_exchange)    ///<	展开后为init_queue_pubmsg_exchange(EZDEV_SDK_UINT8 max_size)函数
+LANE_QUEUE_INIT(pubmsg_exchange)    ///<	展开后为init_queue_pubmsg_exchange()函数
 QUEUE_INIT(inner_cb_notic)     ///<	展开后为init_queue_inner_cb_notic(EZDEV_SDK_UINT8 max_size)函数
 
 QUEUE_INIT(submsg_v3)	       ///<	展开后为init_queue_submsg_v3(EZDEV_SDK_UINT8 max_size)函数
-QUEUE_INIT(pubmsg_exchange_v3) ///<	展开后为init_queue_pubmsg_exchange_v3(EZDEV_SDK_UINT8 max_size)函数
+LANE_QUEUE_INIT(pubmsg_exchange_v3) ///<	展开后为init_queue_pubmsg_exchange_v3()函数
 
 QUEUE_FINI(submsg)			   ///<	展开后为fini_queue_submsg()函数
-QUEUE_FINI(pubmsg_exchange)    ///<	展开后为fini_queue_pubmsg_exchange()函数
+LANE_QUEUE_FINI(pubmsg_exchange)    ///<	展开后为fini_queue_pubmsg_exchange()函数
 QUEUE_FINI(inner_cb_notic)     ///<	展开后为fini_queue_inner_cb_notic()函数
 
 QUEUE_FINI(submsg_v3)			   ///<	展开后为fini_queue_submsg_v3()函数
-QUEUE_FINI(pubmsg_exchange_v3)    ///<	展开后为fini_queue_pubmsg_exchange_v3()函数
+LANE_QUEUE_FINI(pubmsg_exchange_v3)    ///<	展开后为fini_queue_pubmsg_exchange_v3()函数
 
 QUEUE_POP(submsg)		       ///<	展开后为pop_queue_submsg(ezdev_sdk_kernel_submsg**)函数
-QUEUE_POP(pubmsg_exchange)     ///<	展开后为pop_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
+LANE_QUEUE_POP(pubmsg_exchange)     ///<	展开后为pop_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
 QUEUE_POP(inner_cb_notic)      ///<	展开后为pop_queue_inner_cb_notic(ezdev_sdk_kernel_inner_cb_notic**)函数
-QUEUE_GET(pubmsg_exchange)     ///<	展开后为get_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
+LANE_QUEUE_GET(pubmsg_exchange)     ///<	展开后为get_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
+LANE_QUEUE_PEEK(pubmsg_exchange)    ///<	展开后为peek_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**, EZDEV_SDK_UINT8, EZDEV_SDK_UINT8*)函数
+LANE_QUEUE_POP_LANE(pubmsg_exchange)    ///<	展开后为pop_queue_lane_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**, EZDEV_SDK_UINT8)函数
 
 QUEUE_POP(submsg_v3)		       ///<	展开后为pop_queue_submsg_v3(ezdev_sdk_kernel_submsg_v3**)函数
-QUEUE_POP(pubmsg_exchange_v3)     ///<	展开后为pop_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**)函数
-QUEUE_GET(pubmsg_exchange_v3)     ///<	展开后为get_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**)函数
+LANE_QUEUE_POP(pubmsg_exchange_v3)     ///<	展开后为pop_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**)函数
+LANE_QUEUE_GET(pubmsg_exchange_v3)     ///<	展开后为get_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**)函数
+LANE_QUEUE_PEEK(pubmsg_exchange_v3)    ///<	展开后为peek_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**, EZDEV_SDK_UINT8, EZDEV_SDK_UINT8*)函数
+LANE_QUEUE_POP_LANE(pubmsg_exchange_v3)    ///<	展开后为pop_queue_lane_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**, EZDEV_SDK_UINT8)函数
 
 QUEUE_PUSH(submsg)			   ///<	展开后为push_queue_submsg(ezdev_sdk_kernel_submsg**)函数
-QUEUE_PUSH(pubmsg_exchange)    ///<	展开后为push_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
+LANE_QUEUE_PUSH(pubmsg_exchange)    ///<	展开后为push_queue_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
 QUEUE_PUSH(inner_cb_notic)     ///<	展开后为push_queue_inner_cb_notic(ezdev_sdk_kernel_inner_cb_notic**)函数
 
 QUEUE_PUSH(submsg_v3)			   ///<	展开后为push_queue_submsg_v3(ezdev_sdk_kernel_submsg_v3**)函数
-QUEUE_PUSH(pubmsg_exchange_v3)    ///<	展开后为push_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchangeV3**)函数
+LANE_QUEUE_PUSH(pubmsg_exchange_v3)    ///<	展开后为push_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchangeV3**)函数
 
 
 QUEUE_PUSH_HEAD(submsg)			 ///<	展开后为push_queue_head_submsg(ezdev_sdk_kernel_submsg**)函数
-QUEUE_PUSH_HEAD(pubmsg_exchange) ///<	展开后为push_queue_head_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
+LANE_QUEUE_PUSH_HEAD(pubmsg_exchange) ///<	展开后为push_queue_head_pubmsg_exchange(ezdev_sdk_kernel_pubmsg_exchange**)函数
 QUEUE_PUSH_HEAD(inner_cb_notic)  ///<	展开后为push_queue_head_inner_cb_notic(ezdev_sdk_kernel_inner_cb_notic**)函数
 
 QUEUE_PUSH_HEAD(submsg_v3)			 ///<	展开后为push_queue_head_submsg_v3(ezdev_sdk_kernel_submsg_v3**)函数
-QUEUE_PUSH_HEAD(pubmsg_exchange_v3) ///<	展开后为push_queue_head_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**)函数
+LANE_QUEUE_PUSH_HEAD(pubmsg_exchange_v3) ///<	展开后为push_queue_head_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3**)函数
 
-mkernel_internal_error init_queue(EZDEV_SDK_UINT16 sub_max_size, EZDEV_SDK_UINT16 pub_max_size, EZDEV_SDK_UINT16 inner_max_size)
+static const EZDEV_SDK_UINT8 g_lane_weight[ezdev_sdk_queue_lane_count] = {
+	ezdev_sdk_queue_weight_control, ezdev_sdk_queue_weight_interactive, ezdev_sdk_queue_weight_bulk};
+
+int lane_queue_select(const EZDEV_SDK_UINT16 *size, EZDEV_SDK_UINT8 skip, EZDEV_SDK_UINT8 *cursor, EZDEV_SDK_UINT8 *credit, EZDEV_SDK_INT8 commit)
+{
+	EZDEV_SDK_UINT8 lane = *cursor;
+	EZDEV_SDK_UINT8 left = *credit;
+	int i = 0;
+
+	/* 当前分道有额度且非空则继续发, 否则换下一个分道并补满额度; 多转一次是为了让起始分道拿到新额度 */
+	for (i = 0; i <= ezdev_sdk_queue_lane_count; i++)
+	{
+		if (left > 0 && size[lane] > 0 && !(skip & (1 << lane)))
+		{
+			if (commit)
+			{
+				*cursor = lane;
+				*credit = left - 1;
+			}
+			return lane;
+		}
+
+		lane = (lane + 1) % ezdev_sdk_queue_lane_count;
+		left = g_lane_weight[lane];
+	}
+
+	return -1;
+}
+
+void lane_queue_commit(EZDEV_SDK_UINT8 lane, EZDEV_SDK_UINT8 *cursor, EZDEV_SDK_UINT8 *credit)
+{
+	/* 换了分道或者本分道额度已用完(轮询转了一圈回来), 都从满额度开始算 */
+	if (*cursor != lane || *credit == 0)
+	{
+		*cursor = lane;
+		*credit = g_lane_weight[lane];
+	}
+	(*credit)--;
+}
+
+static EZDEV_SDK_INT8 pubmsg_v3_same_key(const ezdev_sdk_kernel_pubmsg_v3 *a, const ezdev_sdk_kernel_pubmsg_v3 *b)
+{
+	/* 组成topic的字段都要一致, 否则替换后会发到别的topic上 */
+	return a->msg_coalesce && b->msg_coalesce &&
+		   0 == strcmp(a->module, b->module) &&
+		   0 == strcmp(a->resource_id, b->resource_id) &&
+		   0 == strcmp(a->resource_type, b->resource_type) &&
+		   0 == strcmp(a->msg_type, b->msg_type) &&
+		   0 == strcmp(a->method, b->method) &&
+		   0 == strcmp(a->sub_serial, b->sub_serial) &&
+		   0 == strcmp(a->ext_msg, b->ext_msg) &&
+		   0 == strcmp(a->coalesce_key, b->coalesce_key);
+}
+
+mkernel_internal_error coalesce_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3 *submsg, ezdev_sdk_kernel_pubmsg_exchange_v3 **replaced)
+{
+	queque_element_pubmsg_exchange_v3 *element = NULL;
+	EZDEV_SDK_UINT8 lane = submsg->msg_lane < ezdev_sdk_queue_lane_count ? submsg->msg_lane : ezdev_sdk_queue_lane_interactive;
+
+	*replaced = NULL;
+	if (!submsg->msg_conntext_v3.msg_coalesce)
+	{
+		return push_queue_pubmsg_exchange_v3(submsg);
+	}
+
+	/* 查找和替换在同一把锁内完成, 发送线程不会取到被替换掉的消息 */
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_pubmsg_exchange_v3.lock);
+	for (element = g_queue_pubmsg_exchange_v3.head[lane]; element != NULL; element = element->next)
+	{
+		if (pubmsg_v3_same_key(&element->msg->msg_conntext_v3, &submsg->msg_conntext_v3))
+		{
+			submsg->msg_lane = lane;
+			*replaced = element->msg;
+			element->msg = submsg;
+			break;
+		}
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_pubmsg_exchange_v3.lock);
+
+	if (NULL != *replaced)
+	{
+		return mkernel_internal_succ;
+	}
+
+	return push_queue_pubmsg_exchange_v3(submsg);
+}
+
+mkernel_internal_error init_queue(EZDEV_SDK_UINT16 sub_max_size, EZDEV_SDK_UINT16 inner_max_size)
 {
 	init_queue_submsg(sub_max_size);
-	init_queue_pubmsg_exchange(pub_max_size);
+	init_queue_pubmsg_exchange();
 	init_queue_inner_cb_notic(inner_max_size);
 
 	init_queue_submsg_v3(sub_max_size);
-	init_queue_pubmsg_exchange_v3(pub_max_size);
+	init_queue_pubmsg_exchange_v3();
 	return mkernel_internal_succ;
 }
 
@@ -35,12 +35,57 @@ typedef struct	tag_queque_##MSGTYPE				\
 	ezdev_sdk_mutex		lock;						\
 }queque_##MSGTYPE;
 
+/**
+ *	\brief 分道队列, 每个优先级一条链表, 出队时按权重轮询(见ezdev_sdk_queue_weight_xxx)
+ *		   消息结构体需要有msg_lane成员, 越界的按interactive处理
+ */
+#define LANE_QUEUE_DEFINE(MSGTYPE)					\
+typedef struct 	tag_queque_element_##MSGTYPE		\
+{													\
+	ezdev_sdk_kernel_##MSGTYPE* msg;				\
+	struct tag_queque_element_##MSGTYPE* next;		\
+}queque_element_##MSGTYPE;							\
+typedef struct	tag_queque_##MSGTYPE				\
+{													\
+	EZDEV_SDK_UINT16	maxsize[ezdev_sdk_queue_lane_count];		\
+	EZDEV_SDK_UINT16	size[ezdev_sdk_queue_lane_count];			\
+	queque_element_##MSGTYPE* head[ezdev_sdk_queue_lane_count];	\
+	queque_element_##MSGTYPE* tail[ezdev_sdk_queue_lane_count];	\
+	EZDEV_SDK_UINT8		cursor;						\
+	EZDEV_SDK_UINT8		credit;						\
+	ezdev_sdk_mutex		lock;						\
+}queque_##MSGTYPE;
+
 QUEUE_DEFINE(submsg)
-QUEUE_DEFINE(pubmsg_exchange)
+LANE_QUEUE_DEFINE(pubmsg_exchange)
 QUEUE_DEFINE(inner_cb_notic)
 
 QUEUE_DEFINE(submsg_v3)
-QUEUE_DEFINE(pubmsg_exchange_v3)
+LANE_QUEUE_DEFINE(pubmsg_exchange_v3)
+
+/**
+ *	\brief 选出下一个出队的分道
+ *	\param[in]		size		各分道当前长度
+ *	\param[in]		skip		按位跳过的分道, 视为空
+ *	\param[in,out]	cursor		当前轮询到的分道
+ *	\param[in,out]	credit		当前分道本轮剩余的出队次数
+ *	\param[in]		commit		0:只查看(get) 1:出队(pop), 更新cursor和credit
+ *	\return			分道下标, 全部为空返回-1
+ */
+int lane_queue_select(const EZDEV_SDK_UINT16* size, EZDEV_SDK_UINT8 skip, EZDEV_SDK_UINT8* cursor, EZDEV_SDK_UINT8* credit, EZDEV_SDK_INT8 commit);
+
+/**
+ *	\brief 从指定分道出队后更新轮询状态, 与lane_queue_select选中该分道并出队的效果一致
+ */
+void lane_queue_commit(EZDEV_SDK_UINT8 lane, EZDEV_SDK_UINT8* cursor, EZDEV_SDK_UINT8* credit);
+
+/**
+ *	\brief v3消息入队, msg_coalesce为1时先在所属分道中查找尚未发送的同类消息, 找到则原位替换
+ *	\param[in]		submsg		新消息
+ *	\param[out]	replaced	被替换下来的旧消息, 由调用者回执并释放; 没有替换时为NULL
+ *	\return		替换或入队成功返回mkernel_internal_succ, 入队失败时submsg仍归调用者
+ */
+mkernel_internal_error coalesce_queue_pubmsg_exchange_v3(ezdev_sdk_kernel_pubmsg_exchange_v3* submsg, ezdev_sdk_kernel_pubmsg_exchange_v3** replaced);
 
 /**
  *	\brief 队列初始化函数
@@ -234,14 +279,206 @@ mkernel_internal_error push_queue_head_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE* sub
 	return mkernel_internal_succ;															\
 }
 
+/**
+ *	\brief 分道队列初始化函数, 各分道容量取ezdev_sdk_queue_xxx_max
+ */
+#define LANE_QUEUE_INIT(MSGTYPE)												\
+mkernel_internal_error init_queue_##MSGTYPE()									\
+{																				\
+	memset(&g_queue_##MSGTYPE, 0, sizeof(g_queue_##MSGTYPE));					\
+	g_queue_##MSGTYPE.maxsize[ezdev_sdk_queue_lane_control] = ezdev_sdk_queue_control_max;			\
+	g_queue_##MSGTYPE.maxsize[ezdev_sdk_queue_lane_interactive] = ezdev_sdk_queue_interactive_max;	\
+	g_queue_##MSGTYPE.maxsize[ezdev_sdk_queue_lane_bulk] = ezdev_sdk_queue_bulk_max;				\
+	g_queue_##MSGTYPE.cursor = ezdev_sdk_queue_lane_control;					\
+	g_queue_##MSGTYPE.credit = ezdev_sdk_queue_weight_control;					\
+	g_queue_##MSGTYPE.lock = ezdev_sdk_kernel_platform_thread_mutex_create();	\
+	if (g_queue_##MSGTYPE.lock == NULL)											\
+	{																			\
+		return mkernel_internal_malloc_error;									\
+	}																			\
+	return mkernel_internal_succ;												\
+}
+
+/**
+ *	\brief 分道队列反初始化函数
+ */
+#define LANE_QUEUE_FINI(MSGTYPE)												\
+void fini_queue_##MSGTYPE()														\
+{																				\
+	queque_element_##MSGTYPE* element = NULL;									\
+	int lane = 0;																\
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_##MSGTYPE.lock);		\
+	for (lane = 0; lane < ezdev_sdk_queue_lane_count; lane++)					\
+	{																			\
+		while (g_queue_##MSGTYPE.head[lane] != NULL)							\
+		{																		\
+			element = g_queue_##MSGTYPE.head[lane];								\
+			g_queue_##MSGTYPE.head[lane] = element->next;						\
+			free(element->msg);													\
+			element->msg = NULL;												\
+			free(element);														\
+		}																		\
+	}																			\
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);		\
+	ezdev_sdk_kernel_platform_thread_mutex_destroy(g_queue_##MSGTYPE.lock);		\
+	memset(&g_queue_##MSGTYPE, 0, sizeof(g_queue_##MSGTYPE));					\
+}
+
+/**
+ *	\brief 按权重轮询从分道队列取出一个消息
+ */
+#define LANE_QUEUE_POP(MSGTYPE)													\
+mkernel_internal_error pop_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg)	\
+{																				\
+	queque_element_##MSGTYPE* element = NULL;									\
+	int lane = 0;																\
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_##MSGTYPE.lock);		\
+	lane = lane_queue_select(g_queue_##MSGTYPE.size, 0, &g_queue_##MSGTYPE.cursor, &g_queue_##MSGTYPE.credit, 1);	\
+	if (lane < 0)																\
+	{																			\
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);	\
+		return mkernel_internal_queue_empty;									\
+	}																			\
+	element = g_queue_##MSGTYPE.head[lane];										\
+	*submsg = element->msg;														\
+	g_queue_##MSGTYPE.head[lane] = element->next;								\
+	if (g_queue_##MSGTYPE.head[lane] == NULL)									\
+	{																			\
+		g_queue_##MSGTYPE.tail[lane] = NULL;									\
+	}																			\
+	g_queue_##MSGTYPE.size[lane]--;												\
+	free(element);																\
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);		\
+	return mkernel_internal_succ;												\
+}
+
+/**
+ *	\brief 查看下一个将要出队的消息, 队列不变
+ */
+#define LANE_QUEUE_GET(MSGTYPE)													\
+mkernel_internal_error get_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg)	\
+{																				\
+	int lane = 0;																\
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_##MSGTYPE.lock);		\
+	lane = lane_queue_select(g_queue_##MSGTYPE.size, 0, &g_queue_##MSGTYPE.cursor, &g_queue_##MSGTYPE.credit, 0);	\
+	if (lane < 0)																\
+	{																			\
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);	\
+		return mkernel_internal_queue_empty;									\
+	}																			\
+	*submsg = g_queue_##MSGTYPE.head[lane]->msg;								\
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);		\
+	return mkernel_internal_succ;												\
+}
+
+/**
+ *	\brief 跳过skip中的分道, 查看下一个将要出队的消息及其分道, 队列不变
+ *		   用于出队前的限速判断, 被限速的分道加入skip后再查看, 不影响其他分道
+ */
+#define LANE_QUEUE_PEEK(MSGTYPE)												\
+mkernel_internal_error peek_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg, EZDEV_SDK_UINT8 skip, EZDEV_SDK_UINT8* lane)	\
+{																				\
+	int selected = 0;															\
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_##MSGTYPE.lock);		\
+	selected = lane_queue_select(g_queue_##MSGTYPE.size, skip, &g_queue_##MSGTYPE.cursor, &g_queue_##MSGTYPE.credit, 0);	\
+	if (selected < 0)															\
+	{																			\
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);	\
+		return mkernel_internal_queue_empty;									\
+	}																			\
+	*submsg = g_queue_##MSGTYPE.head[selected]->msg;							\
+	*lane = (EZDEV_SDK_UINT8)selected;											\
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);		\
+	return mkernel_internal_succ;												\
+}
+
+/**
+ *	\brief 从指定分道头部取出一个消息, 配合peek使用
+ */
+#define LANE_QUEUE_POP_LANE(MSGTYPE)											\
+mkernel_internal_error pop_queue_lane_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg, EZDEV_SDK_UINT8 lane)	\
+{																				\
+	queque_element_##MSGTYPE* element = NULL;									\
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_##MSGTYPE.lock);		\
+	if (lane >= ezdev_sdk_queue_lane_count || g_queue_##MSGTYPE.head[lane] == NULL)	\
+	{																			\
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);	\
+		return mkernel_internal_queue_empty;									\
+	}																			\
+	lane_queue_commit(lane, &g_queue_##MSGTYPE.cursor, &g_queue_##MSGTYPE.credit);	\
+	element = g_queue_##MSGTYPE.head[lane];										\
+	*submsg = element->msg;														\
+	g_queue_##MSGTYPE.head[lane] = element->next;								\
+	if (g_queue_##MSGTYPE.head[lane] == NULL)									\
+	{																			\
+		g_queue_##MSGTYPE.tail[lane] = NULL;									\
+	}																			\
+	g_queue_##MSGTYPE.size[lane]--;												\
+	free(element);																\
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);		\
+	return mkernel_internal_succ;												\
+}
+
+/**
+ *	\brief 往消息所属分道的尾部/头部添加一个消息, 分道满时返回mkernel_internal_queue_full
+ */
+#define LANE_QUEUE_ADD(MSGTYPE, FUNC, AT_HEAD)									\
+mkernel_internal_error FUNC##_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE* submsg)		\
+{																				\
+	queque_element_##MSGTYPE* element = NULL;									\
+	EZDEV_SDK_UINT8 lane = submsg->msg_lane < ezdev_sdk_queue_lane_count ? submsg->msg_lane : ezdev_sdk_queue_lane_interactive;	\
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_queue_##MSGTYPE.lock);		\
+	ezdev_sdk_kernel_log_debug(0, 0, "%s lane:%d size:%d, max size:%d", #MSGTYPE, lane, g_queue_##MSGTYPE.size[lane], g_queue_##MSGTYPE.maxsize[lane]);\
+	if (g_queue_##MSGTYPE.size[lane] >= g_queue_##MSGTYPE.maxsize[lane])		\
+	{																			\
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);	\
+		return mkernel_internal_queue_full;										\
+	}																			\
+	element = (queque_element_##MSGTYPE*)malloc(sizeof(queque_element_##MSGTYPE));	\
+	if (element == NULL)														\
+	{																			\
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);	\
+		return mkernel_internal_malloc_error;									\
+	}																			\
+	submsg->msg_lane = lane;													\
+	element->msg = submsg;														\
+	element->next = NULL;														\
+	if (g_queue_##MSGTYPE.head[lane] == NULL)									\
+	{																			\
+		g_queue_##MSGTYPE.head[lane] = element;									\
+		g_queue_##MSGTYPE.tail[lane] = element;									\
+	}																			\
+	else if (AT_HEAD)															\
+	{																			\
+		element->next = g_queue_##MSGTYPE.head[lane];							\
+		g_queue_##MSGTYPE.head[lane] = element;									\
+	}																			\
+	else																		\
+	{																			\
+		g_queue_##MSGTYPE.tail[lane]->next = element;							\
+		g_queue_##MSGTYPE.tail[lane] = element;									\
+	}																			\
+	g_queue_##MSGTYPE.size[lane]++;												\
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_queue_##MSGTYPE.lock);		\
+	return mkernel_internal_succ;												\
+}
+
+#define LANE_QUEUE_PUSH(MSGTYPE)		LANE_QUEUE_ADD(MSGTYPE, push_queue, 0)
+#define LANE_QUEUE_PUSH_HEAD(MSGTYPE)	LANE_QUEUE_ADD(MSGTYPE, push_queue_head, 1)
+
 #define EXTERN_QUEUE_FUN(MSGTYPE) \
 extern mkernel_internal_error push_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE* submsg);\
 extern mkernel_internal_error push_queue_head_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE* submsg);\
 extern mkernel_internal_error pop_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg);\
 extern mkernel_internal_error get_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg);
 
+#define EXTERN_LANE_QUEUE_FUN(MSGTYPE) \
+EXTERN_QUEUE_FUN(MSGTYPE) \
+extern mkernel_internal_error peek_queue_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg, EZDEV_SDK_UINT8 skip, EZDEV_SDK_UINT8* lane);\
+extern mkernel_internal_error pop_queue_lane_##MSGTYPE(ezdev_sdk_kernel_##MSGTYPE** submsg, EZDEV_SDK_UINT8 lane);
+
 #define EXTERN_QUEUE_BASE_FUN	\
-extern mkernel_internal_error init_queue(EZDEV_SDK_UINT16 sub_max_size, EZDEV_SDK_UINT16 pub_max_size, EZDEV_SDK_UINT16 inner_max_size);\
+extern mkernel_internal_error init_queue(EZDEV_SDK_UINT16 sub_max_size, EZDEV_SDK_UINT16 inner_max_size);\
 extern void fini_queue(void); \
 extern void destroy_inner_cb_notic(ezdev_sdk_kernel_inner_cb_notic* ptr_inner_cb_notic);
 
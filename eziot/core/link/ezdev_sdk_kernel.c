@@ -30,6 +30,10 @@
 #include "dev_protocol_def.h"
 #include "ezdev_sdk_kerne_queuel.h"
 #include "MQTTPublish.h"
+#include "ezdev_sdk_kernel_rng.h"
+#include "ezdev_sdk_kernel_shaper.h"
+#include "ezdev_sdk_kernel_request.h"
+#include "ezdev_sdk_kernel_trace.h"
 
 
 
@@ -41,11 +45,17 @@ JSON_PARSER_INTERFACE
 EZDEV_SDK_KERNEL_COMMON_INTERFACE
 ASE_SUPPORT_INTERFACE
 EZDEV_SDK_KERNEL_EVENT_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_RNG_INTERFACE
+EZDEV_SDK_KERNEL_SHAPER_INTERFACE
+EZDEV_SDK_KERNEL_REQUEST_INTERFACE
+EZDEV_SDK_KERNEL_TRACE_INTERFACE
 EXTERN_QUEUE_FUN(pubmsg_exchange)
 
 
 extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
 extern char g_binding_nic[ezdev_sdk_name_len];
+extern EZDEV_SDK_INT8 g_das_standby_enable;
 extern EZDEV_SDK_UINT32 g_das_transport_seq;
 static const char *g_default_value = "invalidkey";
 static ezdev_sdk_mutex g_mutex_lock;
@@ -158,7 +168,51 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_init(const char *server_name, EZDEV_SDK_
         g_ezdev_sdk_kernel.entr_state = sdk_entrance_normal;
         g_ezdev_sdk_kernel.my_state = sdk_idle0;
         g_ezdev_sdk_kernel.cnt_state = sdk_cnt_unredirect;
-        g_ezdev_sdk_kernel.cnt_state_timer = g_ezdev_sdk_kernel.platform_handle.time_creator();
+        /* 初始化定时器服务, 之后的MQTT和重连定时器都挂在它上面 */
+        sdk_error = mkiE2ezE(kernel_timer_service_init());
+        if (sdk_error != ezdev_sdk_kernel_succ)
+        {
+            break;
+        }
+        kernel_timer_init(&g_ezdev_sdk_kernel.cnt_state_timer, NULL);
+
+        /* 初始化随机数服务, 只在这里采集一次熵 */
+        sdk_error = mkiE2ezE(kernel_rng_service_init());
+        if (sdk_error != ezdev_sdk_kernel_succ)
+        {
+            kernel_timer_service_fini();
+            break;
+        }
+
+        /* 初始化发送限速服务, 默认不限速 */
+        sdk_error = mkiE2ezE(kernel_shaper_service_init());
+        if (sdk_error != ezdev_sdk_kernel_succ)
+        {
+            kernel_rng_service_fini();
+            kernel_timer_service_fini();
+            break;
+        }
+
+        /* 初始化请求/响应关联服务 */
+        sdk_error = mkiE2ezE(kernel_request_service_init());
+        if (sdk_error != ezdev_sdk_kernel_succ)
+        {
+            kernel_shaper_service_fini();
+            kernel_rng_service_fini();
+            kernel_timer_service_fini();
+            break;
+        }
+
+        /* 初始化消息记录服务, 默认不记录 */
+        sdk_error = mkiE2ezE(kernel_trace_service_init());
+        if (sdk_error != ezdev_sdk_kernel_succ)
+        {
+            kernel_request_service_fini();
+            kernel_shaper_service_fini();
+            kernel_rng_service_fini();
+            kernel_timer_service_fini();
+            break;
+        }
 
         /* 初始化风控信息 */
         g_ezdev_sdk_kernel.access_risk = sdk_no_risk_control;
@@ -199,6 +253,7 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_init(const char *server_name, EZDEV_SDK_
 
         /* 初始化MQTT和消息队列 */
         das_object_init(&g_ezdev_sdk_kernel);
+        access_object_init(&g_ezdev_sdk_kernel);
         g_mutex_lock = g_ezdev_sdk_kernel.platform_handle.thread_mutex_create();
         if(NULL == g_mutex_lock)
         {
@@ -224,11 +279,17 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_fini()
         return ezdev_sdk_kernel_invald_call;
     }
 
+    access_object_fini(&g_ezdev_sdk_kernel);
     das_object_fini(&g_ezdev_sdk_kernel);
     extend_fini();
     common_module_fini();
 
-    g_ezdev_sdk_kernel.platform_handle.time_destroy(g_ezdev_sdk_kernel.cnt_state_timer);
+    kernel_timer_stop(&g_ezdev_sdk_kernel.cnt_state_timer);
+    kernel_trace_service_fini();
+    kernel_request_service_fini();
+    kernel_shaper_service_fini();
+    kernel_rng_service_fini();
+    kernel_timer_service_fini();
     if(g_mutex_lock)
     {
         g_ezdev_sdk_kernel.platform_handle.thread_mutex_destroy(g_mutex_lock);
@@ -254,6 +315,8 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_extend_load(const ezdev_sdk_kernel_exten
         return ezdev_sdk_kernel_params_invalid;
     }
 
+    /* 遗嘱消息里带有扩展版本 */
+    das_reg_cache_invalidate();
     return mkiE2ezE(extend_load(external_extend));
 }
 
@@ -273,6 +336,7 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_extend_load_v3(const ezdev_sdk_kernel_ex
 
     g_ezdev_sdk_kernel.v3_reg_status = sdk_v3_reged;
 
+    das_reg_cache_invalidate();
     return mkiE2ezE(extend_load_v3(external_extend_v3));
 }
 
@@ -322,6 +386,7 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_stop()
     }
 
     g_ezdev_sdk_kernel.my_state = sdk_stop;
+    das_wakeup();
     clear_queue_pubmsg_exchange();
     send_offline_msg_to_platform(genaral_seq());
 
@@ -363,7 +428,86 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_yield_user()
     return mkiE2ezE(extend_yield(&g_ezdev_sdk_kernel));
 }
 
-ezdev_sdk_kernel_error ezdev_sdk_kernel_send(ezdev_sdk_kernel_pubmsg *pubmsg)
+void ezdev_sdk_kernel_wakeup()
+{
+    das_wakeup();
+}
+
+static void *submsg_buf_retain(void **buf, EZDEV_SDK_UINT32 buf_len, EZDEV_SDK_INT8 *buf_type)
+{
+    unsigned char *retain_buf = NULL;
+
+    if (NULL == *buf)
+    {
+        return NULL;
+    }
+
+    if (submsg_buf_borrowed == *buf_type)
+    {
+        /* 借用的接收缓冲区在回调返回后会被覆盖，此时才需要拷贝 */
+        retain_buf = (unsigned char *)malloc(buf_len + 1);
+        if (NULL == retain_buf)
+        {
+            return NULL;
+        }
+        memcpy(retain_buf, *buf, buf_len);
+        retain_buf[buf_len] = '\0';
+        *buf = retain_buf;
+    }
+
+    /* 微内核分配的缓冲区直接转移所有权，不再拷贝 */
+    *buf_type = submsg_buf_retained;
+    return *buf;
+}
+
+void *ezdev_sdk_kernel_submsg_retain(ezdev_sdk_kernel_submsg *ptr_submsg)
+{
+    if (NULL == ptr_submsg)
+    {
+        return NULL;
+    }
+
+    return submsg_buf_retain(&ptr_submsg->buf, ptr_submsg->buf_len, &ptr_submsg->buf_type);
+}
+
+void *ezdev_sdk_kernel_submsg_v3_retain(ezdev_sdk_kernel_submsg_v3 *ptr_submsg)
+{
+    if (NULL == ptr_submsg)
+    {
+        return NULL;
+    }
+
+    return submsg_buf_retain(&ptr_submsg->buf, ptr_submsg->buf_len, &ptr_submsg->buf_type);
+}
+
+void ezdev_sdk_kernel_submsg_release(void *buf)
+{
+    if (NULL != buf)
+    {
+        free(buf);
+    }
+}
+
+/* 用户指定的优先级类别映射为发送队列分道, 未指定时响应消息优先 */
+static EZDEV_SDK_UINT8 pubmsg_lane(EZDEV_SDK_UINT8 msg_class, EZDEV_SDK_UINT8 msg_response)
+{
+    switch (msg_class)
+    {
+    case sdk_msg_class_control:
+        return ezdev_sdk_queue_lane_control;
+    case sdk_msg_class_interactive:
+        return ezdev_sdk_queue_lane_interactive;
+    case sdk_msg_class_bulk:
+        return ezdev_sdk_queue_lane_bulk;
+    default:
+        return msg_response ? ezdev_sdk_queue_lane_control : ezdev_sdk_queue_lane_interactive;
+    }
+}
+
+/**
+ * \brief request_seq不为0时是异步请求, 使用已经登记过的seq
+ */
+static ezdev_sdk_kernel_error kernel_send(ezdev_sdk_kernel_pubmsg *pubmsg, EZDEV_SDK_UINT32 request_seq)
 {
     /* 由于对于body的处理后期需要用ase做加密，直接在这里做padding */
     EZDEV_SDK_INT32 input_length_padding = 0;
@@ -428,8 +572,15 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_send(ezdev_sdk_kernel_pubmsg *pubmsg)
     memcpy(new_pubmsg_exchange->msg_conntext.msg_body, pubmsg->msg_body, pubmsg->msg_body_len);
     buf_padding(new_pubmsg_exchange->msg_conntext.msg_body, input_length_padding, pubmsg->msg_body_len);
     new_pubmsg_exchange->max_send_count = ezdev_sdk_max_publish_count; //默认最多发送2次
+    new_pubmsg_exchange->msg_lane = pubmsg_lane(pubmsg->msg_class, pubmsg->msg_response);
+    new_pubmsg_exchange->msg_conntext.msg_class = pubmsg->msg_class;
 
-    if (pubmsg->msg_response == 0)
+    if (0 != request_seq)
+    {
+        pubmsg->msg_seq = request_seq;
+        new_pubmsg_exchange->msg_conntext.msg_seq = pubmsg->msg_seq;
+    }
+    else if (pubmsg->msg_response == 0)
     {
         pubmsg->msg_seq = genaral_seq();
         new_pubmsg_exchange->msg_conntext.msg_seq = pubmsg->msg_seq;
@@ -474,7 +625,12 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_send(ezdev_sdk_kernel_pubmsg *pubmsg)
 
 
 
-ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+ezdev_sdk_kernel_error ezdev_sdk_kernel_send(ezdev_sdk_kernel_pubmsg *pubmsg)
+{
+    return kernel_send(pubmsg, 0);
+}
+
+static ezdev_sdk_kernel_error kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubmsg, EZDEV_SDK_UINT32 request_seq)
 {
     /* 由于对于body的处理后期需要用ase做加密，直接在这里做padding */
     EZDEV_SDK_INT32 input_length_padding = 0;
@@ -486,16 +642,18 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubm
         return ezdev_sdk_kernel_invald_call;
     }
 
-    if (pubmsg->msg_body == NULL || pubmsg->msg_body_len == 0)
+    if ((pubmsg->msg_body == NULL && pubmsg->body_read == NULL) || pubmsg->msg_body_len == 0)
     {
         ezdev_sdk_kernel_log_info(0, 0, " _v3 send input msg invalid\n");
         return ezdev_sdk_kernel_params_invalid;
     }
     
      ezdev_sdk_kernel_log_info(0, 0, "_v3 sdk send:module:%s ,resource_type:%s,msg_type:%s, method:%s, ext_msg:%s, seq:%d, len:%d, string:%s\n", pubmsg->module,\
-                              pubmsg->resource_type, pubmsg->msg_type, pubmsg->method, pubmsg->ext_msg, pubmsg->msg_seq, pubmsg->msg_body_len, pubmsg->msg_body);
+                              pubmsg->resource_type, pubmsg->msg_type, pubmsg->method, pubmsg->ext_msg, pubmsg->msg_seq, pubmsg->msg_body_len,
+                              pubmsg->msg_body != NULL ? (const char *)pubmsg->msg_body : "(stream)");
 
-    if (pubmsg->msg_body_len > ezdev_sdk_send_buf_max)
+    /* 流式发送不拷贝业务数据, 发送时分片读取, 不受发送缓存限制 */
+    if (pubmsg->msg_body_len > (pubmsg->msg_body != NULL ? ezdev_sdk_send_buf_max : ezdev_sdk_das_frag_stream_max))
     {
         return ezdev_sdk_kernel_data_len_range;
     }
@@ -510,7 +668,13 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubm
 
     memset(new_pubmsg_exchange, 0, sizeof(ezdev_sdk_kernel_pubmsg_exchange_v3));
     new_pubmsg_exchange->msg_conntext_v3.msg_qos = pubmsg->msg_qos;
-    if(0 != pubmsg->msg_response)
+    new_pubmsg_exchange->msg_conntext_v3.msg_response = pubmsg->msg_response;
+    if (0 != request_seq)
+    {
+        pubmsg->msg_seq = request_seq;
+        new_pubmsg_exchange->msg_conntext_v3.msg_seq = pubmsg->msg_seq;
+    }
+    else if(0 != pubmsg->msg_response)
     {
         new_pubmsg_exchange->msg_conntext_v3.msg_seq = pubmsg->msg_seq;
     }
@@ -529,21 +693,36 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubm
     strncpy(new_pubmsg_exchange->msg_conntext_v3.ext_msg, pubmsg->ext_msg, ezdev_sdk_ext_msg_len - 1);
  
     input_length_padding = pubmsg->msg_body_len;
-    new_pubmsg_exchange->msg_conntext_v3.msg_body = (unsigned char *)malloc(input_length_padding);
-    if (new_pubmsg_exchange->msg_conntext_v3.msg_body == NULL)
+    new_pubmsg_exchange->msg_conntext_v3.msg_body_len = input_length_padding;
+    if (pubmsg->msg_body == NULL)
     {
-        free(new_pubmsg_exchange);
-        new_pubmsg_exchange = NULL;
+        new_pubmsg_exchange->msg_conntext_v3.body_read = pubmsg->body_read;
+        new_pubmsg_exchange->msg_conntext_v3.body_user = pubmsg->body_user;
+    }
+    else
+    {
+        new_pubmsg_exchange->msg_conntext_v3.msg_body = (unsigned char *)malloc(input_length_padding);
+        if (new_pubmsg_exchange->msg_conntext_v3.msg_body == NULL)
+        {
+            free(new_pubmsg_exchange);
+            new_pubmsg_exchange = NULL;
 
-        ezdev_sdk_kernel_log_error(ezdev_sdk_kernel_memory, 0, "malloc input_length_padding:%d error", input_length_padding);
-        return ezdev_sdk_kernel_memory;
+            ezdev_sdk_kernel_log_error(ezdev_sdk_kernel_memory, 0, "malloc input_length_padding:%d error", input_length_padding);
+            return ezdev_sdk_kernel_memory;
+        }
+        memset(new_pubmsg_exchange->msg_conntext_v3.msg_body, 0, input_length_padding);
+        memcpy(new_pubmsg_exchange->msg_conntext_v3.msg_body, pubmsg->msg_body, pubmsg->msg_body_len);
+        buf_padding(new_pubmsg_exchange->msg_conntext_v3.msg_body, input_length_padding, pubmsg->msg_body_len);
     }
-    memset(new_pubmsg_exchange->msg_conntext_v3.msg_body, 0, input_length_padding);
-    new_pubmsg_exchange->msg_conntext_v3.msg_body_len = input_length_padding;
-    memcpy(new_pubmsg_exchange->msg_conntext_v3.msg_body, pubmsg->msg_body, pubmsg->msg_body_len);
-    buf_padding(new_pubmsg_exchange->msg_conntext_v3.msg_body, input_length_padding, pubmsg->msg_body_len);
     new_pubmsg_exchange->max_send_count = ezdev_sdk_max_publish_count; //默认最多发送2次
     new_pubmsg_exchange->msg_conntext_v3.msg_seq = pubmsg->msg_seq;
+    new_pubmsg_exchange->msg_lane = pubmsg_lane(pubmsg->msg_class, pubmsg->msg_response);
+    new_pubmsg_exchange->msg_conntext_v3.msg_class = pubmsg->msg_class;
+    /* 响应消息和异步请求都要和对端一一对应, 不参与合并 */
+    new_pubmsg_exchange->msg_conntext_v3.msg_coalesce = (0 == pubmsg->msg_response && 0 == request_seq) ? pubmsg->msg_coalesce : 0;
+    /* 两边都是定长数组, 同das_copy_field整段拷贝后补结尾 */
+    memcpy(new_pubmsg_exchange->msg_conntext_v3.coalesce_key, pubmsg->coalesce_key, ezdev_sdk_coalesce_key_len - 1);
+    new_pubmsg_exchange->msg_conntext_v3.coalesce_key[ezdev_sdk_coalesce_key_len - 1] = '\0';
 
     /*非阻塞式往消息队列里push内容 最终由SDKboot模块创建的主线程驱动消息发送*/
     kernel_error = mkiE2ezE(das_send_pubmsg_async_v3(&g_ezdev_sdk_kernel, new_pubmsg_exchange));
@@ -563,6 +742,164 @@ ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubm
     return kernel_error;
 }
 
+ezdev_sdk_kernel_error ezdev_sdk_kernel_send_v3(ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+{
+    return kernel_send_v3(pubmsg, 0);
+}
+
+ezdev_sdk_kernel_error ezdev_sdk_kernel_request(ezdev_sdk_kernel_pubmsg *pubmsg, const sdk_request_option *option, EZDEV_SDK_UINT32 *handle)
+{
+    ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+    EZDEV_SDK_UINT32 seq = 0;
+
+    if (g_ezdev_sdk_kernel.my_state != sdk_start)
+    {
+        return ezdev_sdk_kernel_invald_call;
+    }
+
+    if (NULL == pubmsg || NULL == option || 0 != pubmsg->msg_response)
+    {
+        return ezdev_sdk_kernel_params_invalid;
+    }
+
+    /* 先登记再发送, 响应再快也不会早于登记到达 */
+    seq = genaral_seq();
+    kernel_error = mkiE2ezE(kernel_request_add(seq, kernel_request_v2, NULL, pubmsg->msg_domain_id, NULL, option));
+    if (kernel_error != ezdev_sdk_kernel_succ)
+    {
+        return kernel_error;
+    }
+
+    kernel_error = kernel_send(pubmsg, seq);
+    if (kernel_error != ezdev_sdk_kernel_succ)
+    {
+        kernel_request_cancel(seq);
+        return kernel_error;
+    }
+
+    if (NULL != handle)
+    {
+        *handle = seq;
+    }
+
+    return ezdev_sdk_kernel_succ;
+}
+
+ezdev_sdk_kernel_error ezdev_sdk_kernel_request_v3(ezdev_sdk_kernel_pubmsg_v3 *pubmsg, const sdk_request_option *option, EZDEV_SDK_UINT32 *handle)
+{
+    ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+    EZDEV_SDK_UINT32 seq = 0;
+
+    if (g_ezdev_sdk_kernel.my_state != sdk_start)
+    {
+        return ezdev_sdk_kernel_invald_call;
+    }
+
+    if (NULL == pubmsg || NULL == option || 0 != pubmsg->msg_response)
+    {
+        return ezdev_sdk_kernel_params_invalid;
+    }
+
+    seq = genaral_seq();
+    kernel_error = mkiE2ezE(kernel_request_add(seq, kernel_request_v3, pubmsg->module, 0, pubmsg->msg_type, option));
+    if (kernel_error != ezdev_sdk_kernel_succ)
+    {
+        return kernel_error;
+    }
+
+    kernel_error = kernel_send_v3(pubmsg, seq);
+    if (kernel_error != ezdev_sdk_kernel_succ)
+    {
+        kernel_request_cancel(seq);
+        return kernel_error;
+    }
+
+    if (NULL != handle)
+    {
+        *handle = seq;
+    }
+
+    return ezdev_sdk_kernel_succ;
+}
+
+ezdev_sdk_kernel_error ezdev_sdk_kernel_request_cancel(EZDEV_SDK_UINT32 handle)
+{
+    return mkiE2ezE(kernel_request_cancel(handle));
+}
+
+static ezdev_sdk_kernel_error request_sync_result(const kernel_request_waiter *waiter, EZDEV_SDK_UINT32 *rsp_len)
+{
+    if (NULL != rsp_len)
+    {
+        *rsp_len = waiter->len;
+    }
+
+    if (ezdev_sdk_kernel_succ == waiter->result && waiter->len > waiter->buf_size)
+    {
+        return ezdev_sdk_kernel_buffer_too_small;
+    }
+
+    return (ezdev_sdk_kernel_error)waiter->result;
+}
+
+ezdev_sdk_kernel_error ezdev_sdk_kernel_request_sync(ezdev_sdk_kernel_pubmsg *pubmsg, const sdk_request_option *option,
+                                                     void *rsp_buf, EZDEV_SDK_UINT32 rsp_buf_size, EZDEV_SDK_UINT32 *rsp_len)
+{
+    ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+    kernel_request_waiter waiter;
+    sdk_request_option sync_option;
+    EZDEV_SDK_UINT32 handle = 0;
+
+    if (NULL == option)
+    {
+        return ezdev_sdk_kernel_params_invalid;
+    }
+
+    kernel_request_waiter_init(&waiter, rsp_buf, rsp_buf_size);
+    memcpy(&sync_option, option, sizeof(sync_option));
+    sync_option.cb = kernel_request_waiter_cb;
+    sync_option.user_data = &waiter;
+
+    kernel_error = ezdev_sdk_kernel_request(pubmsg, &sync_option, &handle);
+    if (kernel_error == ezdev_sdk_kernel_succ)
+    {
+        kernel_request_wait(&waiter, handle, sync_option.timeout_ms);
+        kernel_error = request_sync_result(&waiter, rsp_len);
+    }
+
+    kernel_request_waiter_fini(&waiter);
+    return kernel_error;
+}
+
+ezdev_sdk_kernel_error ezdev_sdk_kernel_request_v3_sync(ezdev_sdk_kernel_pubmsg_v3 *pubmsg, const sdk_request_option *option,
+                                                        void *rsp_buf, EZDEV_SDK_UINT32 rsp_buf_size, EZDEV_SDK_UINT32 *rsp_len)
+{
+    ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+    kernel_request_waiter waiter;
+    sdk_request_option sync_option;
+    EZDEV_SDK_UINT32 handle = 0;
+
+    if (NULL == option)
+    {
+        return ezdev_sdk_kernel_params_invalid;
+    }
+
+    kernel_request_waiter_init(&waiter, rsp_buf, rsp_buf_size);
+    memcpy(&sync_option, option, sizeof(sync_option));
+    sync_option.cb = kernel_request_waiter_cb;
+    sync_option.user_data = &waiter;
+
+    kernel_error = ezdev_sdk_kernel_request_v3(pubmsg, &sync_option, &handle);
+    if (kernel_error == ezdev_sdk_kernel_succ)
+    {
+        kernel_request_wait(&waiter, handle, sync_option.timeout_ms);
+        kernel_error = request_sync_result(&waiter, rsp_len);
+    }
+
+    kernel_request_waiter_fini(&waiter);
+    return kernel_error;
+}
+
 EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_net_option(int optname, const void *optval, int optlen)
 {
     ezdev_sdk_kernel_error rv = ezdev_sdk_kernel_succ;
@@ -580,6 +917,16 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_net_option(int
         memcpy(g_binding_nic, (char *)optval, optlen);
         break;
     }
+    case 4:
+    {
+        if (NULL == optval || optlen != sizeof(int))
+        {
+            rv = ezdev_sdk_kernel_params_invalid;
+            break;
+        }
+        g_das_standby_enable = (0 != *(const int *)optval);
+        break;
+    }
     case 3:
     {
         ezdev_sdk_kernel_log_trace(0, 0, "curr state:%d, force break das link", g_ezdev_sdk_kernel.cnt_state);
@@ -22,15 +22,35 @@
 #include "utils.h"
 #include "ezxml.h"
 #include "ase_support.h"
+#include "ezdev_sdk_kernel_request.h"
+#include "ezdev_sdk_kernel_job.h"
 
 LBS_TRANSPORT_INTERFACE
 DAS_TRANSPORT_INTERFACE
 EZDEV_SDK_KERNEL_RISK_CONTROL_INTERFACE
 EZDEV_SDK_KERNEL_EVENT_INTERFACE
 ASE_SUPPORT_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_REQUEST_INTERFACE
+EZDEV_SDK_KERNEL_JOB_INTERFACE
 
 extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
 
+/**
+* \brief   不断线更换会话密钥时与LBS的交互, 在后台任务里完成, 交互期间das_yield照常收发和保活
+*			LBS交互会改写服务器地址等字段, 所以在发起时的微内核状态副本上进行, 结果回到微内核线程后再切换密钥
+*/
+typedef struct
+{
+	ezdev_sdk_kernel kernel;
+	mkernel_internal_error result;
+	unsigned char session_key[ezdev_sdk_sessionkey_len];
+	das_info das_info;
+} access_key_rotate;
+
+static kernel_job g_access_key_rotate_job;
+static access_key_rotate g_access_key_rotate;		///<	后台任务的参数和结果, 任务运行时微内核线程不碰
+
 static mkernel_internal_error cnt_state_lbs_redirect(ezdev_sdk_kernel* sdk_kernel, EZDEV_SDK_UINT8 nUpper)
 {
 	/**
@@ -157,7 +177,7 @@ static mkernel_internal_error cnt_lbs_redirect_do(ezdev_sdk_kernel* sdk_kernel)
 	if (sdk_entrance_authcode_invalid == sdk_kernel->entr_state)
 	{
 		//如果是因为申请secretkey失败，需要根据服务器配置的时间间隔和总时长来进行重试
-		if (!sdk_kernel->platform_handle.time_isexpired_bydiff(sdk_kernel->cnt_state_timer, sdk_kernel->secretkey_interval*1000) || 
+		if (!kernel_timer_expired_bydiff(&sdk_kernel->cnt_state_timer, sdk_kernel->secretkey_interval*1000) || 
 			sdk_kernel->lbs_redirect_times > sdk_kernel->secretkey_duration)
 		{
 			return sdk_error;
@@ -165,13 +185,13 @@ static mkernel_internal_error cnt_lbs_redirect_do(ezdev_sdk_kernel* sdk_kernel)
 	}
 	else
 	{
-		if (sdk_kernel->lbs_redirect_times && !sdk_kernel->platform_handle.time_isexpired_bydiff(sdk_kernel->cnt_state_timer, sdk_kernel->lbs_redirect_times*2000))
+		if (sdk_kernel->lbs_redirect_times && !kernel_timer_expired_bydiff(&sdk_kernel->cnt_state_timer, sdk_kernel->lbs_redirect_times*2000))
 		{
 			return sdk_error;
 		}
 	}
 
-	sdk_kernel->platform_handle.time_countdown(sdk_kernel->cnt_state_timer, 0);
+	kernel_timer_start(&sdk_kernel->cnt_state_timer, 0);
 	ezdev_sdk_kernel_log_trace(0, 0, "cnt_state_lbs_redirect, times:%d \n", sdk_kernel->lbs_redirect_times);
 	sdk_error = cnt_state_lbs_redirect(sdk_kernel, 1);
 
@@ -246,12 +266,12 @@ static mkernel_internal_error cnt_das_reg_do(ezdev_sdk_kernel* sdk_kernel)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 
-	if (sdk_kernel->das_retry_times && !sdk_kernel->platform_handle.time_isexpired_bydiff(sdk_kernel->cnt_state_timer, sdk_kernel->das_retry_times*2000))
+	if (sdk_kernel->das_retry_times && !kernel_timer_expired_bydiff(&sdk_kernel->cnt_state_timer, sdk_kernel->das_retry_times*2000))
 	{
 		return sdk_error;
 	}
 	
-	sdk_kernel->platform_handle.time_countdown(sdk_kernel->cnt_state_timer, 0);
+	kernel_timer_start(&sdk_kernel->cnt_state_timer, 0);
 	ezdev_sdk_kernel_log_trace(0, 0, "cnt_state_das_reged, times:%d \n", sdk_kernel->das_retry_times);
 
 	sdk_error = cnt_state_das_reged(sdk_kernel);
@@ -302,6 +322,99 @@ static mkernel_internal_error cnt_das_reg_do(ezdev_sdk_kernel* sdk_kernel)
 	return sdk_error;
 }
 
+static void cnt_das_key_rotate_task(void *arg)
+{
+	access_key_rotate *rotate = (access_key_rotate *)arg;
+
+	rotate->result = lbs_rotate_sessionkey(&rotate->kernel, rotate->session_key, &rotate->das_info);
+}
+
+static void cnt_das_key_rotate_apply(ezdev_sdk_kernel* sdk_kernel, access_key_rotate *rotate)
+{
+	/**
+	 * \brief   不断线更换会话密钥, 只向LBS取新密钥, DAS连接不动; LBS要求换DAS或加密方式时退回完整注册
+	 */
+	mkernel_internal_error sdk_error = rotate->result;
+	unsigned char *session_key = rotate->session_key;
+	das_info *ptr_das_info = &rotate->das_info;
+	sdk_sessionkey_context context = {0};
+
+	if (sdk_error != mkernel_internal_succ)
+	{
+		das_key_rotate_failed();
+		ezdev_sdk_kernel_log_error(sdk_error, 0, "broadcast_runtime_err, cnt_das_key_rotate_do");
+		broadcast_runtime_err(TAG_ACCESS, mkiE2ezE(sdk_error), NULL, 0);
+		return;
+	}
+
+	memcpy(sdk_kernel->server_info.server_ip, rotate->kernel.server_info.server_ip, ezdev_sdk_ip_max_len);
+
+	if (0 != strncmp(ptr_das_info->das_address, sdk_kernel->redirect_das_info.das_address, ezdev_sdk_ip_max_len) ||
+		ptr_das_info->das_port != sdk_kernel->redirect_das_info.das_port ||
+		ptr_das_info->das_cipher != sdk_kernel->redirect_das_info.das_cipher ||
+		ptr_das_info->das_compress != sdk_kernel->redirect_das_info.das_compress)
+	{
+		ezdev_sdk_kernel_log_info(0, 0, "das info changed while rotating session key, register again");
+		memcpy(sdk_kernel->session_key, session_key, ezdev_sdk_sessionkey_len);
+		memcpy(&sdk_kernel->redirect_das_info, ptr_das_info, sizeof(das_info));
+		sdk_kernel->cnt_state = sdk_cnt_redirected;
+		sdk_kernel->das_retry_times = 0;
+		return;
+	}
+
+	sdk_kernel->redirect_das_info.das_key_lifetime = ptr_das_info->das_key_lifetime;
+	sdk_kernel->redirect_das_info.das_frag_size = ptr_das_info->das_frag_size;
+	das_key_rotate(sdk_kernel, session_key);
+
+	context.das_udp_port = sdk_kernel->redirect_das_info.das_udp_port;
+	context.das_port = sdk_kernel->redirect_das_info.das_port;
+	context.das_socket = ezdev_sdk_kernel_get_das_socket(sdk_kernel);
+	memcpy(context.das_ip, sdk_kernel->redirect_das_info.das_address, ezdev_sdk_ip_max_len);
+	memcpy(context.lbs_ip, sdk_kernel->server_info.server_ip, ezdev_sdk_ip_max_len);
+	memcpy(context.session_key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len);
+	memcpy(context.das_domain, sdk_kernel->redirect_das_info.das_domain, ezdev_sdk_ip_max_len);
+	memcpy(context.das_serverid, sdk_kernel->redirect_das_info.das_serverid, ezdev_sdk_ip_max_len);
+	broadcast_user_event(sdk_kernel_event_sessionkey_rotated, (void*)&context, sizeof(context));
+}
+
+static void cnt_das_key_rotate_do(ezdev_sdk_kernel* sdk_kernel)
+{
+	/**
+	 * \brief   到期时启动后台LBS交互, 之后每轮只轮询, 交互结束后在微内核线程上切换密钥
+	 *			平台没有提供后台线程时退回在微内核线程上同步交互
+	 */
+	kernel_job_state state = kernel_job_poll(&g_access_key_rotate_job);
+
+	if (kernel_job_running == state)
+	{
+		return;
+	}
+
+	if (kernel_job_finished == state)
+	{
+		/* 交互期间走了完整注册, 会话密钥已经被换掉, 这次取到的密钥作废 */
+		if (0 != memcmp(g_access_key_rotate.kernel.session_key, sdk_kernel->session_key, ezdev_sdk_sessionkey_len))
+		{
+			ezdev_sdk_kernel_log_info(0, 0, "session key changed while rotating, result dropped");
+			return;
+		}
+		cnt_das_key_rotate_apply(sdk_kernel, &g_access_key_rotate);
+		return;
+	}
+
+	if (!das_key_rotate_due(sdk_kernel))
+	{
+		return;
+	}
+
+	memcpy(&g_access_key_rotate.kernel, sdk_kernel, sizeof(ezdev_sdk_kernel));
+	if (mkernel_internal_succ != kernel_job_start(&g_access_key_rotate_job, cnt_das_key_rotate_task, &g_access_key_rotate))
+	{
+		cnt_das_key_rotate_task(&g_access_key_rotate);
+		cnt_das_key_rotate_apply(sdk_kernel, &g_access_key_rotate);
+	}
+}
+
 static mkernel_internal_error cnt_das_work_do(ezdev_sdk_kernel* sdk_kernel)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
@@ -319,6 +432,11 @@ static mkernel_internal_error cnt_das_work_do(ezdev_sdk_kernel* sdk_kernel)
 		}
 	}
 
+	if (sdk_cnt_das_reged == sdk_kernel->cnt_state)
+	{
+		cnt_das_key_rotate_do(sdk_kernel);
+	}
+
 	return sdk_error;
 }
 
@@ -326,12 +444,12 @@ static mkernel_internal_error cnt_das_retry_do(ezdev_sdk_kernel* sdk_kernel)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 
-	if (sdk_kernel->das_retry_times && !sdk_kernel->platform_handle.time_isexpired_bydiff(sdk_kernel->cnt_state_timer, sdk_kernel->das_retry_times*1000))
+	if (sdk_kernel->das_retry_times && !kernel_timer_expired_bydiff(&sdk_kernel->cnt_state_timer, sdk_kernel->das_retry_times*1000))
 	{
 		return sdk_error;
 	}
 
-	sdk_kernel->platform_handle.time_countdown(sdk_kernel->cnt_state_timer, 0);
+	kernel_timer_start(&sdk_kernel->cnt_state_timer, 0);
 	ezdev_sdk_kernel_log_trace(0, 0, "cnt_state_das_retry, times:%d \n", sdk_kernel->das_retry_times);
 
 	sdk_error = cnt_state_das_retry(sdk_kernel);
@@ -459,6 +577,7 @@ static mkernel_internal_error cnt_das_reg_v3_fast_do(ezdev_sdk_kernel* sdk_kerne
 static mkernel_internal_error cnt_state_yield(ezdev_sdk_kernel* sdk_kernel)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	sdk_cloud_cnt_state last_state = sdk_kernel->cnt_state;
 
 	if (check_access_risk_control(sdk_kernel))
 	{
@@ -524,6 +643,12 @@ static mkernel_internal_error cnt_state_yield(ezdev_sdk_kernel* sdk_kernel)
 		ezdev_sdk_kernel_log_info(sdk_error, sdk_error, "as server return the error, dev go to lbs redirect ");
 	}
 
+	/* 链路断开后响应不会再来, 未完成的请求立即失败, 不必等到超时 */
+	if (sdk_cnt_das_reged == last_state && sdk_cnt_das_reged != sdk_kernel->cnt_state)
+	{
+		kernel_request_cancel_all(mkernel_internal_das_need_reconnect);
+	}
+
 	return sdk_error;
 }
 
@@ -532,6 +657,7 @@ mkernel_internal_error stop_yield(ezdev_sdk_kernel* sdk_kernel)
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
 	sdk_error = das_unreg(sdk_kernel);
 	sdk_kernel->cnt_state = sdk_cnt_unredirect;
+	kernel_request_cancel_all(mkernel_internal_request_cancelled);
 	return sdk_error;
 }
 
@@ -655,4 +781,19 @@ mkernel_internal_error send_offline_msg_to_platform(EZDEV_SDK_UINT32 seq)
 	ezxml_free(req);
 
 	return sdk_error;
+}
+
+void access_object_init(ezdev_sdk_kernel* sdk_kernel)
+{
+	EZDEV_SDK_UNUSED(sdk_kernel)
+	memset(&g_access_key_rotate, 0, sizeof(g_access_key_rotate));
+	kernel_job_init(&g_access_key_rotate_job);
+}
+
+void access_object_fini(ezdev_sdk_kernel* sdk_kernel)
+{
+	EZDEV_SDK_UNUSED(sdk_kernel)
+	/* 后台LBS交互最多阻塞到网络超时, 等它结束后再清掉副本里的密钥 */
+	kernel_job_fini(&g_access_key_rotate_job);
+	memset(&g_access_key_rotate, 0, sizeof(g_access_key_rotate));
 }
\ No newline at end of file
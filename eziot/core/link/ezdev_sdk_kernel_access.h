@@ -19,6 +19,8 @@
 	extern mkernel_internal_error access_server_yield(ezdev_sdk_kernel* sdk_kernel);\
     extern mkernel_internal_error stop_das_logout(ezdev_sdk_kernel* sdk_kernel); \
     extern mkernel_internal_error stop_recieve_send_msg(ezdev_sdk_kernel* sdk_kernel); \
-    extern mkernel_internal_error send_offline_msg_to_platform(EZDEV_SDK_UINT32 seq);
+    extern mkernel_internal_error send_offline_msg_to_platform(EZDEV_SDK_UINT32 seq); \
+	extern void access_object_init(ezdev_sdk_kernel* sdk_kernel); \
+	extern void access_object_fini(ezdev_sdk_kernel* sdk_kernel);
 
 #endif //H_EZDEV_SDK_KERNEL_ACCESS_H_
\ No newline at end of file
@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "ezdev_sdk_kernel_compress.h"
+#include "sdk_kernel_def.h"
+
+EZDEV_SDK_KERNEL_COMPRESS_INTERFACE
+
+#define compress_min_match		4			///<	最短匹配长度
+#define compress_last_literals	5			///<	LZ4规定最后5个字节必须是字面量
+#define compress_mf_limit		12			///<	LZ4规定最后一个匹配必须在结尾12字节之前开始
+#define compress_max_offset		65535		///<	匹配距离用2字节表示
+#define compress_hash_size		(1 << ezdev_sdk_compress_hash_bits)
+#define compress_empty			0xFFFFFFFF
+
+static EZDEV_SDK_UINT32 compress_read32(const unsigned char *p)
+{
+	EZDEV_SDK_UINT32 value = 0;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static EZDEV_SDK_UINT32 compress_hash(const unsigned char *p)
+{
+	return (compress_read32(p) * 2654435761U) >> (32 - ezdev_sdk_compress_hash_bits);
+}
+
+/**
+ * \brief 长度字段超过15时, 剩余部分按每字节255累加写在后面
+ */
+static void compress_put_len(unsigned char **op, EZDEV_SDK_UINT32 len)
+{
+	while (len >= 255)
+	{
+		*(*op)++ = 255;
+		len -= 255;
+	}
+	*(*op)++ = (unsigned char)len;
+}
+
+/**
+ * \brief 写一个序列: token、字面量、匹配距离和匹配长度, match_len为0表示最后一个只有字面量的序列
+ */
+static mkernel_internal_error compress_put_sequence(unsigned char **op, const unsigned char *op_end, const unsigned char *literal, EZDEV_SDK_UINT32 literal_len,
+													 EZDEV_SDK_UINT32 offset, EZDEV_SDK_UINT32 match_len)
+{
+	unsigned char *token = *op;
+	EZDEV_SDK_UINT32 need = 1 + literal_len + literal_len / 255 + 1;
+
+	if (0 != match_len)
+	{
+		need += 2 + (match_len - compress_min_match) / 255 + 1;
+	}
+	if (need > (EZDEV_SDK_UINT32)(op_end - *op))
+	{
+		return mkernel_internal_mem_lack;
+	}
+
+	(*op)++;
+	if (literal_len >= 15)
+	{
+		*token = 15 << 4;
+		compress_put_len(op, literal_len - 15);
+	}
+	else
+	{
+		*token = (unsigned char)(literal_len << 4);
+	}
+	memcpy(*op, literal, literal_len);
+	*op += literal_len;
+
+	if (0 == match_len)
+	{
+		return mkernel_internal_succ;
+	}
+
+	*(*op)++ = (unsigned char)(offset & 0xFF);
+	*(*op)++ = (unsigned char)(offset >> 8);
+	match_len -= compress_min_match;
+	if (match_len >= 15)
+	{
+		*token |= 15;
+		compress_put_len(op, match_len - 15);
+	}
+	else
+	{
+		*token |= (unsigned char)match_len;
+	}
+
+	return mkernel_internal_succ;
+}
+
+mkernel_internal_error kernel_compress(const unsigned char *src, EZDEV_SDK_UINT32 src_len, unsigned char *dst, EZDEV_SDK_UINT32 dst_size, EZDEV_SDK_UINT32 *dst_len)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	EZDEV_SDK_UINT32 *table = NULL;
+	EZDEV_SDK_UINT32 ip = 0;
+	EZDEV_SDK_UINT32 anchor = 0;
+	EZDEV_SDK_UINT32 ref = 0;
+	EZDEV_SDK_UINT32 h = 0;
+	EZDEV_SDK_UINT32 match_len = 0;
+	EZDEV_SDK_UINT32 match_limit = 0;
+	unsigned char *op = dst;
+	const unsigned char *op_end = dst + dst_size;
+	int i = 0;
+
+	do
+	{
+		if (src_len <= compress_mf_limit)
+		{
+			break;
+		}
+
+		table = (EZDEV_SDK_UINT32 *)malloc(sizeof(EZDEV_SDK_UINT32) * compress_hash_size);
+		if (NULL == table)
+		{
+			sdk_error = mkernel_internal_malloc_error;
+			break;
+		}
+		for (i = 0; i < compress_hash_size; i++)
+		{
+			table[i] = compress_empty;
+		}
+
+		match_limit = src_len - compress_last_literals;
+		while (ip < src_len - compress_mf_limit)
+		{
+			h = compress_hash(src + ip);
+			ref = table[h];
+			table[h] = ip;
+
+			if (compress_empty == ref || ip - ref > compress_max_offset || compress_read32(src + ref) != compress_read32(src + ip))
+			{
+				/* 连续找不到匹配时逐渐加大步长, 不可压缩的数据很快扫完 */
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+			{
+				ip--;
+				ref--;
+			}
+			match_len = compress_min_match;
+			while (ip + match_len < match_limit && src[ref + match_len] == src[ip + match_len])
+			{
+				match_len++;
+			}
+
+			sdk_error = compress_put_sequence(&op, op_end, src + anchor, ip - anchor, ip - ref, match_len);
+			if (sdk_error != mkernel_internal_succ)
+			{
+				break;
+			}
+			ip += match_len;
+			anchor = ip;
+
+			/* 匹配末尾的位置也放进表里, 重复结构多的JSON能接上下一个匹配 */
+			if (ip >= 2 && ip - 2 < src_len - compress_mf_limit)
+			{
+				table[compress_hash(src + ip - 2)] = ip - 2;
+			}
+		}
+	} while (0);
+
+	if (NULL != table)
+	{
+		free(table);
+	}
+
+	if (sdk_error == mkernel_internal_succ)
+	{
+		sdk_error = compress_put_sequence(&op, op_end, src + anchor, src_len - anchor, 0, 0);
+	}
+	if (sdk_error == mkernel_internal_succ)
+	{
+		*dst_len = (EZDEV_SDK_UINT32)(op - dst);
+	}
+
+	return sdk_error;
+}
+
+/**
+ * \brief 读取扩展长度, 累加超过limit时提前失败, 防止构造的超长字段回绕
+ */
+static mkernel_internal_error decompress_get_len(const unsigned char *src, EZDEV_SDK_UINT32 src_len, EZDEV_SDK_UINT32 *ip, EZDEV_SDK_UINT32 limit, EZDEV_SDK_UINT32 *len)
+{
+	unsigned char b = 0;
+
+	do
+	{
+		if (*ip >= src_len)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+		b = src[(*ip)++];
+		*len += b;
+		if (*len > limit)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+	} while (b == 255);
+
+	return mkernel_internal_succ;
+}
+
+mkernel_internal_error kernel_decompress(const unsigned char *src, EZDEV_SDK_UINT32 src_len, unsigned char *dst, EZDEV_SDK_UINT32 dst_len)
+{
+	EZDEV_SDK_UINT32 ip = 0;
+	EZDEV_SDK_UINT32 op = 0;
+	EZDEV_SDK_UINT32 literal_len = 0;
+	EZDEV_SDK_UINT32 match_len = 0;
+	EZDEV_SDK_UINT32 offset = 0;
+	EZDEV_SDK_UINT32 i = 0;
+	unsigned char token = 0;
+
+	for (;;)
+	{
+		if (ip >= src_len)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+		token = src[ip++];
+
+		literal_len = token >> 4;
+		if (15 == literal_len && mkernel_internal_succ != decompress_get_len(src, src_len, &ip, dst_len, &literal_len))
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+		if (literal_len > src_len - ip || literal_len > dst_len - op)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+		memcpy(dst + op, src + ip, literal_len);
+		ip += literal_len;
+		op += literal_len;
+
+		/* 最后一个序列只有字面量 */
+		if (ip == src_len)
+		{
+			break;
+		}
+
+		if (src_len - ip < 2)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+		offset = src[ip] | ((EZDEV_SDK_UINT32)src[ip + 1] << 8);
+		ip += 2;
+		if (0 == offset || offset > op)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+
+		match_len = token & 0x0F;
+		if (15 == match_len && mkernel_internal_succ != decompress_get_len(src, src_len, &ip, dst_len, &match_len))
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+		match_len += compress_min_match;
+		if (match_len > dst_len - op)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
+
+		/* 距离小于长度时源和目的重叠, 只能逐字节复制 */
+		if (offset >= match_len)
+		{
+			memcpy(dst + op, dst + op - offset, match_len);
+		}
+		else
+		{
+			for (i = 0; i < match_len; i++)
+			{
+				dst[op + i] = dst[op - offset + i];
+			}
+		}
+		op += match_len;
+	}
+
+	if (op != dst_len)
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
+
+	return mkernel_internal_succ;
+}
@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_COMPRESS_H_
+#define H_EZDEV_SDK_KERNEL_COMPRESS_H_
+
+#include "base_typedef.h"
+#include "mkernel_internal_error.h"
+
+/**
+ * \brief 微内核报文压缩, 输出LZ4 block格式(不带frame头), 平台可以直接用标准LZ4解压
+ * \note
+ * - kernel_compress: 输出超过dst_size时返回mkernel_internal_mem_lack, 调用者据此放弃压缩,
+ *   不可压缩的数据不会写满整个缓冲区才发现
+ * - kernel_decompress: 每一步都检查输入和输出边界, 解压结果必须恰好是dst_len字节, 否则返回mkernel_internal_rev_invalid_packet
+ * - 压缩时的哈希表从堆上临时分配, 大小见ezdev_sdk_compress_hash_bits
+ */
+#define EZDEV_SDK_KERNEL_COMPRESS_INTERFACE	\
+	extern mkernel_internal_error kernel_compress(const unsigned char *src, EZDEV_SDK_UINT32 src_len, unsigned char *dst, EZDEV_SDK_UINT32 dst_size, EZDEV_SDK_UINT32 *dst_len); \
+	extern mkernel_internal_error kernel_decompress(const unsigned char *src, EZDEV_SDK_UINT32 src_len, unsigned char *dst, EZDEV_SDK_UINT32 dst_len);
+
+#endif
@@ -21,12 +21,18 @@
 #include "mkernel_internal_error.h"
 #include "ezdev_sdk_kerne_queuel.h"
 #include "ase_support.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel_shaper.h"
+#include "ezdev_sdk_kernel_trace.h"
 
 extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
 EXTERN_QUEUE_FUN(pubmsg_exchange)
 LBS_TRANSPORT_INTERFACE
 DAS_TRANSPORT_INTERFACE
 ASE_SUPPORT_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_SHAPER_INTERFACE
+EZDEV_SDK_KERNEL_TRACE_INTERFACE
 
 EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_get_stun(stun_info* ptr_stun, EZDEV_SDK_BOOL bforce_refresh)
 {
@@ -115,8 +121,13 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_keepalive_inter
 
 		buf_padding(new_pubmsg_exchange->msg_conntext.msg_body, input_length_padding, strlen(json_buf));
 		new_pubmsg_exchange->max_send_count = ezdev_sdk_max_publish_count;
+		new_pubmsg_exchange->msg_lane = ezdev_sdk_queue_lane_control;
 		rv = push_queue_pubmsg_exchange(new_pubmsg_exchange);
 		ezdev_sdk_kernel_log_info(rv, rv, "push msg to queue");
+		if (rv == ezdev_sdk_kernel_succ)
+		{
+			das_wakeup();
+		}
     }while(0);
 
 	if(json_buf)
@@ -146,4 +157,31 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_keepalive_inter
 	ezdev_sdk_kernel_log_info(rv, rv, "ezdev_sdk_kernel_set_keepalive_interval !!!!!!");
 
 	return rv;
-}
\ No newline at end of file
+}
+
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_shaper(const sdk_shaper_config* config)
+{
+	/* 微内核初始化前调用返回ezdev_sdk_kernel_invald_call */
+	return mkiE2ezE(kernel_shaper_config(config, kernel_timer_now()));
+}
+
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_trace(const sdk_trace_config* config)
+{
+	/* 微内核初始化前调用返回ezdev_sdk_kernel_invald_call */
+	return mkiE2ezE(kernel_trace_config(config));
+}
+
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_trace_peek(const void* trace, EZDEV_SDK_UINT32 len, sdk_trace_record_info* info)
+{
+	return mkiE2ezE(kernel_trace_peek((const unsigned char*)trace, len, info));
+}
+
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_trace_replay(const void* record, EZDEV_SDK_UINT32 len)
+{
+	if (g_ezdev_sdk_kernel.my_state != sdk_start)
+	{
+		return ezdev_sdk_kernel_invald_call;
+	}
+
+	return kernel_trace_replay((const unsigned char*)record, len);
+}
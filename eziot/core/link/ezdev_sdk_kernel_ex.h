@@ -39,6 +39,51 @@ EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_get_stun(stun_info*
  */
 EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_keepalive_interval(EZDEV_SDK_UINT16 internal, EZDEV_SDK_UINT16 timeout_s);
 
+/** 
+ *  \brief		设置发送限速(令牌桶)
+ *  \method		ezdev_sdk_kernel_set_shaper
+ *  \note		可分别对全局、v3协议的module、v2协议的领域限速, 同一范围重复设置时覆盖, msg_rate和byte_rate都为0时取消
+ *				超出速率的消息留在发送队列中延后发送, 不丢弃; 延后开始时通过sdk_kernel_event_send_shaped事件通知
+ *				指令响应和微内核内部消息(control分道)不等待, 但会占用额度
+ *  \param[in] 	config 限速配置
+ *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_invald_call、ezdev_sdk_kernel_params_invalid、ezdev_sdk_kernel_buffer_too_small(限速条数已满)
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_shaper(const sdk_shaper_config* config);
+
+/** 
+ *  \brief		开始/停止记录收发的消息
+ *  \method		ezdev_sdk_kernel_set_trace
+ *  \note		记录的是解密后的下行消息、进入发送队列的上行消息和上行消息的发送结果, 每条记录带相对开始记录的毫秒时间
+ *				开始记录时先回调一次8字节的记录头, 之后每条消息回调一次完整的记录, 回调在收发线程中执行, 不能阻塞
+ *				scrub可以去掉业务数据和设备标识, 只保留长度, 便于把现网记录带回实验室
+ *				config为NULL或trace_write为NULL时停止记录
+ *  \param[in] 	config 记录配置
+ *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_invald_call
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_set_trace(const sdk_trace_config* config);
+
+/** 
+ *  \brief		解析记录缓冲区开头的一条记录
+ *  \method		ezdev_sdk_kernel_trace_peek
+ *  \note		用于按info.record_len逐条切分记录文件, 以及按info.time_ms控制回放节奏, 不需要启动微内核
+ *  \param[in] 	trace 记录缓冲区
+ *  \param[in] 	len 缓冲区长度
+ *  \param[out] info 记录信息
+ *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_params_invalid(记录不完整或格式不对)
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_trace_peek(const void* trace, EZDEV_SDK_UINT32 len, sdk_trace_record_info* info);
+
+/** 
+ *  \brief		回放一条记录
+ *  \method		ezdev_sdk_kernel_trace_replay
+ *  \note		下行消息送进微内核的分发路径, 和从平台收到的一样回调给领域/模块; 上行消息重新调用发送接口
+ *				记录头和发送结果记录直接返回成功; 没有记录的业务数据用同样长度的空格代替
+ *  \param[in] 	record 一条完整的记录
+ *  \param[in] 	len 记录长度
+ *  \return 	ezdev_sdk_kernel_succ、ezdev_sdk_kernel_invald_call、ezdev_sdk_kernel_params_invalid、ezdev_sdk_kernel_memory, 上行消息为发送接口的返回值
+ */
+EZDEV_SDK_KERNEL_API ezdev_sdk_kernel_error ezdev_sdk_kernel_trace_replay(const void* record, EZDEV_SDK_UINT32 len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -146,11 +146,11 @@ static mkernel_internal_error consume_extend_data_v3(ezdev_sdk_kernel *sdk_kerne
             ezdev_sdk_kernel_log_trace(kernel_error, 0, "rev msg v3 module:%s, resource_id:%s, resource_type:%s, msg_type:%s, seq:%d, len:%d", ptr_submsg->module, \
                                       ptr_submsg->resource_id, ptr_submsg->resource_type,  ptr_submsg->msg_type, ptr_submsg->msg_seq, ptr_submsg->buf_len);
 
-            if (ptr_submsg->buf != NULL)
+            if (ptr_submsg->buf != NULL && ptr_submsg->buf_type == submsg_buf_owned)
             {
                 free(ptr_submsg->buf);
-                ptr_submsg->buf = NULL;
             }
+            ptr_submsg->buf = NULL;
             free(ptr_submsg);
             ptr_submsg = NULL;
         }
@@ -207,11 +207,11 @@ static mkernel_internal_error consume_extend_data(ezdev_sdk_kernel *sdk_kernel)
         {
             ezdev_sdk_kernel_log_trace(kernel_error, 0, "rev msg domain:%d cmd:%d, seq:%d, len:%d", ptr_submsg->msg_domain_id, ptr_submsg->msg_command_id, ptr_submsg->msg_seq, ptr_submsg->buf_len);
 
-            if (ptr_submsg->buf != NULL)
+            if (ptr_submsg->buf != NULL && ptr_submsg->buf_type == submsg_buf_owned)
             {
                 free(ptr_submsg->buf);
-                ptr_submsg->buf = NULL;
             }
+            ptr_submsg->buf = NULL;
 
             free(ptr_submsg);
             ptr_submsg = NULL;
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <string.h>
+#include "ezdev_sdk_kernel_job.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "mkernel_internal_error.h"
+#include "sdk_kernel_def.h"
+#include "das_transport.h"
+
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+EZDEV_SDK_KERNEL_JOB_INTERFACE
+DAS_TRANSPORT_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+mkernel_internal_error kernel_job_init(kernel_job *job)
+{
+	memset(job, 0, sizeof(kernel_job));
+	job->lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	if (NULL == job->lock)
+	{
+		return mkernel_internal_malloc_error;
+	}
+	job->finish_sem = ezdev_sdk_kernel_platform_thread_sem_create();
+	job->state = kernel_job_idle;
+	return mkernel_internal_succ;
+}
+
+void kernel_job_fini(kernel_job *job)
+{
+	if (NULL == job->lock)
+	{
+		return;
+	}
+	kernel_job_wait(job);
+
+	/* 后台线程在锁内释放信号量, 这里拿一次锁, 确保它已经离开 */
+	ezdev_sdk_kernel_platform_thread_mutex_lock(job->lock);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(job->lock);
+	ezdev_sdk_kernel_platform_thread_sem_destroy(job->finish_sem);
+	ezdev_sdk_kernel_platform_thread_mutex_destroy(job->lock);
+	memset(job, 0, sizeof(kernel_job));
+}
+
+static void kernel_job_run(void *arg)
+{
+	kernel_job *job = (kernel_job *)arg;
+
+	job->task(job->arg);
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(job->lock);
+	job->state = kernel_job_finished;
+	ezdev_sdk_kernel_platform_thread_sem_post(job->finish_sem);
+	/* 微内核线程可能正阻塞在das_yield里, 叫醒它来取结果; 在锁内叫, kernel_job_fini拿到锁之后就不会再碰das的状态 */
+	das_wakeup();
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(job->lock);
+}
+
+mkernel_internal_error kernel_job_start(kernel_job *job, void (*task)(void *arg), void *arg)
+{
+	if (NULL == job->lock || NULL == g_ezdev_sdk_kernel.platform_handle.thread_start || kernel_job_idle != kernel_job_poll(job))
+	{
+		return mkernel_internal_invald_call;
+	}
+
+	job->task = task;
+	job->arg = arg;
+	job->state = kernel_job_running;
+	if (0 != ezdev_sdk_kernel_platform_thread_start(kernel_job_run, job))
+	{
+		job->state = kernel_job_idle;
+		return mkernel_internal_internal_err;
+	}
+	return mkernel_internal_succ;
+}
+
+kernel_job_state kernel_job_poll(kernel_job *job)
+{
+	kernel_job_state state = kernel_job_idle;
+
+	if (NULL == job->lock)
+	{
+		return kernel_job_idle;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_lock(job->lock);
+	state = (kernel_job_state)job->state;
+	if (kernel_job_finished == state)
+	{
+		job->state = kernel_job_idle;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(job->lock);
+	return state;
+}
+
+void kernel_job_wait(kernel_job *job)
+{
+	while (kernel_job_running == kernel_job_poll(job))
+	{
+		if (0 != ezdev_sdk_kernel_platform_thread_sem_wait(job->finish_sem, 1000) && NULL == job->finish_sem)
+		{
+			g_ezdev_sdk_kernel.platform_handle.time_sleep(10);
+		}
+	}
+}
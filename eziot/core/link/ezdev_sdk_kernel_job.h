@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_JOB_H_
+#define H_EZDEV_SDK_KERNEL_JOB_H_
+
+#include "base_typedef.h"
+#include "ezdev_sdk_kernel_struct.h"
+
+typedef enum
+{
+	kernel_job_idle,			///<	没有任务, 可以启动
+	kernel_job_running,			///<	任务在后台线程上执行
+	kernel_job_finished,		///<	任务已结束, 结果等微内核线程取走
+} kernel_job_state;
+
+/**
+ * \brief 微内核后台任务: 可能阻塞数秒的网络交互放到平台线程上执行, 微内核线程在yield中轮询, 从不等待
+ * \note  同一时刻只有一个任务; 任务函数只读写arg, 不碰微内核线程上的状态, 结果由微内核线程在kernel_job_poll返回finished后取走
+ */
+typedef struct
+{
+	ezdev_sdk_mutex lock;
+	ezdev_sdk_sem finish_sem;		///<	任务结束时释放, kernel_job_wait用; 平台不提供信号量时轮询
+	EZDEV_SDK_INT8 state;			///<	kernel_job_state
+	void (*task)(void *arg);
+	void *arg;
+} kernel_job;
+
+/**
+ * \note kernel_job_start在平台没有提供thread_start、任务未取走或线程启动失败时返回错误, 调用者自行决定同步执行还是放弃;
+ *       kernel_job_poll返回finished后任务回到idle; kernel_job_wait只在反初始化时用, 阻塞到后台任务结束
+ */
+#define EZDEV_SDK_KERNEL_JOB_INTERFACE	\
+	extern mkernel_internal_error kernel_job_init(kernel_job *job); \
+	extern void kernel_job_fini(kernel_job *job); \
+	extern mkernel_internal_error kernel_job_start(kernel_job *job, void (*task)(void *arg), void *arg); \
+	extern kernel_job_state kernel_job_poll(kernel_job *job); \
+	extern void kernel_job_wait(kernel_job *job);
+
+#endif
@@ -34,4 +34,48 @@ int ezdev_sdk_kernel_platform_thread_mutex_lock(ezdev_sdk_mutex ptr_mutex)
 int ezdev_sdk_kernel_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex)
 {
 	return g_ezdev_sdk_kernel.platform_handle.thread_mutex_unlock(ptr_mutex);
+}
+
+ezdev_sdk_sem ezdev_sdk_kernel_platform_thread_sem_create()
+{
+	if (NULL == g_ezdev_sdk_kernel.platform_handle.thread_sem_create)
+	{
+		return NULL;
+	}
+	return g_ezdev_sdk_kernel.platform_handle.thread_sem_create();
+}
+
+void ezdev_sdk_kernel_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem)
+{
+	if (NULL != ptr_sem)
+	{
+		g_ezdev_sdk_kernel.platform_handle.thread_sem_destroy(ptr_sem);
+	}
+}
+
+int ezdev_sdk_kernel_platform_thread_sem_post(ezdev_sdk_sem ptr_sem)
+{
+	if (NULL == ptr_sem)
+	{
+		return -1;
+	}
+	return g_ezdev_sdk_kernel.platform_handle.thread_sem_post(ptr_sem);
+}
+
+int ezdev_sdk_kernel_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms)
+{
+	if (NULL == ptr_sem)
+	{
+		return -1;
+	}
+	return g_ezdev_sdk_kernel.platform_handle.thread_sem_wait(ptr_sem, timeout_ms);
+}
+
+int ezdev_sdk_kernel_platform_thread_start(void (*task)(void *arg), void *arg)
+{
+	if (NULL == g_ezdev_sdk_kernel.platform_handle.thread_start)
+	{
+		return -1;
+	}
+	return g_ezdev_sdk_kernel.platform_handle.thread_start(task, arg);
 }
\ No newline at end of file
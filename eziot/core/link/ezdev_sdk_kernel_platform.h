@@ -18,5 +18,10 @@
 	extern ezdev_sdk_mutex ezdev_sdk_kernel_platform_thread_mutex_create();	\
 	extern void  ezdev_sdk_kernel_platform_thread_mutex_destroy(ezdev_sdk_mutex ptr_mutex); \
 	extern int ezdev_sdk_kernel_platform_thread_mutex_lock(ezdev_sdk_mutex ptr_mutex); \
-	extern int ezdev_sdk_kernel_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex);
+	extern int ezdev_sdk_kernel_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex); \
+	extern ezdev_sdk_sem ezdev_sdk_kernel_platform_thread_sem_create(); \
+	extern void ezdev_sdk_kernel_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem); \
+	extern int ezdev_sdk_kernel_platform_thread_sem_post(ezdev_sdk_sem ptr_sem); \
+	extern int ezdev_sdk_kernel_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms); \
+	extern int ezdev_sdk_kernel_platform_thread_start(void (*task)(void *arg), void *arg);
 #endif
\ No newline at end of file
@@ -0,0 +1,573 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "ezdev_sdk_kernel_request.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "mkernel_internal_error.h"
+#include "sdk_kernel_def.h"
+#include "utils.h"
+
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_REQUEST_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define kernel_request_slot_mask	(ezdev_sdk_request_slot_max - 1)
+#define kernel_request_count_max	(ezdev_sdk_request_slot_max / 4 * 3)	///<	装载因子不超过3/4, 保证探测链足够短
+#define kernel_request_wait_step	10										///<	平台没有信号量时同步等待的轮询间隔, 毫秒
+#define kernel_request_wait_slack	1000									///<	同步等待比请求超时多等的时间, 超过后主动取消
+
+/**
+ * \brief 请求的状态, 只在g_request_lock内修改
+ */
+typedef enum
+{
+	request_pending,			///<	在哈希表中等待响应
+	request_notifying,			///<	已从哈希表摘除, 正在回调用户
+	request_fired,				///<	回调用户期间定时器到期了, 回调结束后直接释放
+	request_abandoned			///<	定时器摘不下来(已到期正在触发), 由定时器回调释放
+} request_state;
+
+typedef struct tag_kernel_request
+{
+	kernel_timer timer;								///<	超时定时器, 放在第一个成员, 回调中直接转换
+	EZDEV_SDK_UINT32 seq;
+	EZDEV_SDK_UINT8 proto;							///<	kernel_request_v2/kernel_request_v3
+	EZDEV_SDK_UINT8 state;							///<	request_state
+	EZDEV_SDK_UINT32 domain_id;						///<	v2: 领域ID
+	EZDEV_SDK_UINT32 rsp_command_id;				///<	v2: 响应指令ID
+	char module[ezdev_sdk_module_name_len];			///<	v3: 模块
+	char rsp_msg_type[ezdev_sdk_msg_type_len];		///<	v3: 响应消息类型
+	sdk_request_cb cb;
+	void *user_data;
+	struct tag_kernel_request *notify_next;			///<	断线批量取消时串起来, 在锁外回调
+	struct tag_kernel_request *prev;				///<	所有未释放的请求, 反初始化时释放已摘除但定时器未到期的请求
+	struct tag_kernel_request *next;
+} kernel_request;
+
+static kernel_request **g_request_slot = NULL;
+static kernel_request *g_request_list = NULL;
+static EZDEV_SDK_UINT32 g_request_count = 0;
+static ezdev_sdk_mutex g_request_lock = NULL;
+
+static EZDEV_SDK_UINT32 request_home(EZDEV_SDK_UINT32 seq)
+{
+	/* seq是递增的, 乘法散列后低位依然两两不同, 连续的请求不会挤在一起 */
+	return (seq * 2654435761U) & kernel_request_slot_mask;
+}
+
+static EZDEV_SDK_UINT32 request_find(EZDEV_SDK_UINT32 seq)
+{
+	EZDEV_SDK_UINT32 i = request_home(seq);
+
+	while (g_request_slot[i] != NULL)
+	{
+		if (g_request_slot[i]->seq == seq)
+		{
+			return i;
+		}
+		i = (i + 1) & kernel_request_slot_mask;
+	}
+
+	return ezdev_sdk_request_slot_max;
+}
+
+static void request_insert(kernel_request *request)
+{
+	EZDEV_SDK_UINT32 i = request_home(request->seq);
+
+	while (g_request_slot[i] != NULL)
+	{
+		i = (i + 1) & kernel_request_slot_mask;
+	}
+	g_request_slot[i] = request;
+	g_request_count++;
+}
+
+/**
+ * \brief 删除槽位i, 把后面探测链上能前移的元素依次回移, 不留墓碑
+ */
+static void request_remove(EZDEV_SDK_UINT32 i)
+{
+	EZDEV_SDK_UINT32 j = i;
+	EZDEV_SDK_UINT32 home = 0;
+
+	g_request_slot[i] = NULL;
+	g_request_count--;
+
+	for (;;)
+	{
+		j = (j + 1) & kernel_request_slot_mask;
+		if (g_request_slot[j] == NULL)
+		{
+			return;
+		}
+
+		/* home在(i, j]之间的元素留在原处也能找到 */
+		home = request_home(g_request_slot[j]->seq);
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+		{
+			continue;
+		}
+
+		g_request_slot[i] = g_request_slot[j];
+		g_request_slot[j] = NULL;
+		i = j;
+	}
+}
+
+static void request_free(kernel_request *request)
+{
+	if (request->prev != NULL)
+	{
+		request->prev->next = request->next;
+	}
+	else
+	{
+		g_request_list = request->next;
+	}
+	if (request->next != NULL)
+	{
+		request->next->prev = request->prev;
+	}
+	free(request);
+}
+
+/**
+ * \brief 回调用户之后释放请求, 必须在g_request_lock内调用
+ */
+static void request_release(kernel_request *request)
+{
+	if (request_fired == request->state || kernel_timer_stop(&request->timer))
+	{
+		request_free(request);
+		return;
+	}
+
+	request->state = request_abandoned;
+}
+
+static void request_notify(kernel_request *request, mkernel_internal_error result, ezdev_sdk_kernel_submsg *rsp, ezdev_sdk_kernel_submsg_v3 *rsp_v3)
+{
+	sdk_request_result request_result = {0};
+
+	if (NULL == request->cb)
+	{
+		return;
+	}
+
+	request_result.handle = request->seq;
+	request_result.result = mkiE2ezE(result);
+	request_result.rsp = rsp;
+	request_result.rsp_v3 = rsp_v3;
+	request_result.user_data = request->user_data;
+	request->cb(&request_result);
+}
+
+static void request_timeout_cb(kernel_timer *timer)
+{
+	kernel_request *request = (kernel_request *)timer;
+	EZDEV_SDK_UINT32 i = 0;
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	if (request_notifying == request->state)
+	{
+		/* 正在回调用户, 回调结束后由request_release释放 */
+		request->state = request_fired;
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+		return;
+	}
+	if (request_abandoned == request->state)
+	{
+		request_free(request);
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+		return;
+	}
+
+	i = request_find(request->seq);
+	if (i < ezdev_sdk_request_slot_max)
+	{
+		request_remove(i);
+	}
+	request->state = request_fired;
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+
+	/* 已经从哈希表摘除且定时器不在时间轮上, 没有其他人会再访问这个请求 */
+	ezdev_sdk_kernel_log_debug(mkernel_internal_request_timeout, 0, "request seq:%d timeout", request->seq);
+	request_notify(request, mkernel_internal_request_timeout, NULL, NULL);
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	request_free(request);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+}
+
+mkernel_internal_error kernel_request_service_init()
+{
+	g_request_count = 0;
+	g_request_slot = (kernel_request **)malloc(sizeof(kernel_request *) * ezdev_sdk_request_slot_max);
+	if (g_request_slot == NULL)
+	{
+		return mkernel_internal_malloc_error;
+	}
+	memset(g_request_slot, 0, sizeof(kernel_request *) * ezdev_sdk_request_slot_max);
+
+	g_request_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	if (g_request_lock == NULL)
+	{
+		free(g_request_slot);
+		g_request_slot = NULL;
+		return mkernel_internal_malloc_error;
+	}
+
+	return mkernel_internal_succ;
+}
+
+void kernel_request_service_fini()
+{
+	kernel_request *request = NULL;
+
+	if (g_request_lock == NULL)
+	{
+		return;
+	}
+
+	/* 先通知还在等待的请求, 剩下的是已摘除但定时器未到期的请求, 此时微内核线程已经停止, 直接释放 */
+	kernel_request_cancel_all(mkernel_internal_request_cancelled);
+	while (g_request_list != NULL)
+	{
+		request = g_request_list;
+		g_request_list = request->next;
+		kernel_timer_stop(&request->timer);
+		free(request);
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_destroy(g_request_lock);
+	g_request_lock = NULL;
+	free(g_request_slot);
+	g_request_slot = NULL;
+	g_request_count = 0;
+}
+
+mkernel_internal_error kernel_request_add(EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT8 proto, const char *module, EZDEV_SDK_UINT32 domain_id,
+										  const char *msg_type, const sdk_request_option *option)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	kernel_request *request = NULL;
+
+	if (NULL == option || 0 == option->timeout_ms || (kernel_request_v3 == proto && NULL == module))
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+
+	if (NULL == g_request_lock)
+	{
+		return mkernel_internal_invald_call;
+	}
+
+	request = (kernel_request *)malloc(sizeof(kernel_request));
+	if (NULL == request)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	memset(request, 0, sizeof(kernel_request));
+	kernel_timer_init(&request->timer, request_timeout_cb);
+	request->seq = seq;
+	request->proto = proto;
+	request->state = request_pending;
+	request->domain_id = domain_id;
+	request->rsp_command_id = option->rsp_command_id;
+	request->cb = option->cb;
+	request->user_data = option->user_data;
+	if (kernel_request_v3 == proto)
+	{
+		strncpy(request->module, module, ezdev_sdk_module_name_len - 1);
+		if (0 != strlen(option->rsp_msg_type))
+		{
+			/* 两边一样长, 请求已清零, 末尾留一个0 */
+			memcpy(request->rsp_msg_type, option->rsp_msg_type, ezdev_sdk_msg_type_len - 1);
+		}
+		else if (NULL != msg_type)
+		{
+			snprintf(request->rsp_msg_type, ezdev_sdk_msg_type_len, "%s_reply", msg_type);
+		}
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	do
+	{
+		if (g_request_count >= kernel_request_count_max)
+		{
+			sdk_error = mkernel_internal_queue_full;
+			break;
+		}
+		if (request_find(seq) < ezdev_sdk_request_slot_max)
+		{
+			sdk_error = mkernel_internal_invald_call;
+			break;
+		}
+		request_insert(request);
+		request->next = g_request_list;
+		if (g_request_list != NULL)
+		{
+			g_request_list->prev = request;
+		}
+		g_request_list = request;
+	} while (0);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+
+	if (mkernel_internal_succ != sdk_error)
+	{
+		free(request);
+		return sdk_error;
+	}
+
+	/* 启动定时器时可能顺带触发其他请求的超时回调, 不能持锁; 启动前就被完成或取消的请求会标记为abandoned, 等这个定时器到期再释放 */
+	kernel_timer_start(&request->timer, option->timeout_ms);
+	return mkernel_internal_succ;
+}
+
+mkernel_internal_error kernel_request_cancel(EZDEV_SDK_UINT32 seq)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	kernel_request *request = NULL;
+	EZDEV_SDK_UINT32 i = 0;
+
+	if (NULL == g_request_lock)
+	{
+		return mkernel_internal_invald_call;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	i = request_find(seq);
+	if (i < ezdev_sdk_request_slot_max)
+	{
+		request = g_request_slot[i];
+		request_remove(i);
+		request_release(request);
+	}
+	else
+	{
+		/* 已经完成、超时, 或者回调正在进行 */
+		sdk_error = mkernel_internal_input_param_invalid;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+
+	return sdk_error;
+}
+
+void kernel_request_cancel_all(mkernel_internal_error reason)
+{
+	kernel_request *notify_list = NULL;
+	kernel_request *request = NULL;
+	EZDEV_SDK_UINT32 i = 0;
+
+	if (NULL == g_request_lock)
+	{
+		return;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	for (i = 0; i < ezdev_sdk_request_slot_max && g_request_count != 0; i++)
+	{
+		request = g_request_slot[i];
+		if (request == NULL || request_pending != request->state)
+		{
+			continue;
+		}
+
+		/* 整张表都要清空, 不需要回移 */
+		g_request_slot[i] = NULL;
+		g_request_count--;
+		request->state = request_notifying;
+		request->notify_next = notify_list;
+		notify_list = request;
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+
+	for (request = notify_list; request != NULL; request = request->notify_next)
+	{
+		request_notify(request, reason, NULL, NULL);
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	while (notify_list != NULL)
+	{
+		request = notify_list;
+		notify_list = request->notify_next;
+		request_release(request);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+}
+
+static kernel_request *request_take(EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT8 proto, const char *module, const char *msg_type,
+									EZDEV_SDK_UINT32 domain_id, EZDEV_SDK_UINT32 command_id)
+{
+	kernel_request *request = NULL;
+	EZDEV_SDK_UINT32 i = 0;
+
+	if (NULL == g_request_lock)
+	{
+		return NULL;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	do
+	{
+		if (0 == g_request_count)
+		{
+			break;
+		}
+
+		i = request_find(seq);
+		if (i >= ezdev_sdk_request_slot_max)
+		{
+			break;
+		}
+
+		/* 平台下发的请求也带seq, 可能和设备的seq重复, 必须核对响应类型 */
+		request = g_request_slot[i];
+		if (request->proto != proto ||
+			(kernel_request_v3 == proto && (0 != strcmp(request->module, module) || 0 != strcmp(request->rsp_msg_type, msg_type))) ||
+			(kernel_request_v2 == proto && (request->domain_id != domain_id || request->rsp_command_id != command_id)))
+		{
+			request = NULL;
+			break;
+		}
+
+		request_remove(i);
+		request->state = request_notifying;
+	} while (0);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+
+	return request;
+}
+
+static void request_finish(kernel_request *request, ezdev_sdk_kernel_submsg *rsp, ezdev_sdk_kernel_submsg_v3 *rsp_v3)
+{
+	request_notify(request, mkernel_internal_succ, rsp, rsp_v3);
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	request_release(request);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+}
+
+EZDEV_SDK_BOOL kernel_request_complete(ezdev_sdk_kernel_submsg *rsp)
+{
+	kernel_request *request = request_take(rsp->msg_seq, kernel_request_v2, NULL, NULL, rsp->msg_domain_id, rsp->msg_command_id);
+	if (NULL == request)
+	{
+		return EZDEV_SDK_FALSE;
+	}
+
+	request_finish(request, rsp, NULL);
+	return EZDEV_SDK_TRUE;
+}
+
+EZDEV_SDK_BOOL kernel_request_complete_v3(ezdev_sdk_kernel_submsg_v3 *rsp_v3)
+{
+	kernel_request *request = request_take(rsp_v3->msg_seq, kernel_request_v3, rsp_v3->module, rsp_v3->msg_type, 0, 0);
+	if (NULL == request)
+	{
+		return EZDEV_SDK_FALSE;
+	}
+
+	request_finish(request, NULL, rsp_v3);
+	return EZDEV_SDK_TRUE;
+}
+
+void kernel_request_waiter_init(kernel_request_waiter *waiter, void *buf, EZDEV_SDK_UINT32 buf_size)
+{
+	memset(waiter, 0, sizeof(kernel_request_waiter));
+	waiter->buf = buf;
+	waiter->buf_size = (NULL != buf) ? buf_size : 0;
+	/* 必须在发出请求之前创建, 回调可能在kernel_request_wait之前就到了 */
+	waiter->sem = ezdev_sdk_kernel_platform_thread_sem_create();
+}
+
+void kernel_request_waiter_fini(kernel_request_waiter *waiter)
+{
+	ezdev_sdk_kernel_platform_thread_sem_destroy(waiter->sem);
+	waiter->sem = NULL;
+}
+
+void kernel_request_waiter_cb(const sdk_request_result *result)
+{
+	kernel_request_waiter *waiter = (kernel_request_waiter *)result->user_data;
+	void *buf = NULL;
+	EZDEV_SDK_UINT32 buf_len = 0;
+
+	if (NULL != result->rsp)
+	{
+		buf = result->rsp->buf;
+		buf_len = result->rsp->buf_len;
+	}
+	else if (NULL != result->rsp_v3)
+	{
+		buf = result->rsp_v3->buf;
+		buf_len = result->rsp_v3->buf_len;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+	waiter->result = result->result;
+	waiter->len = buf_len;
+	if (NULL != buf && NULL != waiter->buf && buf_len <= waiter->buf_size)
+	{
+		memcpy(waiter->buf, buf, buf_len);
+	}
+	waiter->done = 1;
+	/* 持锁释放信号量, 等待者看到done时这里已经不再访问waiter, 可以销毁信号量 */
+	ezdev_sdk_kernel_platform_thread_sem_post(waiter->sem);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+}
+
+void kernel_request_wait(kernel_request_waiter *waiter, EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT32 timeout_ms)
+{
+	EZDEV_SDK_UINT32 begin = kernel_timer_now();
+	EZDEV_SDK_UINT32 limit = timeout_ms + kernel_request_wait_slack;
+	EZDEV_SDK_UINT32 elapsed = 0;
+	EZDEV_SDK_INT8 done = 0;
+
+	for (;;)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_lock(g_request_lock);
+		done = waiter->done;
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_request_lock);
+		if (done)
+		{
+			break;
+		}
+
+		/* 微内核线程没有在跑时定时器不会到期, 超过期限后自己取消; 取消失败说明回调正在进行, 继续等它写完 */
+		elapsed = kernel_timer_now() - begin;
+		if (elapsed > limit && mkernel_internal_succ == kernel_request_cancel(seq))
+		{
+			waiter->result = ezdev_sdk_kernel_request_timeout;
+			break;
+		}
+
+		if (NULL == waiter->sem)
+		{
+			g_ezdev_sdk_kernel.platform_handle.time_sleep(kernel_request_wait_step);
+		}
+		else
+		{
+			/* 回调释放信号量时立即醒来; 到了期限还没醒, 回到上面取消请求, 取消失败时等回调写完 */
+			ezdev_sdk_kernel_platform_thread_sem_wait(waiter->sem, elapsed < limit ? limit - elapsed + 1 : kernel_request_wait_step);
+		}
+	}
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_REQUEST_H_
+#define H_EZDEV_SDK_KERNEL_REQUEST_H_
+
+#include "base_typedef.h"
+#include "ezdev_sdk_kernel_struct.h"
+
+#define kernel_request_v2		2
+#define kernel_request_v3		3
+
+/**
+ * \brief 同步等待的结果, 放在调用者栈上
+ */
+typedef struct
+{
+	EZDEV_SDK_INT8 done;				///<	请求已结束
+	EZDEV_SDK_UINT32 result;			///<	请求结果, ezdev_sdk_kernel_error
+	void *buf;							///<	响应缓冲区
+	EZDEV_SDK_UINT32 buf_size;			///<	响应缓冲区大小
+	EZDEV_SDK_UINT32 len;				///<	响应实际长度, 大于buf_size时没有拷贝
+	ezdev_sdk_sem sem;					///<	回调时唤醒等待者, 平台没有提供信号量时为NULL
+} kernel_request_waiter;
+
+/**
+ * \brief 微内核请求/响应关联服务
+ * \note
+ * - 请求按seq放在开放寻址(线性探测)的哈希表里, 删除时回移后继元素, 不留墓碑
+ * - 每个请求一个时间轮定时器, 到期回调超时; 收到响应时在接收路径上直接完成, 不进入领域分发队列
+ * - 完成和断线取消在微内核线程中回调; 超时回调在驱动时间轮的线程中执行, 可能是启动定时器的用户线程
+ * - 回调期间请求已经从哈希表摘除, 不持锁; 定时器正在触发、摘不下来的请求标记为abandoned, 由定时器回调释放
+ * - kernel_request_wait用于同步接口, 在调用者线程中等待回调释放信号量; 平台没有提供信号量时退化为轮询
+ */
+#define EZDEV_SDK_KERNEL_REQUEST_INTERFACE	\
+	extern mkernel_internal_error kernel_request_service_init(); \
+	extern void kernel_request_service_fini(); \
+	extern mkernel_internal_error kernel_request_add(EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT8 proto, const char *module, EZDEV_SDK_UINT32 domain_id, \
+													 const char *msg_type, const sdk_request_option *option); \
+	extern mkernel_internal_error kernel_request_cancel(EZDEV_SDK_UINT32 seq); \
+	extern void kernel_request_cancel_all(mkernel_internal_error reason); \
+	extern EZDEV_SDK_BOOL kernel_request_complete(ezdev_sdk_kernel_submsg *rsp); \
+	extern EZDEV_SDK_BOOL kernel_request_complete_v3(ezdev_sdk_kernel_submsg_v3 *rsp_v3); \
+	extern void kernel_request_waiter_init(kernel_request_waiter *waiter, void *buf, EZDEV_SDK_UINT32 buf_size); \
+	extern void kernel_request_waiter_fini(kernel_request_waiter *waiter); \
+	extern void kernel_request_waiter_cb(const sdk_request_result *result); \
+	extern void kernel_request_wait(kernel_request_waiter *waiter, EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT32 timeout_ms);
+
+#endif
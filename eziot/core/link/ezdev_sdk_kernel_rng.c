@@ -0,0 +1,241 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include "ezdev_sdk_kernel_rng.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "mkernel_internal_error.h"
+#include "sdk_kernel_def.h"
+
+#ifndef _REALTEK_RTOS_
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#endif
+
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(_RT_THREAD_)
+#include <unistd.h>
+#define KERNEL_RNG_FORK_DETECT
+#endif
+
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_RNG_INTERFACE
+
+#define kernel_rng_personalization		"ezDevSDK"
+
+static ezdev_sdk_mutex g_rng_lock = NULL;
+static EZDEV_SDK_INT8 g_rng_ready = 0;
+
+#ifndef _REALTEK_RTOS_
+
+static bscomptls_ctr_drbg_context g_rng_drbg;
+static bscomptls_entropy_context g_rng_entropy;
+static kernel_timer g_rng_reseed_timer;
+#ifdef KERNEL_RNG_FORK_DETECT
+static pid_t g_rng_pid = 0;
+#endif
+
+static int rng_random_once(unsigned char *output, size_t output_len)
+{
+	int ret = 0;
+	size_t use_len = 0;
+	bscomptls_ctr_drbg_context ctr_drbg;
+	bscomptls_entropy_context entropy;
+	bscomptls_ctr_drbg_init(&ctr_drbg);
+	bscomptls_entropy_init(&entropy);
+
+	do
+	{
+		ret = bscomptls_ctr_drbg_seed(&ctr_drbg, bscomptls_entropy_func, &entropy,
+									  (const unsigned char *)kernel_rng_personalization, strlen(kernel_rng_personalization));
+		if (ret != 0)
+		{
+			break;
+		}
+
+		while (output_len > 0)
+		{
+			use_len = output_len > BSCOMPTLS_CTR_DRBG_MAX_REQUEST ? BSCOMPTLS_CTR_DRBG_MAX_REQUEST : output_len;
+			ret = bscomptls_ctr_drbg_random(&ctr_drbg, output, use_len);
+			if (ret != 0)
+			{
+				break;
+			}
+			output += use_len;
+			output_len -= use_len;
+		}
+	} while (0);
+
+	bscomptls_ctr_drbg_free(&ctr_drbg);
+	bscomptls_entropy_free(&entropy);
+
+	return ret;
+}
+
+mkernel_internal_error kernel_rng_service_init()
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+
+	bscomptls_ctr_drbg_init(&g_rng_drbg);
+	bscomptls_entropy_init(&g_rng_entropy);
+
+	do
+	{
+		g_rng_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+		if (g_rng_lock == NULL)
+		{
+			sdk_error = mkernel_internal_malloc_error;
+			break;
+		}
+
+		if (0 != bscomptls_ctr_drbg_seed(&g_rng_drbg, bscomptls_entropy_func, &g_rng_entropy,
+										 (const unsigned char *)kernel_rng_personalization, strlen(kernel_rng_personalization)))
+		{
+			sdk_error = mkernel_internal_internal_err;
+			break;
+		}
+		bscomptls_ctr_drbg_set_prediction_resistance(&g_rng_drbg, BSCOMPTLS_CTR_DRBG_PR_OFF);
+
+		kernel_timer_init(&g_rng_reseed_timer, NULL);
+		kernel_timer_start(&g_rng_reseed_timer, kernel_rng_reseed_interval_ms);
+#ifdef KERNEL_RNG_FORK_DETECT
+		g_rng_pid = getpid();
+#endif
+		g_rng_ready = 1;
+	} while (0);
+
+	if (sdk_error != mkernel_internal_succ)
+	{
+		kernel_rng_service_fini();
+	}
+
+	return sdk_error;
+}
+
+void kernel_rng_service_fini()
+{
+	g_rng_ready = 0;
+	kernel_timer_stop(&g_rng_reseed_timer);
+	bscomptls_ctr_drbg_free(&g_rng_drbg);
+	bscomptls_entropy_free(&g_rng_entropy);
+
+	if (g_rng_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_destroy(g_rng_lock);
+		g_rng_lock = NULL;
+	}
+}
+
+int kernel_rng_random(void *p_rng, unsigned char *output, size_t output_len)
+{
+	int ret = 0;
+	int reseed = 0;
+	size_t use_len = 0;
+	EZDEV_SDK_UNUSED(p_rng);
+
+	if (!g_rng_ready)
+	{
+		return rng_random_once(output, output_len);
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_rng_lock);
+	do
+	{
+		if (kernel_timer_expired(&g_rng_reseed_timer))
+		{
+			reseed = 1;
+		}
+#ifdef KERNEL_RNG_FORK_DETECT
+		if (g_rng_pid != getpid())
+		{
+			g_rng_pid = getpid();
+			reseed = 1;
+		}
+#endif
+		if (reseed)
+		{
+			ret = bscomptls_ctr_drbg_reseed(&g_rng_drbg, NULL, 0);
+			if (ret != 0)
+			{
+				break;
+			}
+			kernel_timer_start(&g_rng_reseed_timer, kernel_rng_reseed_interval_ms);
+		}
+
+		while (output_len > 0)
+		{
+			use_len = output_len > BSCOMPTLS_CTR_DRBG_MAX_REQUEST ? BSCOMPTLS_CTR_DRBG_MAX_REQUEST : output_len;
+			ret = bscomptls_ctr_drbg_random(&g_rng_drbg, output, use_len);
+			if (ret != 0)
+			{
+				break;
+			}
+			output += use_len;
+			output_len -= use_len;
+		}
+	} while (0);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_rng_lock);
+
+	return ret;
+}
+
+#else
+
+/* realtek rtos上mbedtls的CTR_DRBG编译有问题, 退化为rand() */
+
+mkernel_internal_error kernel_rng_service_init()
+{
+	g_rng_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	if (g_rng_lock == NULL)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	g_rng_ready = 1;
+	return mkernel_internal_succ;
+}
+
+void kernel_rng_service_fini()
+{
+	g_rng_ready = 0;
+	if (g_rng_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_destroy(g_rng_lock);
+		g_rng_lock = NULL;
+	}
+}
+
+int kernel_rng_random(void *p_rng, unsigned char *output, size_t output_len)
+{
+	size_t i = 0;
+	EZDEV_SDK_UNUSED(p_rng);
+
+	if (g_rng_ready)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_lock(g_rng_lock);
+	}
+	for (i = 0; i < output_len; i++)
+	{
+		output[i] = (unsigned char)rand();
+	}
+	if (g_rng_ready)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_rng_lock);
+	}
+
+	return 0;
+}
+
+#endif
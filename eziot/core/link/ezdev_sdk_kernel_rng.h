@@ -0,0 +1,35 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_RNG_H_
+#define H_EZDEV_SDK_KERNEL_RNG_H_
+
+#include <stddef.h>
+#include "base_typedef.h"
+
+#define kernel_rng_reseed_interval_ms		(60 * 60 * 1000)	///<	按时间重新注入熵的间隔
+
+/**
+ * \brief 微内核随机数服务, 整个微内核共用一个CTR_DRBG, 只在初始化时采集一次熵
+ * \note
+ * - 每隔kernel_rng_reseed_interval_ms或者DRBG的请求次数到达上限时重新注入熵
+ * - 支持fork的平台上, 检测到进程号变化时先重新注入熵, 避免父子进程输出相同的随机数
+ * - kernel_rng_random的原型与bscomptls的f_rng一致, 可直接传给RSA/ECDH接口, p_rng传NULL即可
+ * - 服务未初始化时(如微内核初始化之前)退化为每次调用临时注入熵
+ */
+#define EZDEV_SDK_KERNEL_RNG_INTERFACE	\
+	extern mkernel_internal_error kernel_rng_service_init(); \
+	extern void kernel_rng_service_fini(); \
+	extern int kernel_rng_random(void *p_rng, unsigned char *output, size_t output_len);
+
+#endif
@@ -0,0 +1,303 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <string.h>
+#include "ezdev_sdk_kernel_shaper.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "mkernel_internal_error.h"
+#include "sdk_kernel_def.h"
+
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+EZDEV_SDK_KERNEL_SHAPER_INTERFACE
+
+#define kernel_shaper_scale		1000	///<	令牌按千分之一计数, 毫秒级补充时不丢精度
+
+/**
+ * \brief 令牌桶, tokens和burst都已乘kernel_shaper_scale
+ */
+typedef struct
+{
+	EZDEV_SDK_UINT32 rate;			///<	每秒补充的令牌数, 0表示不限速
+	EZDEV_SDK_INT64 burst;			///<	桶容量
+	EZDEV_SDK_INT64 tokens;			///<	当前令牌, 强制放行时可以为负
+} shaper_bucket;
+
+typedef struct
+{
+	EZDEV_SDK_INT8 used;
+	EZDEV_SDK_INT8 deferring;		///<	已上报过延后事件, 积压发完(桶重新攒满)后清除
+	sdk_shaper_scope scope;
+	char module[ezdev_sdk_module_name_len];
+	EZDEV_SDK_UINT32 domain_id;
+	EZDEV_SDK_UINT32 last_ms;		///<	上次补充令牌的时刻
+	shaper_bucket msgs;
+	shaper_bucket bytes;
+} shaper_entry;
+
+static shaper_entry g_shaper_entry[kernel_shaper_max];
+static ezdev_sdk_mutex g_shaper_lock = NULL;
+
+static void bucket_set(shaper_bucket *bucket, EZDEV_SDK_UINT32 rate, EZDEV_SDK_UINT32 burst, EZDEV_SDK_INT8 fill)
+{
+	bucket->rate = rate;
+	bucket->burst = (EZDEV_SDK_INT64)(burst != 0 ? burst : rate) * kernel_shaper_scale;
+	if (fill || bucket->tokens > bucket->burst)
+	{
+		bucket->tokens = bucket->burst;
+	}
+}
+
+static void bucket_refill(shaper_bucket *bucket, EZDEV_SDK_UINT32 elapsed_ms)
+{
+	if (bucket->rate == 0)
+	{
+		return;
+	}
+
+	/* rate个/秒 == rate*scale/1000个(已缩放)/毫秒, scale取1000时恰好是rate */
+	bucket->tokens += (EZDEV_SDK_INT64)elapsed_ms * bucket->rate * kernel_shaper_scale / 1000;
+	if (bucket->tokens > bucket->burst)
+	{
+		bucket->tokens = bucket->burst;
+	}
+}
+
+static EZDEV_SDK_UINT32 bucket_wait_ms(const shaper_bucket *bucket, EZDEV_SDK_UINT32 cost)
+{
+	EZDEV_SDK_INT64 need = (EZDEV_SDK_INT64)cost * kernel_shaper_scale;
+	EZDEV_SDK_INT64 wait = 0;
+
+	if (bucket->rate == 0)
+	{
+		return 0;
+	}
+
+	/* 超过桶容量的消息等桶满即可, 否则永远发不出去 */
+	if (need > bucket->burst)
+	{
+		need = bucket->burst;
+	}
+	if (bucket->tokens >= need)
+	{
+		return 0;
+	}
+
+	wait = ((need - bucket->tokens) * 1000 + (EZDEV_SDK_INT64)bucket->rate * kernel_shaper_scale - 1) / ((EZDEV_SDK_INT64)bucket->rate * kernel_shaper_scale);
+	return wait > 0xFFFFFFFE ? 0xFFFFFFFE : (EZDEV_SDK_UINT32)wait;
+}
+
+static EZDEV_SDK_INT8 entry_match(const shaper_entry *entry, sdk_shaper_scope scope, const char *module, EZDEV_SDK_UINT32 domain_id)
+{
+	if (!entry->used || entry->scope != scope)
+	{
+		return 0;
+	}
+
+	switch (scope)
+	{
+	case sdk_shaper_module:
+		return 0 == strncmp(entry->module, module, ezdev_sdk_module_name_len - 1);
+	case sdk_shaper_domain:
+		return entry->domain_id == domain_id;
+	default:
+		return 1;
+	}
+}
+
+static shaper_entry *entry_find(sdk_shaper_scope scope, const char *module, EZDEV_SDK_UINT32 domain_id)
+{
+	int i = 0;
+	for (i = 0; i < kernel_shaper_max; i++)
+	{
+		if (entry_match(&g_shaper_entry[i], scope, module, domain_id))
+		{
+			return &g_shaper_entry[i];
+		}
+	}
+
+	return NULL;
+}
+
+mkernel_internal_error kernel_shaper_service_init()
+{
+	memset(g_shaper_entry, 0, sizeof(g_shaper_entry));
+	g_shaper_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	if (g_shaper_lock == NULL)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	return mkernel_internal_succ;
+}
+
+void kernel_shaper_service_fini()
+{
+	if (g_shaper_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_destroy(g_shaper_lock);
+		g_shaper_lock = NULL;
+	}
+	memset(g_shaper_entry, 0, sizeof(g_shaper_entry));
+}
+
+mkernel_internal_error kernel_shaper_config(const sdk_shaper_config *config, EZDEV_SDK_UINT32 now_ms)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	shaper_entry *entry = NULL;
+	EZDEV_SDK_INT8 fill = 0;
+	int i = 0;
+
+	if (NULL == config || config->scope > sdk_shaper_domain ||
+		(sdk_shaper_module == config->scope && 0 == strlen(config->module)))
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+
+	if (NULL == g_shaper_lock)
+	{
+		return mkernel_internal_invald_call;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_shaper_lock);
+	do
+	{
+		entry = entry_find(config->scope, config->module, config->domain_id);
+
+		/* 两个速率都为0表示取消限速 */
+		if (0 == config->msg_rate && 0 == config->byte_rate)
+		{
+			if (NULL != entry)
+			{
+				memset(entry, 0, sizeof(shaper_entry));
+			}
+			break;
+		}
+
+		if (NULL == entry)
+		{
+			for (i = 0; i < kernel_shaper_max && g_shaper_entry[i].used; i++)
+			{
+			}
+			if (i == kernel_shaper_max)
+			{
+				sdk_error = mkernel_internal_mem_lack;
+				break;
+			}
+
+			entry = &g_shaper_entry[i];
+			memset(entry, 0, sizeof(shaper_entry));
+			entry->used = 1;
+			entry->scope = config->scope;
+			memcpy(entry->module, config->module, sizeof(entry->module) - 1);
+			entry->domain_id = config->domain_id;
+			entry->last_ms = now_ms;
+			fill = 1;
+		}
+
+		bucket_set(&entry->msgs, config->msg_rate, config->msg_burst, fill);
+		bucket_set(&entry->bytes, config->byte_rate, config->byte_burst, fill);
+	} while (0);
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_shaper_lock);
+
+	return sdk_error;
+}
+
+EZDEV_SDK_UINT32 kernel_shaper_acquire(const char *module, EZDEV_SDK_UINT32 domain_id, EZDEV_SDK_UINT32 bytes, EZDEV_SDK_INT8 force,
+									   EZDEV_SDK_UINT32 now_ms, sdk_send_shaped_context *shaped, EZDEV_SDK_INT8 *report)
+{
+	shaper_entry *entry[2] = {NULL, NULL};
+	shaper_entry *blocker = NULL;
+	EZDEV_SDK_UINT32 wait_ms = 0;
+	EZDEV_SDK_UINT32 entry_wait = 0;
+	int i = 0;
+
+	*report = 0;
+	if (NULL == g_shaper_lock)
+	{
+		return 0;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_shaper_lock);
+
+	entry[0] = entry_find(sdk_shaper_global, NULL, 0);
+	entry[1] = NULL != module ? entry_find(sdk_shaper_module, module, 0) : entry_find(sdk_shaper_domain, NULL, domain_id);
+
+	for (i = 0; i < 2; i++)
+	{
+		if (NULL == entry[i])
+		{
+			continue;
+		}
+
+		bucket_refill(&entry[i]->msgs, now_ms - entry[i]->last_ms);
+		bucket_refill(&entry[i]->bytes, now_ms - entry[i]->last_ms);
+		entry[i]->last_ms = now_ms;
+
+		entry_wait = bucket_wait_ms(&entry[i]->msgs, 1);
+		if (bucket_wait_ms(&entry[i]->bytes, bytes) > entry_wait)
+		{
+			entry_wait = bucket_wait_ms(&entry[i]->bytes, bytes);
+		}
+		if (entry_wait > wait_ms)
+		{
+			wait_ms = entry_wait;
+			blocker = entry[i];
+		}
+	}
+
+	if (force)
+	{
+		wait_ms = 0;
+	}
+
+	if (0 == wait_ms)
+	{
+		for (i = 0; i < 2; i++)
+		{
+			if (NULL == entry[i])
+			{
+				continue;
+			}
+
+			/* 桶已经攒满说明积压已经发完, 之后再被限速算新的一次延后 */
+			if ((entry[i]->msgs.rate == 0 || entry[i]->msgs.tokens >= entry[i]->msgs.burst) &&
+				(entry[i]->bytes.rate == 0 || entry[i]->bytes.tokens >= entry[i]->bytes.burst))
+			{
+				entry[i]->deferring = 0;
+			}
+
+			if (entry[i]->msgs.rate != 0)
+			{
+				entry[i]->msgs.tokens -= kernel_shaper_scale;
+			}
+			if (entry[i]->bytes.rate != 0)
+			{
+				entry[i]->bytes.tokens -= (EZDEV_SDK_INT64)bytes * kernel_shaper_scale;
+			}
+		}
+	}
+	else if (NULL != blocker && !blocker->deferring)
+	{
+		blocker->deferring = 1;
+		*report = 1;
+		memset(shaped, 0, sizeof(sdk_send_shaped_context));
+		shaped->scope = blocker->scope;
+		memcpy(shaped->module, blocker->module, sizeof(shaped->module));
+		shaped->domain_id = blocker->domain_id;
+		shaped->delay_ms = wait_ms;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_shaper_lock);
+
+	return wait_ms;
+}
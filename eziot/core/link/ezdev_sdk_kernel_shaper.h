@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_SHAPER_H_
+#define H_EZDEV_SDK_KERNEL_SHAPER_H_
+
+#include "base_typedef.h"
+#include "ezdev_sdk_kernel_struct.h"
+
+#define kernel_shaper_max		16		///<	全局、module、领域限速合计的最大条数
+
+/**
+ * \brief 微内核发送限速服务, 在发送队列出队前按令牌桶判断是否放行
+ * \note
+ * - 一条消息同时受全局限速和所属module(v3)/领域(v2)限速约束, 全部放行才扣减额度
+ * - 不放行时返回需要等待的毫秒数, 消息留在队列中, 由调用者稍后重试
+ * - force为1时(control分道)直接放行, 额度允许扣成负数, 由之后的消息偿还
+ * - 单条消息超过桶容量时, 等桶满后放行, 同样扣成负数, 不会永远卡住
+ * - 时间由调用者传入, 不依赖平台时钟
+ */
+#define EZDEV_SDK_KERNEL_SHAPER_INTERFACE	\
+	extern mkernel_internal_error kernel_shaper_service_init(); \
+	extern void kernel_shaper_service_fini(); \
+	extern mkernel_internal_error kernel_shaper_config(const sdk_shaper_config *config, EZDEV_SDK_UINT32 now_ms); \
+	extern EZDEV_SDK_UINT32 kernel_shaper_acquire(const char *module, EZDEV_SDK_UINT32 domain_id, EZDEV_SDK_UINT32 bytes, EZDEV_SDK_INT8 force, \
+												  EZDEV_SDK_UINT32 now_ms, sdk_send_shaped_context *shaped, EZDEV_SDK_INT8 *report);
+
+#endif
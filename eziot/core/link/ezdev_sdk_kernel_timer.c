@@ -0,0 +1,526 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <string.h>
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "mkernel_internal_error.h"
+#include "sdk_kernel_def.h"
+
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+/**
+ * \brief 分层时间轮, 刻度1毫秒, 第0层64个槽位, 其上4层各64个槽位, 共覆盖2^30毫秒(约12天)
+ *        超出范围的定时器先放在最高层, 到位后按真实到期时刻重新挂入
+ */
+#define TVR_BITS		6
+#define TVN_BITS		6
+#define TVN_LEVELS		4
+#define TVR_SIZE		(1 << TVR_BITS)
+#define TVN_SIZE		(1 << TVN_BITS)
+#define TVR_MASK		(TVR_SIZE - 1)
+#define TVN_MASK		(TVN_SIZE - 1)
+#define MAX_TVAL		((EZDEV_SDK_UINT32)((1UL << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1))
+#define TVN_INDEX(jiffies, n)	(((jiffies) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+/**
+ * \brief 时钟只占用一个平台定时器, 从kernel_timer_clock_span开始倒计时, 剩余时间过半时重新倒计时并累加基准
+ */
+#define kernel_timer_clock_span		0x7FFFFFFF
+
+#define time_after_eq(a, b)		((EZDEV_SDK_INT32)((a) - (b)) >= 0)
+
+static kernel_timer *g_timer_tv1[TVR_SIZE];
+static kernel_timer *g_timer_tvn[TVN_LEVELS][TVN_SIZE];
+static EZDEV_SDK_UINT32 g_timer_jiffies = 0;		///<	时间轮已经处理到的刻度
+static EZDEV_SDK_UINT32 g_timer_tv1_count = 0;		///<	第0层的定时器数量
+static EZDEV_SDK_UINT32 g_timer_pending_count = 0;	///<	时间轮上的定时器数量
+static ezdev_sdk_time g_timer_clock = NULL;
+static EZDEV_SDK_UINT32 g_timer_clock_base = 0;
+static ezdev_sdk_mutex g_timer_lock = NULL;
+static EZDEV_SDK_INT8 g_timer_waiting = 0;			///<	微内核线程正按next_deadline的结果阻塞等待
+static EZDEV_SDK_UINT32 g_timer_wait_until = 0;	///<	阻塞等待到的时刻
+static void (*g_timer_wakeup)(void) = NULL;
+
+static void timer_lock()
+{
+	if (g_timer_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_lock(g_timer_lock);
+	}
+}
+
+static void timer_unlock()
+{
+	if (g_timer_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_unlock(g_timer_lock);
+	}
+}
+
+static EZDEV_SDK_UINT32 timer_clock_now()
+{
+	EZDEV_SDK_UINT32 left = 0;
+	EZDEV_SDK_UINT32 elapsed = 0;
+
+	if (g_timer_clock == NULL)
+	{
+		return g_timer_clock_base;
+	}
+
+	left = g_ezdev_sdk_kernel.platform_handle.time_leftms(g_timer_clock);
+	elapsed = kernel_timer_clock_span - left;
+	if (left < kernel_timer_clock_span / 2)
+	{
+		g_timer_clock_base += elapsed;
+		g_ezdev_sdk_kernel.platform_handle.time_countdownms(g_timer_clock, kernel_timer_clock_span);
+		elapsed = 0;
+	}
+
+	return g_timer_clock_base + elapsed;
+}
+
+static kernel_timer **timer_slot_head(EZDEV_SDK_UINT8 level, EZDEV_SDK_UINT8 slot)
+{
+	return level == 0 ? &g_timer_tv1[slot] : &g_timer_tvn[level - 1][slot];
+}
+
+static void timer_internal_add(kernel_timer *timer)
+{
+	EZDEV_SDK_UINT32 expires = timer->expires;
+	EZDEV_SDK_UINT32 idx = expires - g_timer_jiffies;
+	kernel_timer **head = NULL;
+	EZDEV_SDK_UINT8 level = 0;
+
+	if ((EZDEV_SDK_INT32)idx < 0)
+	{
+		/* 已经到期, 放到下一个要处理的槽位 */
+		timer->level = 0;
+		timer->slot = g_timer_jiffies & TVR_MASK;
+	}
+	else if (idx < TVR_SIZE)
+	{
+		timer->level = 0;
+		timer->slot = expires & TVR_MASK;
+	}
+	else
+	{
+		if (idx > MAX_TVAL)
+		{
+			expires = g_timer_jiffies + MAX_TVAL;
+			idx = MAX_TVAL;
+		}
+		for (level = 1; level < TVN_LEVELS; level++)
+		{
+			if (idx < (1UL << (TVR_BITS + level * TVN_BITS)))
+			{
+				break;
+			}
+		}
+		timer->level = level;
+		timer->slot = TVN_INDEX(expires, level - 1);
+	}
+
+	head = timer_slot_head(timer->level, timer->slot);
+	timer->prev = NULL;
+	timer->next = *head;
+	if (*head != NULL)
+	{
+		(*head)->prev = timer;
+	}
+	*head = timer;
+	timer->pending = 1;
+	g_timer_pending_count++;
+	if (timer->level == 0)
+	{
+		g_timer_tv1_count++;
+	}
+}
+
+static void timer_detach(kernel_timer *timer)
+{
+	kernel_timer **head = timer_slot_head(timer->level, timer->slot);
+
+	if (timer->prev != NULL)
+	{
+		timer->prev->next = timer->next;
+	}
+	else
+	{
+		*head = timer->next;
+	}
+	if (timer->next != NULL)
+	{
+		timer->next->prev = timer->prev;
+	}
+	timer->next = NULL;
+	timer->prev = NULL;
+	timer->pending = 0;
+	g_timer_pending_count--;
+	if (timer->level == 0)
+	{
+		g_timer_tv1_count--;
+	}
+}
+
+static EZDEV_SDK_UINT32 timer_cascade(EZDEV_SDK_UINT8 level, EZDEV_SDK_UINT32 index)
+{
+	kernel_timer *timer = g_timer_tvn[level - 1][index];
+	kernel_timer *next = NULL;
+
+	while (timer != NULL)
+	{
+		next = timer->next;
+		timer_detach(timer);
+		timer_internal_add(timer);
+		timer = next;
+	}
+	return index;
+}
+
+/**
+ * \brief 把时间轮推进到now, 返回到期且设置了回调的定时器链表(用next串起来)
+ */
+static kernel_timer *timer_run(EZDEV_SDK_UINT32 now)
+{
+	kernel_timer *expired_list = NULL;
+	kernel_timer *timer = NULL;
+	kernel_timer *next = NULL;
+	EZDEV_SDK_UINT32 index = 0;
+	EZDEV_SDK_UINT32 boundary = 0;
+	EZDEV_SDK_UINT8 level = 0;
+
+	while (time_after_eq(now, g_timer_jiffies))
+	{
+		if (g_timer_pending_count == 0)
+		{
+			g_timer_jiffies = now + 1;
+			break;
+		}
+
+		index = g_timer_jiffies & TVR_MASK;
+		if (index == 0)
+		{
+			for (level = 1; level <= TVN_LEVELS; level++)
+			{
+				if (timer_cascade(level, TVN_INDEX(g_timer_jiffies, level - 1)) != 0)
+				{
+					break;
+				}
+			}
+		}
+		g_timer_jiffies++;
+
+		timer = g_timer_tv1[index];
+		while (timer != NULL)
+		{
+			next = timer->next;
+			timer_detach(timer);
+			if (!time_after_eq(g_timer_jiffies - 1, timer->expires))
+			{
+				/* 超出时间轮范围的定时器, 按真实到期时刻重新挂入 */
+				timer_internal_add(timer);
+			}
+			else if (timer->cb != NULL)
+			{
+				timer->next = expired_list;
+				expired_list = timer;
+			}
+			timer = next;
+		}
+
+		if (g_timer_tv1_count == 0)
+		{
+			/* 第0层为空, 直接跳到下一次级联 */
+			boundary = (g_timer_jiffies + TVR_MASK) & ~(EZDEV_SDK_UINT32)TVR_MASK;
+			if (!time_after_eq(now, boundary))
+			{
+				g_timer_jiffies = now + 1;
+				break;
+			}
+			g_timer_jiffies = boundary;
+		}
+	}
+
+	return expired_list;
+}
+
+static void timer_fire(kernel_timer *expired_list)
+{
+	kernel_timer *next = NULL;
+
+	while (expired_list != NULL)
+	{
+		next = expired_list->next;
+		expired_list->next = NULL;
+		expired_list->cb(expired_list);
+		expired_list = next;
+	}
+}
+
+static EZDEV_SDK_UINT32 timer_slot_min(kernel_timer *timer, EZDEV_SDK_UINT32 now, EZDEV_SDK_UINT32 min_left)
+{
+	for (; timer != NULL; timer = timer->next)
+	{
+		if (time_after_eq(now, timer->expires))
+		{
+			return 0;
+		}
+		if (timer->expires - now < min_left)
+		{
+			min_left = timer->expires - now;
+		}
+	}
+	return min_left;
+}
+
+mkernel_internal_error kernel_timer_service_init()
+{
+	memset(g_timer_tv1, 0, sizeof(g_timer_tv1));
+	memset(g_timer_tvn, 0, sizeof(g_timer_tvn));
+	g_timer_tv1_count = 0;
+	g_timer_pending_count = 0;
+	g_timer_clock_base = 0;
+	g_timer_waiting = 0;
+
+	g_timer_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	if (g_timer_lock == NULL)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	g_timer_clock = g_ezdev_sdk_kernel.platform_handle.time_creator();
+	if (g_timer_clock == NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_destroy(g_timer_lock);
+		g_timer_lock = NULL;
+		return mkernel_internal_malloc_error;
+	}
+	g_ezdev_sdk_kernel.platform_handle.time_countdownms(g_timer_clock, kernel_timer_clock_span);
+	g_timer_jiffies = timer_clock_now();
+
+	return mkernel_internal_succ;
+}
+
+void kernel_timer_service_fini()
+{
+	if (g_timer_clock != NULL)
+	{
+		g_ezdev_sdk_kernel.platform_handle.time_destroy(g_timer_clock);
+		g_timer_clock = NULL;
+	}
+	if (g_timer_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_destroy(g_timer_lock);
+		g_timer_lock = NULL;
+	}
+	memset(g_timer_tv1, 0, sizeof(g_timer_tv1));
+	memset(g_timer_tvn, 0, sizeof(g_timer_tvn));
+	g_timer_tv1_count = 0;
+	g_timer_pending_count = 0;
+}
+
+EZDEV_SDK_UINT32 kernel_timer_now()
+{
+	EZDEV_SDK_UINT32 now = 0;
+
+	timer_lock();
+	now = timer_clock_now();
+	timer_unlock();
+	return now;
+}
+
+void kernel_timer_init(kernel_timer *timer, kernel_timer_cb cb)
+{
+	memset(timer, 0, sizeof(kernel_timer));
+	timer->cb = cb;
+}
+
+void kernel_timer_start(kernel_timer *timer, EZDEV_SDK_UINT32 timeout_ms)
+{
+	kernel_timer *expired_list = NULL;
+	void (*wakeup)(void) = NULL;
+	EZDEV_SDK_UINT32 now = 0;
+
+	timer_lock();
+	now = timer_clock_now();
+	if (timer->pending)
+	{
+		timer_detach(timer);
+	}
+	expired_list = timer_run(now);
+	timer->expires = now + timeout_ms;
+	timer->armed = 1;
+	/* 没有回调的0超时定时器只是给expired_bydiff记一个起点, 已经到期, 不挂到时间轮上, 否则这一毫秒内next_deadline一直返回0 */
+	if (0 == timeout_ms && NULL == timer->cb)
+	{
+		timer_unlock();
+		timer_fire(expired_list);
+		return;
+	}
+	timer_internal_add(timer);
+	/* 比微内核线程等待的时刻更早到期, 叫醒它重新计算 */
+	if (g_timer_waiting && !time_after_eq(timer->expires, g_timer_wait_until))
+	{
+		g_timer_waiting = 0;
+		wakeup = g_timer_wakeup;
+	}
+	timer_unlock();
+
+	if (wakeup != NULL)
+	{
+		wakeup();
+	}
+	timer_fire(expired_list);
+}
+
+EZDEV_SDK_BOOL kernel_timer_stop(kernel_timer *timer)
+{
+	EZDEV_SDK_BOOL detached = EZDEV_SDK_FALSE;
+
+	timer_lock();
+	if (timer->pending)
+	{
+		timer_detach(timer);
+		detached = EZDEV_SDK_TRUE;
+	}
+	timer->armed = 0;
+	timer_unlock();
+
+	return detached;
+}
+
+EZDEV_SDK_BOOL kernel_timer_expired(kernel_timer *timer)
+{
+	if (!timer->armed)
+	{
+		return EZDEV_SDK_TRUE;
+	}
+	return time_after_eq(kernel_timer_now(), timer->expires) ? EZDEV_SDK_TRUE : EZDEV_SDK_FALSE;
+}
+
+EZDEV_SDK_BOOL kernel_timer_expired_bydiff(kernel_timer *timer, EZDEV_SDK_UINT32 diff_ms)
+{
+	EZDEV_SDK_INT32 elapsed = 0;
+
+	if (!timer->armed)
+	{
+		return EZDEV_SDK_TRUE;
+	}
+	elapsed = (EZDEV_SDK_INT32)(kernel_timer_now() - timer->expires);
+	return (elapsed > 0 && (EZDEV_SDK_UINT32)elapsed > diff_ms) ? EZDEV_SDK_TRUE : EZDEV_SDK_FALSE;
+}
+
+EZDEV_SDK_UINT32 kernel_timer_left_bydiff(kernel_timer *timer, EZDEV_SDK_UINT32 diff_ms)
+{
+	EZDEV_SDK_INT32 elapsed = 0;
+
+	if (!timer->armed)
+	{
+		return 0;
+	}
+	elapsed = (EZDEV_SDK_INT32)(kernel_timer_now() - timer->expires);
+	if (elapsed > 0 && (EZDEV_SDK_UINT32)elapsed > diff_ms)
+	{
+		return 0;
+	}
+	return diff_ms - (EZDEV_SDK_UINT32)elapsed + 1;
+}
+
+EZDEV_SDK_UINT32 kernel_timer_left_ms(kernel_timer *timer)
+{
+	EZDEV_SDK_UINT32 now = 0;
+
+	if (!timer->armed)
+	{
+		return 0;
+	}
+	now = kernel_timer_now();
+	return time_after_eq(now, timer->expires) ? 0 : timer->expires - now;
+}
+
+EZDEV_SDK_UINT32 kernel_timer_next_deadline()
+{
+	kernel_timer *expired_list = NULL;
+	EZDEV_SDK_UINT32 min_left = kernel_timer_forever;
+	EZDEV_SDK_UINT32 now = 0;
+	EZDEV_SDK_UINT32 cur = 0;
+	EZDEV_SDK_UINT32 k = 0;
+	EZDEV_SDK_UINT32 first = 0;
+	EZDEV_SDK_UINT32 shift = 0;
+	EZDEV_SDK_UINT32 start = 0;
+	EZDEV_SDK_UINT8 level = 0;
+	kernel_timer *slot = NULL;
+
+	timer_lock();
+	now = timer_clock_now();
+	expired_list = timer_run(now);
+
+	if (g_timer_pending_count != 0)
+	{
+		/* 第0层按刻度有序, 第一个非空槽位就是该层最早的 */
+		for (k = 0; k < TVR_SIZE && g_timer_tv1_count != 0; k++)
+		{
+			slot = g_timer_tv1[(g_timer_jiffies + k) & TVR_MASK];
+			if (slot != NULL)
+			{
+				min_left = timer_slot_min(slot, now, min_left);
+				break;
+			}
+		}
+		/* 高层当前槽位级联过的从下一个槽位开始找, 正好停在级联点上的还没级联, 从当前槽位找, 各层之间取最小值.
+		   槽位的起始时刻是其中定时器到期时刻的下界, 不早于已找到的最小值时整层都不用再看, 免得遍历挂满远期定时器的槽位 */
+		for (level = 1; level <= TVN_LEVELS; level++)
+		{
+			shift = TVR_BITS + (level - 1) * TVN_BITS;
+			cur = TVN_INDEX(g_timer_jiffies, level - 1);
+			first = (g_timer_jiffies & ((1UL << shift) - 1)) == 0 ? 0 : 1;
+			for (k = first; k < first + TVN_SIZE; k++)
+			{
+				start = ((g_timer_jiffies >> shift) + k) << shift;
+				if (!time_after_eq(now, start) && start - now >= min_left)
+				{
+					break;
+				}
+				slot = g_timer_tvn[level - 1][(cur + k) & TVN_MASK];
+				if (slot != NULL)
+				{
+					min_left = timer_slot_min(slot, now, min_left);
+					break;
+				}
+			}
+		}
+	}
+	g_timer_waiting = 1;
+	g_timer_wait_until = now + (min_left > kernel_timer_clock_span ? kernel_timer_clock_span : min_left);
+	timer_unlock();
+
+	timer_fire(expired_list);
+	return min_left;
+}
+
+void kernel_timer_wait_done()
+{
+	timer_lock();
+	g_timer_waiting = 0;
+	timer_unlock();
+}
+
+void kernel_timer_set_wakeup(void (*wakeup)(void))
+{
+	timer_lock();
+	g_timer_wakeup = wakeup;
+	timer_unlock();
+}
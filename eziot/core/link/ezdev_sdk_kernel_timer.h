@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_TIMER_H_
+#define H_EZDEV_SDK_KERNEL_TIMER_H_
+
+#include "base_typedef.h"
+
+#define kernel_timer_forever			0xFFFFFFFF		///<	没有待触发定时器时next_deadline的返回值
+
+struct tag_kernel_timer;
+typedef void (*kernel_timer_cb)(struct tag_kernel_timer *timer);
+
+/**
+ * \brief 微内核定时器节点, 由使用者提供内存(可放在栈上或嵌入其他结构体), 定时器服务不做任何分配
+ * \note  全零即为未启动状态, 未启动的定时器视为已超时
+ */
+typedef struct tag_kernel_timer
+{
+	struct tag_kernel_timer *next;		///<	时间轮槽位双向链表
+	struct tag_kernel_timer *prev;
+	EZDEV_SDK_UINT32 expires;			///<	到期时刻(毫秒, 回绕计数)
+	EZDEV_SDK_INT8 armed;				///<	是否已启动
+	EZDEV_SDK_INT8 pending;				///<	是否挂在时间轮上
+	EZDEV_SDK_UINT8 level;				///<	所在的时间轮层级
+	EZDEV_SDK_UINT8 slot;				///<	所在层级的槽位
+	kernel_timer_cb cb;					///<	到期回调, 可为空, 为空时只能轮询
+} kernel_timer;
+
+/**
+ * \note kernel_timer_stop返回是否从时间轮上摘下; 返回FALSE且设置了回调时, 定时器可能已经到期, 回调正在或即将在其他线程触发,
+ *       此时不能释放定时器所在的内存, 应由回调负责释放
+ * \note kernel_timer_left_bydiff返回kernel_timer_expired_bydiff变为TRUE还要多久;
+ *       微内核线程用kernel_timer_next_deadline的结果阻塞等待, 醒来后调用kernel_timer_wait_done; 等待期间其他线程启动了更早到期的定时器时,
+ *       调用kernel_timer_set_wakeup登记的函数叫醒它
+ */
+#define EZDEV_SDK_KERNEL_TIMER_INTERFACE	\
+	extern mkernel_internal_error kernel_timer_service_init(); \
+	extern void kernel_timer_service_fini(); \
+	extern EZDEV_SDK_UINT32 kernel_timer_now(); \
+	extern void kernel_timer_init(kernel_timer *timer, kernel_timer_cb cb); \
+	extern void kernel_timer_start(kernel_timer *timer, EZDEV_SDK_UINT32 timeout_ms); \
+	extern EZDEV_SDK_BOOL kernel_timer_stop(kernel_timer *timer); \
+	extern EZDEV_SDK_BOOL kernel_timer_expired(kernel_timer *timer); \
+	extern EZDEV_SDK_BOOL kernel_timer_expired_bydiff(kernel_timer *timer, EZDEV_SDK_UINT32 diff_ms); \
+	extern EZDEV_SDK_UINT32 kernel_timer_left_ms(kernel_timer *timer); \
+	extern EZDEV_SDK_UINT32 kernel_timer_left_bydiff(kernel_timer *timer, EZDEV_SDK_UINT32 diff_ms); \
+	extern EZDEV_SDK_UINT32 kernel_timer_next_deadline(); \
+	extern void kernel_timer_wait_done(); \
+	extern void kernel_timer_set_wakeup(void (*wakeup)(void));
+
+#endif
@@ -0,0 +1,596 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "ezdev_sdk_kernel_trace.h"
+#include "ezdev_sdk_kernel_platform.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel.h"
+#include "das_transport.h"
+#include "sdk_kernel_def.h"
+#include "utils.h"
+
+EZDEV_SDK_KERNEL_PLATFORM_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+DAS_TRANSPORT_INTERFACE
+
+#define trace_magic				"EZTR"
+#define trace_header_len		8
+#define trace_record_head_len	16
+#define trace_flag_scrubbed		0x01	///<	业务数据没有记录
+#define trace_flag_response		0x02	///<	响应消息
+
+static sdk_trace_config g_trace_config;
+static EZDEV_SDK_UINT32 g_trace_start_ms = 0;
+static ezdev_sdk_mutex g_trace_lock = NULL;
+
+/**
+ * \brief 只做追加的写指针, 长度已经提前算好
+ */
+typedef struct
+{
+	unsigned char *p;
+} trace_writer;
+
+/**
+ * \brief 只读游标, 越界时置error, 之后的读取都返回0
+ */
+typedef struct
+{
+	const unsigned char *p;
+	const unsigned char *end;
+	EZDEV_SDK_INT8 error;
+} trace_reader;
+
+static void trace_put8(trace_writer *w, EZDEV_SDK_UINT8 v)
+{
+	*w->p++ = v;
+}
+
+static void trace_put32(trace_writer *w, EZDEV_SDK_UINT32 v)
+{
+	w->p[0] = (unsigned char)(v >> 24);
+	w->p[1] = (unsigned char)(v >> 16);
+	w->p[2] = (unsigned char)(v >> 8);
+	w->p[3] = (unsigned char)v;
+	w->p += 4;
+}
+
+static EZDEV_SDK_UINT32 trace_str_len(const char *s, EZDEV_SDK_INT8 scrub)
+{
+	EZDEV_SDK_UINT32 len = scrub ? 0 : strlen(s);
+	return len > 255 ? 255 : len;
+}
+
+static void trace_put_str(trace_writer *w, const char *s, EZDEV_SDK_INT8 scrub)
+{
+	EZDEV_SDK_UINT32 len = trace_str_len(s, scrub);
+	trace_put8(w, (EZDEV_SDK_UINT8)len);
+	memcpy(w->p, s, len);
+	w->p += len;
+}
+
+static void trace_put_body(trace_writer *w, const void *body, EZDEV_SDK_UINT32 body_len, EZDEV_SDK_INT8 scrub)
+{
+	trace_put32(w, body_len);
+	if (!scrub && 0 != body_len)
+	{
+		memcpy(w->p, body, body_len);
+		w->p += body_len;
+	}
+}
+
+static EZDEV_SDK_UINT8 trace_get8(trace_reader *r)
+{
+	if (r->error || r->end - r->p < 1)
+	{
+		r->error = 1;
+		return 0;
+	}
+	return *r->p++;
+}
+
+static EZDEV_SDK_UINT32 trace_get32(trace_reader *r)
+{
+	EZDEV_SDK_UINT32 v = 0;
+	if (r->error || r->end - r->p < 4)
+	{
+		r->error = 1;
+		return 0;
+	}
+	v = ((EZDEV_SDK_UINT32)r->p[0] << 24) | ((EZDEV_SDK_UINT32)r->p[1] << 16) | ((EZDEV_SDK_UINT32)r->p[2] << 8) | r->p[3];
+	r->p += 4;
+	return v;
+}
+
+static void trace_get_str(trace_reader *r, char *buf, EZDEV_SDK_UINT32 buf_size)
+{
+	EZDEV_SDK_UINT32 len = trace_get8(r);
+	if (r->error || (EZDEV_SDK_UINT32)(r->end - r->p) < len || len >= buf_size)
+	{
+		r->error = 1;
+		return;
+	}
+	memcpy(buf, r->p, len);
+	buf[len] = '\0';
+	r->p += len;
+}
+
+/**
+ * \brief 取出业务数据, 复制到新分配的缓冲区并以'\0'结尾; 没有记录内容时用空格填充同样的长度
+ */
+static unsigned char *trace_get_body(trace_reader *r, EZDEV_SDK_INT8 scrubbed, EZDEV_SDK_UINT32 *body_len)
+{
+	unsigned char *body = NULL;
+
+	*body_len = trace_get32(r);
+	if (r->error || *body_len > ezdev_sdk_recv_buf_max || (!scrubbed && (EZDEV_SDK_UINT32)(r->end - r->p) < *body_len))
+	{
+		r->error = 1;
+		return NULL;
+	}
+
+	body = (unsigned char *)malloc(*body_len + 1);
+	if (NULL == body)
+	{
+		return NULL;
+	}
+	if (scrubbed)
+	{
+		memset(body, ' ', *body_len);
+	}
+	else
+	{
+		memcpy(body, r->p, *body_len);
+		r->p += *body_len;
+	}
+	body[*body_len] = '\0';
+
+	return body;
+}
+
+mkernel_internal_error kernel_trace_service_init()
+{
+	memset(&g_trace_config, 0, sizeof(g_trace_config));
+	g_trace_lock = ezdev_sdk_kernel_platform_thread_mutex_create();
+	if (g_trace_lock == NULL)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	return mkernel_internal_succ;
+}
+
+void kernel_trace_service_fini()
+{
+	if (g_trace_lock != NULL)
+	{
+		ezdev_sdk_kernel_platform_thread_mutex_destroy(g_trace_lock);
+		g_trace_lock = NULL;
+	}
+	memset(&g_trace_config, 0, sizeof(g_trace_config));
+}
+
+mkernel_internal_error kernel_trace_config(const sdk_trace_config *config)
+{
+	unsigned char header[trace_header_len];
+
+	if (NULL == g_trace_lock)
+	{
+		return mkernel_internal_invald_call;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_trace_lock);
+	if (NULL == config || NULL == config->trace_write)
+	{
+		memset(&g_trace_config, 0, sizeof(g_trace_config));
+	}
+	else
+	{
+		memcpy(&g_trace_config, config, sizeof(g_trace_config));
+		g_trace_start_ms = kernel_timer_now();
+
+		memcpy(header, trace_magic, 4);
+		header[4] = kernel_trace_version;
+		header[5] = (unsigned char)config->scrub;
+		header[6] = 0;
+		header[7] = 0;
+		g_trace_config.trace_write(header, sizeof(header), g_trace_config.user);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_trace_lock);
+
+	return mkernel_internal_succ;
+}
+
+/**
+ * \brief 分配一条记录并写好记录头, 调用者接着写内容, 再交给trace_emit
+ */
+static unsigned char *trace_begin(trace_writer *w, EZDEV_SDK_UINT8 type, EZDEV_SDK_UINT8 flags, EZDEV_SDK_UINT8 qos,
+								  EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT32 record_len)
+{
+	unsigned char *record = (unsigned char *)malloc(record_len);
+	if (NULL == record)
+	{
+		return NULL;
+	}
+
+	w->p = record;
+	trace_put8(w, type);
+	trace_put8(w, kernel_trace_version);
+	trace_put8(w, flags);
+	trace_put8(w, qos);
+	trace_put32(w, kernel_timer_now() - g_trace_start_ms);
+	trace_put32(w, seq);
+	trace_put32(w, record_len);
+
+	return record;
+}
+
+static void trace_emit(unsigned char *record, EZDEV_SDK_UINT32 record_len)
+{
+	if (NULL == record)
+	{
+		return;
+	}
+	g_trace_config.trace_write(record, record_len, g_trace_config.user);
+	free(record);
+}
+
+void kernel_trace_in(const ezdev_sdk_kernel_submsg *submsg)
+{
+	trace_writer w;
+	unsigned char *record = NULL;
+	EZDEV_SDK_INT8 scrub_body = 0;
+	EZDEV_SDK_UINT32 record_len = 0;
+
+	if (NULL == g_trace_config.trace_write)
+	{
+		return;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_trace_lock);
+	if (NULL != g_trace_config.trace_write)
+	{
+		scrub_body = 0 != (g_trace_config.scrub & sdk_trace_scrub_body);
+		record_len = trace_record_head_len + 4 + 4 + 1 + trace_str_len(submsg->command_ver, 0) + 4 + (scrub_body ? 0 : submsg->buf_len);
+		record = trace_begin(&w, sdk_trace_in_v2, scrub_body ? trace_flag_scrubbed : 0, 0, submsg->msg_seq, record_len);
+		if (NULL != record)
+		{
+			trace_put32(&w, (EZDEV_SDK_UINT32)submsg->msg_domain_id);
+			trace_put32(&w, (EZDEV_SDK_UINT32)submsg->msg_command_id);
+			trace_put_str(&w, submsg->command_ver, 0);
+			trace_put_body(&w, submsg->buf, submsg->buf_len, scrub_body);
+		}
+		trace_emit(record, record_len);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_trace_lock);
+}
+
+void kernel_trace_in_v3(const ezdev_sdk_kernel_submsg_v3 *submsg)
+{
+	trace_writer w;
+	unsigned char *record = NULL;
+	EZDEV_SDK_INT8 scrub_body = 0;
+	EZDEV_SDK_INT8 scrub_id = 0;
+	EZDEV_SDK_UINT32 record_len = 0;
+
+	if (NULL == g_trace_config.trace_write)
+	{
+		return;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_trace_lock);
+	if (NULL != g_trace_config.trace_write)
+	{
+		scrub_body = 0 != (g_trace_config.scrub & sdk_trace_scrub_body);
+		scrub_id = 0 != (g_trace_config.scrub & sdk_trace_scrub_id);
+		record_len = trace_record_head_len + 7 + trace_str_len(submsg->resource_id, scrub_id) + trace_str_len(submsg->resource_type, 0) +
+					 trace_str_len(submsg->module, 0) + trace_str_len(submsg->method, 0) + trace_str_len(submsg->msg_type, 0) +
+					 trace_str_len(submsg->sub_serial, scrub_id) + trace_str_len(submsg->ext_msg, 0) + 4 + (scrub_body ? 0 : submsg->buf_len);
+		record = trace_begin(&w, sdk_trace_in_v3, scrub_body ? trace_flag_scrubbed : 0, 0, submsg->msg_seq, record_len);
+		if (NULL != record)
+		{
+			trace_put_str(&w, submsg->resource_id, scrub_id);
+			trace_put_str(&w, submsg->resource_type, 0);
+			trace_put_str(&w, submsg->module, 0);
+			trace_put_str(&w, submsg->method, 0);
+			trace_put_str(&w, submsg->msg_type, 0);
+			trace_put_str(&w, submsg->sub_serial, scrub_id);
+			trace_put_str(&w, submsg->ext_msg, 0);
+			trace_put_body(&w, submsg->buf, submsg->buf_len, scrub_body);
+		}
+		trace_emit(record, record_len);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_trace_lock);
+}
+
+void kernel_trace_out(const ezdev_sdk_kernel_pubmsg *pubmsg)
+{
+	trace_writer w;
+	unsigned char *record = NULL;
+	EZDEV_SDK_INT8 scrub_body = 0;
+	EZDEV_SDK_UINT8 flags = 0;
+	EZDEV_SDK_UINT32 record_len = 0;
+
+	if (NULL == g_trace_config.trace_write)
+	{
+		return;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_trace_lock);
+	if (NULL != g_trace_config.trace_write)
+	{
+		scrub_body = 0 != (g_trace_config.scrub & sdk_trace_scrub_body);
+		flags = (scrub_body ? trace_flag_scrubbed : 0) | (pubmsg->msg_response ? trace_flag_response : 0);
+		record_len = trace_record_head_len + 4 + 4 + 1 + 1 + trace_str_len(pubmsg->command_ver, 0) + 4 + (scrub_body ? 0 : pubmsg->msg_body_len);
+		record = trace_begin(&w, sdk_trace_out_v2, flags, (EZDEV_SDK_UINT8)pubmsg->msg_qos, pubmsg->msg_seq, record_len);
+		if (NULL != record)
+		{
+			trace_put32(&w, pubmsg->msg_domain_id);
+			trace_put32(&w, pubmsg->msg_command_id);
+			trace_put8(&w, pubmsg->msg_class);
+			trace_put_str(&w, pubmsg->command_ver, 0);
+			trace_put_body(&w, pubmsg->msg_body, pubmsg->msg_body_len, scrub_body);
+		}
+		trace_emit(record, record_len);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_trace_lock);
+}
+
+void kernel_trace_out_v3(const ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+{
+	trace_writer w;
+	unsigned char *record = NULL;
+	EZDEV_SDK_INT8 scrub_body = 0;
+	EZDEV_SDK_INT8 scrub_id = 0;
+	EZDEV_SDK_UINT8 flags = 0;
+	EZDEV_SDK_UINT32 record_len = 0;
+
+	if (NULL == g_trace_config.trace_write)
+	{
+		return;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_trace_lock);
+	if (NULL != g_trace_config.trace_write)
+	{
+		/* 流式发送的消息没有业务数据缓冲区, 只记录长度 */
+		scrub_body = 0 != (g_trace_config.scrub & sdk_trace_scrub_body) || NULL == pubmsg->msg_body;
+		scrub_id = 0 != (g_trace_config.scrub & sdk_trace_scrub_id);
+		flags = (scrub_body ? trace_flag_scrubbed : 0) | (pubmsg->msg_response ? trace_flag_response : 0);
+		record_len = trace_record_head_len + 2 + 8 + trace_str_len(pubmsg->resource_id, scrub_id) + trace_str_len(pubmsg->resource_type, 0) +
+					 trace_str_len(pubmsg->module, 0) + trace_str_len(pubmsg->method, 0) + trace_str_len(pubmsg->msg_type, 0) +
+					 trace_str_len(pubmsg->sub_serial, scrub_id) + trace_str_len(pubmsg->ext_msg, 0) + trace_str_len(pubmsg->coalesce_key, 0) +
+					 4 + (scrub_body ? 0 : pubmsg->msg_body_len);
+		record = trace_begin(&w, sdk_trace_out_v3, flags, (EZDEV_SDK_UINT8)pubmsg->msg_qos, pubmsg->msg_seq, record_len);
+		if (NULL != record)
+		{
+			trace_put8(&w, pubmsg->msg_class);
+			trace_put8(&w, pubmsg->msg_coalesce);
+			trace_put_str(&w, pubmsg->resource_id, scrub_id);
+			trace_put_str(&w, pubmsg->resource_type, 0);
+			trace_put_str(&w, pubmsg->module, 0);
+			trace_put_str(&w, pubmsg->method, 0);
+			trace_put_str(&w, pubmsg->msg_type, 0);
+			trace_put_str(&w, pubmsg->sub_serial, scrub_id);
+			trace_put_str(&w, pubmsg->ext_msg, 0);
+			trace_put_str(&w, pubmsg->coalesce_key, 0);
+			trace_put_body(&w, pubmsg->msg_body, pubmsg->msg_body_len, scrub_body);
+		}
+		trace_emit(record, record_len);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_trace_lock);
+}
+
+void kernel_trace_sent(EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT32 result)
+{
+	trace_writer w;
+	unsigned char *record = NULL;
+
+	if (NULL == g_trace_config.trace_write)
+	{
+		return;
+	}
+
+	ezdev_sdk_kernel_platform_thread_mutex_lock(g_trace_lock);
+	if (NULL != g_trace_config.trace_write)
+	{
+		record = trace_begin(&w, sdk_trace_sent, 0, 0, seq, trace_record_head_len + 4);
+		if (NULL != record)
+		{
+			trace_put32(&w, result);
+		}
+		trace_emit(record, trace_record_head_len + 4);
+	}
+	ezdev_sdk_kernel_platform_thread_mutex_unlock(g_trace_lock);
+}
+
+mkernel_internal_error kernel_trace_peek(const unsigned char *trace, EZDEV_SDK_UINT32 len, sdk_trace_record_info *info)
+{
+	trace_reader r;
+
+	if (NULL == trace || NULL == info)
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+
+	memset(info, 0, sizeof(sdk_trace_record_info));
+	if (len >= trace_header_len && 0 == memcmp(trace, trace_magic, 4))
+	{
+		info->type = sdk_trace_header;
+		info->version = trace[4];
+		info->record_len = trace_header_len;
+		return mkernel_internal_succ;
+	}
+
+	r.p = trace;
+	r.end = trace + len;
+	r.error = 0;
+	info->type = trace_get8(&r);
+	info->version = trace_get8(&r);
+	trace_get8(&r);
+	trace_get8(&r);
+	info->time_ms = trace_get32(&r);
+	info->seq = trace_get32(&r);
+	info->record_len = trace_get32(&r);
+	if (r.error || info->type < sdk_trace_in_v2 || info->type > sdk_trace_sent || info->version != kernel_trace_version ||
+		info->record_len < trace_record_head_len || info->record_len > len)
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+
+	return mkernel_internal_succ;
+}
+
+static mkernel_internal_error trace_replay_in(trace_reader *r, EZDEV_SDK_UINT8 flags, EZDEV_SDK_UINT32 seq)
+{
+	ezdev_sdk_kernel_submsg *submsg = (ezdev_sdk_kernel_submsg *)malloc(sizeof(ezdev_sdk_kernel_submsg));
+	if (NULL == submsg)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	memset(submsg, 0, sizeof(ezdev_sdk_kernel_submsg));
+	submsg->msg_seq = seq;
+	submsg->msg_domain_id = (EZDEV_SDK_INT32)trace_get32(r);
+	submsg->msg_command_id = (EZDEV_SDK_INT32)trace_get32(r);
+	trace_get_str(r, submsg->command_ver, sizeof(submsg->command_ver));
+	submsg->buf = trace_get_body(r, flags & trace_flag_scrubbed, &submsg->buf_len);
+	if (NULL == submsg->buf)
+	{
+		free(submsg);
+		return r->error ? mkernel_internal_input_param_invalid : mkernel_internal_malloc_error;
+	}
+
+	das_message_inject(submsg);
+	return mkernel_internal_succ;
+}
+
+static mkernel_internal_error trace_replay_in_v3(trace_reader *r, EZDEV_SDK_UINT8 flags, EZDEV_SDK_UINT32 seq)
+{
+	ezdev_sdk_kernel_submsg_v3 *submsg = (ezdev_sdk_kernel_submsg_v3 *)malloc(sizeof(ezdev_sdk_kernel_submsg_v3));
+	if (NULL == submsg)
+	{
+		return mkernel_internal_malloc_error;
+	}
+
+	memset(submsg, 0, sizeof(ezdev_sdk_kernel_submsg_v3));
+	submsg->msg_seq = seq;
+	trace_get_str(r, submsg->resource_id, sizeof(submsg->resource_id));
+	trace_get_str(r, submsg->resource_type, sizeof(submsg->resource_type));
+	trace_get_str(r, submsg->module, sizeof(submsg->module));
+	trace_get_str(r, submsg->method, sizeof(submsg->method));
+	trace_get_str(r, submsg->msg_type, sizeof(submsg->msg_type));
+	trace_get_str(r, submsg->sub_serial, sizeof(submsg->sub_serial));
+	trace_get_str(r, submsg->ext_msg, sizeof(submsg->ext_msg));
+	submsg->buf = trace_get_body(r, flags & trace_flag_scrubbed, &submsg->buf_len);
+	if (NULL == submsg->buf)
+	{
+		free(submsg);
+		return r->error ? mkernel_internal_input_param_invalid : mkernel_internal_malloc_error;
+	}
+
+	das_message_inject_v3(submsg);
+	return mkernel_internal_succ;
+}
+
+static ezdev_sdk_kernel_error trace_replay_out(trace_reader *r, EZDEV_SDK_UINT8 flags, EZDEV_SDK_UINT8 qos, EZDEV_SDK_UINT32 seq)
+{
+	ezdev_sdk_kernel_pubmsg pubmsg;
+	ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+
+	memset(&pubmsg, 0, sizeof(pubmsg));
+	pubmsg.msg_response = 0 != (flags & trace_flag_response);
+	pubmsg.msg_qos = (enum QOS_T)qos;
+	pubmsg.msg_seq = seq;
+	pubmsg.msg_domain_id = trace_get32(r);
+	pubmsg.msg_command_id = trace_get32(r);
+	pubmsg.msg_class = trace_get8(r);
+	trace_get_str(r, pubmsg.command_ver, sizeof(pubmsg.command_ver));
+	pubmsg.msg_body = trace_get_body(r, flags & trace_flag_scrubbed, &pubmsg.msg_body_len);
+	if (NULL == pubmsg.msg_body)
+	{
+		return r->error ? ezdev_sdk_kernel_params_invalid : ezdev_sdk_kernel_memory;
+	}
+
+	/* 发送接口复制消息内容, 这里的缓冲区随即释放 */
+	kernel_error = ezdev_sdk_kernel_send(&pubmsg);
+	free(pubmsg.msg_body);
+
+	return kernel_error;
+}
+
+static ezdev_sdk_kernel_error trace_replay_out_v3(trace_reader *r, EZDEV_SDK_UINT8 flags, EZDEV_SDK_UINT8 qos, EZDEV_SDK_UINT32 seq)
+{
+	ezdev_sdk_kernel_pubmsg_v3 pubmsg;
+	ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+
+	memset(&pubmsg, 0, sizeof(pubmsg));
+	pubmsg.msg_response = 0 != (flags & trace_flag_response);
+	pubmsg.msg_qos = (enum QOS_T)qos;
+	pubmsg.msg_seq = seq;
+	pubmsg.msg_class = trace_get8(r);
+	pubmsg.msg_coalesce = trace_get8(r);
+	trace_get_str(r, pubmsg.resource_id, sizeof(pubmsg.resource_id));
+	trace_get_str(r, pubmsg.resource_type, sizeof(pubmsg.resource_type));
+	trace_get_str(r, pubmsg.module, sizeof(pubmsg.module));
+	trace_get_str(r, pubmsg.method, sizeof(pubmsg.method));
+	trace_get_str(r, pubmsg.msg_type, sizeof(pubmsg.msg_type));
+	trace_get_str(r, pubmsg.sub_serial, sizeof(pubmsg.sub_serial));
+	trace_get_str(r, pubmsg.ext_msg, sizeof(pubmsg.ext_msg));
+	trace_get_str(r, pubmsg.coalesce_key, sizeof(pubmsg.coalesce_key));
+	pubmsg.msg_body = trace_get_body(r, flags & trace_flag_scrubbed, &pubmsg.msg_body_len);
+	if (NULL == pubmsg.msg_body)
+	{
+		return r->error ? ezdev_sdk_kernel_params_invalid : ezdev_sdk_kernel_memory;
+	}
+
+	kernel_error = ezdev_sdk_kernel_send_v3(&pubmsg);
+	free(pubmsg.msg_body);
+
+	return kernel_error;
+}
+
+ezdev_sdk_kernel_error kernel_trace_replay(const unsigned char *record, EZDEV_SDK_UINT32 len)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	sdk_trace_record_info info;
+	trace_reader r;
+	EZDEV_SDK_UINT8 flags = 0;
+	EZDEV_SDK_UINT8 qos = 0;
+
+	sdk_error = kernel_trace_peek(record, len, &info);
+	if (sdk_error != mkernel_internal_succ || sdk_trace_header == info.type || sdk_trace_sent == info.type)
+	{
+		return mkiE2ezE(sdk_error);
+	}
+
+	flags = record[2];
+	qos = record[3];
+	r.p = record + trace_record_head_len;
+	r.end = record + info.record_len;
+	r.error = 0;
+
+	switch (info.type)
+	{
+	case sdk_trace_in_v2:
+		return mkiE2ezE(trace_replay_in(&r, flags, info.seq));
+	case sdk_trace_in_v3:
+		return mkiE2ezE(trace_replay_in_v3(&r, flags, info.seq));
+	case sdk_trace_out_v2:
+		return trace_replay_out(&r, flags, qos, info.seq);
+	default:
+		return trace_replay_out_v3(&r, flags, qos, info.seq);
+	}
+}
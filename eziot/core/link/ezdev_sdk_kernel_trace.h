@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * Copyright © 2017-2021 Ezviz Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *******************************************************************************/
+
+#ifndef H_EZDEV_SDK_KERNEL_TRACE_H_
+#define H_EZDEV_SDK_KERNEL_TRACE_H_
+
+#include "base_typedef.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_struct.h"
+#include "ezdev_sdk_kernel_error.h"
+
+#define kernel_trace_version	1
+
+/**
+ * \brief 微内核消息记录和回放, 用于在实验室复现现网的消息节奏
+ * \note
+ * - 记录头: "EZTR"、版本(1)、脱敏选项(1)、保留(2), 共8字节
+ * - 每条记录: 类型(1)、版本(1)、标志(1)、qos(1)、时间(4)、seq(4)、记录长度(4), 之后是各类型的内容;
+ *   标志bit0表示业务数据没有记录, bit1表示响应消息
+ * - 字符串按长度(1) + 内容记录, 业务数据按长度(4) + 内容记录, 没有记录内容时只有长度
+ * - 没有开启记录时各记录点只判断一次回调指针, 不加锁
+ * - 回放时收到的消息送进微内核的分发路径, 发出的消息重新调用发送接口, 按什么节奏回放由调用者决定
+ */
+#define EZDEV_SDK_KERNEL_TRACE_INTERFACE	\
+	extern mkernel_internal_error kernel_trace_service_init(); \
+	extern void kernel_trace_service_fini(); \
+	extern mkernel_internal_error kernel_trace_config(const sdk_trace_config *config); \
+	extern void kernel_trace_in(const ezdev_sdk_kernel_submsg *submsg); \
+	extern void kernel_trace_in_v3(const ezdev_sdk_kernel_submsg_v3 *submsg); \
+	extern void kernel_trace_out(const ezdev_sdk_kernel_pubmsg *pubmsg); \
+	extern void kernel_trace_out_v3(const ezdev_sdk_kernel_pubmsg_v3 *pubmsg); \
+	extern void kernel_trace_sent(EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT32 result); \
+	extern mkernel_internal_error kernel_trace_peek(const unsigned char *trace, EZDEV_SDK_UINT32 len, sdk_trace_record_info *info); \
+	extern ezdev_sdk_kernel_error kernel_trace_replay(const unsigned char *record, EZDEV_SDK_UINT32 len);
+
+#endif
@@ -12,45 +12,97 @@
  *******************************************************************************/
 
 #include "ezdev_sdk_kernel_xml_parser.h"
-#include "ezxml.h"
+#include "ezxml_stream.h"
 #include "mkernel_internal_error.h"
 #include "sdk_kernel_def.h"
 
+typedef struct
+{
+	ezxml_stream_t stream;
+	char *domain_name;
+	size_t domain_name_len;
+	int in_domain_name;			///<	正在根节点下第一个DomainName里
+	int found;
+	int too_long;
+} domain_name_parser;
+
+static int domain_name_event(void *user, ezxml_stream_event event, const char *name, const char *value, size_t len)
+{
+	domain_name_parser *parser = (domain_name_parser *)user;
+
+	switch (event)
+	{
+	case EZXML_STREAM_START:
+		if (!parser->found && ezxml_stream_depth(parser->stream) == 2 && strcmp(name, "DomainName") == 0)
+		{
+			parser->in_domain_name = 1;
+		}
+		break;
+	case EZXML_STREAM_TEXT:
+		if (parser->in_domain_name && ezxml_stream_depth(parser->stream) == 2)
+		{
+			if (parser->domain_name_len + len >= ezdev_sdk_name_len)
+			{
+				parser->too_long = 1;
+				return 1;
+			}
+			memcpy(parser->domain_name + parser->domain_name_len, value, len);
+			parser->domain_name_len += len;
+		}
+		break;
+	case EZXML_STREAM_END:
+		if (parser->in_domain_name && ezxml_stream_depth(parser->stream) == 2)
+		{
+			/* 只需要这一个字段, 找到后不再解析剩余部分 */
+			parser->in_domain_name = 0;
+			parser->found = 1;
+			return 1;
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
 mkernel_internal_error cenplt2pusetlbsdomainnamebydasreq_xml_parser(char* xml_buf, unsigned int len, char domain_name[ezdev_sdk_name_len])
 {
-	ezxml_t	xml_domain_name_node = NULL;
-	ezxml_t xml_root = NULL;
+	domain_name_parser parser;
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.domain_name = domain_name;
 	do 
 	{
 		//Request
-		xml_root = ezxml_parse_str(xml_buf, len);
-		if (NULL == xml_root)
+		parser.stream = ezxml_stream_new(domain_name_event, &parser, 0);
+		if (NULL == parser.stream)
 		{
 			sdk_error = mkernel_internal_xml_parse_error;
 			break;
 		}
-		xml_domain_name_node = ezxml_child(xml_root, "DomainName");
-		if ( NULL == xml_domain_name_node )
+
+		if ((0 != ezxml_stream_feed(parser.stream, xml_buf, len) || 0 != ezxml_stream_finish(parser.stream)) &&
+			!parser.found && !parser.too_long)
 		{
-			sdk_error = mkernel_internal_get_error_xml;
+			sdk_error = mkernel_internal_xml_parse_error;
 			break;
 		}
 
-		if (strlen(ezxml_txt(xml_domain_name_node)) >= ezdev_sdk_name_len)
+		if (parser.too_long || !parser.found)
 		{
 			sdk_error = mkernel_internal_get_error_xml;
 			break;
 		}
-		
-		strncpy(domain_name, ezxml_txt(xml_domain_name_node), strlen(ezxml_txt(xml_domain_name_node)));
+
+		domain_name[parser.domain_name_len] = '\0';
 	} while (0);
 
-	if (xml_root != NULL)
+	if (parser.stream != NULL)
 	{
-		ezxml_free(xml_root);
-		xml_root = NULL;
+		ezxml_stream_free(parser.stream);
+		parser.stream = NULL;
 	}
 
 	return sdk_error;
-}
\ No newline at end of file
+}
@@ -223,6 +223,10 @@ extern mkernel_internal_error json_parse_das_server_info( const char* jsonstring
 	bscJSON *serverid_json_item = NULL;
 	bscJSON *dasinfo_json_item = NULL;
 	bscJSON *das_json_item = NULL;
+	bscJSON *cipher_json_item = NULL;
+	bscJSON *key_lifetime_json_item = NULL;
+	bscJSON *frag_size_json_item = NULL;
+	bscJSON *compress_json_item = NULL;
 
 	do 
 	{
@@ -303,6 +307,38 @@ extern mkernel_internal_error json_parse_das_server_info( const char* jsonstring
 
 		das_server_info->das_port = port_json_item->valueint;
 		das_server_info->das_udp_port = udpport_json_item->valueint;
+
+		/* 老平台不下发Cipher, 沿用CBC */
+		das_server_info->das_cipher = ezdev_sdk_das_cipher_cbc;
+		cipher_json_item = bscJSON_GetObjectItem(dasinfo_json_item, "Cipher");
+		if (cipher_json_item != NULL && cipher_json_item->type == bscJSON_Number && cipher_json_item->valueint == ezdev_sdk_das_cipher_gcm)
+		{
+			das_server_info->das_cipher = ezdev_sdk_das_cipher_gcm;
+		}
+
+		/* 不下发Compress或者取值不认识时不压缩 */
+		das_server_info->das_compress = ezdev_sdk_das_compress_none;
+		compress_json_item = bscJSON_GetObjectItem(dasinfo_json_item, "Compress");
+		if (compress_json_item != NULL && compress_json_item->type == bscJSON_Number && compress_json_item->valueint == ezdev_sdk_das_compress_lz4)
+		{
+			das_server_info->das_compress = ezdev_sdk_das_compress_lz4;
+		}
+
+		/* 不下发KeyLifetime的平台不支持不断线更换密钥, 密钥失效时仍走重新注册 */
+		das_server_info->das_key_lifetime = 0;
+		key_lifetime_json_item = bscJSON_GetObjectItem(dasinfo_json_item, "KeyLifetime");
+		if (key_lifetime_json_item != NULL && key_lifetime_json_item->type == bscJSON_Number && key_lifetime_json_item->valueint > 0)
+		{
+			das_server_info->das_key_lifetime = key_lifetime_json_item->valueint;
+		}
+
+		/* 不下发FragSize的平台不支持分片, 超过发送缓存的消息仍然发不出去 */
+		das_server_info->das_frag_size = 0;
+		frag_size_json_item = bscJSON_GetObjectItem(dasinfo_json_item, "FragSize");
+		if (frag_size_json_item != NULL && frag_size_json_item->type == bscJSON_Number && frag_size_json_item->valueint > 0)
+		{
+			das_server_info->das_frag_size = frag_size_json_item->valueint;
+		}
 		ezdev_sdk_kernel_log_debug(0, 0, "das_server_info:address:%s,port:%d \n",das_server_info->das_address, das_server_info->das_port);
 	} while (0);
 
@@ -37,9 +37,11 @@
 #include "json_parser.h"
 #include "mbedtls/sha512.h"
 #include "utils.h"
+#include "ezdev_sdk_kernel_rng.h"
 
 ASE_SUPPORT_INTERFACE
 JSON_PARSER_INTERFACE
+EZDEV_SDK_KERNEL_RNG_INTERFACE
 extern char g_binding_nic[ezdev_sdk_name_len];
 
 #define iv_len  12
@@ -130,10 +132,16 @@ static void generate_sharekey(ezdev_sdk_kernel *sdk_kernel, lbs_affair *redirect
 
 static mkernel_internal_error init_lbs_affair(ezdev_sdk_kernel *sdk_kernel, lbs_affair *redirect_affair, EZDEV_SDK_UINT8 nUpper)
 {
-	redirect_affair->random_1 = rand() % 256;
-	redirect_affair->random_2 = rand() % 256;
-	redirect_affair->random_3 = rand() % 256;
-	redirect_affair->random_4 = rand() % 256;
+	EZDEV_SDK_UINT8 random[4] = {0};
+	if (0 != kernel_rng_random(NULL, random, sizeof(random)))
+	{
+		ezdev_sdk_kernel_log_error(0, 0, "kernel_rng_random err\n");
+		return mkernel_internal_internal_err;
+	}
+	redirect_affair->random_1 = random[0];
+	redirect_affair->random_2 = random[1];
+	redirect_affair->random_3 = random[2];
+	redirect_affair->random_4 = random[3];
 
     //发送包，固定报文头，2-5个字节
 	redirect_affair->global_out_packet.head_buf = malloc(16);
@@ -534,6 +542,12 @@ static mkernel_internal_error wait_assign_response(ezdev_sdk_kernel *sdk_kernel,
 		*remain_len += len * remain_mult;
 		remain_mult *= 128;
 		remain_count++;
+
+		//剩余长度最多4个字节, 再多说明报文非法, 继续读会让长度回绕
+		if (remain_count >= 4 && (byte_2 & 0x80) != 0)
+		{
+			return mkernel_internal_rev_invalid_packet;
+		}
 	} while ((byte_2 & 0x80) != 0);
 
     authi_affair->global_in_packet.head_buf[0] = byte_1;
@@ -586,6 +600,21 @@ static mkernel_internal_error wait_assign_response(ezdev_sdk_kernel *sdk_kernel,
 	return mkernel_internal_succ;
 }
 
+/**
+ * \brief   响应报文在当前解析位置之后至少还要有need字节, 否则按非法报文处理, 防止后续的长度计算回绕
+ */
+static mkernel_internal_error lbs_check_remain(lbs_affair *authi_affair, EZDEV_SDK_UINT32 remain_len, EZDEV_SDK_UINT32 need)
+{
+	if (remain_len < authi_affair->global_in_packet.payload_buf_off ||
+		remain_len - authi_affair->global_in_packet.payload_buf_off < need)
+	{
+		ezdev_sdk_kernel_log_debug(mkernel_internal_rev_invalid_packet, 0, "lbs rsp too short, len:%d, off:%d, need:%d\n", remain_len, authi_affair->global_in_packet.payload_buf_off, need);
+		return mkernel_internal_rev_invalid_packet;
+	}
+
+	return mkernel_internal_succ;
+}
+
 static mkernel_internal_error send_lbs_msg(ezdev_sdk_kernel *sdk_kernel, lbs_affair *authi_affair)
 {
 	mkernel_internal_error result_ = mkernel_internal_succ;
@@ -783,7 +812,7 @@ static mkernel_internal_error aes_128_decrypt_peer_pubkey(lbs_affair *authi_affa
                                                         unsigned char* intput_tag_buf, EZDEV_SDK_UINT32 tag_buf_len)
 {
     mkernel_internal_error sdk_error = mkernel_internal_succ;
-    EZDEV_SDK_UINT8 recv_plat_key_len = 0;
+    EZDEV_SDK_UINT32 recv_plat_key_len = 0;
     unsigned char aes_encrypt_key[16];
     EZDEV_SDK_UINT32 peer_pubkey_len = 0;
     //EZDEV_SDK_UINT32 buf_len = 0;
@@ -793,6 +822,13 @@ static mkernel_internal_error aes_128_decrypt_peer_pubkey(lbs_affair *authi_affa
         return mkernel_internal_input_param_invalid;
     }
 
+    //out_buf大小为ezdev_sdk_total_len, gcm解密后明文和密文一样长
+    if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1) ||
+        remain_len - authi_affair->global_in_packet.payload_buf_off > ezdev_sdk_total_len)
+    {
+        return mkernel_internal_rev_invalid_packet;
+    }
+
     recv_plat_key_len = remain_len - authi_affair->global_in_packet.payload_buf_off;
     ezdev_sdk_kernel_log_error(0, 0, "recv_plat_key_len: is :%d \n", recv_plat_key_len);
 
@@ -831,6 +867,10 @@ static mkernel_internal_error parse_authentication_ii(ezdev_sdk_kernel *sdk_kern
 	unsigned char md5_masterkey[16]={0};
 	int nIndex = 0;
 	authi_affair->global_in_packet.payload_buf_off += 3;
+	if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
 
 	ezdev_sdk_kernel_log_debug(0, 0, "parse_authentication_ii remain_len:%d", remain_len);
 
@@ -882,6 +922,10 @@ static mkernel_internal_error parse_authentication_ii(ezdev_sdk_kernel *sdk_kern
     switch (sdk_kernel->dev_cur_auth_type)
     {
     case sdk_dev_auth_protocol_ecdh:
+        if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, tag_buf_len))
+        {
+            return mkernel_internal_rev_invalid_packet;
+        }
         memcpy(input_tag_buf, authi_affair->global_in_packet.payload_buf + authi_affair->global_in_packet.payload_buf_off, tag_buf_len);
         authi_affair->global_in_packet.payload_buf_off += tag_buf_len;
 
@@ -1070,6 +1114,10 @@ static mkernel_internal_error parse_authentication_create_dev_id(lbs_affair *aut
     EZDEV_SDK_UINT32 sessionkey_tag_buf_len = tag_len;
 
     authi_affair->global_in_packet.payload_buf_off += 3;
+    if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+    {
+        return mkernel_internal_rev_invalid_packet;
+    }
 
     //取返回码
     memcpy(&result_code, authi_affair->global_in_packet.payload_buf + authi_affair->global_in_packet.payload_buf_off, 1);
@@ -1081,6 +1129,12 @@ static mkernel_internal_error parse_authentication_create_dev_id(lbs_affair *aut
         return mkernel_internal_platform_error + result_code;
     }
 
+    //tag + 长度 + 32字节dev_id密文 + tag + 长度 + 16字节sessionkey密文, 之后是签名
+    if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, devid_tag_buf_len + 1 + 32 + sessionkey_tag_buf_len + 1 + 16))
+    {
+        return mkernel_internal_rev_invalid_packet;
+    }
+
     //devid tag
     memcpy(devid_tag_buf, authi_affair->global_in_packet.payload_buf + authi_affair->global_in_packet.payload_buf_off, devid_tag_buf_len);
     authi_affair->global_in_packet.payload_buf_off += devid_tag_buf_len;
@@ -1284,11 +1338,15 @@ static mkernel_internal_error parse_refreshsessionkey_ii(lbs_affair *authi_affai
 {
     mkernel_internal_error sdk_error = mkernel_internal_succ;
     char result_code = 0;
-    EZDEV_SDK_UINT8 en_sessionkey_len = 0;
+    EZDEV_SDK_UINT32 en_sessionkey_len = 0;
     EZDEV_SDK_UINT8 return_random_1 = 0;
     unsigned char ase_dst[32];
     EZDEV_SDK_UINT32 ase_dst_len = 0;
     authi_affair->global_in_packet.payload_buf_off += 3;
+    if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+    {
+        return mkernel_internal_rev_invalid_packet;
+    }
 
     //取返回码
     memcpy(&result_code, authi_affair->global_in_packet.payload_buf + authi_affair->global_in_packet.payload_buf_off, 1);
@@ -1486,6 +1544,10 @@ static mkernel_internal_error crypto_data_req_das_serialize(lbs_affair *auth_aff
 		bscJSON_AddStringToObject(pJsonRoot, "DevSerial", auth_affair->dev_subserial);
 		bscJSON_AddStringToObject(pJsonRoot, "Type", "DAS");
 		bscJSON_AddNumberToObject(pJsonRoot, "Mode", auth_affair->dev_access_mode);
+		bscJSON_AddNumberToObject(pJsonRoot, "CipherSupport", ezdev_sdk_das_cipher_support);
+		bscJSON_AddNumberToObject(pJsonRoot, "CompressSupport", ezdev_sdk_das_compress_support);
+		bscJSON_AddNumberToObject(pJsonRoot, "KeyRotateSupport", ezdev_sdk_das_key_rotate_support);
+		bscJSON_AddNumberToObject(pJsonRoot, "FragSupport", ezdev_sdk_das_frag_support);
 
 		json_buf = bscJSON_PrintBuffered(pJsonRoot, ezdev_sdk_json_default_size, 0);
 		if (json_buf == NULL)
@@ -1701,6 +1763,10 @@ static mkernel_internal_error parse_crypto_data_rsp_das(lbs_affair *authi_affair
 	EZDEV_SDK_UINT32 de_dst_len = 0;
 
 	authi_affair->global_in_packet.payload_buf_off += 3;
+	if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
 
 	//取返回码
 	memcpy(&result_code, authi_affair->global_in_packet.payload_buf + authi_affair->global_in_packet.payload_buf_off, 1);
@@ -1712,6 +1778,10 @@ static mkernel_internal_error parse_crypto_data_rsp_das(lbs_affair *authi_affair
 		return mkernel_internal_platform_error + result_code;
 	}
 
+	if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
 	en_src_len = remain_len - authi_affair->global_in_packet.payload_buf_off;
 
 	de_dst = (unsigned char *)malloc(en_src_len);
@@ -1730,6 +1800,8 @@ static mkernel_internal_error parse_crypto_data_rsp_das(lbs_affair *authi_affair
 			break;
 		}
 
+		//明文后面是补齐字节, 截断成字符串再交给JSON解析
+		de_dst[de_dst_len] = '\0';
 		sdk_error = json_parse_das_server_info((char *)de_dst, rev_das_info);
 		if (sdk_error != mkernel_internal_succ)
 		{
@@ -1756,6 +1828,10 @@ static mkernel_internal_error parse_crypto_data_rsp_stun(lbs_affair *authi_affai
 	EZDEV_SDK_UINT32 de_dst_len = 0;
 
 	authi_affair->global_in_packet.payload_buf_off += 3;
+	if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
 
 	//取返回码
 	memcpy(&result_code, authi_affair->global_in_packet.payload_buf + authi_affair->global_in_packet.payload_buf_off, 1);
@@ -1767,6 +1843,10 @@ static mkernel_internal_error parse_crypto_data_rsp_stun(lbs_affair *authi_affai
 		return mkernel_internal_platform_error + result_code;
 	}
 
+	if (mkernel_internal_succ != lbs_check_remain(authi_affair, remain_len, 1))
+	{
+		return mkernel_internal_rev_invalid_packet;
+	}
 	en_src_len = remain_len - authi_affair->global_in_packet.payload_buf_off;
 
 	de_dst = (unsigned char *)malloc(en_src_len);
@@ -1786,6 +1866,8 @@ static mkernel_internal_error parse_crypto_data_rsp_stun(lbs_affair *authi_affai
 			break;
 		}
 
+		//明文后面是补齐字节, 截断成字符串再交给JSON解析
+		de_dst[de_dst_len] = '\0';
 		sdk_error = json_parse_stun_server_info((char *)de_dst, rev_stun_info);
 		if (sdk_error != mkernel_internal_succ)
 		{
@@ -2124,65 +2206,75 @@ mkernel_internal_error lbs_redirect_createdevid_with_auth(ezdev_sdk_kernel *sdk_
 	return sdk_error;
 }
 
-mkernel_internal_error lbs_redirect(ezdev_sdk_kernel *sdk_kernel)
+/**
+ * \brief   刷新会话密钥并获取DAS信息, 新密钥留在事务里, 由调用者决定是否保存; 调用者负责lbs_close和fini_lbs_affair
+ */
+static mkernel_internal_error lbs_refresh_sessionkey(ezdev_sdk_kernel *sdk_kernel, lbs_affair *auth_redirect, das_info *revc_das_info)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
-	lbs_affair auth_redirect;
-
-	das_info revc_das_info;
-
-	memset(&auth_redirect, 0, sizeof(auth_redirect));
-	memset(&revc_das_info, 0, sizeof(revc_das_info));
 
 	do
 	{
-		sdk_error = init_lbs_affair(sdk_kernel, &auth_redirect, 1);
+		sdk_error = init_lbs_affair(sdk_kernel, auth_redirect, 1);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
 
-		sdk_error = lbs_connect(sdk_kernel, &auth_redirect);
+		sdk_error = lbs_connect(sdk_kernel, auth_redirect);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
 
-		sdk_error = send_refreshsessionkey_i(sdk_kernel, &auth_redirect);
+		sdk_error = send_refreshsessionkey_i(sdk_kernel, auth_redirect);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
 
-		sdk_error = wait_refreshsessionkey_ii(sdk_kernel, &auth_redirect);
+		sdk_error = wait_refreshsessionkey_ii(sdk_kernel, auth_redirect);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
 
-		clear_lbs_affair_buf(&auth_redirect);
-		sdk_error = send_refreshsessionkey_iii(sdk_kernel, &auth_redirect);
+		clear_lbs_affair_buf(auth_redirect);
+		sdk_error = send_refreshsessionkey_iii(sdk_kernel, auth_redirect);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
 
-		clear_lbs_affair_buf(&auth_redirect);
-		sdk_error = send_crypto_data_req(sdk_kernel, &auth_redirect, 1);
+		clear_lbs_affair_buf(auth_redirect);
+		sdk_error = send_crypto_data_req(sdk_kernel, auth_redirect, 1);
 		if (sdk_error != mkernel_internal_succ)
 		{
 			break;
 		}
 
-		sdk_error = wait_crypto_data_rsp_das(sdk_kernel, &auth_redirect, &revc_das_info);
-		if (sdk_error != mkernel_internal_succ)
-		{
-			break;
-		}
+		sdk_error = wait_crypto_data_rsp_das(sdk_kernel, auth_redirect, revc_das_info);
+	} while (0);
+
+	return sdk_error;
+}
+
+mkernel_internal_error lbs_redirect(ezdev_sdk_kernel *sdk_kernel)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	lbs_affair auth_redirect;
+
+	das_info revc_das_info;
+
+	memset(&auth_redirect, 0, sizeof(auth_redirect));
+	memset(&revc_das_info, 0, sizeof(revc_das_info));
 
+	sdk_error = lbs_refresh_sessionkey(sdk_kernel, &auth_redirect, &revc_das_info);
+	if (sdk_error == mkernel_internal_succ)
+	{
 		save_key_value(sdk_kernel, &auth_redirect);
 		save_das_info(sdk_kernel, &revc_das_info);
-	} while (0);
+	}
   
 	lbs_close(sdk_kernel, &auth_redirect);
 	fini_lbs_affair(&auth_redirect);
@@ -2190,6 +2282,26 @@ mkernel_internal_error lbs_redirect(ezdev_sdk_kernel *sdk_kernel)
 	return sdk_error;
 }
 
+mkernel_internal_error lbs_rotate_sessionkey(ezdev_sdk_kernel *sdk_kernel, unsigned char session_key[ezdev_sdk_sessionkey_len], das_info *new_das_info)
+{
+	mkernel_internal_error sdk_error = mkernel_internal_succ;
+	lbs_affair auth_redirect;
+
+	memset(&auth_redirect, 0, sizeof(auth_redirect));
+	memset(new_das_info, 0, sizeof(das_info));
+
+	sdk_error = lbs_refresh_sessionkey(sdk_kernel, &auth_redirect, new_das_info);
+	if (sdk_error == mkernel_internal_succ)
+	{
+		memcpy(session_key, auth_redirect.session_key, ezdev_sdk_sessionkey_len);
+	}
+
+	lbs_close(sdk_kernel, &auth_redirect);
+	fini_lbs_affair(&auth_redirect);
+
+	return sdk_error;
+}
+
 mkernel_internal_error lbs_getstun(ezdev_sdk_kernel *sdk_kernel, stun_info *ptr_stun)
 {
 	mkernel_internal_error sdk_error = mkernel_internal_succ;
@@ -2386,6 +2498,10 @@ static mkernel_internal_error wait_get_secretkey_rsp(ezdev_sdk_kernel *hsdk_kern
 
 		/** 头三个字节是协议版本号，不关心 */
 		hlbs_affair->global_in_packet.payload_buf_off = 3;
+		if (mkernel_internal_succ != (sdk_rv = lbs_check_remain(hlbs_affair, remain_len, 3)))
+		{
+			break;
+		}
 
 		/** 判断返回码 */
 		result_code = *(hlbs_affair->global_in_packet.payload_buf + hlbs_affair->global_in_packet.payload_buf_off++);
@@ -2394,7 +2510,8 @@ static mkernel_internal_error wait_get_secretkey_rsp(ezdev_sdk_kernel *hsdk_kern
 		memcpy(&netLen16, hlbs_affair->global_in_packet.payload_buf + hlbs_affair->global_in_packet.payload_buf_off, sizeof(short));
 		hlbs_affair->global_in_packet.payload_buf_off += 2;
 
-		if (hlbs_affair->global_in_packet.payload_buf_off + ntohs(netLen16) + 6 > remain_len)
+		if (hlbs_affair->global_in_packet.payload_buf_off + ntohs(netLen16) + 6 > remain_len ||
+			ntohs(netLen16) > sizeof(pPlainText))
 		{
 			ezdev_sdk_kernel_log_debug(sdk_rv, result_code, "rsp data len out of range, real len = %d\n", remain_len);
 			//如果包长度解析出错，默认30s一次，周期24小时
@@ -65,6 +65,8 @@ typedef enum
 	mkernel_internal_internal_err,						///<		内部错误
 	mkernel_internal_msg_len_overrange,                  ///<        消息长度超出范围
 	mkernel_internal_das_need_rebuild_session,
+	mkernel_internal_request_timeout,					///<		等待响应超时
+	mkernel_internal_request_cancelled,					///<		请求被取消
 
 	mkernel_internal_call_mqtt_connect = 100,			///<		调用MQTT 注册
 	mkernel_internal_call_mqtt_sub_error,				///<		调用MQTT 订阅topic
@@ -99,6 +101,7 @@ typedef enum
 	mkernel_internal_queue_uninit,						///<		队列未初始化
 	mkernel_internal_queue_error,						///<		队列内部出现顺序错误
 	mkernel_internal_queue_full,						///<		队列满
+	mkernel_internal_queue_superseded,					///<		队列中的消息被更新的同类消息替换
 
 	mkernel_internal_platform_appoint_error =600,		///<		接收到与协议约定不一致
 	mkernel_internal_sign_check_error,					///<		签名校验错误
@@ -16,6 +16,7 @@
 
 ezdev_sdk_kernel g_ezdev_sdk_kernel;
 char g_binding_nic[ezdev_sdk_name_len] = {0};	///<	设备绑定的本地网卡名称
+EZDEV_SDK_INT8 g_das_standby_enable = 0;		///<	链路变差时是否预先建立备用连接
 #define log_buf_len    513
 
 void ezdev_sdk_kernel_log (sdk_log_level level, int sdk_error, int othercode, \
@@ -16,6 +16,7 @@
 
 #include "base_typedef.h"
 #include "ezdev_sdk_kernel_struct.h"
+#include "ezdev_sdk_kernel_timer.h"
 
 #define ezdev_sdk_recv_topic_len									128		   ///<	设备SDK 一些命名的长度
 #define ezdev_sdk_type_len											16		   ///<	设备SDK 类型长度
@@ -30,6 +31,26 @@
 #define ezdev_sdk_sha256_offset                                     10         ///<	sha256密文偏移值
 #define ezdev_sdk_productkey_len									32		   ///<	productkey最长的长度
 #define ezdev_sdk_json_default_size									1024	   ///<	bscJSON_PrintBuffered 调用时给的默认大小，减少多次malloc/free过程
+#define ezdev_sdk_json_arena_size									512		   ///<	解析消息通用头时bscJSON arena的栈上块大小, 不够时再从堆上补
+#define ezdev_sdk_das_cipher_cbc									0		   ///<	DAS报文加密方式: AES-128-CBC, 固定IV, 补齐到16字节
+#define ezdev_sdk_das_cipher_gcm									1		   ///<	DAS报文加密方式: AES-128-GCM, 12字节序号 + 密文 + 16字节tag, 不补齐
+#define ezdev_sdk_das_cipher_support								((1 << ezdev_sdk_das_cipher_cbc) | (1 << ezdev_sdk_das_cipher_gcm)) ///< 向LBS申请DAS信息时上报的加密方式集合
+#define ezdev_sdk_das_gcm_seq_len									12		   ///<	GCM报文头的序号长度, 前8字节为每次注册随机生成的随机数, 后4字节为计数
+#define ezdev_sdk_das_gcm_tag_len									16		   ///<	GCM认证tag长度
+#define ezdev_sdk_das_compress_none									0		   ///<	DAS报文业务数据不压缩
+#define ezdev_sdk_das_compress_lz4									1		   ///<	DAS报文业务数据按LZ4 block格式压缩, 在加密之前进行
+#define ezdev_sdk_das_compress_support								(1 << ezdev_sdk_das_compress_lz4) ///< 向LBS申请DAS信息时上报的压缩方式集合
+#define ezdev_sdk_das_compress_threshold							512		   ///<	业务数据不小于该长度才尝试压缩
+#define ezdev_sdk_das_compress_ratio_max							128		   ///<	接收时允许的最大压缩比, 超过按非法报文处理, 防止解压炸弹
+#define ezdev_sdk_das_frag_support									1		   ///<	向LBS申请DAS信息时上报支持v3消息分片
+#define ezdev_sdk_das_frag_chunk_max								(ezdev_sdk_send_buf_max - 1024) ///<	每个分片的业务数据上限, 留出主题、通用协议体和加密开销, 保证分片放得进MQTT发送缓存
+#define ezdev_sdk_das_frag_stream_max								(64*1024*1024) ///<	流式发送的业务数据总长上限
+#define ezdev_sdk_das_frag_recv_max									(ezdev_sdk_recv_buf_max * 4) ///<	正在重组的下行消息合计占用内存上限
+#define ezdev_sdk_das_frag_slots									2		   ///<	同时重组的下行消息个数
+#define ezdev_sdk_das_frag_timeout_ms								(30*1000)  ///<	下行消息重组超时, 超时未收齐的丢弃
+#define ezdev_sdk_das_key_rotate_support							1		   ///<	向LBS申请DAS信息时上报支持不断线更换会话密钥
+#define ezdev_sdk_das_key_grace_ms									(60*1000)  ///<	更换会话密钥后, 旧密钥在接收方向继续有效的时间
+#define ezdev_sdk_das_key_retry_ms									(30*1000)  ///<	通过LBS更换会话密钥失败后的重试间隔
 #define ezdev_sdk_domain_id                                         1100       ///< 设备主动下线时，内部发送下线消息使用的领域id
 #define ezdev_sdk_offline_cmd_id                                    0X00002807 ///< 设备主动下线时发送的指令id
 #define ezdev_sdk_cmd_version                                       "v1.0.0"   ///< 指令版本
@@ -52,6 +73,7 @@
 //主要是给realtek使用
 #define ezdev_sdk_send_buf_max			1024*2
 #define ezdev_sdk_recv_buf_max			1024*2
+#define ezdev_sdk_mqtt_buf_init			1024
 
 #define lbs_send_buf_max			1024*2
 #define lbs_recv_buf_max			1024*2
@@ -63,6 +85,23 @@
 */
 #define ezdev_sdk_risk_control_cmd_max		8
 #define	ezdev_sdk_queue_max					32
+
+/**
+* \brief   发送队列每个优先级分道的容量
+*/
+#define ezdev_sdk_queue_control_max			8
+#define ezdev_sdk_queue_interactive_max		16
+#define ezdev_sdk_queue_bulk_max			8
+
+/**
+* \brief   请求/响应关联表的槽位数, 必须是2的幂, 最多同时有3/4的槽位在等待响应
+*/
+#define ezdev_sdk_request_slot_max			64
+
+/**
+* \brief   压缩时哈希表的位数, 哈希表占用(4 << bits)字节, 压缩期间临时分配
+*/
+#define ezdev_sdk_compress_hash_bits		10
 #else  //RAM_LIMIT
 /**
 * \brief   DAS MQTT 会话使用的缓存
@@ -73,11 +112,13 @@
 
 #define ezdev_sdk_send_buf_max			1024*256
 #define ezdev_sdk_recv_buf_max			1024*256
+#define ezdev_sdk_mqtt_buf_init			1024*2
 
 #else
 
 #define ezdev_sdk_send_buf_max			1024*16
 #define ezdev_sdk_recv_buf_max			1024*16
+#define ezdev_sdk_mqtt_buf_init			1024*2
 
 #endif
 
@@ -95,10 +136,52 @@
 #define ezdev_sdk_risk_control_cmd_max		64
 #define	ezdev_sdk_queue_max						64
 
+/**
+* \brief   发送队列每个优先级分道的容量
+*/
+#define ezdev_sdk_queue_control_max				16
+#define ezdev_sdk_queue_interactive_max			32
+#define ezdev_sdk_queue_bulk_max				16
+
+/**
+* \brief   请求/响应关联表的槽位数, 必须是2的幂, 最多同时有3/4的槽位在等待响应
+*/
+#define ezdev_sdk_request_slot_max				4096
+
+/**
+* \brief   压缩时哈希表的位数, 哈希表占用(4 << bits)字节, 压缩期间临时分配
+*/
+#define ezdev_sdk_compress_hash_bits			12
+
 
 #endif //RAM_LIMIT
 
+/**
+* \brief   DAS MQTT 收发缓存默认按ezdev_sdk_mqtt_buf_init分配, 遇到大报文按倍数增长到ezdev_sdk_send_buf_max/ezdev_sdk_recv_buf_max,
+*			最后一次用到大缓存ezdev_sdk_mqtt_buf_shrink_ms之后缩回初始大小
+*			定义EZDEV_SDK_MQTT_BUF_FIXED时仍使用按最大值分配的静态缓存
+*/
+#define ezdev_sdk_mqtt_buf_shrink_ms			30*1000
+
+/**
+* \brief   备用连接建立后超过这个时间没有用上就关掉, 服务端对迟迟不发CONNECT的连接可能已经断开
+*/
+#define ezdev_sdk_das_standby_max_ms			30*1000
+
 #define ezdev_sdk_das_default_keepaliveinterval			30		///<	DAS默认心跳时间
+
+/**
+* \brief   发送队列的优先级分道, 与sdk_msg_class的control/interactive/bulk对应
+*			每轮control最多连发8条、interactive 4条、bulk 1条, 只要分道非空每轮至少发一条, 低优先级不会被饿死
+*/
+#define ezdev_sdk_queue_lane_control			0		///<	内部消息memset后即为0, 默认走最高优先级
+#define ezdev_sdk_queue_lane_interactive		1
+#define ezdev_sdk_queue_lane_bulk				2
+#define ezdev_sdk_queue_lane_count				3
+
+#define ezdev_sdk_queue_weight_control			8
+#define ezdev_sdk_queue_weight_interactive		4
+#define ezdev_sdk_queue_weight_bulk				1
 #define ezdev_sdk_sharekey_salt "www.88075998.com"
 
 #define ezdev_sdk_max_publish_count		2		///<	最多发布的次数
@@ -220,6 +303,10 @@ typedef struct
 	char das_address[ezdev_sdk_ip_max_len];
 	char das_domain[ezdev_sdk_ip_max_len];
 	char das_serverid[ezdev_sdk_name_len];
+	EZDEV_SDK_UINT8 das_cipher;					///<	LBS协商的报文加密方式, ezdev_sdk_das_cipher_cbc/ezdev_sdk_das_cipher_gcm
+	EZDEV_SDK_UINT8 das_compress;				///<	LBS协商的报文压缩方式, ezdev_sdk_das_compress_none/ezdev_sdk_das_compress_lz4
+	EZDEV_SDK_UINT32 das_key_lifetime;			///<	LBS下发的会话密钥有效期(秒), 不为0时在到期前通过LBS更换密钥, 不断开DAS
+	EZDEV_SDK_UINT32 das_frag_size;				///<	LBS下发的v3消息分片大小, 0表示平台不支持分片
 }das_info;
 
 /**
@@ -273,7 +360,7 @@ typedef struct
 	sdk_entrance_state	entr_state;												///<	sdk入口状态
 	sdk_state			my_state;												///<	sdk状态
 	sdk_cloud_cnt_state cnt_state;												///<	连接状态											
-	ezdev_sdk_time		cnt_state_timer;										///<	重连相关的定时器
+	kernel_timer		cnt_state_timer;										///<	重连相关的定时器
 	
 	char dev_subserial[ezdev_sdk_devserial_maxlen];
 	unsigned char master_key[ezdev_sdk_masterkey_len];
@@ -330,6 +417,7 @@ typedef struct
 typedef struct
 {
 	EZDEV_SDK_UINT16		max_send_count;			///<	最大发布次数，send后--
+	EZDEV_SDK_UINT8			msg_lane;				///<	发送队列分道, ezdev_sdk_queue_lane_xxx
 	ezdev_sdk_kernel_pubmsg		msg_conntext;		///<	发布的消息内容
 }ezdev_sdk_kernel_pubmsg_exchange;
 
@@ -339,6 +427,7 @@ typedef struct
 typedef struct
 {
 	EZDEV_SDK_UINT16		max_send_count;			///<	最大发布次数，send后--
+	EZDEV_SDK_UINT8			msg_lane;				///<	发送队列分道, ezdev_sdk_queue_lane_xxx
 	ezdev_sdk_kernel_pubmsg_v3	msg_conntext_v3;		///<	发布的消息内容
 }ezdev_sdk_kernel_pubmsg_exchange_v3;
 
@@ -14,10 +14,9 @@
 #include <string.h>
 #include "utils.h"
 #include "mbedtls/rsa.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
 #include "mkernel_internal_error.h"
 #include "ezdev_sdk_kernel_error.h"
+#include "ezdev_sdk_kernel_rng.h"
 
 #if !defined(BSCOMPTLS_CONFIG_FILE)
 #include "mbedtls/config.h"
@@ -32,52 +31,23 @@
 #define bscomptls_printf     printf
 #endif
 
-#ifndef _REALTEK_RTOS_
+EZDEV_SDK_KERNEL_RNG_INTERFACE
 
 int ezRandomGen(unsigned char *buf, unsigned int len)
 {
-	int ret = 0;
-	char *identifier = "ezDevSDK";
-	bscomptls_ctr_drbg_context ctr_drbg;
-	bscomptls_entropy_context entropy;
-	bscomptls_ctr_drbg_init( &ctr_drbg );
-	bscomptls_entropy_init( &entropy );
-	do 
-	{
-		if(0 != (ret = bscomptls_ctr_drbg_seed( &ctr_drbg, bscomptls_entropy_func, &entropy, (unsigned char*)identifier, strlen(identifier))))
-			break;
-
-		bscomptls_ctr_drbg_set_prediction_resistance( &ctr_drbg, BSCOMPTLS_CTR_DRBG_PR_OFF );
-
-		ret = bscomptls_ctr_drbg_random( &ctr_drbg, buf, len);
-	} while (0);
-
-	bscomptls_ctr_drbg_free( &ctr_drbg );
-	bscomptls_entropy_free( &entropy );
-
-	return ret;
+	return kernel_rng_random(NULL, buf, len);
 }
 
+#ifndef _REALTEK_RTOS_
+
 int ezRsaEncrypt(const unsigned char *pIn, int iInLen, unsigned char *pOut, int *iOutLen, const char *pN, const char *pE)
 {
     int ret = BSCOMPTLS_EXIT_FAILURE;
-	char *identifier = "ezDevSDK";
     bscomptls_rsa_context rsa;
-	bscomptls_ctr_drbg_context ctr_drbg;
-	bscomptls_entropy_context entropy;
     bscomptls_rsa_init( &rsa, BSCOMPTLS_RSA_PKCS_V15, 0 );
-	bscomptls_ctr_drbg_init( &ctr_drbg );
-	bscomptls_entropy_init( &entropy );
 
 	do 
 	{
-		if(0 != bscomptls_ctr_drbg_seed( &ctr_drbg, bscomptls_entropy_func,
-			&entropy, (const unsigned char *) identifier,
-			strlen( identifier ) ))
-		{
-			break;
-		}
-
 		if (0 != bscomptls_mpi_read_string(&rsa.N, 16, pN) ||
 			0 != bscomptls_mpi_read_string(&rsa.E, 16, pE))
 		{
@@ -91,7 +61,7 @@ int ezRsaEncrypt(const unsigned char *pIn, int iInLen, unsigned char *pOut, int
 			break;
 		}
 
-		if (0 != bscomptls_rsa_pkcs1_encrypt( &rsa, bscomptls_ctr_drbg_random, &ctr_drbg, BSCOMPTLS_RSA_PUBLIC,
+		if (0 != bscomptls_rsa_pkcs1_encrypt( &rsa, kernel_rng_random, NULL, BSCOMPTLS_RSA_PUBLIC,
 			iInLen, pIn, pOut))
 		{
 			break;
@@ -101,8 +71,6 @@ int ezRsaEncrypt(const unsigned char *pIn, int iInLen, unsigned char *pOut, int
 		*iOutLen = rsa.len;
 	} while (0);
 
-	bscomptls_ctr_drbg_free( &ctr_drbg );
-	bscomptls_entropy_free( &entropy );
 	bscomptls_rsa_free( &rsa );
 	return ret;
 }
@@ -111,24 +79,12 @@ int ezRsaDecrypt(const unsigned char *pIn, int iInLen, unsigned char *pOut, int
 				 const char *pN, const char *pD, const char *pE)
 {
 	int ret = BSCOMPTLS_EXIT_FAILURE;
-	char *identifier = "ezDevSDK";
 	bscomptls_rsa_context rsa;
-	bscomptls_ctr_drbg_context ctr_drbg;
-	bscomptls_entropy_context entropy;
 	bscomptls_rsa_init( &rsa, BSCOMPTLS_RSA_PKCS_V15, 0 );
-	bscomptls_ctr_drbg_init( &ctr_drbg );
-	bscomptls_entropy_init( &entropy );
 	size_t olen = *iOutLen;
 
 	do 
 	{
-		if(0 != bscomptls_ctr_drbg_seed( &ctr_drbg, bscomptls_entropy_func,
-			&entropy, (const unsigned char *) identifier,
-			strlen( identifier ) ))
-		{
-			break;
-		}
-
 		if (0 != bscomptls_mpi_read_string(&rsa.N, 16, pN) ||
 			0 != bscomptls_mpi_read_string(&rsa.D, 16, pD) ||
 			0 != bscomptls_mpi_read_string(&rsa.E, 16, pE) ||
@@ -145,7 +101,7 @@ int ezRsaDecrypt(const unsigned char *pIn, int iInLen, unsigned char *pOut, int
 			break;
 		}
 
-		if (0 != bscomptls_rsa_pkcs1_decrypt( &rsa, bscomptls_ctr_drbg_random, &ctr_drbg, BSCOMPTLS_RSA_PRIVATE,
+		if (0 != bscomptls_rsa_pkcs1_decrypt( &rsa, kernel_rng_random, NULL, BSCOMPTLS_RSA_PRIVATE,
 				&olen, pIn, pOut, olen))
 		{
 			break;
@@ -155,8 +111,6 @@ int ezRsaDecrypt(const unsigned char *pIn, int iInLen, unsigned char *pOut, int
 		ret = BSCOMPTLS_EXIT_SUCCESS;
 	} while (0);
 
-	bscomptls_ctr_drbg_free( &ctr_drbg );
-	bscomptls_entropy_free( &entropy );
 	bscomptls_rsa_free( &rsa );
 	return ret;
 }
@@ -205,6 +159,15 @@ unsigned int mkiE2ezE(unsigned int mkernel_err)
 	case mkernel_internal_queue_full:
 		rv = ezdev_sdk_kernel_queue_full;
 		break;
+	case mkernel_internal_queue_superseded:
+		rv = ezdev_sdk_kernel_msg_superseded;
+		break;
+	case mkernel_internal_request_timeout:
+		rv = ezdev_sdk_kernel_request_timeout;
+		break;
+	case mkernel_internal_request_cancelled:
+		rv = ezdev_sdk_kernel_request_cancelled;
+		break;
 	case mkernel_internal_value_load_err:
 		rv = ezdev_sdk_kernel_value_load;
 		break;
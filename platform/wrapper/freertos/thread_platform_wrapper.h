@@ -23,6 +23,11 @@ typedef struct
 	xSemaphoreHandle lock;
 }sdk_mutex_platform;
 
+typedef struct 
+{
+	xSemaphoreHandle sem;
+}sdk_sem_platform;
+
 typedef struct thread_handle_platform
 {
 	xTaskHandle thread_hd; ;
@@ -190,6 +190,17 @@ ezdev_sdk_net_work net_create(char* nic_name)
 		return NULL;
 	}
 
+	if (pipe(linuxnet_work->wake_fd) == 0)
+	{
+		linuxsocket_setnonblock(linuxnet_work->wake_fd[0]);
+		linuxsocket_setnonblock(linuxnet_work->wake_fd[1]);
+	}
+	else
+	{
+		linuxnet_work->wake_fd[0] = -1;
+		linuxnet_work->wake_fd[1] = -1;
+	}
+
 	ret = setsockopt(linuxnet_work->socket_fd , IPPROTO_TCP, TCP_MAXSEG, &opt, sizeof(opt));
 	if (ret < 0) 
 	{
@@ -369,10 +380,79 @@ void net_destroy(ezdev_sdk_net_work net_work)
 	{
 		return;
 	}
+	if (linuxnet_work->wake_fd[0] != -1)
+	{
+		close(linuxnet_work->wake_fd[0]);
+		close(linuxnet_work->wake_fd[1]);
+	}
 	free(linuxnet_work);
 	return;
 }
 
+/** 
+ *  \brief		等待网络连接可读, 期间net_wakeup可以让它提前返回
+ *  \method		net_wait
+ *  \return 	可读返回成功, 超时或被叫醒返回mkernel_internal_net_socket_timeout
+ */
+mkernel_internal_error net_wait(ezdev_sdk_net_work net_work, int timeout_ms)
+{
+	struct pollfd poll_fd[2];
+	char drain[16];
+	int nfds = 0;
+
+	linux_net_work* linuxnet_work = (linux_net_work*)net_work;
+	if (NULL == linuxnet_work)
+	{
+		return mkernel_internal_input_param_invalid;
+	}
+	if (linuxnet_work->wake_fd[0] == -1)
+	{
+		return linuxsocket_poll(linuxnet_work->socket_fd, POLL_RECV, timeout_ms);
+	}
+
+	poll_fd[0].fd = linuxnet_work->socket_fd;
+	poll_fd[0].events = POLLIN;
+	poll_fd[0].revents = 0;
+	poll_fd[1].fd = linuxnet_work->wake_fd[0];
+	poll_fd[1].events = POLLIN;
+	poll_fd[1].revents = 0;
+
+	nfds = poll(poll_fd, 2, timeout_ms);
+	if (nfds < 0)
+	{
+		return errno == EINTR ? mkernel_internal_net_socket_timeout : mkernel_internal_net_socket_error;
+	}
+	if (poll_fd[1].revents & POLLIN)
+	{
+		while (read(linuxnet_work->wake_fd[0], drain, sizeof(drain)) > 0)
+		{
+		}
+	}
+	if (poll_fd[0].revents & POLLIN)
+	{
+		return mkernel_internal_succ;
+	}
+	if (poll_fd[0].revents & (POLLNVAL | POLLERR | POLLHUP))
+	{
+		return mkernel_internal_net_socket_error;
+	}
+	return mkernel_internal_net_socket_timeout;
+}
+
+void net_wakeup(ezdev_sdk_net_work net_work)
+{
+	linux_net_work* linuxnet_work = (linux_net_work*)net_work;
+	if (NULL == linuxnet_work || linuxnet_work->wake_fd[1] == -1)
+	{
+		return;
+	}
+	/* 管道满了说明已经有没取走的唤醒, 不用再写 */
+	if (write(linuxnet_work->wake_fd[1], "w", 1) < 0)
+	{
+		return;
+	}
+}
+
 int net_getsocket(ezdev_sdk_net_work net_work)
 {
 	linux_net_work* linuxnet_work = (linux_net_work*)net_work;
@@ -7,6 +7,7 @@
 typedef struct 
 {
 	int socket_fd;
+	int wake_fd[2];		///<	net_waitͬʱȴĹܵ, net_wakeupдһֽڽ, ʧʱΪ-1
 }linux_net_work;
 
 
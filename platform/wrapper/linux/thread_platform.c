@@ -1,5 +1,7 @@
 #include "thread_platform_wrapper.h"
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/prctl.h>
 
 #include "ezdev_sdk_kernel_struct.h"
@@ -70,6 +72,138 @@ int sdk_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex)
 	return 0;
 }
 
+ezdev_sdk_sem sdk_platform_thread_sem_create()
+{
+	sdk_sem_platform *ptr_sem_platform = NULL;
+	pthread_condattr_t attr;
+	ptr_sem_platform = (sdk_sem_platform *)malloc(sizeof(sdk_sem_platform));
+	if (ptr_sem_platform == NULL)
+	{
+		return NULL;
+	}
+
+	/* 按单调时钟计算超时, 不受系统校时影响 */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&ptr_sem_platform->lock, NULL);
+	pthread_cond_init(&ptr_sem_platform->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	ptr_sem_platform->count = 0;
+
+	return (ezdev_sdk_sem)ptr_sem_platform;
+}
+
+void sdk_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem)
+{
+	sdk_sem_platform *ptr_sem_platform = (sdk_sem_platform *)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return;
+	}
+
+	pthread_cond_destroy(&ptr_sem_platform->cond);
+	pthread_mutex_destroy(&ptr_sem_platform->lock);
+
+	free(ptr_sem_platform);
+	ptr_sem_platform = NULL;
+}
+
+int sdk_platform_thread_sem_post(ezdev_sdk_sem ptr_sem)
+{
+	sdk_sem_platform *ptr_sem_platform = (sdk_sem_platform *)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&ptr_sem_platform->lock);
+	ptr_sem_platform->count++;
+	pthread_cond_signal(&ptr_sem_platform->cond);
+	pthread_mutex_unlock(&ptr_sem_platform->lock);
+	return 0;
+}
+
+int sdk_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms)
+{
+	sdk_sem_platform *ptr_sem_platform = (sdk_sem_platform *)ptr_sem;
+	struct timespec deadline;
+	int rv = 0;
+	if (ptr_sem_platform == NULL)
+	{
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&ptr_sem_platform->lock);
+	while (ptr_sem_platform->count == 0 && rv != ETIMEDOUT)
+	{
+		rv = pthread_cond_timedwait(&ptr_sem_platform->cond, &ptr_sem_platform->lock, &deadline);
+	}
+	if (ptr_sem_platform->count == 0)
+	{
+		pthread_mutex_unlock(&ptr_sem_platform->lock);
+		return -1;
+	}
+	ptr_sem_platform->count--;
+	pthread_mutex_unlock(&ptr_sem_platform->lock);
+	return 0;
+}
+
+/**
+ * \brief   微内核后台任务的线程, 分离运行, 任务结束线程即退出
+ */
+typedef struct
+{
+	void (*task)(void *arg);
+	void *arg;
+} sdk_thread_task;
+
+static void *sdk_thread_task_fun(void *aArg)
+{
+	sdk_thread_task task = *(sdk_thread_task *)aArg;
+
+	free(aArg);
+	task.task(task.arg);
+	return NULL;
+}
+
+int sdk_platform_thread_start(void (*task)(void *arg), void *arg)
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+	sdk_thread_task *ptr_task = NULL;
+	int rv = -1;
+
+	ptr_task = (sdk_thread_task *)malloc(sizeof(sdk_thread_task));
+	if (ptr_task == NULL)
+	{
+		return -1;
+	}
+	ptr_task->task = task;
+	ptr_task->arg = arg;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attr, sdk_thread_task_fun, (void *)ptr_task) == 0)
+	{
+		rv = 0;
+	}
+	else
+	{
+		free(ptr_task);
+	}
+	pthread_attr_destroy(&attr);
+	return rv;
+}
+
 int sdk_thread_create(thread_handle *handle)
 {
 	if (handle == NULL)
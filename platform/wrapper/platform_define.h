@@ -31,6 +31,11 @@
 	extern void net_destroy(ezdev_sdk_net_work net_work);                                                                                                              \
 	int net_getsocket(ezdev_sdk_net_work net_work);
 
+/* 可叫醒的等待, 目前只有linux实现 */
+#define NET_WAKEUP_PLATFORM_INTERFACE                                                  \
+	extern ezdev_sdk_kernel_error net_wait(ezdev_sdk_net_work net_work, int timeout_ms); \
+	extern void net_wakeup(ezdev_sdk_net_work net_work);
+
 #define EZDEVSDK_CONFIG_INTERFACE                                                                        \
 	extern int get_devinfo_fromconfig(const char *path, char *devinfo_context, int devinfo_context_len); \
 	extern int set_file_value(const char *path, unsigned char *keyvalue, int keyvalue_size);             \
@@ -51,4 +56,13 @@
 	extern void sdk_platform_thread_mutex_destroy(ezdev_sdk_mutex ptr_mutex); \
 	extern int sdk_platform_thread_mutex_lock(ezdev_sdk_mutex ptr_mutex);     \
 	extern int sdk_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex);
+
+#define SEM_PLATFORM_INTERFACE                                          \
+	extern ezdev_sdk_sem sdk_platform_thread_sem_create();              \
+	extern void sdk_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem); \
+	extern int sdk_platform_thread_sem_post(ezdev_sdk_sem ptr_sem);     \
+	extern int sdk_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms);
+
+#define THREAD_PLATFORM_INTERFACE \
+	extern int sdk_platform_thread_start(void (*task)(void *arg), void *arg);
 #endif //H_PLATFORM_DEFINE_H_
\ No newline at end of file
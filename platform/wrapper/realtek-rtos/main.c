@@ -46,6 +46,8 @@ NET_PLATFORM_INTERFACE
 LOG_PLATFORM_INTERFACE
 TIME_PLATFORM_INTERFACE
 MUTEX_PLATFORM_INTERFACE
+SEM_PLATFORM_INTERFACE
+THREAD_PLATFORM_INTERFACE
 void event_notice_from_sdk_kernel(sdk_kernel_event_type event_type, void* event_context)
 {
  
@@ -471,6 +473,11 @@ void test_task(void *pvParameters)
 	kernel_platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
 	kernel_platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
 	kernel_platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+	kernel_platform_handle.thread_sem_create = sdk_platform_thread_sem_create;
+	kernel_platform_handle.thread_sem_destroy = sdk_platform_thread_sem_destroy;
+	kernel_platform_handle.thread_sem_post = sdk_platform_thread_sem_post;
+	kernel_platform_handle.thread_sem_wait = sdk_platform_thread_sem_wait;
+	kernel_platform_handle.thread_start = sdk_platform_thread_start;
         
         
 	DBG_8195A("\r\n panlong test_task start SDK version:V1.0\r\n");
@@ -55,5 +55,14 @@
 	extern int sdk_platform_thread_mutex_lock(ezdev_sdk_mutex ptr_mutex);	\
 	extern int sdk_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex);
 
+#define SEM_PLATFORM_INTERFACE	\
+	extern ezdev_sdk_sem sdk_platform_thread_sem_create();	\
+	extern void sdk_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem);	\
+	extern int sdk_platform_thread_sem_post(ezdev_sdk_sem ptr_sem);	\
+	extern int sdk_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms);
+
+#define THREAD_PLATFORM_INTERFACE \
+	extern int sdk_platform_thread_start(void (*task)(void *arg), void *arg);
+
 	
 #endif //H_PLATFORM_DEFINE_H_
\ No newline at end of file
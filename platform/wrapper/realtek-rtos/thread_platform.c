@@ -88,6 +88,109 @@ int sdk_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex)
 	return -1;
 }
 
+ezdev_sdk_sem sdk_platform_thread_sem_create()
+{
+	sdk_sem_platform* ptr_sem_platform = NULL;
+	ptr_sem_platform = (sdk_sem_platform*)malloc(sizeof(sdk_sem_platform));
+	if (ptr_sem_platform == NULL)
+	{
+		return NULL;
+	}
+
+	ptr_sem_platform->sem = xSemaphoreCreateCounting(0x7fff, 0);
+	if (ptr_sem_platform->sem == NULL)
+	{
+		free(ptr_sem_platform);
+		ptr_sem_platform = NULL;
+	}
+	return (ezdev_sdk_sem)ptr_sem_platform;
+}
+
+void sdk_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem)
+{
+	sdk_sem_platform* ptr_sem_platform = (sdk_sem_platform*)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return;
+	}
+
+	vSemaphoreDelete(ptr_sem_platform->sem);
+
+	free(ptr_sem_platform);
+	ptr_sem_platform = NULL;
+}
+
+int sdk_platform_thread_sem_post(ezdev_sdk_sem ptr_sem)
+{
+	sdk_sem_platform* ptr_sem_platform = (sdk_sem_platform*)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return -1;
+	}
+
+	if (xSemaphoreGive(ptr_sem_platform->sem) == pdTRUE)
+	{
+		return 0;
+	}
+	return -1;
+}
+
+int sdk_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms)
+{
+	sdk_sem_platform* ptr_sem_platform = (sdk_sem_platform*)ptr_sem;
+	portTickType xTicksToWait = timeout_ms / portTICK_RATE_MS;
+	if (ptr_sem_platform == NULL)
+	{
+		return -1;
+	}
+
+	if (xSemaphoreTake(ptr_sem_platform->sem, xTicksToWait) == pdTRUE)
+	{
+		return 0;
+	}
+	return -1;
+}
+
+/**
+ * \brief   微内核后台任务, 任务结束后删除自身
+ */
+typedef struct
+{
+	void (*task)(void *arg);
+	void *arg;
+} sdk_thread_task;
+
+static void sdk_thread_task_fun(void *aArg)
+{
+	sdk_thread_task task = *(sdk_thread_task *)aArg;
+
+	free(aArg);
+	task.task(task.arg);
+	vTaskDelete(NULL);
+}
+
+int sdk_platform_thread_start(void (*task)(void *arg), void *arg)
+{
+	sdk_thread_task *ptr_task = NULL;
+	uint16_t usTaskStackSize = (configMINIMAL_STACK_SIZE * 20);
+	unsigned portBASE_TYPE uxTaskPriority = uxTaskPriorityGet(NULL);
+
+	ptr_task = (sdk_thread_task *)malloc(sizeof(sdk_thread_task));
+	if (ptr_task == NULL)
+	{
+		return -1;
+	}
+	ptr_task->task = task;
+	ptr_task->arg = arg;
+
+	if (xTaskCreate(sdk_thread_task_fun, "ez_kernel_job", usTaskStackSize, ptr_task, uxTaskPriority, NULL) != pdPASS)
+	{
+		free(ptr_task);
+		return -1;
+	}
+	return 0;
+}
+
 int sdk_thread_create(thread_handle* handle)
 {
 	if (handle == NULL)
@@ -22,6 +22,13 @@ typedef struct
 	pthread_mutex_t lock;
 }sdk_mutex_platform;
 
+typedef struct 
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int count;
+}sdk_sem_platform;
+
 typedef struct thread_handle_platform
 {
 	pthread_t thread_hd;
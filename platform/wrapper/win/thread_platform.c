@@ -102,6 +102,123 @@ int sdk_platform_thread_mutex_unlock(ezdev_sdk_mutex ptr_mutex)
 	return 0;
 }
 
+/** 
+ *  \brief		信号量创建, 初始计数为0
+ *  \method		sdk_platform_thread_sem_create
+ *  \return 	成功返回信号量对象 失败返回NULL
+ */
+ezdev_sdk_sem sdk_platform_thread_sem_create()
+{
+	sdk_sem_platform* ptr_sem_platform = NULL;
+	ptr_sem_platform = (sdk_sem_platform*)malloc(sizeof(sdk_sem_platform));
+	if (ptr_sem_platform == NULL)
+	{
+		return NULL;
+	}
+	ptr_sem_platform->sem = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+	if (ptr_sem_platform->sem == NULL)
+	{
+		free(ptr_sem_platform);
+		return NULL;
+	}
+	return (ezdev_sdk_sem)ptr_sem_platform;
+}
+
+/** 
+ *  \brief		信号量销毁
+ *  \method		sdk_platform_thread_sem_destroy
+ *  \param[in] 	ptr_sem 信号量对象
+ */
+void sdk_platform_thread_sem_destroy(ezdev_sdk_sem ptr_sem)
+{
+	sdk_sem_platform* ptr_sem_platform = (sdk_sem_platform*)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return;
+	}
+	CloseHandle(ptr_sem_platform->sem);
+
+	free(ptr_sem_platform);
+	ptr_sem_platform = NULL;
+}
+
+/** 
+ *  \brief		信号量计数加一
+ *  \method		sdk_platform_thread_sem_post
+ *  \param[in] 	ptr_sem 信号量对象
+ *  \return 	成功返回0 失败返回-1
+ */
+int sdk_platform_thread_sem_post(ezdev_sdk_sem ptr_sem)
+{
+	sdk_sem_platform* ptr_sem_platform = (sdk_sem_platform*)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return -1;
+	}
+	return ReleaseSemaphore(ptr_sem_platform->sem, 1, NULL) ? 0 : -1;
+}
+
+/** 
+ *  \brief		等待信号量
+ *  \method		sdk_platform_thread_sem_wait
+ *  \param[in] 	ptr_sem 信号量对象
+ *  \param[in] 	timeout_ms 最多等待的毫秒数
+ *  \return 	等到返回0 超时或失败返回-1
+ */
+int sdk_platform_thread_sem_wait(ezdev_sdk_sem ptr_sem, EZDEV_SDK_UINT32 timeout_ms)
+{
+	sdk_sem_platform* ptr_sem_platform = (sdk_sem_platform*)ptr_sem;
+	if (ptr_sem_platform == NULL)
+	{
+		return -1;
+	}
+	return WAIT_OBJECT_0 == WaitForSingleObject(ptr_sem_platform->sem, timeout_ms) ? 0 : -1;
+}
+
+typedef struct
+{
+	void (*task)(void *arg);
+	void *arg;
+} sdk_thread_task;
+
+static unsigned int __stdcall sdk_thread_task_fun(void *arg)
+{
+	sdk_thread_task task = *(sdk_thread_task *)arg;
+
+	free(arg);
+	task.task(task.arg);
+	return 0;
+}
+
+/** 
+ *  \brief		启动微内核后台任务的线程, 不等待线程结束
+ *  \method		sdk_platform_thread_start
+ *  \param[in] 	task 任务函数
+ *  \param[in] 	arg 任务参数
+ *  \return 	成功返回0 失败返回-1
+ */
+int sdk_platform_thread_start(void (*task)(void *arg), void *arg)
+{
+	unsigned int threadID = 0;
+	HANDLE thread_hd = NULL;
+	sdk_thread_task* ptr_task = (sdk_thread_task*)malloc(sizeof(sdk_thread_task));
+	if (ptr_task == NULL)
+	{
+		return -1;
+	}
+	ptr_task->task = task;
+	ptr_task->arg = arg;
+
+	thread_hd = (HANDLE)_beginthreadex(NULL, 0, sdk_thread_task_fun, ptr_task, 0, &threadID);
+	if (thread_hd == NULL)
+	{
+		free(ptr_task);
+		return -1;
+	}
+	CloseHandle(thread_hd);
+	return 0;
+}
+
 int sdk_thread_create(thread_handle* handle)
 {
 	unsigned int threadID = 0;
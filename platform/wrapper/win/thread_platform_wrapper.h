@@ -21,6 +21,11 @@ typedef struct
 	CRITICAL_SECTION lock;
 }sdk_mutex_platform;
 
+typedef struct 
+{
+	HANDLE sem;
+}sdk_sem_platform;
+
 typedef struct thread_handle_platform
 {
 	HANDLE thread_hd;
@@ -0,0 +1,253 @@
+/**
+ * \file      bench_bignum.c
+ * \brief     bignum上的ECDH和RSA: 每秒密钥协商次数、RSA-1024运算次数, 以及内层循环与通用实现的对比
+ *
+ * - ECDH: 与LBS交互相同, ezdev_generate_publickey生成P-384密钥对, ezdev_generate_masterkey与固定的对端公钥协商
+ * - RSA-1024: ezRsaEncrypt/ezRsaDecrypt(每次解析16进制密钥, PKCS#1 v1.5), 和不含解析的bscomptls_rsa_public/private
+ * - 384/1024/2048位的乘法和模幂, 库里的实现(汇编, x86-64上CPU支持时走MULX/ADX)与common/bignum_generic.c对比
+ * 第一个参数可以给运行次数的倍数.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "sdk_kernel_def.h"
+#include "mbedtls/bignum.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/rsa.h"
+#include "ezdev_ecdh_support.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel_rng.h"
+#include "bignum_generic.h"
+#include "platform_define.h"
+#include "utils.h"
+#include "test_util.h"
+
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_RNG_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define HEX_MAX     600
+
+typedef int (*mpi_mul_fn)(bscomptls_mpi *X, const bscomptls_mpi *A, const bscomptls_mpi *B);
+typedef int (*mpi_exp_fn)(bscomptls_mpi *X, const bscomptls_mpi *A, const bscomptls_mpi *E, const bscomptls_mpi *N, bscomptls_mpi *RR);
+
+static void platform_init(void)
+{
+    ezdev_sdk_kernel_platform_handle *handle = &g_ezdev_sdk_kernel.platform_handle;
+
+    handle->time_creator = Platform_TimerCreater;
+    handle->time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    handle->time_isexpired = Platform_TimerIsExpired;
+    handle->time_countdownms = Platform_TimerCountdownMS;
+    handle->time_countdown = Platform_TimerCountdown;
+    handle->time_leftms = Platform_TimerLeftMS;
+    handle->time_destroy = Platform_TimeDestroy;
+    handle->time_sleep = sdk_thread_sleep;
+    handle->thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle->thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle->thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle->thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    kernel_timer_service_init();
+    kernel_rng_service_init();
+}
+
+static void report(const char *name, unsigned rounds, uint64_t start, const test_alloc_stat *before)
+{
+    uint64_t elapsed = test_now_ns() - start;
+    test_alloc_stat after;
+
+    test_alloc_snapshot(&after);
+    bench_report(name, rounds, elapsed, after.allocs - before->allocs, 0);
+    printf("%-40s %12.1f ops/s\n", name, rounds * 1e9 / (double)elapsed);
+}
+
+static void bench_ecdh(unsigned rounds)
+{
+    bscomptls_ecdh_context peer;
+    bscomptls_ecdh_context ctx;
+    unsigned char peer_pubkey[ezdev_sdk_ecdh_key_len];
+    unsigned char pubkey[ezdev_sdk_ecdh_key_len];
+    unsigned char masterkey[64];
+    EZDEV_SDK_UINT32 peer_pubkey_len = 0;
+    EZDEV_SDK_UINT32 pubkey_len = 0;
+    EZDEV_SDK_UINT32 masterkey_len = 0;
+    test_alloc_stat before;
+    uint64_t start = 0;
+    unsigned i = 0;
+
+    bscomptls_ecdh_init(&peer);
+    if (mkernel_internal_succ != ezdev_generate_publickey(&peer, peer_pubkey, &peer_pubkey_len))
+    {
+        fprintf(stderr, "ecdh: peer key failed\n");
+        exit(1);
+    }
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        bscomptls_ecdh_init(&ctx);
+        if (mkernel_internal_succ != ezdev_generate_publickey(&ctx, pubkey, &pubkey_len) ||
+            mkernel_internal_succ != ezdev_generate_masterkey(&ctx, peer_pubkey, peer_pubkey_len, masterkey, &masterkey_len))
+        {
+            fprintf(stderr, "ecdh: agreement %u failed\n", i);
+            exit(1);
+        }
+        bscomptls_ecdh_free(&ctx);
+    }
+    report("ecdh p384 key agreement", rounds, start, &before);
+    bscomptls_ecdh_free(&peer);
+}
+
+static void bench_rsa(unsigned rounds)
+{
+    bscomptls_rsa_context rsa;
+    char n[HEX_MAX], e[HEX_MAX], d[HEX_MAX], p[HEX_MAX], q[HEX_MAX];
+    size_t olen = 0;
+    unsigned char plain[32];
+    unsigned char cipher[128];
+    unsigned char out[128];
+    int cipher_len = sizeof(cipher);
+    int out_len = sizeof(out);
+    test_alloc_stat before;
+    uint64_t start = 0;
+    unsigned i = 0;
+
+    bscomptls_rsa_init(&rsa, BSCOMPTLS_RSA_PKCS_V15, 0);
+    if (0 != bscomptls_rsa_gen_key(&rsa, kernel_rng_random, NULL, 1024, 65537) ||
+        0 != bscomptls_mpi_write_string(&rsa.N, 16, n, sizeof(n), &olen) || 0 != bscomptls_mpi_write_string(&rsa.E, 16, e, sizeof(e), &olen) ||
+        0 != bscomptls_mpi_write_string(&rsa.D, 16, d, sizeof(d), &olen) || 0 != bscomptls_mpi_write_string(&rsa.P, 16, p, sizeof(p), &olen) ||
+        0 != bscomptls_mpi_write_string(&rsa.Q, 16, q, sizeof(q), &olen))
+    {
+        fprintf(stderr, "rsa: key generation failed\n");
+        exit(1);
+    }
+    memset(plain, 0x5A, sizeof(plain));
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds * 10; i++)
+    {
+        cipher_len = sizeof(cipher);
+        ezRsaEncrypt(plain, sizeof(plain), cipher, &cipher_len, n, e);
+    }
+    report("rsa1024 ezRsaEncrypt", rounds * 10, start, &before);
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        out_len = sizeof(out);
+        if (0 != ezRsaDecrypt(cipher, cipher_len, out, &out_len, p, q, n, d, e) || sizeof(plain) != out_len)
+        {
+            fprintf(stderr, "rsa: decrypt failed\n");
+            exit(1);
+        }
+    }
+    report("rsa1024 ezRsaDecrypt", rounds, start, &before);
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds * 10; i++)
+    {
+        bscomptls_rsa_public(&rsa, cipher, out);
+    }
+    report("rsa1024 public (e=65537)", rounds * 10, start, &before);
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        bscomptls_rsa_private(&rsa, kernel_rng_random, NULL, cipher, out);
+    }
+    report("rsa1024 private (crt)", rounds, start, &before);
+    bscomptls_rsa_free(&rsa);
+}
+
+static void fill(bscomptls_mpi *X, size_t bits)
+{
+    unsigned char buf[512];
+    size_t i = 0;
+
+    for (i = 0; i < bits / 8; i++)
+    {
+        buf[i] = (unsigned char)test_rand();
+    }
+    buf[0] |= 0x80;
+    buf[bits / 8 - 1] |= 1;
+    bscomptls_mpi_read_binary(X, buf, bits / 8);
+}
+
+static void bench_inner(const char *impl, mpi_mul_fn mul, mpi_exp_fn exp_mod, size_t bits, unsigned rounds)
+{
+    bscomptls_mpi A, B, M, X, RR;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    unsigned i = 0;
+    char name[64];
+
+    bscomptls_mpi_init(&A);
+    bscomptls_mpi_init(&B);
+    bscomptls_mpi_init(&M);
+    bscomptls_mpi_init(&X);
+    bscomptls_mpi_init(&RR);
+    test_rand_seed(bits);
+    fill(&A, bits);
+    fill(&B, bits);
+    fill(&M, bits);
+
+    mul(&X, &A, &B);
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds * 100; i++)
+    {
+        mul(&X, &A, &B);
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "%s mul %zu", impl, bits);
+    bench_report(name, rounds * 100, elapsed, after.allocs - before.allocs, 0);
+
+    exp_mod(&X, &A, &B, &M, &RR);
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds / 4 + 1; i++)
+    {
+        exp_mod(&X, &A, &B, &M, &RR);
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "%s exp_mod %zu", impl, bits);
+    bench_report(name, rounds / 4 + 1, elapsed, after.allocs - before.allocs, 0);
+
+    bscomptls_mpi_free(&A);
+    bscomptls_mpi_free(&B);
+    bscomptls_mpi_free(&M);
+    bscomptls_mpi_free(&X);
+    bscomptls_mpi_free(&RR);
+}
+
+int main(int argc, char **argv)
+{
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    unsigned rounds = (unsigned)(scale * 200) + 1;
+    static const size_t sizes[] = {384, 1024, 2048};
+    size_t i = 0;
+
+    platform_init();
+    printf("bignum limb %zu bits\n", sizeof(bscomptls_mpi_uint) * 8);
+    bench_ecdh(rounds);
+    bench_rsa(rounds);
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        bench_inner("library", bscomptls_mpi_mul_mpi, bscomptls_mpi_exp_mod, sizes[i], rounds);
+        bench_inner("generic", generic_mpi_mul_mpi, generic_mpi_exp_mod, sizes[i], rounds);
+    }
+    kernel_rng_service_fini();
+    kernel_timer_service_fini();
+    return 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * \file      bench_compress.c
+ * \brief     报文压缩(kernel_compress/kernel_decompress)的压缩率、吞吐和分配次数
+ *
+ * 语料仿照实际走DAS的大报文, 用固定种子生成, 每次运行结果相同:
+ * - 物模型属性上报的JSON, 600B/4K/16K
+ * - ISAPI报警列表XML, 16K/250K
+ * - 配置导出的JSON, 16K
+ * - 随机数据和全相同字节, 分别对应不可压缩和极端可压缩
+ * 也可以在命令行上给出抓包得到的报文文件, 逐个测. 压缩输出上限与das_send_pubmsg相同,
+ * 省不到1/16就放弃. 设置EZ_BENCH_LZ4_DUMP=<目录>时把压缩结果写成legacy LZ4 frame,
+ * 可以用`lz4 -d`核对格式.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "base_typedef.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_compress.h"
+#include "test_util.h"
+
+EZDEV_SDK_KERNEL_COMPRESS_INTERFACE
+
+#define CORPUS_MAX  (300 * 1024)
+
+static unsigned char g_src[CORPUS_MAX];
+static unsigned char g_zip[CORPUS_MAX];
+static unsigned char g_out[CORPUS_MAX];
+
+static size_t gen_model_json(char *buf, size_t cap)
+{
+    size_t len = 0;
+    unsigned i = 0;
+
+    len += snprintf(buf + len, cap - len, "{\"data\":{\"props\":[");
+    while (len + 300 < cap)
+    {
+        len += snprintf(buf + len, cap - len, "%s{\"identifier\":\"prop_%u\",\"value\":%u,\"time\":16%08u,\"status\":\"%s\"}",
+                        i ? "," : "", test_rand_below(40), test_rand_below(1000), test_rand_below(100000000),
+                        test_rand_below(2) ? "online" : "normal");
+        i++;
+    }
+    len += snprintf(buf + len, cap - len, "]},\"devSerial\":\"E12345678\",\"version\":\"v3.1.2\"}");
+    return len;
+}
+
+static size_t gen_isapi_xml(char *buf, size_t cap)
+{
+    size_t len = 0;
+
+    len += snprintf(buf + len, cap - len, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><EventNotificationAlertList>");
+    while (len + 400 < cap)
+    {
+        len += snprintf(buf + len, cap - len,
+                        "<EventNotificationAlert><ipAddress>192.168.%u.%u</ipAddress><portNo>80</portNo><channelID>%u</channelID>"
+                        "<dateTime>2021-0%u-1%uT1%u:%02u:%02u+08:00</dateTime><eventType>VMD</eventType><eventState>active</eventState>"
+                        "<eventDescription>Motion alarm</eventDescription></EventNotificationAlert>",
+                        test_rand_below(255), test_rand_below(255), test_rand_below(16), 1 + test_rand_below(9),
+                        test_rand_below(10), test_rand_below(10), test_rand_below(60), test_rand_below(60));
+    }
+    len += snprintf(buf + len, cap - len, "</EventNotificationAlertList>");
+    return len;
+}
+
+static size_t gen_config_json(char *buf, size_t cap)
+{
+    size_t len = 0;
+
+    while (len + 100 < cap)
+    {
+        len += snprintf(buf + len, cap - len, "{\"key\":\"cfg.item.%u\",\"enable\":%s,\"schedule\":[\"00:00-24:00\"],\"level\":%u},",
+                        test_rand_below(500), test_rand_below(2) ? "true" : "false", test_rand_below(5));
+    }
+    return len;
+}
+
+/**
+ * \brief   写成legacy LZ4 frame(魔数0x184C2102, 4字节块长, 块数据), 供lz4命令行核对
+ */
+static void dump_lz4(const char *name, EZDEV_SDK_UINT32 len, EZDEV_SDK_UINT32 zip_len)
+{
+    const char *dir = getenv("EZ_BENCH_LZ4_DUMP");
+    unsigned char head[8] = {0x02, 0x21, 0x4C, 0x18};
+    char file[64];
+    char path[512];
+    FILE *fp = NULL;
+    size_t i = 0;
+
+    if (NULL == dir)
+    {
+        return;
+    }
+    snprintf(file, sizeof(file), "%s", name);
+    for (i = 0; file[i] != '\0'; i++)
+    {
+        file[i] = (' ' == file[i]) ? '_' : file[i];
+    }
+    head[4] = (unsigned char)zip_len;
+    head[5] = (unsigned char)(zip_len >> 8);
+    head[6] = (unsigned char)(zip_len >> 16);
+    head[7] = (unsigned char)(zip_len >> 24);
+    snprintf(path, sizeof(path), "%s/%s.lz4", dir, file);
+    if (NULL != (fp = fopen(path, "wb")))
+    {
+        fwrite(head, 1, sizeof(head), fp);
+        fwrite(g_zip, 1, zip_len, fp);
+        fclose(fp);
+    }
+    snprintf(path, sizeof(path), "%s/%s.raw", dir, file);
+    if (NULL != (fp = fopen(path, "wb")))
+    {
+        fwrite(g_src, 1, len, fp);
+        fclose(fp);
+    }
+}
+
+static void bench_one(const char *name, EZDEV_SDK_UINT32 len, double scale)
+{
+    test_alloc_stat before;
+    test_alloc_stat after;
+    EZDEV_SDK_UINT32 zip_len = 0;
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    unsigned rounds = (unsigned)(scale * (len >= 100000 ? 200 : 2000)) + 1;
+    unsigned i = 0;
+    char label[96];
+
+    /* 与发送路径相同: 输出上限是原长减1/16 */
+    if (mkernel_internal_succ != kernel_compress(g_src, len, g_zip, len - len / 16, &zip_len))
+    {
+        printf("%-24s %7u bytes, incompressible, sent as is\n", name, len);
+        test_alloc_snapshot(&before);
+        start = test_now_ns();
+        for (i = 0; i < rounds; i++)
+        {
+            kernel_compress(g_src, len, g_zip, len - len / 16, &zip_len);
+        }
+        elapsed = test_now_ns() - start;
+        test_alloc_snapshot(&after);
+        snprintf(label, sizeof(label), "%s give up", name);
+        bench_report(label, rounds, elapsed, after.allocs - before.allocs, (uint64_t)len * rounds);
+        return;
+    }
+    if (mkernel_internal_succ != kernel_decompress(g_zip, zip_len, g_out, len) || 0 != memcmp(g_out, g_src, len))
+    {
+        fprintf(stderr, "%s: round trip failed\n", name);
+        exit(1);
+    }
+    dump_lz4(name, len, zip_len);
+    printf("%-24s %7u -> %6u bytes, ratio %.1fx\n", name, len, zip_len, (double)len / zip_len);
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        kernel_compress(g_src, len, g_zip, len - len / 16, &zip_len);
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(label, sizeof(label), "%s compress", name);
+    bench_report(label, rounds, elapsed, after.allocs - before.allocs, (uint64_t)len * rounds);
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        kernel_decompress(g_zip, zip_len, g_out, len);
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(label, sizeof(label), "%s decompress", name);
+    bench_report(label, rounds, elapsed, after.allocs - before.allocs, (uint64_t)len * rounds);
+}
+
+static void bench_file(const char *path, double scale)
+{
+    FILE *fp = fopen(path, "rb");
+    size_t len = 0;
+    const char *name = strrchr(path, '/');
+
+    if (NULL == fp)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return;
+    }
+    len = fread(g_src, 1, sizeof(g_src), fp);
+    fclose(fp);
+    bench_one(name ? name + 1 : path, (EZDEV_SDK_UINT32)len, scale);
+}
+
+int main(int argc, char **argv)
+{
+    double scale = 1.0;
+    unsigned i = 0;
+    int arg = 1;
+
+    if (arg < argc && strspn(argv[arg], "0123456789.") == strlen(argv[arg]))
+    {
+        scale = atof(argv[arg++]);
+    }
+    if (arg < argc)
+    {
+        for (; arg < argc; arg++)
+        {
+            bench_file(argv[arg], scale);
+        }
+        return 0;
+    }
+
+    test_rand_seed(1);
+    bench_one("model json 600", (EZDEV_SDK_UINT32)gen_model_json((char *)g_src, 600), scale);
+    bench_one("model json 4K", (EZDEV_SDK_UINT32)gen_model_json((char *)g_src, 4000), scale);
+    bench_one("model json 16K", (EZDEV_SDK_UINT32)gen_model_json((char *)g_src, 16000), scale);
+    bench_one("isapi xml 16K", (EZDEV_SDK_UINT32)gen_isapi_xml((char *)g_src, 16000), scale);
+    bench_one("isapi xml 250K", (EZDEV_SDK_UINT32)gen_isapi_xml((char *)g_src, 250000), scale);
+    bench_one("config json 16K", (EZDEV_SDK_UINT32)gen_config_json((char *)g_src, 16000), scale);
+    for (i = 0; i < 16000; i++)
+    {
+        g_src[i] = (unsigned char)test_rand();
+    }
+    bench_one("random 16K", 16000, scale);
+    memset(g_src, 'a', 16000);
+    bench_one("same byte 16K", 16000, scale);
+    return 0;
+}
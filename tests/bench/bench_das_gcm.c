@@ -0,0 +1,206 @@
+/**
+ * \file      bench_das_gcm.c
+ * \brief     DAS报文加解密吞吐: 固定IV的CBC加补齐对比GCM
+ *
+ * 用法: bench_das_gcm [倍数]
+ * 组包加密(das_payload_encrypt)和原地解密(das_payload_open)都是das_transport.c里的静态函数, 这里直接把源文件包含进来测.
+ * - seal行: 通用协议头加业务数据组包、分配一次内存并原地加密, 每轮释放
+ * - open行: 接收缓冲区内原地解密并校验(CBC查补齐, GCM查防重放窗口和tag). 解密会覆盖密文,
+ *   每轮先把密文拷进接收缓冲区, GCM再清空防重放窗口, 这两步两种方式都算在内
+ * - 业务数据64B到64KB, MB/s按明文(通用协议头加业务数据)计
+ * - 计时前每种方式先加解密一遍比对明文: CBC和GCM下行用das_payload_open解, GCM上行用上行iv单独验tag再解
+ */
+#include "das_transport.c"
+#include "test_util.h"
+
+#define BYTE_BUDGET     (256ULL * 1024 * 1024)
+#define BODY_MAX        (64 * 1024)
+
+static const unsigned int g_sizes[] = {64, 256, 1024, 4096, 16384, 65536};
+static const char g_common[] = "{\"Seq\":1234,\"CmdVer\":\"v1.0.0\"}";
+static const unsigned char g_key[ezdev_sdk_sessionkey_len] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe,
+                                                              0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+
+static ezdev_sdk_kernel g_bench_kernel;
+static das_gcm_state g_bench_down;
+static unsigned char g_body[BODY_MAX];
+static unsigned char g_work[BODY_MAX + 256];
+
+/**
+ * \brief   按平台发往设备的方向组一个GCM下行报文, 与das_payload_encrypt的上行只差iv
+ */
+static unsigned char *seal_down(unsigned int body_len, EZDEV_SDK_UINT32 *payload_len)
+{
+    EZDEV_SDK_UINT32 plain_len = 2 + (EZDEV_SDK_UINT32)strlen(g_common) + body_len;
+    unsigned char *buf = (unsigned char *)malloc(ezdev_sdk_das_gcm_seq_len + plain_len + ezdev_sdk_das_gcm_tag_len);
+    unsigned char *plain = buf + ezdev_sdk_das_gcm_seq_len;
+    unsigned char nonce[das_gcm_iv_len];
+
+    das_gcm_prepare(&g_bench_down, g_key);
+    memset(buf, 0x5a, das_gcm_salt_len);
+    memset(buf + das_gcm_salt_len, 0, 4);
+    serialize_short(plain, (EZDEV_SDK_UINT16)strlen(g_common));
+    memcpy(plain + 2, g_common, strlen(g_common));
+    memcpy(plain + 2 + strlen(g_common), g_body, body_len);
+    das_gcm_nonce(g_bench_down.iv_down, buf, nonce);
+    bscomptls_gcm_crypt_and_tag(&g_bench_down.ctx, BSCOMPTLS_GCM_ENCRYPT, plain_len, nonce, das_gcm_iv_len, NULL, 0,
+                                plain, plain, ezdev_sdk_das_gcm_tag_len, plain + plain_len);
+    *payload_len = ezdev_sdk_das_gcm_seq_len + plain_len + ezdev_sdk_das_gcm_tag_len;
+    return buf;
+}
+
+static int plain_matches(const unsigned char *plain, EZDEV_SDK_UINT32 plain_len, unsigned int body_len)
+{
+    EZDEV_SDK_UINT16 common_len = 0;
+    EZDEV_SDK_UINT32 located_len = 0;
+
+    if (mkernel_internal_succ != das_payload_locate((unsigned char *)plain, plain_len, &common_len, &located_len))
+    {
+        return 0;
+    }
+    return common_len == strlen(g_common) && 0 == memcmp(plain + 2, g_common, common_len) && located_len == body_len &&
+           0 == memcmp(plain + 2 + common_len, g_body, body_len);
+}
+
+/**
+ * \brief   上行报文用上行iv验tag并解密
+ */
+static int gcm_uplink_matches(const unsigned char *payload, EZDEV_SDK_UINT32 payload_len, unsigned int body_len)
+{
+    EZDEV_SDK_UINT32 plain_len = payload_len - ezdev_sdk_das_gcm_seq_len - ezdev_sdk_das_gcm_tag_len;
+    const unsigned char *cipher = payload + ezdev_sdk_das_gcm_seq_len;
+    unsigned char nonce[das_gcm_iv_len];
+
+    das_gcm_nonce(g_das_gcm.iv_up, payload, nonce);
+    if (0 != bscomptls_gcm_auth_decrypt(&g_das_gcm.ctx, plain_len, nonce, das_gcm_iv_len, NULL, 0, cipher + plain_len,
+                                        ezdev_sdk_das_gcm_tag_len, cipher, g_work))
+    {
+        return 0;
+    }
+    return plain_matches(g_work, plain_len, body_len);
+}
+
+static int check_cipher(int gcm, unsigned int body_len)
+{
+    unsigned char *payload = NULL;
+    unsigned char *plain = NULL;
+    EZDEV_SDK_UINT32 payload_len = 0;
+    EZDEV_SDK_UINT32 plain_len = 0;
+    int ok = 0;
+
+    if (mkernel_internal_succ != das_payload_encrypt(&g_bench_kernel, (const unsigned char *)g_common, (EZDEV_SDK_UINT16)strlen(g_common),
+                                                     g_body, body_len, &payload, &payload_len))
+    {
+        return 0;
+    }
+    if (gcm)
+    {
+        ok = gcm_uplink_matches(payload, payload_len, body_len);
+        free(payload);
+        payload = seal_down(body_len, &payload_len);
+        memset(&g_bench_down.recv, 0, sizeof(g_bench_down.recv));
+    }
+    else
+    {
+        ok = 1;
+    }
+    memcpy(g_work, payload, payload_len);
+    ok = ok && mkernel_internal_succ == das_payload_open(&g_bench_kernel, g_key, &g_bench_down, g_work, payload_len, &plain, &plain_len) &&
+         plain_matches(plain, plain_len, body_len);
+    free(payload);
+    return ok;
+}
+
+static void bench_cipher(int gcm, unsigned int body_len, uint64_t scale)
+{
+    const char *mode = gcm ? "gcm" : "cbc";
+    char name[64];
+    unsigned char *payload = NULL;
+    unsigned char *plain = NULL;
+    EZDEV_SDK_UINT32 payload_len = 0;
+    EZDEV_SDK_UINT32 plain_len = 0;
+    EZDEV_SDK_UINT32 common_len = (EZDEV_SDK_UINT32)strlen(g_common);
+    uint64_t rounds = scale * BYTE_BUDGET / (uint64_t)(body_len + 256);
+    uint64_t bytes = rounds * (uint64_t)(2 + common_len + body_len);
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t r = 0;
+    int failures = 0;
+
+    g_bench_kernel.redirect_das_info.das_cipher = gcm ? ezdev_sdk_das_cipher_gcm : ezdev_sdk_das_cipher_cbc;
+    if (!check_cipher(gcm, body_len))
+    {
+        printf("%s/%u: round trip failed, not timed\n", mode, body_len);
+        return;
+    }
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        failures += mkernel_internal_succ != das_payload_encrypt(&g_bench_kernel, (const unsigned char *)g_common, (EZDEV_SDK_UINT16)common_len,
+                                                                 g_body, body_len, &payload, &payload_len);
+        free(payload);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "seal/%s/%u", mode, body_len);
+    bench_report(name, rounds, start, after.allocs - before.allocs, bytes);
+
+    if (gcm)
+    {
+        payload = seal_down(body_len, &payload_len);
+    }
+    else
+    {
+        das_payload_encrypt(&g_bench_kernel, (const unsigned char *)g_common, (EZDEV_SDK_UINT16)common_len, g_body, body_len, &payload, &payload_len);
+    }
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        memcpy(g_work, payload, payload_len);
+        if (gcm)
+        {
+            memset(&g_bench_down.recv, 0, sizeof(g_bench_down.recv));
+        }
+        failures += mkernel_internal_succ != das_payload_open(&g_bench_kernel, g_key, &g_bench_down, g_work, payload_len, &plain, &plain_len);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "open/%s/%u", mode, body_len);
+    bench_report(name, rounds, start, after.allocs - before.allocs, bytes);
+    free(payload);
+
+    if (failures > 0)
+    {
+        printf("%s/%u: %d calls failed\n", mode, body_len, failures);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t scale = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    size_t i = 0;
+
+    if (0 == scale)
+    {
+        scale = 1;
+    }
+    memcpy(g_bench_kernel.session_key, g_key, sizeof(g_key));
+    test_rand_seed(33);
+    for (i = 0; i < sizeof(g_body); i++)
+    {
+        g_body[i] = (unsigned char)test_rand_below(256);
+    }
+
+    for (i = 0; i < sizeof(g_sizes) / sizeof(g_sizes[0]); i++)
+    {
+        bench_cipher(0, g_sizes[i], scale);
+        bench_cipher(1, g_sizes[i], scale);
+    }
+    das_gcm_fini(&g_das_gcm);
+    das_gcm_fini(&g_bench_down);
+    return 0;
+}
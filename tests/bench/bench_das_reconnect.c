@@ -0,0 +1,320 @@
+/**
+ * \file      bench_das_reconnect.c
+ * \brief     DAS重连时发出第一条消息前的往返次数和耗时, 对着DAS替身测
+ *
+ * 替身每收到一批报文先等delay_ms再处理, 模拟网络往返; 同一次发送里连续到达的报文算一批,
+ * 第一个PUBLISH所在的批次减1就是它之前的往返次数. 场景:
+ * - MQTT客户端直接连替身: 原来的CONNECT等CONNACK后两次MQTTSubscribe各等SUBACK,
+ *   MQTTConnectSubscribe完整注册, 轻注册会话还在/会话丢失
+ * - 微内核走快速上线连到替身, 替身断开连接后重连, 会话还在/会话丢失
+ * 每个场景一个子进程. 参数: [delay_ms] [重连次数], 默认50ms和20次.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "MQTTClient.h"
+#include "platform_define.h"
+#include "standin_das.h"
+#include "standin_kernel.h"
+#include "test_util.h"
+
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+NET_PLATFORM_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define WAIT_MS     5000
+#define BUF_INIT    (2 * 1024)
+#define BUF_MAX     (16 * 1024)
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+
+typedef enum
+{
+    path_sequential,        ///<    CONNECT等CONNACK, 再逐个SUBSCRIBE等SUBACK
+    path_pipelined,         ///<    MQTTConnectSubscribe, 完整注册
+    path_light,             ///<    MQTTConnectSubscribe, 轻注册沿用会话
+} connect_path;
+
+typedef struct
+{
+    int rounds;
+    int round_trips;
+    int subscribes;
+    uint64_t elapsed_ns;
+} reconnect_result;
+
+static void print_result(const char *name, const reconnect_result *result)
+{
+    if (0 == result->rounds)
+    {
+        printf("%-34s no reconnect measured\n", name);
+        return;
+    }
+    printf("%-34s %3d reconnects, round trips before first publish %.2f, subscribes %.2f, %.1f ms\n", name, result->rounds,
+           (double)result->round_trips / result->rounds, (double)result->subscribes / result->rounds,
+           result->elapsed_ns / 1e6 / result->rounds);
+}
+
+/**
+ * \brief   等替身收到当前连接上的第一个PUBLISH
+ */
+static int wait_first_publish(standin_das *das, standin_das_stats *stats)
+{
+    int waited = 0;
+
+    for (waited = 0; waited < WAIT_MS; waited++)
+    {
+        standin_das_get_stats(das, stats);
+        if (0 != stats->first_publish_read)
+        {
+            return 0;
+        }
+        usleep(1000);
+    }
+    return -1;
+}
+
+static void message_arrived(MessageData *md)
+{
+}
+
+static void client_platform_init(void)
+{
+    g_ezdev_sdk_kernel.platform_handle.net_work_create = net_create;
+    g_ezdev_sdk_kernel.platform_handle.net_work_connect = net_connect;
+    g_ezdev_sdk_kernel.platform_handle.net_work_read = net_read;
+    g_ezdev_sdk_kernel.platform_handle.net_work_write = net_write;
+    g_ezdev_sdk_kernel.platform_handle.net_work_disconnect = net_disconnect;
+    g_ezdev_sdk_kernel.platform_handle.net_work_destroy = net_destroy;
+    g_ezdev_sdk_kernel.platform_handle.net_work_getsocket = net_getsocket;
+    g_ezdev_sdk_kernel.platform_handle.time_creator = Platform_TimerCreater;
+    g_ezdev_sdk_kernel.platform_handle.time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    g_ezdev_sdk_kernel.platform_handle.time_isexpired = Platform_TimerIsExpired;
+    g_ezdev_sdk_kernel.platform_handle.time_countdownms = Platform_TimerCountdownMS;
+    g_ezdev_sdk_kernel.platform_handle.time_countdown = Platform_TimerCountdown;
+    g_ezdev_sdk_kernel.platform_handle.time_leftms = Platform_TimerLeftMS;
+    g_ezdev_sdk_kernel.platform_handle.time_destroy = Platform_TimeDestroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_create = sdk_platform_thread_mutex_create;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    kernel_timer_service_init();
+}
+
+/**
+ * \brief   一次上线: 建TCP连接, 按path握手和订阅, 然后发一条QoS0消息
+ */
+static int client_connect_publish(MQTTClient *client, Network *network, int port, connect_path path)
+{
+    MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+    MQTTSubscribeOptions subs;
+    MQTTMessage message;
+    unsigned char session_present = 0;
+    char payload[] = "{}";
+
+    MQTTNetInit(network);
+    if (mkernel_internal_succ != MQTTNetConnect(network, "127.0.0.1", port))
+    {
+        return -1;
+    }
+
+    data.MQTTVersion = 4;
+    data.keepAliveInterval = 60;
+    data.cleansession = (path_light == path) ? 0 : 1;
+    data.username.cstring = STANDIN_KERNEL_SERIAL;
+    data.password.cstring = "test";
+    if (path_sequential == path)
+    {
+        if (SUCCESS != MQTTConnect(client, &data) ||
+            SUCCESS != MQTTSubscribe(client, "/iot/" STANDIN_KERNEL_SERIAL "/#", QOS1, message_arrived) ||
+            SUCCESS != MQTTSubscribe(client, "/" STANDIN_KERNEL_SERIAL "/#", QOS1, message_arrived))
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        memset(&subs, 0, sizeof(subs));
+        subs.topicFilters[subs.count] = "/iot/" STANDIN_KERNEL_SERIAL "/#";
+        subs.qos[subs.count] = QOS1;
+        subs.handlers[subs.count++] = message_arrived;
+        subs.topicFilters[subs.count] = "/" STANDIN_KERNEL_SERIAL "/#";
+        subs.qos[subs.count] = QOS1;
+        subs.handlers[subs.count++] = message_arrived;
+        /* 和das_mqttlogin2das一样, 上次订阅成功才沿用会话 */
+        subs.reuseSession = (path_light == path) && MQTT_SUBACK_GRANTED == client->suback_state;
+        if (SUCCESS != MQTTConnectSubscribe(client, &data, &subs, &session_present))
+        {
+            return -1;
+        }
+    }
+
+    memset(&message, 0, sizeof(message));
+    message.qos = QOS0;
+    message.payload = payload;
+    message.payloadlen = 2;
+    return SUCCESS == MQTTPublish(client, "/iot/" STANDIN_KERNEL_SERIAL "/global/0-global/standin/event/report", &message) ? 0 : -1;
+}
+
+static void client_case(const char *name, connect_path path, int session_present, int delay_ms, int rounds)
+{
+    standin_das *das = standin_das_start(STANDIN_CIPHER_CBC, g_key);
+    standin_das_stats stats;
+    reconnect_result result;
+    MQTTClient client;
+    Network network;
+    uint64_t start = 0;
+    int i = 0;
+
+    memset(&result, 0, sizeof(result));
+    client_platform_init();
+    MQTTClientInitGrowable(&client, &network, 6 * 1000, BUF_INIT, BUF_MAX, BUF_INIT, BUF_MAX, 30 * 1000);
+    standin_das_set_session_present(das, session_present);
+
+    /* 第一次上线不计, 轻注册要先有一次成功的订阅 */
+    for (i = 0; i <= rounds; i++)
+    {
+        standin_das_set_delay(das, i > 0 ? delay_ms : 0);
+        start = test_now_ns();
+        if (0 != client_connect_publish(&client, &network, standin_das_port(das), path) || 0 != wait_first_publish(das, &stats))
+        {
+            fprintf(stderr, "%s: connect %d failed\n", name, i);
+            break;
+        }
+        if (path_light == path && 0 == i)
+        {
+            /* SUBACK在后台处理, 这里把它收下来 */
+            MQTTYield(&client, delay_ms + 100);
+        }
+        if (i > 0)
+        {
+            result.rounds++;
+            result.round_trips += stats.first_publish_read - 1;
+            result.subscribes += stats.conn_subscribes;
+            result.elapsed_ns += test_now_ns() - start;
+        }
+        MQTTDisconnect(&client);
+        MQTTNetDisconnect(&network);
+        MQTTNetFini(&network);
+    }
+    print_result(name, &result);
+    MQTTClientFini(&client);
+    standin_das_stop(das);
+}
+
+/**
+ * \brief   微内核连着替身, 替身断开后等它重连, 重连一上来就发一条消息
+ */
+static void kernel_case(const char *name, int session_present, int delay_ms, int rounds)
+{
+    standin_das *das = standin_das_start(STANDIN_CIPHER_CBC, g_key);
+    standin_kernel_config config;
+    standin_das_stats stats;
+    reconnect_result result;
+    standin_msg msg;
+    uint64_t start = 0;
+    int i = 0;
+
+    memset(&result, 0, sizeof(result));
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = STANDIN_CIPHER_CBC;
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    standin_das_set_session_present(das, session_present);
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS) ||
+        0 != standin_kernel_send("event", "report", "{}", 2, 0) || 0 != wait_first_publish(das, &stats))
+    {
+        fprintf(stderr, "%s: kernel did not come online\n", name);
+        standin_das_stop(das);
+        return;
+    }
+    standin_das_set_delay(das, delay_ms);
+
+    for (i = 0; i < rounds; i++)
+    {
+        standin_das_drop(das);
+        if (0 != standin_das_wait_connects(das, i + 2, WAIT_MS))
+        {
+            fprintf(stderr, "%s: no reconnect in round %d\n", name, i);
+            break;
+        }
+        start = test_now_ns();
+        standin_kernel_send("event", "report", "{}", 2, (unsigned int)i);
+        if (0 != wait_first_publish(das, &stats))
+        {
+            fprintf(stderr, "%s: no publish in round %d\n", name, i);
+            break;
+        }
+        result.rounds++;
+        result.round_trips += stats.first_publish_read - 1;
+        result.subscribes += stats.conn_subscribes;
+        result.elapsed_ns += test_now_ns() - start;
+        while (0 == standin_das_pop(das, &msg, 0))
+        {
+            standin_msg_free(&msg);
+        }
+    }
+    print_result(name, &result);
+    standin_kernel_stop();
+    standin_das_stop(das);
+}
+
+typedef struct
+{
+    const char *name;
+    int kernel;
+    connect_path path;
+    int session_present;
+} bench_case;
+
+static const bench_case g_cases[] = {
+    {"client: connect + 2x subscribe", 0, path_sequential, 0},
+    {"client: full reg, pipelined", 0, path_pipelined, 0},
+    {"client: light reg, session present", 0, path_light, 1},
+    {"client: light reg, session lost", 0, path_light, 0},
+    {"kernel: reconnect, session present", 1, path_light, 1},
+    {"kernel: reconnect, session lost", 1, path_light, 0},
+};
+
+int main(int argc, char **argv)
+{
+    int delay_ms = argc > 1 ? atoi(argv[1]) : 50;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    size_t i = 0;
+    pid_t pid = 0;
+    int status = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    printf("stand-in delay %d ms per batch, %d reconnects per case\n", delay_ms, rounds);
+    fflush(stdout);
+    for (i = 0; i < sizeof(g_cases) / sizeof(g_cases[0]); i++)
+    {
+        pid = fork();
+        if (0 == pid)
+        {
+            if (g_cases[i].kernel)
+            {
+                kernel_case(g_cases[i].name, g_cases[i].session_present, delay_ms, rounds);
+            }
+            else
+            {
+                client_case(g_cases[i].name, g_cases[i].path, g_cases[i].session_present, delay_ms, rounds);
+            }
+            fflush(stdout);
+            _exit(0);
+        }
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || 0 != WEXITSTATUS(status))
+        {
+            fprintf(stderr, "%s: failed, status 0x%x\n", g_cases[i].name, status);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+/**
+ * \file      bench_das_recv.c
+ * \brief     每条下行消息在接收路径上拷贝的字节数和耗时, 借用与保留对比, CBC和GCM
+ *
+ * 微内核走快速上线连到DAS替身, 先收一条正常下行确认会话密钥和GCM状态都就绪, 然后暂停微内核线程,
+ * 替身只组包不发送(standin_das_seal), 测试线程把报文装进[79字节头][MQTT PUBLISH]的接收缓冲区,
+ * 调ezDevSDK_parse_wifi_publish_msg走同步路由(das_message_receive_ex):
+ * - borrow: 领域回调直接读原地解密后的业务数据, 回调返回即结束
+ * - retain: 回调里ezdev_sdk_kernel_submsg_retain留下消息再释放, 借用的缓冲区要拷贝一次
+ * - before: 原来的做法, 在测试里按同样的报文重写: 解密到新分配的缓冲区, 业务数据memmove到开头,
+ *   再拷贝一份放进队列消息. 没有解析通用协议体, 耗时比原来的实际路径略低
+ * 每条消息都先把报文拷进接收缓冲区(相当于从网络读入), 三种做法都有这一步, 不计入拷贝字节.
+ * 拷贝字节数按接收路径上申请的内存计, 每次分配都是为了装一份拷贝, before里的memmove没有算进去.
+ * GCM报文带计数不能重复使用, 每批先组好再计时. 每种加密方式一个子进程. 参数: [倍数]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+#include "MQTTPacket.h"
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel.h"
+#include "standin_das.h"
+#include "standin_kernel.h"
+#include "test_util.h"
+
+#define WAIT_MS         5000
+#define BENCH_DOMAIN    4242
+#define BENCH_CMD       17
+#define BATCH           64
+#define BYTES_BUDGET    (64ULL * 1024 * 1024)
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+static const size_t g_sizes[] = {256, 4096, 65536};
+
+typedef enum
+{
+    mode_borrow,
+    mode_retain,
+    mode_before,
+} recv_mode;
+
+static const char *g_mode_names[] = {"borrow", "retain", "before"};
+
+static recv_mode g_mode = mode_borrow;
+static const unsigned char *g_expect = NULL;
+static size_t g_expect_len = 0;
+static uint64_t g_delivered = 0;
+static uint64_t g_mismatches = 0;
+
+/**
+ * \brief   原来的做法用的密钥, 和替身一样直接调bscomptls
+ */
+static bscomptls_aes_context g_aes_dec;
+static bscomptls_gcm_context g_gcm;
+static unsigned char g_iv_down[12];
+
+static void body_check(const unsigned char *body, size_t body_len)
+{
+    g_delivered++;
+    if (body_len != g_expect_len || 0 != memcmp(body, g_expect, body_len))
+    {
+        g_mismatches++;
+    }
+}
+
+static void data_route(ezdev_sdk_kernel_submsg *ptr_submsg, EZDEV_SDK_PTR pUser)
+{
+    void *kept = NULL;
+
+    if (mode_retain == g_mode)
+    {
+        kept = ezdev_sdk_kernel_submsg_retain(ptr_submsg);
+        body_check((const unsigned char *)kept, ptr_submsg->buf_len);
+        ezdev_sdk_kernel_submsg_release(kept);
+        return;
+    }
+    body_check((const unsigned char *)ptr_submsg->buf, ptr_submsg->buf_len);
+}
+
+static void extend_start(EZDEV_SDK_PTR pUser)
+{
+}
+
+static void extend_stop(EZDEV_SDK_PTR pUser)
+{
+}
+
+static void extend_event(ezdev_sdk_kernel_event *ptr_event, EZDEV_SDK_PTR pUser)
+{
+}
+
+static void keys_setup(void)
+{
+    static const char label[] = "ezDevSDK das gcm";
+    unsigned char material[sizeof(label) - 1 + 16];
+    unsigned char digest[32];
+
+    memcpy(material, label, sizeof(label) - 1);
+    memcpy(material + sizeof(label) - 1, g_key, 16);
+    bscomptls_sha256(material, sizeof(material), digest, 0);
+    memcpy(g_iv_down, digest + 12, 12);
+    bscomptls_aes_init(&g_aes_dec);
+    bscomptls_aes_setkey_dec(&g_aes_dec, g_key, 128);
+    bscomptls_gcm_init(&g_gcm);
+    bscomptls_gcm_setkey(&g_gcm, BSCOMPTLS_CIPHER_ID_AES, g_key, 128);
+}
+
+/**
+ * \brief   原来的接收路径: 解密到新缓冲区, 定位后memmove, 再拷贝给队列消息
+ */
+static void receive_before(unsigned char *frame, size_t frame_len, int cipher)
+{
+    MQTTString topic = MQTTString_initializer;
+    unsigned char dup = 0;
+    unsigned char retained = 0;
+    unsigned short id = 0;
+    unsigned char *payload = NULL;
+    unsigned char *plain = NULL;
+    unsigned char *copy = NULL;
+    unsigned char iv[16];
+    unsigned char nonce[12];
+    int payload_len = 0;
+    int qos = 0;
+    size_t plain_len = 0;
+    size_t common_len = 0;
+    size_t body_len = 0;
+    size_t i = 0;
+
+    if (1 != MQTTDeserialize_publish(&dup, &qos, &retained, &id, &topic, &payload, &payload_len,
+                                     frame + ezdev_sdk_tcp_header_len, (int)(frame_len - ezdev_sdk_tcp_header_len)))
+    {
+        return;
+    }
+    plain = malloc((size_t)payload_len);
+    if (STANDIN_CIPHER_GCM == cipher)
+    {
+        plain_len = (size_t)payload_len - STANDIN_GCM_SEQ_LEN - STANDIN_GCM_TAG_LEN;
+        for (i = 0; i < 12; i++)
+        {
+            nonce[i] = g_iv_down[i] ^ payload[i];
+        }
+        if (0 != bscomptls_gcm_auth_decrypt(&g_gcm, plain_len, nonce, 12, NULL, 0, payload + payload_len - STANDIN_GCM_TAG_LEN, STANDIN_GCM_TAG_LEN,
+                                            payload + STANDIN_GCM_SEQ_LEN, plain))
+        {
+            free(plain);
+            return;
+        }
+    }
+    else
+    {
+        memset(iv, 0, sizeof(iv));
+        for (i = 0; i < 8; i++)
+        {
+            iv[i] = (unsigned char)(0x30 + i);
+        }
+        bscomptls_aes_crypt_cbc(&g_aes_dec, BSCOMPTLS_AES_DECRYPT, (size_t)payload_len, iv, payload, plain);
+        plain_len = (size_t)payload_len - plain[payload_len - 1];
+    }
+    common_len = ((size_t)plain[0] << 8) | plain[1];
+    body_len = plain_len - 2 - common_len;
+    memmove(plain, plain + 2 + common_len, body_len);
+
+    copy = malloc(body_len + 1);
+    memcpy(copy, plain, body_len);
+    copy[body_len] = '\0';
+    free(plain);
+    body_check(copy, body_len);
+    free(copy);
+}
+
+/**
+ * \brief   组一批报文: [79字节头][MQTT PUBLISH], v2 topic /{序列号}/{领域}/{指令}
+ */
+static int seal_batch(standin_das *das, const unsigned char *body, size_t body_len, unsigned char **frames, size_t *frame_lens, size_t frame_max, unsigned int seq)
+{
+    char topic_buf[64];
+    char common[64];
+    MQTTString topic = MQTTString_initializer;
+    unsigned char *payload = NULL;
+    size_t payload_len = 0;
+    int i = 0;
+    int len = 0;
+
+    snprintf(topic_buf, sizeof(topic_buf), "/%s/%d/%d", STANDIN_KERNEL_SERIAL, BENCH_DOMAIN, BENCH_CMD);
+    topic.cstring = topic_buf;
+    for (i = 0; i < BATCH; i++)
+    {
+        snprintf(common, sizeof(common), "{\"Seq\":%u,\"CmdVer\":\"v1.0\"}", seq + (unsigned int)i);
+        if (0 != standin_das_seal(das, common, body, body_len, &payload, &payload_len))
+        {
+            return -1;
+        }
+        memset(frames[i], 0, ezdev_sdk_tcp_header_len);
+        len = MQTTSerialize_publish(frames[i] + ezdev_sdk_tcp_header_len, (int)(frame_max - ezdev_sdk_tcp_header_len), 0, 1, 0, (unsigned short)(i + 1), topic,
+                                    payload, (int)payload_len);
+        free(payload);
+        if (len <= 0)
+        {
+            return -1;
+        }
+        frame_lens[i] = ezdev_sdk_tcp_header_len + (size_t)len;
+    }
+    return 0;
+}
+
+static void run_mode(standin_das *das, int cipher, recv_mode mode, size_t body_len, uint64_t scale)
+{
+    char name[64];
+    unsigned char *body = malloc(body_len);
+    unsigned char *frames[BATCH];
+    size_t frame_lens[BATCH];
+    unsigned char *readbuf = NULL;
+    size_t frame_max = body_len + 256;
+    uint64_t messages = scale * BYTES_BUDGET / body_len;
+    uint64_t done = 0;
+    uint64_t elapsed = 0;
+    uint64_t start = 0;
+    uint64_t allocs = 0;
+    uint64_t copied = 0;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    size_t i = 0;
+
+    if (messages > 20000 * scale)
+    {
+        messages = 20000 * scale;
+    }
+    messages = (messages + BATCH - 1) / BATCH * BATCH;
+    for (i = 0; i < body_len; i++)
+    {
+        body[i] = (unsigned char)('a' + test_rand_below(26));
+    }
+    for (i = 0; i < BATCH; i++)
+    {
+        frames[i] = malloc(frame_max);
+    }
+    readbuf = malloc(frame_max);
+
+    g_mode = mode;
+    g_expect = body;
+    g_expect_len = body_len;
+    g_delivered = 0;
+    g_mismatches = 0;
+    for (done = 0; done < messages; done += BATCH)
+    {
+        if (0 != seal_batch(das, body, body_len, frames, frame_lens, frame_max, (unsigned int)done))
+        {
+            printf("%s: seal failed\n", g_mode_names[mode]);
+            break;
+        }
+        test_alloc_snapshot(&before);
+        start = test_now_ns();
+        for (i = 0; i < BATCH; i++)
+        {
+            memcpy(readbuf, frames[i], frame_lens[i]);
+            if (mode_before == mode)
+            {
+                receive_before(readbuf, frame_lens[i], cipher);
+            }
+            else
+            {
+                ezDevSDK_parse_wifi_publish_msg(readbuf, (int)frame_lens[i], 0);
+            }
+        }
+        elapsed += test_now_ns() - start;
+        test_alloc_snapshot(&after);
+        allocs += after.allocs - before.allocs;
+        copied += after.alloc_bytes - before.alloc_bytes;
+    }
+
+    snprintf(name, sizeof(name), "%s/%s/%zu", STANDIN_CIPHER_GCM == cipher ? "gcm" : "cbc", g_mode_names[mode], body_len);
+    if (g_delivered != done || 0 != g_mismatches)
+    {
+        printf("%-40s %llu of %llu delivered, %llu differ\n", name, (unsigned long long)g_delivered, (unsigned long long)done,
+               (unsigned long long)g_mismatches);
+    }
+    else
+    {
+        printf("%-20s %12.1f ns/op %6.2f allocs/op %10.1f B copied/op %8.1f MB/s\n", name, (double)elapsed / (double)done,
+               (double)allocs / (double)done, (double)copied / (double)done, (double)(done * body_len) * 1000.0 / (double)elapsed);
+    }
+
+    for (i = 0; i < BATCH; i++)
+    {
+        free(frames[i]);
+    }
+    free(readbuf);
+    free(body);
+}
+
+static void run_cipher(int cipher, uint64_t scale)
+{
+    standin_kernel_config config;
+    standin_kernel_msg msg;
+    ezdev_sdk_kernel_extend extend;
+    standin_das *das = standin_das_start(cipher, g_key);
+    char topic[256];
+    size_t i = 0;
+    int mode = 0;
+
+    if (NULL == das)
+    {
+        printf("stand-in did not start\n");
+        return;
+    }
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = cipher;
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS))
+    {
+        printf("kernel did not connect\n");
+        standin_das_stop(das);
+        return;
+    }
+
+    /* 走一遍正常下行, 确认上线且接收状态就绪 */
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    if (0 != standin_das_publish(das, topic, "{\"Seq\":1}", "ready", 5) || 0 != standin_kernel_pop(&msg, WAIT_MS))
+    {
+        printf("no downlink before the benchmark\n");
+        standin_kernel_stop();
+        standin_das_stop(das);
+        return;
+    }
+    standin_kernel_msg_free(&msg);
+
+    standin_kernel_pause();
+    memset(&extend, 0, sizeof(extend));
+    extend.domain_id = BENCH_DOMAIN;
+    extend.ezdev_sdk_kernel_extend_start = extend_start;
+    extend.ezdev_sdk_kernel_extend_stop = extend_stop;
+    extend.ezdev_sdk_kernel_extend_data_route = data_route;
+    extend.ezdev_sdk_kernel_extend_event = extend_event;
+    snprintf(extend.extend_module_name, sizeof(extend.extend_module_name), "bench");
+    snprintf(extend.extend_module_version, sizeof(extend.extend_module_version), "V1.0.0");
+    if (ezdev_sdk_kernel_succ != ezdev_sdk_kernel_extend_load(&extend))
+    {
+        printf("extend load failed\n");
+    }
+    else
+    {
+        keys_setup();
+        for (i = 0; i < sizeof(g_sizes) / sizeof(g_sizes[0]); i++)
+        {
+            for (mode = mode_borrow; mode <= mode_before; mode++)
+            {
+                run_mode(das, cipher, (recv_mode)mode, g_sizes[i], scale);
+            }
+        }
+    }
+    standin_kernel_resume();
+
+    standin_kernel_stop();
+    standin_das_stop(das);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t scale = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    int ciphers[] = {STANDIN_CIPHER_CBC, STANDIN_CIPHER_GCM};
+    pid_t pid = 0;
+    size_t i = 0;
+
+    if (0 == scale)
+    {
+        scale = 1;
+    }
+    test_rand_seed(26);
+    for (i = 0; i < sizeof(ciphers) / sizeof(ciphers[0]); i++)
+    {
+        fflush(stdout);
+        pid = fork();
+        if (0 == pid)
+        {
+            run_cipher(ciphers[i], scale);
+            fflush(stdout);
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,284 @@
+/**
+ * \file      bench_das_topic.c
+ * \brief     DAS topic生成(上行)和解析(下行)的单次耗时和分配次数
+ *
+ * topic的构造和解析都是das_transport.c里的静态函数, 这里直接把源文件包含进来测.
+ * 本文件定义了das_transport.c的全部符号, 链接时静态库里的das_transport.o不会再被拉进来.
+ * legacy一行是原来的做法: 每条消息strncpy序列号再snprintf, 下行拷贝到栈上再sscanf,
+ * 两种做法的结果逐字段比对过一致才计时.
+ */
+#include "das_transport.c"
+#include "test_util.h"
+
+#define ROUNDS 2000000
+
+static ezdev_sdk_kernel g_bench_kernel;
+
+static const char *g_down_topics[] = {
+    "/iot/BENCH00001/global/0-global/model/service/set/attr/PrivacyStatus",
+    "/iot/BENCH00001/C12345678/1-Video/ota/upgrade/inform",
+    "/iot/BENCH00001/global/0-global/basic/upload/result/report",
+};
+
+static void fill_pubmsg(ezdev_sdk_kernel_pubmsg_v3 *pubmsg, int model)
+{
+    memset(pubmsg, 0, sizeof(*pubmsg));
+    strcpy(pubmsg->resource_id, "0");
+    strcpy(pubmsg->resource_type, "global");
+    strcpy(pubmsg->module, model ? "model" : "ota");
+    strcpy(pubmsg->method, model ? "event" : "upgrade");
+    strcpy(pubmsg->msg_type, "report");
+    strcpy(pubmsg->ext_msg, "attr/PrivacyStatus");
+    if (!model)
+    {
+        strcpy(pubmsg->sub_serial, "C12345678");
+    }
+}
+
+/**
+ * \brief   原来das_send_pubmsg_v3里的topic生成
+ */
+static void legacy_render_v3(char *publish_topic, const ezdev_sdk_kernel_pubmsg_v3 *pubmsg)
+{
+    char dev_serial[ezdev_sdk_devserial_maxlen] = {0};
+    char dev_subserial[ezdev_sdk_devserial_maxlen] = {0};
+
+    memcpy(dev_serial, g_bench_kernel.dev_info.dev_subserial, ezdev_sdk_devserial_maxlen - 1);
+    if (strlen(pubmsg->sub_serial) > 0)
+    {
+        snprintf(dev_subserial, sizeof(dev_subserial), "%s", pubmsg->sub_serial);
+    }
+    else
+    {
+        memcpy(dev_subserial, "global", sizeof("global"));
+    }
+    if (0 == strcmp(pubmsg->module, "model"))
+    {
+        snprintf(publish_topic, 512, "/iot/%s/%s/%s-%s/model/%s/%s/%s", dev_serial, dev_subserial, pubmsg->resource_id,
+                 pubmsg->resource_type, pubmsg->method, pubmsg->msg_type, pubmsg->ext_msg);
+    }
+    else
+    {
+        snprintf(publish_topic, 512, "/iot/%s/%s/%s-%s/%s/%s/%s", dev_serial, dev_subserial, pubmsg->resource_id,
+                 pubmsg->resource_type, pubmsg->module, pubmsg->method, pubmsg->msg_type);
+    }
+}
+
+/**
+ * \brief   原来das_message_receive_v3里的topic解析
+ */
+static int legacy_parse_v3(ezdev_sdk_kernel_submsg_v3 *submsg, const char *topic, int topic_len)
+{
+    char msg_topic[512];
+    char dev_serial[ezdev_sdk_devserial_maxlen];
+    char find_str[32];
+    char *begin = NULL;
+    char *slash = NULL;
+
+    memset(msg_topic, 0, sizeof(msg_topic));
+    memcpy(msg_topic, topic, topic_len);
+    if (5 != sscanf(msg_topic, "/iot/%71[^/]/%71[^/]/%63[^-]-%63[^/]/%15[^/]/", dev_serial, submsg->sub_serial,
+                    submsg->resource_id, submsg->resource_type, submsg->module))
+    {
+        return -1;
+    }
+    snprintf(find_str, sizeof(find_str), "%s/", submsg->module);
+    if (0 == strcmp(submsg->module, "model"))
+    {
+        return 7 == sscanf(msg_topic, "/iot/%71[^/]/%71[^/]/%63[^-]-%63[^/]/model/%63[^/]/%63[^/]/%127s", dev_serial,
+                           submsg->sub_serial, submsg->resource_id, submsg->resource_type, submsg->method,
+                           submsg->msg_type, submsg->ext_msg) ? 0 : -1;
+    }
+    begin = strstr(msg_topic, find_str);
+    if (NULL == begin || NULL == (slash = strrchr(begin, '/')) || slash - begin - (int)strlen(find_str) <= 0)
+    {
+        return -1;
+    }
+    snprintf(submsg->msg_type, sizeof(submsg->msg_type), "%s", slash + 1);
+    snprintf(submsg->method, sizeof(submsg->method), "%.*s", (int)(slash - begin - strlen(find_str)), begin + strlen(find_str));
+    return 0;
+}
+
+static void to_mqtt_string(MQTTString *name, const char *topic)
+{
+    memset(name, 0, sizeof(*name));
+    name->lenstring.data = (char *)topic;
+    name->lenstring.len = (int)strlen(topic);
+}
+
+static int same_submsg(const ezdev_sdk_kernel_submsg_v3 *a, const ezdev_sdk_kernel_submsg_v3 *b)
+{
+    return 0 == strcmp(a->sub_serial, b->sub_serial) && 0 == strcmp(a->resource_id, b->resource_id) &&
+           0 == strcmp(a->resource_type, b->resource_type) && 0 == strcmp(a->module, b->module) &&
+           0 == strcmp(a->method, b->method) && 0 == strcmp(a->msg_type, b->msg_type) &&
+           0 == strcmp(a->ext_msg, b->ext_msg);
+}
+
+static void run(const char *name, void (*fn)(uint64_t), uint64_t rounds)
+{
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start;
+    uint64_t elapsed;
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    fn(rounds);
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    bench_report(name, rounds, elapsed, after.allocs - before.allocs, 0);
+}
+
+static ezdev_sdk_kernel_pubmsg_v3 g_pub[2];
+static char g_topic_buf[512];
+static volatile size_t g_sink;
+
+static void up_builder(uint64_t rounds)
+{
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        das_topic_render_v3(g_topic_buf, sizeof(g_topic_buf), &g_pub[i & 1]);
+        g_sink += (unsigned char)g_topic_buf[20];
+    }
+}
+
+static void up_legacy(uint64_t rounds)
+{
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        legacy_render_v3(g_topic_buf, &g_pub[i & 1]);
+        g_sink += (unsigned char)g_topic_buf[20];
+    }
+}
+
+static void up_v2_builder(uint64_t rounds)
+{
+    das_topic_builder topic;
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        das_topic_init(&topic, g_topic_buf, 128, "/", 1);
+        das_topic_append_int(&topic, (EZDEV_SDK_INT32)(i & 0xffff));
+        das_topic_append_char(&topic, '/');
+        das_topic_append_int(&topic, 0x4801);
+        das_topic_finish(&topic);
+        g_sink += topic.len;
+    }
+}
+
+static void up_v2_legacy(uint64_t rounds)
+{
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        g_sink += snprintf(g_topic_buf, 128, "/%d/%d", (int)(i & 0xffff), 0x4801);
+    }
+}
+
+static MQTTString g_down_names[3];
+static MQTTTopicIndex g_index;
+static ezdev_sdk_kernel_submsg_v3 g_sub;
+
+static void down_split(uint64_t rounds)
+{
+    MQTTTopicLevels levels;
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        MQTTTopicIndex_split(&g_down_names[i % 3], &levels);
+        g_sink += ezdev_parse_topic_v3(&g_sub, &levels);
+    }
+}
+
+static void down_match(uint64_t rounds)
+{
+    MQTTTopicLevels levels;
+    MQTTTopicHandler handlers[MQTT_TOPIC_MAX_MATCHES];
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        g_sink += MQTTTopicIndex_match(&g_index, &g_down_names[i % 3], &levels, handlers);
+        g_sink += ezdev_parse_topic_v3(&g_sub, &levels);
+    }
+}
+
+static void down_legacy(uint64_t rounds)
+{
+    uint64_t i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        const MQTTString *name = &g_down_names[i % 3];
+        g_sink += legacy_parse_v3(&g_sub, name->lenstring.data, name->lenstring.len);
+    }
+}
+
+static void dummy_handler(MessageData *data)
+{
+    (void)data;
+}
+
+int main(void)
+{
+    ezdev_sdk_kernel_submsg_v3 fresh;
+    ezdev_sdk_kernel_submsg_v3 legacy;
+    MQTTTopicLevels levels;
+    char legacy_topic[512];
+    int i = 0;
+
+    strcpy(g_bench_kernel.dev_info.dev_subserial, "BENCH00001");
+    if (mkernel_internal_succ != das_topic_prefix_render(&g_bench_kernel))
+    {
+        fprintf(stderr, "prefix render failed\n");
+        return 1;
+    }
+    fill_pubmsg(&g_pub[0], 1);
+    fill_pubmsg(&g_pub[1], 0);
+
+    for (i = 0; i < 2; i++)
+    {
+        das_topic_render_v3(g_topic_buf, sizeof(g_topic_buf), &g_pub[i]);
+        legacy_render_v3(legacy_topic, &g_pub[i]);
+        if (0 != strcmp(g_topic_buf, legacy_topic))
+        {
+            fprintf(stderr, "render mismatch: %s vs %s\n", g_topic_buf, legacy_topic);
+            return 1;
+        }
+    }
+
+    MQTTTopicIndex_init(&g_index);
+    MQTTTopicIndex_add(&g_index, "/iot/BENCH00001/#", dummy_handler);
+    MQTTTopicIndex_add(&g_index, "/BENCH00001/#", dummy_handler);
+    for (i = 0; i < 3; i++)
+    {
+        to_mqtt_string(&g_down_names[i], g_down_topics[i]);
+        memset(&fresh, 0, sizeof(fresh));
+        memset(&legacy, 0, sizeof(legacy));
+        MQTTTopicIndex_split(&g_down_names[i], &levels);
+        if (mkernel_internal_succ != ezdev_parse_topic_v3(&fresh, &levels) ||
+            0 != legacy_parse_v3(&legacy, g_down_topics[i], (int)strlen(g_down_topics[i])) || !same_submsg(&fresh, &legacy))
+        {
+            fprintf(stderr, "parse mismatch: %s\n", g_down_topics[i]);
+            return 1;
+        }
+    }
+
+    run("up v3 builder", up_builder, ROUNDS);
+    run("up v3 legacy snprintf", up_legacy, ROUNDS);
+    run("up v2 builder", up_v2_builder, ROUNDS);
+    run("up v2 legacy snprintf", up_v2_legacy, ROUNDS);
+    run("down v3 split+parse", down_split, ROUNDS);
+    run("down v3 match+parse", down_match, ROUNDS);
+    run("down v3 legacy sscanf", down_legacy, ROUNDS);
+
+    MQTTTopicIndex_fini(&g_index);
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * \file      bench_json_arena.c
+ * \brief     DAS报文里的JSON解析进arena与堆上解析对比: 每个文档的分配次数和解析吞吐
+ *
+ * 用法: bench_json_arena [倍数]
+ * - 报文: v2和v3(带压缩、分片字段)的通用协议头, 物模型属性设置, 约1.5KB的配置下发, 约14KB的告警批量上报
+ * - heap行是原来的bscJSON_Parse加bscJSON_Delete; arena/512行用微内核解析通用协议头时的栈上块(ezdev_sdk_json_arena_size),
+ *   放不下的部分从堆上补块; arena/256K行整个文档都在块里.
+ *   64位主机上一个节点72字节, 带压缩和分片字段的v3头在512字节的块里放不下, 要补一块; 32位的目标平台上节点小一半, 放得下
+ * - 每种做法解析出来的文档先重新打印, 和堆上解析的结果逐字节比对一致才计时
+ * - 分配次数按每个文档计, MB/s按报文字节数计
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bscJSON.h"
+#include "sdk_kernel_def.h"
+#include "test_util.h"
+
+#define PARSE_BUDGET    (256ULL * 1024 * 1024)
+#define LARGE_BLOCK     (256 * 1024)
+
+typedef struct
+{
+    const char *name;
+    char *text;
+    size_t len;
+} payload;
+
+static unsigned char g_small_block[ezdev_sdk_json_arena_size];
+static unsigned char g_large_block[LARGE_BLOCK];
+static volatile size_t g_sink;
+
+static char *dup_text(const char *text)
+{
+    char *copy = (char *)malloc(strlen(text) + 1);
+
+    strcpy(copy, text);
+    return copy;
+}
+
+/* 配置下发: 40个各种类型的属性 */
+static char *make_config(void)
+{
+    char *text = (char *)malloc(4096);
+    size_t len = 0;
+    int i = 0;
+
+    len += (size_t)sprintf(text + len, "{\"data\":{");
+    for (i = 0; i < 40; i++)
+    {
+        switch (i % 4)
+        {
+        case 0:
+            len += (size_t)sprintf(text + len, "%s\"Switch%02d\":{\"enable\":%s}", i ? "," : "", i, i % 8 ? "true" : "false");
+            break;
+        case 1:
+            len += (size_t)sprintf(text + len, ",\"Level%02d\":%d", i, i * 37 % 101);
+            break;
+        case 2:
+            len += (size_t)sprintf(text + len, ",\"Name%02d\":\"channel-%02d-front-door\"", i, i);
+            break;
+        default:
+            len += (size_t)sprintf(text + len, ",\"Plan%02d\":[{\"begin\":\"00:00\",\"end\":\"08:30\"},{\"begin\":\"18:00\",\"end\":\"23:59\"}]", i);
+            break;
+        }
+    }
+    sprintf(text + len, "},\"timestamp\":\"2021-07-01T12:00:00.000Z\"}");
+    return text;
+}
+
+/* 告警批量上报: 100条告警 */
+static char *make_alarms(void)
+{
+    char *text = (char *)malloc(32 * 1024);
+    size_t len = 0;
+    int i = 0;
+
+    len += (size_t)sprintf(text + len, "{\"alarms\":[");
+    for (i = 0; i < 100; i++)
+    {
+        len += (size_t)sprintf(text + len,
+                               "%s{\"type\":\"motiondetect\",\"channel\":%d,\"time\":\"2021-07-01T12:%02d:%02d+08:00\",\"confidence\":0.%02d,"
+                               "\"region\":[%d,%d,%d,%d],\"picture\":\"pic/%08d.jpg\"}",
+                               i ? "," : "", i % 4 + 1, i / 60, i % 60, 50 + i % 50, i, i * 2, i + 64, i * 2 + 48, i * 7919);
+    }
+    sprintf(text + len, "],\"count\":100}");
+    return text;
+}
+
+/**
+ * \brief   解析进arena再打印出来和expect比对
+ */
+static int arena_matches(const payload *p, unsigned char *block, size_t size, const char *expect)
+{
+    bscJSON_Arena arena;
+    bscJSON *doc = NULL;
+    char *printed = NULL;
+    int same = 0;
+
+    bscJSON_ArenaInit(&arena, block, size);
+    doc = bscJSON_ParseInArena(p->text, &arena);
+    printed = NULL != doc ? bscJSON_PrintUnformatted(doc) : NULL;
+    same = NULL != printed && 0 == strcmp(printed, expect);
+    bscJSON_free(printed);
+    bscJSON_ArenaReset(&arena);
+    return same;
+}
+
+static void run_arena(const payload *p, const char *kind, unsigned char *block, size_t size, uint64_t rounds)
+{
+    char name[64];
+    bscJSON_Arena arena;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t r = 0;
+
+    bscJSON_ArenaInit(&arena, block, size);
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        g_sink += (size_t)bscJSON_ParseInArena(p->text, &arena);
+        bscJSON_ArenaReset(&arena);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "%s/%s", p->name, kind);
+    bench_report(name, rounds, start, after.allocs - before.allocs, rounds * (uint64_t)p->len);
+}
+
+static void bench_payload(const payload *p, uint64_t scale)
+{
+    char name[64];
+    char *expect = NULL;
+    bscJSON *doc = bscJSON_Parse(p->text);
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t rounds = scale * PARSE_BUDGET / (uint64_t)(p->len + 256);
+    uint64_t start = 0;
+    uint64_t r = 0;
+
+    if (NULL == doc)
+    {
+        printf("%s: parse failed, not timed\n", p->name);
+        return;
+    }
+    expect = bscJSON_PrintUnformatted(doc);
+    bscJSON_Delete(doc);
+    if (!arena_matches(p, g_small_block, sizeof(g_small_block), expect) ||
+        !arena_matches(p, g_large_block, sizeof(g_large_block), expect))
+    {
+        printf("%s: arena document differs, not timed\n", p->name);
+        bscJSON_free(expect);
+        return;
+    }
+    bscJSON_free(expect);
+
+    printf("%s: %u bytes\n", p->name, (unsigned int)p->len);
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        bscJSON_Delete(bscJSON_Parse(p->text));
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "%s/heap", p->name);
+    bench_report(name, rounds, start, after.allocs - before.allocs, rounds * (uint64_t)p->len);
+
+    run_arena(p, "arena/512", g_small_block, sizeof(g_small_block), rounds);
+    run_arena(p, "arena/256K", g_large_block, sizeof(g_large_block), rounds);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t scale = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    payload payloads[5];
+    size_t i = 0;
+
+    if (0 == scale)
+    {
+        scale = 1;
+    }
+    payloads[0].name = "header_v2";
+    payloads[0].text = dup_text("{\"Seq\":1234,\"CmdVer\":\"v1.0.0\"}");
+    payloads[1].name = "header_v3";
+    payloads[1].text = dup_text("{\"Seq\":1234,\"Compress\":1,\"RawLen\":20480,\"FragId\":7,\"FragOff\":8192,\"FragTotal\":20480}");
+    payloads[2].name = "service_set";
+    payloads[2].text = dup_text("{\"data\":{\"PrivacyStatus\":{\"enable\":true,\"mode\":2},\"Volume\":{\"level\":60},"
+                                "\"NightVision\":{\"mode\":\"auto\",\"sensitivity\":3}},\"seq\":\"a3f1c2d4-0b7e-4e55-9c1d-2f3e4a5b6c7d\","
+                                "\"timestamp\":\"2021-07-01T12:00:00.000Z\"}");
+    payloads[3].name = "config_push";
+    payloads[3].text = make_config();
+    payloads[4].name = "alarm_report";
+    payloads[4].text = make_alarms();
+
+    for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++)
+    {
+        payloads[i].len = strlen(payloads[i].text);
+        bench_payload(&payloads[i], scale);
+        free(payloads[i].text);
+    }
+    return 0;
+}
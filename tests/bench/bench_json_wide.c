@@ -0,0 +1,199 @@
+/**
+ * \file      bench_json_wide.c
+ * \brief     宽对象(8到4096个成员)的解析、构造和按名字查找, 列表遍历与哈希索引对比
+ *
+ * 用法: bench_json_wide [倍数]
+ * - 成员名是"property_N", 查找按随机顺序覆盖全部成员
+ * - 解析进arena的文档从不建索引, 查找走原来的列表遍历(list行); 堆上解析的文档超过bscJSON_INDEX_THRESHOLD个成员时
+ *   解析完就建好索引(index行). 两种文档对每个名字查到的成员先逐个比对一致才计时
+ * - parse/build按每个成员计, 堆上解析包含建索引; get按每次查找计
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bscJSON.h"
+#include "test_util.h"
+
+#define LOOKUP_BUDGET   20000000ULL
+#define ARENA_BLOCK     (64 * 1024)
+
+static const int g_sizes[] = {8, 16, 32, 64, 256, 1024, 4096};
+
+static char **g_names = NULL;
+static char *g_text = NULL;
+static uint32_t *g_order = NULL;
+static unsigned char g_block[ARENA_BLOCK];
+static volatile size_t g_sink;
+
+/* {"property_0":0,"property_1":1,...} */
+static void make_document(int members)
+{
+    size_t len = 0;
+    int i = 0;
+
+    g_names = (char **)malloc(sizeof(char *) * (size_t)members);
+    g_order = (uint32_t *)malloc(sizeof(uint32_t) * (size_t)members);
+    g_text = (char *)malloc((size_t)members * 32 + 2);
+    g_text[len++] = '{';
+    for (i = 0; i < members; i++)
+    {
+        g_names[i] = (char *)malloc(24);
+        snprintf(g_names[i], 24, "property_%d", i);
+        len += (size_t)sprintf(g_text + len, "%s\"%s\":%d", i ? "," : "", g_names[i], i);
+        g_order[i] = (uint32_t)i;
+    }
+    g_text[len++] = '}';
+    g_text[len] = '\0';
+
+    for (i = members - 1; i > 0; i--)
+    {
+        uint32_t j = test_rand_below((uint32_t)i + 1);
+        uint32_t t = g_order[i];
+        g_order[i] = g_order[j];
+        g_order[j] = t;
+    }
+}
+
+static void free_document(int members)
+{
+    int i = 0;
+
+    for (i = 0; i < members; i++)
+    {
+        free(g_names[i]);
+    }
+    free(g_names);
+    free(g_order);
+    free(g_text);
+}
+
+typedef bscJSON *(*lookup_fn)(const bscJSON *const object, const char *const string);
+
+static void run_lookup(const char *what, const char *kind, int members, const bscJSON *object, lookup_fn fn, uint64_t lookups)
+{
+    char name[64];
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t i = 0;
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < lookups; i++)
+    {
+        g_sink += (size_t)fn(object, g_names[g_order[i % (uint64_t)members]])->valueint;
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "%s/%d/%s", what, members, kind);
+    bench_report(name, lookups, start, after.allocs - before.allocs, 0);
+}
+
+static void bench_size(int members, uint64_t scale)
+{
+    char name[64];
+    bscJSON_Arena arena;
+    bscJSON *indexed = NULL;
+    bscJSON *listed = NULL;
+    bscJSON *built = NULL;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t lookups = scale * LOOKUP_BUDGET / (uint64_t)(members + 64);
+    uint64_t rounds = scale * 400000 / (uint64_t)members + 1;
+    uint64_t start = 0;
+    uint64_t r = 0;
+    int mismatches = 0;
+    int i = 0;
+
+    make_document(members);
+
+    /* 堆上解析(建索引) */
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        bscJSON_Delete(bscJSON_Parse(g_text));
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "parse/%d/heap", members);
+    bench_report(name, rounds * (uint64_t)members, start, after.allocs - before.allocs, 0);
+
+    /* 解析进arena(不建索引) */
+    bscJSON_ArenaInit(&arena, g_block, sizeof(g_block));
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        g_sink += (size_t)bscJSON_ParseInArena(g_text, &arena);
+        bscJSON_ArenaReset(&arena);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "parse/%d/arena", members);
+    bench_report(name, rounds * (uint64_t)members, start, after.allocs - before.allocs, 0);
+
+    /* 逐个追加 */
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (r = 0; r < rounds; r++)
+    {
+        built = bscJSON_CreateObject();
+        for (i = 0; i < members; i++)
+        {
+            bscJSON_AddNumberToObject(built, g_names[i], i);
+        }
+        bscJSON_Delete(built);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "build/%d", members);
+    bench_report(name, rounds * (uint64_t)members, start, after.allocs - before.allocs, 0);
+
+    indexed = bscJSON_Parse(g_text);
+    listed = bscJSON_ParseInArena(g_text, &arena);
+    for (i = 0; i < members; i++)
+    {
+        bscJSON *a = bscJSON_GetObjectItem(indexed, g_names[i]);
+        bscJSON *b = bscJSON_GetObjectItem(listed, g_names[i]);
+        bscJSON *c = bscJSON_GetObjectItemCaseSensitive(indexed, g_names[i]);
+
+        if (NULL == a || NULL == b || a != c || a->valueint != i || b->valueint != i)
+        {
+            mismatches++;
+        }
+    }
+    if (mismatches > 0)
+    {
+        printf("%d members: %d lookups differ, not timed\n", members, mismatches);
+    }
+    else
+    {
+        run_lookup("get", "list", members, listed, bscJSON_GetObjectItem, lookups);
+        run_lookup("get", "index", members, indexed, bscJSON_GetObjectItem, lookups);
+        run_lookup("get_cs", "list", members, listed, bscJSON_GetObjectItemCaseSensitive, lookups);
+        run_lookup("get_cs", "index", members, indexed, bscJSON_GetObjectItemCaseSensitive, lookups);
+    }
+
+    bscJSON_Delete(indexed);
+    bscJSON_ArenaReset(&arena);
+    free_document(members);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t scale = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    size_t i = 0;
+
+    if (0 == scale)
+    {
+        scale = 1;
+    }
+    printf("bscJSON_INDEX_THRESHOLD %d\n", bscJSON_INDEX_THRESHOLD);
+    test_rand_seed(50);
+    for (i = 0; i < sizeof(g_sizes) / sizeof(g_sizes[0]); i++)
+    {
+        bench_size(g_sizes[i], scale);
+    }
+    return 0;
+}
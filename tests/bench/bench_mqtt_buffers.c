@@ -0,0 +1,242 @@
+/**
+ * \file      bench_mqtt_buffers.c
+ * \brief     DAS MQTT收发缓存在大小报文混合时的内存占用: 固定缓存和按需增长的缓存
+ *
+ * 20000个序列化好的PUBLISH报文逐个经cycle()读入, 大多数小于2K, 按给定比例夹杂16K-216K的大报文,
+ * 虚拟时钟每个报文前进500ms, 不睡眠. 每种方式在子进程里跑, 统计:
+ * - 缓存占用: 固定方式是两块静态缓存, 增长方式是堆上当前占用, 给出峰值和逐报文平均
+ * - 进程常驻内存(RSS): 开始前、结束时和峰值
+ * 固定方式与das_object_init相同, 按ezdev_sdk_send_buf_max/ezdev_sdk_recv_buf_max(RSETBUFFER时256K)
+ * 分配并清零; 增长方式从ezdev_sdk_mqtt_buf_init开始, ezdev_sdk_mqtt_buf_shrink_ms没有大报文后缩回.
+ * 第一个参数可以给报文数量的倍数.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "MQTTClient.h"
+#include "platform_define.h"
+#include "test_util.h"
+
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+extern int cycle(MQTTClient *c, Timer *timer);
+
+#define BUF_MAX         (1024 * 256)
+#define PACKETS         20000
+#define PACKET_GAP_MS   500
+#define SMALL_MAX       1900
+#define LARGE_MIN       (16 * 1024)
+#define LARGE_MAX       (216 * 1024)
+
+static unsigned char g_sendbuf[BUF_MAX];
+static unsigned char g_readbuf[BUF_MAX];
+static unsigned char g_packet[BUF_MAX];
+static unsigned char g_payload[BUF_MAX];
+static int g_packet_len = 0;
+static int g_packet_pos = 0;
+
+/**
+ * \brief   虚拟时钟, 内核时间轮和MQTT的Timer都从这里取时间
+ */
+static EZDEV_SDK_UINT32 g_vnow_ms = 0;
+
+typedef struct
+{
+    EZDEV_SDK_UINT32 deadline;
+} vclock_timer;
+
+static ezdev_sdk_time vclock_create(void)
+{
+    return calloc(1, sizeof(vclock_timer));
+}
+
+static void vclock_countdownms(ezdev_sdk_time t, EZDEV_SDK_UINT32 ms)
+{
+    ((vclock_timer *)t)->deadline = g_vnow_ms + ms;
+}
+
+static void vclock_countdown(ezdev_sdk_time t, EZDEV_SDK_UINT32 s)
+{
+    vclock_countdownms(t, s * 1000);
+}
+
+static EZDEV_SDK_UINT32 vclock_leftms(ezdev_sdk_time t)
+{
+    EZDEV_SDK_INT32 left = (EZDEV_SDK_INT32)(((vclock_timer *)t)->deadline - g_vnow_ms);
+
+    return left > 0 ? (EZDEV_SDK_UINT32)left : 0;
+}
+
+static char vclock_isexpired(ezdev_sdk_time t)
+{
+    return 0 == vclock_leftms(t);
+}
+
+static void vclock_destroy(ezdev_sdk_time t)
+{
+    free(t);
+}
+
+/**
+ * \brief   网络层直接从g_packet读, 写出去的丢掉
+ */
+static int mem_read(Network *n, unsigned char *buf, int len, int timeout_ms)
+{
+    if (len > g_packet_len - g_packet_pos)
+    {
+        len = g_packet_len - g_packet_pos;
+    }
+    memcpy(buf, g_packet + g_packet_pos, len);
+    g_packet_pos += len;
+    return len;
+}
+
+static int mem_write(Network *n, unsigned char *buf, int len, int timeout_ms)
+{
+    return len;
+}
+
+static void make_packet(int payload_len)
+{
+    MQTTString topic = MQTTString_initializer;
+    int i = 0;
+
+    topic.cstring = "/iot/E12345678/das/v3/model/attribute/report/global/0/1/Temperature";
+    for (i = 0; i < payload_len; i++)
+    {
+        g_payload[i] = (unsigned char)('a' + i % 26);
+    }
+    g_packet_len = MQTTSerialize_publish(g_packet, sizeof(g_packet), 0, 0, 0, 0, topic, g_payload, payload_len);
+    g_packet_pos = 0;
+}
+
+static void platform_init(void)
+{
+    g_ezdev_sdk_kernel.platform_handle.time_creator = vclock_create;
+    g_ezdev_sdk_kernel.platform_handle.time_isexpired = vclock_isexpired;
+    g_ezdev_sdk_kernel.platform_handle.time_countdownms = vclock_countdownms;
+    g_ezdev_sdk_kernel.platform_handle.time_countdown = vclock_countdown;
+    g_ezdev_sdk_kernel.platform_handle.time_leftms = vclock_leftms;
+    g_ezdev_sdk_kernel.platform_handle.time_destroy = vclock_destroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_create = sdk_platform_thread_mutex_create;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    kernel_timer_service_init();
+}
+
+/**
+ * \brief   large_per_10k: 每万个报文中大报文的个数; growable为0时用固定缓存
+ */
+static void run_mode(const char *name, int growable, unsigned large_per_10k, unsigned packets)
+{
+    MQTTClient client;
+    Network network;
+    Timer timer;
+    test_alloc_stat base;
+    test_alloc_stat stat;
+    size_t rss_before = 0;
+    size_t held = 0;
+    size_t held_peak = 0;
+    double held_sum = 0;
+    unsigned large = 0;
+    unsigned i = 0;
+    int payload_len = 0;
+
+    platform_init();
+    memset(&network, 0, sizeof(network));
+    network.mqttread = mem_read;
+    network.mqttwrite = mem_write;
+    test_rand_seed(large_per_10k + 1);
+    rss_before = test_rss_kb();
+
+    test_alloc_snapshot(&base);
+    if (growable)
+    {
+        MQTTClientInitGrowable(&client, &network, 6 * 1000, ezdev_sdk_mqtt_buf_init, BUF_MAX, ezdev_sdk_mqtt_buf_init, BUF_MAX,
+                               ezdev_sdk_mqtt_buf_shrink_ms);
+    }
+    else
+    {
+        memset(g_sendbuf, 0, sizeof(g_sendbuf));
+        memset(g_readbuf, 0, sizeof(g_readbuf));
+        MQTTClientInit(&client, &network, 6 * 1000, g_sendbuf, sizeof(g_sendbuf), g_readbuf, sizeof(g_readbuf));
+    }
+    TimerInit(&timer);
+
+    for (i = 0; i < packets; i++)
+    {
+        if (test_rand_below(10000) < large_per_10k)
+        {
+            payload_len = LARGE_MIN + (int)test_rand_below(LARGE_MAX - LARGE_MIN);
+            large++;
+        }
+        else
+        {
+            payload_len = 1 + (int)test_rand_below(SMALL_MAX);
+        }
+        make_packet(payload_len);
+        g_vnow_ms += PACKET_GAP_MS;
+        TimerCountdownMS(&timer, 1000);
+        if (PUBLISH != cycle(&client, &timer))
+        {
+            fprintf(stderr, "%s: packet %u of %d bytes not read\n", name, i, g_packet_len);
+            exit(1);
+        }
+
+        test_alloc_snapshot(&stat);
+        held = growable ? stat.cur_bytes - base.cur_bytes : sizeof(g_sendbuf) + sizeof(g_readbuf);
+        held_peak = held > held_peak ? held : held_peak;
+        held_sum += held;
+    }
+
+    printf("%-16s %5u large, buffers peak %4zuK avg %4.0fK, rss before %5zuK end %5zuK peak %5zuK\n", name, large,
+           held_peak / 1024, held_sum / packets / 1024, rss_before, test_rss_kb(), test_rss_peak_kb());
+    TimerFini(&timer);
+    MQTTClientFini(&client);
+}
+
+/**
+ * \brief   每种方式一个子进程, 常驻内存峰值互不影响
+ */
+static void run_case(const char *name, int growable, unsigned large_per_10k, unsigned packets)
+{
+    pid_t pid = fork();
+    int status = 0;
+
+    if (0 == pid)
+    {
+        run_mode(name, growable, large_per_10k, packets);
+        fflush(stdout);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || 0 != WEXITSTATUS(status))
+    {
+        fprintf(stderr, "%s: failed, status 0x%x\n", name, status);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    unsigned packets = (unsigned)(scale * PACKETS);
+
+    if (0 == packets)
+    {
+        packets = 1;
+    }
+    printf("%u packets, %d ms apart, small 1-%d bytes, large %dK-%dK\n", packets, PACKET_GAP_MS, SMALL_MAX, LARGE_MIN / 1024,
+           LARGE_MAX / 1024);
+    fflush(stdout);
+    run_case("fixed 256K", 0, 200, packets);
+    run_case("growable 2%", 1, 200, packets);
+    run_case("growable 0.2%", 1, 20, packets);
+    run_case("growable none", 1, 0, packets);
+    return 0;
+}
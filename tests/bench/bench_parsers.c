@@ -0,0 +1,194 @@
+/**
+ * \file      bench_parsers.c
+ * \brief     不可信输入解析器在抓包语料上的单次耗时和分配次数
+ *
+ * 用的是模糊测试的入口和fuzz/corpus下从替身服务端抓的种子(见fuzz/fuzz_capture.c), 每个入口把自己的语料
+ * 轮流跑到总次数为止, ns/op和allocs/op按单个输入算. json和xml另外只计解析加释放, 不含入口里的序列化.
+ * 用法: bench_parsers [倍数] [语料根目录], 语料根目录默认是源码树里的tests/fuzz/corpus.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "bscJSON.h"
+#include "ezxml.h"
+#include "test_util.h"
+#include "fuzz.h"
+
+#ifndef EZ_FUZZ_CORPUS_DIR
+#define EZ_FUZZ_CORPUS_DIR  "fuzz/corpus"
+#endif
+
+#define ROUNDS      200000
+#define ROUNDS_LBS  2000        ///<    认证II要做一次P-384密钥协商, 少跑一些
+
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+} bench_input;
+
+typedef struct
+{
+    bench_input *inputs;
+    size_t count;
+    size_t bytes;
+} bench_corpus;
+
+static void corpus_load(bench_corpus *corpus, const char *root, const char *name)
+{
+    struct dirent **entries = NULL;
+    struct stat st;
+    char path[1024];
+    FILE *fp = NULL;
+    int count = 0;
+    int i = 0;
+
+    memset(corpus, 0, sizeof(*corpus));
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    count = scandir(path, &entries, NULL, alphasort);
+    if (count <= 0)
+    {
+        return;
+    }
+    corpus->inputs = (bench_input *)calloc(count, sizeof(bench_input));
+    for (i = 0; i < count; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s/%s", root, name, entries[i]->d_name);
+        free(entries[i]);
+        if (0 != stat(path, &st) || !S_ISREG(st.st_mode) || NULL == (fp = fopen(path, "rb")))
+        {
+            continue;
+        }
+        /* 多留一个字节放'\0', json和xml直接在上面解析 */
+        corpus->inputs[corpus->count].data = (unsigned char *)malloc(st.st_size + 1);
+        corpus->inputs[corpus->count].size = fread(corpus->inputs[corpus->count].data, 1, st.st_size, fp);
+        corpus->inputs[corpus->count].data[corpus->inputs[corpus->count].size] = '\0';
+        corpus->bytes += corpus->inputs[corpus->count].size;
+        corpus->count++;
+        fclose(fp);
+    }
+    free(entries);
+}
+
+static void corpus_free(bench_corpus *corpus)
+{
+    size_t i = 0;
+
+    for (i = 0; i < corpus->count; i++)
+    {
+        free(corpus->inputs[i].data);
+    }
+    free(corpus->inputs);
+}
+
+static void bench_entry(const char *label, const bench_corpus *corpus, fuzz_entry_fn entry, uint64_t rounds)
+{
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    uint64_t bytes = 0;
+    uint64_t i = 0;
+    const bench_input *input = NULL;
+
+    /* 先跑一遍, 一次性的初始化不计入 */
+    for (i = 0; i < corpus->count; i++)
+    {
+        entry(corpus->inputs[i].data, corpus->inputs[i].size);
+    }
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        input = &corpus->inputs[i % corpus->count];
+        entry(input->data, input->size);
+        bytes += input->size;
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    bench_report(label, rounds, elapsed, after.allocs - before.allocs, bytes);
+}
+
+static int json_parse_only(const uint8_t *data, size_t size)
+{
+    bscJSON_Delete(bscJSON_Parse((const char *)data));
+    return 0;
+}
+
+/**
+ * \brief   ezxml_parse_str原地修改输入, 每次先拷到工作区
+ */
+static char g_xml_work[64 * 1024];
+
+static int xml_parse_only(const uint8_t *data, size_t size)
+{
+    if (size >= sizeof(g_xml_work))
+    {
+        return 0;
+    }
+    memcpy(g_xml_work, data, size + 1);
+    ezxml_free(ezxml_parse_str(g_xml_work, size));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *name;
+        fuzz_entry_fn entry;
+        int slow;
+    } entries[] = {
+        {"json", fuzz_json, 0},
+        {"xml", fuzz_xml, 0},
+        {"mqtt", fuzz_mqtt, 0},
+        {"das_topic", fuzz_das_topic, 0},
+        {"das_header", fuzz_das_header, 0},
+        {"lbs_authentication_ii", fuzz_lbs_authentication_ii, 1},
+        {"lbs_refreshsessionkey_ii", fuzz_lbs_refreshsessionkey_ii, 0},
+        {"lbs_crypto_data_das", fuzz_lbs_crypto_data_das, 0},
+    };
+    const char *root = EZ_FUZZ_CORPUS_DIR;
+    bench_corpus corpus;
+    double scale = 1.0;
+    uint64_t rounds = 0;
+    char label[96];
+    size_t i = 0;
+    int arg = 1;
+
+    if (arg < argc && strspn(argv[arg], "0123456789.") == strlen(argv[arg]))
+    {
+        scale = atof(argv[arg++]);
+    }
+    if (arg < argc)
+    {
+        root = argv[arg++];
+    }
+    fuzz_platform_init();
+
+    for (i = 0; i < sizeof(entries) / sizeof(entries[0]); i++)
+    {
+        corpus_load(&corpus, root, entries[i].name);
+        if (0 == corpus.count)
+        {
+            fprintf(stderr, "%s: no corpus under %s\n", entries[i].name, root);
+            return 1;
+        }
+        printf("%-26s %4zu inputs, %6zu bytes\n", entries[i].name, corpus.count, corpus.bytes);
+        rounds = (uint64_t)(scale * (entries[i].slow ? ROUNDS_LBS : ROUNDS)) + 1;
+        bench_entry(entries[i].name, &corpus, entries[i].entry, rounds);
+        if (fuzz_json == entries[i].entry)
+        {
+            snprintf(label, sizeof(label), "%s parse only", entries[i].name);
+            bench_entry(label, &corpus, json_parse_only, rounds);
+        }
+        else if (fuzz_xml == entries[i].entry)
+        {
+            snprintf(label, sizeof(label), "%s parse only", entries[i].name);
+            bench_entry(label, &corpus, xml_parse_only, rounds);
+        }
+        corpus_free(&corpus);
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * \file      bench_rng.c
+ * \brief     微内核随机数服务每次取随机数的耗时: 共用的CTR_DRBG对比原来每次调用重新采集熵、注入种子
+ *
+ * 用法: bench_rng [倍数]
+ * - once行是kernel_rng_service_init之前的kernel_rng_random, 每次调用临时建熵源和DRBG再注入种子,
+ *   就是原来ezRandomGen、ezRsaEncrypt/ezRsaDecrypt的做法
+ * - shared行是服务初始化以后共用一个DRBG, 每次调用只加锁、查重新注入的定时器和进程号再取随机数;
+ *   threads行是4个线程同时取
+ * - 长度: 4字节(LBS挑战随机数), 16字节(密钥申请的AES密钥), 32字节(ECDH私钥), 1KB
+ * - 计时前先检查连续两次取到的随机数不相同
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_rng.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "platform_define.h"
+
+EZDEV_SDK_KERNEL_RNG_INTERFACE
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define ONCE_ROUNDS     2000ULL
+#define SHARED_ROUNDS   1000000ULL
+#define THREADS         4
+
+static const size_t g_lengths[] = {4, 16, 32, 1024};
+
+typedef struct
+{
+    size_t len;
+    uint64_t rounds;
+    int failures;
+} rng_job;
+
+static int draws_differ(size_t len)
+{
+    unsigned char first[1024];
+    unsigned char second[1024];
+
+    if (0 != kernel_rng_random(NULL, first, len) || 0 != kernel_rng_random(NULL, second, len))
+    {
+        return 0;
+    }
+    return 0 != memcmp(first, second, len);
+}
+
+static void *rng_thread(void *arg)
+{
+    rng_job *job = (rng_job *)arg;
+    unsigned char buf[1024];
+    uint64_t i = 0;
+
+    for (i = 0; i < job->rounds; i++)
+    {
+        job->failures += 0 != kernel_rng_random(NULL, buf, job->len);
+    }
+    return NULL;
+}
+
+static void run_draws(const char *kind, size_t len, uint64_t rounds)
+{
+    char name[64];
+    rng_job job;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+
+    if (!draws_differ(len))
+    {
+        printf("%s/%u: draws failed or repeat, not timed\n", kind, (unsigned int)len);
+        return;
+    }
+    job.len = len;
+    job.rounds = rounds;
+    job.failures = 0;
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    rng_thread(&job);
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "%s/%u", kind, (unsigned int)len);
+    bench_report(name, rounds, start, after.allocs - before.allocs, rounds * (uint64_t)len);
+    if (job.failures > 0)
+    {
+        printf("%s: %d draws failed\n", name, job.failures);
+    }
+}
+
+static void run_threads(size_t len, uint64_t rounds)
+{
+    char name[64];
+    pthread_t threads[THREADS];
+    rng_job jobs[THREADS];
+    uint64_t start = 0;
+    int failures = 0;
+    int i = 0;
+
+    start = test_now_ns();
+    for (i = 0; i < THREADS; i++)
+    {
+        jobs[i].len = len;
+        jobs[i].rounds = rounds;
+        jobs[i].failures = 0;
+        pthread_create(&threads[i], NULL, rng_thread, &jobs[i]);
+    }
+    for (i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        failures += jobs[i].failures;
+    }
+    start = test_now_ns() - start;
+    snprintf(name, sizeof(name), "shared/%u/%d threads", (unsigned int)len, THREADS);
+    bench_report(name, rounds * THREADS, start, 0, rounds * THREADS * (uint64_t)len);
+    if (failures > 0)
+    {
+        printf("%s: %d draws failed\n", name, failures);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ezdev_sdk_kernel_platform_handle *handle = &g_ezdev_sdk_kernel.platform_handle;
+    uint64_t scale = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    size_t i = 0;
+
+    if (0 == scale)
+    {
+        scale = 1;
+    }
+    handle->time_creator = Platform_TimerCreater;
+    handle->time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    handle->time_isexpired = Platform_TimerIsExpired;
+    handle->time_countdownms = Platform_TimerCountdownMS;
+    handle->time_countdown = Platform_TimerCountdown;
+    handle->time_leftms = Platform_TimerLeftMS;
+    handle->time_destroy = Platform_TimeDestroy;
+    handle->thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle->thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle->thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle->thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+
+    for (i = 0; i < sizeof(g_lengths) / sizeof(g_lengths[0]); i++)
+    {
+        run_draws("once", g_lengths[i], scale * ONCE_ROUNDS);
+    }
+
+    if (mkernel_internal_succ != kernel_timer_service_init() || mkernel_internal_succ != kernel_rng_service_init())
+    {
+        printf("kernel timer or rng service init failed\n");
+        return 1;
+    }
+    for (i = 0; i < sizeof(g_lengths) / sizeof(g_lengths[0]); i++)
+    {
+        run_draws("shared", g_lengths[i], scale * SHARED_ROUNDS);
+    }
+    for (i = 0; i < sizeof(g_lengths) / sizeof(g_lengths[0]); i++)
+    {
+        run_threads(g_lengths[i], scale * SHARED_ROUNDS / THREADS);
+    }
+    kernel_rng_service_fini();
+    kernel_timer_service_fini();
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * \file      bench_sha.c
+ * \brief     SHA-256和SHA-512的吞吐(MB/s), 库里的实现与不用扩展指令的实现(common/sha256_generic.c, sha512_generic.c)对比
+ *
+ * - SHA-256: 库里在x86-64上CPU支持时走SHA-NI, 打开BSCOMPTLS_SHA256_A64_CRYPTO的AArch64上走ARMv8指令, 其余与通用实现相同
+ * - SHA-512: 库里用展开的轮函数和16字滚动消息扩展(打开BSCOMPTLS_SHA512_A64_CRYPTO时走ARMv8.2指令),
+ *   通用实现是BSCOMPTLS_SHA512_SMALLER的紧凑循环
+ * 每种消息长度(64字节、1KB、16KB)都是一次性的bscomptls_shaXXX调用. 两种实现的批次交替运行, 报告各自最快的一批,
+ * 减少共享机器上的抖动和先后顺序的影响. 第一个参数可以给运行次数的倍数.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+#include "sha_generic.h"
+#include "test_util.h"
+
+#define BENCH_BYTES     (32u * 1024 * 1024)
+#define MSG_MAX         (16 * 1024)
+#define BATCHES         5
+
+typedef void (*sha_fn)(const unsigned char *input, size_t ilen, unsigned char *output, int truncated);
+
+static uint64_t run_batch(sha_fn fn, const unsigned char *msg, size_t len, uint64_t rounds)
+{
+    unsigned char out[64];
+    uint64_t start = test_now_ns();
+    uint64_t i = 0;
+
+    for (i = 0; i < rounds; i++)
+    {
+        fn(msg, len, out, 0);
+    }
+    return test_now_ns() - start;
+}
+
+/* 两种实现的批次交替运行, 各自取最快的一批 */
+static void bench_pair(const char *algo, sha_fn library, sha_fn generic, const unsigned char *msg, size_t len, double scale)
+{
+    sha_fn fns[2] = {library, generic};
+    const char *impls[2] = {"library", "generic"};
+    uint64_t best[2] = {0, 0};
+    uint64_t allocs[2] = {0, 0};
+    uint64_t rounds = (uint64_t)(scale * BENCH_BYTES / len / BATCHES) + 1;
+    uint64_t elapsed = 0;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    int batch = 0;
+    int k = 0;
+    char name[64];
+
+    run_batch(library, msg, len, 1);
+    run_batch(generic, msg, len, 1);
+    for (batch = 0; batch < BATCHES; batch++)
+    {
+        for (k = 0; k < 2; k++)
+        {
+            test_alloc_snapshot(&before);
+            elapsed = run_batch(fns[k], msg, len, rounds);
+            test_alloc_snapshot(&after);
+            allocs[k] += after.allocs - before.allocs;
+            if (0 == batch || elapsed < best[k])
+            {
+                best[k] = elapsed;
+            }
+        }
+    }
+    for (k = 0; k < 2; k++)
+    {
+        snprintf(name, sizeof(name), "%s %s %zuB", impls[k], algo, len);
+        bench_report(name, rounds, best[k], allocs[k] / BATCHES, rounds * len);
+    }
+}
+
+static void library_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int truncated)
+{
+    bscomptls_sha256(input, ilen, output, truncated);
+}
+
+static void library_sha512(const unsigned char *input, size_t ilen, unsigned char *output, int truncated)
+{
+    bscomptls_sha512(input, ilen, output, truncated);
+}
+
+static void plain_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int truncated)
+{
+    generic_sha256(input, ilen, output, truncated);
+}
+
+static void plain_sha512(const unsigned char *input, size_t ilen, unsigned char *output, int truncated)
+{
+    generic_sha512(input, ilen, output, truncated);
+}
+
+int main(int argc, char **argv)
+{
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    static const size_t sizes[] = {64, 1024, MSG_MAX};
+    static unsigned char msg[MSG_MAX];
+    size_t i = 0;
+
+    test_rand_seed(44);
+    for (i = 0; i < sizeof(msg); i++)
+    {
+        msg[i] = (unsigned char)test_rand();
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        bench_pair("sha256", library_sha256, plain_sha256, msg, sizes[i], scale);
+        bench_pair("sha512", library_sha512, plain_sha512, msg, sizes[i], scale);
+    }
+    return 0;
+}
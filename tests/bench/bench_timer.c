@@ -0,0 +1,253 @@
+/**
+ * \file      bench_timer.c
+ * \brief     每次发布消息的定时器开销: 原来每次现建现删的平台定时器与微内核时间轮定时器对比
+ *
+ * 用法: bench_timer [倍数]
+ * - 一次"发布"按MQTTClient.c里的用法走一遍: MQTTPublish建一个命令超时定时器, sendPacket和waitfor里查剩余时间和是否超时,
+ *   cycle刷新connect_timer; 随后一次MQTTYield再建一个定时器, keepalive查ping_timer, das_yield按时间差查心跳超时
+ * - platform行是原来的做法, 每个Timer在TimerInit里time_creator(malloc), TimerFini里time_destroy(free)
+ * - kernel行走MQTTNet.c里的Timer, 时间轮上另外挂着0/1000/100000个随机到期(1秒到1天)的定时器;
+ *   next_deadline行是das_yield每轮算等待时长的kernel_timer_next_deadline
+ * - 两种做法每一步的超时判断先比对一致才计时, next_deadline先对着逐个算出的最近到期时间检查
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "MQTTNet.h"
+#include "platform_define.h"
+
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define ROUNDS              1000000ULL
+#define DEADLINE_ROUNDS     1000000ULL
+#define COMMAND_TIMEOUT_MS  5000
+#define YIELD_MS            10
+#define KEEPALIVE_S         60
+
+static const int g_pending[] = {0, 1000, 100000};
+
+static volatile unsigned int g_sink;
+
+/**
+ * \brief   原来的平台定时器, 一次发布走的步骤, 返回各步超时判断拼成的位图
+ */
+static unsigned int publish_platform(ezdev_sdk_time ping_timer, ezdev_sdk_time connect_timer)
+{
+    unsigned int flags = 0;
+    ezdev_sdk_time timer = NULL;
+
+    /* MQTTPublish */
+    timer = Platform_TimerCreater();
+    Platform_TimerCountdownMS(timer, COMMAND_TIMEOUT_MS);
+    g_sink += Platform_TimerLeftMS(timer);
+    flags |= (unsigned int)Platform_TimerIsExpired(timer) << 0;
+    flags |= (unsigned int)Platform_TimerIsExpired(timer) << 1;
+    g_sink += Platform_TimerLeftMS(timer);
+    Platform_TimerCountdown(connect_timer, 0);
+    Platform_TimeDestroy(timer);
+
+    /* MQTTYield */
+    timer = Platform_TimerCreater();
+    Platform_TimerCountdownMS(timer, YIELD_MS);
+    g_sink += Platform_TimerLeftMS(timer);
+    flags |= (unsigned int)Platform_TimerIsExpired(ping_timer) << 2;
+    flags |= (unsigned int)Platform_TimerIsExpired(timer) << 3;
+    Platform_TimeDestroy(timer);
+
+    /* das_yield的心跳超时 */
+    flags |= (unsigned int)Platform_TimeIsExpired_Bydiff(connect_timer, KEEPALIVE_S * 2000) << 4;
+    return flags;
+}
+
+/**
+ * \brief   MQTTNet.c的Timer, 步骤同publish_platform
+ */
+static unsigned int publish_kernel(Timer *ping_timer, Timer *connect_timer)
+{
+    unsigned int flags = 0;
+    Timer timer;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, COMMAND_TIMEOUT_MS);
+    g_sink += (unsigned int)TimerLeftMS(&timer);
+    flags |= (unsigned int)TimerIsExpired(&timer) << 0;
+    flags |= (unsigned int)TimerIsExpired(&timer) << 1;
+    g_sink += (unsigned int)TimerLeftMS(&timer);
+    TimerCountdown(connect_timer, 0);
+    TimerFini(&timer);
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, YIELD_MS);
+    g_sink += (unsigned int)TimerLeftMS(&timer);
+    flags |= (unsigned int)TimerIsExpired(ping_timer) << 2;
+    flags |= (unsigned int)TimerIsExpired(&timer) << 3;
+    TimerFini(&timer);
+
+    flags |= (unsigned int)TimerIsExpiredByDiff(connect_timer, KEEPALIVE_S * 2000) << 4;
+    return flags;
+}
+
+static void bench_platform(uint64_t rounds)
+{
+    ezdev_sdk_time ping_timer = Platform_TimerCreater();
+    ezdev_sdk_time connect_timer = Platform_TimerCreater();
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t i = 0;
+
+    Platform_TimerCountdown(ping_timer, KEEPALIVE_S);
+    Platform_TimerCountdown(connect_timer, 0);
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        g_sink += publish_platform(ping_timer, connect_timer);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    bench_report("publish/platform", rounds, start, after.allocs - before.allocs, 0);
+
+    Platform_TimeDestroy(ping_timer);
+    Platform_TimeDestroy(connect_timer);
+}
+
+static void bench_kernel(int pending, uint64_t rounds)
+{
+    char name[64];
+    kernel_timer *background = (kernel_timer *)calloc((size_t)pending + 1, sizeof(kernel_timer));
+    Timer ping_timer;
+    Timer connect_timer;
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start = 0;
+    uint64_t i = 0;
+    EZDEV_SDK_UINT32 deadline = 0;
+    EZDEV_SDK_UINT32 nearest = 0;
+    EZDEV_SDK_UINT32 now = 0;
+    int j = 0;
+
+    for (j = 0; j < pending; j++)
+    {
+        kernel_timer_init(&background[j], NULL);
+        kernel_timer_start(&background[j], 1000 + test_rand_below(86400 * 1000));
+    }
+    TimerInit(&ping_timer);
+    TimerInit(&connect_timer);
+    TimerCountdown(&ping_timer, KEEPALIVE_S);
+    TimerCountdown(&connect_timer, 0);
+
+    /* next_deadline对着按同一时刻逐个算的最小剩余时间, 算的过程中走过的时间另外扣掉 */
+    now = kernel_timer_now();
+    nearest = ping_timer.node.expires - now;
+    for (j = 0; j < pending; j++)
+    {
+        nearest = background[j].expires - now < nearest ? background[j].expires - now : nearest;
+    }
+    deadline = kernel_timer_next_deadline();
+    kernel_timer_wait_done();
+    if (deadline > nearest || nearest - deadline > kernel_timer_now() - now)
+    {
+        printf("%d pending: next_deadline %u, nearest timer %u\n", pending, deadline, nearest);
+    }
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        g_sink += publish_kernel(&ping_timer, &connect_timer);
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "publish/kernel/%d", pending);
+    bench_report(name, rounds, start, after.allocs - before.allocs, 0);
+
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < DEADLINE_ROUNDS; i++)
+    {
+        g_sink += kernel_timer_next_deadline();
+        kernel_timer_wait_done();
+    }
+    start = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+    snprintf(name, sizeof(name), "next_deadline/%d", pending);
+    bench_report(name, DEADLINE_ROUNDS, start, after.allocs - before.allocs, 0);
+
+    TimerFini(&ping_timer);
+    TimerFini(&connect_timer);
+    for (j = 0; j < pending; j++)
+    {
+        kernel_timer_stop(&background[j]);
+    }
+    free(background);
+}
+
+int main(int argc, char **argv)
+{
+    ezdev_sdk_kernel_platform_handle *handle = &g_ezdev_sdk_kernel.platform_handle;
+    uint64_t scale = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    ezdev_sdk_time ping_timer = NULL;
+    ezdev_sdk_time connect_timer = NULL;
+    Timer kernel_ping;
+    Timer kernel_connect;
+    unsigned int old_flags = 0;
+    unsigned int new_flags = 0;
+    size_t i = 0;
+
+    if (0 == scale)
+    {
+        scale = 1;
+    }
+    handle->time_creator = Platform_TimerCreater;
+    handle->time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    handle->time_isexpired = Platform_TimerIsExpired;
+    handle->time_countdownms = Platform_TimerCountdownMS;
+    handle->time_countdown = Platform_TimerCountdown;
+    handle->time_leftms = Platform_TimerLeftMS;
+    handle->time_destroy = Platform_TimeDestroy;
+    handle->thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle->thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle->thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle->thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    if (mkernel_internal_succ != kernel_timer_service_init())
+    {
+        printf("kernel_timer_service_init failed\n");
+        return 1;
+    }
+    test_rand_seed(28);
+
+    /* 超时判断: 命令超时和yield定时器未到期, ping_timer和心跳超时未到期 */
+    ping_timer = Platform_TimerCreater();
+    connect_timer = Platform_TimerCreater();
+    Platform_TimerCountdown(ping_timer, KEEPALIVE_S);
+    TimerInit(&kernel_ping);
+    TimerInit(&kernel_connect);
+    TimerCountdown(&kernel_ping, KEEPALIVE_S);
+    old_flags = publish_platform(ping_timer, connect_timer);
+    new_flags = publish_kernel(&kernel_ping, &kernel_connect);
+    Platform_TimeDestroy(ping_timer);
+    Platform_TimeDestroy(connect_timer);
+    TimerFini(&kernel_ping);
+    TimerFini(&kernel_connect);
+    if (old_flags != new_flags)
+    {
+        printf("expiry checks differ: platform 0x%x, kernel 0x%x, not timed\n", old_flags, new_flags);
+        kernel_timer_service_fini();
+        return 1;
+    }
+
+    bench_platform(scale * ROUNDS);
+    for (i = 0; i < sizeof(g_pending) / sizeof(g_pending[0]); i++)
+    {
+        bench_kernel(g_pending[i], scale * ROUNDS);
+    }
+    kernel_timer_service_fini();
+    return 0;
+}
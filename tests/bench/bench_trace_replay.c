@@ -0,0 +1,1091 @@
+/**
+ * \file      bench_trace_replay.c
+ * \brief     把微内核的消息记录(ezdev_sdk_kernel_set_trace)对着DAS替身回放, 报告吞吐和各阶段时延
+ *
+ * 用法: bench_trace_replay [-recorded|-afap] [-speed=X] [-gcm] [-save=<文件>] [记录文件]
+ * - 不给记录文件时先在子进程里录一段接近现网的流量: 上线后的配置下发和应答、告警突发、ISAPI XML大报文、
+ *   周期上报和零星下发; -save把录到的记录存下来
+ * - -recorded按记录的时间节奏回放(-speed=X加速X倍), -afap不等待, 尽快送入; 两个都不给时各跑一遍
+ * - 回放时每个模式一个子进程, 微内核连DAS替身. 下行记录按记录里的topic(模块段改成standin)和业务数据
+ *   由替身加密下发, 走完整的收包、解密、分发; v2下行记录没有替身通道, 在进程内注入; 上行记录重新调用发送接口
+ * 阶段时间点来自回放时微内核自己的记录回调(只记长度)、替身收到的上行消息和应用线程收到的下行消息, 按seq对应:
+ * - 下行: 替身下发 -> 微内核解密完成 -> 应用收到
+ * - 上行: 调用发送接口 -> 进入发送队列 -> 发送完成 -> 替身收到
+ * 记录回调本身在收发线程里持锁执行, 测得的时延包含它的开销.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "ezdev_sdk_kernel.h"
+#include "ezdev_sdk_kernel_ex.h"
+#include "standin_das.h"
+#include "standin_kernel.h"
+#include "test_util.h"
+
+#define WAIT_MS             5000
+#define DRAIN_MS            10000       ///<    送完之后等待剩余消息到达的上限
+#define TRACE_HEAD_LEN      16
+#define TRACE_FLAG_SCRUBBED 0x01
+#define TRACE_FLAG_RESPONSE 0x02
+#define RECORD_SEQ_BASE     100000      ///<    录制时下行消息的seq, 与微内核自己生成的上行seq错开
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+
+typedef struct
+{
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} trace_buf;
+
+static int trace_buf_append(trace_buf *buf, const void *data, size_t len)
+{
+    unsigned char *grown = NULL;
+    size_t cap = buf->cap ? buf->cap : 64 * 1024;
+
+    while (cap < buf->len + len)
+    {
+        cap *= 2;
+    }
+    if (cap != buf->cap)
+    {
+        grown = (unsigned char *)realloc(buf->data, cap);
+        if (NULL == grown)
+        {
+            return -1;
+        }
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+static int trace_load(trace_buf *buf, const char *path)
+{
+    unsigned char chunk[4096];
+    FILE *fp = fopen(path, "rb");
+    size_t n = 0;
+
+    if (NULL == fp)
+    {
+        return -1;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        trace_buf_append(buf, chunk, n);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int trace_save(const trace_buf *buf, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    size_t n = 0;
+
+    if (NULL == fp)
+    {
+        return -1;
+    }
+    n = fwrite(buf->data, 1, buf->len, fp);
+    fclose(fp);
+    return n == buf->len ? 0 : -1;
+}
+
+/**
+ * \brief   从记录内容里按顺序取字段, 越界时置error
+ */
+typedef struct
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    int error;
+} field_reader;
+
+static uint32_t read8(field_reader *r)
+{
+    if (r->error || r->end - r->p < 1)
+    {
+        r->error = 1;
+        return 0;
+    }
+    return *r->p++;
+}
+
+static uint32_t read32(field_reader *r)
+{
+    uint32_t v = 0;
+
+    if (r->error || r->end - r->p < 4)
+    {
+        r->error = 1;
+        return 0;
+    }
+    v = ((uint32_t)r->p[0] << 24) | ((uint32_t)r->p[1] << 16) | ((uint32_t)r->p[2] << 8) | r->p[3];
+    r->p += 4;
+    return v;
+}
+
+static void read_str(field_reader *r, char *buf, size_t buf_size)
+{
+    uint32_t len = read8(r);
+
+    if (r->error || (uint32_t)(r->end - r->p) < len || len >= buf_size)
+    {
+        r->error = 1;
+        buf[0] = '\0';
+        return;
+    }
+    memcpy(buf, r->p, len);
+    buf[len] = '\0';
+    r->p += len;
+}
+
+/**
+ * \brief   脱敏记录的业务数据字段只有末尾的4字节长度, 回放时自己的记录都是脱敏的
+ */
+static uint32_t record_body_len(const unsigned char *record, const sdk_trace_record_info *info)
+{
+    field_reader r;
+
+    if (0 == (record[2] & TRACE_FLAG_SCRUBBED))
+    {
+        return 0;
+    }
+    r.p = record + info->record_len - 4;
+    r.end = record + info->record_len;
+    r.error = 0;
+    return read32(&r);
+}
+
+static uint32_t record_result(const unsigned char *record, const sdk_trace_record_info *info)
+{
+    field_reader r;
+
+    r.p = record + TRACE_HEAD_LEN;
+    r.end = record + info->record_len;
+    r.error = 0;
+    return read32(&r);
+}
+
+/**
+ * \brief   out记录之后同一seq的发送结果是队列满, 说明这条没有入队, 录制时的应用随后重试过
+ */
+static int out_rejected(const unsigned char *trace, size_t len, size_t off, const sdk_trace_record_info *out)
+{
+    sdk_trace_record_info info;
+
+    for (off += out->record_len; off < len && ezdev_sdk_kernel_succ == ezdev_sdk_kernel_trace_peek(trace + off, (EZDEV_SDK_UINT32)(len - off), &info);
+         off += info.record_len)
+    {
+        if (info.seq != out->seq)
+        {
+            continue;
+        }
+        if (sdk_trace_sent == info.type)
+        {
+            return ezdev_sdk_kernel_queue_full == (ezdev_sdk_kernel_error)record_result(trace + off, &info);
+        }
+        if (sdk_trace_out_v2 == info.type || sdk_trace_out_v3 == info.type)
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* 录制                                                                       */
+/* ------------------------------------------------------------------------- */
+
+static pthread_mutex_t g_rec_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_buf g_rec;
+static int g_rec_out = 0;
+static int g_rec_sent = 0;
+
+static void record_write(const void *data, EZDEV_SDK_UINT32 len, EZDEV_SDK_PTR user)
+{
+    sdk_trace_record_info info;
+
+    pthread_mutex_lock(&g_rec_lock);
+    trace_buf_append(&g_rec, data, len);
+    if (ezdev_sdk_kernel_succ == ezdev_sdk_kernel_trace_peek(data, len, &info))
+    {
+        g_rec_out += sdk_trace_out_v2 == info.type || sdk_trace_out_v3 == info.type;
+        g_rec_sent += sdk_trace_sent == info.type;
+    }
+    pthread_mutex_unlock(&g_rec_lock);
+}
+
+static void fill_json(char *buf, size_t len, unsigned int salt)
+{
+    size_t off = 0;
+    unsigned int i = 0;
+
+    off += snprintf(buf + off, len - off, "{\"ver\":%u,\"items\":[", salt);
+    while (off + 64 < len)
+    {
+        off += snprintf(buf + off, len - off, "%s{\"id\":%u,\"enable\":true,\"value\":%u}", i ? "," : "", i, (salt * 31 + i) % 997);
+        i++;
+    }
+    snprintf(buf + off, len - off, "]}");
+}
+
+static void fill_xml(char *buf, size_t len, unsigned int salt)
+{
+    size_t off = 0;
+    unsigned int i = 0;
+
+    off += snprintf(buf + off, len - off, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><EventNotificationAlert version=\"2.0\">");
+    while (off + 160 < len)
+    {
+        off += snprintf(buf + off, len - off, "<DetectionRegionEntry><regionID>%u</regionID><sensitivityLevel>%u</sensitivityLevel>"
+                        "<RegionCoordinatesList/></DetectionRegionEntry>", i, (salt + i) % 100);
+        i++;
+    }
+    snprintf(buf + off, len - off, "</EventNotificationAlert>");
+}
+
+/**
+ * \brief   发一条上行消息, 发送队列满时稍等重试
+ */
+static void record_send(const char *method, const char *msg_type, const char *body, int qos, int response, unsigned int seq)
+{
+    ezdev_sdk_kernel_pubmsg_v3 pubmsg;
+    int retry = 0;
+
+    memset(&pubmsg, 0, sizeof(pubmsg));
+    pubmsg.msg_qos = qos ? QOS_T1 : QOS_T0;
+    pubmsg.msg_response = (EZDEV_SDK_UINT8)response;
+    pubmsg.msg_seq = seq;
+    pubmsg.msg_body = (unsigned char *)body;
+    pubmsg.msg_body_len = (EZDEV_SDK_UINT32)strlen(body);
+    snprintf(pubmsg.resource_id, sizeof(pubmsg.resource_id), "0");
+    snprintf(pubmsg.resource_type, sizeof(pubmsg.resource_type), "global");
+    snprintf(pubmsg.module, sizeof(pubmsg.module), STANDIN_KERNEL_MODULE);
+    snprintf(pubmsg.method, sizeof(pubmsg.method), "%s", method);
+    snprintf(pubmsg.msg_type, sizeof(pubmsg.msg_type), "%s", msg_type);
+    for (retry = 0; retry < 1000 && ezdev_sdk_kernel_queue_full == ezdev_sdk_kernel_send_v3(&pubmsg); retry++)
+    {
+        usleep(1000);
+    }
+}
+
+/**
+ * \brief   应用收到下发的设置后回一条应答
+ */
+static int record_answer(int timeout_ms)
+{
+    standin_kernel_msg msg;
+    int answered = 0;
+
+    while (0 == standin_kernel_pop(&msg, timeout_ms))
+    {
+        if (0 == strcmp(msg.msg_type, "set"))
+        {
+            record_send(msg.method, "set_reply", "{\"code\":0}", 0, 1, msg.seq);
+        }
+        standin_kernel_msg_free(&msg);
+        answered++;
+        timeout_ms = 0;
+    }
+    return answered;
+}
+
+static void record_publish(standin_das *das, const char *method, const char *msg_type, const char *body, unsigned int seq)
+{
+    char topic[256];
+    char common[32];
+
+    standin_kernel_down_topic(topic, sizeof(topic), method, msg_type);
+    snprintf(common, sizeof(common), "{\"Seq\":%u}", seq);
+    standin_das_publish(das, topic, common, body, strlen(body));
+}
+
+/**
+ * \brief   在子进程里录一段流量, 写到path
+ */
+static int record_shape(int cipher, const char *path)
+{
+    standin_das *das = standin_das_start(cipher, g_key);
+    standin_kernel_config config;
+    sdk_trace_config trace;
+    standin_msg msg;
+    char *body = (char *)malloc(16 * 1024);
+    unsigned int seq = RECORD_SEQ_BASE;
+    unsigned int down = 0;
+    unsigned int up = 0;
+    unsigned int delivered = 0;
+    uint64_t until = 0;
+    int i = 0;
+    int rv = -1;
+
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = cipher;
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS))
+    {
+        fprintf(stderr, "record: kernel did not come online\n");
+        standin_das_stop(das);
+        free(body);
+        return -1;
+    }
+
+    memset(&trace, 0, sizeof(trace));
+    trace.trace_write = record_write;
+    ezdev_sdk_kernel_set_trace(&trace);
+
+    /* 上线后平台一次下发的配置, 设备逐条应答 */
+    for (i = 0; i < 30; i++)
+    {
+        fill_json(body, 1024 + test_rand_below(3 * 1024), (unsigned int)i);
+        record_publish(das, "config", "set", body, seq++);
+        down++;
+        usleep(5 * 1000);
+        delivered += record_answer(0);
+    }
+    /* 告警突发 */
+    for (i = 0; i < 100; i++)
+    {
+        snprintf(body, 256, "{\"type\":\"motion\",\"channel\":%d,\"time\":%d,\"pic\":\"/pic/%08d.jpg\"}", i % 4, 1600000000 + i, i);
+        record_send("event", "alarm", body, 1, 0, 0);
+        up++;
+    }
+    delivered += record_answer(0);
+    /* ISAPI XML大报文, 不超过16K的收包缓冲 */
+    for (i = 0; i < 8; i++)
+    {
+        fill_xml(body, 8 * 1024 + test_rand_below(4 * 1024), (unsigned int)i);
+        record_publish(das, "isapi", "dump", body, seq++);
+        down++;
+        usleep(20 * 1000);
+        delivered += record_answer(0);
+    }
+    /* 周期上报, 偶尔有下发 */
+    until = test_now_ns() + 2000ULL * 1000 * 1000;
+    for (i = 0; test_now_ns() < until; i++)
+    {
+        snprintf(body, 512, "{\"temperature\":%d,\"rssi\":-%d,\"uptime\":%d,\"storage\":{\"total\":65536,\"free\":%d}}", 30 + i % 10, 40 + i % 30, i * 50, 40000 - i);
+        record_send("attribute", "report", body, i % 2, 0, 0);
+        up++;
+        if (0 == i % 4)
+        {
+            snprintf(body, 256, "{\"led\":%d,\"volume\":%d}", i % 2, i % 100);
+            record_publish(das, "attribute", "set", body, seq++);
+            down++;
+        }
+        delivered += record_answer(50);
+    }
+
+    /* 等应答送完, 所有上行都有发送结果 */
+    until = test_now_ns() + (uint64_t)DRAIN_MS * 1000 * 1000;
+    while (test_now_ns() < until)
+    {
+        delivered += record_answer(10);
+        while (0 == standin_das_pop(das, &msg, 0))
+        {
+            standin_msg_free(&msg);
+        }
+        pthread_mutex_lock(&g_rec_lock);
+        rv = delivered >= down && g_rec_sent >= g_rec_out ? 0 : -1;
+        pthread_mutex_unlock(&g_rec_lock);
+        if (0 == rv)
+        {
+            break;
+        }
+    }
+    ezdev_sdk_kernel_set_trace(NULL);
+    if (0 != rv)
+    {
+        fprintf(stderr, "record: %u/%u downlinks delivered, %d/%d uplinks sent\n", delivered, down, g_rec_sent, g_rec_out);
+    }
+    rv = trace_save(&g_rec, path);
+    printf("recorded %u downlinks, %u uplinks plus %u replies, %zu bytes\n", down, up, down - 8, g_rec.len);
+
+    standin_kernel_stop();
+    standin_das_stop(das);
+    free(g_rec.data);
+    free(body);
+    return rv;
+}
+
+/* ------------------------------------------------------------------------- */
+/* 回放                                                                       */
+/* ------------------------------------------------------------------------- */
+
+enum
+{
+    stage_call = 0,     ///<    下行: 替身下发; 上行: 调用发送接口
+    stage_queued,       ///<    下行: 微内核解密完成; 上行: 进入发送队列
+    stage_sent,         ///<    上行: 发送完成
+    stage_done,         ///<    下行: 应用收到; 上行: 替身收到
+    stage_count
+};
+
+typedef struct
+{
+    uint32_t seq;
+    uint32_t bytes;
+    int dropped;        ///<    发送队列满被拒, 随后重试的是另一条
+    uint64_t t[stage_count];
+} stage_entry;
+
+/**
+ * \brief   seq到各阶段时间点的开放寻址表, seq 0不用
+ */
+typedef struct
+{
+    stage_entry *slots;
+    uint32_t mask;
+    uint32_t count;
+    uint32_t done;
+} stage_table;
+
+static void stage_table_init(stage_table *table, uint32_t records)
+{
+    uint32_t size = 64;
+
+    while (size < records * 2)
+    {
+        size *= 2;
+    }
+    table->slots = (stage_entry *)calloc(size, sizeof(stage_entry));
+    table->mask = size - 1;
+    table->count = 0;
+    table->done = 0;
+}
+
+static stage_entry *stage_find(stage_table *table, uint32_t seq, int create);
+
+/**
+ * \brief   队列满重试的消息每次拿新seq, 条目数可能超过记录数, 半满时加倍
+ */
+static void stage_table_grow(stage_table *table)
+{
+    stage_table grown;
+    uint32_t i = 0;
+
+    grown.slots = (stage_entry *)calloc((size_t)(table->mask + 1) * 2, sizeof(stage_entry));
+    if (NULL == grown.slots)
+    {
+        return;
+    }
+    grown.mask = table->mask * 2 + 1;
+    grown.count = 0;
+    grown.done = table->done;
+    for (i = 0; i <= table->mask; i++)
+    {
+        if (0 != table->slots[i].seq)
+        {
+            *stage_find(&grown, table->slots[i].seq, 1) = table->slots[i];
+        }
+    }
+    free(table->slots);
+    *table = grown;
+}
+
+static stage_entry *stage_find(stage_table *table, uint32_t seq, int create)
+{
+    uint32_t i = 0;
+
+    if (0 == seq)
+    {
+        return NULL;
+    }
+    if (create && table->count * 2 >= table->mask)
+    {
+        stage_table_grow(table);
+    }
+    i = (seq * 2654435761u) & table->mask;
+    while (0 != table->slots[i].seq)
+    {
+        if (seq == table->slots[i].seq)
+        {
+            return &table->slots[i];
+        }
+        i = (i + 1) & table->mask;
+    }
+    if (!create || table->count >= table->mask)
+    {
+        return NULL;
+    }
+    table->slots[i].seq = seq;
+    table->count++;
+    return &table->slots[i];
+}
+
+static void stage_mark(stage_table *table, uint32_t seq, int stage, uint64_t now)
+{
+    stage_entry *entry = stage_find(table, seq, 1);
+
+    if (NULL != entry && 0 == entry->t[stage])
+    {
+        entry->t[stage] = now;
+        if (stage_done == stage && !entry->dropped)
+        {
+            table->done++;
+        }
+    }
+}
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static stage_table g_up;
+static stage_table g_down;
+static uint64_t g_call_ns = 0;          ///<    回放线程调用发送接口的时刻
+static volatile int g_stop = 0;
+
+static void replay_trace_write(const void *data, EZDEV_SDK_UINT32 len, EZDEV_SDK_PTR user)
+{
+    sdk_trace_record_info info;
+    uint64_t now = test_now_ns();
+    stage_entry *entry = NULL;
+
+    if (ezdev_sdk_kernel_succ != ezdev_sdk_kernel_trace_peek(data, len, &info))
+    {
+        return;
+    }
+    pthread_mutex_lock(&g_lock);
+    switch (info.type)
+    {
+    case sdk_trace_out_v2:
+    case sdk_trace_out_v3:
+        /* out记录在调用发送接口的线程里同步产生, seq是微内核最终用的 */
+        entry = stage_find(&g_up, info.seq, 1);
+        if (NULL != entry)
+        {
+            memset(entry->t, 0, sizeof(entry->t));
+            entry->dropped = 0;
+            entry->bytes = record_body_len((const unsigned char *)data, &info);
+            entry->t[stage_call] = g_call_ns;
+            entry->t[stage_queued] = now;
+        }
+        break;
+    case sdk_trace_sent:
+        entry = stage_find(&g_up, info.seq, 0);
+        if (NULL != entry && ezdev_sdk_kernel_queue_full == (ezdev_sdk_kernel_error)record_result((const unsigned char *)data, &info))
+        {
+            /* 没能入队, 重试时非应答消息会拿到新的seq */
+            entry->dropped = 1;
+            break;
+        }
+        stage_mark(&g_up, info.seq, stage_sent, now);
+        break;
+    case sdk_trace_in_v3:
+        stage_mark(&g_down, info.seq, stage_queued, now);
+        break;
+    default:
+        break;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void *server_thread(void *arg)
+{
+    standin_das *das = (standin_das *)arg;
+    const char *seq = NULL;
+    standin_msg msg;
+    uint64_t now = 0;
+
+    while (!g_stop)
+    {
+        if (0 != standin_das_pop(das, &msg, 50))
+        {
+            continue;
+        }
+        now = test_now_ns();
+        seq = strstr(msg.common, "\"Seq\":");
+        if (NULL != seq)
+        {
+            pthread_mutex_lock(&g_lock);
+            stage_mark(&g_up, (uint32_t)strtoul(seq + 6, NULL, 10), stage_done, now);
+            pthread_mutex_unlock(&g_lock);
+        }
+        standin_msg_free(&msg);
+    }
+    return NULL;
+}
+
+static void *app_thread(void *arg)
+{
+    standin_kernel_msg msg;
+    uint64_t now = 0;
+
+    while (!g_stop)
+    {
+        if (0 != standin_kernel_pop(&msg, 50))
+        {
+            continue;
+        }
+        now = test_now_ns();
+        pthread_mutex_lock(&g_lock);
+        stage_mark(&g_down, msg.seq, stage_done, now);
+        pthread_mutex_unlock(&g_lock);
+        standin_kernel_msg_free(&msg);
+    }
+    return NULL;
+}
+
+/**
+ * \brief   按记录重建v3下行topic和业务数据, 由替身下发; seq换成回放自己的编号
+ */
+static int replay_downlink(standin_das *das, const unsigned char *record, const sdk_trace_record_info *info, uint32_t seq)
+{
+    char resource_id[64];
+    char resource_type[64];
+    char module[64];
+    char method[64];
+    char msg_type[64];
+    char sub_serial[72];
+    char ext_msg[64];
+    char topic[512];
+    char common[32];
+    unsigned char *body = NULL;
+    uint32_t body_len = 0;
+    field_reader r;
+    stage_entry *entry = NULL;
+    int rv = 0;
+
+    r.p = record + TRACE_HEAD_LEN;
+    r.end = record + info->record_len;
+    r.error = 0;
+    read_str(&r, resource_id, sizeof(resource_id));
+    read_str(&r, resource_type, sizeof(resource_type));
+    read_str(&r, module, sizeof(module));
+    read_str(&r, method, sizeof(method));
+    read_str(&r, msg_type, sizeof(msg_type));
+    read_str(&r, sub_serial, sizeof(sub_serial));
+    read_str(&r, ext_msg, sizeof(ext_msg));
+    body_len = read32(&r);
+    if (r.error || 0 == body_len || body_len > 16 * 1024)
+    {
+        return -1;
+    }
+    body = (unsigned char *)malloc(body_len);
+    if (NULL == body)
+    {
+        return -1;
+    }
+    if (record[2] & TRACE_FLAG_SCRUBBED)
+    {
+        memset(body, ' ', body_len);
+    }
+    else if ((uint32_t)(r.end - r.p) >= body_len)
+    {
+        memcpy(body, r.p, body_len);
+    }
+    else
+    {
+        free(body);
+        return -1;
+    }
+
+    /* 模块段改成替身注册的模块, 应用线程才能收到 */
+    snprintf(topic, sizeof(topic), "/iot/%s/%s/%s-%s/%s/%s/%s%s%s", STANDIN_KERNEL_SERIAL, sub_serial[0] ? sub_serial : "global",
+             resource_id[0] ? resource_id : "0", resource_type[0] ? resource_type : "global", STANDIN_KERNEL_MODULE, method, msg_type,
+             ext_msg[0] ? "/" : "", ext_msg);
+    snprintf(common, sizeof(common), "{\"Seq\":%u}", seq);
+
+    pthread_mutex_lock(&g_lock);
+    entry = stage_find(&g_down, seq, 1);
+    if (NULL != entry)
+    {
+        entry->bytes = body_len;
+        entry->t[stage_call] = test_now_ns();
+    }
+    pthread_mutex_unlock(&g_lock);
+    rv = standin_das_publish(das, topic, common, body, body_len);
+    free(body);
+    return rv;
+}
+
+typedef struct
+{
+    uint32_t up;
+    uint32_t down;
+    uint32_t down_v2;
+    uint32_t rejected;      ///<    录制时没能入队的out记录, 不回放
+    uint32_t retries;
+    uint32_t errors;
+    uint64_t *lag;
+    uint32_t lag_count;
+    uint64_t start;
+    uint64_t fed;
+} replay_result;
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_stage(const char *name, uint64_t *values, uint32_t count)
+{
+    if (0 == count)
+    {
+        printf("  %-26s %6u\n", name, count);
+        return;
+    }
+    qsort(values, count, sizeof(uint64_t), cmp_u64);
+    printf("  %-26s %6u %10.1f %10.1f %10.1f %10.1f\n", name, count, values[count * 50 / 100] / 1e3, values[count * 90 / 100] / 1e3,
+           values[count * 99 / 100] / 1e3, values[count - 1] / 1e3);
+}
+
+/**
+ * \brief   一个方向上两个阶段之间的时延, 两端都有时间点的消息才算
+ *          替身可能在发送线程写发送结果记录之前就读到报文, 这种按0算
+ */
+static void report_stage(const char *name, const stage_table *table, int from, int to, uint64_t *scratch)
+{
+    uint32_t count = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i <= table->mask; i++)
+    {
+        const stage_entry *entry = &table->slots[i];
+        if (0 != entry->seq && !entry->dropped && 0 != entry->t[from] && 0 != entry->t[to])
+        {
+            scratch[count++] = entry->t[to] > entry->t[from] ? entry->t[to] - entry->t[from] : 0;
+        }
+    }
+    print_stage(name, scratch, count);
+}
+
+static void report_direction(const char *name, const stage_table *table)
+{
+    uint64_t first = 0;
+    uint64_t last = 0;
+    uint64_t bytes = 0;
+    uint32_t expected = 0;
+    uint32_t done = 0;
+    uint32_t i = 0;
+    double seconds = 0;
+
+    for (i = 0; i <= table->mask; i++)
+    {
+        const stage_entry *entry = &table->slots[i];
+        if (0 == entry->seq || entry->dropped || 0 == entry->t[stage_call])
+        {
+            continue;
+        }
+        expected++;
+        if (0 == entry->t[stage_done])
+        {
+            continue;
+        }
+        done++;
+        bytes += entry->bytes;
+        first = 0 == first || entry->t[stage_call] < first ? entry->t[stage_call] : first;
+        last = entry->t[stage_done] > last ? entry->t[stage_done] : last;
+    }
+    seconds = last > first ? (last - first) / 1e9 : 0;
+    printf("  %-9s %6u msgs, %9.1f msg/s, %7.3f MB/s, %u missing\n", name, done, seconds > 0 ? done / seconds : 0,
+           seconds > 0 ? bytes / seconds / 1e6 : 0, expected - done);
+}
+
+static void replay_report(const char *mode, const replay_result *result)
+{
+    uint32_t size = (g_up.mask > g_down.mask ? g_up.mask : g_down.mask) + 1;
+    uint64_t *scratch = (uint64_t *)malloc((size > result->lag_count ? size : result->lag_count + 1) * sizeof(uint64_t));
+
+    printf("replay %s: fed %u uplinks (%u rejected by a full queue when recorded, skipped), %u downlinks (%u v2 in-process) in %.1f ms, %u queue-full retries, %u errors\n",
+           mode, result->up, result->rejected, result->down + result->down_v2, result->down_v2, (result->fed - result->start) / 1e6, result->retries,
+           result->errors);
+    report_direction("uplink", &g_up);
+    report_direction("downlink", &g_down);
+    printf("  %-26s %6s %10s %10s %10s %10s\n", "stage (us)", "n", "p50", "p90", "p99", "max");
+    report_stage("up call -> queued", &g_up, stage_call, stage_queued, scratch);
+    report_stage("up queued -> sent", &g_up, stage_queued, stage_sent, scratch);
+    report_stage("up sent -> server", &g_up, stage_sent, stage_done, scratch);
+    report_stage("up end to end", &g_up, stage_call, stage_done, scratch);
+    report_stage("down publish -> decrypted", &g_down, stage_call, stage_queued, scratch);
+    report_stage("down decrypted -> app", &g_down, stage_queued, stage_done, scratch);
+    report_stage("down end to end", &g_down, stage_call, stage_done, scratch);
+    if (0 != result->lag_count)
+    {
+        memcpy(scratch, result->lag, result->lag_count * sizeof(uint64_t));
+        print_stage("schedule lag", scratch, result->lag_count);
+    }
+    free(scratch);
+}
+
+/**
+ * \brief   在子进程里回放一遍; speed为0时尽快送入
+ */
+static int replay_run(const trace_buf *trace, int cipher, double speed)
+{
+    standin_das *das = standin_das_start(cipher, g_key);
+    standin_kernel_config config;
+    sdk_trace_config trace_config;
+    sdk_trace_record_info info;
+    replay_result result;
+    pthread_t server;
+    pthread_t app;
+    const unsigned char *record = NULL;
+    ezdev_sdk_kernel_error kernel_error = ezdev_sdk_kernel_succ;
+    uint32_t records = 0;
+    uint32_t pending = 0;
+    uint64_t target = 0;
+    uint64_t now = 0;
+    uint64_t until = 0;
+    size_t off = 0;
+    char mode[32];
+
+    memset(&result, 0, sizeof(result));
+    for (off = 0; off < trace->len && ezdev_sdk_kernel_succ == ezdev_sdk_kernel_trace_peek(trace->data + off, (EZDEV_SDK_UINT32)(trace->len - off), &info);
+         off += info.record_len)
+    {
+        records++;
+    }
+    stage_table_init(&g_up, records);
+    stage_table_init(&g_down, records);
+    result.lag = (uint64_t *)calloc(records + 1, sizeof(uint64_t));
+
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = cipher;
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS))
+    {
+        fprintf(stderr, "replay: kernel did not come online\n");
+        standin_das_stop(das);
+        return -1;
+    }
+    memset(&trace_config, 0, sizeof(trace_config));
+    trace_config.trace_write = replay_trace_write;
+    trace_config.scrub = sdk_trace_scrub_body;
+    ezdev_sdk_kernel_set_trace(&trace_config);
+    pthread_create(&server, NULL, server_thread, das);
+    pthread_create(&app, NULL, app_thread, NULL);
+
+    result.start = test_now_ns();
+    for (off = 0; off < trace->len; off += info.record_len)
+    {
+        record = trace->data + off;
+        if (ezdev_sdk_kernel_succ != ezdev_sdk_kernel_trace_peek(record, (EZDEV_SDK_UINT32)(trace->len - off), &info))
+        {
+            fprintf(stderr, "replay: bad record at offset %zu\n", off);
+            break;
+        }
+        if (sdk_trace_header == info.type || sdk_trace_sent == info.type)
+        {
+            continue;
+        }
+        if ((sdk_trace_out_v2 == info.type || sdk_trace_out_v3 == info.type) && out_rejected(trace->data, trace->len, off, &info))
+        {
+            result.rejected++;
+            continue;
+        }
+        if (speed > 0)
+        {
+            target = result.start + (uint64_t)(info.time_ms * 1e6 / speed);
+            now = test_now_ns();
+            if (target > now)
+            {
+                usleep((useconds_t)((target - now) / 1000));
+                now = test_now_ns();
+            }
+            result.lag[result.lag_count++] = now > target ? now - target : 0;
+        }
+
+        switch (info.type)
+        {
+        case sdk_trace_in_v3:
+            result.down++;
+            result.errors += 0 != replay_downlink(das, record, &info, result.down);
+            break;
+        case sdk_trace_in_v2:
+            result.down_v2++;
+            result.errors += ezdev_sdk_kernel_succ != ezdev_sdk_kernel_trace_replay(record, info.record_len);
+            break;
+        default:
+            result.up++;
+            for (;;)
+            {
+                pthread_mutex_lock(&g_lock);
+                g_call_ns = test_now_ns();
+                pthread_mutex_unlock(&g_lock);
+                kernel_error = ezdev_sdk_kernel_trace_replay(record, info.record_len);
+                if (ezdev_sdk_kernel_queue_full != kernel_error)
+                {
+                    break;
+                }
+                result.retries++;
+                usleep(1000);
+            }
+            result.errors += ezdev_sdk_kernel_succ != kernel_error;
+            break;
+        }
+    }
+    result.fed = test_now_ns();
+
+    /* 等所有消息到达终点 */
+    until = result.fed + (uint64_t)DRAIN_MS * 1000 * 1000;
+    do
+    {
+        usleep(1000);
+        pthread_mutex_lock(&g_lock);
+        pending = result.up + result.down - result.errors - g_up.done - g_down.done;
+        pthread_mutex_unlock(&g_lock);
+    } while (0 != pending && test_now_ns() < until);
+
+    g_stop = 1;
+    pthread_join(server, NULL);
+    pthread_join(app, NULL);
+    ezdev_sdk_kernel_set_trace(NULL);
+
+    if (speed > 0)
+    {
+        snprintf(mode, sizeof(mode), "recorded x%g", speed);
+    }
+    else
+    {
+        snprintf(mode, sizeof(mode), "afap");
+    }
+    replay_report(mode, &result);
+
+    standin_kernel_stop();
+    standin_das_stop(das);
+    free(result.lag);
+    free(g_up.slots);
+    free(g_down.slots);
+    return 0;
+}
+
+static int run_child(int (*fn)(const trace_buf *, int, double), const trace_buf *trace, int cipher, double speed)
+{
+    pid_t pid = fork();
+    int status = 0;
+
+    if (0 == pid)
+    {
+        status = fn(trace, cipher, speed);
+        fflush(stdout);
+        _exit(0 == status ? 0 : 1);
+    }
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && 0 == WEXITSTATUS(status) ? 0 : -1;
+}
+
+static const char *g_record_path = NULL;
+
+static int record_child(const trace_buf *trace, int cipher, double speed)
+{
+    return record_shape(cipher, g_record_path);
+}
+
+static void trace_summary(const trace_buf *trace)
+{
+    sdk_trace_record_info info;
+    uint32_t counts[sdk_trace_sent + 1];
+    uint32_t span = 0;
+    size_t off = 0;
+
+    memset(counts, 0, sizeof(counts));
+    for (off = 0; off < trace->len && ezdev_sdk_kernel_succ == ezdev_sdk_kernel_trace_peek(trace->data + off, (EZDEV_SDK_UINT32)(trace->len - off), &info);
+         off += info.record_len)
+    {
+        counts[info.type <= sdk_trace_sent ? info.type : sdk_trace_header]++;
+        span = info.time_ms > span ? info.time_ms : span;
+    }
+    printf("trace: %zu bytes, %u ms, in v3 %u, in v2 %u, out v3 %u, out v2 %u, sent %u\n", trace->len, span, counts[sdk_trace_in_v3],
+           counts[sdk_trace_in_v2], counts[sdk_trace_out_v3], counts[sdk_trace_out_v2], counts[sdk_trace_sent]);
+}
+
+int main(int argc, char **argv)
+{
+    const char *save = NULL;
+    const char *path = NULL;
+    char temp[64];
+    trace_buf trace;
+    double speed = 1.0;
+    int recorded = 0;
+    int afap = 0;
+    int cipher = STANDIN_CIPHER_CBC;
+    int rv = 0;
+    int i = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "-recorded"))
+        {
+            recorded = 1;
+        }
+        else if (0 == strcmp(argv[i], "-afap"))
+        {
+            afap = 1;
+        }
+        else if (0 == strncmp(argv[i], "-speed=", 7))
+        {
+            speed = atof(argv[i] + 7);
+            recorded = 1;
+        }
+        else if (0 == strcmp(argv[i], "-gcm"))
+        {
+            cipher = STANDIN_CIPHER_GCM;
+        }
+        else if (0 == strncmp(argv[i], "-save=", 6))
+        {
+            save = argv[i] + 6;
+        }
+        else if ('-' != argv[i][0])
+        {
+            path = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-recorded|-afap] [-speed=X] [-gcm] [-save=<file>] [trace file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!recorded && !afap)
+    {
+        recorded = afap = 1;
+    }
+    if (speed <= 0)
+    {
+        speed = 1.0;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (NULL == path)
+    {
+        snprintf(temp, sizeof(temp), "/tmp/bench_trace_replay.%d", (int)getpid());
+        g_record_path = NULL != save ? save : temp;
+        if (0 != run_child(record_child, NULL, cipher, 0))
+        {
+            fprintf(stderr, "recording failed\n");
+            return 1;
+        }
+        path = g_record_path;
+    }
+    memset(&trace, 0, sizeof(trace));
+    if (0 != trace_load(&trace, path))
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    if (path == temp)
+    {
+        unlink(temp);
+    }
+    trace_summary(&trace);
+    fflush(stdout);
+
+    if (recorded && 0 != run_child(replay_run, &trace, cipher, speed))
+    {
+        rv = 1;
+    }
+    if (afap && 0 != run_child(replay_run, &trace, cipher, 0))
+    {
+        rv = 1;
+    }
+    free(trace.data);
+    return rv;
+}
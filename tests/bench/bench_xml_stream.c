@@ -0,0 +1,161 @@
+/**
+ * \file      bench_xml_stream.c
+ * \brief     ezxml_parse_str与ezxml_stream的吞吐和峰值内存对比
+ *
+ * 文档仿照设备配置下发的ISAPI报文, 按16K/256K/4M三种大小生成. ezxml每轮要
+ * 先复制一份(解析会改写输入), 复制的时间和内存也算在内, 因为调用方同样要付出.
+ * ezxml_stream按1K分片喂入, 模拟边解密边解析.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "ezxml.h"
+#include "ezxml_stream.h"
+#include "test_util.h"
+
+#define FEED_CHUNK 1024
+
+static size_t g_events = 0;
+
+static int count_cb(void *user, ezxml_stream_event event, const char *name, const char *value, size_t len)
+{
+    (void)user;
+    (void)event;
+    (void)name;
+    (void)value;
+    (void)len;
+    g_events++;
+    return 0;
+}
+
+static char *make_document(size_t target, size_t *out_len)
+{
+    size_t cap = target + 4096;
+    char *doc = malloc(cap);
+    size_t len = 0;
+    unsigned i = 0;
+
+    len += snprintf(doc + len, cap - len, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<ISAPI version=\"2.0\">\n");
+    while (len < target)
+    {
+        len += snprintf(doc + len, cap - len,
+                        "  <Channel id=\"%u\" enabled=\"true\">\n"
+                        "    <Name>Camera &amp; Door %u</Name>\n"
+                        "    <Video codec=\"H.265\" width=\"1920\" height=\"1080\" fps=\"25\"/>\n"
+                        "    <Motion sensitivity=\"%u\"><Region>0,0;640,0;640,480;0,480</Region></Motion>\n"
+                        "    <Desc><![CDATA[<free text> %u]]></Desc>\n"
+                        "  </Channel>\n",
+                        i, i, i % 100, i);
+        i++;
+    }
+    len += snprintf(doc + len, cap - len, "</ISAPI>\n");
+
+    *out_len = len;
+    return doc;
+}
+
+static void bench_dom(const char *label, const char *doc, size_t len, unsigned rounds)
+{
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start;
+    uint64_t elapsed;
+    unsigned i;
+    char name[64];
+
+    test_alloc_reset_peak();
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        char *copy = malloc(len);
+        ezxml_t xml;
+
+        memcpy(copy, doc, len);
+        xml = ezxml_parse_str(copy, len);
+        if (xml == NULL || *ezxml_error(xml))
+        {
+            fprintf(stderr, "ezxml failed\n");
+            exit(1);
+        }
+        ezxml_free(xml);
+        free(copy);
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+
+    snprintf(name, sizeof(name), "ezxml_parse_str/%s", label);
+    bench_report(name, rounds, elapsed, after.allocs - before.allocs, (uint64_t)len * rounds);
+    printf("%-40s %12zu peak heap bytes\n", name, after.peak_bytes - before.cur_bytes);
+}
+
+static void bench_stream(const char *label, const char *doc, size_t len, unsigned rounds)
+{
+    test_alloc_stat before;
+    test_alloc_stat after;
+    uint64_t start;
+    uint64_t elapsed;
+    unsigned i;
+    char name[64];
+
+    test_alloc_reset_peak();
+    test_alloc_snapshot(&before);
+    start = test_now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        ezxml_stream_t st = ezxml_stream_new(count_cb, NULL, 0);
+        size_t off;
+
+        for (off = 0; off < len; off += FEED_CHUNK)
+        {
+            size_t n = len - off < FEED_CHUNK ? len - off : FEED_CHUNK;
+            if (ezxml_stream_feed(st, doc + off, n) != 0)
+            {
+                fprintf(stderr, "ezxml_stream failed: %s\n", ezxml_stream_error(st));
+                exit(1);
+            }
+        }
+        if (ezxml_stream_finish(st) != 0)
+        {
+            fprintf(stderr, "ezxml_stream failed: %s\n", ezxml_stream_error(st));
+            exit(1);
+        }
+        ezxml_stream_free(st);
+    }
+    elapsed = test_now_ns() - start;
+    test_alloc_snapshot(&after);
+
+    snprintf(name, sizeof(name), "ezxml_stream/%s", label);
+    bench_report(name, rounds, elapsed, after.allocs - before.allocs, (uint64_t)len * rounds);
+    printf("%-40s %12zu peak heap bytes\n", name, after.peak_bytes - before.cur_bytes);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *label;
+        size_t size;
+        unsigned rounds;
+    } cases[] = {{"16K", 16 * 1024, 2000}, {"256K", 256 * 1024, 100}, {"4M", 4 * 1024 * 1024, 2}};
+    unsigned scale = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    size_t i;
+
+    if (scale == 0)
+    {
+        scale = 1;
+    }
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        size_t len;
+        char *doc = make_document(cases[i].size, &len);
+        unsigned rounds = cases[i].rounds * scale;
+
+        bench_dom(cases[i].label, doc, len, rounds);
+        bench_stream(cases[i].label, doc, len, rounds);
+        free(doc);
+    }
+
+    printf("events: %zu\n", g_events);
+    return 0;
+}
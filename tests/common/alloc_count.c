@@ -0,0 +1,122 @@
+/**
+ * \file      alloc_count.c
+ * \brief     替换glibc的malloc族函数统计分配次数、累计申请字节和峰值占用, 只链接进基准测试程序
+ *
+ * 实际分配仍交给__libc_malloc等, 字节数按malloc_usable_size计, 计数用原子操作,
+ * 多线程下也能用. 非glibc环境下不替换, 计数保持为0.
+ */
+#define _GNU_SOURCE
+#include "test_util.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static uint64_t g_allocs = 0;
+static uint64_t g_frees = 0;
+static size_t g_cur_bytes = 0;
+static size_t g_peak_bytes = 0;
+static uint64_t g_alloc_bytes = 0;
+
+static void account_alloc(void *ptr, size_t size)
+{
+    size_t cur;
+    size_t peak;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&g_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&g_alloc_bytes, size, __ATOMIC_RELAXED);
+    cur = __atomic_add_fetch(&g_cur_bytes, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&g_peak_bytes, __ATOMIC_RELAXED);
+    while (cur > peak && !__atomic_compare_exchange_n(&g_peak_bytes, &peak, cur, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+static void account_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&g_frees, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&g_cur_bytes, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    account_alloc(ptr, size);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __libc_calloc(nmemb, size);
+    account_alloc(ptr, nmemb * size);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+
+    account_free(ptr);
+    new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr == NULL && ptr != NULL && size != 0)
+    {
+        //原块还在, 补回计数
+        __atomic_sub_fetch(&g_frees, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&g_cur_bytes, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    account_alloc(new_ptr, size);
+    return new_ptr;
+}
+
+void free(void *ptr)
+{
+    account_free(ptr);
+    __libc_free(ptr);
+}
+
+void test_alloc_snapshot(test_alloc_stat *stat)
+{
+    stat->allocs = __atomic_load_n(&g_allocs, __ATOMIC_RELAXED);
+    stat->frees = __atomic_load_n(&g_frees, __ATOMIC_RELAXED);
+    stat->cur_bytes = __atomic_load_n(&g_cur_bytes, __ATOMIC_RELAXED);
+    stat->peak_bytes = __atomic_load_n(&g_peak_bytes, __ATOMIC_RELAXED);
+    stat->alloc_bytes = __atomic_load_n(&g_alloc_bytes, __ATOMIC_RELAXED);
+}
+
+void test_alloc_reset_peak(void)
+{
+    __atomic_store_n(&g_peak_bytes, __atomic_load_n(&g_cur_bytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+#else
+
+void test_alloc_snapshot(test_alloc_stat *stat)
+{
+    stat->allocs = 0;
+    stat->frees = 0;
+    stat->cur_bytes = 0;
+    stat->peak_bytes = 0;
+    stat->alloc_bytes = 0;
+}
+
+void test_alloc_reset_peak(void)
+{
+}
+
+#endif
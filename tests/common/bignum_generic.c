@@ -0,0 +1,55 @@
+/**
+ * \file      bignum_generic.c
+ * \brief     components/mbedtls/bignum.c的第二份编译: 关掉汇编, 内层循环用bn_mul.h的C实现
+ *
+ * 对外的bscomptls_mpi_*都改名为generic_mpi_*, 与库里的版本链接在同一个程序中, 作为比对基准.
+ * limb宽度与库里相同, bscomptls_mpi可以在两份实现之间直接传递.
+ */
+#define BSCOMPTLS_CONFIG_FILE "bignum_generic_config.h"
+
+#define bscomptls_mpi_add_abs generic_mpi_add_abs
+#define bscomptls_mpi_add_int generic_mpi_add_int
+#define bscomptls_mpi_add_mpi generic_mpi_add_mpi
+#define bscomptls_mpi_bitlen generic_mpi_bitlen
+#define bscomptls_mpi_cmp_abs generic_mpi_cmp_abs
+#define bscomptls_mpi_cmp_int generic_mpi_cmp_int
+#define bscomptls_mpi_cmp_mpi generic_mpi_cmp_mpi
+#define bscomptls_mpi_copy generic_mpi_copy
+#define bscomptls_mpi_div_int generic_mpi_div_int
+#define bscomptls_mpi_div_mpi generic_mpi_div_mpi
+#define bscomptls_mpi_exp_mod generic_mpi_exp_mod
+#define bscomptls_mpi_fill_random generic_mpi_fill_random
+#define bscomptls_mpi_free generic_mpi_free
+#define bscomptls_mpi_gcd generic_mpi_gcd
+#define bscomptls_mpi_gen_prime generic_mpi_gen_prime
+#define bscomptls_mpi_get_bit generic_mpi_get_bit
+#define bscomptls_mpi_grow generic_mpi_grow
+#define bscomptls_mpi_init generic_mpi_init
+#define bscomptls_mpi_inv_mod generic_mpi_inv_mod
+#define bscomptls_mpi_is_prime generic_mpi_is_prime
+#define bscomptls_mpi_lsb generic_mpi_lsb
+#define bscomptls_mpi_lset generic_mpi_lset
+#define bscomptls_mpi_mod_int generic_mpi_mod_int
+#define bscomptls_mpi_mod_mpi generic_mpi_mod_mpi
+#define bscomptls_mpi_mul_int generic_mpi_mul_int
+#define bscomptls_mpi_mul_mpi generic_mpi_mul_mpi
+#define bscomptls_mpi_read_file generic_mpi_read_file
+#define bscomptls_mpi_read_binary generic_mpi_read_binary
+#define bscomptls_mpi_read_string generic_mpi_read_string
+#define bscomptls_mpi_safe_cond_assign generic_mpi_safe_cond_assign
+#define bscomptls_mpi_safe_cond_swap generic_mpi_safe_cond_swap
+#define bscomptls_mpi_set_bit generic_mpi_set_bit
+#define bscomptls_mpi_shift_l generic_mpi_shift_l
+#define bscomptls_mpi_shift_r generic_mpi_shift_r
+#define bscomptls_mpi_shrink generic_mpi_shrink
+#define bscomptls_mpi_size generic_mpi_size
+#define bscomptls_mpi_sub_abs generic_mpi_sub_abs
+#define bscomptls_mpi_sub_int generic_mpi_sub_int
+#define bscomptls_mpi_sub_mpi generic_mpi_sub_mpi
+#define bscomptls_mpi_swap generic_mpi_swap
+#define bscomptls_mpi_self_test generic_mpi_self_test
+#define bscomptls_mpi_write_binary generic_mpi_write_binary
+#define bscomptls_mpi_write_string generic_mpi_write_string
+#define bscomptls_mpi_write_file generic_mpi_write_file
+
+#include "../../components/mbedtls/bignum.c"
@@ -0,0 +1,23 @@
+/**
+ * \file      bignum_generic.h
+ * \brief     不用汇编的bignum实现(bignum_generic.c), 与库里的版本比对结果和速度
+ */
+#ifndef H_BIGNUM_GENERIC_H_
+#define H_BIGNUM_GENERIC_H_
+
+#include "mbedtls/bignum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int generic_mpi_mul_mpi(bscomptls_mpi *X, const bscomptls_mpi *A, const bscomptls_mpi *B);
+int generic_mpi_mod_mpi(bscomptls_mpi *R, const bscomptls_mpi *A, const bscomptls_mpi *B);
+int generic_mpi_exp_mod(bscomptls_mpi *X, const bscomptls_mpi *A, const bscomptls_mpi *E, const bscomptls_mpi *N, bscomptls_mpi *_RR);
+int generic_mpi_inv_mod(bscomptls_mpi *X, const bscomptls_mpi *A, const bscomptls_mpi *N);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
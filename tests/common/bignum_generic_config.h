@@ -0,0 +1,13 @@
+/**
+ * \file      bignum_generic_config.h
+ * \brief     bignum_generic.c用的配置: SDK的配置去掉汇编和MULX/ADX路径
+ */
+#ifndef H_BIGNUM_GENERIC_CONFIG_H_
+#define H_BIGNUM_GENERIC_CONFIG_H_
+
+#include "mbedtls/config.h"
+
+#undef BSCOMPTLS_HAVE_ASM
+#undef BSCOMPTLS_BIGNUM_ADX
+
+#endif
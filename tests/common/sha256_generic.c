@@ -0,0 +1,19 @@
+/**
+ * \file      sha256_generic.c
+ * \brief     components/mbedtls/sha256.c的第二份编译: 不用扩展指令, 走SHA-256的C实现(BSCOMPTLS_SHA256_SMALLER)
+ *
+ * 对外的bscomptls_sha256*都改名为generic_sha256*, 与库里的版本链接在同一个程序中, 作为比对基准.
+ */
+#define BSCOMPTLS_CONFIG_FILE "sha_generic_config.h"
+
+#define bscomptls_sha256 generic_sha256
+#define bscomptls_sha256_clone generic_sha256_clone
+#define bscomptls_sha256_finish generic_sha256_finish
+#define bscomptls_sha256_free generic_sha256_free
+#define bscomptls_sha256_init generic_sha256_init
+#define bscomptls_sha256_process generic_sha256_process
+#define bscomptls_sha256_starts generic_sha256_starts
+#define bscomptls_sha256_update generic_sha256_update
+#define bscomptls_sha256_self_test generic_sha256_self_test
+
+#include "../../components/mbedtls/sha256.c"
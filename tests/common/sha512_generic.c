@@ -0,0 +1,19 @@
+/**
+ * \file      sha512_generic.c
+ * \brief     components/mbedtls/sha512.c的第二份编译: 不用扩展指令, 走SHA-512紧凑的轮循环和80字的消息扩展(BSCOMPTLS_SHA512_SMALLER)
+ *
+ * 对外的bscomptls_sha512*都改名为generic_sha512*, 与库里的版本链接在同一个程序中, 作为比对基准.
+ */
+#define BSCOMPTLS_CONFIG_FILE "sha_generic_config.h"
+
+#define bscomptls_sha512 generic_sha512
+#define bscomptls_sha512_clone generic_sha512_clone
+#define bscomptls_sha512_finish generic_sha512_finish
+#define bscomptls_sha512_free generic_sha512_free
+#define bscomptls_sha512_init generic_sha512_init
+#define bscomptls_sha512_process generic_sha512_process
+#define bscomptls_sha512_starts generic_sha512_starts
+#define bscomptls_sha512_update generic_sha512_update
+#define bscomptls_sha512_self_test generic_sha512_self_test
+
+#include "../../components/mbedtls/sha512.c"
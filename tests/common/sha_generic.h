@@ -0,0 +1,21 @@
+/**
+ * \file      sha_generic.h
+ * \brief     不用CPU扩展指令的SHA-256/SHA-512实现(sha256_generic.c, sha512_generic.c), 与库里的版本比对结果和速度
+ */
+#ifndef H_SHA_GENERIC_H_
+#define H_SHA_GENERIC_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void generic_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224);
+void generic_sha512(const unsigned char *input, size_t ilen, unsigned char output[64], int is384);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,15 @@
+/**
+ * \file      sha_generic_config.h
+ * \brief     sha256_generic.c/sha512_generic.c用的配置: SDK的配置去掉SHA-NI和ARMv8路径, SHA-512用紧凑的轮循环
+ */
+#ifndef H_SHA_GENERIC_CONFIG_H_
+#define H_SHA_GENERIC_CONFIG_H_
+
+#include "mbedtls/config.h"
+
+#undef BSCOMPTLS_SHA256_SHANI
+#undef BSCOMPTLS_SHA256_A64_CRYPTO
+#undef BSCOMPTLS_SHA512_A64_CRYPTO
+#define BSCOMPTLS_SHA512_SMALLER
+
+#endif
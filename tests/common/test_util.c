@@ -0,0 +1,99 @@
+/**
+ * \file      test_util.c
+ * \brief     测试公共函数
+ */
+#define _GNU_SOURCE
+#include "test_util.h"
+#include <string.h>
+#include <time.h>
+
+int test_failures = 0;
+
+static uint64_t g_rand_state = 0x9E3779B97F4A7C15ULL;
+
+int test_report(const char *name)
+{
+    if (test_failures)
+    {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+uint64_t test_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void test_rand_seed(uint64_t seed)
+{
+    g_rand_state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+uint64_t test_rand(void)
+{
+    g_rand_state ^= g_rand_state >> 12;
+    g_rand_state ^= g_rand_state << 25;
+    g_rand_state ^= g_rand_state >> 27;
+    return g_rand_state * 0x2545F4914F6CDD1DULL;
+}
+
+uint32_t test_rand_below(uint32_t n)
+{
+    return n ? (uint32_t)((test_rand() >> 32) % n) : 0;
+}
+
+static size_t read_status_kb(const char *key)
+{
+    char line[256];
+    size_t kb = 0;
+    size_t key_len = strlen(key);
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (0 == strncmp(line, key, key_len))
+        {
+            sscanf(line + key_len, "%zu", &kb);
+            break;
+        }
+    }
+
+    fclose(fp);
+    return kb;
+}
+
+size_t test_rss_kb(void)
+{
+    return read_status_kb("VmRSS:");
+}
+
+size_t test_rss_peak_kb(void)
+{
+    return read_status_kb("VmHWM:");
+}
+
+void bench_report(const char *name, uint64_t ops, uint64_t elapsed_ns, uint64_t allocs, uint64_t bytes)
+{
+    double ns_op = ops ? (double)elapsed_ns / (double)ops : 0;
+    double allocs_op = ops ? (double)allocs / (double)ops : 0;
+
+    if (bytes && elapsed_ns)
+    {
+        printf("%-40s %12.1f ns/op %8.2f allocs/op %10.1f MB/s\n", name, ns_op, allocs_op,
+               (double)bytes * 1000.0 / (double)elapsed_ns);
+    }
+    else
+    {
+        printf("%-40s %12.1f ns/op %8.2f allocs/op\n", name, ns_op, allocs_op);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * \file      test_util.h
+ * \brief     单元测试和基准测试共用的断言、计时和分配计数
+ */
+#ifndef H_TEST_UTIL_H_
+#define H_TEST_UTIL_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int test_failures;
+
+/**
+ * \brief   条件不成立时打印位置并记一次失败, 不中断当前用例
+ */
+#define TEST_CHECK(cond)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            test_failures++;                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                                       \
+    } while (0)
+
+#define TEST_CHECK_MSG(cond, ...)                                               \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            test_failures++;                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                       \
+            fputc('\n', stderr);                                                \
+        }                                                                       \
+    } while (0)
+
+/**
+ * \brief   打印结果并返回进程退出码, 0表示全部通过
+ */
+int test_report(const char *name);
+
+/**
+ * \brief   单调时钟, 纳秒
+ */
+uint64_t test_now_ns(void);
+
+/**
+ * \brief   可复现的伪随机数(xorshift64*), seed为0时取固定种子
+ */
+void test_rand_seed(uint64_t seed);
+uint64_t test_rand(void);
+uint32_t test_rand_below(uint32_t n);
+
+/**
+ * \brief   进程内malloc/calloc/realloc/free计数, 只有链接了alloc_count.c的程序才有效
+ */
+typedef struct
+{
+    uint64_t allocs;     ///< 分配次数(含realloc)
+    uint64_t frees;      ///< 释放次数
+    size_t cur_bytes;    ///< 当前占用
+    size_t peak_bytes;   ///< 自上次清零以来的峰值
+    uint64_t alloc_bytes; ///< 累计申请的字节数(含realloc), 按申请大小计
+} test_alloc_stat;
+
+void test_alloc_snapshot(test_alloc_stat *stat);
+void test_alloc_reset_peak(void);
+
+/**
+ * \brief   进程当前/峰值常驻内存(KB), 读取/proc/self/status, 不支持时返回0
+ */
+size_t test_rss_kb(void);
+size_t test_rss_peak_kb(void);
+
+/**
+ * \brief   基准测试输出一行: 名称, 每次操作耗时, 每次操作分配次数, 可选吞吐
+ */
+void bench_report(const char *name, uint64_t ops, uint64_t elapsed_ns, uint64_t allocs, uint64_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * \file      fuzz.h
+ * \brief     不可信输入解析器的模糊测试入口
+ *
+ * 每个入口按SDK收到数据时的做法调用一个解析器, 输入任意字节都不能崩溃、越界或泄漏.
+ * fuzz_entry.c把其中一个包装成LLVMFuzzerTestOneInput, 与libFuzzer链接, 或者与fuzz_main.c链接成
+ * 可以跑语料、接AFL的独立程序; bench_parsers在同一组入口上统计ns/op和allocs/op.
+ */
+#ifndef H_FUZZ_H_
+#define H_FUZZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief   LBS入口的输入前缀: 16字节密钥 + 设备的随机数r1, 后面是从套接字读到的响应报文
+ *
+ * 密钥按报文不同是共享密钥(认证II)、主密钥(刷新会话密钥II)或新会话密钥(DAS信息响应).
+ */
+#define FUZZ_LBS_KEY_LEN        16
+#define FUZZ_LBS_PREFIX_LEN     (FUZZ_LBS_KEY_LEN + 1)
+
+typedef int (*fuzz_entry_fn)(const uint8_t *data, size_t size);
+
+/**
+ * \brief   设置解析器用到的平台接口(定时器、随机数、互斥锁), 可以重复调用
+ */
+void fuzz_platform_init(void);
+
+int fuzz_json(const uint8_t *data, size_t size);
+int fuzz_xml(const uint8_t *data, size_t size);
+int fuzz_mqtt(const uint8_t *data, size_t size);
+int fuzz_lbs_authentication_ii(const uint8_t *data, size_t size);
+int fuzz_lbs_refreshsessionkey_ii(const uint8_t *data, size_t size);
+int fuzz_lbs_crypto_data_das(const uint8_t *data, size_t size);
+int fuzz_das_topic(const uint8_t *data, size_t size);
+int fuzz_das_header(const uint8_t *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,378 @@
+/**
+ * \file      fuzz_capture.c
+ * \brief     从替身服务端抓取模糊测试的种子语料
+ *
+ * 用法: fuzz_capture <语料根目录>, 种子写到<语料根目录>/<入口名去掉fuzz_>/<内容的SHA-1>, 已有的同名文件直接覆盖.
+ * 微内核快速上线连到standin_das, 会话密钥有效期2秒, 期间向standin_lbs换一次密钥, 抓下:
+ * - mqtt: 替身发给设备的每个MQTT报文(CONNACK、SUBACK、PUBLISH、PUBACK...), 外加整个会话连起来的一份
+ * - das_topic/das_header: 各种下行的topic和加密前的负载, 包括分片、LZ4压缩、空业务数据和v2 topic
+ * - json/xml: 通用协议体、业务数据和LBS下发的DAS信息
+ * - lbs_refreshsessionkey_ii/lbs_crypto_data_das: 刷新会话密钥II和DAS信息响应, 前面拼上设备一侧的密钥和r1(见fuzz.h)
+ * - lbs_authentication_ii: 替身不实现ECDH认证, 按lbs_transport.c的格式合成: 正常响应、平台错误码、认证方式不匹配
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "mbedtls/sha1.h"
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel_struct.h"
+#include "dev_protocol_def.h"
+#include "ezdev_sdk_kernel_compress.h"
+#include "ezdev_ecdh_support.h"
+#include "ase_support.h"
+#include "test_util.h"
+#include "standin_das.h"
+#include "standin_lbs.h"
+#include "standin_kernel.h"
+#include "fuzz.h"
+
+ASE_SUPPORT_INTERFACE
+EZDEV_SDK_KERNEL_COMPRESS_INTERFACE
+
+#define WAIT_MS             5000
+#define ROTATE_WAIT_MS      10000
+#define KEY_LIFETIME        2
+#define CAPTURE_SESSION_MAX (256 * 1024)
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+static const unsigned char g_master_key[16] = {'f', 'e', 'd', 'c', 'b', 'a', '9', '8', '7', '6', '5', '4', '3', '2', '1', '0'};
+static const unsigned char g_share_key[32] = {'s', 'h', 'a', 'r', 'e', 'k', 'e', 'y', '0', '1', '2', '3', '4', '5', '6', '7'};
+
+static const char *g_root = NULL;
+static int g_written = 0;
+
+static unsigned char g_session[CAPTURE_SESSION_MAX];
+static size_t g_session_len = 0;
+
+/**
+ * \brief   写一个种子, 文件名取内容的SHA-1, 相同内容只留一份
+ */
+static void write_seed(const char *target, const unsigned char *data, size_t len)
+{
+    unsigned char digest[20];
+    char path[1024];
+    size_t off = 0;
+    size_t i = 0;
+    FILE *fp = NULL;
+
+    off = snprintf(path, sizeof(path), "%s/%s", g_root, target);
+    if (0 != mkdir(path, 0755) && EEXIST != errno)
+    {
+        fprintf(stderr, "cannot create %s\n", path);
+        exit(1);
+    }
+    bscomptls_sha1(data, len, digest);
+    off += snprintf(path + off, sizeof(path) - off, "/");
+    for (i = 0; i < sizeof(digest); i++)
+    {
+        off += snprintf(path + off, sizeof(path) - off, "%02x", digest[i]);
+    }
+    fp = fopen(path, "wb");
+    if (NULL == fp || len != fwrite(data, 1, len, fp))
+    {
+        fprintf(stderr, "cannot write %s\n", path);
+        exit(1);
+    }
+    fclose(fp);
+    g_written++;
+}
+
+/**
+ * \brief   LBS种子: [16字节密钥][r1][响应报文]
+ */
+static void write_lbs_seed(const char *target, const unsigned char key[16], unsigned char r1, const unsigned char *frame, size_t len)
+{
+    unsigned char *seed = (unsigned char *)malloc(FUZZ_LBS_PREFIX_LEN + len);
+
+    memcpy(seed, key, FUZZ_LBS_KEY_LEN);
+    seed[FUZZ_LBS_KEY_LEN] = r1;
+    memcpy(seed + FUZZ_LBS_PREFIX_LEN, frame, len);
+    write_seed(target, seed, FUZZ_LBS_PREFIX_LEN + len);
+    free(seed);
+}
+
+/**
+ * \brief   加密前的负载里拆出通用协议体和业务数据, 都可能是JSON或XML
+ */
+static void write_plain_parts(const unsigned char *plain, size_t len)
+{
+    size_t common_len = 0;
+    const unsigned char *body = NULL;
+    size_t body_len = 0;
+
+    if (len < 2)
+    {
+        return;
+    }
+    common_len = ((size_t)plain[0] << 8) | plain[1];
+    if (2 + common_len > len)
+    {
+        return;
+    }
+    write_seed("json", plain + 2, common_len);
+    body = plain + 2 + common_len;
+    body_len = len - 2 - common_len;
+    if (body_len > 0 && ('{' == body[0] || '[' == body[0]))
+    {
+        write_seed("json", body, body_len);
+    }
+    else if (body_len > 0 && '<' == body[0])
+    {
+        write_seed("xml", body, body_len);
+    }
+}
+
+/**
+ * \brief   替身持锁调用, 只做拷贝和写文件
+ */
+static void on_das_capture(void *ctx, int kind, const unsigned char *data, size_t len)
+{
+    switch (kind)
+    {
+    case STANDIN_CAPTURE_MQTT:
+        write_seed("mqtt", data, len);
+        if (g_session_len + len <= sizeof(g_session))
+        {
+            memcpy(g_session + g_session_len, data, len);
+            g_session_len += len;
+        }
+        break;
+    case STANDIN_CAPTURE_TOPIC:
+        write_seed("das_topic", data, len);
+        break;
+    case STANDIN_CAPTURE_PLAIN:
+        write_seed("das_header", data, len);
+        write_plain_parts(data, len);
+        break;
+    default:
+        break;
+    }
+}
+
+static void on_lbs_capture(void *ctx, int cmd, const unsigned char key[16], unsigned char r1, const unsigned char *frame, size_t len)
+{
+    unsigned char plain[2048];
+    EZDEV_SDK_UINT32 plain_len = 0;
+    size_t head = 2;
+
+    if (DEV_PROTOCOL_RESPONSE_DEVID == cmd)
+    {
+        write_lbs_seed("lbs_refreshsessionkey_ii", key, r1, frame, len);
+    }
+    else if (DEV_PROTOCOL_CRYPTO_DATA_RSP == cmd)
+    {
+        write_lbs_seed("lbs_crypto_data_das", key, r1, frame, len);
+        /* 剩余长度可能占两个字节, 之后是3字节版本和1字节结果码, 再往后是CBC加密的DAS信息 */
+        while (head < len && (frame[head - 1] & 0x80))
+        {
+            head++;
+        }
+        if (len > head + 4 && len - head - 4 <= sizeof(plain) &&
+            mkernel_internal_succ == aes_cbc_128_dec_padding(key, frame + head + 4, (EZDEV_SDK_UINT32)(len - head - 4), plain, &plain_len))
+        {
+            write_seed("json", plain, plain_len);
+        }
+    }
+}
+
+/**
+ * \brief   合成认证II响应: 平台的P-384公钥用共享密钥GCM加密
+ * \param   auth_type   可变报文头里平台选的认证方式
+ * \param   result      平台结果码, 非0时后面不带公钥
+ */
+static void write_auth_ii(unsigned char auth_type, unsigned char result, const unsigned char *pubkey, size_t pubkey_len)
+{
+    unsigned char frame[256];
+    unsigned char cipher[ezdev_sdk_ecdh_key_len];
+    unsigned char tag[16];
+    EZDEV_SDK_UINT32 cipher_len = 0;
+    size_t payload_len = 3 + 1;
+    size_t off = 0;
+
+    if (0 == result)
+    {
+        aes_gcm_128_enc_padding(g_share_key, (unsigned char *)pubkey, (EZDEV_SDK_UINT32)pubkey_len, cipher, &cipher_len, tag, sizeof(tag));
+        payload_len += sizeof(tag) + cipher_len;
+    }
+    frame[off++] = (unsigned char)((DEV_PROTOCOL_AUTHENTICATION_II << 4) | 0x08);
+    frame[off++] = (unsigned char)(1 + payload_len);
+    frame[off++] = auth_type;
+    frame[off++] = 1;
+    frame[off++] = 0;
+    frame[off++] = 0;
+    frame[off++] = result;
+    if (0 == result)
+    {
+        memcpy(frame + off, tag, sizeof(tag));
+        off += sizeof(tag);
+        memcpy(frame + off, cipher, cipher_len);
+        off += cipher_len;
+    }
+    write_lbs_seed("lbs_authentication_ii", g_share_key, 0x5a, frame, off);
+}
+
+static void synthesize_auth_ii(void)
+{
+    bscomptls_ecdh_context peer;
+    unsigned char pubkey[ezdev_sdk_ecdh_key_len];
+    EZDEV_SDK_UINT32 pubkey_len = 0;
+
+    bscomptls_ecdh_init(&peer);
+    if (mkernel_internal_succ != ezdev_generate_publickey(&peer, pubkey, &pubkey_len))
+    {
+        fprintf(stderr, "cannot generate the peer key\n");
+        exit(1);
+    }
+    bscomptls_ecdh_free(&peer);
+
+    write_auth_ii(sdk_dev_auth_protocol_ecdh, 0, pubkey, pubkey_len);
+    write_auth_ii(sdk_dev_auth_protocol_ecdh, 3, pubkey, pubkey_len);
+    write_auth_ii(sdk_dev_auth_protocol_ecdh + 1, 0, pubkey, pubkey_len);
+}
+
+static void drain_downlinks(void)
+{
+    standin_kernel_msg msg;
+
+    while (0 == standin_kernel_pop(&msg, 200))
+    {
+        standin_kernel_msg_free(&msg);
+    }
+}
+
+/**
+ * \brief   下发各种形状的消息, 替身在加密前回调抓下topic和负载
+ */
+static void publish_downlinks(standin_das *das)
+{
+    static const char *xml_bodies[] = {
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Request><Channel id=\"1\">on</Channel><Mode>day</Mode></Request>",
+        "<!DOCTYPE r [<!ENTITY who \"cam&#x41;\">]><r a='&who;' b=\"&lt;&amp;&gt;\"><!-- note --><![CDATA[<raw>]]>&#20013;<e/></r>",
+        "<?xml version=\"1.0\"?>\n<ISAPI xmlns=\"http://www.isapi.org/ver20/XMLSchema\">\n  <ptz><pan>-10</pan><tilt>5</tilt></ptz>\n  <?pi data?>\n</ISAPI>\n",
+    };
+    static const char *json_bodies[] = {
+        "{\"enable\":1,\"level\":2.5,\"name\":\"\\u4e2d\\u6587 front door\",\"list\":[1,-2,3e2,null,true,false],\"obj\":{}}",
+        "{\"n\":[0,-0,0.1,1e-7,-1.5E+300,123456789012345678,4.9e-324,1.7976931348623157e308],\"s\":\"\\ud83d\\ude00\\t\\\"\\/\\b\"}",
+        "[[[[]]],{\"a\":{\"b\":{\"c\":[{\"d\":\"\"}]}}}]",
+    };
+    unsigned char raw[1024];
+    unsigned char packed[1024];
+    unsigned char binary[40];
+    EZDEV_SDK_UINT32 packed_len = 0;
+    char topic[256];
+    char common[256];
+    size_t i = 0;
+
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    for (i = 0; i < sizeof(json_bodies) / sizeof(json_bodies[0]); i++)
+    {
+        standin_das_publish(das, topic, "{\"Seq\":1}", json_bodies[i], strlen(json_bodies[i]));
+    }
+    for (i = 0; i < sizeof(xml_bodies) / sizeof(xml_bodies[0]); i++)
+    {
+        standin_das_publish(das, topic, "{\"Seq\":2}", xml_bodies[i], strlen(xml_bodies[i]));
+    }
+    standin_das_publish(das, topic, "{\"Seq\":3}", "", 0);
+    for (i = 0; i < sizeof(binary); i++)
+    {
+        binary[i] = (unsigned char)(i * 29 + 7);
+    }
+    standin_das_publish(das, topic, "{\"Seq\":4}", binary, sizeof(binary));
+
+    standin_das_publish(das, "/iot/" STANDIN_KERNEL_SERIAL "/global/0-global/model/service/set/attr/PrivacyStatus", "{\"Seq\":5}", "{\"data\":{\"value\":0}}", 20);
+    standin_das_publish(das, "/iot/" STANDIN_KERNEL_SERIAL "/C12345678/1-Video/ota/upgrade/inform", "{\"Seq\":6}", "{}", 2);
+    standin_das_publish(das, "/" STANDIN_KERNEL_SERIAL "/1000/2001", "{\"Seq\":7}", "{\"v2\":true}", 11);
+
+    /* 分两片下发一个业务数据 */
+    for (i = 0; i < sizeof(raw); i++)
+    {
+        raw[i] = (unsigned char)('a' + i % 26);
+    }
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "frag");
+    snprintf(common, sizeof(common), "{\"Seq\":8,\"FragId\":1,\"FragOff\":0,\"FragTotal\":%u}", (unsigned)sizeof(raw));
+    standin_das_publish(das, topic, common, raw, sizeof(raw) / 2);
+    snprintf(common, sizeof(common), "{\"Seq\":8,\"FragId\":1,\"FragOff\":%u,\"FragTotal\":%u}", (unsigned)sizeof(raw) / 2, (unsigned)sizeof(raw));
+    standin_das_publish(das, topic, common, raw + sizeof(raw) / 2, sizeof(raw) / 2);
+
+    /* LZ4压缩的业务数据 */
+    if (mkernel_internal_succ == kernel_compress(raw, sizeof(raw), packed, sizeof(packed), &packed_len))
+    {
+        standin_kernel_down_topic(topic, sizeof(topic), "service", "packed");
+        snprintf(common, sizeof(common), "{\"Seq\":9,\"Compress\":%d,\"RawLen\":%u}", ezdev_sdk_das_compress_lz4, (unsigned)sizeof(raw));
+        standin_das_publish(das, topic, common, packed, packed_len);
+    }
+    drain_downlinks();
+}
+
+int main(int argc, char **argv)
+{
+    standin_kernel_config config;
+    standin_lbs_stats lbs_stats;
+    standin_das *das = NULL;
+    standin_lbs *lbs = NULL;
+    char topic[256];
+    int i = 0;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <corpus dir>\n", argv[0]);
+        return 2;
+    }
+    g_root = argv[1];
+    mkdir(g_root, 0755);
+
+    das = standin_das_start(STANDIN_CIPHER_CBC, g_key);
+    lbs = NULL != das ? standin_lbs_start(g_master_key, standin_das_port(das), STANDIN_CIPHER_CBC, 3600) : NULL;
+    if (NULL == lbs)
+    {
+        fprintf(stderr, "cannot start the stand-in servers\n");
+        return 1;
+    }
+    standin_das_set_capture(das, on_das_capture, NULL);
+    standin_lbs_set_capture(lbs, on_lbs_capture, NULL);
+
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = STANDIN_CIPHER_CBC;
+    config.key_lifetime = KEY_LIFETIME;
+    config.lbs_port = standin_lbs_port(lbs);
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS))
+    {
+        fprintf(stderr, "the kernel did not connect\n");
+        return 1;
+    }
+
+    publish_downlinks(das);
+    for (i = 0; i < 3; i++)
+    {
+        /* 上行QoS1, 替身回PUBACK */
+        standin_kernel_send("event", "report", "{\"up\":1}", 8, (unsigned int)i + 1);
+    }
+
+    if (0 != standin_kernel_wait_event(sdk_kernel_event_sessionkey_rotated, 1, ROTATE_WAIT_MS))
+    {
+        fprintf(stderr, "the session key was not rotated\n");
+        return 1;
+    }
+    standin_lbs_get_stats(lbs, &lbs_stats);
+    standin_das_set_key(das, lbs_stats.last_key, 1);
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    standin_das_publish(das, topic, "{\"Seq\":10}", "{\"after\":\"rekey\"}", 17);
+    drain_downlinks();
+    /* 公钥要用微内核的随机数服务, 在停止之前生成 */
+    synthesize_auth_ii();
+
+    standin_kernel_stop();
+    standin_das_set_capture(das, NULL, NULL);
+    standin_lbs_set_capture(lbs, NULL, NULL);
+    standin_lbs_stop(lbs);
+    standin_das_stop(das);
+
+    write_seed("mqtt", g_session, g_session_len);
+
+    printf("%s: %d seeds written to %s\n", argv[0], g_written, g_root);
+    return 0;
+}
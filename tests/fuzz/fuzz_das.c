@@ -0,0 +1,93 @@
+/**
+ * \file      fuzz_das.c
+ * \brief     DAS下行消息的topic和解密后报文头的解析
+ *
+ * topic的切分、v3/v2解析和通用协议体的反序列化都是das_transport.c里的静态函数, 这里直接把源文件包含进来.
+ * 本文件定义了das_transport.c的全部符号, 链接时静态库里的das_transport.o不会再被拉进来.
+ * - fuzz_das_topic: 输入是PUBLISH里的topic, 不以'\0'结尾
+ * - fuzz_das_header: 输入是解密后的负载 [2字节通用协议体长度][通用协议体JSON][业务数据],
+ *   与das_message_receive_v3解密之后的步骤相同: 定位、宽限期内的JSON检查、v3/v2通用协议体、分片重组、解压
+ */
+#include "das_transport.c"
+#include "fuzz.h"
+
+int fuzz_das_topic(const uint8_t *data, size_t size)
+{
+    ezdev_sdk_kernel_submsg_v3 submsg_v3;
+    ezdev_sdk_kernel_submsg submsg;
+    MQTTTopicLevels levels;
+    MQTTString topic = MQTTString_initializer;
+
+    if (size >= 512)
+    {
+        return 0;
+    }
+    topic.lenstring.data = (char *)data;
+    topic.lenstring.len = (int)size;
+    MQTTTopicIndex_split(&topic, &levels);
+
+    memset(&submsg_v3, 0, sizeof(submsg_v3));
+    ezdev_parse_topic_v3(&submsg_v3, &levels);
+    memset(&submsg, 0, sizeof(submsg));
+    ezdev_parse_topic_v2(&submsg, &levels);
+    return 0;
+}
+
+int fuzz_das_header(const uint8_t *data, size_t size)
+{
+    ezdev_sdk_kernel_submsg_v3 submsg_v3;
+    ezdev_sdk_kernel_submsg submsg;
+    unsigned char *plain = NULL;
+    EZDEV_SDK_UINT16 common_len = 0;
+    EZDEV_SDK_UINT32 body_len = 0;
+    EZDEV_SDK_UINT32 raw_len = 0;
+    das_frag_info frag;
+    EZDEV_SDK_BOOL complete = EZDEV_SDK_FALSE;
+    void *buf = NULL;
+    EZDEV_SDK_UINT32 buf_len = 0;
+
+    fuzz_platform_init();
+    /* 解密后的明文在接收缓冲区里, 末尾写了'\0' */
+    plain = (unsigned char *)malloc(size + 1);
+    if (NULL == plain)
+    {
+        return 0;
+    }
+    memcpy(plain, data, size);
+    plain[size] = '\0';
+
+    do
+    {
+        if (mkernel_internal_succ != das_payload_locate(plain, (EZDEV_SDK_UINT32)size, &common_len, &body_len))
+        {
+            break;
+        }
+        das_payload_common_valid(plain, common_len);
+
+        memset(&submsg, 0, sizeof(submsg));
+        deserialize_common(plain + 2, common_len, &submsg, &raw_len);
+
+        memset(&submsg_v3, 0, sizeof(submsg_v3));
+        strcpy(submsg_v3.module, "fuzz");
+        if (mkernel_internal_succ != deserialize_common_v3(plain + 2, common_len, &submsg_v3, &raw_len, &frag))
+        {
+            break;
+        }
+        if (0 != frag.total)
+        {
+            if (0 == raw_len && mkernel_internal_succ == das_frag_assemble(&submsg_v3, &frag, plain + 2 + common_len, body_len, &complete) && complete)
+            {
+                free(submsg_v3.buf);
+            }
+            das_frag_fini();
+            break;
+        }
+        if (mkernel_internal_succ == das_payload_body_dup(plain + 2 + common_len, body_len, raw_len, &buf, &buf_len))
+        {
+            free(buf);
+        }
+    } while (0);
+
+    free(plain);
+    return 0;
+}
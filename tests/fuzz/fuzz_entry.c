@@ -0,0 +1,21 @@
+/**
+ * \file      fuzz_entry.c
+ * \brief     libFuzzer/AFL的入口, 编译时用-DFUZZ_ENTRY=<fuzz.h里的入口>选定解析器
+ */
+#include "fuzz.h"
+
+#ifndef FUZZ_ENTRY
+#error "define FUZZ_ENTRY to one of the entries in fuzz.h"
+#endif
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    fuzz_platform_init();
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    FUZZ_ENTRY(data, size);
+    return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * \file      fuzz_json.c
+ * \brief     bscJSON_Parse: DAS信息、通用协议体和业务数据的JSON
+ *
+ * 输入复制成'\0'结尾的字符串后解析; 解析成功时再打印并重新解析一次, 打印结果必须还能解析.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "bscJSON.h"
+#include "fuzz.h"
+
+int fuzz_json(const uint8_t *data, size_t size)
+{
+    char *text = (char *)malloc(size + 1);
+    bscJSON *root = NULL;
+    bscJSON *again = NULL;
+    char *printed = NULL;
+
+    if (NULL == text)
+    {
+        return 0;
+    }
+    memcpy(text, data, size);
+    text[size] = '\0';
+
+    root = bscJSON_Parse(text);
+    if (NULL != root)
+    {
+        printed = bscJSON_PrintUnformatted(root);
+        if (NULL != printed)
+        {
+            again = bscJSON_Parse(printed);
+            if (NULL == again)
+            {
+                abort();
+            }
+            bscJSON_Delete(again);
+            free(printed);
+        }
+        bscJSON_Delete(root);
+    }
+    free(text);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * \file      fuzz_lbs.c
+ * \brief     LBS响应的解析: 认证II、刷新会话密钥II和DAS信息响应
+ *
+ * 解析函数都是lbs_transport.c里的静态函数, 这里直接把源文件包含进来, 走wait_*从"套接字"读响应再解析,
+ * 与设备收到响应时完全一样. 输入的前FUZZ_LBS_PREFIX_LEN字节是设备这一侧的状态(见fuzz.h),
+ * 这样语料里的报文能解开, 变异能走到解密之后的长度检查和JSON解析.
+ * 本文件定义了lbs_transport.c的全部符号, 链接时静态库里的lbs_transport.o不会再被拉进来.
+ */
+#include "lbs_transport.c"
+#include "fuzz.h"
+
+static ezdev_sdk_kernel g_fuzz_lbs_kernel;
+static lbs_affair g_fuzz_lbs_affair;
+static bscomptls_ecdh_context g_fuzz_lbs_ecdh;
+static int g_fuzz_lbs_ready = 0;
+
+static const uint8_t *g_fuzz_lbs_data = NULL;
+static size_t g_fuzz_lbs_size = 0;
+static size_t g_fuzz_lbs_pos = 0;
+
+/**
+ * \brief   与平台的net_work_read一致: 读满read_len字节才算成功
+ */
+static ezdev_sdk_kernel_error fuzz_lbs_read(ezdev_sdk_net_work net_work, unsigned char *read_buf, EZDEV_SDK_INT32 read_len, EZDEV_SDK_INT32 read_timeout_ms)
+{
+    if (read_len < 0 || (size_t)read_len > g_fuzz_lbs_size - g_fuzz_lbs_pos)
+    {
+        g_fuzz_lbs_pos = g_fuzz_lbs_size;
+        return (ezdev_sdk_kernel_error)mkernel_internal_net_socket_closed;
+    }
+    memcpy(read_buf, g_fuzz_lbs_data + g_fuzz_lbs_pos, read_len);
+    g_fuzz_lbs_pos += read_len;
+    return (ezdev_sdk_kernel_error)mkernel_internal_succ;
+}
+
+static int fuzz_lbs_setup(void)
+{
+    unsigned char pubkey[ezdev_sdk_ecdh_key_len];
+    EZDEV_SDK_UINT32 pubkey_len = 0;
+
+    if (g_fuzz_lbs_ready)
+    {
+        return 0;
+    }
+    fuzz_platform_init();
+    memset(&g_fuzz_lbs_kernel, 0, sizeof(g_fuzz_lbs_kernel));
+    g_fuzz_lbs_kernel.platform_handle.net_work_read = fuzz_lbs_read;
+    g_fuzz_lbs_kernel.dev_cur_auth_type = sdk_dev_auth_protocol_ecdh;
+    if (mkernel_internal_succ != init_lbs_affair(&g_fuzz_lbs_kernel, &g_fuzz_lbs_affair, 0))
+    {
+        return -1;
+    }
+
+    /* 认证II的对端公钥要与这个密钥对协商, 密钥对只在启动时生成一次 */
+    bscomptls_ecdh_init(&g_fuzz_lbs_ecdh);
+    if (mkernel_internal_succ != ezdev_generate_publickey(&g_fuzz_lbs_ecdh, pubkey, &pubkey_len))
+    {
+        return -1;
+    }
+    g_fuzz_lbs_ready = 1;
+    return 0;
+}
+
+/**
+ * \brief   恢复成刚发出请求、等待响应时的状态, 返回响应报文的起始位置
+ */
+static int fuzz_lbs_begin(const uint8_t *data, size_t size, int out_cmd, unsigned char *key, size_t key_size)
+{
+    lbs_affair *affair = &g_fuzz_lbs_affair;
+
+    if (0 != fuzz_lbs_setup() || size < FUZZ_LBS_PREFIX_LEN)
+    {
+        return -1;
+    }
+    clear_lbs_affair_buf(affair);
+    memset(affair->global_in_packet.var_head_buf, 0, affair->global_in_packet.var_head_buf_Len);
+    affair->global_in_packet.var_head_buf_off = 0;
+    memset(key, 0, key_size);
+    memcpy(key, data, FUZZ_LBS_KEY_LEN);
+    affair->random_1 = data[FUZZ_LBS_KEY_LEN];
+
+    /* 认证I带可变报文头: 当前认证方式, 支持的个数, 支持的方式 */
+    affair->global_out_packet.head_buf[0] = (unsigned char)((out_cmd << 4) | 0x08);
+    affair->global_out_packet.var_head_buf[0] = sdk_dev_auth_protocol_ecdh;
+    affair->global_out_packet.var_head_buf[1] = 1;
+    affair->global_out_packet.var_head_buf[2] = sdk_dev_auth_protocol_ecdh;
+    affair->global_out_packet.var_head_buf_off = 3;
+    g_fuzz_lbs_kernel.dev_cur_auth_type = sdk_dev_auth_protocol_ecdh;
+
+    g_fuzz_lbs_data = data + FUZZ_LBS_PREFIX_LEN;
+    g_fuzz_lbs_size = size - FUZZ_LBS_PREFIX_LEN;
+    g_fuzz_lbs_pos = 0;
+    return 0;
+}
+
+int fuzz_lbs_authentication_ii(const uint8_t *data, size_t size)
+{
+    if (0 == fuzz_lbs_begin(data, size, DEV_PROTOCOL_AUTHENTICATION_I, g_fuzz_lbs_affair.share_key, sizeof(g_fuzz_lbs_affair.share_key)))
+    {
+        wait_authentication_ii(&g_fuzz_lbs_kernel, &g_fuzz_lbs_affair, &g_fuzz_lbs_ecdh);
+    }
+    return 0;
+}
+
+int fuzz_lbs_refreshsessionkey_ii(const uint8_t *data, size_t size)
+{
+    if (0 == fuzz_lbs_begin(data, size, DEV_PROTOCOL_REQUEST_DEVID, g_fuzz_lbs_affair.master_key, sizeof(g_fuzz_lbs_affair.master_key)))
+    {
+        wait_refreshsessionkey_ii(&g_fuzz_lbs_kernel, &g_fuzz_lbs_affair);
+    }
+    return 0;
+}
+
+int fuzz_lbs_crypto_data_das(const uint8_t *data, size_t size)
+{
+    das_info info;
+
+    if (0 == fuzz_lbs_begin(data, size, DEV_PROTOCOL_CRYPTO_DATA_REQ, g_fuzz_lbs_affair.session_key, sizeof(g_fuzz_lbs_affair.session_key)))
+    {
+        memset(&info, 0, sizeof(info));
+        wait_crypto_data_rsp_das(&g_fuzz_lbs_kernel, &g_fuzz_lbs_affair, &info);
+    }
+    return 0;
+}
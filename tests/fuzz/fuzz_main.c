@@ -0,0 +1,350 @@
+/**
+ * \file      fuzz_main.c
+ * \brief     不用libFuzzer时的驱动: 回放语料, 可选地在语料上做简单变异
+ *
+ * 用法: fuzz_<name> [-runs=N] [-seed=S] [-max_len=L] [文件或目录...]
+ * - 给出的文件和目录(只看一层)里的每个文件各跑一次; 什么都不给时从标准输入读一个输入, 可以直接接AFL
+ *   (afl-fuzz -i <语料> -o <输出> -- ./fuzz_<name> @@)
+ * - -runs=N 回放之后再跑N个变异输入: 位翻转、特殊值、插入、删除、重复一段、与另一个语料拼接、截断.
+ *   种子固定, 同样的参数得到同样的输入序列
+ * - 崩溃(包括ASan报错)时把当前输入写到crash-<pid>, 可以直接拿来回放
+ * 其它以'-'开头的参数按libFuzzer的选项忽略.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "test_util.h"
+#include "fuzz.h"
+
+#define FUZZ_MAX_LEN_DEFAULT    (64 * 1024)
+
+extern int LLVMFuzzerInitialize(int *argc, char ***argv);
+extern int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+typedef struct
+{
+    uint8_t *data;
+    size_t size;
+} fuzz_input;
+
+static fuzz_input *g_corpus = NULL;
+static size_t g_corpus_count = 0;
+static size_t g_corpus_cap = 0;
+
+static const uint8_t *g_current = NULL;
+static size_t g_current_size = 0;
+
+/**
+ * \brief   崩溃时保存当前输入, 只用异步信号安全的调用
+ */
+static void save_current(void)
+{
+    char name[32];
+    int fd = -1;
+    size_t off = 0;
+    ssize_t n = 0;
+
+    if (NULL == g_current)
+    {
+        return;
+    }
+    snprintf(name, sizeof(name), "crash-%d", (int)getpid());
+    fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return;
+    }
+    while (off < g_current_size && (n = write(fd, g_current + off, g_current_size - off)) > 0)
+    {
+        off += (size_t)n;
+    }
+    close(fd);
+    write(STDERR_FILENO, "input saved to ", 15);
+    write(STDERR_FILENO, name, strlen(name));
+    write(STDERR_FILENO, "\n", 1);
+    g_current = NULL;
+}
+
+static void on_signal(int sig)
+{
+    save_current();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void run_one(const uint8_t *data, size_t size)
+{
+    g_current = data;
+    g_current_size = size;
+    LLVMFuzzerTestOneInput(data, size);
+    g_current = NULL;
+}
+
+static int read_all(FILE *fp, uint8_t **data, size_t *size)
+{
+    size_t cap = 4096;
+    size_t len = 0;
+    size_t n = 0;
+    uint8_t *buf = (uint8_t *)malloc(cap);
+
+    while (NULL != buf && (n = fread(buf + len, 1, cap - len, fp)) > 0)
+    {
+        len += n;
+        if (len == cap)
+        {
+            uint8_t *grown = (uint8_t *)realloc(buf, cap * 2);
+            if (NULL == grown)
+            {
+                free(buf);
+                return -1;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    if (NULL == buf)
+    {
+        return -1;
+    }
+    *data = buf;
+    *size = len;
+    return 0;
+}
+
+static void corpus_add_file(const char *path, size_t max_len)
+{
+    FILE *fp = fopen(path, "rb");
+    fuzz_input input;
+
+    if (NULL == fp)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        exit(1);
+    }
+    if (0 != read_all(fp, &input.data, &input.size))
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        exit(1);
+    }
+    fclose(fp);
+    if (input.size > max_len)
+    {
+        input.size = max_len;
+    }
+    if (g_corpus_count == g_corpus_cap)
+    {
+        g_corpus_cap = g_corpus_cap ? g_corpus_cap * 2 : 64;
+        g_corpus = (fuzz_input *)realloc(g_corpus, g_corpus_cap * sizeof(fuzz_input));
+    }
+    g_corpus[g_corpus_count++] = input;
+}
+
+static void corpus_add(const char *path, size_t max_len)
+{
+    struct stat st;
+    struct dirent **entries = NULL;
+    char file[4096];
+    int count = 0;
+    int i = 0;
+
+    if (0 != stat(path, &st))
+    {
+        fprintf(stderr, "cannot stat %s\n", path);
+        exit(1);
+    }
+    if (!S_ISDIR(st.st_mode))
+    {
+        corpus_add_file(path, max_len);
+        return;
+    }
+    count = scandir(path, &entries, NULL, alphasort);
+    for (i = 0; i < count; i++)
+    {
+        snprintf(file, sizeof(file), "%s/%s", path, entries[i]->d_name);
+        if (0 == stat(file, &st) && S_ISREG(st.st_mode))
+        {
+            corpus_add_file(file, max_len);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+}
+
+/**
+ * \brief   在buf上做一次变异, 返回新长度
+ */
+static size_t mutate_once(uint8_t *buf, size_t size, size_t max_len)
+{
+    static const uint8_t interesting[] = {0x00, 0x01, 0x7F, 0x80, 0xFF, '{', '}', '"', '<', '>', '/', '\\', ':', ','};
+    const fuzz_input *other = NULL;
+    size_t pos = size ? test_rand_below((uint32_t)size) : 0;
+    size_t len = 0;
+
+    switch (test_rand_below(8))
+    {
+    case 0:
+        if (size > 0)
+        {
+            buf[pos] ^= (uint8_t)(1u << test_rand_below(8));
+        }
+        break;
+    case 1:
+        if (size > 0)
+        {
+            buf[pos] = interesting[test_rand_below(sizeof(interesting))];
+        }
+        break;
+    case 2:
+        if (size > 0)
+        {
+            buf[pos] = (uint8_t)test_rand();
+        }
+        break;
+    case 3:
+        len = 1 + test_rand_below(8);
+        if (size + len <= max_len)
+        {
+            memmove(buf + pos + len, buf + pos, size - pos);
+            while (len-- > 0)
+            {
+                buf[pos + len] = (uint8_t)test_rand();
+                size++;
+            }
+        }
+        break;
+    case 4:
+        if (size > pos)
+        {
+            len = 1 + test_rand_below((uint32_t)(size - pos < 16 ? size - pos : 16));
+            memmove(buf + pos, buf + pos + len, size - pos - len);
+            size -= len;
+        }
+        break;
+    case 5:
+        if (size > pos)
+        {
+            len = 1 + test_rand_below((uint32_t)(size - pos < 64 ? size - pos : 64));
+            if (size + len <= max_len)
+            {
+                memmove(buf + pos + len, buf + pos, size - pos);
+                size += len;
+            }
+        }
+        break;
+    case 6:
+        other = &g_corpus[test_rand_below((uint32_t)g_corpus_count)];
+        if (other->size > 0)
+        {
+            len = test_rand_below((uint32_t)other->size);
+            if (pos + other->size - len > max_len)
+            {
+                break;
+            }
+            memcpy(buf + pos, other->data + len, other->size - len);
+            size = pos + other->size - len;
+        }
+        break;
+    default:
+        size = pos;
+        break;
+    }
+    return size;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long runs = 0;
+    unsigned long seed = 1;
+    size_t max_len = FUZZ_MAX_LEN_DEFAULT;
+    uint8_t *buf = NULL;
+    size_t size = 0;
+    fuzz_input input;
+    unsigned long r = 0;
+    unsigned k = 0;
+    int paths = 0;
+    int i = 0;
+
+    LLVMFuzzerInitialize(&argc, &argv);
+    if (NULL != __sanitizer_set_death_callback)
+    {
+        /* 信号交给ASan处理, 它打印完报告再回调 */
+        __sanitizer_set_death_callback(save_current);
+    }
+    else
+    {
+        signal(SIGSEGV, on_signal);
+        signal(SIGBUS, on_signal);
+        signal(SIGABRT, on_signal);
+        signal(SIGFPE, on_signal);
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if (0 == strncmp(argv[i], "-runs=", 6))
+        {
+            runs = strtoul(argv[i] + 6, NULL, 10);
+        }
+        else if (0 == strncmp(argv[i], "-seed=", 6))
+        {
+            seed = strtoul(argv[i] + 6, NULL, 10);
+        }
+        else if (0 == strncmp(argv[i], "-max_len=", 9))
+        {
+            max_len = strtoul(argv[i] + 9, NULL, 10);
+        }
+        else if ('-' != argv[i][0])
+        {
+            corpus_add(argv[i], max_len);
+            paths++;
+        }
+    }
+
+    if (0 == paths)
+    {
+        if (0 != read_all(stdin, &input.data, &input.size))
+        {
+            return 1;
+        }
+        run_one(input.data, input.size);
+        free(input.data);
+        return 0;
+    }
+
+    for (r = 0; r < g_corpus_count; r++)
+    {
+        run_one(g_corpus[r].data, g_corpus[r].size);
+    }
+
+    if (runs > 0 && g_corpus_count > 0)
+    {
+        test_rand_seed(seed);
+        buf = (uint8_t *)malloc(max_len + 1);
+        for (r = 0; r < runs; r++)
+        {
+            input = g_corpus[test_rand_below((uint32_t)g_corpus_count)];
+            size = input.size;
+            memcpy(buf, input.data, size);
+            for (k = 1 + test_rand_below(4); k > 0; k--)
+            {
+                size = mutate_once(buf, size, max_len);
+            }
+            run_one(buf, size);
+        }
+        free(buf);
+    }
+
+    printf("%s: %zu inputs, %lu mutations, ok\n", argv[0], g_corpus_count, runs);
+    for (r = 0; r < g_corpus_count; r++)
+    {
+        free(g_corpus[r].data);
+    }
+    free(g_corpus);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * \file      fuzz_mqtt.c
+ * \brief     DAS MQTT客户端的收包路径: readPacket, MQTTPacket_decode和各类报文的反序列化, 订阅匹配
+ *
+ * 输入是平台发给设备的字节流, 可以连着多个报文. 客户端与das_transport.c一样按需增长缓存,
+ * 订阅了设备的v3和v2前缀, 并挂着一个待确认的SUBACK; 每轮cycle()读一个报文, 读不出来就结束.
+ */
+#include <string.h>
+#include "sdk_kernel_def.h"
+#include "MQTTClient.h"
+#include "fuzz.h"
+
+#define FUZZ_MQTT_SERIAL    "STANDIN0001"
+
+extern int cycle(MQTTClient *c, Timer *timer);
+
+static const uint8_t *g_mqtt_data = NULL;
+static size_t g_mqtt_size = 0;
+static size_t g_mqtt_pos = 0;
+static volatile unsigned g_mqtt_sink = 0;
+
+static int mqtt_read(Network *n, unsigned char *buf, int len, int timeout_ms)
+{
+    size_t left = g_mqtt_size - g_mqtt_pos;
+
+    if (len <= 0)
+    {
+        return 0;
+    }
+    if ((size_t)len > left)
+    {
+        len = (int)left;
+    }
+    memcpy(buf, g_mqtt_data + g_mqtt_pos, len);
+    g_mqtt_pos += len;
+    return len;
+}
+
+static int mqtt_write(Network *n, unsigned char *buf, int len, int timeout_ms)
+{
+    return len;
+}
+
+/**
+ * \brief   读一遍负载, 让越界访问在这里暴露出来
+ */
+static void mqtt_handler(MessageData *md)
+{
+    const unsigned char *payload = (const unsigned char *)md->message->payload;
+    size_t i = 0;
+    unsigned sum = 0;
+
+    for (i = 0; i < md->message->payloadlen; i++)
+    {
+        sum += payload[i];
+    }
+    for (i = 0; i < (size_t)md->topicName->lenstring.len; i++)
+    {
+        sum += (unsigned char)md->topicName->lenstring.data[i];
+    }
+    g_mqtt_sink += sum;
+}
+
+int fuzz_mqtt(const uint8_t *data, size_t size)
+{
+    MQTTClient client;
+    Network network;
+    Timer timer;
+    size_t last = 0;
+
+    fuzz_platform_init();
+    memset(&client, 0, sizeof(client));
+    memset(&network, 0, sizeof(network));
+    network.mqttread = mqtt_read;
+    network.mqttwrite = mqtt_write;
+    g_mqtt_data = data;
+    g_mqtt_size = size;
+    g_mqtt_pos = 0;
+    MQTTNetSetLastError(mkernel_internal_succ);
+
+    if (SUCCESS != MQTTClientInitGrowable(&client, &network, 6 * 1000, ezdev_sdk_mqtt_buf_init, ezdev_sdk_send_buf_max,
+                                          ezdev_sdk_mqtt_buf_init, ezdev_sdk_recv_buf_max, ezdev_sdk_mqtt_buf_shrink_ms))
+    {
+        return 0;
+    }
+    MQTTTopicIndex_add(&client.topicIndex, "/iot/" FUZZ_MQTT_SERIAL "/#", mqtt_handler);
+    MQTTTopicIndex_add(&client.topicIndex, "/" FUZZ_MQTT_SERIAL "/#", mqtt_handler);
+    client.suback_state = MQTT_SUBACK_PENDING;
+    client.suback_id = 1;
+    client.suback_count = 2;
+    client.isconnected = 1;
+
+    TimerInit(&timer);
+    while (g_mqtt_pos < g_mqtt_size)
+    {
+        last = g_mqtt_pos;
+        TimerCountdownMS(&timer, 1000);
+        if (cycle(&client, &timer) < 0 || MQTTNetGetLastError() != mkernel_internal_succ || g_mqtt_pos == last)
+        {
+            break;
+        }
+    }
+    TimerFini(&timer);
+    MQTTClientFini(&client);
+    return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * \file      fuzz_platform.c
+ * \brief     模糊测试和解析器基准共用的平台接口设置
+ */
+#include "mkernel_internal_error.h"
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel_rng.h"
+#include "platform_define.h"
+#include "fuzz.h"
+
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_RNG_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+static int g_fuzz_platform_ready = 0;
+
+void fuzz_platform_init(void)
+{
+    ezdev_sdk_kernel_platform_handle *handle = &g_ezdev_sdk_kernel.platform_handle;
+
+    if (g_fuzz_platform_ready)
+    {
+        return;
+    }
+    handle->time_creator = Platform_TimerCreater;
+    handle->time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    handle->time_isexpired = Platform_TimerIsExpired;
+    handle->time_countdownms = Platform_TimerCountdownMS;
+    handle->time_countdown = Platform_TimerCountdown;
+    handle->time_leftms = Platform_TimerLeftMS;
+    handle->time_destroy = Platform_TimeDestroy;
+    handle->time_sleep = sdk_thread_sleep;
+    handle->thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle->thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle->thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle->thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    kernel_timer_service_init();
+    kernel_rng_service_init();
+    g_fuzz_platform_ready = 1;
+}
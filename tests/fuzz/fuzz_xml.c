@@ -0,0 +1,37 @@
+/**
+ * \file      fuzz_xml.c
+ * \brief     ezxml_parse_str: 业务数据里的XML
+ *
+ * ezxml_parse_str在输入缓冲区上原地解析, 这里每次复制一份. 解析成功时再序列化一次.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "ezxml.h"
+#include "fuzz.h"
+
+int fuzz_xml(const uint8_t *data, size_t size)
+{
+    char *text = (char *)malloc(size + 1);
+    char *printed = NULL;
+    ezxml_t xml = NULL;
+
+    if (NULL == text)
+    {
+        return 0;
+    }
+    memcpy(text, data, size);
+    text[size] = '\0';
+
+    xml = ezxml_parse_str(text, size);
+    if (NULL != xml)
+    {
+        if ('\0' == ezxml_error(xml)[0])
+        {
+            printed = ezxml_toxml(xml);
+            free(printed);
+        }
+        ezxml_free(xml);
+    }
+    free(text);
+    return 0;
+}
@@ -0,0 +1,912 @@
+/**
+ * \file      standin_das.c
+ * \brief     测试用的DAS替身实现
+ *
+ * 报文格式按das_transport.c: 明文 = [2字节通用协议体长度][通用协议体JSON][业务数据],
+ * CBC用会话密钥和固定IV加密并补齐到16字节; GCM为[8字节随机数][4字节计数][密文][16字节tag],
+ * nonce = iv ^ 报文头, 上下行iv取SHA256("ezDevSDK das gcm" || 会话密钥)的前后12字节.
+ * 这里的加解密直接调bscomptls, 不复用SDK里的封装, 两边各写一遍才能互相校验.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+#include "MQTTPacket.h"
+#include "standin_das.h"
+
+#define STANDIN_QUEUE_MAX   4096
+#define STANDIN_SALT_LEN    8
+
+/**
+ * \brief   报文头集合, 开放寻址, 值为第一次出现的连接序号
+ */
+typedef struct
+{
+    unsigned char (*keys)[STANDIN_GCM_SEQ_LEN];
+    int *values;
+    size_t cap;
+    size_t count;
+} standin_set;
+
+typedef struct
+{
+    unsigned char key[16];
+    unsigned char iv_up[12];
+    unsigned char iv_down[12];
+    bscomptls_gcm_context gcm;
+    bscomptls_aes_context aes_enc;
+    bscomptls_aes_context aes_dec;
+} standin_key;
+
+struct standin_das
+{
+    int listen_fd;
+    int client_fd;
+    int port;
+    int running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    int cipher;
+    standin_key cur;
+    standin_key prev;
+    int prev_valid;
+    int delay_ms;
+    int session_present;
+
+    unsigned char down_salt[STANDIN_SALT_LEN];
+    uint32_t down_count;
+    unsigned short packet_id;
+    unsigned char *last_down;
+    size_t last_down_len;
+
+    unsigned char *in_buf;
+    size_t in_len;
+    size_t in_cap;
+
+    standin_msg *queue;
+    size_t q_head;
+    size_t q_count;
+
+    standin_set nonces;
+    standin_set salts;
+    standin_das_stats stats;
+
+    standin_das_capture_fn capture;
+    void *capture_ctx;
+};
+
+static uint64_t fnv_hash(const unsigned char *p, size_t len)
+{
+    uint64_t h = 1469598103934665603ULL;
+    size_t i = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * \brief   查找key, 不存在时插入value; 返回已有的值, 新插入返回-1
+ */
+static int set_put(standin_set *set, const unsigned char *key, size_t key_len, int value)
+{
+    unsigned char k[STANDIN_GCM_SEQ_LEN] = {0};
+    size_t i = 0;
+
+    memcpy(k, key, key_len);
+    if ((set->count + 1) * 2 > set->cap)
+    {
+        standin_set grown;
+        grown.cap = set->cap ? set->cap * 2 : 1024;
+        grown.count = 0;
+        grown.keys = calloc(grown.cap, STANDIN_GCM_SEQ_LEN);
+        grown.values = calloc(grown.cap, sizeof(int));
+        for (i = 0; i < set->cap; i++)
+        {
+            if (set->values[i] != 0)
+            {
+                set_put(&grown, set->keys[i], STANDIN_GCM_SEQ_LEN, set->values[i]);
+            }
+        }
+        free(set->keys);
+        free(set->values);
+        *set = grown;
+    }
+
+    i = fnv_hash(k, sizeof(k)) & (set->cap - 1);
+    while (set->values[i] != 0)
+    {
+        if (0 == memcmp(set->keys[i], k, sizeof(k)))
+        {
+            return set->values[i];
+        }
+        i = (i + 1) & (set->cap - 1);
+    }
+    memcpy(set->keys[i], k, sizeof(k));
+    set->values[i] = value;
+    set->count++;
+    return -1;
+}
+
+static void set_free(standin_set *set)
+{
+    free(set->keys);
+    free(set->values);
+    memset(set, 0, sizeof(*set));
+}
+
+static void key_setup(standin_key *k, const unsigned char key[16])
+{
+    static const char label[] = "ezDevSDK das gcm";
+    unsigned char material[sizeof(label) - 1 + 16];
+    unsigned char digest[32];
+
+    memcpy(k->key, key, 16);
+    memcpy(material, label, sizeof(label) - 1);
+    memcpy(material + sizeof(label) - 1, key, 16);
+    bscomptls_sha256(material, sizeof(material), digest, 0);
+    memcpy(k->iv_up, digest, 12);
+    memcpy(k->iv_down, digest + 12, 12);
+
+    bscomptls_gcm_init(&k->gcm);
+    bscomptls_gcm_setkey(&k->gcm, BSCOMPTLS_CIPHER_ID_AES, key, 128);
+    bscomptls_aes_init(&k->aes_enc);
+    bscomptls_aes_setkey_enc(&k->aes_enc, key, 128);
+    bscomptls_aes_init(&k->aes_dec);
+    bscomptls_aes_setkey_dec(&k->aes_dec, key, 128);
+}
+
+static void key_free(standin_key *k)
+{
+    bscomptls_gcm_free(&k->gcm);
+    bscomptls_aes_free(&k->aes_enc);
+    bscomptls_aes_free(&k->aes_dec);
+}
+
+static void cbc_iv(unsigned char iv[16])
+{
+    int i = 0;
+
+    memset(iv, 0, 16);
+    for (i = 0; i < 8; i++)
+    {
+        iv[i] = (unsigned char)(0x30 + i);
+    }
+}
+
+/**
+ * \brief   解开一个上行报文, 成功时plain指向明文(在out里), 返回明文长度, 失败返回-1
+ */
+static long payload_decrypt(standin_das *das, standin_key *k, const unsigned char *payload, size_t len, unsigned char *out, unsigned char **plain)
+{
+    unsigned char iv[16];
+    unsigned char nonce[12];
+    size_t plain_len = 0;
+    unsigned char pad = 0;
+    size_t i = 0;
+
+    if (STANDIN_CIPHER_GCM == das->cipher)
+    {
+        if (len < STANDIN_GCM_SEQ_LEN + STANDIN_GCM_TAG_LEN)
+        {
+            return -1;
+        }
+        plain_len = len - STANDIN_GCM_SEQ_LEN - STANDIN_GCM_TAG_LEN;
+        for (i = 0; i < 12; i++)
+        {
+            nonce[i] = k->iv_up[i] ^ payload[i];
+        }
+        if (0 != bscomptls_gcm_auth_decrypt(&k->gcm, plain_len, nonce, 12, NULL, 0, payload + len - STANDIN_GCM_TAG_LEN, STANDIN_GCM_TAG_LEN,
+                                            payload + STANDIN_GCM_SEQ_LEN, out))
+        {
+            return -1;
+        }
+        *plain = out;
+        return (long)plain_len;
+    }
+
+    if (0 == len || 0 != len % 16)
+    {
+        return -1;
+    }
+    cbc_iv(iv);
+    bscomptls_aes_crypt_cbc(&k->aes_dec, BSCOMPTLS_AES_DECRYPT, len, iv, payload, out);
+    pad = out[len - 1];
+    if (0 == pad || pad > 16)
+    {
+        return -1;
+    }
+    for (i = 1; i <= pad; i++)
+    {
+        if (out[len - i] != pad)
+        {
+            return -1;
+        }
+    }
+    *plain = out;
+    return (long)(len - pad);
+}
+
+static int send_all(int fd, const unsigned char *buf, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len > 0)
+    {
+        n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            if (n < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * \brief   发给当前连接, 设置了抓包回调时先交给回调
+ */
+static int das_send(standin_das *das, const unsigned char *buf, size_t len)
+{
+    if (NULL != das->capture)
+    {
+        das->capture(das->capture_ctx, STANDIN_CAPTURE_MQTT, buf, len);
+    }
+    return send_all(das->client_fd, buf, len);
+}
+
+static void close_client(standin_das *das)
+{
+    if (das->client_fd >= 0)
+    {
+        close(das->client_fd);
+        das->client_fd = -1;
+    }
+    das->in_len = 0;
+    das->stats.connected = 0;
+}
+
+static void handle_publish(standin_das *das, unsigned char *pkt, size_t pkt_len)
+{
+    unsigned char dup = 0;
+    unsigned char retained = 0;
+    unsigned short packet_id = 0;
+    int qos = 0;
+    MQTTString topic;
+    unsigned char *payload = NULL;
+    int payload_len = 0;
+    unsigned char *out = NULL;
+    unsigned char *plain = NULL;
+    long plain_len = -1;
+    int prev_key = 0;
+    size_t common_len = 0;
+    standin_msg *msg = NULL;
+    unsigned char ack[4];
+    int prior = 0;
+
+    memset(&topic, 0, sizeof(topic));
+    if (1 != MQTTDeserialize_publish(&dup, &qos, &retained, &packet_id, &topic, &payload, &payload_len, pkt, (int)pkt_len))
+    {
+        das->stats.decrypt_errors++;
+        return;
+    }
+    if (qos > 0 && 4 == MQTTSerialize_puback(ack, sizeof(ack), packet_id))
+    {
+        das_send(das, ack, 4);
+    }
+
+    out = malloc((size_t)payload_len + 1);
+    plain_len = payload_decrypt(das, &das->cur, payload, (size_t)payload_len, out, &plain);
+    if (plain_len < 0 && das->prev_valid)
+    {
+        plain_len = payload_decrypt(das, &das->prev, payload, (size_t)payload_len, out, &plain);
+        prev_key = 1;
+    }
+    if (plain_len < 2 || (common_len = ((size_t)plain[0] << 8 | plain[1])) > (size_t)plain_len - 2 || das->q_count == STANDIN_QUEUE_MAX)
+    {
+        das->stats.decrypt_errors++;
+        free(out);
+        return;
+    }
+
+    if (STANDIN_CIPHER_GCM == das->cipher)
+    {
+        if (-1 != set_put(&das->nonces, payload, STANDIN_GCM_SEQ_LEN, das->stats.connects))
+        {
+            das->stats.nonce_reuse++;
+        }
+        prior = set_put(&das->salts, payload, STANDIN_SALT_LEN, das->stats.connects);
+        if (-1 != prior && prior != das->stats.connects)
+        {
+            das->stats.salt_reuse++;
+        }
+    }
+
+    msg = &das->queue[(das->q_head + das->q_count) % STANDIN_QUEUE_MAX];
+    memset(msg, 0, sizeof(*msg));
+    snprintf(msg->topic, sizeof(msg->topic), "%.*s", topic.lenstring.len, topic.lenstring.data);
+    snprintf(msg->common, sizeof(msg->common), "%.*s", (int)common_len, (const char *)plain + 2);
+    msg->body_len = (size_t)plain_len - 2 - common_len;
+    msg->body = malloc(msg->body_len + 1);
+    memcpy(msg->body, plain + 2 + common_len, msg->body_len);
+    msg->body[msg->body_len] = '\0';
+    msg->qos = qos;
+    msg->conn = das->stats.connects;
+    msg->prev_key = prev_key;
+    if (STANDIN_CIPHER_GCM == das->cipher)
+    {
+        memcpy(msg->seq, payload, STANDIN_GCM_SEQ_LEN);
+    }
+    das->q_count++;
+    das->stats.publishes++;
+    pthread_cond_broadcast(&das->cond);
+    free(out);
+}
+
+static void handle_packet(standin_das *das, unsigned char *pkt, size_t pkt_len)
+{
+    unsigned char reply[64];
+    int reply_len = 0;
+    int type = pkt[0] >> 4;
+    MQTTPacket_connectData conn = MQTTPacket_connectData_initializer;
+    unsigned char dup = 0;
+    unsigned short packet_id = 0;
+    int count = 0;
+    MQTTString filters[8];
+    int qos[8];
+    int granted[8];
+    int i = 0;
+
+    das->stats.packets_in++;
+    switch (type)
+    {
+    case CONNECT:
+        if (1 == MQTTDeserialize_connect(&conn, pkt, (int)pkt_len))
+        {
+            reply_len = MQTTSerialize_connack(reply, sizeof(reply), 0, (unsigned char)das->session_present);
+        }
+        break;
+    case SUBSCRIBE:
+        memset(filters, 0, sizeof(filters));
+        if (1 == MQTTDeserialize_subscribe(&dup, &packet_id, 8, &count, filters, qos, pkt, (int)pkt_len))
+        {
+            for (i = 0; i < count; i++)
+            {
+                granted[i] = qos[i];
+            }
+            reply_len = MQTTSerialize_suback(reply, sizeof(reply), packet_id, count, granted);
+            das->stats.subscribes++;
+            das->stats.conn_subscribes++;
+        }
+        break;
+    case UNSUBSCRIBE:
+        memset(filters, 0, sizeof(filters));
+        if (1 == MQTTDeserialize_unsubscribe(&dup, &packet_id, 8, &count, filters, pkt, (int)pkt_len))
+        {
+            reply_len = MQTTSerialize_unsuback(reply, sizeof(reply), packet_id);
+        }
+        break;
+    case PUBLISH:
+        if (0 == das->stats.first_publish_read)
+        {
+            das->stats.first_publish_read = das->stats.conn_reads;
+        }
+        handle_publish(das, pkt, pkt_len);
+        break;
+    case PUBACK:
+        das->stats.pubacks++;
+        break;
+    case PINGREQ:
+        reply[0] = PINGRESP << 4;
+        reply[1] = 0;
+        reply_len = 2;
+        das->stats.pings++;
+        break;
+    case DISCONNECT:
+        close_client(das);
+        break;
+    default:
+        break;
+    }
+
+    if (reply_len > 0 && das->client_fd >= 0)
+    {
+        das_send(das, reply, (size_t)reply_len);
+    }
+}
+
+/**
+ * \brief   从输入缓冲区里切出完整的MQTT报文逐个处理
+ */
+static void handle_input(standin_das *das)
+{
+    size_t off = 0;
+    size_t rem = 0;
+    size_t mult = 1;
+    size_t hdr = 0;
+    size_t i = 0;
+
+    while (das->client_fd >= 0 && das->in_len - off >= 2)
+    {
+        rem = 0;
+        mult = 1;
+        for (i = 1; i <= 4; i++)
+        {
+            if (off + i >= das->in_len)
+            {
+                return;
+            }
+            rem += (das->in_buf[off + i] & 127) * mult;
+            mult *= 128;
+            if (0 == (das->in_buf[off + i] & 128))
+            {
+                break;
+            }
+        }
+        hdr = i + 1;
+        if (das->in_len - off < hdr + rem)
+        {
+            break;
+        }
+        handle_packet(das, das->in_buf + off, hdr + rem);
+        off += hdr + rem;
+    }
+
+    if (das->client_fd >= 0 && off > 0)
+    {
+        memmove(das->in_buf, das->in_buf + off, das->in_len - off);
+        das->in_len -= off;
+    }
+}
+
+static void accept_client(standin_das *das)
+{
+    int fd = accept(das->listen_fd, NULL, NULL);
+    int one = 1;
+
+    if (fd < 0)
+    {
+        return;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    pthread_mutex_lock(&das->lock);
+    close_client(das);
+    das->client_fd = fd;
+    das->stats.connects++;
+    das->stats.connected = 1;
+    das->stats.conn_reads = 0;
+    das->stats.conn_subscribes = 0;
+    das->stats.first_publish_read = 0;
+    if (getrandom(das->down_salt, sizeof(das->down_salt), 0) != (ssize_t)sizeof(das->down_salt))
+    {
+        memcpy(das->down_salt, &das->stats.connects, sizeof(das->stats.connects));
+    }
+    das->down_count = 0;
+    pthread_cond_broadcast(&das->cond);
+    pthread_mutex_unlock(&das->lock);
+}
+
+static void *standin_thread(void *arg)
+{
+    standin_das *das = (standin_das *)arg;
+    struct pollfd fds[2];
+    int nfds = 0;
+    ssize_t n = 0;
+    int got = 0;
+
+    while (das->running)
+    {
+        nfds = 0;
+        fds[nfds].fd = das->listen_fd;
+        fds[nfds++].events = POLLIN;
+        pthread_mutex_lock(&das->lock);
+        if (das->client_fd >= 0)
+        {
+            fds[nfds].fd = das->client_fd;
+            fds[nfds++].events = POLLIN;
+        }
+        pthread_mutex_unlock(&das->lock);
+
+        if (poll(fds, nfds, 20) <= 0)
+        {
+            continue;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            accept_client(das);
+            continue;
+        }
+        if (nfds < 2 || 0 == fds[1].revents)
+        {
+            continue;
+        }
+
+        if (das->delay_ms > 0)
+        {
+            usleep((useconds_t)das->delay_ms * 1000);
+        }
+
+        pthread_mutex_lock(&das->lock);
+        got = 0;
+        while (das->client_fd == fds[1].fd)
+        {
+            if (das->in_cap - das->in_len < 4096)
+            {
+                das->in_cap = das->in_cap ? das->in_cap * 2 : 65536;
+                das->in_buf = realloc(das->in_buf, das->in_cap);
+            }
+            n = recv(das->client_fd, das->in_buf + das->in_len, das->in_cap - das->in_len, MSG_DONTWAIT);
+            if (n > 0)
+            {
+                das->in_len += (size_t)n;
+                got = 1;
+                continue;
+            }
+            if (0 == n || (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno))
+            {
+                handle_input(das);
+                close_client(das);
+                pthread_cond_broadcast(&das->cond);
+            }
+            break;
+        }
+        if (got)
+        {
+            das->stats.reads_in++;
+            das->stats.conn_reads++;
+            handle_input(das);
+        }
+        pthread_mutex_unlock(&das->lock);
+    }
+
+    return NULL;
+}
+
+standin_das *standin_das_start(int cipher, const unsigned char key[16])
+{
+    standin_das *das = calloc(1, sizeof(standin_das));
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+
+    das->client_fd = -1;
+    das->cipher = cipher;
+    key_setup(&das->cur, key);
+    das->queue = calloc(STANDIN_QUEUE_MAX, sizeof(standin_msg));
+    pthread_mutex_init(&das->lock, NULL);
+    pthread_cond_init(&das->cond, NULL);
+
+    das->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(das->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (0 != bind(das->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || 0 != listen(das->listen_fd, 8) ||
+        0 != getsockname(das->listen_fd, (struct sockaddr *)&addr, &addr_len))
+    {
+        fprintf(stderr, "standin das: listen failed: %s\n", strerror(errno));
+        close(das->listen_fd);
+        key_free(&das->cur);
+        free(das->queue);
+        free(das);
+        return NULL;
+    }
+    das->port = ntohs(addr.sin_port);
+
+    das->running = 1;
+    pthread_create(&das->thread, NULL, standin_thread, das);
+    return das;
+}
+
+void standin_das_stop(standin_das *das)
+{
+    standin_msg msg;
+
+    if (NULL == das)
+    {
+        return;
+    }
+    das->running = 0;
+    pthread_join(das->thread, NULL);
+    close_client(das);
+    close(das->listen_fd);
+    while (0 == standin_das_pop(das, &msg, 0))
+    {
+        standin_msg_free(&msg);
+    }
+    key_free(&das->cur);
+    if (das->prev_valid)
+    {
+        key_free(&das->prev);
+    }
+    set_free(&das->nonces);
+    set_free(&das->salts);
+    pthread_mutex_destroy(&das->lock);
+    pthread_cond_destroy(&das->cond);
+    free(das->queue);
+    free(das->in_buf);
+    free(das->last_down);
+    free(das);
+}
+
+int standin_das_port(const standin_das *das)
+{
+    return das->port;
+}
+
+void standin_das_set_key(standin_das *das, const unsigned char key[16], int keep_prev)
+{
+    pthread_mutex_lock(&das->lock);
+    if (das->prev_valid)
+    {
+        key_free(&das->prev);
+        das->prev_valid = 0;
+    }
+    if (keep_prev)
+    {
+        key_setup(&das->prev, das->cur.key);
+        das->prev_valid = 1;
+    }
+    key_free(&das->cur);
+    key_setup(&das->cur, key);
+    /* 新密钥下重新开始下行计数, 随机数也换掉 */
+    if (getrandom(das->down_salt, sizeof(das->down_salt), 0) != (ssize_t)sizeof(das->down_salt))
+    {
+        das->down_salt[0]++;
+    }
+    das->down_count = 0;
+    pthread_mutex_unlock(&das->lock);
+}
+
+void standin_das_set_delay(standin_das *das, int delay_ms)
+{
+    das->delay_ms = delay_ms;
+}
+
+void standin_das_set_session_present(standin_das *das, int present)
+{
+    das->session_present = present;
+}
+
+void standin_das_set_capture(standin_das *das, standin_das_capture_fn fn, void *ctx)
+{
+    pthread_mutex_lock(&das->lock);
+    das->capture = fn;
+    das->capture_ctx = ctx;
+    pthread_mutex_unlock(&das->lock);
+}
+
+int standin_das_pop(standin_das *das, standin_msg *msg, int timeout_ms)
+{
+    struct timespec deadline;
+    int rv = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&das->lock);
+    while (0 == das->q_count && 0 == rv)
+    {
+        rv = pthread_cond_timedwait(&das->cond, &das->lock, &deadline);
+    }
+    if (0 == das->q_count)
+    {
+        pthread_mutex_unlock(&das->lock);
+        return -1;
+    }
+    *msg = das->queue[das->q_head];
+    das->q_head = (das->q_head + 1) % STANDIN_QUEUE_MAX;
+    das->q_count--;
+    pthread_mutex_unlock(&das->lock);
+    return 0;
+}
+
+void standin_msg_free(standin_msg *msg)
+{
+    free(msg->body);
+    msg->body = NULL;
+}
+
+static int publish_locked(standin_das *das, const char *topic, const unsigned char *payload, size_t payload_len)
+{
+    MQTTString topic_str = MQTTString_initializer;
+    size_t buf_len = payload_len + strlen(topic) + 16;
+    unsigned char *buf = NULL;
+    int len = 0;
+    int rv = -1;
+
+    if (das->client_fd < 0)
+    {
+        return -1;
+    }
+    buf = malloc(buf_len);
+    topic_str.cstring = (char *)topic;
+    if (++das->packet_id == 0)
+    {
+        das->packet_id = 1;
+    }
+    len = MQTTSerialize_publish(buf, (int)buf_len, 0, 1, 0, das->packet_id, topic_str, (unsigned char *)payload, (int)payload_len);
+    if (len > 0)
+    {
+        rv = das_send(das, buf, (size_t)len);
+    }
+    free(buf);
+    return rv;
+}
+
+/**
+ * \brief   按当前加密方式组包, GCM计数递增; topic不为NULL时交给抓包回调
+ */
+static unsigned char *seal_locked(standin_das *das, const char *topic, const char *common, const void *body, size_t body_len, size_t *sealed_len)
+{
+    size_t common_len = strlen(common);
+    size_t plain_len = 2 + common_len + body_len;
+    size_t payload_len = 0;
+    unsigned char *payload = NULL;
+    unsigned char *plain = NULL;
+    unsigned char iv[16];
+    unsigned char nonce[12];
+    size_t i = 0;
+
+    if (STANDIN_CIPHER_GCM == das->cipher)
+    {
+        payload_len = STANDIN_GCM_SEQ_LEN + plain_len + STANDIN_GCM_TAG_LEN;
+        payload = malloc(payload_len);
+        plain = payload + STANDIN_GCM_SEQ_LEN;
+    }
+    else
+    {
+        payload_len = (plain_len / 16 + 1) * 16;
+        payload = malloc(payload_len);
+        plain = payload;
+    }
+    plain[0] = (unsigned char)(common_len >> 8);
+    plain[1] = (unsigned char)common_len;
+    memcpy(plain + 2, common, common_len);
+    memcpy(plain + 2 + common_len, body, body_len);
+    if (NULL != das->capture && NULL != topic)
+    {
+        das->capture(das->capture_ctx, STANDIN_CAPTURE_TOPIC, (const unsigned char *)topic, strlen(topic));
+        das->capture(das->capture_ctx, STANDIN_CAPTURE_PLAIN, plain, plain_len);
+    }
+
+    if (STANDIN_CIPHER_GCM == das->cipher)
+    {
+        memcpy(payload, das->down_salt, STANDIN_SALT_LEN);
+        payload[8] = (unsigned char)(das->down_count >> 24);
+        payload[9] = (unsigned char)(das->down_count >> 16);
+        payload[10] = (unsigned char)(das->down_count >> 8);
+        payload[11] = (unsigned char)das->down_count;
+        das->down_count++;
+        for (i = 0; i < 12; i++)
+        {
+            nonce[i] = das->cur.iv_down[i] ^ payload[i];
+        }
+        bscomptls_gcm_crypt_and_tag(&das->cur.gcm, BSCOMPTLS_GCM_ENCRYPT, plain_len, nonce, 12, NULL, 0, plain, plain,
+                                    STANDIN_GCM_TAG_LEN, plain + plain_len);
+    }
+    else
+    {
+        for (i = plain_len; i < payload_len; i++)
+        {
+            payload[i] = (unsigned char)(payload_len - plain_len);
+        }
+        cbc_iv(iv);
+        bscomptls_aes_crypt_cbc(&das->cur.aes_enc, BSCOMPTLS_AES_ENCRYPT, payload_len, iv, payload, payload);
+    }
+
+    *sealed_len = payload_len;
+    return payload;
+}
+
+int standin_das_publish(standin_das *das, const char *topic, const char *common, const void *body, size_t body_len)
+{
+    int rv = 0;
+
+    pthread_mutex_lock(&das->lock);
+    free(das->last_down);
+    das->last_down = seal_locked(das, topic, common, body, body_len, &das->last_down_len);
+    rv = publish_locked(das, topic, das->last_down, das->last_down_len);
+    pthread_mutex_unlock(&das->lock);
+    return rv;
+}
+
+int standin_das_seal(standin_das *das, const char *common, const void *body, size_t body_len, unsigned char **payload, size_t *payload_len)
+{
+    pthread_mutex_lock(&das->lock);
+    *payload = seal_locked(das, NULL, common, body, body_len, payload_len);
+    pthread_mutex_unlock(&das->lock);
+    return NULL != *payload ? 0 : -1;
+}
+
+int standin_das_publish_raw(standin_das *das, const char *topic, const void *payload, size_t payload_len)
+{
+    int rv = 0;
+
+    pthread_mutex_lock(&das->lock);
+    rv = publish_locked(das, topic, (const unsigned char *)payload, payload_len);
+    pthread_mutex_unlock(&das->lock);
+    return rv;
+}
+
+size_t standin_das_last_downlink(standin_das *das, unsigned char *buf, size_t buf_max)
+{
+    size_t len = 0;
+
+    pthread_mutex_lock(&das->lock);
+    len = das->last_down_len < buf_max ? das->last_down_len : buf_max;
+    if (len > 0)
+    {
+        memcpy(buf, das->last_down, len);
+    }
+    pthread_mutex_unlock(&das->lock);
+    return len;
+}
+
+void standin_das_drop(standin_das *das)
+{
+    pthread_mutex_lock(&das->lock);
+    if (das->client_fd >= 0)
+    {
+        shutdown(das->client_fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&das->lock);
+}
+
+int standin_das_wait_connects(standin_das *das, int count, int timeout_ms)
+{
+    uint64_t waited = 0;
+    int connects = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&das->lock);
+        connects = das->stats.connects;
+        pthread_mutex_unlock(&das->lock);
+        if (connects >= count)
+        {
+            return 0;
+        }
+        if (waited >= (uint64_t)timeout_ms)
+        {
+            return -1;
+        }
+        usleep(1000);
+        waited++;
+    }
+}
+
+void standin_das_get_stats(standin_das *das, standin_das_stats *stats)
+{
+    pthread_mutex_lock(&das->lock);
+    *stats = das->stats;
+    pthread_mutex_unlock(&das->lock);
+}
@@ -0,0 +1,134 @@
+/**
+ * \file      standin_das.h
+ * \brief     测试用的DAS替身: 本机回环上的最小MQTT服务端, 按DAS的报文格式加解密
+ *
+ * 只服务一个设备连接, 新连接进来时旧连接直接关掉. 收到的PUBLISH按当前密钥(宽限期内再试旧密钥)
+ * 解密后放进队列供测试取用; 下行可以按当前加密方式组包发送, 也可以原样重发任意报文模拟重放.
+ * GCM模式下记录所有上行报文头, 统计nonce重复.
+ */
+#ifndef H_STANDIN_DAS_H_
+#define H_STANDIN_DAS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STANDIN_CIPHER_CBC      0       ///<    与ezdev_sdk_das_cipher_cbc一致
+#define STANDIN_CIPHER_GCM      1       ///<    与ezdev_sdk_das_cipher_gcm一致
+#define STANDIN_GCM_SEQ_LEN     12      ///<    GCM报文头: 8字节随机数 + 4字节计数
+#define STANDIN_GCM_TAG_LEN     16
+
+typedef struct standin_das standin_das;
+
+/**
+ * \brief   设备发来的一条PUBLISH, 已解密
+ */
+typedef struct
+{
+    char topic[256];
+    char common[512];                           ///<    通用协议体, 以'\0'结尾
+    unsigned char *body;                        ///<    业务数据, standin_msg_free释放
+    size_t body_len;
+    int qos;
+    int conn;                                   ///<    第几个连接上收到的, 从1开始
+    int prev_key;                               ///<    1表示用旧密钥解开
+    unsigned char seq[STANDIN_GCM_SEQ_LEN];     ///<    GCM报文头, CBC时全0
+} standin_msg;
+
+/**
+ * \brief   启动替身, 监听127.0.0.1上的随机端口
+ */
+standin_das *standin_das_start(int cipher, const unsigned char key[16]);
+void standin_das_stop(standin_das *das);
+int standin_das_port(const standin_das *das);
+
+/**
+ * \brief   换会话密钥, keep_prev为1时旧密钥继续用于解上行报文
+ */
+void standin_das_set_key(standin_das *das, const unsigned char key[16], int keep_prev);
+
+/**
+ * \brief   收到每个报文后先等delay_ms再处理, 模拟网络往返
+ */
+void standin_das_set_delay(standin_das *das, int delay_ms);
+
+/**
+ * \brief   CONNACK里的session present标志
+ */
+void standin_das_set_session_present(standin_das *das, int present);
+
+#define STANDIN_CAPTURE_MQTT    0       ///<    发给设备的完整MQTT报文
+#define STANDIN_CAPTURE_TOPIC   1       ///<    standin_das_publish下行的topic
+#define STANDIN_CAPTURE_PLAIN   2       ///<    standin_das_publish加密前的负载 [2字节长度][通用协议体][业务数据]
+
+typedef void (*standin_das_capture_fn)(void *ctx, int kind, const unsigned char *data, size_t len);
+
+/**
+ * \brief   抓包回调, 在替身持锁时调用, 回调里不能再调standin_das_*; fn为NULL时停止
+ */
+void standin_das_set_capture(standin_das *das, standin_das_capture_fn fn, void *ctx);
+
+/**
+ * \brief   取下一条上行消息, 超时返回-1
+ */
+int standin_das_pop(standin_das *das, standin_msg *msg, int timeout_ms);
+void standin_msg_free(standin_msg *msg);
+
+/**
+ * \brief   按当前加密方式组包下发, 报文副本留作standin_das_last_downlink
+ */
+int standin_das_publish(standin_das *das, const char *topic, const char *common, const void *body, size_t body_len);
+
+/**
+ * \brief   按当前加密方式组包但不发送, 用来直接喂给设备的接收接口; GCM计数照常递增, *payload用free释放
+ */
+int standin_das_seal(standin_das *das, const char *common, const void *body, size_t body_len, unsigned char **payload, size_t *payload_len);
+
+/**
+ * \brief   原样下发一段报文, 用于重放和伪造
+ */
+int standin_das_publish_raw(standin_das *das, const char *topic, const void *payload, size_t payload_len);
+
+/**
+ * \brief   拷贝最近一次standin_das_publish发出的加密报文, 返回长度
+ */
+size_t standin_das_last_downlink(standin_das *das, unsigned char *buf, size_t buf_max);
+
+/**
+ * \brief   断开当前连接, 设备会走重连
+ */
+void standin_das_drop(standin_das *das);
+
+/**
+ * \brief   等到累计连接数不小于count, 超时返回-1
+ */
+int standin_das_wait_connects(standin_das *das, int count, int timeout_ms);
+
+typedef struct
+{
+    int connects;           ///<    累计接受的连接
+    int connected;          ///<    当前是否有连接
+    int subscribes;         ///<    SUBSCRIBE报文数
+    int publishes;          ///<    解开的上行PUBLISH数
+    int decrypt_errors;     ///<    解不开的上行PUBLISH数
+    int pubacks;            ///<    设备对下行QoS1的确认数
+    int pings;              ///<    PINGREQ数
+    int nonce_reuse;        ///<    GCM上行报文头重复次数
+    int salt_reuse;         ///<    不同连接上出现相同GCM随机数的次数
+    int packets_in;         ///<    收到的MQTT报文总数
+    int reads_in;           ///<    收到报文的批次, 同一次发送里连续到达的报文算一批
+    int conn_reads;         ///<    当前连接上收到报文的批次
+    int conn_subscribes;    ///<    当前连接上的SUBSCRIBE报文数
+    int first_publish_read; ///<    当前连接上第一个PUBLISH在第几批到达, 0表示还没有; 减1即发出第一条消息前的往返次数
+} standin_das_stats;
+
+void standin_das_get_stats(standin_das *das, standin_das_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,361 @@
+/**
+ * \file      standin_kernel.c
+ * \brief     微内核测试启动: 平台层用platform/wrapper/linux, 键值和验证码放在内存里
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel.h"
+#include "platform_define.h"
+#include "standin_kernel.h"
+
+NET_PLATFORM_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+SEM_PLATFORM_INTERFACE
+THREAD_PLATFORM_INTERFACE
+NET_WAKEUP_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define STANDIN_KERNEL_QUEUE_MAX    1024
+#define STANDIN_KERNEL_EVENT_MAX    16
+
+static pthread_t g_kernel_thread;
+static pthread_t g_user_thread;
+static volatile int g_running = 0;
+static int g_loop_sleep_ms = 1;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_yield_lock = PTHREAD_MUTEX_INITIALIZER;    ///<    微内核线程每轮持有, standin_kernel_pause拿走它
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static standin_kernel_msg g_queue[STANDIN_KERNEL_QUEUE_MAX];
+static size_t g_q_head = 0;
+static size_t g_q_count = 0;
+static int g_events[STANDIN_KERNEL_EVENT_MAX];
+
+static const char g_devinfo[] =
+    "{\"dev_status\":1,\"dev_oeminfo\":0,"
+    "\"dev_subserial\":\"" STANDIN_KERNEL_SERIAL "\",\"dev_serial\":\"" STANDIN_KERNEL_SERIAL "\","
+    "\"dev_verification_code\":\"ABCDEF\",\"dev_firmwareversion\":\"V1.0.0 build 200101\","
+    "\"dev_type\":\"STANDIN\",\"dev_typedisplay\":\"STANDIN\",\"dev_mac\":\"001122334455\","
+    "\"dev_nickname\":\"standin\",\"dev_firmwareidentificationcode\":\"STANDIN\"}";
+
+static void value_load(sdk_keyvalue_type valuetype, unsigned char *keyvalue, EZDEV_SDK_INT32 keyvalue_maxsize)
+{
+    if (sdk_keyvalue_devid == valuetype)
+    {
+        memcpy(keyvalue, "0123456789abcdef0123456789abcdef", keyvalue_maxsize < 32 ? keyvalue_maxsize : 32);
+    }
+    else if (sdk_keyvalue_masterkey == valuetype)
+    {
+        memcpy(keyvalue, "fedcba9876543210", keyvalue_maxsize < 16 ? keyvalue_maxsize : 16);
+    }
+}
+
+static EZDEV_SDK_INT32 value_save(sdk_keyvalue_type valuetype, unsigned char *keyvalue, EZDEV_SDK_INT32 keyvalue_size)
+{
+    return 0;
+}
+
+static EZDEV_SDK_INT32 curing_data_load(sdk_curingdata_type valuetype, unsigned char *keyvalue, EZDEV_SDK_INT32 *keyvalue_maxsize)
+{
+    memcpy(keyvalue, "ABCDEF", 6);
+    *keyvalue_maxsize = 6;
+    return 0;
+}
+
+static EZDEV_SDK_INT32 curing_data_save(sdk_curingdata_type valuetype, unsigned char *keyvalue, EZDEV_SDK_INT32 keyvalue_size)
+{
+    return 0;
+}
+
+static void kernel_log(sdk_log_level level, EZDEV_SDK_INT32 sdk_error, EZDEV_SDK_INT32 othercode, const char *buf)
+{
+    static int verbose = -1;
+
+    if (verbose < 0)
+    {
+        verbose = NULL != getenv("STANDIN_LOG");
+    }
+    if (verbose)
+    {
+        fprintf(stderr, "[sdk %d] %d %d %s\n", (int)level, sdk_error, othercode, buf);
+    }
+}
+
+static void event_notice(ezdev_sdk_kernel_event *ptr_event)
+{
+    pthread_mutex_lock(&g_lock);
+    if ((int)ptr_event->event_type < STANDIN_KERNEL_EVENT_MAX)
+    {
+        g_events[ptr_event->event_type]++;
+    }
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void data_route_v3(ezdev_sdk_kernel_submsg_v3 *ptr_submsg)
+{
+    standin_kernel_msg *msg = NULL;
+
+    pthread_mutex_lock(&g_lock);
+    if (g_q_count < STANDIN_KERNEL_QUEUE_MAX)
+    {
+        msg = &g_queue[(g_q_head + g_q_count) % STANDIN_KERNEL_QUEUE_MAX];
+        memset(msg, 0, sizeof(*msg));
+        snprintf(msg->method, sizeof(msg->method), "%s", ptr_submsg->method);
+        snprintf(msg->msg_type, sizeof(msg->msg_type), "%s", ptr_submsg->msg_type);
+        msg->seq = ptr_submsg->msg_seq;
+        msg->body_len = ptr_submsg->buf_len;
+        msg->body = malloc(msg->body_len + 1);
+        memcpy(msg->body, ptr_submsg->buf, msg->body_len);
+        msg->body[msg->body_len] = '\0';
+        g_q_count++;
+        pthread_cond_broadcast(&g_cond);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void event_route_v3(ezdev_sdk_kernel_event *ptr_event)
+{
+}
+
+static void *kernel_thread(void *arg)
+{
+    while (g_running)
+    {
+        pthread_mutex_lock(&g_yield_lock);
+        ezdev_sdk_kernel_yield();
+        pthread_mutex_unlock(&g_yield_lock);
+        usleep((useconds_t)g_loop_sleep_ms * 1000);
+    }
+    return NULL;
+}
+
+static void *user_thread(void *arg)
+{
+    while (g_running)
+    {
+        ezdev_sdk_kernel_yield_user();
+        usleep((useconds_t)g_loop_sleep_ms * 1000);
+    }
+    return NULL;
+}
+
+int standin_kernel_start(const standin_kernel_config *config)
+{
+    ezdev_sdk_kernel_platform_handle handle;
+    kernel_das_info das_info;
+    ezdev_sdk_kernel_extend_v3 extend;
+
+    memset(&handle, 0, sizeof(handle));
+    handle.net_work_create = net_create;
+    handle.net_work_connect = net_connect;
+    handle.net_work_read = net_read;
+    handle.net_work_write = net_write;
+    handle.net_work_disconnect = net_disconnect;
+    handle.net_work_destroy = net_destroy;
+    handle.net_work_getsocket = net_getsocket;
+    handle.net_work_wait = net_wait;
+    handle.net_work_wakeup = net_wakeup;
+    handle.time_creator = Platform_TimerCreater;
+    handle.time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    handle.time_isexpired = Platform_TimerIsExpired;
+    handle.time_countdownms = Platform_TimerCountdownMS;
+    handle.time_countdown = Platform_TimerCountdown;
+    handle.time_leftms = Platform_TimerLeftMS;
+    handle.time_destroy = Platform_TimeDestroy;
+    handle.time_sleep = sdk_thread_sleep;
+    handle.sdk_kernel_log = kernel_log;
+    handle.key_value_load = value_load;
+    handle.key_value_save = value_save;
+    handle.curing_data_load = curing_data_load;
+    handle.curing_data_save = curing_data_save;
+    handle.thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    handle.thread_sem_create = sdk_platform_thread_sem_create;
+    handle.thread_sem_destroy = sdk_platform_thread_sem_destroy;
+    handle.thread_sem_post = sdk_platform_thread_sem_post;
+    handle.thread_sem_wait = sdk_platform_thread_sem_wait;
+    handle.thread_start = sdk_platform_thread_start;
+
+    /* 替身断开连接后微内核还可能在写, 和应用一样忽略SIGPIPE */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* 带着DAS信息和会话密钥快速上线, 不经过LBS */
+    memset(&das_info, 0, sizeof(das_info));
+    das_info.bLightreg = 1;
+    das_info.das_port = (EZDEV_SDK_UINT16)config->das_port;
+    snprintf(das_info.das_address, sizeof(das_info.das_address), "127.0.0.1");
+    snprintf(das_info.das_domain, sizeof(das_info.das_domain), "127.0.0.1");
+    snprintf(das_info.das_serverid, sizeof(das_info.das_serverid), "standin");
+    memcpy(das_info.session_key, config->session_key, sizeof(das_info.session_key));
+
+    if (ezdev_sdk_kernel_succ != ezdev_sdk_kernel_init("127.0.0.1", (EZDEV_SDK_INT16)(config->lbs_port ? config->lbs_port : 1),
+                                                       &handle, event_notice, g_devinfo, &das_info, 1))
+    {
+        fprintf(stderr, "standin kernel: init failed\n");
+        return -1;
+    }
+
+    /* LBS协商的结果直接写进去 */
+    g_ezdev_sdk_kernel.redirect_das_info.das_cipher = (EZDEV_SDK_UINT8)config->cipher;
+    g_ezdev_sdk_kernel.redirect_das_info.das_key_lifetime = config->key_lifetime;
+
+    memset(&extend, 0, sizeof(extend));
+    snprintf(extend.module, sizeof(extend.module), STANDIN_KERNEL_MODULE);
+    extend.ezdev_sdk_kernel_data_route = data_route_v3;
+    extend.ezdev_sdk_kernel_event_route = event_route_v3;
+    if (ezdev_sdk_kernel_succ != ezdev_sdk_kernel_extend_load_v3(&extend) || ezdev_sdk_kernel_succ != ezdev_sdk_kernel_start())
+    {
+        fprintf(stderr, "standin kernel: start failed\n");
+        ezdev_sdk_kernel_fini();
+        return -1;
+    }
+
+    g_loop_sleep_ms = config->loop_sleep_ms > 0 ? config->loop_sleep_ms : 1;
+    g_running = 1;
+    pthread_create(&g_kernel_thread, NULL, kernel_thread, NULL);
+    pthread_create(&g_user_thread, NULL, user_thread, NULL);
+    return 0;
+}
+
+void standin_kernel_stop(void)
+{
+    standin_kernel_msg msg;
+
+    if (!g_running)
+    {
+        return;
+    }
+    g_running = 0;
+    ezdev_sdk_kernel_wakeup();
+    pthread_join(g_kernel_thread, NULL);
+    pthread_join(g_user_thread, NULL);
+    ezdev_sdk_kernel_stop();
+    ezdev_sdk_kernel_fini();
+    while (0 == standin_kernel_pop(&msg, 0))
+    {
+        standin_kernel_msg_free(&msg);
+    }
+}
+
+void standin_kernel_pause(void)
+{
+    /* 微内核线程可能阻塞在等待里, 叫醒它直到拿到锁 */
+    while (0 != pthread_mutex_trylock(&g_yield_lock))
+    {
+        ezdev_sdk_kernel_wakeup();
+        usleep(1000);
+    }
+}
+
+void standin_kernel_resume(void)
+{
+    pthread_mutex_unlock(&g_yield_lock);
+}
+
+int standin_kernel_send(const char *method, const char *msg_type, const void *body, size_t body_len, unsigned int seq)
+{
+    ezdev_sdk_kernel_pubmsg_v3 pubmsg;
+
+    memset(&pubmsg, 0, sizeof(pubmsg));
+    pubmsg.msg_qos = QOS_T1;
+    pubmsg.msg_seq = seq;
+    pubmsg.msg_body = (unsigned char *)body;
+    pubmsg.msg_body_len = (EZDEV_SDK_UINT32)body_len;
+    snprintf(pubmsg.resource_id, sizeof(pubmsg.resource_id), "0");
+    snprintf(pubmsg.resource_type, sizeof(pubmsg.resource_type), "global");
+    snprintf(pubmsg.module, sizeof(pubmsg.module), STANDIN_KERNEL_MODULE);
+    snprintf(pubmsg.method, sizeof(pubmsg.method), "%s", method);
+    snprintf(pubmsg.msg_type, sizeof(pubmsg.msg_type), "%s", msg_type);
+    return ezdev_sdk_kernel_succ == ezdev_sdk_kernel_send_v3(&pubmsg) ? 0 : -1;
+}
+
+int standin_kernel_pop(standin_kernel_msg *msg, int timeout_ms)
+{
+    struct timespec deadline;
+    int rv = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    while (0 == g_q_count && 0 == rv)
+    {
+        rv = pthread_cond_timedwait(&g_cond, &g_lock, &deadline);
+    }
+    if (0 == g_q_count)
+    {
+        pthread_mutex_unlock(&g_lock);
+        return -1;
+    }
+    *msg = g_queue[g_q_head];
+    g_q_head = (g_q_head + 1) % STANDIN_KERNEL_QUEUE_MAX;
+    g_q_count--;
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+}
+
+void standin_kernel_msg_free(standin_kernel_msg *msg)
+{
+    free(msg->body);
+    msg->body = NULL;
+}
+
+int standin_kernel_events(int event_type)
+{
+    int count = 0;
+
+    pthread_mutex_lock(&g_lock);
+    count = (event_type >= 0 && event_type < STANDIN_KERNEL_EVENT_MAX) ? g_events[event_type] : 0;
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+int standin_kernel_wait_event(int event_type, int count, int timeout_ms)
+{
+    struct timespec deadline;
+    int rv = 0;
+
+    if (event_type < 0 || event_type >= STANDIN_KERNEL_EVENT_MAX)
+    {
+        return -1;
+    }
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    while (g_events[event_type] < count && 0 == rv)
+    {
+        rv = pthread_cond_timedwait(&g_cond, &g_lock, &deadline);
+    }
+    rv = g_events[event_type] >= count ? 0 : -1;
+    pthread_mutex_unlock(&g_lock);
+    return rv;
+}
+
+void standin_kernel_down_topic(char *buf, size_t buf_len, const char *method, const char *msg_type)
+{
+    snprintf(buf, buf_len, "/iot/%s/global/0-global/%s/%s/%s", STANDIN_KERNEL_SERIAL, STANDIN_KERNEL_MODULE, method, msg_type);
+}
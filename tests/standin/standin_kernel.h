@@ -0,0 +1,81 @@
+/**
+ * \file      standin_kernel.h
+ * \brief     让微内核走快速上线连到DAS替身, 微内核线程和用户线程在后台跑
+ *
+ * 微内核用的是进程内的全局状态, 一个进程只能启动一次; 需要多个场景时每个场景fork一个子进程.
+ */
+#ifndef H_STANDIN_KERNEL_H_
+#define H_STANDIN_KERNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STANDIN_KERNEL_MODULE   "standin"   ///<    注册的v3模块名, 下行topic的模块段用它
+#define STANDIN_KERNEL_SERIAL   "STANDIN0001"
+
+typedef struct
+{
+    int das_port;                   ///<    DAS替身端口
+    int cipher;                     ///<    STANDIN_CIPHER_CBC/STANDIN_CIPHER_GCM
+    unsigned char session_key[16];
+    unsigned int key_lifetime;      ///<    会话密钥有效期(秒), 0不更换
+    int lbs_port;                   ///<    LBS地址的端口, 不走LBS时随便填
+    int loop_sleep_ms;              ///<    两个线程每轮之间的休眠, 0取1ms
+} standin_kernel_config;
+
+/**
+ * \brief   设备收到的一条v3消息
+ */
+typedef struct
+{
+    char method[128];
+    char msg_type[128];
+    unsigned int seq;
+    unsigned char *body;            ///<    standin_kernel_msg_free释放
+    size_t body_len;
+} standin_kernel_msg;
+
+int standin_kernel_start(const standin_kernel_config *config);
+void standin_kernel_stop(void);
+
+/**
+ * \brief   暂停微内核线程, 返回时它已不在ezdev_sdk_kernel_yield里, 测试线程可以直接调接收接口; 用户线程照常运行
+ */
+void standin_kernel_pause(void);
+void standin_kernel_resume(void);
+
+/**
+ * \brief   发一条v3消息, topic为/iot/{序列号}/global/0-global/standin/{method}/{msg_type}
+ */
+int standin_kernel_send(const char *method, const char *msg_type, const void *body, size_t body_len, unsigned int seq);
+
+/**
+ * \brief   取下一条收到的v3消息, 超时返回-1
+ */
+int standin_kernel_pop(standin_kernel_msg *msg, int timeout_ms);
+void standin_kernel_msg_free(standin_kernel_msg *msg);
+
+/**
+ * \brief   某类事件(sdk_kernel_event_type)累计次数
+ */
+int standin_kernel_events(int event_type);
+
+/**
+ * \brief   等到某类事件累计次数不小于count, 超时返回-1
+ */
+int standin_kernel_wait_event(int event_type, int count, int timeout_ms);
+
+/**
+ * \brief   下行v3 topic, 写入buf
+ */
+void standin_kernel_down_topic(char *buf, size_t buf_len, const char *method, const char *msg_type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,472 @@
+/**
+ * \file      standin_lbs.c
+ * \brief     测试用的LBS替身实现
+ *
+ * 报文格式按lbs_transport.c: [命令<<4][MQTT式剩余长度][负载], 负载以3字节协议版本开头.
+ * - 0x7 设备: [序列号长度][序列号][32][设备ID][主密钥加密的r1]
+ * - 0x8 平台: [结果0][主密钥加密的r1 r2 会话密钥]
+ * - 0x9 设备: [主密钥加密的r2]
+ * - 0xA 设备: [新会话密钥加密的请求JSON]
+ * - 0xB 平台: [结果0][新会话密钥加密的DasInfo JSON]
+ * 加密都是AES-128-CBC, 固定IV, 补齐到16字节. 这里直接调bscomptls, 不复用SDK里的封装.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "mbedtls/aes.h"
+#include "standin_lbs.h"
+
+#define LBS_IO_TIMEOUT_MS   5000
+#define LBS_PACKET_MAX      4096
+
+#define LBS_CMD_REFRESH_I   0x7
+#define LBS_CMD_REFRESH_II  0x8
+#define LBS_CMD_REFRESH_III 0x9
+#define LBS_CMD_CRYPTO_REQ  0xA
+#define LBS_CMD_CRYPTO_RSP  0xB
+
+struct standin_lbs
+{
+    int listen_fd;
+    int port;
+    volatile int running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    unsigned char master_key[16];
+    int das_port;
+    int cipher;
+    unsigned int key_lifetime;
+    int delay_ms;
+    standin_lbs_stats stats;
+
+    standin_lbs_capture_fn capture;
+    void *capture_ctx;
+};
+
+static void cbc_crypt(const unsigned char key[16], int mode, const unsigned char *in, size_t len, unsigned char *out)
+{
+    bscomptls_aes_context aes;
+    unsigned char iv[16];
+    int i = 0;
+
+    memset(iv, 0, sizeof(iv));
+    for (i = 0; i < 8; i++)
+    {
+        iv[i] = (unsigned char)(0x30 + i);
+    }
+    bscomptls_aes_init(&aes);
+    if (BSCOMPTLS_AES_ENCRYPT == mode)
+    {
+        bscomptls_aes_setkey_enc(&aes, key, 128);
+    }
+    else
+    {
+        bscomptls_aes_setkey_dec(&aes, key, 128);
+    }
+    bscomptls_aes_crypt_cbc(&aes, mode, len, iv, in, out);
+    bscomptls_aes_free(&aes);
+}
+
+/**
+ * \brief   补齐后加密, 返回密文长度; 明文正好是16的倍数时也补一整块
+ */
+static size_t cbc_encrypt(const unsigned char key[16], const unsigned char *plain, size_t len, unsigned char *out)
+{
+    unsigned char buf[LBS_PACKET_MAX];
+    size_t padded = (len / 16 + 1) * 16;
+
+    memcpy(buf, plain, len);
+    memset(buf + len, (int)(padded - len), padded - len);
+    cbc_crypt(key, BSCOMPTLS_AES_ENCRYPT, buf, padded, out);
+    return padded;
+}
+
+/**
+ * \brief   解密并去掉补齐, 返回明文长度, 补齐不对返回-1
+ */
+static long cbc_decrypt(const unsigned char key[16], const unsigned char *in, size_t len, unsigned char *out)
+{
+    unsigned char pad = 0;
+    size_t i = 0;
+
+    if (0 == len || 0 != len % 16)
+    {
+        return -1;
+    }
+    cbc_crypt(key, BSCOMPTLS_AES_DECRYPT, in, len, out);
+    pad = out[len - 1];
+    if (0 == pad || pad > 16)
+    {
+        return -1;
+    }
+    for (i = 1; i <= pad; i++)
+    {
+        if (out[len - i] != pad)
+        {
+            return -1;
+        }
+    }
+    return (long)(len - pad);
+}
+
+/**
+ * \brief   在超时之内读满len字节, 替身停止时提前返回
+ */
+static int recv_exact(standin_lbs *lbs, int fd, unsigned char *buf, size_t len)
+{
+    struct pollfd pfd;
+    int waited = 0;
+    ssize_t n = 0;
+
+    while (len > 0)
+    {
+        if (!lbs->running || waited >= LBS_IO_TIMEOUT_MS)
+        {
+            return -1;
+        }
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 20) <= 0)
+        {
+            waited += 20;
+            continue;
+        }
+        n = recv(fd, buf, len, 0);
+        if (n <= 0)
+        {
+            if (n < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * \brief   读一个报文, 返回负载长度, 命令写入cmd
+ */
+static long recv_packet(standin_lbs *lbs, int fd, int *cmd, unsigned char *payload)
+{
+    unsigned char byte = 0;
+    size_t len = 0;
+    size_t mult = 1;
+    int count = 0;
+
+    if (0 != recv_exact(lbs, fd, &byte, 1))
+    {
+        return -1;
+    }
+    *cmd = byte >> 4;
+    do
+    {
+        if (count++ >= 4 || 0 != recv_exact(lbs, fd, &byte, 1))
+        {
+            return -1;
+        }
+        len += (size_t)(byte & 0x7F) * mult;
+        mult *= 128;
+    } while (byte & 0x80);
+
+    if (len > LBS_PACKET_MAX || 0 != recv_exact(lbs, fd, payload, len))
+    {
+        return -1;
+    }
+    return (long)len;
+}
+
+/**
+ * \brief   组包发出, 设置了抓包回调时连同加密用的密钥和设备的r1一起交给回调
+ */
+static int send_packet(standin_lbs *lbs, int fd, int cmd, const unsigned char key[16], unsigned char r1, const unsigned char *payload, size_t len)
+{
+    unsigned char buf[LBS_PACKET_MAX + 8];
+    size_t off = 0;
+    size_t remain = len;
+    unsigned char byte = 0;
+
+    buf[off++] = (unsigned char)(cmd << 4);
+    do
+    {
+        byte = remain % 128;
+        remain /= 128;
+        buf[off++] = remain > 0 ? (byte | 0x80) : byte;
+    } while (remain > 0);
+    memcpy(buf + off, payload, len);
+    off += len;
+
+    pthread_mutex_lock(&lbs->lock);
+    if (NULL != lbs->capture)
+    {
+        lbs->capture(lbs->capture_ctx, cmd, key, r1, buf, off);
+    }
+    pthread_mutex_unlock(&lbs->lock);
+    return (ssize_t)off == send(fd, buf, off, MSG_NOSIGNAL) ? 0 : -1;
+}
+
+static void sleep_ms(standin_lbs *lbs, int ms)
+{
+    while (ms > 0 && lbs->running)
+    {
+        usleep(10 * 1000);
+        ms -= 10;
+    }
+}
+
+/**
+ * \brief   走完一次刷新会话密钥的交互, 成功返回0
+ */
+static int serve_exchange(standin_lbs *lbs, int fd)
+{
+    unsigned char in[LBS_PACKET_MAX];
+    unsigned char out[LBS_PACKET_MAX];
+    unsigned char plain[LBS_PACKET_MAX];
+    unsigned char session_key[16];
+    char json[512];
+    unsigned char r1 = 0;
+    unsigned char r2 = 0;
+    long len = 0;
+    long plain_len = 0;
+    size_t off = 0;
+    int cmd = 0;
+    int delay_ms = 0;
+
+    /* I: 取出r1 */
+    len = recv_packet(lbs, fd, &cmd, in);
+    if (LBS_CMD_REFRESH_I != cmd || len < 4 || 4 + in[3] + 1 + 32 + 16 != len ||
+        cbc_decrypt(lbs->master_key, in + len - 16, 16, plain) != 1)
+    {
+        return -1;
+    }
+    r1 = plain[0];
+
+    pthread_mutex_lock(&lbs->lock);
+    delay_ms = lbs->delay_ms;
+    pthread_mutex_unlock(&lbs->lock);
+    sleep_ms(lbs, delay_ms);
+
+    /* II: r1 r2 新会话密钥 */
+    if (sizeof(session_key) != getrandom(session_key, sizeof(session_key), 0) || 1 != getrandom(&r2, 1, 0))
+    {
+        return -1;
+    }
+    memcpy(out, in, 3);
+    out[3] = 0;
+    plain[0] = r1;
+    plain[1] = r2;
+    memcpy(plain + 2, session_key, 16);
+    off = 4 + cbc_encrypt(lbs->master_key, plain, 18, out + 4);
+    if (0 != send_packet(lbs, fd, LBS_CMD_REFRESH_II, lbs->master_key, r1, out, off))
+    {
+        return -1;
+    }
+
+    /* III: 设备回送r2 */
+    len = recv_packet(lbs, fd, &cmd, in);
+    if (LBS_CMD_REFRESH_III != cmd || len != 3 + 16 || cbc_decrypt(lbs->master_key, in + 3, 16, plain) != 1 || plain[0] != r2)
+    {
+        return -1;
+    }
+
+    /* DAS信息请求用新密钥加密 */
+    len = recv_packet(lbs, fd, &cmd, in);
+    if (LBS_CMD_CRYPTO_REQ != cmd || len < 3 + 16)
+    {
+        return -1;
+    }
+    plain_len = cbc_decrypt(session_key, in + 3, (size_t)len - 3, plain);
+    if (plain_len < 0)
+    {
+        return -1;
+    }
+    plain[plain_len] = '\0';
+    if (NULL == strstr((const char *)plain, "\"Type\":\"DAS\"") || NULL == strstr((const char *)plain, "\"KeyRotateSupport\""))
+    {
+        return -1;
+    }
+
+    snprintf(json, sizeof(json),
+             "{\"Type\":\"DAS\",\"DasInfo\":{\"Address\":\"127.0.0.1\",\"Port\":%d,\"UdpPort\":0,\"Domain\":\"127.0.0.1\","
+             "\"ServerID\":\"standin\",\"Cipher\":%d,\"Compress\":0,\"KeyLifetime\":%u,\"FragSize\":0}}",
+             lbs->das_port, lbs->cipher, lbs->key_lifetime);
+    memcpy(out, in, 3);
+    out[3] = 0;
+    off = 4 + cbc_encrypt(session_key, (const unsigned char *)json, strlen(json), out + 4);
+    if (0 != send_packet(lbs, fd, LBS_CMD_CRYPTO_RSP, session_key, r1, out, off))
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lbs->lock);
+    memcpy(lbs->stats.last_key, session_key, sizeof(session_key));
+    lbs->stats.exchanges++;
+    pthread_mutex_unlock(&lbs->lock);
+    return 0;
+}
+
+static void *standin_lbs_thread(void *arg)
+{
+    standin_lbs *lbs = (standin_lbs *)arg;
+    struct pollfd pfd;
+    unsigned char drain[64];
+    int fd = -1;
+    int ok = 0;
+
+    while (lbs->running)
+    {
+        pfd.fd = lbs->listen_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 20) <= 0)
+        {
+            continue;
+        }
+        fd = accept(lbs->listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&lbs->lock);
+        lbs->stats.connects++;
+        lbs->stats.active = 1;
+        pthread_mutex_unlock(&lbs->lock);
+
+        ok = 0 == serve_exchange(lbs, fd);
+        if (ok)
+        {
+            /* 等设备自己断开 */
+            while (lbs->running && recv_exact(lbs, fd, drain, 1) == 0)
+            {
+            }
+        }
+
+        pthread_mutex_lock(&lbs->lock);
+        lbs->stats.active = 0;
+        if (!ok)
+        {
+            lbs->stats.failures++;
+        }
+        pthread_mutex_unlock(&lbs->lock);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+standin_lbs *standin_lbs_start(const unsigned char master_key[16], int das_port, int cipher, unsigned int key_lifetime)
+{
+    standin_lbs *lbs = calloc(1, sizeof(standin_lbs));
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+
+    memcpy(lbs->master_key, master_key, 16);
+    lbs->das_port = das_port;
+    lbs->cipher = cipher;
+    lbs->key_lifetime = key_lifetime;
+    pthread_mutex_init(&lbs->lock, NULL);
+
+    lbs->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(lbs->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (0 != bind(lbs->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || 0 != listen(lbs->listen_fd, 8) ||
+        0 != getsockname(lbs->listen_fd, (struct sockaddr *)&addr, &addr_len))
+    {
+        fprintf(stderr, "standin lbs: listen failed: %s\n", strerror(errno));
+        close(lbs->listen_fd);
+        pthread_mutex_destroy(&lbs->lock);
+        free(lbs);
+        return NULL;
+    }
+    lbs->port = ntohs(addr.sin_port);
+
+    lbs->running = 1;
+    pthread_create(&lbs->thread, NULL, standin_lbs_thread, lbs);
+    return lbs;
+}
+
+void standin_lbs_stop(standin_lbs *lbs)
+{
+    if (NULL == lbs)
+    {
+        return;
+    }
+    lbs->running = 0;
+    pthread_join(lbs->thread, NULL);
+    close(lbs->listen_fd);
+    pthread_mutex_destroy(&lbs->lock);
+    free(lbs);
+}
+
+int standin_lbs_port(const standin_lbs *lbs)
+{
+    return lbs->port;
+}
+
+void standin_lbs_set_delay(standin_lbs *lbs, int delay_ms)
+{
+    pthread_mutex_lock(&lbs->lock);
+    lbs->delay_ms = delay_ms;
+    pthread_mutex_unlock(&lbs->lock);
+}
+
+void standin_lbs_set_capture(standin_lbs *lbs, standin_lbs_capture_fn fn, void *ctx)
+{
+    pthread_mutex_lock(&lbs->lock);
+    lbs->capture = fn;
+    lbs->capture_ctx = ctx;
+    pthread_mutex_unlock(&lbs->lock);
+}
+
+void standin_lbs_get_stats(standin_lbs *lbs, standin_lbs_stats *stats)
+{
+    pthread_mutex_lock(&lbs->lock);
+    *stats = lbs->stats;
+    pthread_mutex_unlock(&lbs->lock);
+}
+
+static int wait_count(standin_lbs *lbs, const int *field, int count, int timeout_ms)
+{
+    uint64_t waited = 0;
+    int value = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&lbs->lock);
+        value = *field;
+        pthread_mutex_unlock(&lbs->lock);
+        if (value >= count)
+        {
+            return 0;
+        }
+        if (waited >= (uint64_t)timeout_ms)
+        {
+            return -1;
+        }
+        usleep(1000);
+        waited++;
+    }
+}
+
+int standin_lbs_wait_connects(standin_lbs *lbs, int count, int timeout_ms)
+{
+    return wait_count(lbs, &lbs->stats.connects, count, timeout_ms);
+}
+
+int standin_lbs_wait_exchanges(standin_lbs *lbs, int count, int timeout_ms)
+{
+    return wait_count(lbs, &lbs->stats.exchanges, count, timeout_ms);
+}
@@ -0,0 +1,68 @@
+/**
+ * \file      standin_lbs.h
+ * \brief     测试用的LBS替身: 本机回环上只实现刷新会话密钥的交互, 设备不断线更换密钥时连它
+ *
+ * 一次只服务一个连接, 按lbs_transport.c的报文格式走完refreshsessionkey I/II/III和DAS信息请求,
+ * 每次下发一个新的随机会话密钥, DAS地址固定为127.0.0.1和创建时给的端口.
+ */
+#ifndef H_STANDIN_LBS_H_
+#define H_STANDIN_LBS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct standin_lbs standin_lbs;
+
+/**
+ * \brief   启动替身, 监听127.0.0.1上的随机端口
+ * \param   master_key      设备的主密钥, 交互的前三步用它加密
+ * \param   das_port        下发的DAS端口, 与设备当前连着的一致才不会退回完整注册
+ * \param   cipher          下发的加密方式, STANDIN_CIPHER_CBC/STANDIN_CIPHER_GCM
+ * \param   key_lifetime    下发的新密钥有效期(秒)
+ */
+standin_lbs *standin_lbs_start(const unsigned char master_key[16], int das_port, int cipher, unsigned int key_lifetime);
+void standin_lbs_stop(standin_lbs *lbs);
+int standin_lbs_port(const standin_lbs *lbs);
+
+/**
+ * \brief   收到第一步请求后先等delay_ms再回应, 模拟慢速链路上的LBS
+ */
+void standin_lbs_set_delay(standin_lbs *lbs, int delay_ms);
+
+/**
+ * \brief   抓包回调: 每个发给设备的响应报文, 连同加密它的密钥(0x8用主密钥, 0xB用新会话密钥)和设备的r1
+ * \note    在替身线程里持锁调用, 回调里不能再调standin_lbs_*; fn为NULL时停止
+ */
+typedef void (*standin_lbs_capture_fn)(void *ctx, int cmd, const unsigned char key[16], unsigned char r1, const unsigned char *frame, size_t len);
+void standin_lbs_set_capture(standin_lbs *lbs, standin_lbs_capture_fn fn, void *ctx);
+
+typedef struct
+{
+    int connects;                   ///<    累计接受的连接
+    int active;                     ///<    当前是否有交互在进行
+    int exchanges;                  ///<    完整走完的交互次数, 每次下发一个新密钥
+    int failures;                   ///<    中途断开或报文不对的交互次数
+    unsigned char last_key[16];     ///<    最近一次下发的会话密钥
+} standin_lbs_stats;
+
+void standin_lbs_get_stats(standin_lbs *lbs, standin_lbs_stats *stats);
+
+/**
+ * \brief   等到某次交互开始(累计连接数不小于count), 超时返回-1
+ */
+int standin_lbs_wait_connects(standin_lbs *lbs, int count, int timeout_ms);
+
+/**
+ * \brief   等到完整交互次数不小于count, 超时返回-1
+ */
+int standin_lbs_wait_exchanges(standin_lbs *lbs, int count, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,593 @@
+/**
+ * \file      test_bignum.c
+ * \brief     bignum的已知答案测试, 以及与不用汇编的实现(common/bignum_generic.c)的比对
+ *
+ * ECDH(SECP384R1)和RSA(ezRsaEncrypt/ezRsaDecrypt)的运算都落在bignum上, 汇编/MULX-ADX内层循环和
+ * AArch64的64位limb(BSCOMPTLS_BIGNUM_AARCH64_INT64)打开前, 在目标机上跑这个测试:
+ * - 8位到4096位的乘法、取模、模幂(蒙哥马利乘法)和模逆, 答案由Python的大整数独立算出
+ * - RSA-1024公钥运算和CRT私钥运算, P-384上的ECDH公钥生成和共享密钥
+ * - 随机长度、随机取值(包括全0和全1的limb)的操作数, 库里的实现与通用实现结果相同
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "mbedtls/bignum.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/rsa.h"
+#include "bignum_generic.h"
+#include "test_util.h"
+
+#define RANDOM_ROUNDS       3000
+#define RANDOM_EXP_ROUNDS   200
+#define RANDOM_LIMBS_MAX    72
+
+typedef struct
+{
+    const char *a;
+    const char *b;
+    const char *m;
+    const char *e;
+    const char *a_mul_b;
+    const char *a_mod_m;
+    const char *a_exp_e_mod_m;
+    const char *a_inv_mod_m;    ///<    "0"表示不可逆
+} bignum_kat;
+
+/* 以下由Python生成(random.Random(43)), 答案用Python的int运算得出 */
+static const bignum_kat g_bignum_kat[] =
+{
+    {
+        "89",
+        "C9",
+        "B3",
+        "C3",
+        "6B91",
+        "89",
+        "6D",
+        "62",
+    },
+    {
+        "F59BA79924D8CEA5",
+        "DEB0452176688387",
+        "B2CCDFA7ABF10AC3",
+        "18A61865CAFEDACF",
+        "D5A618AD16143E9A3020C336611B6803",
+        "42CEC7F178E7C3E2",
+        "AA407A42E82AE117",
+        "5217309DC6549A3",
+    },
+    {
+        "1994B7A5674043590",
+        "4273BD7A9BE6A8EA",
+        "EEB108E2839AA6B1",
+        "5F53F26C939D61DD",
+        "6A3E8162FF4ACF7F7E6E2DFF1E5F75A0",
+        "AA9A7173F0698EDF",
+        "D388CEDB171422E8",
+        "17DBED7B984C8D61",
+    },
+    {
+        "8C072307F275418CDA2F966E9FDFE168",
+        "EF1F16F1F362B708C15C71BFE2F23430",
+        "6CE97AF60EC69D372D1AA9EA64D8F363",
+        "301C1FD01FE2A062D1F9EFFA1B784C45",
+        "82CBAB1E9E2D42D09BFD806CDD7FE389CD64E4ACE332DC43F519887058136380",
+        "1F1DA811E3AEA455AD14EC843B06EE05",
+        "5E9A14473E214EDA7290634C51E743DE",
+        "0",
+    },
+    {
+        "FEF85D5BD5A25C02832EA288291E1AA618829EED2749AC58",
+        "206D613AFA6B594E98E335286308B85BC5B5849620F2C360",
+        "8C86010E10439BDE607E2B462E8D0BB3933D9D81459D9901",
+        "D6CF23C00FB87E07F120986B2FC6499D0FAB80C5944AE60B",
+        "204BFC4213DCAA4FBD87760503ED21D255CDA78A8F0AE8DA4CAD16AC2961AEE6634F370536DD65822562F29BC517A900",
+        "72725C4DC55EC02422B07741FA910EF28545016BE1AC1357",
+        "340BD182F29CE155E47C45D686ECF805AF46912C3DF2C30E",
+        "8544FE4395ECD6BB9DC61182EF363524E926DE139BCB00CA",
+    },
+    {
+        "4ACCDE1ED0469667DB0E5E65FCFCBC361A60E0339F9F243F85B25AC313B93773E38544F34678B59A4BD120B42A6D06F0",
+        "E61F2DA4A5AB4237C9715E9775198C349F6C6415D84481351816DA590FA0448EADE3702DA6561BE6EECB2547A76BB9C8",
+        "C7E6C9711484CF3FD92E1A262057B0DE2AB49AE170547E0BB37EE754AA03203287656D8E5486D49654CE7017B9307855",
+        "F81BD0EE120287D69ABF39B8AC0072C72F9E383BBA711A185E38A9FF44A3F94497668966E05ADC180CD32C5251CD827D",
+        "433D2BB4B38C6F62B4014E76FCB08F20576A144C1ADAD6187EB8C3668C04CEEF7F992139A2CE0B84BD10757834A4DD8A"
+        "44173CF3CFBCCEF12F782EE1B500A5AA1FA5EEF743748D24A77F9D61CF6677A6808BA28C19D626B4B58C37126580DB80",
+        "4ACCDE1ED0469667DB0E5E65FCFCBC361A60E0339F9F243F85B25AC313B93773E38544F34678B59A4BD120B42A6D06F0",
+        "1D0E633609601DA964909A4AA16170E78F9C9BB826DBFCABCF5A978D4EDF0239AA0E23EEDA6697AD3CDDE9D3388FAB82",
+        "0",
+    },
+    {
+        "F7702500791AA55F0A9574A76F1A311EB715E9A15C8FFA6EF489E08BBA83F02AC7753887E63CE18B7EB39BC14C0897CE"
+        "1D0159FDA9A3D6238D4DE4F9FE4C06D4",
+        "9BE38AC14EB9D5A9CEB64BFE92F7992B277364CFBB2A90CDAA30910ADF9E95261613064FA51C6D2A208D57E35BADD3CC"
+        "1569F64BC60E43AE9A1394FF6A387A4E",
+        "5E07119B2043C5171FD36C9BD3FDC924FA02F585CA9C2AF1E74DC2131B12D40D00A51DA62585702D09B8AA4C964EE498"
+        "716D78B26CBC093C890221E8B0A84CD1",
+        "59FC8A82C115BFF5EFF5CA26424CE83F7F8439CA8847A774B79F98F51E58B604566FA460C7D7CD13E291EA49D25B9E35"
+        "E7609EA3C5DCCB54FD3B17A7045D845D",
+        "96ACD4F56454753A2AC6AE2F8B55AD7F6776AA0FF660D98ECF09846DF95A40FB4FCCDAE544601FB015F682F9B99C3A63"
+        "680F2551B27A292F996464400FD1C2E425118AFA7FF9F787556C77D5A15A1779BA3F431929F700871F1FE9BE25AD5A49"
+        "83FF36B67C65F50253EA631A19ABABB13AADF14993CEB1E6123F5FFCFCCB1C98",
+        "3B6201CA38931B30CAEE9B6FC71E9ED4C30FFE95C757A48B25EE5C65845E4810C62AFD3B9B3201316B4247281F6ACE9D"
+        "3A266898D02BC3AA7B49A1289CFB6D32",
+        "4D1BE8BC1B2D9065AF82140461F47608EAE5F2B7CE63B113C75608850FA0BFCFA6489DC075827D056901519192954B43"
+        "39CC933EE4D1C97486A8FE00C36CE19A",
+        "0",
+    },
+    {
+        "AF90E1BF0D457C2258D4CAB265DD854E53CD3343CCEB51F7E99691CB68A0BD8A961951489820E20442A4617967495073"
+        "935C8B9FEF69AD42AF5F3EED31A9387F6797D0D2AC1C1D2BEFC3282ED8F30B8734C2901AB7BD86BF17CBC410088D7F34"
+        "B65D812F164F3DCA62B65955F3422348DB72357D570AFD2AD7FBBAEF74CBC8B2",
+        "8BBA5D33061410F306F6F3651892A86C0FAC2B38805C400075544EC60F8988793990AF27639F6342FD55CE5FD29EBA72"
+        "623F3D89FAE98AB1376E0B2AC6CEFB923012A6AA586C21E138D0BF0D4CC73CBDF57538753BC1C56CAB6E55370D14B80C"
+        "F70A1CD8BCD71085B4CA39CA30109707D3CE573CC8826D952D864C4A899F0915",
+        "ECD32F2C607199303375B2E96A5DE37D9F58978990F527311FE05A7F38336541B30207E31BC04C840190CBE83FCB670D"
+        "27948206641F1BE5C3A3C88372E945E02143FA473838FA1D43743D8758764BF3943555271C8DABD5F37C9B478167D3BF"
+        "DC69FE8A80EFD5D4EA283363E35265D682C63468D8CC2AFD9CFDE533DC65A331",
+        "24685A5D56F36506B40DF9E27B537DC712D48C0CCB59C491A5C38D2ED65371EC45F5C801EF9B37C3B3085D9B7A978A5E"
+        "44AAFBE9173A92E50B39B99C3C8B2CA9331F09E73E17077CB14C1DBE26C26109935D8DC08A7A2DCE2244D20B89C827AB"
+        "42D9F95250073C2A5410CF591DCC06AD604A6F762FD4CE0503C5D1DD1B0224AF",
+        "5FD379C1610EE80090C5EEBAD7A1575AEA8034FF3F5D5D477579666DC9665D07C255007E4320B8991ED75DB39CAB1F1A"
+        "C1B0D297BFF2C8141AE9F2816FD631861D2D02206EE8A8B42929033FFC59A61398065D2DC732750A009FDFD02AF810E3"
+        "439C600031AF896AAF614C8416114F5AD07077477107DF4288A3D0BFC8A489B54FC5A187CA246572E241014FF55E9707"
+        "008428157706C4F39F3F5BD40323BB1642A791CDCC4AD26D198E855FEDFB7C566577BE433EF7A0936565BD4D3B31B7A1"
+        "ECE97B59FB778FFF5906F383799C16A00D9E9C9D4D6F689C3A19B33B879E269F8D83FA99C4B860CDD7EBEBAD3365976E"
+        "848FBEE08694D0EF6B1C352CA753B89A",
+        "AF90E1BF0D457C2258D4CAB265DD854E53CD3343CCEB51F7E99691CB68A0BD8A961951489820E20442A4617967495073"
+        "935C8B9FEF69AD42AF5F3EED31A9387F6797D0D2AC1C1D2BEFC3282ED8F30B8734C2901AB7BD86BF17CBC410088D7F34"
+        "B65D812F164F3DCA62B65955F3422348DB72357D570AFD2AD7FBBAEF74CBC8B2",
+        "24F4F4BD0BDBCB990B51E6A00743197235D6887E9F6B5E98A03D16D4328E6E35092B42970072565185659AD5FC16A615"
+        "583B0ED7E2B65F012153023C6FF30B0602928394372902C2281F018B6DDB9C4C89714FE329D4B9653A4444E2CDD17E02"
+        "B9F546DC211CE89EFA25C01DDB1003CD9AD17E01B1AD07F1DEBA842C7F81B746",
+        "0",
+    },
+    {
+        "1849E28FD6F02CD52B94B16AA6D82975C9C2CBD2E8C9AC1E6D86A4BC67CA1196B8C6B2D8EBF2417FAC0919B50F6BC721"
+        "5E987DC774EDA754771ADAD60FA25939C7B1EFA9FB90156514C8D0A1171BDA784AB1FC65091CA33AA493BC738267BDC9"
+        "CA3EF8CD7F86B62A4799CEFB3351EAF15BAC7AD44028EC91E392971CA51EB53C2",
+        "67AF533ABAE3921ECB2E6BFA9C563CE8328B99D1FC33DA0B301FC72E3B3AFD42A70EC0FDE4BC701AC51FD1B1E7868B90"
+        "1694C1D3B31BF637A3481A49E1BD1DC7CC878DC11BB0E975A576FE30065A916BBEDE42149B3B049327708646D1CFE589"
+        "B9ED733EA3A48779B313EDE6EE437CCD9D29D84136B4EE5B120B7E3C9339B8E6",
+        "D60CE96A4F4443DC53970B96728E8781FD9709EDB2C0AAB0633D1532C88E5D7819D108CF5D6542855532A3F95BB10D6F"
+        "5244C251CDE9E0431D4D5E5123AC193B7FAAAB9344486948B1AAA0EC715D6CFC755B493557812880106E4BAD4C16EDCD"
+        "6B4DCC8776499AC0FF7F17997C6C3D332B7CB5F241988B6C0F7091CE843F2FC5",
+        "81EF168196B365A2A45AEE1EF03A68E6B0070FE12DB6A24123DE886336AA0FE227F02EF8C9E8CD93217F70B4E2CBA002"
+        "4D8CF8392E77F695F2CC75810C735EA6A32FA35886F363AF4B2C43F797EB7E91D40B32633D6AC1206F3D59B2FEADE868"
+        "4D2691165FDBA9352EA1E424768826D5CA9231393C93BD5835F3B17ECBC65455",
+        "9D65C8F46BBCD7C72108E9C809CF4F7D2D063359FF7919D840A0EB22A62D983BEC5A56E4D055EDA039561D6E524415E7"
+        "5338FC57B3FB9F108756730D7C8E95AD0707DCCF8B558D72C9325E059242104B86BB172D286EF28C281173C68ED1926A"
+        "37F982D2773546D45F171E66EC92895B363F8924B665BB148718DA1AF6B85BC2EEEEFF235524C628595E01739EAA6112"
+        "CD22F1992F792D472E7AC540DFF30D65DC3223F3004B040F355860AA2E3330916BFE9736039AF5A348A5521FF248E98E"
+        "6EEBFD8CBA6247EA52745BF92DBBD4E86F72E0EB55C6493E1EBCADD793A9FB9B393018BF771A565B102A787D9DB0011F"
+        "E2DD3AAFAF7D6381EBD3229CC9D2B04C",
+        "AE913F931FBE897665B40B13FAF40FDA9E95B340D9DA1736752D3693B412BBF3729A24BF61BED5756B5EF7579B0B64A6"
+        "97431A2580F0950454604F0FD6797A60FB744F0C74B8ED089AE2692500603A8835C47D1B3A490B2A38CD7B8ADA64EECF"
+        "38A1C0508221C7E37A1DD819B8B271E28F4AF751C0F63DB229B8DFFBCDAC23FD",
+        "18F3B0EE23DF677015CBA6639CF452DE8D54002067417FFEC6101AF874117E14BFA6586882875A9CBB0AB176DDC9A0ED"
+        "F1CE3B1FE1EA1B2C5E926BF1918DA903972C81C93B157C8E1D3E8D1456EBBDB7CDAAE1B0DD7DD0C82EAF1E2FE7F5F572"
+        "DB651ACAD55293C87B0B9BDED7D7EDA9F94FAB1A44EE00721E673C108722BBF",
+        "57B0C85175535B497E897FEC793719B90029B98FDCE2C8BA70E3ED23C530E70738C495DD15C2035C9D75B535EC62BC7B"
+        "7908EE34D323910EF931C901580C7BBCBAE6B6FFBB5E84CC66C017F076BA2762AC25C12D7A0A0063A5B9AAB973C9A8CC"
+        "19FB54AAEF7A41C846679163ABFB36DD155C4ABEACF97373AA08E01FE189D9D4",
+    },
+    {
+        "ACCDB979AE49D0A61670A634B2F2D77A72B1CA5A34A139B5B912D599AAB97DC21B8F158A4988D28C138600E8D17CBF3D"
+        "7B44D93B7C9547B2B7B4C686ACE42221024A32601B4757DCF4215A69A5F60DCD8AEF0DB2788586038FD695B6758B231E"
+        "A1AE879170745912935F488D6044A52E0D20E65164A4A3F98497EAF9B172F56A921F9CCF27722711187E2ADF413C4D23"
+        "FC6D2A7CC1E3C223804671BF4EEF74376F85E97DD55074181A7956A1223BA65B5CD599EB83F10875BF171C77D7732D72"
+        "1B21FAFCE1B4D1C4D5420863413373F9FE2FBABC2FACEB6887E39400E9EA2DDB6370C4707FF385C8E7DF15C642CD38F4"
+        "3093DAE1E837F4D5B632C97FB7645DEF",
+        "E5D8F03D4738F69242540BC23978A238AD53B4D7A83C58B8CC6A9AF6CEE0D2E4DA2DD716AB143711807515E8DFA64BFB"
+        "9DA402D3127D500E06C30A274DDD8974197513971C660F53E4D48D110A11EE5165A1ECFDC64E51C00AE7783D3E9D6DE3"
+        "36246E9B9D2FCE0A337D124EEDA7D82B1ABA84AAE4EF9528381278A11557885AB28FB61AA27C195102EFBAEA0F1CBE96"
+        "76FFBB1F6A19D9191F721134DAE45B56533D1177347D54D85B3D7D65A0EEC5F205C108272F67FE8D524BED8DD5C58955"
+        "8E61FC95E424439516ACEDCC0AFC2395EBF4CC7A54BF0E6643DC6C661511D2B301CF1DCF5BD450C12FABA8B7F34FE789"
+        "25B879B67ABEA1C86D2057EA8B3B041B",
+        "F9C61081C3646CAE7F0D56C03B2E999B64FE18AD863F83CED0411C0880B0D959A7C29444B0FF1828F7DE5533405D5356"
+        "D29034F5A10EA9CA0511F55B1F784C951ADC8DC7762539E813D38B417199E80B13546B971CC1626FDE090D15C49FD42A"
+        "2DB51BE8941DD8BBE74E0149085583C870BC568627927880D1B199E8D080CF9385C077B5044DD073D326B5727C21ED29"
+        "E92DFB20D532CF0CA2E37F2D6FD4F8BB71441E0C3437604FBCFAA5E59734A68C5F69462475A2D9AF5432E6AEA9E5A3E5"
+        "6805BF90D9887FEBB4AF0A85A0BCFDEBF26CD066690ED76492C536EACCBB50847DC3E20C52375B11B630EDEEA00B65C8"
+        "2B121E73CA90B0122FB066309BA57573",
+        "5B9F899FDD389B7826997E4CF6E57EE6E2C4137ECA5EE228E2A5DE08EDC54DD1A555717A829F296BC524CC033D15ED21"
+        "06A8187AE0FF6BB09BC59D36EB6FC11DE8E69181D35AF2EA7D922CD12728D8E996499A285E24AE4E9F9CC6B02C8C7382"
+        "11C8C37160703EA643459311A33A5A25DB307AA502948C63DE6F7CC02D31C83",
+        "9B2676A8928DDD3215B1337C8AE035F0AD4EC5571E5CB6409430DB28EAB3F0E48E734980A63608359B912C638F49BD88"
+        "5D49D725A95F6C3C3D149914DE2E98C6134FE671AAA28615B251E5EB6BFAAC47570568472E135A40E8DD01E4939EE9B4"
+        "FFBF648F45D5D1B9C0AAA694A828FC53B924CAB948EA291F6B0C79093E6E81C3DACBF6D9C480402F5BD48CCF05D6F8CA"
+        "4A1C0B627DB4C3DCDDBD65FB8C9D4AED18BC6CE378BD0C1F0C41E838720F035C85F4EA4B973D6EBCA7FF5336B08BCF3A"
+        "BC08D4B64FF972AC97FADEE3A21D77CBA86267B19F5BAA1ABD912B58542CFFDEB624C33003D6CE564EDBBAF5832C2E4C"
+        "39A08D695E14DB989BDA2C2A124F2E8669E7F1D8F6122623F9D6045F05C198B8F1F005E9AC43F6DB44C36AFB11F9AA47"
+        "248FD80B5390C55581F256AFD1DF24B4DA5FD7D7564B9EE0359F2B299012BD0AB2AB5568A8D86696C11DABA123959023"
+        "544016687F8B59242C90E83170F76095844D2E97A2B7EBA036AE32FE4CF0D694CCF17C1D40F51FB4942F31FCBAAC9C3B"
+        "2EE84923857DDD9DD3E1857A69F663FAE0F5D2746B65B393076544047C02B26285C428D2BED366B1092325A9A4E4D058"
+        "9F82D4D0F8EB1FF6815E9AC4980C17437632A25C8AD88E9213854F2936EF169C2EEE9805A2444B53D4642D805D5F6897"
+        "567D72C691C8610D4973AFCDB7D8F973FDEEC4FB35BAAAD30A0E17EE5422A435",
+        "ACCDB979AE49D0A61670A634B2F2D77A72B1CA5A34A139B5B912D599AAB97DC21B8F158A4988D28C138600E8D17CBF3D"
+        "7B44D93B7C9547B2B7B4C686ACE42221024A32601B4757DCF4215A69A5F60DCD8AEF0DB2788586038FD695B6758B231E"
+        "A1AE879170745912935F488D6044A52E0D20E65164A4A3F98497EAF9B172F56A921F9CCF27722711187E2ADF413C4D23"
+        "FC6D2A7CC1E3C223804671BF4EEF74376F85E97DD55074181A7956A1223BA65B5CD599EB83F10875BF171C77D7732D72"
+        "1B21FAFCE1B4D1C4D5420863413373F9FE2FBABC2FACEB6887E39400E9EA2DDB6370C4707FF385C8E7DF15C642CD38F4"
+        "3093DAE1E837F4D5B632C97FB7645DEF",
+        "5F40AFBCF0491D038327C6FF110FE4F4A169655244AB4ADAE1C4E4B69D1881A234F9495E8B28B45D884B01F3C2C8BF93"
+        "061E312BFF1EAC2CDBBC0837991E0F15C3B129FBC3EE4724873781CD512CA0F0609102F1B46DF333E42262810F4A51A3"
+        "9591F264500B6ED164F2A700916271F1CF6BF99A586907D6A5FD57ECBC3534A0FEBAFBC6E8C4871E064119AB8E35B024"
+        "574CD5B1F285112C666394B947A2EF2EFCB3A01DC724C1593F5305F4DBBAEBBCDD673408199D9BD84EB4002625757453"
+        "C4D9C7F50249A2136CE3C6CD7094FC953E4F4BE8FC6C8E6C983D25931FB2E3958FDE3D9A92301C6230C77269907F79F5"
+        "07EEBF708A5E1E9050EFD41D7442412D",
+        "0",
+    },
+    {
+        "BB7EA33A7B546D5CE70116788D490C76C0FEE651700638D5B4CE8FC682D9CCFA822FBE9F9E4AE100F393199DCBF973AA"
+        "1BBA94F549EB6B585204194A509732A7F81A94791A1E482A6830CE31A03840B47E912218422BA55C4439EE9DB8AA3635"
+        "996D9E79ABCD625438CAEACA2C6BE1767A99F6406ED596316CAF691271D20A1A1BFED24FE55823052FD2664FF5F22767"
+        "80D4525C5B78AC6E7EEA99F61C102E16EC1D1EBE484F0FFC72D533BA91E60FFC5C2EB8B654A2B3E36A981BCC1FB5A757"
+        "8AD5A862376658E3BD6CBADACB21A1720B41AE965A60A0A214C6F8535006E1A9C12890A64566D584C85B261A4D7BF827"
+        "65CF611BA4E64DFFF0797D131FFCAD74084B03174E966D7E735859745B3FF49C0690C9B04C680CF989E31E2AF1F8698D"
+        "D836654640B0F5DC455A54336D5DACED051941860F13F70A02A8CF899CD2DCED07597AA216A7D492BB3A4870B925AB1F"
+        "7038E6D405E464A98B031C5C6CF0273DAA988A8E486F769B5FCD7635521FC73994040CBCE2A2DAD6B3519C1F5B756A5F",
+        "C6EC9DBD41F66F33",
+        "5D60EC3AA786471625D5E800417BBB365616669EBEEC6A38F5C8225373D3CCB41EBC6CF8FD95E15FE4192236216082ED"
+        "DF05DC13B614A3024E8513880F8518F52C06DE51DFA85C308068835FFC81591D9094293F0251B917B58A37ACB971533F"
+        "9D3A864E4DA268F85028C7C98E620B663FF4DC3FA20F57E5E7FC9A534537259701F4C85C944FBEDC69D0EF6FEB8AE20D"
+        "70AC45C6833FDB299955DE3784856A9127B610FB51EBED6DA6950D1E9FB57B73DBD3782B598D251BBEF43C6630B219A3"
+        "4A7765AA2B41467403BF50A7C40E1D22A19E772105456C5F090868EFED1F3657DBCFD8B267137996C7ECEEFA62F5DB99"
+        "D60648B7CC028B9AA93B78A1D4AFF189",
+        "9DBAA81A5F09A40411AA594BFDACA6E0C0EDEEAD5C035865A3E4E550D285AA9A86DA0A7C22A635EA98DEF6C9B328017F"
+        "B74FF8578B53F05A4CA16E1F61A6BE5817A494E62ABA32C8EF0D51B20BCA71C0DD6F13E980720CBBFEAEB52570F23BAC"
+        "92C726D52C1546F04345AD5B4423B5B917682A10CC90FDA6AE694988075EBB83",
+        "91B13E84FC3602CE773A56AA0628980D23FF28CB123B38482CA5E37E230826190A9BA9DBA9C7249C4A47530528C74EAC"
+        "C23374C311C0738110BA083D3C84045F2016C867F302776F8DF7F58CC4AF26ADB1FE3BE1F5716E947D45595F4BB6FFC1"
+        "3470B61BFE0A285BDB981CBA5770EC58B0BFBB81260AE1D7ACECCA6382BD9812B61D0072B491CC951E47283260E33281"
+        "D6906D20D2A68A5047D98291286BC60B4D13BBCC67E19BCF620E92A6AA642CC320D3805844FE1AAE68A1B0097F0EEEC9"
+        "85611C6FD684BC4ACC8D5E91AA8C7E689F2F23A7F93842CB178D64AC23D04A03D20D65444F00C08A206FFBA6985F5BBE"
+        "33678CC7E6AFCC1B60A77749C9786D95DA3CFBD212B2405814A07CCD012BE6D48E8382FF829B643ED892DB084712C226"
+        "D82788C70B8677D31ED02211CC750B46E15936AA19C67707D39F4750D77340183008B3F8DEA734385DDBB345BEB71CA8"
+        "A9E2DE672AFE88C305D36C0D2683BB07578D6C527936C1F9BEF24947221E7C0E9D7AA238CBD80C9B70713C6C2ED15857"
+        "29CE30E077CD61ED",
+        "221A4318519FAA9EC9D7AA288B7943E69A3CE9A26959C47F70679B10DED14DF71E2E77F7B6D624C5CC719C641497B509"
+        "EA0A95E4A7F311F167B26A4779CA4B6F2BB0AC9D3914880EF7133C02581F0C5210C49E4B9AD22875BCFA0BB735E68ADD"
+        "6B1B31ECAD1392B740D2DD514B5753238FBF3B5E83BC93CF1156D7BCDDCA81676D9A4D171F6A051750D7A1CEE43BF124"
+        "355BA08FC42F325F23608823DD69A57F4A736643E740E2480A7B87FA96148DE2C2DD0A70ADBD0980A44C9DE3D0F2BEC8"
+        "DE7E74D2031922BD2A4AA65B84A758D23DC0CE84C9D86B8BE6E74104977E2013FF570C47F2AD0A2905C14CDCCF7D1642"
+        "975E3BF767894B2BF4654DFFDFC16BCB",
+        "25B202A404B60BF6B04EB91EF1E81344FBAF0BD30F6833E1C5376077531768517DD3A476788F04EFCEA0014697FE1E6A"
+        "857CD79B529776F24F8ABC52F61FF4A73B5FFC0E885630CA8811896E41D6815D5D3D2CFC5A21ECF18B59F231CBE204C9"
+        "FC3F9D87A5BEA3719D3292AD0BCC0B7E337BA692B1556C194A30D9E2D4F62B3F349CAE60C1802547887BB9C3760EBBE9"
+        "A55665BECB73F09A5B306CD87150C093B05758235592B00667F59B270BE8CF2BA306DAD95F847E1D6A0C8AB62B22FDC3"
+        "63804E80644D15FC1DCF7E486AA70FE78AE99921FAB38823B4C0667034BFBD927EA1E633E9FDF828544D6A9477661611"
+        "EA3669B8BDE53E68DF3D962A84C8D30F",
+        "5BE5218425C1A83A82CA8D04C9F3558B83EB648B31F579CAF3B99075968A8C79F962B705286D09369C9E75A5B97387B1"
+        "144956F7B11AA26BB3DCBA491FA290808AE9FADD8C43AA1E9E18408BF8C45A8B95FDA4C381D73B4E7E615F3A16BF9F0A"
+        "5C85052AB1D875A717FD650907C19F7529DBF37D87D18EC1D88194408D161C2F6BC7B68CD8601F8D114EA2CDB49707DA"
+        "80F06146857796574C3F74263A5BD5EB6C7A5493B3A9BD338A877AEE3913B761E8A20F7B2D6822CC7BD063A9A73F3064"
+        "00389A0B9FA32670D92E3B7FEB1C3B21760AF8F9C156126D8AAEB9A692B07B1020DD684599C13B5606DEF7F0687542C2"
+        "F8C684460280153C37E094729FCADA00",
+    },
+    {
+        "91D8738EC35ED7ABBB302E75B2271D97ED5FF9460EDCB3B4F2E6508221BAE86BACDD9C823CEADC471FDAD2DFD5D0ADC4"
+        "662F53617975BB87083BF2620EE43683DA9EA138E9D27E9651116FA392449525BD9AEADD09E3676BDA2E5BA1959C0312"
+        "63E8340F02987077486E66D0360683CF53C8EE75FD637DB84A22591507C69E1C0A66EE4160948FEF1FC370E753F1D55F"
+        "B243F00C7B6400DDE08704631D1E7282EF8000CD51844482498E8EDD157CD5AAE363904C7CDD48CB3AE976A351B6DB13"
+        "3D1F138EA123411E3A9742DF5410769EE015D65C605371AB851026DC964D50368D02AF816D9EC58832E0F5273DE51C64"
+        "292BDF32862FCFD44BE321D6EBC4ED495586DB5261A2ABD6035ABEE5A33D31DEB46FF86871D16D53F1E0FD74D3E15FAF"
+        "8BFEA30DB9E138B517A62ED7564ED6B6A5E3850DE5714AAA2EFDA808E5C2376B3E8C6963D1D44C332669F81304F70659"
+        "94960BB0B28D4EE0EF6DD5C0D66BC48E50B61D4259216241EE9C871AF896D37E90F1BB13F3A6B418FFB647A9CCA36360"
+        "EAC4440A9709FE04FE5D9F57FD0E9DD2B0E125F8B2C5D95B9820134F751ACEFAFE6B5793A043A03F267B6C7465101CAA"
+        "0FAA8B53458D3CA15917780448FD22856A65799F7C5BFE8320AAB477276E54741C17D37EC1BE9341113F8EA9976033C5"
+        "7B20CD43ED576EA2AB7231B214A641ABD20E9D675C05CE6FAC9E5A5D7291B537",
+        "B9ACF0385C5113A193B991889DF937C0DE302DF68CE45589BB0C98B462095FE5E7AF2DDDDFB1D4B441586AE33A164BB9"
+        "548E66DEE61CF82CCD9134E7238177384522258F71D358E1BAF8AC8BA305BB4AC07A20258F3A036C4845E519AA15C298"
+        "B5BBA401E2C4D00201DB0BDE69CE620E0BB70F91D5C33FDBA5048DE4CA004807747E10901E0DF9050DDE3C8C8BD4C90F"
+        "77DA6A102D3287966A8ADB7B7AA3B4442BAE57DF532267B067915DB35385FBC98DF045570442FF0EA71061083DD59F26"
+        "7457BD4B06A24BA32A0AC6F7BEAD02D8EE72BD8B59C5E2D8E53FB387166184ABC3C45C9F831A6A46984DF9B5BB0FCB1A"
+        "D5B0A88DBD845D1029EA519CCCFA262FF9F22B90CD2E284974AC4FBC6E0650E0326E59124B371C04623DC6891813338D"
+        "352BFC420C01A1E5E41A0CA09C748692A5AAFDDFD7557643C1B33BCD1684E26AE16D9A589187F7FA781BBDD76B01A373"
+        "9CD253115A2744F0E89891EECEC48E7F3DBDB1D84FDACEC3F78601EA6F7233ED17A8EEDEF1E8A241F462BE9F5FFAB985"
+        "A85A77255A50A378D3426697DDAB7C3DA4FF4A22ACB055F98DA2BFA3D6F083F66BE0559F9F9CF62A7C0C631FBEF01704"
+        "C96D65B4E703CB54B7E8AD0353A5A73E3A37FAE0C8D5F5B318A0DCC373F8A10B072A2E40CED69D2C469F214BCCCA8F03"
+        "1E9A82883FA3FF0A868154B5FBD4804C14FE88465931A2F8CF16FCBA6D41E90E",
+        "BFAC4438058568FAB3D1D20D7EEA9AC9146DCC68478ED41E0AE6C54B55FC0E42D3DDCB2043910AC9857A95453213057F"
+        "74A43D20F8F127D59C65A0789B5B0460D0A0E86F56E98DF2375F471EE4D1E6B31F4BDE1A07C588C2E704CD3A34E83513"
+        "F86838CACBAD8451F0357DD769A9E17BBD1FEE714763178DDF63340DA9E1FFBE042F43B69519234F43A6D46D39E0F4CB"
+        "95D374BCB0ECB490FB22231EF5FB836915B4928EB311DBC34C57BAD3D06567CB0050F7E01FF6E8D3D335A64A127D78E3"
+        "59C61E57086D844E5ECA6AA5743FA109033500168402A0D74F472CB37D05E48BEF65810CABF928C643B1A2EB4F29EDD9"
+        "EA7BDE99D3E6CAD22D06734B17F2D9FFF364863B16CD1924F7671B554245D6B68EE742D93E54B2E32D0C6DC3174B26E6"
+        "3797D9F98624C016708AEBFC9EAF2ABBE98371FE26879E602608C1F5F56B3122800E641974ADC160659C02D637461E1C"
+        "E3022402605CA8F7082EF60C840723CE29BCBD7DAF2ACDC61C268661EADE320C4D8139FB917A37380647948B00729A0D"
+        "6FAC78198D3ABA3B0718A7F3AE6CB11828DC792E90CBE833FE40A401039A8412D5830BA19A3BB0F381ACE5A67132896C"
+        "F3AAC9A276730AFBC385F18A890E0AEF5F5336C3216C281FA3B5CC845BF4F40AE8787B90F09E0C9C490CBF60E31E87C8"
+        "FFE34DAD5678775619EB7C3D627644649BB1FA1AD908BFF487DDE700FDBF84DB",
+        "3220303CD39721B2EE76FEC33213245650F3CD446A0ED79F76DEBF5B0FE635621ABD22A79B7B2C21A571698F1E19521F"
+        "6DC09207436A9FC773775751F2A4F3D24F3E351ADCBE32100881D3C26A5A4F6F9BAE5D97B47157EAB9E9ECE760054043"
+        "D142284865866259469F8E66368B68B69C5836A6FF89B2FA55767151CE8980C5",
+        "69C7F1CAD761E62AA4D6F17D2AF90450EC7C98F1C90175A1C20E1CAFC2806361F3A6DE360D5108B27057FA9DF51EDA08"
+        "2973834A40F6944F0E167E3ADA604C10D8636722DCF39C409506F5BB748769FC5E56882A71C5402A4D6899C22026B9CA"
+        "D3C61F6EE1F245B457D9A77F526938B0AE3EEDC48149BC511320E02788D4DFFB33C694DCDE140C28F3A5C4183780C508"
+        "3B1FEBD9E7E2A182DA456DFD6E4D4E293229BCC53AABC7E4E8A3CBDBFD23F8C550C6B0731585394F599D43409BFB8408"
+        "7371190A2CDE8E57FF83208D2B710D113DB24C0BE35CF4B6F1FB48D2BE4ECA1C253094DBB044604D5C7CDA5D24BA6C13"
+        "9A211FE6DDCC99E6477CADB887AB5ECC25BF19271F0CD9D36E96927868966323421BA3FA4F96B8465CAACA6692AC5AD3"
+        "5007E43AE71AE0AD03B2343F0A3ECA8EF9E0402BF47B6894653D6DD1A98E956876EC3BB512CB465097DD262D94BC2F51"
+        "1B41E7D34E2BD6AC6408965B3D9D4B9828FC52A80398AC60F4950F10EE76C125A56DF8D681B2EEDE63ACB28C4FA7A3C1"
+        "F89968886CBBCBBEB5FC3505A28E24A0A3565AE424211D2D1724F0E6D59612974790D4F4D4985AA0EBBE300434464A14"
+        "070D4E49C61925728F2B2750C0F3576E52222D520DA27EC92DC4126D6235FC37BDEC79FA2D2DF08857E36508DE06901E"
+        "A6BBED50B877A8ABC4BD98663E485D4DC87770B4BBAC98B32D9B49F602D231C2EAA9FA80430A83EC63EE23B86C80D882"
+        "11B074DDFFC6B202C1B538F57FD850BA5527EB6062BAC4D124932D8D861A727DC0B21882D7E5FC8CC12E35FFC7CEF242"
+        "6AD1AFCB563736F9D5F35E2755799EE40FD692081CBD1FD7760763225314FC01EB4107029A8BC417F99D96CC46D131D3"
+        "01765E8B709319FDEAAB2958DDB2EF92888E3980408761F0DB15B628B55CEC02FD46239FB6314E754FAF5023AA7C1CC2"
+        "76C287E762A76F461D9AEDEE51C43C0149910A6E292CFB1C9421B23E6B17A2F7299A61C942EFC50CAAD53C77C17038E3"
+        "D54B3844F4E07BA3F34A7129347C10B56981E19C05BE9E195A033389C662A25E7A21E23FB1F58B4E6DA9DE20B8382507"
+        "6979C3431DB583337C82FC9A5E91DC2A53B05BC3486820DA3F39B6E5C8765701311EDFC0A2F236D1E90A431B44887D76"
+        "19D9E2476E7A11D89EC077640CC5366ACBD579555FB99BAB013294A76AE24AD17FD4D35EADFEC02030240C60685BBEA6"
+        "872A15C5D4A43741839701E4507AE49463D61F9950F8C761B34CBECD5E67F16BC23FBF752C376D00FAF1F06B9308B4C6"
+        "A526E078A59EC4D65B45A5CE959C2BB426D5B2DB3C4A29605516B17CE4DDE76CFDE106B6A61BBC089345BDABDFEAF515"
+        "096D0BC9B20DE9741D9E19DD4BA5BB7620C9B99DFF5EA63773B317FC4010FCF8A346E690C71DF76B62BBF3C3B1D0B308"
+        "6D145878E817D8E80463ED804FDDF802",
+        "91D8738EC35ED7ABBB302E75B2271D97ED5FF9460EDCB3B4F2E6508221BAE86BACDD9C823CEADC471FDAD2DFD5D0ADC4"
+        "662F53617975BB87083BF2620EE43683DA9EA138E9D27E9651116FA392449525BD9AEADD09E3676BDA2E5BA1959C0312"
+        "63E8340F02987077486E66D0360683CF53C8EE75FD637DB84A22591507C69E1C0A66EE4160948FEF1FC370E753F1D55F"
+        "B243F00C7B6400DDE08704631D1E7282EF8000CD51844482498E8EDD157CD5AAE363904C7CDD48CB3AE976A351B6DB13"
+        "3D1F138EA123411E3A9742DF5410769EE015D65C605371AB851026DC964D50368D02AF816D9EC58832E0F5273DE51C64"
+        "292BDF32862FCFD44BE321D6EBC4ED495586DB5261A2ABD6035ABEE5A33D31DEB46FF86871D16D53F1E0FD74D3E15FAF"
+        "8BFEA30DB9E138B517A62ED7564ED6B6A5E3850DE5714AAA2EFDA808E5C2376B3E8C6963D1D44C332669F81304F70659"
+        "94960BB0B28D4EE0EF6DD5C0D66BC48E50B61D4259216241EE9C871AF896D37E90F1BB13F3A6B418FFB647A9CCA36360"
+        "EAC4440A9709FE04FE5D9F57FD0E9DD2B0E125F8B2C5D95B9820134F751ACEFAFE6B5793A043A03F267B6C7465101CAA"
+        "0FAA8B53458D3CA15917780448FD22856A65799F7C5BFE8320AAB477276E54741C17D37EC1BE9341113F8EA9976033C5"
+        "7B20CD43ED576EA2AB7231B214A641ABD20E9D675C05CE6FAC9E5A5D7291B537",
+        "4FEB328F3FAC58C5C75948F48EB69CB677154D5556B83FBCE89DF5B7BC0F28B28A364D1286BA6264590700073420DAC9"
+        "5E5948B21886372C221BC2B43A57320623C7AAB3F40A3FE762E2FBD154CBB1BAB12C878E5767C5CC10B5A12D7CB967C8"
+        "2DD22CAB23F2B26EAA3E08A6DE26EF18100C5594F49A545759B47DE3035027082EED8F618AE0AADF1787B56163EF8175"
+        "89A415A2DF296C3FDD6B1C1E351C1FB59374E49AAA33F94D197088649F8088CA7BDE5A7B23275FCCC5FE7B4391E92612"
+        "C371EAB3FB735C631F9C1507336775118D03A98619260668DC38849779393232675D47181A1CAD5224BFC9FC2A8BE7E2"
+        "50561B7FF8DC2548A67A0C54E17C3D4F2A8619BFC24E12E9578B03F6A25D025CCF992517B94E149EBE3F730E83831524"
+        "B91B721AED0F8060DD5856DB0E7A2FE30838A1119380BBAEF23CB0BF98FFFF75CD346A0581C8A5E037A8FCDBFEE399D4"
+        "55DC492A452D1BB0018725A038372DF161B1A5E465D105DE98D01D9EA8D141491B509B68009401A86AA1773FA43DDF5F"
+        "6D39BCECE59D0A4DF3725B75495A0ED902B9B35CF912F23DDF6F428EFA96580D4791FFB7F2CCD0D294558D479CED6C37"
+        "3E7C8B63D17A079C275D12AE08758C8C386EBB1FB8CD8807A7331E7B0F367022C69E9F6DF53EADE8CABADAFB8EC32F69"
+        "69E9D3AC36CDE324326F395E3715050EF605E945EC196E914CE98E4313FD0B93",
+        "ACB9C419B57543104F6664F15967520C8265D5D7E6E9CC2DA18100683001AC378FCB7FAF1499338CC533ABF630427DC7"
+        "5F7F03F4476C1FBFAE4E7617C40F597B847F3E4DE662E17E3A32D5419D8A23DEDE9BF278C71B29B08828E19FA0CE8E5A"
+        "8595B18724A32A936F261F5A9FBA2823B050862352C38E25B7CE50DD17445565F1D06B0B3F850F8528596B65EEF37E87"
+        "426D220E4D5EE1C2AF1562C0403DEB4892E4D888671D1DB5C5FD3324538F2D6F7E5F1651ADA005789FB1A053D5741296"
+        "BAD60EE395995A88EF45FF096BB10E236F3FE303AEE6572755CA9AED2841AFFDFA76F60619D09FB732FBF9C468085196"
+        "3143DC7E1CB4BB2CF8980A00E2B774040611B4857517991E41D428DE67E2647E751D8AB23A2DB2D73A653BA75B59EB84"
+        "6CCC974EA5AD1B33538EFABBC942F73196EFCBF5F282750B11CF0F45019095D238B16889BA885902AAAB56A5AB2999E8"
+        "19B31EDF7561EF13C0214D3EE1786DFCC93137054F2367972809054DF8B508A3E749D6319FE50C1F4753B8DC0091596D"
+        "16C1DD6D1935ED1DA0D2B0C6CBD2E1CA5A97C0B43BDE7B1CDBD063B1E97C5FBFE29526F74D0641818176CCEC643F3240"
+        "F0C230DDF3C5C81622565EC53D20498C6B0B18F32F5A311571A66DDEEB4894090A483F4C3C6354DF43E98A691727C9A6"
+        "D85112C0A2166718C6BE995B09A752DFD2C7B71C18CA8FBB449B4A727DCE3401",
+    },
+};
+
+static const char *g_rsa_n = "D12644F0F40DEBD5C635A76020C9CEB314EBDC48D60F484A1C9AD4CEA19408610AA58299174D9719ECB88E8743F74021"
+        "BD568435A0AF1FF89885E8D1716ACB7824299B9A049283FADEC9E812161D619A5A19E8461EB07D9D17469F976DF2322C"
+        "5D0AA46D5CBF7D64465C88C8E155610866051FAEE21BB7F6047736B2B7FFD6B5";
+static const char *g_rsa_p = "F889738BEBBD1871C5AFFF563F4EC432DA900610A72E97654DF8878E455F4AF9AA5CF7CC90D76A0B1370F16ABCE9A5E0"
+        "609406B76FE660143BE5C61F4CB8B173";
+static const char *g_rsa_q = "D76E0A226D5E3A4B118A7E245AB0CA33C87C6570812C814F427F16B69DDC4881DBC78E9271C5D8B4AC76105EB36526C8"
+        "E2408731AEA387120D6BB7D04C3DAD37";
+static const char *g_rsa_d = "A2927AB8491CA11AB44D7462F659A7BFF01D3E47A78C8D867E21A41551E77D73E110B22949C1D81820B77CA28C241EC7"
+        "9B232AF57C8763F49AAA4C44B1427010F47558689E09B24F231549A7A2A4944CF897154B0CA7681E8EDB4D8DD9A1064D"
+        "335E0032EBC0FB9073ABDB59A78393C537D7431854627DCB5B0F8144BA5563E9";
+static const char *g_rsa_msg = "1FCF7F819AB016613140C3DF4824DAE5BCF75EE948E00B0A854F9A247D9B2CEAAED671CE823F6DE63AAD6C3864B59852"
+        "B5E8F9315F40A22651038A85BE4D6CC5A24126D711CAE9D6286CDF9D1744057150538FA226B45ED4317959BD36A372D6"
+        "B679518D6BAB60298031635A87218C05EBC6BE75AB0AF026F35864C03819115";
+static const char *g_rsa_cipher = "91DB5B59B0FAE70DE5E481C0C2F6B682AEC2A59A79BF7F2E9CD54194BA1594B0BED90F2298839A56F1881E2C3FBE28AF"
+        "1C4BC0711D9E9485DC346CC7FAED39FA9B555D5456EFFA91B5AAA1575A3AD8393214F131C2CEABB289B3E9BC7BE2A872"
+        "E3336BBDF06A396AAF438C83BF331FB001B7A4331615D7CC550544E9324CF234";
+
+static const char *g_ecdh_da = "7915EF5E9788AC306D364758AD9398850B4671673AC4FEFBF32B9FE638BAD9E1D7863A676E6F29910F51DDEAEA2D43";
+static const char *g_ecdh_qax = "8CABD68472C1CFBB3C095AB8280BE46FE3A2B004EF25FF94E3D0CBC0445BDC7EEBD3235FDE735377A106192963469D77";
+static const char *g_ecdh_qay = "2A2DFC74903B9C3465ABFBF5AE31ADB71A0EE663A1AA05797FEF458001B199C7BBDFE728D96B8F772538638496E19A3D";
+static const char *g_ecdh_qbx = "D114BE29B6A710D8AE512832FE44AE1E69ED33783C36CA21F6175A0078A6158CD23D40708AB4C0C6CD92AF6FABF4B9CC";
+static const char *g_ecdh_qby = "D4929CB3CA9322330E9752307769A6221D89916426D20BDC90A27543A5EEF8C637C677E843AA0AE9F823FC8EF78F1B2";
+static const char *g_ecdh_z = "305EF921EEAD5C555480B685CE74931B93FCAB953154A06402DB5E1AFA8FE4528A2A43FB106A8F8B8EA8AE1C236FD0A9";
+static int read_hex(bscomptls_mpi *X, const char *hex)
+{
+    return bscomptls_mpi_read_string(X, 16, hex);
+}
+
+static int equals_hex(const bscomptls_mpi *X, const char *hex)
+{
+    bscomptls_mpi expect;
+    int equal = 0;
+
+    bscomptls_mpi_init(&expect);
+    equal = (0 == read_hex(&expect, hex) && 0 == bscomptls_mpi_cmp_mpi(X, &expect));
+    bscomptls_mpi_free(&expect);
+    return equal;
+}
+
+static int fixed_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    size_t i = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = (unsigned char)test_rand();
+    }
+    return 0;
+}
+
+static void case_kat(void)
+{
+    bscomptls_mpi A, B, M, E, X, RR;
+    size_t i = 0;
+    int invertible = 0;
+
+    bscomptls_mpi_init(&A);
+    bscomptls_mpi_init(&B);
+    bscomptls_mpi_init(&M);
+    bscomptls_mpi_init(&E);
+    bscomptls_mpi_init(&X);
+    bscomptls_mpi_init(&RR);
+    for (i = 0; i < sizeof(g_bignum_kat) / sizeof(g_bignum_kat[0]); i++)
+    {
+        const bignum_kat *kat = &g_bignum_kat[i];
+
+        TEST_CHECK(0 == read_hex(&A, kat->a) && 0 == read_hex(&B, kat->b) && 0 == read_hex(&M, kat->m) && 0 == read_hex(&E, kat->e));
+        TEST_CHECK_MSG(0 == bscomptls_mpi_mul_mpi(&X, &A, &B) && equals_hex(&X, kat->a_mul_b), "mul, %zu bits", bscomptls_mpi_bitlen(&A));
+        TEST_CHECK_MSG(0 == bscomptls_mpi_mod_mpi(&X, &A, &M) && equals_hex(&X, kat->a_mod_m), "mod, %zu bits", bscomptls_mpi_bitlen(&M));
+        TEST_CHECK_MSG(0 == bscomptls_mpi_exp_mod(&X, &A, &E, &M, &RR) && equals_hex(&X, kat->a_exp_e_mod_m), "exp_mod, %zu bits",
+                       bscomptls_mpi_bitlen(&M));
+        /* 第二次用算好的R^2 mod M */
+        TEST_CHECK(0 == bscomptls_mpi_exp_mod(&X, &A, &E, &M, &RR) && equals_hex(&X, kat->a_exp_e_mod_m));
+        invertible = (0 != strcmp(kat->a_inv_mod_m, "0"));
+        TEST_CHECK_MSG(invertible == (0 == bscomptls_mpi_inv_mod(&X, &A, &M)), "inv_mod, %zu bits", bscomptls_mpi_bitlen(&M));
+        TEST_CHECK(!invertible || equals_hex(&X, kat->a_inv_mod_m));
+
+        TEST_CHECK(0 == generic_mpi_mul_mpi(&X, &A, &B) && equals_hex(&X, kat->a_mul_b));
+        TEST_CHECK(0 == generic_mpi_exp_mod(&X, &A, &E, &M, NULL) && equals_hex(&X, kat->a_exp_e_mod_m));
+        bscomptls_mpi_free(&RR);
+    }
+    bscomptls_mpi_free(&A);
+    bscomptls_mpi_free(&B);
+    bscomptls_mpi_free(&M);
+    bscomptls_mpi_free(&E);
+    bscomptls_mpi_free(&X);
+}
+
+static void case_rsa(void)
+{
+    bscomptls_rsa_context rsa;
+    bscomptls_mpi P1, Q1, X;
+    unsigned char msg[128];
+    unsigned char cipher[128];
+    unsigned char out[128];
+
+    bscomptls_rsa_init(&rsa, BSCOMPTLS_RSA_PKCS_V15, 0);
+    bscomptls_mpi_init(&P1);
+    bscomptls_mpi_init(&Q1);
+    bscomptls_mpi_init(&X);
+    TEST_CHECK(0 == read_hex(&rsa.N, g_rsa_n) && 0 == read_hex(&rsa.P, g_rsa_p) && 0 == read_hex(&rsa.Q, g_rsa_q) &&
+               0 == read_hex(&rsa.D, g_rsa_d) && 0 == bscomptls_mpi_lset(&rsa.E, 65537));
+    TEST_CHECK(0 == bscomptls_mpi_sub_int(&P1, &rsa.P, 1) && 0 == bscomptls_mpi_sub_int(&Q1, &rsa.Q, 1) &&
+               0 == bscomptls_mpi_mod_mpi(&rsa.DP, &rsa.D, &P1) && 0 == bscomptls_mpi_mod_mpi(&rsa.DQ, &rsa.D, &Q1) &&
+               0 == bscomptls_mpi_inv_mod(&rsa.QP, &rsa.Q, &rsa.P));
+    rsa.len = (bscomptls_mpi_bitlen(&rsa.N) + 7) >> 3;
+    TEST_CHECK(128 == rsa.len);
+    TEST_CHECK(0 == bscomptls_rsa_check_privkey(&rsa));
+
+    TEST_CHECK(0 == read_hex(&X, g_rsa_msg) && 0 == bscomptls_mpi_write_binary(&X, msg, sizeof(msg)));
+    TEST_CHECK(0 == read_hex(&X, g_rsa_cipher) && 0 == bscomptls_mpi_write_binary(&X, cipher, sizeof(cipher)));
+    TEST_CHECK(0 == bscomptls_rsa_public(&rsa, msg, out) && 0 == memcmp(out, cipher, sizeof(cipher)));
+    TEST_CHECK(0 == bscomptls_rsa_private(&rsa, fixed_rng, NULL, cipher, out) && 0 == memcmp(out, msg, sizeof(msg)));
+
+    bscomptls_mpi_free(&P1);
+    bscomptls_mpi_free(&Q1);
+    bscomptls_mpi_free(&X);
+    bscomptls_rsa_free(&rsa);
+}
+
+static void case_ecdh(void)
+{
+    bscomptls_ecp_group grp;
+    bscomptls_ecp_point Q;
+    bscomptls_mpi d, z;
+
+    bscomptls_ecp_group_init(&grp);
+    bscomptls_ecp_point_init(&Q);
+    bscomptls_mpi_init(&d);
+    bscomptls_mpi_init(&z);
+    TEST_CHECK(0 == bscomptls_ecp_group_load(&grp, BSCOMPTLS_ECP_DP_SECP384R1));
+    TEST_CHECK(0 == read_hex(&d, g_ecdh_da));
+
+    TEST_CHECK(0 == bscomptls_ecp_mul(&grp, &Q, &d, &grp.G, fixed_rng, NULL));
+    TEST_CHECK(equals_hex(&Q.X, g_ecdh_qax) && equals_hex(&Q.Y, g_ecdh_qay));
+
+    TEST_CHECK(0 == read_hex(&Q.X, g_ecdh_qbx) && 0 == read_hex(&Q.Y, g_ecdh_qby) && 0 == bscomptls_mpi_lset(&Q.Z, 1));
+    TEST_CHECK(0 == bscomptls_ecp_check_pubkey(&grp, &Q));
+    TEST_CHECK(0 == bscomptls_ecdh_compute_shared(&grp, &z, &Q, &d, fixed_rng, NULL));
+    TEST_CHECK(equals_hex(&z, g_ecdh_z));
+
+    bscomptls_mpi_free(&d);
+    bscomptls_mpi_free(&z);
+    bscomptls_ecp_point_free(&Q);
+    bscomptls_ecp_group_free(&grp);
+}
+
+/**
+ * \brief   随机limb数, limb取值偏向全0、全1和单个比特, 进位链最容易出错
+ */
+static void random_mpi(bscomptls_mpi *X, size_t limbs)
+{
+    size_t i = 0;
+    unsigned style = test_rand_below(4);
+
+    bscomptls_mpi_grow(X, limbs);
+    bscomptls_mpi_lset(X, 0);
+    for (i = 0; i < limbs; i++)
+    {
+        switch (0 == style ? test_rand_below(4) : 3)
+        {
+        case 0:
+            X->p[i] = 0;
+            break;
+        case 1:
+            X->p[i] = (bscomptls_mpi_uint)-1;
+            break;
+        case 2:
+            X->p[i] = (bscomptls_mpi_uint)1 << test_rand_below(sizeof(bscomptls_mpi_uint) * 8);
+            break;
+        default:
+            X->p[i] = (bscomptls_mpi_uint)test_rand() << (sizeof(bscomptls_mpi_uint) * 4) << (sizeof(bscomptls_mpi_uint) * 4);
+            X->p[i] |= (bscomptls_mpi_uint)test_rand();
+            break;
+        }
+    }
+}
+
+static void case_random(void)
+{
+    bscomptls_mpi A, B, M, X, Y;
+    int round = 0;
+
+    bscomptls_mpi_init(&A);
+    bscomptls_mpi_init(&B);
+    bscomptls_mpi_init(&M);
+    bscomptls_mpi_init(&X);
+    bscomptls_mpi_init(&Y);
+    for (round = 0; round < RANDOM_ROUNDS && 0 == test_failures; round++)
+    {
+        random_mpi(&A, 1 + test_rand_below(RANDOM_LIMBS_MAX));
+        random_mpi(&B, 1 + test_rand_below(RANDOM_LIMBS_MAX));
+        TEST_CHECK(0 == bscomptls_mpi_mul_mpi(&X, &A, &B) && 0 == generic_mpi_mul_mpi(&Y, &A, &B));
+        TEST_CHECK_MSG(0 == bscomptls_mpi_cmp_mpi(&X, &Y), "mul %zu x %zu bits", bscomptls_mpi_bitlen(&A), bscomptls_mpi_bitlen(&B));
+
+        random_mpi(&M, 1 + test_rand_below(RANDOM_LIMBS_MAX / 2));
+        if (0 == bscomptls_mpi_cmp_int(&M, 0))
+        {
+            continue;
+        }
+        TEST_CHECK(0 == bscomptls_mpi_mod_mpi(&X, &A, &M) && 0 == generic_mpi_mod_mpi(&Y, &A, &M));
+        TEST_CHECK_MSG(0 == bscomptls_mpi_cmp_mpi(&X, &Y), "mod %zu by %zu bits", bscomptls_mpi_bitlen(&A), bscomptls_mpi_bitlen(&M));
+        TEST_CHECK((0 == bscomptls_mpi_inv_mod(&X, &A, &M)) == (0 == generic_mpi_inv_mod(&Y, &A, &M)));
+    }
+
+    /* 蒙哥马利乘法要求奇模数 */
+    for (round = 0; round < RANDOM_EXP_ROUNDS && 0 == test_failures; round++)
+    {
+        random_mpi(&M, 1 + test_rand_below(RANDOM_LIMBS_MAX / 2));
+        M.p[0] |= 1;
+        random_mpi(&A, 1 + test_rand_below(RANDOM_LIMBS_MAX / 2));
+        random_mpi(&B, 1 + test_rand_below(4));
+        TEST_CHECK(0 == bscomptls_mpi_exp_mod(&X, &A, &B, &M, NULL) && 0 == generic_mpi_exp_mod(&Y, &A, &B, &M, NULL));
+        TEST_CHECK_MSG(0 == bscomptls_mpi_cmp_mpi(&X, &Y), "exp_mod %zu bits", bscomptls_mpi_bitlen(&M));
+    }
+    bscomptls_mpi_free(&A);
+    bscomptls_mpi_free(&B);
+    bscomptls_mpi_free(&M);
+    bscomptls_mpi_free(&X);
+    bscomptls_mpi_free(&Y);
+}
+
+int main(void)
+{
+    test_rand_seed(43);
+    printf("bignum limb %zu bits\n", sizeof(bscomptls_mpi_uint) * 8);
+    case_kat();
+    case_rsa();
+    case_ecdh();
+    case_random();
+    return test_report("test_bignum");
+}
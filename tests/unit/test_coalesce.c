@@ -0,0 +1,285 @@
+/**
+ * \file      test_coalesce.c
+ * \brief     v3发送队列合并(coalesce_queue_pubmsg_exchange_v3)的随机测试
+ *
+ * 随机生成入队和出队的操作序列, 同一个序列分别按合并和不合并跑一遍, 检查:
+ * - 每个seq恰好结束一次: 发出去, 或者被同类的更新消息替换
+ * - 被替换的消息和替换它的消息同类, 且更早入队
+ * - 同类消息发出的顺序不变; 每个分道按入队位置先后发出, 替换的消息占用旧消息的位置
+ * - 每类消息合并时发出的值是不合并时的子序列, 最后一个值相同
+ * 同类消息固定走同一个分道, 与实际用法一致.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kerne_queuel.h"
+#include "platform_define.h"
+
+EXTERN_LANE_QUEUE_FUN(pubmsg_exchange_v3)
+EXTERN_QUEUE_BASE_FUN
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define KEY_COUNT       8
+#define PUSH_COUNT      4000
+#define ROUNDS          200
+
+typedef struct
+{
+    const char *module;
+    const char *method;
+    const char *ext_msg;
+    const char *coalesce_key;
+    EZDEV_SDK_UINT8 lane;
+    EZDEV_SDK_UINT8 coalesce;
+} msg_key;
+
+/* 前6类可合并, 其中两类只有ext_msg或coalesce_key不同; 后2类不合并 */
+static const msg_key g_keys[KEY_COUNT] = {
+    {"model", "attribute", "1/Temperature", "", ezdev_sdk_queue_lane_interactive, 1},
+    {"model", "attribute", "1/Humidity", "", ezdev_sdk_queue_lane_interactive, 1},
+    {"model", "event", "1/Battery", "", ezdev_sdk_queue_lane_bulk, 1},
+    {"ota", "progress", "", "a", ezdev_sdk_queue_lane_bulk, 1},
+    {"ota", "progress", "", "b", ezdev_sdk_queue_lane_bulk, 1},
+    {"basic", "status", "", "", ezdev_sdk_queue_lane_control, 1},
+    {"model", "event", "1/Alarm", "", ezdev_sdk_queue_lane_interactive, 0},
+    {"storage", "upload", "", "", ezdev_sdk_queue_lane_bulk, 0},
+};
+
+typedef struct
+{
+    int key;
+    int slot;           ///< 在队列中的位置, 取最初占用这个位置的消息seq
+    int sent;
+    int superseded;
+    int superseded_by;
+} seq_state;
+
+typedef struct
+{
+    int *values[KEY_COUNT];     ///< 每类消息依次发出的seq
+    int count[KEY_COUNT];
+    int last_slot[ezdev_sdk_queue_lane_count];
+    int last_plain[ezdev_sdk_queue_lane_count];
+} run_result;
+
+static seq_state g_seq[PUSH_COUNT];
+static int g_push_key[PUSH_COUNT];     ///< 每轮的入队序列, 两种跑法相同
+
+static ezdev_sdk_kernel_pubmsg_exchange_v3 *make_msg(int seq, int key, int coalesce)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *msg = calloc(1, sizeof(*msg));
+    const msg_key *k = &g_keys[key];
+
+    msg->msg_lane = k->lane;
+    msg->max_send_count = 1;
+    msg->msg_conntext_v3.msg_seq = (EZDEV_SDK_UINT32)seq;
+    msg->msg_conntext_v3.msg_coalesce = coalesce && k->coalesce;
+    strcpy(msg->msg_conntext_v3.module, k->module);
+    strcpy(msg->msg_conntext_v3.method, k->method);
+    strcpy(msg->msg_conntext_v3.ext_msg, k->ext_msg);
+    strcpy(msg->msg_conntext_v3.coalesce_key, k->coalesce_key);
+    strcpy(msg->msg_conntext_v3.resource_id, "0");
+    strcpy(msg->msg_conntext_v3.resource_type, "global");
+    strcpy(msg->msg_conntext_v3.msg_type, "report");
+    return msg;
+}
+
+static void deliver(run_result *result, ezdev_sdk_kernel_pubmsg_exchange_v3 *msg)
+{
+    int seq = (int)msg->msg_conntext_v3.msg_seq;
+    seq_state *state = &g_seq[seq];
+    int lane = msg->msg_lane;
+
+    TEST_CHECK_MSG(!state->sent && !state->superseded, "seq %d delivered twice", seq);
+    state->sent = 1;
+    result->values[state->key][result->count[state->key]++] = seq;
+
+    /* 分道内按位置先后发出 */
+    TEST_CHECK_MSG(state->slot > result->last_slot[lane], "lane %d slot %d after %d", lane, state->slot, result->last_slot[lane]);
+    result->last_slot[lane] = state->slot;
+    if (!g_keys[state->key].coalesce)
+    {
+        TEST_CHECK(seq > result->last_plain[lane]);
+        result->last_plain[lane] = seq;
+    }
+    free(msg);
+}
+
+static int pop_one(run_result *result)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *msg = NULL;
+
+    if (mkernel_internal_succ != pop_queue_pubmsg_exchange_v3(&msg))
+    {
+        return 0;
+    }
+    deliver(result, msg);
+    return 1;
+}
+
+static void run_once(uint64_t seed, uint32_t pop_percent, int coalesce, run_result *result)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *msg = NULL;
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *replaced = NULL;
+    mkernel_internal_error err = mkernel_internal_succ;
+    int seq = 0;
+    int key = 0;
+    int i = 0;
+
+    memset(g_seq, 0, sizeof(g_seq));
+    memset(result, 0, sizeof(*result));
+    for (i = 0; i < KEY_COUNT; i++)
+    {
+        result->values[i] = calloc(PUSH_COUNT, sizeof(int));
+    }
+    for (i = 0; i < ezdev_sdk_queue_lane_count; i++)
+    {
+        result->last_slot[i] = -1;
+        result->last_plain[i] = -1;
+    }
+
+    TEST_CHECK(mkernel_internal_succ == init_queue(16, 16));
+    test_rand_seed(seed);
+    for (seq = 0; seq < PUSH_COUNT; seq++)
+    {
+        key = g_push_key[seq];
+        g_seq[seq].key = key;
+        g_seq[seq].slot = seq;
+        msg = make_msg(seq, key, coalesce);
+
+        /* 分道满了先发掉一些, 不合并时入队不能失败 */
+        while (mkernel_internal_queue_full == (err = coalesce_queue_pubmsg_exchange_v3(msg, &replaced)))
+        {
+            TEST_CHECK(pop_one(result));
+        }
+        TEST_CHECK(mkernel_internal_succ == err);
+        if (NULL != replaced)
+        {
+            int old = (int)replaced->msg_conntext_v3.msg_seq;
+
+            TEST_CHECK(coalesce && g_keys[key].coalesce);
+            TEST_CHECK_MSG(g_seq[old].key == key && old < seq && !g_seq[old].sent && !g_seq[old].superseded,
+                           "seq %d replaced %d", seq, old);
+            TEST_CHECK(replaced->msg_lane == msg->msg_lane);
+            g_seq[old].superseded = 1;
+            g_seq[old].superseded_by = seq;
+            g_seq[seq].slot = g_seq[old].slot;
+            free(replaced);
+        }
+
+        while (test_rand_below(100) < pop_percent && pop_one(result))
+        {
+        }
+    }
+    while (pop_one(result))
+    {
+    }
+
+    for (seq = 0; seq < PUSH_COUNT; seq++)
+    {
+        TEST_CHECK_MSG(1 == g_seq[seq].sent + g_seq[seq].superseded, "seq %d sent %d superseded %d", seq, g_seq[seq].sent,
+                       g_seq[seq].superseded);
+        /* 同类消息的先后次序不变 */
+        if (g_seq[seq].superseded)
+        {
+            TEST_CHECK(g_seq[seq].superseded_by > seq);
+        }
+    }
+    for (key = 0; key < KEY_COUNT; key++)
+    {
+        for (i = 1; i < result->count[key]; i++)
+        {
+            TEST_CHECK(result->values[key][i] > result->values[key][i - 1]);
+        }
+    }
+    fini_queue();
+}
+
+/**
+ * \brief   合并时每类消息发出的值是不合并时的子序列, 且最后一个值相同
+ */
+static void compare(const run_result *merged, const run_result *plain)
+{
+    int key = 0;
+    int i = 0;
+    int j = 0;
+
+    for (key = 0; key < KEY_COUNT; key++)
+    {
+        TEST_CHECK(merged->count[key] <= plain->count[key]);
+        if (!g_keys[key].coalesce)
+        {
+            TEST_CHECK(merged->count[key] == plain->count[key]);
+        }
+        if (0 == plain->count[key])
+        {
+            TEST_CHECK(0 == merged->count[key]);
+            continue;
+        }
+        TEST_CHECK_MSG(merged->count[key] > 0 &&
+                       merged->values[key][merged->count[key] - 1] == plain->values[key][plain->count[key] - 1],
+                       "key %d final value differs", key);
+        for (i = 0, j = 0; i < merged->count[key] && j < plain->count[key]; j++)
+        {
+            if (merged->values[key][i] == plain->values[key][j])
+            {
+                i++;
+            }
+        }
+        TEST_CHECK_MSG(i == merged->count[key], "key %d: merged values are not a subsequence", key);
+    }
+}
+
+static void free_result(run_result *result)
+{
+    int i = 0;
+
+    for (i = 0; i < KEY_COUNT; i++)
+    {
+        free(result->values[i]);
+    }
+}
+
+int main(void)
+{
+    run_result merged;
+    run_result plain;
+    uint64_t sent = 0;
+    uint32_t pop_percent = 0;
+    int round = 0;
+    int key = 0;
+    int i = 0;
+
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_create = sdk_platform_thread_mutex_create;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+
+    for (round = 0; round < ROUNDS && 0 == test_failures; round++)
+    {
+        test_rand_seed(round + 1);
+        for (i = 0; i < PUSH_COUNT; i++)
+        {
+            g_push_key[i] = (int)test_rand_below(KEY_COUNT);
+        }
+        /* 出队快慢随轮次变化, 慢的时候积压多, 合并的机会也多 */
+        pop_percent = 10 + test_rand_below(50);
+        run_once(round + 1000, pop_percent, 1, &merged);
+        run_once(round + 1000, pop_percent, 0, &plain);
+        compare(&merged, &plain);
+        for (key = 0; key < KEY_COUNT; key++)
+        {
+            sent += merged.count[key];
+        }
+        free_result(&merged);
+        free_result(&plain);
+    }
+    printf("%d rounds, %d pushes each, %.1f%% sent after coalescing\n", round, PUSH_COUNT,
+           100.0 * (double)sent / ((double)round * PUSH_COUNT));
+    return test_report("test_coalesce");
+}
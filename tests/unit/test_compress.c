@@ -0,0 +1,187 @@
+/**
+ * \file      test_compress.c
+ * \brief     报文压缩(kernel_compress/kernel_decompress)的往返和解压边界检查
+ *
+ * - 0到几十字节的短输入、随机长度的JSON和随机数据, 压缩后解压与原文一致
+ * - 输出缓冲不够时压缩返回失败, 不越界
+ * - 压缩结果被翻转比特、截断、给错原长, 以及完全随机的输入, 解压只能成功或返回错误, 不越界
+ *   (用-DEZ_TESTS_SANITIZE=ON编译时由ASan检查), 成功时也只写dst_len字节
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "base_typedef.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_compress.h"
+#include "test_util.h"
+
+EZDEV_SDK_KERNEL_COMPRESS_INTERFACE
+
+#define BUF_MAX     8192
+#define ROUNDS      20000
+#define GUARD       64
+
+static unsigned char g_src[BUF_MAX];
+static unsigned char g_zip[BUF_MAX * 2];
+
+static size_t gen_json(unsigned char *buf, size_t cap)
+{
+    size_t len = 0;
+    unsigned i = 0;
+
+    len += snprintf((char *)buf + len, cap - len, "{\"props\":[");
+    while (len + 120 < cap)
+    {
+        len += snprintf((char *)buf + len, cap - len, "%s{\"identifier\":\"prop_%u\",\"value\":%u}", i++ ? "," : "",
+                        test_rand_below(40), test_rand_below(1000));
+    }
+    len += snprintf((char *)buf + len, cap - len, "]}");
+    return len;
+}
+
+/**
+ * \brief   解压到堆上正好dst_len大小的缓冲区后面跟一段哨兵, 检查没有写过界
+ */
+static mkernel_internal_error decompress_guarded(const unsigned char *zip, EZDEV_SDK_UINT32 zip_len, EZDEV_SDK_UINT32 dst_len,
+                                                 const unsigned char *expect)
+{
+    unsigned char *zip_copy = malloc(zip_len ? zip_len : 1);
+    unsigned char *dst = malloc(dst_len + GUARD);
+    mkernel_internal_error err = mkernel_internal_succ;
+    int i = 0;
+
+    memcpy(zip_copy, zip, zip_len);
+    memset(dst + dst_len, 0xA5, GUARD);
+    err = kernel_decompress(zip_copy, zip_len, dst, dst_len);
+    for (i = 0; i < GUARD; i++)
+    {
+        TEST_CHECK_MSG(0xA5 == dst[dst_len + i], "write past dst_len %u at +%d", dst_len, i);
+    }
+    if (mkernel_internal_succ == err && NULL != expect)
+    {
+        TEST_CHECK(0 == memcmp(dst, expect, dst_len));
+    }
+    free(dst);
+    free(zip_copy);
+    return err;
+}
+
+static void check_round_trip(EZDEV_SDK_UINT32 len)
+{
+    EZDEV_SDK_UINT32 zip_len = 0;
+
+    TEST_CHECK_MSG(mkernel_internal_succ == kernel_compress(g_src, len, g_zip, sizeof(g_zip), &zip_len), "compress %u bytes", len);
+    TEST_CHECK_MSG(mkernel_internal_succ == decompress_guarded(g_zip, zip_len, len, g_src), "decompress %u bytes", len);
+}
+
+static void case_round_trip(void)
+{
+    EZDEV_SDK_UINT32 len = 0;
+    EZDEV_SDK_UINT32 i = 0;
+    int round = 0;
+
+    for (len = 0; len < 80; len++)
+    {
+        for (i = 0; i < len; i++)
+        {
+            g_src[i] = "abab"[i % 4];
+        }
+        check_round_trip(len);
+        for (i = 0; i < len; i++)
+        {
+            g_src[i] = (unsigned char)test_rand();
+        }
+        check_round_trip(len);
+    }
+    for (round = 0; round < ROUNDS / 10 && 0 == test_failures; round++)
+    {
+        check_round_trip((EZDEV_SDK_UINT32)gen_json(g_src, 200 + test_rand_below(BUF_MAX - 200)));
+        len = 1 + test_rand_below(BUF_MAX - 1);
+        for (i = 0; i < len; i++)
+        {
+            /* 字母表大小随轮次变化, 从高度重复到不可压缩 */
+            g_src[i] = (unsigned char)test_rand_below(2 + (round % 8) * 36);
+        }
+        check_round_trip(len);
+    }
+}
+
+/**
+ * \brief   输出上限不够时返回失败, 上限之外一个字节都不写
+ */
+static void case_dst_limit(void)
+{
+    EZDEV_SDK_UINT32 len = (EZDEV_SDK_UINT32)gen_json(g_src, 4000);
+    EZDEV_SDK_UINT32 full = 0;
+    EZDEV_SDK_UINT32 zip_len = 0;
+    EZDEV_SDK_UINT32 limit = 0;
+    int i = 0;
+
+    TEST_CHECK(mkernel_internal_succ == kernel_compress(g_src, len, g_zip, sizeof(g_zip), &full));
+    for (limit = 0; limit < full; limit += 1 + limit / 8)
+    {
+        memset(g_zip, 0xA5, sizeof(g_zip));
+        TEST_CHECK_MSG(mkernel_internal_succ != kernel_compress(g_src, len, g_zip, limit, &zip_len), "limit %u of %u", limit, full);
+        for (i = 0; i < GUARD; i++)
+        {
+            TEST_CHECK(0xA5 == g_zip[limit + i]);
+        }
+    }
+    for (i = 0; i < BUF_MAX; i++)
+    {
+        g_src[i] = (unsigned char)test_rand();
+    }
+    TEST_CHECK(mkernel_internal_succ != kernel_compress(g_src, BUF_MAX, g_zip, BUF_MAX - BUF_MAX / 16, &zip_len));
+}
+
+static void case_corrupt(void)
+{
+    EZDEV_SDK_UINT32 len = 0;
+    EZDEV_SDK_UINT32 zip_len = 0;
+    EZDEV_SDK_UINT32 dst_len = 0;
+    int accepted = 0;
+    int round = 0;
+    int flips = 0;
+    int i = 0;
+
+    for (round = 0; round < ROUNDS && 0 == test_failures; round++)
+    {
+        len = (EZDEV_SDK_UINT32)gen_json(g_src, 200 + test_rand_below(3000));
+        TEST_CHECK(mkernel_internal_succ == kernel_compress(g_src, len, g_zip, sizeof(g_zip), &zip_len));
+        flips = 1 + (int)test_rand_below(4);
+        for (i = 0; i < flips; i++)
+        {
+            g_zip[test_rand_below(zip_len)] ^= (unsigned char)(1 << test_rand_below(8));
+        }
+        if (0 == test_rand_below(3))
+        {
+            zip_len -= 1 + test_rand_below(zip_len < 8 ? zip_len : 8);
+        }
+        /* 原长偏差一点, 或者远大于实际 */
+        dst_len = len + test_rand_below(3) - 1;
+        if (0 == test_rand_below(10))
+        {
+            dst_len = len * (2 + test_rand_below(200));
+        }
+        accepted += (mkernel_internal_succ == decompress_guarded(g_zip, zip_len, dst_len, NULL));
+    }
+
+    for (round = 0; round < ROUNDS && 0 == test_failures; round++)
+    {
+        zip_len = 1 + test_rand_below(64);
+        for (i = 0; i < (int)zip_len; i++)
+        {
+            g_zip[i] = (unsigned char)test_rand();
+        }
+        accepted += (mkernel_internal_succ == decompress_guarded(g_zip, zip_len, test_rand_below(70000), NULL));
+    }
+    printf("corrupt: %d of %d damaged or random streams still decoded to the requested length\n", accepted, ROUNDS * 2);
+}
+
+int main(void)
+{
+    test_rand_seed(1);
+    case_round_trip();
+    case_dst_limit();
+    case_corrupt();
+    return test_report("test_compress");
+}
@@ -0,0 +1,299 @@
+/**
+ * \file      test_das_gcm.c
+ * \brief     DAS报文加密对着替身服务端的端到端测试
+ *
+ * 每个场景在子进程里启动一次微内核, 快速上线连到standin_das:
+ * - CBC和GCM上下行收发, 替身独立实现的加解密与SDK互通
+ * - GCM下反复断线重连, 每次注册的发送随机数都不同, 所有上行报文头不重复
+ * - GCM下行重放(同一连接内、换连接之后)和篡改的报文被丢弃, 之后的正常报文照常收到
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test_util.h"
+#include "standin_das.h"
+#include "standin_kernel.h"
+
+#define WAIT_MS             5000
+#define RECONNECT_ROUNDS    100
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+
+static standin_das *boot(int cipher)
+{
+    standin_kernel_config config;
+    standin_das *das = standin_das_start(cipher, g_key);
+
+    if (NULL == das)
+    {
+        return NULL;
+    }
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = cipher;
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS))
+    {
+        standin_das_stop(das);
+        return NULL;
+    }
+    return das;
+}
+
+static void shutdown_all(standin_das *das)
+{
+    standin_kernel_stop();
+    standin_das_stop(das);
+}
+
+/**
+ * \brief   等设备发来指定method的上行消息, 中间的其它消息丢掉
+ */
+static int pop_uplink(standin_das *das, const char *method, standin_msg *msg)
+{
+    char want[128];
+
+    snprintf(want, sizeof(want), "/" STANDIN_KERNEL_MODULE "/%s/", method);
+    while (0 == standin_das_pop(das, msg, WAIT_MS))
+    {
+        if (NULL != strstr(msg->topic, want))
+        {
+            return 0;
+        }
+        standin_msg_free(msg);
+    }
+    return -1;
+}
+
+static uint32_t seq_count(const standin_msg *msg)
+{
+    return ((uint32_t)msg->seq[8] << 24) | ((uint32_t)msg->seq[9] << 16) | ((uint32_t)msg->seq[10] << 8) | msg->seq[11];
+}
+
+static void check_roundtrip(int cipher)
+{
+    standin_das *das = boot(cipher);
+    standin_msg msg;
+    standin_kernel_msg in;
+    standin_das_stats stats;
+    char body[256];
+    char topic[256];
+    unsigned char salt[8];
+    uint32_t last = 0;
+    int i = 0;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    for (i = 0; i < 20; i++)
+    {
+        snprintf(body, sizeof(body), "{\"up\":%d,\"pad\":\"%.*s\"}", i, i * 7, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+        TEST_CHECK(0 == standin_kernel_send("event", "report", body, strlen(body), 1000 + i));
+        TEST_CHECK(0 == pop_uplink(das, "event", &msg));
+        TEST_CHECK_MSG(msg.body_len == strlen(body) && 0 == memcmp(msg.body, body, msg.body_len), "uplink %d body: %s", i, msg.body);
+        TEST_CHECK(0 == msg.prev_key);
+        if (STANDIN_CIPHER_GCM == cipher)
+        {
+            /* 同一连接内随机数不变, 计数递增 */
+            if (0 == i)
+            {
+                memcpy(salt, msg.seq, sizeof(salt));
+            }
+            else
+            {
+                TEST_CHECK(0 == memcmp(salt, msg.seq, sizeof(salt)));
+                TEST_CHECK(seq_count(&msg) > last);
+            }
+            last = seq_count(&msg);
+        }
+        standin_msg_free(&msg);
+    }
+
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    for (i = 0; i < 20; i++)
+    {
+        snprintf(body, sizeof(body), "{\"down\":%d}", i);
+        TEST_CHECK(0 == standin_das_publish(das, topic, "{\"Seq\":7}", body, strlen(body)));
+        TEST_CHECK(0 == standin_kernel_pop(&in, WAIT_MS));
+        TEST_CHECK_MSG(in.body_len == strlen(body) && 0 == memcmp(in.body, body, in.body_len), "downlink %d body: %s", i, in.body);
+        TEST_CHECK(0 == strcmp(in.method, "service") && 0 == strcmp(in.msg_type, "set"));
+        standin_kernel_msg_free(&in);
+    }
+
+    standin_das_get_stats(das, &stats);
+    TEST_CHECK(0 == stats.decrypt_errors);
+    TEST_CHECK(0 == stats.nonce_reuse);
+    shutdown_all(das);
+}
+
+static void case_cbc_roundtrip(void)
+{
+    check_roundtrip(STANDIN_CIPHER_CBC);
+}
+
+static void case_gcm_roundtrip(void)
+{
+    check_roundtrip(STANDIN_CIPHER_GCM);
+}
+
+/**
+ * \brief   同一会话密钥下反复重连, 每次注册换随机数, 计数从头开始
+ */
+static void case_gcm_reconnect_salts(void)
+{
+    standin_das *das = boot(STANDIN_CIPHER_GCM);
+    standin_msg msg;
+    standin_das_stats stats;
+    unsigned char (*salts)[8] = calloc(RECONNECT_ROUNDS, 8);
+    char body[32];
+    int i = 0;
+    int j = 0;
+    int distinct = 1;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        free(salts);
+        return;
+    }
+
+    for (i = 0; i < RECONNECT_ROUNDS; i++)
+    {
+        snprintf(body, sizeof(body), "{\"round\":%d}", i);
+        TEST_CHECK(0 == standin_kernel_send("event", "report", body, strlen(body), (unsigned int)i));
+        if (0 != pop_uplink(das, "event", &msg))
+        {
+            TEST_CHECK_MSG(0, "no uplink in round %d", i);
+            break;
+        }
+        TEST_CHECK(msg.conn == i + 1);
+        memcpy(salts[i], msg.seq, 8);
+        for (j = 0; j < i; j++)
+        {
+            distinct &= (0 != memcmp(salts[i], salts[j], 8));
+        }
+        standin_msg_free(&msg);
+
+        standin_das_drop(das);
+        if (0 != standin_das_wait_connects(das, i + 2, WAIT_MS))
+        {
+            TEST_CHECK_MSG(0, "no reconnect after round %d", i);
+            break;
+        }
+    }
+
+    TEST_CHECK(distinct);
+    standin_das_get_stats(das, &stats);
+    TEST_CHECK_MSG(0 == stats.nonce_reuse, "nonce reuse %d", stats.nonce_reuse);
+    TEST_CHECK_MSG(0 == stats.salt_reuse, "salt reuse %d", stats.salt_reuse);
+    TEST_CHECK(0 == stats.decrypt_errors);
+    free(salts);
+    shutdown_all(das);
+}
+
+static int expect_downlink(const char *body)
+{
+    standin_kernel_msg in;
+    int ok = 0;
+
+    if (0 != standin_kernel_pop(&in, WAIT_MS))
+    {
+        return 0;
+    }
+    ok = in.body_len == strlen(body) && 0 == memcmp(in.body, body, in.body_len);
+    if (!ok)
+    {
+        fprintf(stderr, "unexpected downlink: %s, want %s\n", (const char *)in.body, body);
+    }
+    standin_kernel_msg_free(&in);
+    return ok;
+}
+
+/**
+ * \brief   重放、跨连接重放、篡改的下行报文都不能送到应用
+ */
+static void case_gcm_replay(void)
+{
+    standin_das *das = boot(STANDIN_CIPHER_GCM);
+    unsigned char first[512];
+    unsigned char second[512];
+    unsigned char forged[512];
+    size_t first_len = 0;
+    size_t second_len = 0;
+    char topic[256];
+    standin_kernel_msg in;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+
+    TEST_CHECK(0 == standin_das_publish(das, topic, "{\"Seq\":1}", "first", 5));
+    TEST_CHECK(expect_downlink("first"));
+    first_len = standin_das_last_downlink(das, first, sizeof(first));
+    TEST_CHECK(0 == standin_das_publish(das, topic, "{\"Seq\":2}", "second", 6));
+    TEST_CHECK(expect_downlink("second"));
+    second_len = standin_das_last_downlink(das, second, sizeof(second));
+
+    /* 同一连接内重放 */
+    TEST_CHECK(0 == standin_das_publish_raw(das, topic, first, first_len));
+    TEST_CHECK(0 == standin_das_publish_raw(das, topic, second, second_len));
+    /* 篡改: 改一个密文字节, 改计数 */
+    memcpy(forged, second, second_len);
+    forged[14] ^= 0x01;
+    TEST_CHECK(0 == standin_das_publish_raw(das, topic, forged, second_len));
+    memcpy(forged, second, second_len);
+    forged[11] ^= 0x40;
+    TEST_CHECK(0 == standin_das_publish_raw(das, topic, forged, second_len));
+    TEST_CHECK(0 == standin_das_publish(das, topic, "{\"Seq\":3}", "third", 5));
+    TEST_CHECK(expect_downlink("third"));
+
+    /* 换连接以后再重放上一个连接的报文 */
+    standin_das_drop(das);
+    TEST_CHECK(0 == standin_das_wait_connects(das, 2, WAIT_MS));
+    TEST_CHECK(0 == standin_kernel_send("event", "report", "{}", 2, 1));
+    TEST_CHECK(0 == standin_das_publish(das, topic, "{\"Seq\":4}", "fourth", 6));
+    TEST_CHECK(expect_downlink("fourth"));
+    TEST_CHECK(0 == standin_das_publish_raw(das, topic, first, first_len));
+    TEST_CHECK(0 == standin_das_publish_raw(das, topic, second, second_len));
+    TEST_CHECK(0 == standin_das_publish(das, topic, "{\"Seq\":5}", "fifth", 5));
+    TEST_CHECK(expect_downlink("fifth"));
+
+    TEST_CHECK(0 != standin_kernel_pop(&in, 200));
+    shutdown_all(das);
+}
+
+/**
+ * \brief   每个场景一个子进程, 微内核的全局状态互不影响
+ */
+static void run_case(const char *name, void (*fn)(void))
+{
+    pid_t pid = fork();
+    int status = 0;
+    uint64_t start = test_now_ns();
+
+    if (0 == pid)
+    {
+        fn();
+        _exit(test_failures > 0 ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    TEST_CHECK_MSG(WIFEXITED(status) && 0 == WEXITSTATUS(status), "case %s failed, status 0x%x", name, status);
+    printf("%s: %s, %.1f s\n", name, WIFEXITED(status) && 0 == WEXITSTATUS(status) ? "ok" : "FAILED", (test_now_ns() - start) / 1e9);
+}
+
+int main(void)
+{
+    run_case("cbc_roundtrip", case_cbc_roundtrip);
+    run_case("gcm_roundtrip", case_gcm_roundtrip);
+    run_case("gcm_reconnect_salts", case_gcm_reconnect_salts);
+    run_case("gcm_replay", case_gcm_replay);
+    return test_report("test_das_gcm");
+}
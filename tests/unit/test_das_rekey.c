@@ -0,0 +1,399 @@
+/**
+ * \file      test_das_rekey.c
+ * \brief     不断线更换会话密钥对着DAS替身和LBS替身的端到端测试
+ *
+ * 每个场景在子进程里启动一次微内核, 快速上线连到standin_das, 会话密钥有效期2秒, 1.5秒时向standin_lbs取新密钥:
+ * - CBC和GCM下换密钥不断线, 上行改用新密钥; 平台切换之前用旧密钥发的下行在宽限期内照常收到
+ * - LBS很慢时交互在后台进行, 期间上下行消息照常往返, 不等交互结束
+ * - CBC下旧密钥的报文碰巧能用新密钥通过补齐检查时, 按通用协议体解析失败改用旧密钥, 不会交给应用错误的明文
+ * - 解不开的下行报文(伪造、乱码)不会触发额外的LBS交互
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "mbedtls/aes.h"
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel_struct.h"
+#include "test_util.h"
+#include "standin_das.h"
+#include "standin_lbs.h"
+#include "standin_kernel.h"
+
+#define WAIT_MS             5000
+#define ROTATE_WAIT_MS      10000
+#define KEY_LIFETIME        2           ///<    秒, 用到3/4即1.5秒时更换
+#define SLOW_LBS_MS         3000
+#define SLOW_ROUNDTRIP_MS   1000        ///<    LBS交互期间一次上下行往返的上限, 远小于SLOW_LBS_MS
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+static const unsigned char g_master_key[16] = {'f', 'e', 'd', 'c', 'b', 'a', '9', '8', '7', '6', '5', '4', '3', '2', '1', '0'};
+
+static standin_das *g_das = NULL;
+static standin_lbs *g_lbs = NULL;
+
+/**
+ * \brief   启动两个替身和微内核, LBS下发的新密钥有效期为lbs_lifetime
+ */
+static int boot(int cipher, unsigned int key_lifetime, unsigned int lbs_lifetime, int lbs_delay_ms)
+{
+    standin_kernel_config config;
+
+    g_das = standin_das_start(cipher, g_key);
+    if (NULL == g_das)
+    {
+        return -1;
+    }
+    g_lbs = standin_lbs_start(g_master_key, standin_das_port(g_das), cipher, lbs_lifetime);
+    if (NULL == g_lbs)
+    {
+        standin_das_stop(g_das);
+        return -1;
+    }
+    standin_lbs_set_delay(g_lbs, lbs_delay_ms);
+
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(g_das);
+    config.cipher = cipher;
+    config.key_lifetime = key_lifetime;
+    config.lbs_port = standin_lbs_port(g_lbs);
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(g_das, 1, WAIT_MS))
+    {
+        standin_lbs_stop(g_lbs);
+        standin_das_stop(g_das);
+        return -1;
+    }
+    return 0;
+}
+
+static void shutdown_all(void)
+{
+    standin_kernel_stop();
+    standin_lbs_stop(g_lbs);
+    standin_das_stop(g_das);
+}
+
+static int pop_uplink(const char *method, standin_msg *msg)
+{
+    char want[128];
+
+    snprintf(want, sizeof(want), "/" STANDIN_KERNEL_MODULE "/%s/", method);
+    while (0 == standin_das_pop(g_das, msg, WAIT_MS))
+    {
+        if (NULL != strstr(msg->topic, want))
+        {
+            return 0;
+        }
+        standin_msg_free(msg);
+    }
+    return -1;
+}
+
+static int expect_downlink(const char *body)
+{
+    standin_kernel_msg in;
+    int ok = 0;
+
+    if (0 != standin_kernel_pop(&in, WAIT_MS))
+    {
+        return 0;
+    }
+    ok = in.body_len == strlen(body) && 0 == memcmp(in.body, body, in.body_len);
+    if (!ok)
+    {
+        fprintf(stderr, "unexpected downlink: %s, want %s\n", (const char *)in.body, body);
+    }
+    standin_kernel_msg_free(&in);
+    return ok;
+}
+
+/**
+ * \brief   发一条上行, 返回解开它的是不是旧密钥, 收不到返回-1
+ */
+static int uplink_prev_key(const char *body)
+{
+    standin_msg msg;
+    int prev_key = -1;
+
+    if (0 != standin_kernel_send("event", "report", body, strlen(body), 1) || 0 != pop_uplink("event", &msg))
+    {
+        return -1;
+    }
+    if (msg.body_len == strlen(body) && 0 == memcmp(msg.body, body, msg.body_len))
+    {
+        prev_key = msg.prev_key;
+    }
+    standin_msg_free(&msg);
+    return prev_key;
+}
+
+/**
+ * \brief   换一次密钥: 平台切换前后的下行都收到, 上行改用新密钥, 连接不断
+ */
+static void check_rekey(int cipher)
+{
+    standin_lbs_stats lbs_stats;
+    standin_das_stats das_stats;
+    unsigned char garbage[64];
+    char topic[256];
+    size_t i = 0;
+
+    TEST_CHECK(0 == boot(cipher, KEY_LIFETIME, 3600, 0));
+    if (NULL == g_das)
+    {
+        return;
+    }
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+
+    TEST_CHECK(0 == uplink_prev_key("{\"before\":1}"));
+    TEST_CHECK(0 == standin_das_publish(g_das, topic, "{\"Seq\":1}", "before", 6));
+    TEST_CHECK(expect_downlink("before"));
+
+    TEST_CHECK(0 == standin_kernel_wait_event(sdk_kernel_event_sessionkey_rotated, 1, ROTATE_WAIT_MS));
+    standin_lbs_get_stats(g_lbs, &lbs_stats);
+    TEST_CHECK(1 == lbs_stats.exchanges);
+
+    /* 平台还没切换, 仍用旧密钥下发 */
+    TEST_CHECK(0 == standin_das_publish(g_das, topic, "{\"Seq\":2}", "old key", 7));
+    TEST_CHECK(expect_downlink("old key"));
+
+    /* 宽限期内的乱码不影响两个密钥 */
+    for (i = 0; i < sizeof(garbage); i++)
+    {
+        garbage[i] = (unsigned char)(i * 37 + 11);
+    }
+    TEST_CHECK(0 == standin_das_publish_raw(g_das, topic, garbage, sizeof(garbage)));
+    TEST_CHECK(0 == standin_das_publish_raw(g_das, topic, garbage, 47));
+
+    /* 平台切换到新密钥, 旧密钥留着解切换前发出的上行 */
+    standin_das_set_key(g_das, lbs_stats.last_key, 1);
+    TEST_CHECK(0 == uplink_prev_key("{\"after\":1}"));
+    TEST_CHECK(0 == standin_das_publish(g_das, topic, "{\"Seq\":3}", "new key", 7));
+    TEST_CHECK(expect_downlink("new key"));
+
+    standin_das_get_stats(g_das, &das_stats);
+    TEST_CHECK_MSG(1 == das_stats.connects, "connects %d", das_stats.connects);
+    TEST_CHECK(0 == das_stats.decrypt_errors);
+    TEST_CHECK(0 == das_stats.nonce_reuse);
+    standin_lbs_get_stats(g_lbs, &lbs_stats);
+    TEST_CHECK_MSG(1 == lbs_stats.exchanges && 0 == lbs_stats.failures, "exchanges %d failures %d", lbs_stats.exchanges, lbs_stats.failures);
+    TEST_CHECK(1 == standin_kernel_events(sdk_kernel_event_sessionkey_rotated));
+    shutdown_all();
+}
+
+static void case_cbc_rekey(void)
+{
+    check_rekey(STANDIN_CIPHER_CBC);
+}
+
+static void case_gcm_rekey(void)
+{
+    check_rekey(STANDIN_CIPHER_GCM);
+}
+
+/**
+ * \brief   LBS回应很慢时, 交互期间消息照常往返, 微内核线程不被交互占住
+ */
+static void case_slow_lbs(void)
+{
+    standin_lbs_stats lbs_stats;
+    char topic[256];
+    char body[64];
+    uint64_t start = 0;
+    uint64_t worst_ms = 0;
+    uint64_t elapsed_ms = 0;
+    int rounds = 0;
+    int prev_key = 0;
+
+    TEST_CHECK(0 == boot(STANDIN_CIPHER_GCM, KEY_LIFETIME, 3600, SLOW_LBS_MS));
+    if (NULL == g_das)
+    {
+        return;
+    }
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    TEST_CHECK(0 == standin_lbs_wait_connects(g_lbs, 1, ROTATE_WAIT_MS));
+
+    for (;;)
+    {
+        standin_lbs_get_stats(g_lbs, &lbs_stats);
+        if (!lbs_stats.active || lbs_stats.exchanges > 0 || test_failures > 0)
+        {
+            break;
+        }
+        start = test_now_ns();
+        snprintf(body, sizeof(body), "{\"during\":%d}", rounds);
+        prev_key = uplink_prev_key(body);
+        if (standin_kernel_events(sdk_kernel_event_sessionkey_rotated) > 0)
+        {
+            /* 交互恰好在这一轮结束, 上行可能已经换成替身还不认识的新密钥 */
+            break;
+        }
+        TEST_CHECK(0 == prev_key);
+        TEST_CHECK(0 == standin_das_publish(g_das, topic, "{\"Seq\":1}", body, strlen(body)));
+        TEST_CHECK(expect_downlink(body));
+        elapsed_ms = (test_now_ns() - start) / 1000000;
+        worst_ms = elapsed_ms > worst_ms ? elapsed_ms : worst_ms;
+        rounds++;
+        usleep(100 * 1000);
+    }
+
+    TEST_CHECK_MSG(rounds >= 5, "only %d round trips during the exchange", rounds);
+    TEST_CHECK_MSG(worst_ms < SLOW_ROUNDTRIP_MS, "worst round trip %llu ms during the exchange", (unsigned long long)worst_ms);
+    TEST_CHECK(0 == standin_kernel_wait_event(sdk_kernel_event_sessionkey_rotated, 1, ROTATE_WAIT_MS));
+    printf("slow lbs: %d round trips while the exchange ran, worst %llu ms\n", rounds, (unsigned long long)worst_ms);
+    shutdown_all();
+}
+
+static void cbc_encrypt(const unsigned char key[16], const unsigned char *in, size_t len, unsigned char *out)
+{
+    bscomptls_aes_context aes;
+    unsigned char iv[16] = {0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37};
+
+    bscomptls_aes_init(&aes);
+    bscomptls_aes_setkey_enc(&aes, key, 128);
+    bscomptls_aes_crypt_cbc(&aes, BSCOMPTLS_AES_ENCRYPT, len, iv, in, out);
+    bscomptls_aes_free(&aes);
+}
+
+static void cbc_decrypt(const unsigned char key[16], const unsigned char *in, size_t len, unsigned char *out)
+{
+    bscomptls_aes_context aes;
+    unsigned char iv[16] = {0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37};
+
+    bscomptls_aes_init(&aes);
+    bscomptls_aes_setkey_dec(&aes, key, 128);
+    bscomptls_aes_crypt_cbc(&aes, BSCOMPTLS_AES_DECRYPT, len, iv, in, out);
+    bscomptls_aes_free(&aes);
+}
+
+/**
+ * \brief   找一个旧密钥下的报文, 用新密钥解出来能通过补齐检查, 通用协议体长度也在范围内, 只有解析JSON才能发现不对
+ */
+static size_t forge_padding_collision(const unsigned char *old_key, const unsigned char *new_key, unsigned char *cipher, char *body, size_t body_max)
+{
+    char common[32];
+    unsigned char plain[128];
+    unsigned char check[128];
+    size_t common_len = 0;
+    size_t len = 0;
+    size_t padded = 0;
+    int n = 0;
+
+    /* 序号放在第一个分组里, 每次尝试新密钥解出的通用协议体长度都不同 */
+    snprintf(body, body_max, "collide");
+    for (n = 0; n < 20000000; n++)
+    {
+        common_len = (size_t)snprintf(common, sizeof(common), "{\"Seq\":%d}", n);
+        len = 2 + common_len + strlen(body);
+        padded = (len / 16 + 1) * 16;
+        plain[0] = 0;
+        plain[1] = (unsigned char)common_len;
+        memcpy(plain + 2, common, common_len);
+        memcpy(plain + 2 + common_len, body, strlen(body));
+        memset(plain + len, (int)(padded - len), padded - len);
+        cbc_encrypt(old_key, plain, padded, cipher);
+        cbc_decrypt(new_key, cipher, padded, check);
+        if (1 == check[padded - 1] && 0 == check[0] && (size_t)check[1] + 3 < padded)
+        {
+            return padded;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief   CBC下旧密钥的报文被新密钥碰巧解出合法补齐, 通用协议体不是JSON, 改用旧密钥解开
+ */
+static void case_cbc_padding_collision(void)
+{
+    standin_lbs_stats lbs_stats;
+    unsigned char cipher[128];
+    char body[64];
+    char topic[256];
+    size_t len = 0;
+
+    TEST_CHECK(0 == boot(STANDIN_CIPHER_CBC, KEY_LIFETIME, 3600, 0));
+    if (NULL == g_das)
+    {
+        return;
+    }
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    TEST_CHECK(0 == standin_kernel_wait_event(sdk_kernel_event_sessionkey_rotated, 1, ROTATE_WAIT_MS));
+    standin_lbs_get_stats(g_lbs, &lbs_stats);
+
+    len = forge_padding_collision(g_key, lbs_stats.last_key, cipher, body, sizeof(body));
+    TEST_CHECK(len > 0);
+    TEST_CHECK(0 == standin_das_publish_raw(g_das, topic, cipher, len));
+    TEST_CHECK(expect_downlink(body));
+    shutdown_all();
+}
+
+/**
+ * \brief   密钥有效期内解不开的下行报文只是丢掉, 不去LBS取密钥
+ */
+static void case_forged_no_exchange(void)
+{
+    standin_lbs_stats lbs_stats;
+    standin_das_stats das_stats;
+    unsigned char forged[512];
+    char topic[256];
+    size_t len = 0;
+    int i = 0;
+
+    TEST_CHECK(0 == boot(STANDIN_CIPHER_CBC, 3600, 3600, 0));
+    if (NULL == g_das)
+    {
+        return;
+    }
+    standin_kernel_down_topic(topic, sizeof(topic), "service", "set");
+    TEST_CHECK(0 == standin_das_publish(g_das, topic, "{\"Seq\":1}", "genuine", 7));
+    TEST_CHECK(expect_downlink("genuine"));
+    len = standin_das_last_downlink(g_das, forged, sizeof(forged));
+
+    for (i = 0; i < 50; i++)
+    {
+        forged[(size_t)i % len] ^= 0x5A;
+        TEST_CHECK(0 == standin_das_publish_raw(g_das, topic, forged, len));
+    }
+    TEST_CHECK(0 == standin_das_publish(g_das, topic, "{\"Seq\":2}", "still here", 10));
+    TEST_CHECK(expect_downlink("still here"));
+
+    sleep(2);
+    standin_lbs_get_stats(g_lbs, &lbs_stats);
+    standin_das_get_stats(g_das, &das_stats);
+    TEST_CHECK_MSG(0 == lbs_stats.connects, "lbs connects %d", lbs_stats.connects);
+    TEST_CHECK(1 == das_stats.connects);
+    TEST_CHECK(0 == standin_kernel_events(sdk_kernel_event_sessionkey_rotated));
+    shutdown_all();
+}
+
+/**
+ * \brief   每个场景一个子进程, 微内核的全局状态互不影响
+ */
+static void run_case(const char *name, void (*fn)(void))
+{
+    pid_t pid = fork();
+    int status = 0;
+    uint64_t start = test_now_ns();
+
+    if (0 == pid)
+    {
+        fn();
+        _exit(test_failures > 0 ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    TEST_CHECK_MSG(WIFEXITED(status) && 0 == WEXITSTATUS(status), "case %s failed, status 0x%x", name, status);
+    printf("%s: %s, %.1f s\n", name, WIFEXITED(status) && 0 == WEXITSTATUS(status) ? "ok" : "FAILED", (test_now_ns() - start) / 1e9);
+}
+
+int main(void)
+{
+    run_case("cbc_rekey", case_cbc_rekey);
+    run_case("gcm_rekey", case_gcm_rekey);
+    run_case("slow_lbs", case_slow_lbs);
+    run_case("cbc_padding_collision", case_cbc_padding_collision);
+    run_case("forged_no_exchange", case_forged_no_exchange);
+    return test_report("test_das_rekey");
+}
@@ -0,0 +1,554 @@
+/**
+ * \file      test_frag.c
+ * \brief     v3消息分片对着替身服务端的测试: 下行重组(das_frag_assemble)和流式分片发送(das_send_pubmsg_frag_v3)
+ *
+ * 每个场景在子进程里启动一次微内核, 快速上线连到standin_das(CBC, 重发的QoS1报文能原样解开).
+ * 下行分片用standin_das_publish在通用协议体里带FragId/FragOff/FragTotal发送, 检查:
+ * - 按顺序到达的分片拼成整条消息, seq取第一个分片的; 两条消息交错重组互不影响
+ * - 原样重发的QoS1分片被忽略, 收齐以后再重发的分片也不会多出一条消息
+ * - offset为0的分片从头开始, 之前收到的内容作废
+ * - 跳过数据的分片丢弃整条消息, 之后的分片也丢弃
+ * - FragTotal超过ezdev_sdk_das_frag_recv_max、FragOff不小于FragTotal、业务数据超出FragTotal的分片不收;
+ *   重组缓冲区合计超过ezdev_sdk_das_frag_recv_max或槽位用完时新消息不收, 已在重组的照常收齐
+ * - 超过ezdev_sdk_das_frag_timeout_ms没收齐的消息被丢弃
+ * 上行流式发送暂停微内核线程后在测试线程里直接调das_send_pubmsg_v3, 检查分片内容和body_read读不满时
+ * 以mkernel_internal_value_load_err结束. 这里直接包含das_transport.c, 用来查看和调整重组槽位.
+ */
+#include "das_transport.c"
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test_util.h"
+#include "standin_das.h"
+#include "standin_kernel.h"
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define WAIT_MS         5000
+#define QUIET_MS        300
+#define CHUNK           4096
+#define PAYLOAD_MAX     (ezdev_sdk_das_frag_recv_max + CHUNK)
+#define STREAM_FRAG     1000
+
+static const unsigned char g_key[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+
+static unsigned char g_payload[PAYLOAD_MAX];
+static char g_topic[256];
+static int g_sync;
+
+static standin_das *boot(void)
+{
+    standin_kernel_config config;
+    standin_das *das = standin_das_start(STANDIN_CIPHER_CBC, g_key);
+    size_t i = 0;
+
+    if (NULL == das)
+    {
+        return NULL;
+    }
+    test_rand_seed(48);
+    for (i = 0; i < sizeof(g_payload); i++)
+    {
+        g_payload[i] = (unsigned char)test_rand_below(256);
+    }
+    standin_kernel_down_topic(g_topic, sizeof(g_topic), "service", "set");
+
+    memset(&config, 0, sizeof(config));
+    config.das_port = standin_das_port(das);
+    config.cipher = STANDIN_CIPHER_CBC;
+    memcpy(config.session_key, g_key, sizeof(g_key));
+    if (0 != standin_kernel_start(&config) || 0 != standin_das_wait_connects(das, 1, WAIT_MS))
+    {
+        standin_das_stop(das);
+        return NULL;
+    }
+    return das;
+}
+
+static void shutdown_all(standin_das *das)
+{
+    standin_kernel_stop();
+    standin_das_stop(das);
+}
+
+/**
+ * \brief   下发一个分片, 业务数据取g_payload里id对应的一段; Seq取id加offset, 收齐后的seq应该是id
+ */
+static int send_frag_body(standin_das *das, unsigned int id, unsigned int offset, unsigned int total, const unsigned char *body, size_t len)
+{
+    char common[160];
+
+    snprintf(common, sizeof(common), "{\"Seq\":%u,\"FragId\":%u,\"FragOff\":%u,\"FragTotal\":%u}", id + offset, id, offset, total);
+    return standin_das_publish(das, g_topic, common, body, len);
+}
+
+static const unsigned char *payload_of(unsigned int id)
+{
+    return g_payload + id % 64;
+}
+
+static int send_frag(standin_das *das, unsigned int id, unsigned int offset, unsigned int total)
+{
+    unsigned int len = total - offset < CHUNK ? total - offset : CHUNK;
+
+    return send_frag_body(das, id, offset, total, payload_of(id) + offset, len);
+}
+
+/**
+ * \brief   从offset开始把剩下的分片按顺序发完
+ */
+static void send_rest(standin_das *das, unsigned int id, unsigned int offset, unsigned int total)
+{
+    for (; offset < total; offset += CHUNK)
+    {
+        TEST_CHECK(0 == send_frag(das, id, offset, total));
+    }
+}
+
+/**
+ * \brief   下一条收到的消息是id对应的整条消息
+ */
+static int expect_message(unsigned int id, unsigned int total)
+{
+    standin_kernel_msg in;
+    int ok = 0;
+
+    if (0 != standin_kernel_pop(&in, WAIT_MS))
+    {
+        fprintf(stderr, "message %u not delivered\n", id);
+        return 0;
+    }
+    ok = in.seq == id && in.body_len == total && 0 == memcmp(in.body, payload_of(id), total);
+    if (!ok)
+    {
+        fprintf(stderr, "unexpected message seq %u len %u, want %u len %u\n", in.seq, (unsigned int)in.body_len, id, total);
+    }
+    standin_kernel_msg_free(&in);
+    return ok;
+}
+
+/**
+ * \brief   发一条不分片的消息并等它到达; 下行报文按顺序处理, 它之前的分片都已经处理完, 中间不能有别的消息
+ */
+static int expect_nothing(standin_das *das)
+{
+    standin_kernel_msg in;
+    char common[32];
+    char body[32];
+    int ok = 0;
+
+    snprintf(common, sizeof(common), "{\"Seq\":%d}", 900000 + ++g_sync);
+    snprintf(body, sizeof(body), "{\"sync\":%d}", g_sync);
+    if (0 != standin_das_publish(das, g_topic, common, body, strlen(body)) || 0 != standin_kernel_pop(&in, WAIT_MS))
+    {
+        return 0;
+    }
+    ok = in.body_len == strlen(body) && 0 == memcmp(in.body, body, in.body_len);
+    if (!ok)
+    {
+        fprintf(stderr, "unexpected message seq %u len %u before sync %d\n", in.seq, (unsigned int)in.body_len, g_sync);
+    }
+    standin_kernel_msg_free(&in);
+    return ok;
+}
+
+/**
+ * \brief   暂停微内核线程后查看重组槽位: 正在重组的消息数和合计占用
+ */
+static void check_slots(int busy, EZDEV_SDK_UINT32 mem)
+{
+    int in_use = 0;
+    int i = 0;
+
+    standin_kernel_pause();
+    for (i = 0; i < ezdev_sdk_das_frag_slots; i++)
+    {
+        in_use += NULL != g_das_frag[i].buf;
+    }
+    TEST_CHECK_MSG(in_use == busy, "%d slots in use, want %d", in_use, busy);
+    TEST_CHECK_MSG(g_das_frag_mem == mem, "%u bytes in use, want %u", g_das_frag_mem, mem);
+    standin_kernel_resume();
+}
+
+static void case_in_order(void)
+{
+    standin_das *das = boot();
+    unsigned int offset = 0;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    send_rest(das, 1, 0, 10000);
+    TEST_CHECK(expect_message(1, 10000));
+
+    /* 正好一个分片、最后一片只有1字节 */
+    send_rest(das, 2, 0, CHUNK);
+    TEST_CHECK(expect_message(2, CHUNK));
+    send_rest(das, 3, 0, 2 * CHUNK + 1);
+    TEST_CHECK(expect_message(3, 2 * CHUNK + 1));
+
+    /* 两条消息的分片交错到达 */
+    for (offset = 0; offset < 3 * CHUNK; offset += CHUNK)
+    {
+        TEST_CHECK(0 == send_frag(das, 4, offset, 3 * CHUNK));
+        TEST_CHECK(0 == send_frag(das, 5, offset, 3 * CHUNK - 100));
+    }
+    TEST_CHECK(expect_message(4, 3 * CHUNK));
+    TEST_CHECK(expect_message(5, 3 * CHUNK - 100));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+    shutdown_all(das);
+}
+
+static void case_duplicate(void)
+{
+    standin_das *das = boot();
+    unsigned char dup[CHUNK + 512];
+    size_t dup_len = 0;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    /* 第二片原样重发两次, 中间插一条不分片的消息 */
+    TEST_CHECK(0 == send_frag(das, 6, 0, 10000));
+    TEST_CHECK(0 == send_frag(das, 6, CHUNK, 10000));
+    dup_len = standin_das_last_downlink(das, dup, sizeof(dup));
+    TEST_CHECK(0 == standin_das_publish_raw(das, g_topic, dup, dup_len));
+    TEST_CHECK(expect_nothing(das));
+    TEST_CHECK(0 == standin_das_publish_raw(das, g_topic, dup, dup_len));
+    check_slots(1, 10000);
+    send_rest(das, 6, 2 * CHUNK, 10000);
+    TEST_CHECK(expect_message(6, 10000));
+
+    /* 收齐以后最后一片再来一次, 槽位已经释放, 不会多出一条消息 */
+    dup_len = standin_das_last_downlink(das, dup, sizeof(dup));
+    TEST_CHECK(0 == standin_das_publish_raw(das, g_topic, dup, dup_len));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+    shutdown_all(das);
+}
+
+static void case_restart(void)
+{
+    standin_das *das = boot();
+    unsigned int offset = 0;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    /* 先收两片别的内容, 对端从头重发后按新内容拼 */
+    for (offset = 0; offset < 2 * CHUNK; offset += CHUNK)
+    {
+        TEST_CHECK(0 == send_frag_body(das, 7, offset, 10000, g_payload + 1000 + offset, CHUNK));
+    }
+    send_rest(das, 7, 0, 10000);
+    TEST_CHECK(expect_message(7, 10000));
+
+    /* 重发时总长变了也按新的算 */
+    TEST_CHECK(0 == send_frag(das, 8, 0, 3 * CHUNK));
+    send_rest(das, 8, 0, 2 * CHUNK);
+    TEST_CHECK(expect_message(8, 2 * CHUNK));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+    shutdown_all(das);
+}
+
+static void case_gap(void)
+{
+    standin_das *das = boot();
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    TEST_CHECK(0 == send_frag(das, 9, 0, 10000));
+    TEST_CHECK(0 == send_frag(das, 9, 2 * CHUNK, 10000));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+
+    /* 缺的那片补上也没用, 整条已经丢了 */
+    TEST_CHECK(0 == send_frag(das, 9, CHUNK, 10000));
+    TEST_CHECK(0 == send_frag(das, 9, 2 * CHUNK, 10000));
+    /* 没有第一片的分片 */
+    TEST_CHECK(0 == send_frag(das, 10, CHUNK, 10000));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+
+    /* 对端从头重发就能收到 */
+    send_rest(das, 9, 0, 10000);
+    TEST_CHECK(expect_message(9, 10000));
+    shutdown_all(das);
+}
+
+static void case_cap(void)
+{
+    standin_das *das = boot();
+    const unsigned int big = ezdev_sdk_das_frag_recv_max - 1000;
+    unsigned int offset = 0;
+    char common[160];
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    /* FragTotal超过上限, FragOff不小于FragTotal, 业务数据超出FragTotal */
+    TEST_CHECK(0 == send_frag_body(das, 11, 0, ezdev_sdk_das_frag_recv_max + 1, g_payload, CHUNK));
+    TEST_CHECK(0 == send_frag_body(das, 12, 100, 100, g_payload, 10));
+    TEST_CHECK(0 == send_frag_body(das, 13, 0, 100, g_payload, 101));
+    snprintf(common, sizeof(common), "{\"Seq\":14,\"FragId\":14,\"FragOff\":0,\"FragTotal\":0}");
+    TEST_CHECK(0 == standin_das_publish(das, g_topic, common, g_payload, 10));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+
+    /* 正在重组的消息收到超出FragTotal的分片时这一片不收, 后面的正常分片照常拼 */
+    TEST_CHECK(0 == send_frag(das, 15, 0, CHUNK + 100));
+    TEST_CHECK(0 == send_frag_body(das, 15, CHUNK, CHUNK + 100, payload_of(15) + CHUNK, 101));
+    TEST_CHECK(expect_nothing(das));
+    TEST_CHECK(0 == send_frag(das, 15, CHUNK, CHUNK + 100));
+    TEST_CHECK(expect_message(15, CHUNK + 100));
+
+    /* 正好到上限的消息能收 */
+    send_rest(das, 16, 0, ezdev_sdk_das_frag_recv_max);
+    TEST_CHECK(expect_message(16, ezdev_sdk_das_frag_recv_max));
+
+    /* 合计占用超过上限: 后来的消息不收, 已经在重组的收齐; 释放后重发能收 */
+    TEST_CHECK(0 == send_frag(das, 17, 0, big));
+    TEST_CHECK(0 == send_frag(das, 18, 0, 2000));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(1, big);
+    send_rest(das, 17, CHUNK, big);
+    TEST_CHECK(expect_message(17, big));
+    send_rest(das, 18, 0, 2000);
+    TEST_CHECK(expect_message(18, 2000));
+
+    /* 槽位用完: 第三条同时重组的消息不收 */
+    TEST_CHECK(0 == send_frag(das, 19, 0, 2 * CHUNK));
+    TEST_CHECK(0 == send_frag(das, 20, 0, 2 * CHUNK));
+    TEST_CHECK(0 == send_frag(das, 21, 0, 2 * CHUNK));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(ezdev_sdk_das_frag_slots, ezdev_sdk_das_frag_slots * 2 * CHUNK);
+    for (offset = CHUNK; offset < 2 * CHUNK; offset += CHUNK)
+    {
+        TEST_CHECK(0 == send_frag(das, 19, offset, 2 * CHUNK));
+        TEST_CHECK(0 == send_frag(das, 20, offset, 2 * CHUNK));
+        TEST_CHECK(0 == send_frag(das, 21, offset, 2 * CHUNK));
+    }
+    TEST_CHECK(expect_message(19, 2 * CHUNK));
+    TEST_CHECK(expect_message(20, 2 * CHUNK));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+    shutdown_all(das);
+}
+
+static void case_timeout(void)
+{
+    standin_das *das = boot();
+    int i = 0;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    TEST_CHECK(0 == send_frag(das, 22, 0, 10000));
+    TEST_CHECK(0 == send_frag(das, 23, 0, 10000));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(2, 20000);
+
+    /* 把22收到第一片的时刻往前拨到超时, 23不动 */
+    standin_kernel_pause();
+    for (i = 0; i < ezdev_sdk_das_frag_slots; i++)
+    {
+        if (NULL != g_das_frag[i].buf && 22 == g_das_frag[i].id)
+        {
+            g_das_frag[i].timer.expires -= ezdev_sdk_das_frag_timeout_ms;
+        }
+    }
+    standin_kernel_resume();
+
+    send_rest(das, 22, CHUNK, 10000);
+    send_rest(das, 23, CHUNK, 10000);
+    TEST_CHECK(expect_message(23, 10000));
+    TEST_CHECK(expect_nothing(das));
+    check_slots(0, 0);
+
+    send_rest(das, 22, 0, 10000);
+    TEST_CHECK(expect_message(22, 10000));
+    shutdown_all(das);
+}
+
+typedef struct
+{
+    EZDEV_SDK_UINT32 short_at;      ///<    从这个偏移开始读不满, 0xFFFFFFFF不出错
+    int fail;                       ///<    读不满时返回-1而不是少读一个字节
+    int reads;
+} stream_source;
+
+static EZDEV_SDK_INT32 stream_read(unsigned char *buf, EZDEV_SDK_UINT32 offset, EZDEV_SDK_UINT32 len, EZDEV_SDK_PTR user)
+{
+    stream_source *source = (stream_source *)user;
+
+    source->reads++;
+    if (offset >= source->short_at)
+    {
+        if (source->fail)
+        {
+            return -1;
+        }
+        len--;
+    }
+    memcpy(buf, g_payload + offset, len);
+    return (EZDEV_SDK_INT32)len;
+}
+
+static mkernel_internal_error send_stream(EZDEV_SDK_UINT32 total, stream_source *source)
+{
+    ezdev_sdk_kernel_pubmsg_v3 pubmsg;
+
+    memset(&pubmsg, 0, sizeof(pubmsg));
+    pubmsg.msg_qos = QOS_T1;
+    pubmsg.msg_seq = 77;
+    pubmsg.msg_body_len = total;
+    pubmsg.body_read = stream_read;
+    pubmsg.body_user = source;
+    snprintf(pubmsg.resource_id, sizeof(pubmsg.resource_id), "0");
+    snprintf(pubmsg.resource_type, sizeof(pubmsg.resource_type), "global");
+    snprintf(pubmsg.module, sizeof(pubmsg.module), STANDIN_KERNEL_MODULE);
+    snprintf(pubmsg.method, sizeof(pubmsg.method), "upload");
+    snprintf(pubmsg.msg_type, sizeof(pubmsg.msg_type), "report");
+    return das_send_pubmsg_v3(&g_ezdev_sdk_kernel, &pubmsg);
+}
+
+static unsigned long common_number(const standin_msg *msg, const char *key)
+{
+    char want[32];
+    const char *at = NULL;
+
+    snprintf(want, sizeof(want), "\"%s\":", key);
+    at = strstr(msg->common, want);
+    return NULL != at ? strtoul(at + strlen(want), NULL, 10) : 0xFFFFFFFFUL;
+}
+
+/**
+ * \brief   替身上按顺序收到的分片, 返回个数; 每片检查通用协议体和内容
+ */
+static int pop_stream(standin_das *das, EZDEV_SDK_UINT32 total)
+{
+    standin_msg msg;
+    EZDEV_SDK_UINT32 offset = 0;
+    EZDEV_SDK_UINT32 len = 0;
+    int count = 0;
+
+    while (0 == standin_das_pop(das, &msg, QUIET_MS))
+    {
+        if (NULL == strstr(msg.topic, "/" STANDIN_KERNEL_MODULE "/upload/"))
+        {
+            standin_msg_free(&msg);
+            continue;
+        }
+        len = total - offset < STREAM_FRAG ? total - offset : STREAM_FRAG;
+        TEST_CHECK_MSG(77 == common_number(&msg, "Seq") && 77 == common_number(&msg, "FragId") && offset == common_number(&msg, "FragOff") &&
+                           total == common_number(&msg, "FragTotal"),
+                       "fragment %d common %s", count, msg.common);
+        TEST_CHECK_MSG(msg.body_len == len && 0 == memcmp(msg.body, g_payload + offset, len), "fragment %d body length %u", count,
+                       (unsigned int)msg.body_len);
+        offset += len;
+        count++;
+        standin_msg_free(&msg);
+    }
+    return count;
+}
+
+static void case_stream(void)
+{
+    standin_das *das = boot();
+    stream_source source;
+
+    TEST_CHECK(NULL != das);
+    if (NULL == das)
+    {
+        return;
+    }
+
+    /* 微内核线程停下来, 测试线程代替它发 */
+    standin_kernel_pause();
+
+    /* 平台不支持分片时流式消息发不出去 */
+    memset(&source, 0, sizeof(source));
+    source.short_at = 0xFFFFFFFF;
+    g_ezdev_sdk_kernel.redirect_das_info.das_frag_size = 0;
+    TEST_CHECK(mkernel_internal_msg_len_overrange == send_stream(3500, &source));
+    TEST_CHECK(0 == source.reads);
+
+    g_ezdev_sdk_kernel.redirect_das_info.das_frag_size = STREAM_FRAG;
+    TEST_CHECK(mkernel_internal_succ == send_stream(3500, &source));
+    TEST_CHECK(4 == source.reads);
+    TEST_CHECK(4 == pop_stream(das, 3500));
+
+    /* 第三片读不满: 前两片已经发出, 不再往下读 */
+    memset(&source, 0, sizeof(source));
+    source.short_at = 2 * STREAM_FRAG;
+    TEST_CHECK(mkernel_internal_value_load_err == send_stream(3500, &source));
+    TEST_CHECK(3 == source.reads);
+    TEST_CHECK(2 == pop_stream(das, 3500));
+
+    /* 最后一片只差一个字节 */
+    memset(&source, 0, sizeof(source));
+    source.short_at = 3 * STREAM_FRAG;
+    TEST_CHECK(mkernel_internal_value_load_err == send_stream(3500, &source));
+    TEST_CHECK(3 == pop_stream(das, 3500));
+
+    /* 第一片就读失败, 什么也不发 */
+    memset(&source, 0, sizeof(source));
+    source.fail = 1;
+    TEST_CHECK(mkernel_internal_value_load_err == send_stream(3500, &source));
+    TEST_CHECK(1 == source.reads);
+    TEST_CHECK(0 == pop_stream(das, 3500));
+
+    standin_kernel_resume();
+    shutdown_all(das);
+}
+
+/**
+ * \brief   每个场景一个子进程, 微内核的全局状态互不影响
+ */
+static void run_case(const char *name, void (*fn)(void))
+{
+    pid_t pid = fork();
+    int status = 0;
+    uint64_t start = test_now_ns();
+
+    if (0 == pid)
+    {
+        fn();
+        _exit(test_failures > 0 ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    TEST_CHECK_MSG(WIFEXITED(status) && 0 == WEXITSTATUS(status), "case %s failed, status 0x%x", name, status);
+    printf("%s: %s, %.1f s\n", name, WIFEXITED(status) && 0 == WEXITSTATUS(status) ? "ok" : "FAILED", (test_now_ns() - start) / 1e9);
+}
+
+int main(void)
+{
+    run_case("in_order", case_in_order);
+    run_case("duplicate", case_duplicate);
+    run_case("restart", case_restart);
+    run_case("gap", case_gap);
+    run_case("cap", case_cap);
+    run_case("timeout", case_timeout);
+    run_case("stream", case_stream);
+    return test_report("test_frag");
+}
@@ -0,0 +1,154 @@
+/**
+ * \file      test_job.c
+ * \brief     微内核后台任务(ezdev_sdk_kernel_job)的测试
+ *
+ * 阻塞的网络交互(备用连接的TCP connect、会话密钥更换的LBS交互)放到后台任务上, 微内核线程只轮询:
+ * - 平台没有提供thread_start时启动失败, 调用者自己处理
+ * - 任务阻塞时kernel_job_start和kernel_job_poll立即返回, 运行中不能再启动; 结束后poll恰好一次返回finished
+ * - 反初始化等到运行中的任务结束
+ * - 连续启动大量任务, 每个恰好执行一次
+ */
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_job.h"
+#include "platform_define.h"
+
+EZDEV_SDK_KERNEL_JOB_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+SEM_PLATFORM_INTERFACE
+THREAD_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define SLOW_TASK_MS    300
+#define QUICK_JOBS      1000
+
+typedef struct
+{
+    int sleep_ms;
+    volatile int runs;
+} job_arg;
+
+static void job_task(void *arg)
+{
+    job_arg *job = (job_arg *)arg;
+
+    if (job->sleep_ms > 0)
+    {
+        sdk_thread_sleep(job->sleep_ms);
+    }
+    job->runs++;
+}
+
+static void case_no_thread(void)
+{
+    kernel_job job;
+    job_arg arg = {0, 0};
+
+    g_ezdev_sdk_kernel.platform_handle.thread_start = NULL;
+    TEST_CHECK(mkernel_internal_succ == kernel_job_init(&job));
+    TEST_CHECK(mkernel_internal_succ != kernel_job_start(&job, job_task, &arg));
+    TEST_CHECK(kernel_job_idle == kernel_job_poll(&job));
+    kernel_job_fini(&job);
+    TEST_CHECK(0 == arg.runs);
+    g_ezdev_sdk_kernel.platform_handle.thread_start = sdk_platform_thread_start;
+}
+
+static void case_non_blocking(void)
+{
+    kernel_job job;
+    job_arg arg = {SLOW_TASK_MS, 0};
+    job_arg other = {0, 0};
+    uint64_t start = 0;
+    uint64_t elapsed_ms = 0;
+    int finished = 0;
+    kernel_job_state state = kernel_job_idle;
+
+    TEST_CHECK(mkernel_internal_succ == kernel_job_init(&job));
+    start = test_now_ns();
+    TEST_CHECK(mkernel_internal_succ == kernel_job_start(&job, job_task, &arg));
+    TEST_CHECK(kernel_job_running == kernel_job_poll(&job));
+    TEST_CHECK(mkernel_internal_succ != kernel_job_start(&job, job_task, &other));
+    elapsed_ms = (test_now_ns() - start) / 1000000;
+    TEST_CHECK_MSG(elapsed_ms < SLOW_TASK_MS / 3, "start and poll took %llu ms", (unsigned long long)elapsed_ms);
+
+    while (0 == finished && (test_now_ns() - start) / 1000000 < SLOW_TASK_MS * 10)
+    {
+        state = kernel_job_poll(&job);
+        finished = (kernel_job_finished == state);
+        if (!finished)
+        {
+            TEST_CHECK(kernel_job_running == state);
+            sdk_thread_sleep(5);
+        }
+    }
+    elapsed_ms = (test_now_ns() - start) / 1000000;
+    TEST_CHECK(finished);
+    TEST_CHECK_MSG(elapsed_ms >= SLOW_TASK_MS, "finished after %llu ms", (unsigned long long)elapsed_ms);
+    TEST_CHECK(1 == arg.runs);
+    TEST_CHECK(kernel_job_idle == kernel_job_poll(&job));
+    TEST_CHECK(0 == other.runs);
+    kernel_job_fini(&job);
+}
+
+static void case_fini_waits(void)
+{
+    kernel_job job;
+    job_arg arg = {SLOW_TASK_MS, 0};
+
+    TEST_CHECK(mkernel_internal_succ == kernel_job_init(&job));
+    TEST_CHECK(mkernel_internal_succ == kernel_job_start(&job, job_task, &arg));
+    kernel_job_fini(&job);
+    TEST_CHECK(1 == arg.runs);
+}
+
+static void case_many(void)
+{
+    kernel_job job;
+    job_arg arg = {0, 0};
+    int started = 0;
+    int finished = 0;
+
+    TEST_CHECK(mkernel_internal_succ == kernel_job_init(&job));
+    while (started < QUICK_JOBS && 0 == test_failures)
+    {
+        if (mkernel_internal_succ == kernel_job_start(&job, job_task, &arg))
+        {
+            started++;
+        }
+        while (kernel_job_finished != kernel_job_poll(&job))
+        {
+            sdk_thread_sleep(0);
+        }
+        finished++;
+        TEST_CHECK(finished == arg.runs);
+    }
+    kernel_job_fini(&job);
+    TEST_CHECK(QUICK_JOBS == arg.runs);
+}
+
+int main(void)
+{
+    ezdev_sdk_kernel_platform_handle *handle = &g_ezdev_sdk_kernel.platform_handle;
+
+    handle->time_sleep = sdk_thread_sleep;
+    handle->thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle->thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle->thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle->thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    handle->thread_sem_create = sdk_platform_thread_sem_create;
+    handle->thread_sem_destroy = sdk_platform_thread_sem_destroy;
+    handle->thread_sem_post = sdk_platform_thread_sem_post;
+    handle->thread_sem_wait = sdk_platform_thread_sem_wait;
+    handle->thread_start = sdk_platform_thread_start;
+
+    case_no_thread();
+    case_non_blocking();
+    case_fini_waits();
+    case_many();
+    return test_report("test_job");
+}
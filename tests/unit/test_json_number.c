@@ -0,0 +1,348 @@
+/**
+ * \file      test_json_number.c
+ * \brief     bscJSON数字的解析和打印, 与libc的strtod/printf比对
+ *
+ * bscJSON不再用strtod和printf, 这里用它们做参照:
+ * - 打印: 结果用strtod读回来必须是同一个double(包括-0), 有效数字必须与最短的"%.*e"(能读回的最小精度)相同,
+ *   即最短且最接近; 规格化数不超过15位时与原来的"%1.15g"逐字节相同(非规格化数精度低, 最短的会比"%1.15g"短)
+ * - 解析: 结果和消耗的长度与strtod相同, 包括19位以上、接近两个double中点、超过800位、上溢和下溢的输入
+ * 取值: 随机位模式(含非规格化数), 随机的短小数, 2和10的每个幂, 两个double的中点附近
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include "bscJSON.h"
+#include "test_util.h"
+
+#define RANDOM_BITS_ROUNDS      200000
+#define SHORT_DECIMAL_ROUNDS    100000
+#define PARSE_RANDOM_ROUNDS     200000
+#define HALFWAY_ROUNDS          20000
+#define TEXT_MAX                2048
+
+static int same_double(double a, double b)
+{
+    return 0 == memcmp(&a, &b, sizeof(a));
+}
+
+static double random_double_bits(void)
+{
+    uint64_t bits = 0;
+    double value = 0;
+
+    do
+    {
+        bits = test_rand();
+        memcpy(&value, &bits, sizeof(value));
+    } while (isnan(value) || isinf(value));
+    return value;
+}
+
+/* 有效数字: 去掉符号、小数点、指数和首尾的0 */
+static void significant_digits(const char *text, char *out)
+{
+    size_t n = 0;
+
+    for (; *text && 'e' != *text && 'E' != *text; text++)
+    {
+        if (*text >= '0' && *text <= '9' && (n > 0 || '0' != *text))
+        {
+            out[n++] = *text;
+        }
+    }
+    while (n > 1 && '0' == out[n - 1])
+    {
+        n--;
+    }
+    if (0 == n)
+    {
+        out[n++] = '0';
+    }
+    out[n] = '\0';
+}
+
+/* 把"%.*e"的末位加减1, 能读回value时写到out */
+static int neighbour_reads_back(double value, const char *text, int precision, int step, char *out)
+{
+    unsigned long long mantissa = 0;
+    const char *p = text;
+    int exponent = 0;
+
+    for (; *p && 'e' != *p; p++)
+    {
+        if (*p >= '0' && *p <= '9')
+        {
+            mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+        }
+    }
+    exponent = atoi(p + 1) - (precision - 1);
+    snprintf(out, 64, "%llue%d", mantissa + (unsigned long long)step, exponent);
+    return same_double(strtod(out, NULL), value);
+}
+
+/* precision位有效数字里能读回value的最接近的一个, 没有时返回0.
+ * 最接近的("%.*e")读不回来时, 另一侧相邻的可能读得回来: 2的幂下边界更近, 区间不对称 */
+static int closest_reading_back(double value, int precision, char *digits)
+{
+    char text[64];
+    char other[64];
+
+    snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+    if (same_double(strtod(text, NULL), value))
+    {
+        significant_digits(text, digits);
+        return 1;
+    }
+    if (neighbour_reads_back(value, text, precision, 1, other) ||
+        (precision > 1 && neighbour_reads_back(value, text, precision, -1, other)))
+    {
+        significant_digits(other, digits);
+        return 1;
+    }
+    return 0;
+}
+
+static void check_print(double value)
+{
+    bscJSON *item = bscJSON_CreateNumber(value);
+    char printed[64];
+    char digits[32];
+    char expect[32];
+    char legacy[64];
+    int shortest = 0;
+
+    if (NULL == item || !bscJSON_PrintPreallocated(item, printed, sizeof(printed), 0))
+    {
+        TEST_CHECK_MSG(0, "print %a", value);
+        bscJSON_Delete(item);
+        return;
+    }
+    bscJSON_Delete(item);
+
+    TEST_CHECK_MSG(same_double(strtod(printed, NULL), value), "%a printed as %s", value, printed);
+    /* 少一位就读不回来(能读回的位数越多越容易, 少一位都不行就更短的都不行), 同样位数里最接近 */
+    significant_digits(printed, digits);
+    shortest = (int)strlen(digits);
+    TEST_CHECK_MSG(shortest <= 17, "%a printed as %s", value, printed);
+    TEST_CHECK_MSG(shortest == 1 || !closest_reading_back(value, shortest - 1, expect), "%a printed as %s, %d digits read back: %s", value, printed, shortest - 1, expect);
+    TEST_CHECK_MSG(closest_reading_back(value, shortest, expect) && 0 == strcmp(digits, expect), "%a printed as %s, closest digits %s", value, printed, expect);
+    if (shortest <= 15 && fabs(value) >= DBL_MIN)
+    {
+        snprintf(legacy, sizeof(legacy), "%1.15g", value);
+        TEST_CHECK_MSG(0 == strcmp(printed, legacy), "%a printed as %s, %%1.15g gives %s", value, printed, legacy);
+    }
+}
+
+static void check_parse(const char *text)
+{
+    const char *parse_end = NULL;
+    char *strtod_end = NULL;
+    double expect = strtod(text, &strtod_end);
+    bscJSON *item = bscJSON_ParseWithOpts(text, &parse_end, 0);
+
+    TEST_CHECK_MSG(NULL != item && bscJSON_IsNumber(item), "parse %.80s", text);
+    if (NULL != item && bscJSON_IsNumber(item))
+    {
+        TEST_CHECK_MSG(same_double(item->valuedouble, expect), "%.80s parsed as %a, strtod gives %a", text, item->valuedouble, expect);
+        TEST_CHECK_MSG(parse_end == strtod_end, "%.80s: parse consumed %d, strtod %d", text, (int)(parse_end - text), (int)(strtod_end - text));
+    }
+    bscJSON_Delete(item);
+}
+
+static void case_print_edges(void)
+{
+    static const double values[] =
+    {
+        0.0, 1.0, 0.1, 0.2, 0.3, 0.1 + 0.2, 1.0 / 3, 2.0 / 3, 123456.789, 1e15, 1e16, 1e17, 1e21, 1e22, 1e23,
+        9007199254740991.0, 9007199254740992.0, 9007199254740994.0, 5e-324, 1e-323, DBL_MIN, DBL_MAX,
+        2.2250738585072009e-308, 1.7976931348623157e308, 4.9406564584124654e-324, 5e-310, 1e-5, 1e-4, 0.001,
+        123e-20, 299792458.0, 6.02214076e23, 1.602176634e-19, 3.141592653589793, 2.718281828459045
+    };
+    size_t i = 0;
+    int n = 0;
+
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        check_print(values[i]);
+        check_print(-values[i]);
+    }
+    /* 2的幂: 下边界更近, 最小规格化数除外 */
+    for (n = -1074; n <= 1023; n++)
+    {
+        check_print(ldexp(1.0, n));
+        check_print(nextafter(ldexp(1.0, n), 0.0));
+        check_print(nextafter(ldexp(1.0, n), INFINITY));
+    }
+    for (n = -323; n <= 308; n++)
+    {
+        check_print(pow(10.0, n));
+        check_print(nextafter(pow(10.0, n), INFINITY));
+    }
+}
+
+static void case_print_random(void)
+{
+    char text[64];
+    int round = 0;
+
+    test_rand_seed(49);
+    for (round = 0; round < RANDOM_BITS_ROUNDS && 0 == test_failures; round++)
+    {
+        check_print(random_double_bits());
+    }
+    /* 几位有效数字的小数, 设备上报的多是这种 */
+    for (round = 0; round < SHORT_DECIMAL_ROUNDS && 0 == test_failures; round++)
+    {
+        snprintf(text, sizeof(text), "%llue%d", (unsigned long long)(test_rand() % 10000000ULL), (int)test_rand_below(60) - 40);
+        check_print(strtod(text, NULL));
+    }
+}
+
+/* 随机的数字串: 前导0, 1到30位有效数字, 任意位置的小数点, 可选的指数(有时缺数字) */
+static void random_number_text(char *text)
+{
+    size_t n = 0;
+    int digits = 1 + (int)test_rand_below(30);
+    int point = (int)test_rand_below((uint32_t)digits + 2) - 1;
+    int i = 0;
+
+    if (test_rand_below(2))
+    {
+        text[n++] = '-';
+    }
+    for (i = (int)test_rand_below(4) - 2; i > 0; i--)
+    {
+        text[n++] = '0';
+    }
+    for (i = 0; i < digits; i++)
+    {
+        if (i == point)
+        {
+            text[n++] = '.';
+        }
+        text[n++] = (char)('0' + test_rand_below(10));
+    }
+    if (test_rand_below(3))
+    {
+        text[n++] = test_rand_below(2) ? 'e' : 'E';
+        switch (test_rand_below(3))
+        {
+        case 0:
+            text[n++] = '-';
+            break;
+        case 1:
+            text[n++] = '+';
+            break;
+        default:
+            break;
+        }
+        if (test_rand_below(20))
+        {
+            n += (size_t)sprintf(text + n, "%u", test_rand_below(test_rand_below(2) ? 40 : 400));
+        }
+    }
+    text[n] = '\0';
+}
+
+static void case_parse_random(void)
+{
+    char text[TEXT_MAX];
+    int round = 0;
+
+    test_rand_seed(4949);
+    for (round = 0; round < PARSE_RANDOM_ROUNDS && 0 == test_failures; round++)
+    {
+        random_number_text(text);
+        if ('.' == text[0])
+        {
+            /* 不以数字或'-'开头的不是数字 */
+            continue;
+        }
+        check_parse(text);
+        /* 打印出来的17位也要能解析回来 */
+        snprintf(text, sizeof(text), "%.17g", random_double_bits());
+        check_parse(text);
+    }
+}
+
+static void case_parse_edges(void)
+{
+    static const char *texts[] =
+    {
+        "0", "-0", "0.0", "-0.0e5", "1", "-1", "1.5e", "1.5e+", "1e-", "2.", "-.5", "00012", "1.2.3", "1e5e5", "1E+2",
+        "9007199254740993", "9007199254740992.5", "18446744073709551615", "18446744073709551616",
+        "123456789012345678901234567890", "0.000000000000000000000000000001",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309", "-1e400",
+        "2.2250738585072011e-308", "2.2250738585072012e-308", "4.9406564584124654e-324", "2.4703282292062327e-324",
+        "2.4703282292062328e-324", "1e-324", "1e-400", "1e-99999", "1e99999", "1e999999999999",
+        "0.30000000000000004", "3.0000000000000004e-1", "7.2057594037927933e16", "1448997445238699", "5e-324",
+        "17976931348623157081452742373170435679807056752584499659891747680315726078002853876058955863276687817154045895351438246423432132688946418276846754670353751698604991057655128207624549009038932894407586850845513394230458323690322294816580855933212334827479782620414472316873817718091929988125040402618412485836.8",
+        "2.22507385850720113605740979670913197593481954635164564802342610972482222202107694551652952390813508791414915891303962110687008643869459464552765720740782062174337998814106326732925355228688137214901298112245145188984905722230728525513315575501591439747639798341180199932396254828901710708185069063066665599493827577257201576306269066333264756530000924588831643303777979186961204949739037782970490505108060994073026293712895895000358379996720725430436028407889577179615094551674824347103070260914462157228988025818254518032570701886087211312807951223342628836862232150377566662250398253433597456888442390026549819838548794829220689472168983109969836584681402285424333066033985088644580400103493397042756718644338377048603786162277173854562306587467901408672332763671875e-308",
+        "2.22507385850720113605740979670913197593481954635164564802342610972482222202107694551652952390813508791414915891303962110687008643869459464552765720740782062174337998814106326732925355228688137214901298112245145188984905722230728525513315575501591439747639798341180199932396254828901710708185069063066665599493827577257201576306269066333264756530000924588831643303777979186961204949739037782970490505108060994073026293712895895000358379996720725430436028407889577179615094551674824347103070260914462157228988025818254518032570701886087211312807951223342628836862232150377566662250398253433597456888442390026549819838548794829220689472168983109969836584681402285424333066033985088644580400103493397042756718644338377048603786162277173854562306587467901408672332763671875000000000000000000000000000000000000000000001e-308",
+    };
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+    {
+        check_parse(texts[i]);
+    }
+}
+
+/* 两个相邻double的中点: 精确的中点(平局, 取偶), 以及它按不同位数截断和进位后的数字串,
+ * 这些输入64位近似判断不了, 要走精确的十进制运算 */
+static void case_parse_halfway(void)
+{
+#if LDBL_MANT_DIG > 53
+    char text[TEXT_MAX];
+    char *exponent = NULL;
+    double low = 0;
+    long double mid = 0;
+    size_t n = 0;
+    size_t cut = 0;
+    int round = 0;
+
+    test_rand_seed(494949);
+    for (round = 0; round < HALFWAY_ROUNDS && 0 == test_failures; round++)
+    {
+        low = fabs(random_double_bits());
+        if (round % 4 == 0)
+        {
+            low = ldexp((double)(test_rand() >> 11), (int)test_rand_below(200) - 100);
+        }
+        if (DBL_MAX == low)
+        {
+            continue;
+        }
+        mid = ((long double)low + (long double)nextafter(low, INFINITY)) / 2;
+        snprintf(text, sizeof(text), "%.800Le", mid);
+        check_parse(text);
+
+        /* 在第17到40位截断, 剩下的有效数字要么丢掉(略低于中点), 要么末位加1(略高于中点) */
+        exponent = strchr(text, 'e');
+        n = (size_t)(exponent - text);
+        cut = 18 + test_rand_below(24);
+        if (cut < n)
+        {
+            memmove(text + cut, exponent, strlen(exponent) + 1);
+            check_parse(text);
+            if (text[cut - 1] < '9')
+            {
+                text[cut - 1]++;
+                check_parse(text);
+            }
+        }
+    }
+#endif
+}
+
+int main(void)
+{
+    case_print_edges();
+    case_print_random();
+    case_parse_edges();
+    case_parse_random();
+    case_parse_halfway();
+    return test_report("test_json_number");
+}
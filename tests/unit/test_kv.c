@@ -0,0 +1,280 @@
+/**
+ * \file      test_kv.c
+ * \brief     ezDevSDK_kv掉电一致性测试
+ *
+ * 把ezDevSDK_kv.c里用到的open/write/fsync/rename/unlink换成计数的版本, 子进程落盘时
+ * 在第N个操作(写按字节算)处直接_exit, 模拟写到任意位置时进程被杀. 父进程重新加载,
+ * 每个key只能读到旧值或新值, 然后还要能正常写入下一个值且不留下临时文件.
+ * 同时覆盖rename能覆盖和不能覆盖(FAT一类)已存在文件两种文件系统.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "test_util.h"
+
+#define CRASH_EXIT_CODE 42
+
+static long g_budget = -1;          ///< 剩余可执行的操作数, -1不限
+static int g_no_replace = 0;        ///< rename不能覆盖已存在的文件
+
+static void fault_point(void)
+{
+    if (g_budget == 0)
+    {
+        _exit(CRASH_EXIT_CODE);
+    }
+    if (g_budget > 0)
+    {
+        g_budget--;
+    }
+}
+
+static int fault_open(const char *path, int flags, ...)
+{
+    fault_point();
+    return open(path, flags, 0644);
+}
+
+static ssize_t fault_write(int fd, const void *buf, size_t count)
+{
+    //一次只写一个字节, 每个字节都是一个中断点
+    if (count == 0)
+    {
+        return 0;
+    }
+    fault_point();
+    return write(fd, buf, 1);
+}
+
+static int fault_fsync(int fd)
+{
+    fault_point();
+    return fsync(fd);
+}
+
+static int fault_rename(const char *from, const char *to)
+{
+    struct stat st;
+
+    fault_point();
+    if (g_no_replace && 0 == stat(to, &st))
+    {
+        errno = EEXIST;
+        return -1;
+    }
+    return rename(from, to);
+}
+
+static int fault_unlink(const char *path)
+{
+    fault_point();
+    return unlink(path);
+}
+
+#define open fault_open
+#define write fault_write
+#define fsync fault_fsync
+#define rename fault_rename
+#define unlink fault_unlink
+#include "ezDevSDK_kv.c"
+#undef open
+#undef write
+#undef fsync
+#undef rename
+#undef unlink
+
+static char g_dir[64];
+static char g_devid_path[128];
+static char g_masterkey_path[128];
+
+static void write_plain(const char *path, const char *value)
+{
+    FILE *fp = fopen(path, "wb");
+    fwrite(value, 1, strlen(value), fp);
+    fclose(fp);
+}
+
+static void remove_all(void)
+{
+    static const char *suffix[] = {"", ".tmp", ".new"};
+    char path[160];
+    size_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        snprintf(path, sizeof(path), "%s%s", g_devid_path, suffix[i]);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s%s", g_masterkey_path, suffix[i]);
+        unlink(path);
+    }
+}
+
+static int file_exists(const char *path, const char *suffix)
+{
+    char full[160];
+    struct stat st;
+
+    snprintf(full, sizeof(full), "%s%s", path, suffix);
+    return 0 == stat(full, &st);
+}
+
+/**
+ * \brief   读出当前值, 不存在时返回空串
+ */
+static void load_value(ezDevSDK_kv_key key, char *out, size_t out_len)
+{
+    memset(out, 0, out_len);
+    if (0 != ezDevSDK_kv_load(key, (unsigned char *)out, (int)out_len - 1))
+    {
+        out[0] = '\0';
+    }
+}
+
+/**
+ * \brief   子进程: 在第budget个操作处中断地写入新值. 返回子进程是否写完
+ */
+static int run_writer(long budget)
+{
+    int status = 0;
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        g_budget = budget;
+        if (0 != ezDevSDK_kv_init(g_devid_path, g_masterkey_path))
+        {
+            _exit(2);
+        }
+        ezDevSDK_kv_save(ezDevSDK_kv_devid, (unsigned char *)"NEW-DEVID-0123456789", 20);
+        ezDevSDK_kv_save(ezDevSDK_kv_masterkey, (unsigned char *)"NEWMASTER", 9);
+        _exit(0 == ezDevSDK_kv_flush(1) ? 0 : 3);
+    }
+
+    waitpid(pid, &status, 0);
+    TEST_CHECK_MSG(WIFEXITED(status) && (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == CRASH_EXIT_CODE),
+                   "writer failed at budget %ld, status %d", budget, status);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void run_scenario(int no_replace, int with_old)
+{
+    long budget;
+    int done = 0;
+    int seen_old = 0;
+    int seen_new = 0;
+    const char *old_devid = with_old ? "OLD-DEVID" : "";
+    const char *old_masterkey = with_old ? "OLDMASTERKEY" : "";
+
+    g_no_replace = no_replace;
+    for (budget = 0; !done && budget < 10000; budget++)
+    {
+        char devid[65];
+        char masterkey[65];
+
+        remove_all();
+        if (with_old)
+        {
+            write_plain(g_devid_path, old_devid);
+            write_plain(g_masterkey_path, old_masterkey);
+        }
+
+        done = run_writer(budget);
+
+        //重启后读取, 只能是旧值或新值
+        TEST_CHECK(0 == ezDevSDK_kv_init(g_devid_path, g_masterkey_path));
+        load_value(ezDevSDK_kv_devid, devid, sizeof(devid));
+        load_value(ezDevSDK_kv_masterkey, masterkey, sizeof(masterkey));
+        TEST_CHECK_MSG(0 == strcmp(devid, old_devid) || 0 == strcmp(devid, "NEW-DEVID-0123456789"),
+                       "no_replace %d old %d budget %ld: devid [%s]", no_replace, with_old, budget, devid);
+        TEST_CHECK_MSG(0 == strcmp(masterkey, old_masterkey) || 0 == strcmp(masterkey, "NEWMASTER"),
+                       "no_replace %d old %d budget %ld: masterkey [%s]", no_replace, with_old, budget, masterkey);
+        seen_old |= 0 == strcmp(devid, old_devid);
+        seen_new |= 0 == strcmp(devid, "NEW-DEVID-0123456789");
+        if (done)
+        {
+            TEST_CHECK(0 == strcmp(devid, "NEW-DEVID-0123456789") && 0 == strcmp(masterkey, "NEWMASTER"));
+        }
+
+        //恢复后要能继续写, 且不留下.tmp和.new
+        TEST_CHECK(0 == ezDevSDK_kv_save(ezDevSDK_kv_devid, (unsigned char *)"NEXT", 4));
+        TEST_CHECK(0 == ezDevSDK_kv_save(ezDevSDK_kv_masterkey, (unsigned char *)"NEXTMK", 6));
+        TEST_CHECK(0 == ezDevSDK_kv_flush(1));
+        ezDevSDK_kv_fini();
+
+        TEST_CHECK(!file_exists(g_devid_path, ".tmp") && !file_exists(g_devid_path, ".new"));
+        TEST_CHECK(!file_exists(g_masterkey_path, ".tmp") && !file_exists(g_masterkey_path, ".new"));
+
+        TEST_CHECK(0 == ezDevSDK_kv_init(g_devid_path, g_masterkey_path));
+        load_value(ezDevSDK_kv_devid, devid, sizeof(devid));
+        load_value(ezDevSDK_kv_masterkey, masterkey, sizeof(masterkey));
+        TEST_CHECK(0 == strcmp(devid, "NEXT") && 0 == strcmp(masterkey, "NEXTMK"));
+        ezDevSDK_kv_fini();
+    }
+
+    TEST_CHECK_MSG(done, "writer never completed");
+    TEST_CHECK(seen_old && seen_new);
+    printf("no_replace %d old %d: %ld crash points\n", no_replace, with_old, budget - 1);
+}
+
+static void test_partial_tmp_ignored(void)
+{
+    char devid[65];
+    char path[160];
+
+    remove_all();
+    write_plain(g_devid_path, "OLD-DEVID");
+    snprintf(path, sizeof(path), "%s.tmp", g_devid_path);
+    write_plain(path, "HALF-WRIT");
+
+    TEST_CHECK(0 == ezDevSDK_kv_init(g_devid_path, g_masterkey_path));
+    load_value(ezDevSDK_kv_devid, devid, sizeof(devid));
+    TEST_CHECK(0 == strcmp(devid, "OLD-DEVID"));
+    load_value(ezDevSDK_kv_masterkey, devid, sizeof(devid));
+    TEST_CHECK(devid[0] == '\0');
+    ezDevSDK_kv_fini();
+}
+
+static void test_coalesce(void)
+{
+    remove_all();
+    TEST_CHECK(0 == ezDevSDK_kv_init(g_devid_path, g_masterkey_path));
+    TEST_CHECK(0 == ezDevSDK_kv_save(ezDevSDK_kv_devid, (unsigned char *)"A", 1));
+    TEST_CHECK(0 == ezDevSDK_kv_save(ezDevSDK_kv_masterkey, (unsigned char *)"B", 1));
+
+    //合并窗口内不落盘
+    TEST_CHECK(-1 == ezDevSDK_kv_flush(0));
+    TEST_CHECK(!file_exists(g_devid_path, ""));
+    usleep((EZDEVSDK_KV_COALESCE_MS + 50) * 1000);
+    TEST_CHECK(0 == ezDevSDK_kv_flush(0));
+    TEST_CHECK(file_exists(g_devid_path, "") && file_exists(g_masterkey_path, ""));
+    ezDevSDK_kv_fini();
+}
+
+int main(void)
+{
+    snprintf(g_dir, sizeof(g_dir), "kv_test_XXXXXX");
+    if (mkdtemp(g_dir) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(g_devid_path, sizeof(g_devid_path), "%s/devid", g_dir);
+    snprintf(g_masterkey_path, sizeof(g_masterkey_path), "%s/masterkey", g_dir);
+
+    test_partial_tmp_ignored();
+    test_coalesce();
+    run_scenario(0, 1);
+    run_scenario(0, 0);
+    run_scenario(1, 1);
+    run_scenario(1, 0);
+
+    remove_all();
+    rmdir(g_dir);
+    return test_report("test_kv");
+}
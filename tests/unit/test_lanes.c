@@ -0,0 +1,311 @@
+/**
+ * \file      test_lanes.c
+ * \brief     v3发送队列分道(LANE_QUEUE_xxx)的出队顺序和容量测试
+ *
+ * 按das_pop_shaped_v3的用法先peek再pop_queue_lane, 并与pop_queue对照, 检查:
+ * - 三个分道一直有消息时按8/4/1的权重轮询, 两种取法的顺序相同
+ * - 控制和交互分道一直补满时, 新进的bulk消息最多等一轮(8+4+1次出队)就能发出, 与之前已经出了多少条无关
+ * - 被限速跳过的分道不消耗额度, peek不改变轮询状态
+ * - 每个分道有自己的上限, 满了返回mkernel_internal_queue_full且不影响其它分道; 越界的分道按交互分道算
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kerne_queuel.h"
+#include "platform_define.h"
+
+EXTERN_LANE_QUEUE_FUN(pubmsg_exchange_v3)
+EXTERN_QUEUE_BASE_FUN
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define ROUND_POPS      (ezdev_sdk_queue_weight_control + ezdev_sdk_queue_weight_interactive + ezdev_sdk_queue_weight_bulk)
+#define ROUNDS          20
+#define PHASES          200
+#define SKIP_LANE(lane) (1 << (lane))
+
+static const EZDEV_SDK_UINT16 g_lane_max[ezdev_sdk_queue_lane_count] = {
+    ezdev_sdk_queue_control_max, ezdev_sdk_queue_interactive_max, ezdev_sdk_queue_bulk_max};
+
+static int g_seq;
+
+static mkernel_internal_error push_lane(EZDEV_SDK_UINT8 lane, int at_head)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *msg = calloc(1, sizeof(*msg));
+    mkernel_internal_error err = mkernel_internal_succ;
+
+    msg->msg_lane = lane;
+    msg->msg_conntext_v3.msg_seq = (EZDEV_SDK_UINT32)++g_seq;
+    err = at_head ? push_queue_head_pubmsg_exchange_v3(msg) : push_queue_pubmsg_exchange_v3(msg);
+    if (mkernel_internal_succ != err)
+    {
+        free(msg);
+    }
+    return err;
+}
+
+static void fill_lane(EZDEV_SDK_UINT8 lane)
+{
+    while (mkernel_internal_succ == push_lane(lane, 0))
+    {
+    }
+}
+
+/**
+ * \brief   取出一条消息, 返回所在分道并把seq写到seq; 队列(除去跳过的分道)为空返回-1
+ * \param   peek    1按das_pop_shaped_v3先peek再pop_queue_lane, 0直接pop_queue
+ */
+static int pop_next(int peek, EZDEV_SDK_UINT8 skip, int *seq)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *msg = NULL;
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *peeked = NULL;
+    EZDEV_SDK_UINT8 lane = 0;
+    int msg_lane = 0;
+
+    if (peek)
+    {
+        if (mkernel_internal_succ != peek_queue_pubmsg_exchange_v3(&peeked, skip, &lane))
+        {
+            return -1;
+        }
+        TEST_CHECK(mkernel_internal_succ == pop_queue_lane_pubmsg_exchange_v3(&msg, lane));
+        TEST_CHECK(msg == peeked);
+    }
+    else if (mkernel_internal_succ != pop_queue_pubmsg_exchange_v3(&msg))
+    {
+        return -1;
+    }
+    if (NULL == msg)
+    {
+        return -1;
+    }
+    msg_lane = msg->msg_lane;
+    if (NULL != seq)
+    {
+        *seq = (int)msg->msg_conntext_v3.msg_seq;
+    }
+    free(msg);
+    return msg_lane;
+}
+
+static void start_queue(void)
+{
+    g_seq = 0;
+    TEST_CHECK(mkernel_internal_succ == init_queue(16, 16));
+}
+
+/**
+ * \brief   第i次出队(从0算)在一直饱和的队列里应该取到的分道
+ */
+static int saturated_lane(int i)
+{
+    int phase = i % ROUND_POPS;
+
+    if (phase < ezdev_sdk_queue_weight_control)
+    {
+        return ezdev_sdk_queue_lane_control;
+    }
+    if (phase < ezdev_sdk_queue_weight_control + ezdev_sdk_queue_weight_interactive)
+    {
+        return ezdev_sdk_queue_lane_interactive;
+    }
+    return ezdev_sdk_queue_lane_bulk;
+}
+
+static void test_weighted_order(int peek)
+{
+    int lanes[ROUNDS * ROUND_POPS];
+    int seq = 0;
+    int last_seq[ezdev_sdk_queue_lane_count] = {0};
+    int lane = 0;
+    int i = 0;
+
+    start_queue();
+    for (i = 0; i < ROUNDS * ROUND_POPS; i++)
+    {
+        /* 每次出队前把三个分道都补满, 一直处于饱和状态 */
+        for (lane = 0; lane < ezdev_sdk_queue_lane_count; lane++)
+        {
+            fill_lane((EZDEV_SDK_UINT8)lane);
+        }
+        lanes[i] = pop_next(peek, 0, &seq);
+        TEST_CHECK_MSG(lanes[i] == saturated_lane(i), "%s pop %d: lane %d, expected %d", peek ? "peek" : "pop", i, lanes[i],
+                       saturated_lane(i));
+        if (lanes[i] >= 0)
+        {
+            TEST_CHECK(seq > last_seq[lanes[i]]);
+            last_seq[lanes[i]] = seq;
+        }
+    }
+    fini_queue();
+}
+
+static void test_bulk_bound(int peek, EZDEV_SDK_UINT8 skip)
+{
+    int phase = 0;
+    int waited = 0;
+    int bulk_seq = 0;
+    int seq = 0;
+    int lane = 0;
+    int i = 0;
+
+    for (phase = 0; phase < PHASES; phase++)
+    {
+        start_queue();
+        fill_lane(ezdev_sdk_queue_lane_control);
+        fill_lane(ezdev_sdk_queue_lane_interactive);
+
+        /* 先出若干条, 让轮询停在随机的位置上, 期间bulk分道一直为空 */
+        for (i = (int)test_rand_below(3 * ROUND_POPS); i > 0; i--)
+        {
+            lane = pop_next(peek, skip, NULL);
+            TEST_CHECK(lane != ezdev_sdk_queue_lane_bulk);
+            fill_lane(ezdev_sdk_queue_lane_control);
+            fill_lane(ezdev_sdk_queue_lane_interactive);
+        }
+
+        TEST_CHECK(mkernel_internal_succ == push_lane(ezdev_sdk_queue_lane_bulk, 0));
+        bulk_seq = g_seq;
+        for (waited = 1; waited <= 2 * ROUND_POPS; waited++)
+        {
+            lane = pop_next(peek, skip, &seq);
+            if (lane == ezdev_sdk_queue_lane_bulk)
+            {
+                TEST_CHECK(seq == bulk_seq);
+                break;
+            }
+            TEST_CHECK(lane >= 0 && !(skip & SKIP_LANE(lane)));
+            fill_lane(ezdev_sdk_queue_lane_control);
+            fill_lane(ezdev_sdk_queue_lane_interactive);
+        }
+        TEST_CHECK_MSG(waited <= ROUND_POPS, "%s skip 0x%x phase %d: bulk sent after %d pops", peek ? "peek" : "pop", skip, phase, waited);
+        fini_queue();
+    }
+}
+
+static void test_skip_keeps_credit(void)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *first = NULL;
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *second = NULL;
+    EZDEV_SDK_UINT8 first_lane = 0;
+    EZDEV_SDK_UINT8 second_lane = 0;
+    int expect[ROUND_POPS];
+    int n = 0;
+    int i = 0;
+
+    start_queue();
+    for (i = 0; i < ezdev_sdk_queue_lane_count; i++)
+    {
+        fill_lane((EZDEV_SDK_UINT8)i);
+    }
+
+    /* peek不提交, 连续两次取到同一条, 队列和轮询状态都不变 */
+    TEST_CHECK(mkernel_internal_succ == peek_queue_pubmsg_exchange_v3(&first, 0, &first_lane));
+    TEST_CHECK(mkernel_internal_succ == peek_queue_pubmsg_exchange_v3(&second, 0, &second_lane));
+    TEST_CHECK(first == second && first_lane == second_lane && first_lane == ezdev_sdk_queue_lane_control);
+
+    /* 控制分道出两条后被限速, 交互分道接着出; 解除限速后先把交互分道的额度用完, 控制分道下一轮拿满额度 */
+    TEST_CHECK(pop_next(1, 0, NULL) == ezdev_sdk_queue_lane_control);
+    TEST_CHECK(pop_next(1, 0, NULL) == ezdev_sdk_queue_lane_control);
+    TEST_CHECK(pop_next(1, SKIP_LANE(ezdev_sdk_queue_lane_control), NULL) == ezdev_sdk_queue_lane_interactive);
+    for (i = 1; i < ezdev_sdk_queue_weight_interactive; i++)
+    {
+        expect[n++] = ezdev_sdk_queue_lane_interactive;
+    }
+    for (i = 0; i < ezdev_sdk_queue_weight_bulk; i++)
+    {
+        expect[n++] = ezdev_sdk_queue_lane_bulk;
+    }
+    for (i = 0; i < ezdev_sdk_queue_weight_control; i++)
+    {
+        expect[n++] = ezdev_sdk_queue_lane_control;
+    }
+    for (i = 0; i < n; i++)
+    {
+        TEST_CHECK_MSG(pop_next(1, 0, NULL) == expect[i], "after skip, pop %d", i);
+    }
+
+    /* 只剩被跳过的分道时peek返回空, 不改变任何状态 */
+    fini_queue();
+    start_queue();
+    TEST_CHECK(mkernel_internal_succ == push_lane(ezdev_sdk_queue_lane_bulk, 0));
+    TEST_CHECK(mkernel_internal_queue_empty == peek_queue_pubmsg_exchange_v3(&first, SKIP_LANE(ezdev_sdk_queue_lane_bulk), &first_lane));
+    TEST_CHECK(mkernel_internal_queue_empty == pop_queue_lane_pubmsg_exchange_v3(&first, ezdev_sdk_queue_lane_control));
+    TEST_CHECK(mkernel_internal_queue_empty == pop_queue_lane_pubmsg_exchange_v3(&first, ezdev_sdk_queue_lane_count));
+    TEST_CHECK(pop_next(1, 0, NULL) == ezdev_sdk_queue_lane_bulk);
+    TEST_CHECK(pop_next(1, 0, NULL) < 0);
+    fini_queue();
+}
+
+static void test_lane_cap(void)
+{
+    ezdev_sdk_kernel_pubmsg_exchange_v3 *msg = NULL;
+    int lane = 0;
+    int other = 0;
+    int seq = 0;
+    int i = 0;
+
+    for (lane = 0; lane < ezdev_sdk_queue_lane_count; lane++)
+    {
+        start_queue();
+        for (i = 0; i < g_lane_max[lane]; i++)
+        {
+            TEST_CHECK(mkernel_internal_succ == push_lane((EZDEV_SDK_UINT8)lane, 0));
+        }
+        TEST_CHECK_MSG(mkernel_internal_queue_full == push_lane((EZDEV_SDK_UINT8)lane, 0), "lane %d over %d", lane, g_lane_max[lane]);
+        TEST_CHECK(mkernel_internal_queue_full == push_lane((EZDEV_SDK_UINT8)lane, 1));
+
+        /* 一个分道满了其它分道照常入队 */
+        for (other = 0; other < ezdev_sdk_queue_lane_count; other++)
+        {
+            if (other != lane)
+            {
+                TEST_CHECK(mkernel_internal_succ == push_lane((EZDEV_SDK_UINT8)other, 0));
+            }
+        }
+
+        /* 取走一条后空出一个位置, 从头部插入的消息下一个发出 */
+        TEST_CHECK(mkernel_internal_succ == pop_queue_lane_pubmsg_exchange_v3(&msg, (EZDEV_SDK_UINT8)lane));
+        free(msg);
+        TEST_CHECK(mkernel_internal_succ == push_lane((EZDEV_SDK_UINT8)lane, 1));
+        TEST_CHECK(mkernel_internal_queue_full == push_lane((EZDEV_SDK_UINT8)lane, 0));
+        TEST_CHECK(mkernel_internal_succ == pop_queue_lane_pubmsg_exchange_v3(&msg, (EZDEV_SDK_UINT8)lane));
+        seq = NULL != msg ? (int)msg->msg_conntext_v3.msg_seq : 0;
+        TEST_CHECK(seq == g_seq - 1);
+        free(msg);
+        fini_queue();
+    }
+
+    /* 越界的分道按交互分道计数和出队 */
+    start_queue();
+    for (i = 0; i < ezdev_sdk_queue_interactive_max; i++)
+    {
+        TEST_CHECK(mkernel_internal_succ == push_lane(ezdev_sdk_queue_lane_count + 4, 0));
+    }
+    TEST_CHECK(mkernel_internal_queue_full == push_lane(ezdev_sdk_queue_lane_interactive, 0));
+    TEST_CHECK(pop_next(1, 0, NULL) == ezdev_sdk_queue_lane_interactive);
+    fini_queue();
+}
+
+int main(void)
+{
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_create = sdk_platform_thread_mutex_create;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    test_rand_seed(35);
+
+    test_weighted_order(1);
+    test_weighted_order(0);
+    test_bulk_bound(1, 0);
+    test_bulk_bound(0, 0);
+    /* 控制分道被限速时交互分道独占, bulk仍然在一轮内发出 */
+    test_bulk_bound(1, SKIP_LANE(ezdev_sdk_queue_lane_control));
+    test_skip_keeps_credit();
+    test_lane_cap();
+    return test_report("test_lanes");
+}
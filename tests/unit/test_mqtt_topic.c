@@ -0,0 +1,470 @@
+/**
+ * \file      test_mqtt_topic.c
+ * \brief     MQTT订阅索引(MQTTTopicIndex)的匹配测试
+ *
+ * - '+'匹配一级, '#'匹配其后所有级, "a/#"也匹配"a"本身
+ * - 同一个topic同时有精确订阅和通配订阅时都投递, 重复订阅替换回调
+ * - 删除订阅后不再匹配, 删除不存在的订阅失败, 删除后再订阅复用节点
+ * - 超过MQTT_TOPIC_MAX_LEVELS级的topic: 最后一级带着剩余部分, '+'不能匹配剩余的多级;
+ *   通配符落在剩余部分里的订阅添加失败
+ * - 匹配的订阅超过MQTT_TOPIC_MAX_MATCHES个时只返回这么多个, 不越界
+ * - 随机订阅集合和随机topic与按MQTT规则逐级比较的参考实现对比
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "MQTTTopicIndex.h"
+
+#define HANDLER_COUNT   32
+#define RANDOM_ROUNDS   3000
+#define RANDOM_FILTERS  12
+#define RANDOM_TOPICS   40
+#define LEVELS_DEEP     (MQTT_TOPIC_MAX_LEVELS + 4)
+
+#define DEFINE_HANDLER(n) static void handler_##n(struct MessageData *md) { (void)md; }
+DEFINE_HANDLER(0) DEFINE_HANDLER(1) DEFINE_HANDLER(2) DEFINE_HANDLER(3) DEFINE_HANDLER(4) DEFINE_HANDLER(5) DEFINE_HANDLER(6) DEFINE_HANDLER(7)
+DEFINE_HANDLER(8) DEFINE_HANDLER(9) DEFINE_HANDLER(10) DEFINE_HANDLER(11) DEFINE_HANDLER(12) DEFINE_HANDLER(13) DEFINE_HANDLER(14) DEFINE_HANDLER(15)
+DEFINE_HANDLER(16) DEFINE_HANDLER(17) DEFINE_HANDLER(18) DEFINE_HANDLER(19) DEFINE_HANDLER(20) DEFINE_HANDLER(21) DEFINE_HANDLER(22) DEFINE_HANDLER(23)
+DEFINE_HANDLER(24) DEFINE_HANDLER(25) DEFINE_HANDLER(26) DEFINE_HANDLER(27) DEFINE_HANDLER(28) DEFINE_HANDLER(29) DEFINE_HANDLER(30) DEFINE_HANDLER(31)
+
+static const MQTTTopicHandler g_handlers[HANDLER_COUNT] = {
+    handler_0, handler_1, handler_2, handler_3, handler_4, handler_5, handler_6, handler_7,
+    handler_8, handler_9, handler_10, handler_11, handler_12, handler_13, handler_14, handler_15,
+    handler_16, handler_17, handler_18, handler_19, handler_20, handler_21, handler_22, handler_23,
+    handler_24, handler_25, handler_26, handler_27, handler_28, handler_29, handler_30, handler_31,
+};
+
+/**
+ * \brief   匹配结果后面放一段哨兵, 检查不会写过MQTT_TOPIC_MAX_MATCHES
+ */
+typedef struct
+{
+    MQTTTopicHandler handlers[MQTT_TOPIC_MAX_MATCHES];
+    MQTTTopicHandler guard[4];
+} match_out;
+
+static int handler_id(MQTTTopicHandler fp)
+{
+    int i = 0;
+
+    for (i = 0; i < HANDLER_COUNT; i++)
+    {
+        if (g_handlers[i] == fp)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief   匹配topic, 返回命中回调编号的位图
+ */
+static uint32_t match_mask(MQTTTopicIndex *index, const char *topic, int *count)
+{
+    MQTTString name = MQTTString_initializer;
+    MQTTTopicLevels levels;
+    match_out out;
+    uint32_t mask = 0;
+    int i = 0;
+    int id = 0;
+
+    memset(&out, 0, sizeof(out));
+    name.lenstring.data = (char *)topic;
+    name.lenstring.len = (int)strlen(topic);
+    *count = MQTTTopicIndex_match(index, &name, &levels, out.handlers);
+    TEST_CHECK(*count >= 0 && *count <= MQTT_TOPIC_MAX_MATCHES);
+    TEST_CHECK(NULL == out.guard[0] && NULL == out.guard[3]);
+    for (i = 0; i < *count && i < MQTT_TOPIC_MAX_MATCHES; i++)
+    {
+        id = handler_id(out.handlers[i]);
+        TEST_CHECK_MSG(id >= 0, "%s: unknown handler", topic);
+        TEST_CHECK_MSG(id < 0 || 0 == (mask & (1u << id)), "%s: handler %d delivered twice", topic, id);
+        if (id >= 0)
+        {
+            mask |= 1u << id;
+        }
+    }
+    return mask;
+}
+
+static void expect(MQTTTopicIndex *index, const char *topic, uint32_t want)
+{
+    int count = 0;
+    uint32_t got = match_mask(index, topic, &count);
+
+    TEST_CHECK_MSG(got == want, "%s: matched 0x%x, want 0x%x", topic, (unsigned)got, (unsigned)want);
+}
+
+static void test_wildcards(void)
+{
+    MQTTTopicIndex index;
+
+    MQTTTopicIndex_init(&index);
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/+/c", handler_0));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/#", handler_1));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "+", handler_2));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "#", handler_3));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "+/+/c/#", handler_4));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "x/+", handler_5));
+
+    expect(&index, "a/b/c", (1u << 0) | (1u << 1) | (1u << 3) | (1u << 4));
+    expect(&index, "a", (1u << 1) | (1u << 2) | (1u << 3));
+    expect(&index, "a/b", (1u << 1) | (1u << 3));
+    expect(&index, "a/b/c/d/e", (1u << 1) | (1u << 3) | (1u << 4));
+    expect(&index, "b/b/c", (1u << 3) | (1u << 4));
+    expect(&index, "x", (1u << 2) | (1u << 3));
+    expect(&index, "x/", (1u << 3) | (1u << 5));
+    expect(&index, "x/y/z", 1u << 3);
+    expect(&index, "a//c", (1u << 0) | (1u << 1) | (1u << 3) | (1u << 4));
+
+    /* 通配符只能单独占一级, '#'只能在最后 */
+    TEST_CHECK(0 != MQTTTopicIndex_add(&index, "a/b+/c", handler_6));
+    TEST_CHECK(0 != MQTTTopicIndex_add(&index, "a/#/c", handler_6));
+    TEST_CHECK(0 != MQTTTopicIndex_add(&index, "a/b#", handler_6));
+    TEST_CHECK(0 != MQTTTopicIndex_add(&index, "", handler_6));
+    TEST_CHECK(6 == index.count);
+    MQTTTopicIndex_fini(&index);
+}
+
+static void test_exact_and_wildcard(void)
+{
+    MQTTTopicIndex index;
+
+    MQTTTopicIndex_init(&index);
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "/iot/dev/cmd", handler_0));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "/iot/+/cmd", handler_1));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "/iot/dev/#", handler_2));
+    expect(&index, "/iot/dev/cmd", (1u << 0) | (1u << 1) | (1u << 2));
+    expect(&index, "/iot/other/cmd", 1u << 1);
+    expect(&index, "/iot/dev", 1u << 2);
+    expect(&index, "iot/dev/cmd", 0);
+
+    /* 重复订阅替换回调, 个数不变 */
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "/iot/dev/cmd", handler_3));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "/iot/+/cmd", handler_4));
+    TEST_CHECK(3 == index.count);
+    expect(&index, "/iot/dev/cmd", (1u << 2) | (1u << 3) | (1u << 4));
+    MQTTTopicIndex_fini(&index);
+}
+
+static void test_remove(void)
+{
+    MQTTTopicIndex index;
+
+    MQTTTopicIndex_init(&index);
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/b", handler_0));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/+", handler_1));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/#", handler_2));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/+/c", handler_3));
+
+    TEST_CHECK(0 == MQTTTopicIndex_remove(&index, "a/+"));
+    expect(&index, "a/b", (1u << 0) | (1u << 2));
+    expect(&index, "a/b/c", (1u << 2) | (1u << 3));
+    TEST_CHECK(0 == MQTTTopicIndex_remove(&index, "a/b"));
+    expect(&index, "a/b", 1u << 2);
+    TEST_CHECK(0 == MQTTTopicIndex_remove(&index, "a/#"));
+    expect(&index, "a/b", 0);
+    expect(&index, "a", 0);
+    expect(&index, "a/b/c", 1u << 3);
+
+    /* 不存在的订阅, 包括只是前缀树里还留着节点的 */
+    TEST_CHECK(0 != MQTTTopicIndex_remove(&index, "a/+"));
+    TEST_CHECK(0 != MQTTTopicIndex_remove(&index, "a/b"));
+    TEST_CHECK(0 != MQTTTopicIndex_remove(&index, "a/#"));
+    TEST_CHECK(0 != MQTTTopicIndex_remove(&index, "a/+/c/d"));
+    TEST_CHECK(1 == index.count);
+
+    TEST_CHECK(0 == MQTTTopicIndex_remove(&index, "a/+/c"));
+    TEST_CHECK(0 == index.count);
+    expect(&index, "a/b/c", 0);
+
+    /* 删除后重新订阅 */
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/+", handler_5));
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, "a/b", handler_6));
+    expect(&index, "a/b", (1u << 5) | (1u << 6));
+    MQTTTopicIndex_fini(&index);
+}
+
+/**
+ * \brief   用n级拼出topic, 第i级取levels[i]
+ */
+static void join_levels(char *buf, size_t buf_len, const char **levels, int n)
+{
+    size_t len = 0;
+    int i = 0;
+
+    buf[0] = '\0';
+    for (i = 0; i < n; i++)
+    {
+        len += (size_t)snprintf(buf + len, buf_len - len, "%s%s", i ? "/" : "", levels[i]);
+    }
+}
+
+static void test_deep_topics(void)
+{
+    MQTTTopicIndex index;
+    MQTTTopicLevels levels;
+    MQTTString name = MQTTString_initializer;
+    const char *parts[LEVELS_DEEP];
+    char topic[256];
+    char filter[256];
+    int i = 0;
+
+    for (i = 0; i < LEVELS_DEEP; i++)
+    {
+        parts[i] = "l";
+    }
+
+    /* 切分: 最后一级带着剩余部分 */
+    join_levels(topic, sizeof(topic), parts, LEVELS_DEEP);
+    name.cstring = topic;
+    TEST_CHECK(MQTT_TOPIC_MAX_LEVELS == MQTTTopicIndex_split(&name, &levels));
+    TEST_CHECK(levels.level[MQTT_TOPIC_MAX_LEVELS - 1].len == 2 * (LEVELS_DEEP - MQTT_TOPIC_MAX_LEVELS) + 1);
+
+    MQTTTopicIndex_init(&index);
+    /* 精确订阅整个比较, 不受级数限制 */
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, topic, handler_0));
+    /* 第一级是'+', 其余是字面量, 剩余部分按字面量整体比较 */
+    parts[0] = "+";
+    join_levels(filter, sizeof(filter), parts, LEVELS_DEEP);
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, filter, handler_1));
+    /* 正好MQTT_TOPIC_MAX_LEVELS级, 最后一级是'+': 只匹配同样级数的topic */
+    parts[0] = "l";
+    parts[MQTT_TOPIC_MAX_LEVELS - 1] = "+";
+    join_levels(filter, sizeof(filter), parts, MQTT_TOPIC_MAX_LEVELS);
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, filter, handler_2));
+    /* 最后一级是'#' */
+    parts[MQTT_TOPIC_MAX_LEVELS - 1] = "#";
+    join_levels(filter, sizeof(filter), parts, MQTT_TOPIC_MAX_LEVELS);
+    TEST_CHECK(0 == MQTTTopicIndex_add(&index, filter, handler_3));
+    /* 通配符落在剩余部分里, 无法按级匹配, 添加失败 */
+    parts[MQTT_TOPIC_MAX_LEVELS - 1] = "l";
+    parts[LEVELS_DEEP - 1] = "+";
+    join_levels(filter, sizeof(filter), parts, LEVELS_DEEP);
+    TEST_CHECK(0 != MQTTTopicIndex_add(&index, filter, handler_4));
+    parts[LEVELS_DEEP - 1] = "#";
+    join_levels(filter, sizeof(filter), parts, LEVELS_DEEP);
+    TEST_CHECK(0 != MQTTTopicIndex_add(&index, filter, handler_4));
+    parts[LEVELS_DEEP - 1] = "l";
+    TEST_CHECK(4 == index.count);
+
+    expect(&index, topic, (1u << 0) | (1u << 1) | (1u << 3));
+    join_levels(topic, sizeof(topic), parts, MQTT_TOPIC_MAX_LEVELS);
+    expect(&index, topic, (1u << 2) | (1u << 3));
+    join_levels(topic, sizeof(topic), parts, MQTT_TOPIC_MAX_LEVELS - 1);
+    expect(&index, topic, 1u << 3);
+    join_levels(topic, sizeof(topic), parts, MQTT_TOPIC_MAX_LEVELS + 1);
+    expect(&index, topic, 1u << 3);
+    MQTTTopicIndex_fini(&index);
+}
+
+static void test_max_matches(void)
+{
+    static const char *filters[] = {"a/b/c", "+/b/c", "a/+/c", "a/b/+", "+/+/c", "+/b/+", "a/+/+", "+/+/+",
+                                    "#", "a/#", "a/b/#", "a/b/c/#", "+/#", "+/b/#"};
+    MQTTTopicIndex index;
+    int count = 0;
+    uint32_t mask = 0;
+    size_t i = 0;
+
+    MQTTTopicIndex_init(&index);
+    for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+    {
+        TEST_CHECK(0 == MQTTTopicIndex_add(&index, filters[i], g_handlers[i]));
+    }
+    TEST_CHECK(sizeof(filters) / sizeof(filters[0]) > MQTT_TOPIC_MAX_MATCHES);
+
+    mask = match_mask(&index, "a/b/c", &count);
+    TEST_CHECK(MQTT_TOPIC_MAX_MATCHES == count);
+    TEST_CHECK(0 == (mask >> (sizeof(filters) / sizeof(filters[0]))));
+    /* 精确订阅先查, 不会被通配订阅挤掉 */
+    TEST_CHECK(mask & 1u);
+
+    /* 去掉一些以后都能收到 */
+    for (i = MQTT_TOPIC_MAX_MATCHES; i < sizeof(filters) / sizeof(filters[0]); i++)
+    {
+        TEST_CHECK(0 == MQTTTopicIndex_remove(&index, filters[i]));
+    }
+    expect(&index, "a/b/c", (1u << MQTT_TOPIC_MAX_MATCHES) - 1);
+    MQTTTopicIndex_fini(&index);
+}
+
+/**
+ * \brief   参考实现: 按MQTT规则逐级比较, 不限级数
+ */
+static int ref_match(const char *filter, const char *topic)
+{
+    const char *fs = NULL;
+    const char *ts = NULL;
+    size_t fl = 0;
+    size_t tl = 0;
+
+    for (;;)
+    {
+        fs = strchr(filter, '/');
+        ts = strchr(topic, '/');
+        fl = fs ? (size_t)(fs - filter) : strlen(filter);
+        tl = ts ? (size_t)(ts - topic) : strlen(topic);
+        if (1 == fl && '#' == filter[0])
+        {
+            return 1;
+        }
+        if (!(1 == fl && '+' == filter[0]) && (fl != tl || 0 != memcmp(filter, topic, fl)))
+        {
+            return 0;
+        }
+        if (NULL == ts)
+        {
+            /* topic到头了, 订阅剩下的只能是"/#" */
+            return NULL == fs || 0 == strcmp(fs + 1, "#");
+        }
+        if (NULL == fs)
+        {
+            return 0;
+        }
+        filter = fs + 1;
+        topic = ts + 1;
+    }
+}
+
+/**
+ * \brief   订阅能否按级放进索引: 非空, 通配符不能落在超出MQTT_TOPIC_MAX_LEVELS级时最后一级带的剩余部分里
+ */
+static int filter_indexable(const char *filter)
+{
+    const char *p = NULL;
+    int levels = 1;
+    int level = 0;
+
+    for (p = filter; *p; p++)
+    {
+        levels += '/' == *p;
+    }
+    for (p = filter; *p; p++)
+    {
+        if ('/' == *p)
+        {
+            level++;
+        }
+        else if (('+' == *p || '#' == *p) && levels > MQTT_TOPIC_MAX_LEVELS && level >= MQTT_TOPIC_MAX_LEVELS - 1)
+        {
+            return 0;
+        }
+    }
+    return '\0' != filter[0];
+}
+
+static void random_path(char *buf, size_t buf_len, int wildcards)
+{
+    static const char *literals[] = {"a", "a", "a", "b", ""};
+    int depth = 1 + (int)test_rand_below(test_rand_below(4) ? 4 : LEVELS_DEEP);
+    size_t len = 0;
+    const char *level = NULL;
+    int i = 0;
+    uint32_t r = 0;
+
+    buf[0] = '\0';
+    for (i = 0; i < depth; i++)
+    {
+        r = test_rand_below(10);
+        if (wildcards && i == depth - 1 && r < 2)
+        {
+            level = "#";
+        }
+        else if (wildcards && r < 4)
+        {
+            level = "+";
+        }
+        else
+        {
+            level = literals[test_rand_below(sizeof(literals) / sizeof(literals[0]))];
+        }
+        len += (size_t)snprintf(buf + len, buf_len - len, "%s%s", i ? "/" : "", level);
+    }
+}
+
+static void test_random(void)
+{
+    char filters[RANDOM_FILTERS][128];
+    int owner[RANDOM_FILTERS];
+    int added[RANDOM_FILTERS];
+    char topic[128];
+    MQTTTopicIndex index;
+    uint32_t want = 0;
+    uint32_t got = 0;
+    int want_count = 0;
+    int count = 0;
+    int round = 0;
+    int i = 0;
+    int j = 0;
+    int t = 0;
+
+    test_rand_seed(27);
+    for (round = 0; round < RANDOM_ROUNDS && 0 == test_failures; round++)
+    {
+        MQTTTopicIndex_init(&index);
+        for (i = 0; i < RANDOM_FILTERS; i++)
+        {
+            random_path(filters[i], sizeof(filters[i]), 1);
+            owner[i] = i;
+            added[i] = 0 == MQTTTopicIndex_add(&index, filters[i], g_handlers[i]);
+            TEST_CHECK_MSG(added[i] == filter_indexable(filters[i]), "add %s", filters[i]);
+            /* 重复的订阅替换回调, 前面那个不再收到 */
+            for (j = 0; j < i && added[i]; j++)
+            {
+                if (added[j] && owner[j] == j && 0 == strcmp(filters[i], filters[j]))
+                {
+                    owner[j] = i;
+                }
+            }
+        }
+        /* 随机删掉一些 */
+        for (i = 0; i < RANDOM_FILTERS; i++)
+        {
+            if (added[i] && owner[i] == i && 0 == test_rand_below(4))
+            {
+                TEST_CHECK(0 == MQTTTopicIndex_remove(&index, filters[i]));
+                added[i] = 0;
+            }
+        }
+
+        for (t = 0; t < RANDOM_TOPICS; t++)
+        {
+            random_path(topic, sizeof(topic), 0);
+            want = 0;
+            want_count = 0;
+            for (i = 0; i < RANDOM_FILTERS; i++)
+            {
+                if (added[i] && owner[i] == i && ref_match(filters[i], topic))
+                {
+                    want |= 1u << i;
+                    want_count++;
+                }
+            }
+            got = match_mask(&index, topic, &count);
+            if (want_count <= MQTT_TOPIC_MAX_MATCHES)
+            {
+                TEST_CHECK_MSG(got == want, "round %d topic %s: matched 0x%x, want 0x%x", round, topic, (unsigned)got, (unsigned)want);
+            }
+            else
+            {
+                TEST_CHECK_MSG(MQTT_TOPIC_MAX_MATCHES == count && got == (got & want), "round %d topic %s: matched 0x%x of 0x%x", round, topic,
+                               (unsigned)got, (unsigned)want);
+            }
+        }
+        MQTTTopicIndex_fini(&index);
+    }
+}
+
+int main(void)
+{
+    test_wildcards();
+    test_exact_and_wildcard();
+    test_remove();
+    test_deep_topics();
+    test_max_matches();
+    test_random();
+    return test_report("test_mqtt_topic");
+}
@@ -0,0 +1,484 @@
+/**
+ * \file      test_request.c
+ * \brief     请求/响应关联服务(ezdev_sdk_kernel_request)在大量未完成请求下的压力测试
+ *
+ * 不启动微内核, 只初始化时间轮和请求服务, 用一个线程代替微内核线程驱动时间轮:
+ * - 填满请求表, 多余的请求和重复的seq被拒绝; 多个线程并发完成、取消、发错误响应, 每个请求最多回调一次
+ * - 大量请求带随机超时, 与并发的响应赛跑, 每个请求恰好回调一次, 结果和响应是否被接受一致
+ * - 同步等待在回调时立即醒来, 与没有信号量时的轮询比较唤醒延迟; 没有人驱动时间轮时到期后自己取消
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "mkernel_internal_error.h"
+#include "ezdev_sdk_kernel_timer.h"
+#include "ezdev_sdk_kernel_request.h"
+#include "platform_define.h"
+#include "utils.h"
+
+EZDEV_SDK_KERNEL_TIMER_INTERFACE
+EZDEV_SDK_KERNEL_REQUEST_INTERFACE
+TIME_PLATFORM_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+SEM_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+#define REQUEST_MAX     (ezdev_sdk_request_slot_max / 4 * 3)
+#define WORKERS         4
+#define WAITERS         32
+#define WAIT_ROUNDS     20
+#define MODULE          "model"
+
+typedef struct
+{
+    volatile int calls;
+    volatile int result;
+    volatile int accepted;      ///< kernel_request_complete_v3返回TRUE的次数
+    volatile int cancelled;     ///< kernel_request_cancel成功
+} request_record;
+
+static request_record g_record[REQUEST_MAX + 1];
+static volatile int g_driver_stop;
+static pthread_mutex_t g_record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void record_cb(const sdk_request_result *result)
+{
+    request_record *record = (request_record *)result->user_data;
+
+    pthread_mutex_lock(&g_record_lock);
+    record->calls++;
+    record->result = (int)result->result;
+    pthread_mutex_unlock(&g_record_lock);
+}
+
+static mkernel_internal_error add_request(EZDEV_SDK_UINT32 seq, EZDEV_SDK_UINT32 timeout_ms, sdk_request_cb cb, void *user_data)
+{
+    sdk_request_option option;
+
+    memset(&option, 0, sizeof(option));
+    option.timeout_ms = timeout_ms;
+    option.cb = cb;
+    option.user_data = user_data;
+    return kernel_request_add(seq, kernel_request_v3, MODULE, 0, "query", &option);
+}
+
+static EZDEV_SDK_BOOL respond(EZDEV_SDK_UINT32 seq, const char *msg_type, const char *body)
+{
+    ezdev_sdk_kernel_submsg_v3 rsp;
+
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.msg_seq = seq;
+    strcpy(rsp.module, MODULE);
+    strcpy(rsp.msg_type, msg_type);
+    rsp.buf = (void *)body;
+    rsp.buf_len = (EZDEV_SDK_UINT32)strlen(body);
+    return kernel_request_complete_v3(&rsp);
+}
+
+/**
+ * \brief   代替微内核线程驱动时间轮
+ */
+static void *driver_thread(void *arg)
+{
+    (void)arg;
+    while (!g_driver_stop)
+    {
+        kernel_timer_next_deadline();
+        usleep(500);
+    }
+    return NULL;
+}
+
+static uint64_t xorshift(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+typedef struct
+{
+    int index;
+    uint64_t rng;
+    int cancel_percent;
+    int pace_us;        ///< 每个seq之后歇一会, 让响应和超时交错
+} worker_arg;
+
+/**
+ * \brief   按seq从大到小交错分给各个线程, 每个seq先发一个类型不对的响应, 再随机完成或取消, 完成后再重复完成一次
+ */
+static void *worker_thread(void *arg)
+{
+    worker_arg *worker = (worker_arg *)arg;
+    EZDEV_SDK_UINT32 seq = 0;
+    request_record *record = NULL;
+
+    for (seq = REQUEST_MAX - worker->index; seq >= 1 && seq <= REQUEST_MAX; seq -= WORKERS)
+    {
+        record = &g_record[seq];
+        if (respond(seq, "query", "{}") || respond(seq, "report_reply", "{}"))
+        {
+            record->accepted += 100;
+        }
+        if ((int)(xorshift(&worker->rng) % 100) < worker->cancel_percent)
+        {
+            if (mkernel_internal_succ == kernel_request_cancel(seq))
+            {
+                record->cancelled++;
+            }
+        }
+        else if (respond(seq, "query_reply", "{\"ok\":1}"))
+        {
+            record->accepted++;
+        }
+        if (respond(seq, "query_reply", "{}"))
+        {
+            record->accepted++;
+        }
+        if (worker->pace_us > 0)
+        {
+            usleep(worker->pace_us);
+        }
+    }
+    return NULL;
+}
+
+static void run_workers(int cancel_percent, int pace_us, uint64_t seed)
+{
+    pthread_t threads[WORKERS];
+    worker_arg args[WORKERS];
+    int i = 0;
+
+    for (i = 0; i < WORKERS; i++)
+    {
+        args[i].index = i;
+        args[i].rng = seed * 0x9E3779B97F4A7C15ULL + (uint64_t)i + 1;
+        args[i].cancel_percent = cancel_percent;
+        args[i].pace_us = pace_us;
+        pthread_create(&threads[i], NULL, worker_thread, &args[i]);
+    }
+    for (i = 0; i < WORKERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/**
+ * \brief   填满请求表, 并发完成和取消, 最后断线取消剩下的请求
+ */
+static void case_full_table(void)
+{
+    EZDEV_SDK_UINT32 seq = 0;
+    int completed = 0;
+    int cancelled = 0;
+    uint64_t start = 0;
+
+    memset(g_record, 0, sizeof(g_record));
+    start = test_now_ns();
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        TEST_CHECK(mkernel_internal_succ == add_request(seq, 60000, record_cb, &g_record[seq]));
+    }
+    printf("full_table: %d outstanding requests added in %.2f ms\n", REQUEST_MAX, (test_now_ns() - start) / 1e6);
+    TEST_CHECK(mkernel_internal_queue_full == add_request(REQUEST_MAX + 1, 60000, record_cb, &g_record[0]));
+    TEST_CHECK(0 == g_record[0].calls);
+
+    /* 腾出一个位置后, seq重复的请求仍然被拒 */
+    TEST_CHECK(mkernel_internal_succ == kernel_request_cancel(REQUEST_MAX));
+    g_record[REQUEST_MAX].cancelled++;
+    TEST_CHECK(mkernel_internal_invald_call == add_request(1, 60000, record_cb, &g_record[0]));
+
+    start = test_now_ns();
+    run_workers(25, 0, 1);
+    printf("full_table: completed/cancelled from %d threads in %.2f ms\n", WORKERS, (test_now_ns() - start) / 1e6);
+
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        request_record *record = &g_record[seq];
+
+        TEST_CHECK_MSG(record->accepted <= 1 && record->cancelled <= 1 && record->accepted + record->cancelled == 1,
+                       "seq %u accepted %d cancelled %d", seq, record->accepted, record->cancelled);
+        TEST_CHECK_MSG(record->calls == record->accepted, "seq %u calls %d accepted %d", seq, record->calls, record->accepted);
+        if (1 == record->calls)
+        {
+            TEST_CHECK(ezdev_sdk_kernel_succ == record->result);
+        }
+        completed += record->accepted;
+        cancelled += record->cancelled;
+    }
+    printf("full_table: %d completed, %d cancelled\n", completed, cancelled);
+
+    /* 表已经清空, 可以重新填满; 断线时全部以取消回调一次 */
+    memset(g_record, 0, sizeof(g_record));
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        TEST_CHECK(mkernel_internal_succ == add_request(seq + 100000, 60000, record_cb, &g_record[seq]));
+    }
+    kernel_request_cancel_all(mkernel_internal_request_cancelled);
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        TEST_CHECK(1 == g_record[seq].calls && ezdev_sdk_kernel_request_cancelled == g_record[seq].result);
+        TEST_CHECK(!respond(seq + 100000, "query_reply", "{}"));
+    }
+    TEST_CHECK(mkernel_internal_succ == add_request(1, 60000, record_cb, &g_record[0]));
+    TEST_CHECK(mkernel_internal_succ == kernel_request_cancel(1));
+}
+
+/**
+ * \brief   随机超时和并发响应赛跑
+ */
+static void case_timeout_race(void)
+{
+    EZDEV_SDK_UINT32 seq = 0;
+    int timeouts = 0;
+    int pending = 0;
+    int i = 0;
+    uint64_t start = 0;
+
+    memset(g_record, 0, sizeof(g_record));
+    test_rand_seed(2);
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        TEST_CHECK(mkernel_internal_succ == add_request(seq, 1 + test_rand_below(150), record_cb, &g_record[seq]));
+    }
+    run_workers(0, 50, 2);
+
+    /* 时间轮在另一个线程上跑, 等所有回调结束 */
+    start = test_now_ns();
+    do
+    {
+        usleep(10000);
+        pending = 0;
+        for (seq = 1; seq <= REQUEST_MAX; seq++)
+        {
+            pending += (0 == g_record[seq].calls);
+        }
+    } while (pending != 0 && test_now_ns() - start < 5000000000ULL);
+    TEST_CHECK_MSG(0 == pending, "%d requests never called back", pending);
+
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        request_record *record = &g_record[seq];
+
+        TEST_CHECK_MSG(1 == record->calls, "seq %u calls %d", seq, record->calls);
+        TEST_CHECK(record->accepted <= 1);
+        if (record->accepted)
+        {
+            TEST_CHECK(ezdev_sdk_kernel_succ == record->result);
+        }
+        else
+        {
+            TEST_CHECK_MSG(ezdev_sdk_kernel_request_timeout == record->result, "seq %u result %d", seq, record->result);
+            timeouts++;
+        }
+    }
+    printf("timeout_race: %d completed, %d timed out\n", REQUEST_MAX - timeouts, timeouts);
+
+    /* 回调都结束以后表应当是空的 */
+    for (i = 0; i < 3; i++)
+    {
+        kernel_timer_next_deadline();
+    }
+    for (seq = 1; seq <= REQUEST_MAX; seq++)
+    {
+        TEST_CHECK(mkernel_internal_succ == add_request(seq + 200000, 60000, NULL, NULL));
+    }
+    kernel_request_cancel_all(mkernel_internal_request_cancelled);
+}
+
+typedef struct
+{
+    EZDEV_SDK_UINT32 seq;
+    volatile uint64_t respond_ns;   ///< 响应线程调用完成接口之前的时刻
+    uint64_t wake_ns;
+    int result;
+    char rsp[32];
+    EZDEV_SDK_UINT32 rsp_len;
+} sync_slot;
+
+static sync_slot g_sync[WAITERS];
+static volatile int g_sync_ready[WAITERS];
+
+static void *sync_waiter_thread(void *arg)
+{
+    sync_slot *slot = (sync_slot *)arg;
+    kernel_request_waiter waiter;
+    sdk_request_option option;
+
+    kernel_request_waiter_init(&waiter, slot->rsp, sizeof(slot->rsp));
+    memset(&option, 0, sizeof(option));
+    option.timeout_ms = 5000;
+    option.cb = kernel_request_waiter_cb;
+    option.user_data = &waiter;
+    if (mkernel_internal_succ != kernel_request_add(slot->seq, kernel_request_v3, MODULE, 0, "query", &option))
+    {
+        slot->result = -1;
+        kernel_request_waiter_fini(&waiter);
+        return NULL;
+    }
+    g_sync_ready[slot - g_sync] = 1;
+    kernel_request_wait(&waiter, slot->seq, option.timeout_ms);
+    slot->wake_ns = test_now_ns();
+    slot->result = (int)waiter.result;
+    slot->rsp_len = waiter.len;
+    kernel_request_waiter_fini(&waiter);
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * \brief   WAITERS个线程同时同步等待, 逐个响应, 统计从调用完成接口到等待者醒来的延迟, 返回中位数(微秒)
+ */
+static uint64_t measure_wake(const char *name, EZDEV_SDK_UINT32 seq_base)
+{
+    pthread_t threads[WAITERS];
+    uint64_t latency[WAITERS * WAIT_ROUNDS];
+    int count = 0;
+    int round = 0;
+    int i = 0;
+
+    for (round = 0; round < WAIT_ROUNDS; round++)
+    {
+        memset(g_sync, 0, sizeof(g_sync));
+        memset((void *)g_sync_ready, 0, sizeof(g_sync_ready));
+        for (i = 0; i < WAITERS; i++)
+        {
+            g_sync[i].seq = seq_base + round * WAITERS + i;
+            pthread_create(&threads[i], NULL, sync_waiter_thread, &g_sync[i]);
+        }
+        for (i = 0; i < WAITERS; i++)
+        {
+            while (!g_sync_ready[i] && 0 == g_sync[i].result)
+            {
+                usleep(100);
+            }
+        }
+        /* 等待者都已经进入等待后再响应, 响应之间错开, 避免同时醒来互相排队 */
+        usleep(2000);
+        for (i = 0; i < WAITERS; i++)
+        {
+            g_sync[i].respond_ns = test_now_ns();
+            TEST_CHECK(respond(g_sync[i].seq, "query_reply", "{\"wake\":1}"));
+            usleep(300);
+        }
+        for (i = 0; i < WAITERS; i++)
+        {
+            pthread_join(threads[i], NULL);
+            TEST_CHECK_MSG(ezdev_sdk_kernel_succ == g_sync[i].result, "%s waiter %d result %d", name, i, g_sync[i].result);
+            TEST_CHECK(10 == g_sync[i].rsp_len && 0 == memcmp(g_sync[i].rsp, "{\"wake\":1}", 10));
+            latency[count++] = (g_sync[i].wake_ns - g_sync[i].respond_ns) / 1000;
+        }
+    }
+
+    qsort(latency, count, sizeof(latency[0]), cmp_u64);
+    printf("%s: %d sync waits, wake latency median %llu us, p99 %llu us, max %llu us\n", name, count,
+           (unsigned long long)latency[count / 2], (unsigned long long)latency[count * 99 / 100],
+           (unsigned long long)latency[count - 1]);
+    return latency[count / 2];
+}
+
+static void case_sync_wake(void)
+{
+    uint64_t sem_median = 0;
+    uint64_t poll_median = 0;
+
+    sem_median = measure_wake("sync_wake semaphore", 300000);
+
+    /* 平台不提供信号量时退化为轮询 */
+    g_ezdev_sdk_kernel.platform_handle.thread_sem_create = NULL;
+    poll_median = measure_wake("sync_wake polling", 400000);
+    g_ezdev_sdk_kernel.platform_handle.thread_sem_create = sdk_platform_thread_sem_create;
+
+    TEST_CHECK_MSG(sem_median < 2000, "semaphore wake median %llu us", (unsigned long long)sem_median);
+    TEST_CHECK_MSG(sem_median < poll_median, "semaphore %llu us vs polling %llu us", (unsigned long long)sem_median,
+                   (unsigned long long)poll_median);
+}
+
+/**
+ * \brief   同步等待超时: 有人驱动时间轮时按请求超时醒来, 没人驱动时多等一段后自己取消
+ */
+static void case_sync_timeout(int driven)
+{
+    kernel_request_waiter waiter;
+    sdk_request_option option;
+    uint64_t start = 0;
+    uint64_t elapsed_ms = 0;
+
+    kernel_request_waiter_init(&waiter, NULL, 0);
+    TEST_CHECK(NULL != waiter.sem);
+    memset(&option, 0, sizeof(option));
+    option.timeout_ms = 50;
+    option.cb = kernel_request_waiter_cb;
+    option.user_data = &waiter;
+    start = test_now_ns();
+    TEST_CHECK(mkernel_internal_succ == kernel_request_add(500000 + driven, kernel_request_v3, MODULE, 0, "query", &option));
+    kernel_request_wait(&waiter, 500000 + driven, option.timeout_ms);
+    elapsed_ms = (test_now_ns() - start) / 1000000;
+    kernel_request_waiter_fini(&waiter);
+
+    TEST_CHECK(ezdev_sdk_kernel_request_timeout == waiter.result);
+    if (driven)
+    {
+        TEST_CHECK_MSG(elapsed_ms >= 45 && elapsed_ms < 500, "driven timeout after %llu ms", (unsigned long long)elapsed_ms);
+    }
+    else
+    {
+        TEST_CHECK_MSG(elapsed_ms >= 1045 && elapsed_ms < 1500, "undriven timeout after %llu ms", (unsigned long long)elapsed_ms);
+    }
+    printf("sync_timeout %s: woke after %llu ms\n", driven ? "driven" : "undriven", (unsigned long long)elapsed_ms);
+    TEST_CHECK(!respond(500000 + driven, "query_reply", "{}"));
+}
+
+int main(void)
+{
+    ezdev_sdk_kernel_platform_handle *handle = &g_ezdev_sdk_kernel.platform_handle;
+    pthread_t driver;
+
+    handle->time_creator = Platform_TimerCreater;
+    handle->time_isexpired_bydiff = Platform_TimeIsExpired_Bydiff;
+    handle->time_isexpired = Platform_TimerIsExpired;
+    handle->time_countdownms = Platform_TimerCountdownMS;
+    handle->time_countdown = Platform_TimerCountdown;
+    handle->time_leftms = Platform_TimerLeftMS;
+    handle->time_destroy = Platform_TimeDestroy;
+    handle->time_sleep = sdk_thread_sleep;
+    handle->thread_mutex_create = sdk_platform_thread_mutex_create;
+    handle->thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    handle->thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    handle->thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+    handle->thread_sem_create = sdk_platform_thread_sem_create;
+    handle->thread_sem_destroy = sdk_platform_thread_sem_destroy;
+    handle->thread_sem_post = sdk_platform_thread_sem_post;
+    handle->thread_sem_wait = sdk_platform_thread_sem_wait;
+
+    TEST_CHECK(mkernel_internal_succ == kernel_timer_service_init());
+    TEST_CHECK(mkernel_internal_succ == kernel_request_service_init());
+
+    case_sync_timeout(0);
+
+    g_driver_stop = 0;
+    pthread_create(&driver, NULL, driver_thread, NULL);
+    case_full_table();
+    case_timeout_race();
+    case_sync_wake();
+    case_sync_timeout(1);
+    g_driver_stop = 1;
+    pthread_join(driver, NULL);
+
+    kernel_request_service_fini();
+    kernel_timer_service_fini();
+    return test_report("test_request");
+}
@@ -0,0 +1,225 @@
+/**
+ * \file      test_sha.c
+ * \brief     SHA-224/256/384/512的已知答案测试, 以及与不用扩展指令的实现(common/sha256_generic.c, sha512_generic.c)的比对
+ *
+ * 库里的SHA-256在x86-64上按CPU走SHA-NI, SHA-384/512走展开的轮函数和16字滚动消息扩展,
+ * AArch64打开BSCOMPTLS_SHA256_A64_CRYPTO/BSCOMPTLS_SHA512_A64_CRYPTO后走ARMv8指令. 打开前在目标机上跑这个测试:
+ * - FIPS 180-2附录的消息("abc"、448位和896位的两段消息、一百万个'a')和空消息
+ * - 随机长度、随机切分update的消息, 库里的实现与通用实现结果相同, 中途clone的上下文得到同样的结果
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+#include "sha_generic.h"
+#include "test_util.h"
+
+#define RANDOM_ROUNDS       2000
+#define RANDOM_LEN_MAX      1200
+#define MILLION_A           1000000
+
+typedef struct
+{
+    const char *msg;
+    const char *sha224;
+    const char *sha256;
+    const char *sha384;
+    const char *sha512;
+} sha_kat;
+
+/* 答案与FIPS 180-2附录相同, 也可以用Python的hashlib核对 */
+static const sha_kat g_sha_kat[] =
+{
+    {
+        "abc",
+        "23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da7",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7",
+        "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+    },
+    {
+        "",
+        "d14a028c2a3a2bc9476102bb288234c415a2b01f828ea62ac5b3e42f",
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da274edebfe76f65fbd51ad2f14898b95b",
+        "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e",
+    },
+    {
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+        "75388b16512776cc5dba5da1fd890150b0c6455cb4f58b1952522525",
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+        "3391fdddfc8dc7393707a65b1b4709397cf8b1d162af05abfe8f450de5f36bc6b0455a8520bc4e6f5fe95b1fe3c8452b",
+        "204a8fc6dda82f0a0ced7beb8e08a41657c16ef468b228a8279be331a703c33596fd15c13b1b07f9aa1d3bea57789ca031ad85c7a71dd70354ec631238ca3445",
+    },
+    {
+        "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+        "c97ca9a559850ce97a04a96def6d99a9e0e0e2ab14e6b8df265fc0b3",
+        "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+        "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039",
+        "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909",
+    },
+};
+
+static const sha_kat g_million_a =
+{
+    NULL,
+    "20794655980c91d8bbb4c1ea97618a4bf03f42581948b2ee4ee7ad67",
+    "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+    "9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b07b8b3dc38ecc4ebae97ddd87f3d8985",
+    "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973ebde0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b",
+};
+
+static int equals_hex(const unsigned char *digest, size_t len, const char *hex)
+{
+    char buf[129];
+    size_t i = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        snprintf(buf + i * 2, 3, "%02x", digest[i]);
+    }
+    return strlen(hex) == len * 2 && 0 == memcmp(buf, hex, len * 2);
+}
+
+static void check_digests(const unsigned char *msg, size_t len, const sha_kat *kat)
+{
+    unsigned char out[64];
+
+    bscomptls_sha256(msg, len, out, 1);
+    TEST_CHECK_MSG(equals_hex(out, 28, kat->sha224), "sha224, %zu bytes", len);
+    bscomptls_sha256(msg, len, out, 0);
+    TEST_CHECK_MSG(equals_hex(out, 32, kat->sha256), "sha256, %zu bytes", len);
+    bscomptls_sha512(msg, len, out, 1);
+    TEST_CHECK_MSG(equals_hex(out, 48, kat->sha384), "sha384, %zu bytes", len);
+    bscomptls_sha512(msg, len, out, 0);
+    TEST_CHECK_MSG(equals_hex(out, 64, kat->sha512), "sha512, %zu bytes", len);
+
+    generic_sha256(msg, len, out, 0);
+    TEST_CHECK_MSG(equals_hex(out, 32, kat->sha256), "generic sha256, %zu bytes", len);
+    generic_sha512(msg, len, out, 0);
+    TEST_CHECK_MSG(equals_hex(out, 64, kat->sha512), "generic sha512, %zu bytes", len);
+}
+
+static void case_kat(void)
+{
+    unsigned char *million = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(g_sha_kat) / sizeof(g_sha_kat[0]); i++)
+    {
+        check_digests((const unsigned char *)g_sha_kat[i].msg, strlen(g_sha_kat[i].msg), &g_sha_kat[i]);
+    }
+
+    million = (unsigned char *)malloc(MILLION_A);
+    TEST_CHECK(NULL != million);
+    if (NULL != million)
+    {
+        memset(million, 'a', MILLION_A);
+        check_digests(million, MILLION_A, &g_million_a);
+        free(million);
+    }
+}
+
+/* 下一段update的长度: 1到200字节, 不超过剩余的长度 */
+static size_t next_chunk(size_t left)
+{
+    return 1 + test_rand_below(left < 200 ? (uint32_t)left : 200);
+}
+
+/* 把msg切成随机长度的几段update; 第一段之后clone一份, clone的上下文一次update剩下的部分 */
+static void split_sha256(const unsigned char *msg, size_t len, int is224, unsigned char out[32], unsigned char cloned[32])
+{
+    bscomptls_sha256_context ctx;
+    bscomptls_sha256_context copy;
+    size_t first = test_rand_below((uint32_t)len + 1);
+    size_t off = first;
+    size_t n = 0;
+
+    bscomptls_sha256_init(&ctx);
+    bscomptls_sha256_init(&copy);
+    bscomptls_sha256_starts(&ctx, is224);
+    bscomptls_sha256_update(&ctx, msg, first);
+    bscomptls_sha256_clone(&copy, &ctx);
+    bscomptls_sha256_update(&copy, msg + first, len - first);
+    while (off < len)
+    {
+        n = next_chunk(len - off);
+        bscomptls_sha256_update(&ctx, msg + off, n);
+        off += n;
+    }
+    bscomptls_sha256_finish(&ctx, out);
+    bscomptls_sha256_finish(&copy, cloned);
+    bscomptls_sha256_free(&ctx);
+    bscomptls_sha256_free(&copy);
+}
+
+static void split_sha512(const unsigned char *msg, size_t len, int is384, unsigned char out[64], unsigned char cloned[64])
+{
+    bscomptls_sha512_context ctx;
+    bscomptls_sha512_context copy;
+    size_t first = test_rand_below((uint32_t)len + 1);
+    size_t off = first;
+    size_t n = 0;
+
+    bscomptls_sha512_init(&ctx);
+    bscomptls_sha512_init(&copy);
+    bscomptls_sha512_starts(&ctx, is384);
+    bscomptls_sha512_update(&ctx, msg, first);
+    bscomptls_sha512_clone(&copy, &ctx);
+    bscomptls_sha512_update(&copy, msg + first, len - first);
+    while (off < len)
+    {
+        n = next_chunk(len - off);
+        bscomptls_sha512_update(&ctx, msg + off, n);
+        off += n;
+    }
+    bscomptls_sha512_finish(&ctx, out);
+    bscomptls_sha512_finish(&copy, cloned);
+    bscomptls_sha512_free(&ctx);
+    bscomptls_sha512_free(&copy);
+}
+
+static void case_random(void)
+{
+    unsigned char msg[RANDOM_LEN_MAX];
+    unsigned char out[64];
+    unsigned char cloned[64];
+    unsigned char expect[64];
+    size_t len = 0;
+    size_t i = 0;
+    int round = 0;
+    int truncated = 0;
+
+    test_rand_seed(44);
+    for (round = 0; round < RANDOM_ROUNDS && 0 == test_failures; round++)
+    {
+        /* 前面几轮覆盖块边界附近的每个长度, 之后随机 */
+        len = round < 300 ? (size_t)round : test_rand_below(RANDOM_LEN_MAX + 1);
+        for (i = 0; i < len; i++)
+        {
+            msg[i] = (unsigned char)test_rand();
+        }
+        if (round % 7 == 0)
+        {
+            memset(msg, round % 14 ? 0xFF : 0x00, len);
+        }
+        truncated = round & 1;
+
+        split_sha256(msg, len, truncated, out, cloned);
+        generic_sha256(msg, len, expect, truncated);
+        TEST_CHECK_MSG(0 == memcmp(out, expect, truncated ? 28 : 32), "sha%d, %zu bytes", truncated ? 224 : 256, len);
+        TEST_CHECK_MSG(0 == memcmp(cloned, expect, truncated ? 28 : 32), "cloned sha%d, %zu bytes", truncated ? 224 : 256, len);
+
+        split_sha512(msg, len, truncated, out, cloned);
+        generic_sha512(msg, len, expect, truncated);
+        TEST_CHECK_MSG(0 == memcmp(out, expect, truncated ? 48 : 64), "sha%d, %zu bytes", truncated ? 384 : 512, len);
+        TEST_CHECK_MSG(0 == memcmp(cloned, expect, truncated ? 48 : 64), "cloned sha%d, %zu bytes", truncated ? 384 : 512, len);
+    }
+}
+
+int main(void)
+{
+    case_kat();
+    case_random();
+    return test_report("test_sha");
+}
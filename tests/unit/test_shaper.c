@@ -0,0 +1,292 @@
+/**
+ * \file      test_shaper.c
+ * \brief     发送限速令牌桶测试
+ *
+ * kernel_shaper_acquire的时间由调用者传入, 这里全部用虚拟时钟驱动, 不睡眠:
+ * 速率和桶容量、超过桶容量的消息、强制放行透支、全局和module/领域两级叠加、
+ * 延后事件只报一次、配置更新和取消、时钟回绕, 以及长时间贪婪发送时的实际速率.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "test_util.h"
+#include "sdk_kernel_def.h"
+#include "ezdev_sdk_kernel_shaper.h"
+#include "mkernel_internal_error.h"
+#include "platform_define.h"
+
+EZDEV_SDK_KERNEL_SHAPER_INTERFACE
+MUTEX_PLATFORM_INTERFACE
+
+extern ezdev_sdk_kernel g_ezdev_sdk_kernel;
+
+static sdk_send_shaped_context g_shaped;
+static EZDEV_SDK_INT8 g_report;
+
+static void reset(void)
+{
+    kernel_shaper_service_fini();
+    TEST_CHECK(mkernel_internal_succ == kernel_shaper_service_init());
+}
+
+static int set_limit(sdk_shaper_scope scope, const char *module, EZDEV_SDK_UINT32 domain_id, EZDEV_SDK_UINT32 msg_rate,
+                     EZDEV_SDK_UINT32 msg_burst, EZDEV_SDK_UINT32 byte_rate, EZDEV_SDK_UINT32 byte_burst, EZDEV_SDK_UINT32 now_ms)
+{
+    sdk_shaper_config config;
+
+    memset(&config, 0, sizeof(config));
+    config.scope = scope;
+    if (NULL != module)
+    {
+        strncpy(config.module, module, sizeof(config.module) - 1);
+    }
+    config.domain_id = domain_id;
+    config.msg_rate = msg_rate;
+    config.msg_burst = msg_burst;
+    config.byte_rate = byte_rate;
+    config.byte_burst = byte_burst;
+    return kernel_shaper_config(&config, now_ms);
+}
+
+static EZDEV_SDK_UINT32 acquire(const char *module, EZDEV_SDK_UINT32 bytes, EZDEV_SDK_UINT32 now_ms)
+{
+    return kernel_shaper_acquire(module, 0, bytes, 0, now_ms, &g_shaped, &g_report);
+}
+
+static void test_msg_rate(void)
+{
+    int i = 0;
+
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 10, 10, 0, 0, 1000));
+    for (i = 0; i < 10; i++)
+    {
+        TEST_CHECK(0 == acquire("model", 100, 1000));
+    }
+    /* 桶空了, 10个/秒补一个要100ms */
+    TEST_CHECK_MSG(100 == acquire("model", 100, 1000), "wait %u", acquire("model", 100, 1000));
+    TEST_CHECK(40 == acquire("model", 100, 1060));
+    TEST_CHECK(0 == acquire("model", 100, 1100));
+    TEST_CHECK(100 == acquire("model", 100, 1100));
+    kernel_shaper_service_fini();
+}
+
+static void test_byte_rate(void)
+{
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 0, 0, 1000, 1000, 0));
+    TEST_CHECK(0 == acquire("ota", 600, 0));
+    /* 剩400, 还差200字节, 1000字节/秒 */
+    TEST_CHECK(200 == acquire("ota", 600, 0));
+    TEST_CHECK(0 == acquire("ota", 600, 200));
+    TEST_CHECK(0 == acquire("ota", 0, 200));
+    kernel_shaper_service_fini();
+}
+
+static void test_oversized(void)
+{
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 0, 0, 1000, 1000, 0));
+    TEST_CHECK(0 == acquire("ota", 500, 0));
+    /* 5000字节大于桶容量, 等桶满(再补500字节)后放行, 余额扣成-4000 */
+    TEST_CHECK(500 == acquire("ota", 5000, 0));
+    TEST_CHECK(0 == acquire("ota", 5000, 500));
+    /* 偿还4000字节后再攒够1字节 */
+    TEST_CHECK(4001 == acquire("ota", 1, 500));
+    TEST_CHECK(0 == acquire("ota", 1, 4501));
+    kernel_shaper_service_fini();
+}
+
+static void test_force(void)
+{
+    int i = 0;
+
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 10, 10, 0, 0, 0));
+    for (i = 0; i < 15; i++)
+    {
+        TEST_CHECK(0 == kernel_shaper_acquire("control", 0, 10, 1, 0, &g_shaped, &g_report));
+        TEST_CHECK(0 == g_report);
+    }
+    /* 透支5个, 再攒够1个要600ms */
+    TEST_CHECK(600 == acquire("model", 10, 0));
+    TEST_CHECK(0 == acquire("model", 10, 600));
+    kernel_shaper_service_fini();
+}
+
+static void test_two_levels(void)
+{
+    int i = 0;
+
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 100, 100, 0, 0, 0));
+    TEST_CHECK(0 == set_limit(sdk_shaper_module, "ota", 0, 2, 2, 0, 0, 0));
+    TEST_CHECK(0 == acquire("ota", 1, 0));
+    TEST_CHECK(0 == acquire("ota", 1, 0));
+
+    /* module限速先卡住, 只报一次延后 */
+    TEST_CHECK(500 == acquire("ota", 1, 0));
+    TEST_CHECK(1 == g_report);
+    TEST_CHECK(sdk_shaper_module == g_shaped.scope && 0 == strcmp(g_shaped.module, "ota") && 500 == g_shaped.delay_ms);
+    TEST_CHECK(250 == acquire("ota", 1, 250));
+    TEST_CHECK(0 == g_report);
+
+    /* 其它module只受全局限速; 全局剩98个, 250ms补25个但不超过桶容量100 */
+    for (i = 0; i < 100; i++)
+    {
+        TEST_CHECK(0 == acquire("model", 1, 250));
+    }
+    TEST_CHECK(10 == acquire("model", 1, 250));
+    TEST_CHECK(1 == g_report && sdk_shaper_global == g_shaped.scope);
+
+    /* 领域限速只对v2消息(module为NULL)生效 */
+    TEST_CHECK(0 == set_limit(sdk_shaper_domain, NULL, 4801, 1, 1, 0, 0, 10000));
+    TEST_CHECK(0 == kernel_shaper_acquire(NULL, 4801, 1, 0, 10000, &g_shaped, &g_report));
+    TEST_CHECK(1000 == kernel_shaper_acquire(NULL, 4801, 1, 0, 10000, &g_shaped, &g_report));
+    TEST_CHECK(1 == g_report && sdk_shaper_domain == g_shaped.scope && 4801 == g_shaped.domain_id);
+    TEST_CHECK(0 == kernel_shaper_acquire(NULL, 4802, 1, 0, 10000, &g_shaped, &g_report));
+    kernel_shaper_service_fini();
+}
+
+static void test_report_rearm(void)
+{
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_module, "model", 0, 10, 2, 0, 0, 0));
+    TEST_CHECK(0 == acquire("model", 1, 0));
+    TEST_CHECK(0 == acquire("model", 1, 0));
+    TEST_CHECK(100 == acquire("model", 1, 0) && 1 == g_report);
+    TEST_CHECK(0 == acquire("model", 1, 100) && 0 == g_report);
+    TEST_CHECK(100 == acquire("model", 1, 100) && 0 == g_report);
+
+    /* 桶重新攒满说明积压发完, 下一次被限速重新上报 */
+    TEST_CHECK(0 == acquire("model", 1, 1000));
+    TEST_CHECK(0 == acquire("model", 1, 1000));
+    TEST_CHECK(100 == acquire("model", 1, 1000) && 1 == g_report);
+    kernel_shaper_service_fini();
+}
+
+static void test_config_update(void)
+{
+    int i = 0;
+
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 10, 10, 0, 0, 0));
+    for (i = 0; i < 5; i++)
+    {
+        TEST_CHECK(0 == acquire("model", 1, 0));
+    }
+    /* 改速率不重新装满, 余额超过新容量时截断 */
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 1, 2, 0, 0, 0));
+    TEST_CHECK(0 == acquire("model", 1, 0));
+    TEST_CHECK(0 == acquire("model", 1, 0));
+    TEST_CHECK(1000 == acquire("model", 1, 0));
+
+    /* 两个速率都为0取消限速 */
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 0, 0, 0, 0, 0));
+    for (i = 0; i < 100; i++)
+    {
+        TEST_CHECK(0 == acquire("model", 1, 0));
+    }
+
+    TEST_CHECK(mkernel_internal_input_param_invalid == kernel_shaper_config(NULL, 0));
+    TEST_CHECK(mkernel_internal_input_param_invalid == set_limit(sdk_shaper_module, "", 0, 1, 1, 0, 0, 0));
+
+    /* 条数用完 */
+    for (i = 0; i < kernel_shaper_max; i++)
+    {
+        TEST_CHECK(0 == set_limit(sdk_shaper_domain, NULL, (EZDEV_SDK_UINT32)i, 1, 1, 0, 0, 0));
+    }
+    TEST_CHECK(mkernel_internal_mem_lack == set_limit(sdk_shaper_domain, NULL, 1000, 1, 1, 0, 0, 0));
+    TEST_CHECK(0 == set_limit(sdk_shaper_domain, NULL, 3, 0, 0, 0, 0, 0));
+    TEST_CHECK(0 == set_limit(sdk_shaper_domain, NULL, 1000, 1, 1, 0, 0, 0));
+    kernel_shaper_service_fini();
+}
+
+static void test_clock_wrap(void)
+{
+    EZDEV_SDK_UINT32 start = 0xFFFFFF00u;
+
+    reset();
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, 10, 1, 0, 0, start));
+    TEST_CHECK(0 == acquire("model", 1, start));
+    TEST_CHECK(100 == acquire("model", 1, start));
+    /* 毫秒计数回绕到0附近, 差值仍按无符号计算 */
+    TEST_CHECK(0 == acquire("model", 1, start + 100));
+    TEST_CHECK(100 == acquire("model", 1, start + 100));
+    TEST_CHECK(0 == acquire("model", 1, start + 300));
+    kernel_shaper_service_fini();
+}
+
+/**
+ * \brief   按返回的等待时间推进虚拟时钟贪婪发送, 统计实际速率
+ */
+static void check_long_run(EZDEV_SDK_UINT32 msg_rate, EZDEV_SDK_UINT32 byte_rate, EZDEV_SDK_UINT32 burst_bytes)
+{
+    EZDEV_SDK_UINT32 now = 0;
+    EZDEV_SDK_UINT32 wait = 0;
+    uint64_t msgs = 0;
+    uint64_t bytes = 0;
+    uint64_t expect_msgs = 0;
+    uint64_t expect_bytes = 0;
+    EZDEV_SDK_UINT32 size = 0;
+    const EZDEV_SDK_UINT32 duration = 60000;
+
+    reset();
+    test_rand_seed(msg_rate * 7919u + byte_rate);
+    TEST_CHECK(0 == set_limit(sdk_shaper_global, NULL, 0, msg_rate, 0, byte_rate, burst_bytes, 0));
+    size = 1 + test_rand_below(2000);
+    while (now < duration)
+    {
+        wait = acquire("model", size, now);
+        if (0 == wait)
+        {
+            msgs++;
+            bytes += size;
+            size = 1 + test_rand_below(2000);
+            continue;
+        }
+        /* 等待时间不能比按当前速率算出来的上限还长 */
+        TEST_CHECK_MSG(wait <= 1000 + (byte_rate ? (uint64_t)2000 * 1000 / byte_rate : 0), "wait %u", wait);
+        now += wait;
+    }
+
+    /* 桶容量为0时取速率 */
+    expect_msgs = msg_rate ? (uint64_t)msg_rate * duration / 1000 + msg_rate : msgs;
+    expect_bytes = byte_rate ? (uint64_t)byte_rate * duration / 1000 + (burst_bytes ? burst_bytes : byte_rate) : bytes;
+    /* 上限: 速率乘时间加一桶; 消息大小随机, 允许最后一条超出 */
+    TEST_CHECK_MSG(msgs <= expect_msgs + 1, "msgs %llu > %llu", (unsigned long long)msgs, (unsigned long long)expect_msgs);
+    TEST_CHECK_MSG(bytes <= expect_bytes + 2000, "bytes %llu > %llu", (unsigned long long)bytes, (unsigned long long)expect_bytes);
+    /* 下限: 贪婪发送时受限的那个维度至少用满98% */
+    TEST_CHECK_MSG((msg_rate && msgs * 100 >= expect_msgs * 98) || (byte_rate && bytes * 100 >= expect_bytes * 98),
+                   "underused: msgs %llu/%llu bytes %llu/%llu", (unsigned long long)msgs, (unsigned long long)expect_msgs,
+                   (unsigned long long)bytes, (unsigned long long)expect_bytes);
+    kernel_shaper_service_fini();
+}
+
+static void test_long_run(void)
+{
+    check_long_run(50, 0, 0);
+    check_long_run(0, 20000, 0);
+    check_long_run(0, 3000, 500);
+    check_long_run(1000, 50000, 8000);
+    check_long_run(3, 100000, 0);
+}
+
+int main(void)
+{
+    /* 只用到平台层的锁 */
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_create = sdk_platform_thread_mutex_create;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_destroy = sdk_platform_thread_mutex_destroy;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_lock = sdk_platform_thread_mutex_lock;
+    g_ezdev_sdk_kernel.platform_handle.thread_mutex_unlock = sdk_platform_thread_mutex_unlock;
+
+    test_msg_rate();
+    test_byte_rate();
+    test_oversized();
+    test_force();
+    test_two_levels();
+    test_report_rearm();
+    test_config_update();
+    test_clock_wrap();
+    test_long_run();
+    return test_report("test_shaper");
+}
@@ -0,0 +1,381 @@
+/**
+ * \file      test_xml_stream.c
+ * \brief     ezxml_stream与ezxml_parse_str的一致性测试
+ *
+ * 同一文档分别用ezxml建树和用ezxml_stream按各种分片喂入, 两边都展开成
+ * "深度:标签 属性=[值]... {文本}" 的文本形式再比较. 文本按ezxml的语义拼接
+ * (只保留元素自身的文本, 不含子元素), 所以混合内容也能对上.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "ezxml.h"
+#include "ezxml_stream.h"
+#include "test_util.h"
+
+#define DUMP_MAX (256 * 1024)
+#define DEPTH_MAX 64
+
+typedef struct
+{
+    char *line;
+    size_t line_len;
+    char *text;
+    size_t text_len;
+} element_rec;
+
+typedef struct
+{
+    element_rec *recs;
+    size_t count;
+    size_t cap;
+    size_t stack[DEPTH_MAX];
+    size_t depth;
+    int bad_event;
+} stream_rec;
+
+static void append(char **buf, size_t *len, const char *s, size_t n)
+{
+    *buf = realloc(*buf, *len + n + 1);
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+}
+
+static void appends(char **buf, size_t *len, const char *s)
+{
+    append(buf, len, s, strlen(s));
+}
+
+static int stream_cb(void *user, ezxml_stream_event event, const char *name, const char *value, size_t len)
+{
+    stream_rec *rec = (stream_rec *)user;
+    element_rec *cur = NULL;
+    char tmp[32];
+
+    switch (event)
+    {
+    case EZXML_STREAM_START:
+        if (rec->depth >= DEPTH_MAX)
+        {
+            rec->bad_event = 1;
+            return 1;
+        }
+        if (rec->count == rec->cap)
+        {
+            rec->cap = rec->cap ? rec->cap * 2 : 16;
+            rec->recs = realloc(rec->recs, rec->cap * sizeof(element_rec));
+        }
+        cur = &rec->recs[rec->count];
+        memset(cur, 0, sizeof(*cur));
+        snprintf(tmp, sizeof(tmp), "%u:", (unsigned)rec->depth);
+        appends(&cur->line, &cur->line_len, tmp);
+        appends(&cur->line, &cur->line_len, name);
+        rec->stack[rec->depth++] = rec->count++;
+        break;
+    case EZXML_STREAM_ATTR:
+        if (rec->depth == 0 || strlen(value) != len)
+        {
+            rec->bad_event = 1;
+            return 1;
+        }
+        cur = &rec->recs[rec->stack[rec->depth - 1]];
+        appends(&cur->line, &cur->line_len, " ");
+        appends(&cur->line, &cur->line_len, name);
+        appends(&cur->line, &cur->line_len, "=[");
+        append(&cur->line, &cur->line_len, value, len);
+        appends(&cur->line, &cur->line_len, "]");
+        break;
+    case EZXML_STREAM_TEXT:
+        if (rec->depth == 0)
+        {
+            rec->bad_event = 1;
+            return 1;
+        }
+        cur = &rec->recs[rec->stack[rec->depth - 1]];
+        append(&cur->text, &cur->text_len, value, len);
+        break;
+    case EZXML_STREAM_END:
+        if (rec->depth == 0)
+        {
+            rec->bad_event = 1;
+            return 1;
+        }
+        rec->depth--;
+        break;
+    }
+
+    return 0;
+}
+
+static void stream_rec_clear(stream_rec *rec)
+{
+    size_t i;
+    for (i = 0; i < rec->count; i++)
+    {
+        free(rec->recs[i].line);
+        free(rec->recs[i].text);
+    }
+    free(rec->recs);
+    memset(rec, 0, sizeof(*rec));
+}
+
+static void dump_dom(ezxml_t xml, unsigned depth, char **out, size_t *len)
+{
+    ezxml_t child;
+    char tmp[32];
+    int i;
+
+    snprintf(tmp, sizeof(tmp), "%u:", depth);
+    appends(out, len, tmp);
+    appends(out, len, xml->name);
+    for (i = 0; xml->attr[i]; i += 2)
+    {
+        appends(out, len, " ");
+        appends(out, len, xml->attr[i]);
+        appends(out, len, "=[");
+        appends(out, len, xml->attr[i + 1]);
+        appends(out, len, "]");
+    }
+    appends(out, len, " {");
+    appends(out, len, xml->txt);
+    appends(out, len, "}\n");
+
+    for (child = xml->child; child; child = child->ordered)
+    {
+        dump_dom(child, depth + 1, out, len);
+    }
+}
+
+static char *dump_stream(stream_rec *rec)
+{
+    char *out = NULL;
+    size_t len = 0;
+    size_t i;
+
+    appends(&out, &len, "");
+    for (i = 0; i < rec->count; i++)
+    {
+        append(&out, &len, rec->recs[i].line, rec->recs[i].line_len);
+        appends(&out, &len, " {");
+        if (rec->recs[i].text)
+        {
+            append(&out, &len, rec->recs[i].text, rec->recs[i].text_len);
+        }
+        appends(&out, &len, "}\n");
+    }
+    return out;
+}
+
+/**
+ * \brief   按给定分片方式解析, split为0时每片长度随机(1~97)
+ */
+static int stream_parse(const char *doc, size_t doc_len, size_t split, stream_rec *rec, char *err, size_t err_len)
+{
+    ezxml_stream_t st = ezxml_stream_new(stream_cb, rec, 0);
+    size_t off = 0;
+    int rv = 0;
+
+    if (st == NULL)
+    {
+        return -1;
+    }
+
+    while (off < doc_len)
+    {
+        size_t n = split ? split : 1 + test_rand_below(97);
+        if (n > doc_len - off)
+        {
+            n = doc_len - off;
+        }
+        rv = ezxml_stream_feed(st, doc + off, n);
+        if (rv != 0)
+        {
+            break;
+        }
+        off += n;
+    }
+
+    if (rv == 0)
+    {
+        rv = ezxml_stream_finish(st);
+    }
+
+    snprintf(err, err_len, "%s", ezxml_stream_error(st));
+    ezxml_stream_free(st);
+    return rv;
+}
+
+static void check_document(const char *tag, const char *doc)
+{
+    size_t doc_len = strlen(doc);
+    char *copy = strdup(doc);
+    ezxml_t xml = ezxml_parse_str(copy, doc_len);
+    char *expect = NULL;
+    size_t expect_len = 0;
+    size_t split;
+    char err[256];
+
+    TEST_CHECK_MSG(xml != NULL && *ezxml_error(xml) == '\0', "%s: ezxml rejects the reference document", tag);
+    if (xml == NULL)
+    {
+        free(copy);
+        return;
+    }
+    dump_dom(xml, 0, &expect, &expect_len);
+
+    for (split = 0; split <= 64 || split == doc_len; split = (split < 64) ? split + 1 : doc_len)
+    {
+        stream_rec rec;
+        char *got;
+        int rv;
+
+        memset(&rec, 0, sizeof(rec));
+        rv = stream_parse(doc, doc_len, split, &rec, err, sizeof(err));
+        got = dump_stream(&rec);
+
+        TEST_CHECK_MSG(rv == 0, "%s: split %u: %s", tag, (unsigned)split, err);
+        TEST_CHECK_MSG(!rec.bad_event && rec.depth == 0, "%s: split %u: unbalanced events", tag, (unsigned)split);
+        TEST_CHECK_MSG(0 == strcmp(expect, got), "%s: split %u\n--ezxml--\n%s--stream--\n%s", tag, (unsigned)split, expect, got);
+
+        free(got);
+        stream_rec_clear(&rec);
+        if (split == doc_len)
+        {
+            break;
+        }
+    }
+
+    free(expect);
+    ezxml_free(xml);
+    free(copy);
+}
+
+static void check_rejected(const char *doc)
+{
+    size_t doc_len = strlen(doc);
+    char *copy = strdup(doc);
+    ezxml_t xml = ezxml_parse_str(copy, doc_len);
+    size_t split;
+    char err[256];
+
+    TEST_CHECK_MSG(xml == NULL || *ezxml_error(xml) != '\0', "ezxml accepts the malformed document: %s", doc);
+    ezxml_free(xml);
+    free(copy);
+
+    for (split = 1; split <= doc_len || split == 1; split++)
+    {
+        stream_rec rec;
+        int rv;
+
+        memset(&rec, 0, sizeof(rec));
+        rv = stream_parse(doc, doc_len, split, &rec, err, sizeof(err));
+        TEST_CHECK_MSG(rv != 0 && err[0] != '\0', "accepted malformed document (split %u): %s", (unsigned)split, doc);
+        stream_rec_clear(&rec);
+    }
+}
+
+/**
+ * \brief   随机生成一份合法文档: 嵌套, 属性, 实体, CDATA, 注释, 混合内容和自闭合标签
+ */
+static void gen_element(char **out, size_t *len, int depth)
+{
+    static const char *names[] = {"a", "Request", "DomainName", "x-y", "n_1", "ISAPI", "ns:tag"};
+    static const char *texts[] = {"text", " ", "a&amp;b", "&lt;&gt;", "&#65;&#x4e2d;", "\r\n", "\n  ",
+                                  "<![CDATA[raw <b>&amp;]]>", "<!-- skip -->", "<?pi x?>", "&quot;&apos;", "]]"};
+    static const char *values[] = {"1", "", "a b", "&amp;", "x\r\ny", "\t&#x41;", "'", "&lt;"};
+    const char *name = names[test_rand_below(sizeof(names) / sizeof(names[0]))];
+    unsigned attrs = test_rand_below(4);
+    unsigned items = depth < 5 ? test_rand_below(6) : 0;
+    unsigned i;
+
+    appends(out, len, "<");
+    appends(out, len, name);
+    for (i = 0; i < attrs; i++)
+    {
+        char attr[16];
+        const char *value = values[test_rand_below(sizeof(values) / sizeof(values[0]))];
+        int single = strchr(value, '\'') == NULL && test_rand_below(2);
+
+        snprintf(attr, sizeof(attr), "%sk%u%s=", test_rand_below(2) ? " " : "\n ", i, test_rand_below(3) ? "" : " ");
+        appends(out, len, attr);
+        appends(out, len, single ? "'" : "\"");
+        appends(out, len, value);
+        appends(out, len, single ? "'" : "\"");
+    }
+
+    if (items == 0 && test_rand_below(2))
+    {
+        appends(out, len, test_rand_below(2) ? "/>" : " />");
+        return;
+    }
+
+    appends(out, len, ">");
+    for (i = 0; i < items; i++)
+    {
+        if (test_rand_below(2))
+        {
+            gen_element(out, len, depth + 1);
+        }
+        else
+        {
+            appends(out, len, texts[test_rand_below(sizeof(texts) / sizeof(texts[0]))]);
+        }
+    }
+    appends(out, len, "</");
+    appends(out, len, name);
+    appends(out, len, ">");
+}
+
+int main(void)
+{
+    static const char *documents[] = {
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n<!-- hi - there -->\n<Request a=\"1 &amp; 2\" b='x\r\ny'>\r\n"
+        " <DomainName>dev.ys7.com</DomainName>\n<x/><y  k = \"&#x4e2d;&lt;&gt;\"/>text&amp;more&#65;"
+        "<![CDATA[raw <b>]]]>]]>tail</Request>",
+        "<!DOCTYPE a [<!ELEMENT a ANY>]><a><b><c>1</c>2</b>3<b>4</b></a>",
+        "<ISAPI><Event><id>5</id><desc>a &quot;q&quot; &apos;</desc></Event></ISAPI>\n",
+        "<Response><Result>0</Result><DasInfo Address=\"10.0.0.1\" Port=\"8666\" Udpport=\"6000\"/>"
+        "<Domain>dev.ys7.com</Domain><Token>0123456789abcdef</Token></Response>",
+        "<a/>",
+        "<a\n\tb = 'c'\n/>",
+        "<a x=1></a>",
+    };
+    static const char *malformed[] = {
+        "<a></b>",
+        "<a>",
+        "",
+        "<a><b></a>",
+        "<a x=\"1></a>",
+        "</a>",
+        "<a><!-- open",
+        "<a><![CDATA[open</a>",
+    };
+    char name[32];
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++)
+    {
+        snprintf(name, sizeof(name), "doc %u", (unsigned)i);
+        check_document(name, documents[i]);
+    }
+
+    test_rand_seed(20201019);
+    for (i = 0; i < 300; i++)
+    {
+        char *doc = NULL;
+        size_t len = 0;
+
+        appends(&doc, &len, test_rand_below(2) ? "<?xml version=\"1.0\"?>\n" : "");
+        gen_element(&doc, &len, 0);
+        snprintf(name, sizeof(name), "random %u", (unsigned)i);
+        check_document(name, doc);
+        free(doc);
+    }
+
+    for (i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+    {
+        check_rejected(malformed[i]);
+    }
+
+    return test_report("test_xml_stream");
+}